@@ -18,6 +18,7 @@
 #   $ python
 #   >>> import hdgeant4
 #   >>> hdgeant4.pick_point3D(0,0,65)
+#   >>> probe = hdgeant4.probePoints(xarray, yarray, zarray, 8)
 #   >>> hdgeant4.stdviews()
 #   >>> hdgeant4.gUImanager.ApplyCommand("/vis/viewer/zoomTo 50")
 #   >>> hdgeant4.gUImanager.ApplyCommand("/vis/ogl/export pic.eps")
@@ -104,5 +105,27 @@ def checkBfield(infile):
     coord = line.split()
     pickPoint3D(float(coord[0]), float(coord[1]), float(coord[2]))
 
+def probeBfield(infile, nthreads=1):
+  '''
+  Same as checkBfield, but probes all of the points in one call to
+  probePoints spread over nthreads threads, and prints one line for
+  each point in the format of "sampler.py scan4", ready for comparison
+  with "sampler.py compare".
+  '''
+  import numpy
+  G4GeometryManager.GetInstance().CloseGeometry()
+  xyz = numpy.loadtxt(infile, usecols=(0,1,2), ndmin=2)
+  probe = probePoints(xyz[:,0], xyz[:,1], xyz[:,2], nthreads)
+  names = probe["volume_names"]
+  for n in range(len(xyz)):
+    vol = probe["volume"][n]
+    print "{0:7.2f} ".format(xyz[n,0]), \
+          "{0:7.2f} ".format(xyz[n,1]), \
+          "{0:7.2f}    ".format(xyz[n,2]), \
+          names[vol] if vol >= 0 else "NONE", \
+          "{0:12.7f} ".format(probe["Bx"][n]), \
+          "{0:12.7f} ".format(probe["By"][n]), \
+          "{0:12.7f} ".format(probe["Bz"][n])
+
 # Automatic actions at startup
 init()
@@ -55,7 +55,9 @@
 #include <CobremsGenerator.hh>
 #include <boost/math/special_functions/expint.hpp>
 #include <boost/math/special_functions/erf.hpp>
+#include <thread>
 
+const int CobremsGenerator::model_version = 2;
 const double CobremsGenerator::dpi = 3.1415926535897;
 const double CobremsGenerator::me = 0.510998910e-3;
 const double CobremsGenerator::alpha = 7.2973525698e-3;
@@ -147,6 +149,62 @@ void CobremsGenerator::setTargetCrystal(std::string crystal)
 
    // compute the radiation length
    fTargetCrystal.radiation_length = getTargetRadiationLength_Schiff();
+
+   buildReciprocalLattice();
+}
+
+void CobremsGenerator::buildReciprocalLattice()
+{
+   // Tabulate the reciprocal lattice vectors that contribute to the
+   // coherent rate, ie. that pass the selection rules for the diamond
+   // lattice and have a non-vanishing structure factor, together with
+   // the factors in their weight that depend only on |q|, which does
+   // not change when the crystal is rotated. This only needs to be done
+   // when the crystal is changed. The order of the planes in the table
+   // is the order in which they are summed in Rate_dNcdxdp.
+
+   double a = fTargetCrystal.lattice_constant;
+   double qnorm = hbarc * 2 * dpi / a;
+   double betaFF2 = pow(fTargetCrystal.betaFF, 2);
+   fTargetCrystal.planes.clear();
+   // can restrict to h=0 for cpu speedup, if crystal alignment is "reasonable"
+   for (int h = -4; h <= 4; ++h) {
+      for (int k = -10; k <= 10; ++k) {
+         for (int l = -10; l <= 10; ++l) {
+            if (h/2 * 2 == h) {
+               if (k/2 * 2 != k || l/2 * 2 != l ||
+                   (h + k + l)/4 * 4 != h + k + l)
+               {
+                  continue;
+               }
+            }
+            else if (k/2 * 2 == k || l/2 * 2 == l) {
+              continue;
+            }
+            double ReS = 0;
+            double ImS = 0;
+            for (int i=0; i < fTargetCrystal.nsites; ++i) {
+              double qdota = 2 * dpi * (h * fTargetCrystal.ucell_site[i].x +
+                                        k * fTargetCrystal.ucell_site[i].y +
+                                        l * fTargetCrystal.ucell_site[i].z);
+              ReS += cos(qdota);
+              ImS += sin(qdota);
+            }
+            double S2 = ReS*ReS + ImS*ImS;
+            if (S2 < 1e-4)
+               continue;
+            reciprocal_plane_t plane;
+            plane.h = h;
+            plane.k = k;
+            plane.l = l;
+            plane.q2 = qnorm*qnorm * (h*h + k*k + l*l);
+            double FF = 1 / (1 + plane.q2 * betaFF2);
+            plane.weight = S2 * pow(FF * betaFF2, 2) *
+                           exp(-plane.q2 * fTargetCrystal.Debye_Waller_const);
+            fTargetCrystal.planes.push_back(plane);
+         }
+      }
+   }
 }
 
 double CobremsGenerator::getTargetDebyeWallerConstant(double DebyeT_K, 
@@ -449,6 +507,9 @@ CobremsGenerator::CobremsGenerator(const CobremsGenerator &src)
    fCollimatorSpotrms = src.fCollimatorSpotrms;
    fCollimatorDistance = src.fCollimatorDistance;
    fCollimatorDiameter = src.fCollimatorDiameter;
+   fCollimatedFlag = src.fCollimatedFlag;
+   fPolarizedFlag = src.fPolarizedFlag;
+   fPhotonEnergyMin = src.fPhotonEnergyMin;
    fQ2theta2 = src.fQ2theta2;
    fQ2weight = src.fQ2weight;
 }
@@ -471,6 +532,9 @@ CobremsGenerator &CobremsGenerator::operator=(const CobremsGenerator &src)
    fCollimatorSpotrms = src.fCollimatorSpotrms;
    fCollimatorDistance = src.fCollimatorDistance;
    fCollimatorDiameter = src.fCollimatorDiameter;
+   fCollimatedFlag = src.fCollimatedFlag;
+   fPolarizedFlag = src.fPolarizedFlag;
+   fPhotonEnergyMin = src.fPhotonEnergyMin;
    fQ2theta2 = src.fQ2theta2;
    fQ2weight = src.fQ2weight;
    return *this;
@@ -564,88 +628,97 @@ double CobremsGenerator::Rate_dNcdxdp(double x, double phi)
    // the total yield is returned, otherwise only the part that passes the
    // collimator is counted (default).
 
+   // The only part of the sum over reciprocal lattice vectors that
+   // depends on the orientation of the crystal is the longitudinal
+   // component qz of each vector. In a first pass, the kinematic limit
+   // xmax is computed for every plane in the table. Only those planes
+   // that can contribute at this x are visited in the second pass.
+
+   int nplanes = fTargetCrystal.planes.size();
+   if ((int)fPlaneQz.size() < nplanes) {
+      fPlaneQz.resize(nplanes);
+      fPlaneXmax.resize(nplanes);
+   }
+   computePlaneLimits(&fPlaneQz[0], &fPlaneXmax[0]);
+   return sumPlanes(x, phi, &fPlaneQz[0], &fPlaneXmax[0], true);
+}
+
+void CobremsGenerator::computePlaneLimits(double *qzs, double *xmax)
+{
+   // First pass of Rate_dNcdxdp, fills qzs and xmax with the longitudinal
+   // momentum transfer and the kinematic limit in x for each plane, at
+   // the present orientation of the crystal.
+
+   int nplanes = fTargetCrystal.planes.size();
+   const reciprocal_plane_t *planes = &fTargetCrystal.planes[0];
+   double a = fTargetCrystal.lattice_constant;
+   double qnorm = hbarc * 2 * dpi / a;
+   double Rz0 = qnorm * fTargetRmatrix[2][0];
+   double Rz1 = qnorm * fTargetRmatrix[2][1];
+   double Rz2 = qnorm * fTargetRmatrix[2][2];
+   double Ebeam2 = 2 * fBeamEnergy;
+   double me2 = me*me;
+   for (int n=0; n < nplanes; ++n) {
+      double qz = Rz0 * planes[n].h + Rz1 * planes[n].k + Rz2 * planes[n].l;
+      double xm = Ebeam2 * qz;
+      qzs[n] = qz;
+      xmax[n] = xm / (xm + me2);
+   }
+}
+
+double CobremsGenerator::sumPlanes(double x, double phi, const double *qzs,
+                                   const double *xmax, bool record)
+{
+   // Second pass of Rate_dNcdxdp, sums the contributions of the planes
+   // that are open at this x. Nothing in the object is changed unless
+   // record is true, when the statistical record is filled in.
+
    double Z = fTargetCrystal.Z;
    double a = fTargetCrystal.lattice_constant;
    double sigma0 = 16 * dpi * fTargetThickness * Z*Z * pow(alpha, 3) *
                    fBeamEnergy * hbarc/(a*a) * pow(hbarc / (a * me), 4);
 
-   fQ2theta2.clear();
-   fQ2weight.clear();
+   int nplanes = fTargetCrystal.planes.size();
+   const reciprocal_plane_t *planes = &fTargetCrystal.planes[0];
+   if (record) {
+      fQ2theta2.clear();
+      fQ2weight.clear();
+   }
    double qzmin = 99;
    int hmin, kmin, lmin;
    double sum = 0;
-   // can restrict to h=0 for cpu speedup, if crystal alignment is "reasonable"
-   for (int h = -4; h <= 4; ++h) {
-      for (int k = -10; k <= 10; ++k) {
-         for (int l = -10; l <= 10; ++l) {
-            if (h/2 * 2 == h) {
-               if (k/2 * 2 != k || l/2 * 2 != l ||
-                   (h + k + l)/4 * 4 != h + k + l)
-               {
-                  continue;
-               }
-            }
-            else if (k/2 * 2 == k || l/2 * 2 == l) {
-              continue;
-            }
-            double ReS = 0;
-            double ImS = 0;
-            for (int i=0; i < fTargetCrystal.nsites; ++i) {
-              double qdota = 2 * dpi * (h * fTargetCrystal.ucell_site[i].x +
-                                        k * fTargetCrystal.ucell_site[i].y +
-                                        l * fTargetCrystal.ucell_site[i].z);
-              ReS += cos(qdota);
-              ImS += sin(qdota);
-            }
-            double S2 = ReS*ReS + ImS*ImS;
-            if (S2 < 1e-4)
-               continue;
-            double qnorm = hbarc * 2 * dpi / a;
-            double q[3];
-            q[0] = qnorm * (fTargetRmatrix[0][0] * h +
-                            fTargetRmatrix[0][1] * k +
-                            fTargetRmatrix[0][2] * l);
-            q[1] = qnorm * (fTargetRmatrix[1][0] * h +
-                            fTargetRmatrix[1][1] * k +
-                            fTargetRmatrix[1][2] * l);
-            q[2] = qnorm * (fTargetRmatrix[2][0] * h +
-                            fTargetRmatrix[2][1] * k +
-                            fTargetRmatrix[2][2] * l);
-            double q2 = q[0]*q[0] + q[1]*q[1] + q[2]*q[2];
-            double qT2 = q[0]*q[0] + q[1]*q[1];
-            double xmax = 2 * fBeamEnergy * q[2];
-            xmax /= xmax + me*me;
-            if (x > xmax || xmax > 1) {
-               continue;
-            }
+   double xfactor = (1 - x) * sigma0;
+   double xspin = 1 + pow(1 - x, 2);
+   double xcos2phi = 8 * (1 - x) * pow(cos(phi), 2);
+   for (int n=0; n < nplanes; ++n) {
+      if (x > xmax[n] || xmax[n] > 1) {
+         continue;
+      }
+      double qz = qzs[n];
+      double q2 = planes[n].q2;
+      double qT2 = q2 - qz*qz;
 
 #if COBREMS_GENERATOR_VERBOSITY > 2
-            else {
-               std::cout << h << "," << k << "," << l << ","
-                         << S2 << "," << q2 << "," << xmax
-                         << std::endl;
-            }
+      std::cout << planes[n].h << "," << planes[n].k << "," << planes[n].l
+                << "," << q2 << "," << xmax[n]
+                << std::endl;
 #endif
 
-            if (q[2] < qzmin) {
-               qzmin = q[2];
-               hmin = h;
-               kmin = k;
-               lmin = l;
-            }
-            double theta2 = (1 - x) * xmax / (x * (1 - xmax) + 1e-99) - 1;
-            double betaFF2 = pow(fTargetCrystal.betaFF, 2);
-            double FF = 1 / (1 + q2 * betaFF2);
-            sum += sigma0 * qT2 * S2 * pow(FF * betaFF2, 2) *
-                   exp(-q2 * fTargetCrystal.Debye_Waller_const) *
-                   ((1 - x) / pow(x * (1 + theta2) + 1e-99, 2)) *
-                   ((1 + pow(1 - x, 2)) - 8 * (theta2 / pow(1 + theta2, 2) * 
-                                              (1 - x) * pow(cos(phi), 2))) *
-                   ((fCollimatedFlag)? Acceptance(theta2) : 1) *
-                   ((fPolarizedFlag)? Polarization(x, theta2) : 1);
-            fQ2theta2.push_back(theta2);
-            fQ2weight.push_back(sum);
-         }
+      if (qz < qzmin) {
+         qzmin = qz;
+         hmin = planes[n].h;
+         kmin = planes[n].k;
+         lmin = planes[n].l;
+      }
+      double theta2 = (1 - x) * xmax[n] / (x * (1 - xmax[n]) + 1e-99) - 1;
+      sum += xfactor * qT2 * planes[n].weight *
+             (1 / pow(x * (1 + theta2) + 1e-99, 2)) *
+             (xspin - xcos2phi * theta2 / pow(1 + theta2, 2)) *
+             ((fCollimatedFlag)? Acceptance(theta2) : 1) *
+             ((fPolarizedFlag)? Polarization(x, theta2) : 1);
+      if (record) {
+         fQ2theta2.push_back(theta2);
+         fQ2weight.push_back(sum);
       }
    }
 
@@ -874,6 +947,151 @@ double CobremsGenerator::Acceptance(double theta2)
    }
    return acceptance;
 }
+
+void CobremsGenerator::Rate_dNtdx(int n, const double *x, double *rate,
+                                  int nthreads)
+{
+   // Batch version of Rate_dNtdx(x), see runBatch.
+
+   batch_t batch;
+   batch.kind = kBatch_dNtdx;
+   batch.u = x;
+   batch.v = 0;
+   batch.result = rate;
+   runBatch(batch, n, nthreads);
+}
+
+void CobremsGenerator::Rate_dNcdx(int n, const double *x, double *rate,
+                                  int nthreads)
+{
+   // Batch version of Rate_dNcdx(x), see runBatch.
+
+   batch_t batch;
+   batch.kind = kBatch_dNcdx;
+   batch.u = x;
+   batch.v = 0;
+   batch.result = rate;
+   runBatch(batch, n, nthreads);
+}
+
+void CobremsGenerator::Rate_dNidx(int n, const double *x, double *rate,
+                                  int nthreads)
+{
+   // Batch version of Rate_dNidx(x), see runBatch.
+
+   batch_t batch;
+   batch.kind = kBatch_dNidx;
+   batch.u = x;
+   batch.v = 0;
+   batch.result = rate;
+   runBatch(batch, n, nthreads);
+}
+
+void CobremsGenerator::Rate_dNcdxdp(int n, const double *x, const double *phi,
+                                    double *rate, int nthreads)
+{
+   // Batch version of Rate_dNcdxdp(x, phi), see runBatch.
+
+   batch_t batch;
+   batch.kind = kBatch_dNcdxdp;
+   batch.u = x;
+   batch.v = phi;
+   batch.result = rate;
+   runBatch(batch, n, nthreads);
+}
+
+void CobremsGenerator::Polarization(int n, const double *x,
+                                    const double *theta2, double *pol,
+                                    int nthreads)
+{
+   // Batch version of Polarization(x, theta2), see runBatch.
+
+   batch_t batch;
+   batch.kind = kBatchPolarization;
+   batch.u = x;
+   batch.v = theta2;
+   batch.result = pol;
+   runBatch(batch, n, nthreads);
+}
+
+void CobremsGenerator::Acceptance(int n, const double *theta2, double *acc,
+                                  int nthreads)
+{
+   // Batch version of Acceptance(theta2), see runBatch.
+
+   batch_t batch;
+   batch.kind = kBatchAcceptance;
+   batch.u = theta2;
+   batch.v = 0;
+   batch.result = acc;
+   runBatch(batch, n, nthreads);
+}
+
+void CobremsGenerator::runBatch(batch_t &batch, int n, int nthreads)
+{
+   // Evaluates a batch of n points, dividing them into contiguous blocks
+   // for nthreads threads. The plane limits in x depend only on the
+   // orientation of the crystal and the beam energy, so they are computed
+   // once here for the whole batch and shared by the threads, which only
+   // read the object from then on.
+
+   if (batch.kind == kBatch_dNtdx || batch.kind == kBatch_dNcdx ||
+       batch.kind == kBatch_dNcdxdp)
+   {
+      int nplanes = fTargetCrystal.planes.size();
+      batch.qzs.resize(nplanes);
+      batch.xmax.resize(nplanes);
+      if (nplanes > 0)
+         computePlaneLimits(&batch.qzs[0], &batch.xmax[0]);
+   }
+   if (nthreads > n)
+      nthreads = n;
+   if (nthreads <= 1) {
+      batchWorker(&batch, 0, n);
+      return;
+   }
+   std::vector<std::thread> workers;
+   for (int t=0; t < nthreads; ++t) {
+      int first = (long int)n * t / nthreads;
+      int last = (long int)n * (t + 1) / nthreads;
+      workers.push_back(std::thread(&CobremsGenerator::batchWorker, this,
+                                    &batch, first, last));
+   }
+   for (int t=0; t < nthreads; ++t)
+      workers[t].join();
+}
+
+void CobremsGenerator::batchWorker(const batch_t *batch, int first, int last)
+{
+   // Evaluates points [first,last) of a batch, see runBatch.
+
+   const double *qzs = (batch->qzs.size() > 0)? &batch->qzs[0] : 0;
+   const double *xmax = (batch->xmax.size() > 0)? &batch->xmax[0] : 0;
+   for (int i=first; i < last; ++i) {
+      double u = batch->u[i];
+      switch (batch->kind) {
+       case kBatch_dNtdx:
+         batch->result[i] = 2 * dpi * sumPlanes(u, dpi/4, qzs, xmax, false)
+                            + Rate_dNidx(u);
+         break;
+       case kBatch_dNcdx:
+         batch->result[i] = 2 * dpi * sumPlanes(u, dpi/4, qzs, xmax, false);
+         break;
+       case kBatch_dNidx:
+         batch->result[i] = Rate_dNidx(u);
+         break;
+       case kBatch_dNcdxdp:
+         batch->result[i] = sumPlanes(u, batch->v[i], qzs, xmax, false);
+         break;
+       case kBatchPolarization:
+         batch->result[i] = Polarization(u, batch->v[i]);
+         break;
+       case kBatchAcceptance:
+         batch->result[i] = Acceptance(u);
+         break;
+      }
+   }
+}
    
 void CobremsGenerator::RotateTarget(double thetax, 
                                     double thetay,
@@ -1042,11 +1260,151 @@ void CobremsGenerator::pyApplyBeamCrystalConvolution(int nbins, pyobject xarr,
    applyBeamCrystalConvolution(nbins, xbuf, ybuf);
 }
 
+// The array versions take anything that numpy can turn into an array of
+// doubles, and return a new numpy array with the results. The python
+// interpreter is released while they run.
+
+static CobremsGenerator::pyobject pyarray_in(CobremsGenerator::pyobject arr,
+                                             const double **data)
+{
+   using boost::python::extract;
+   boost::python::object numpy = boost::python::import("numpy");
+   boost::python::object carr = numpy.attr("ascontiguousarray")(arr,
+                                                                "float64");
+   boost::python::object iface = carr.attr("__array_interface__");
+   boost::python::tuple pointer = extract<boost::python::tuple>(iface["data"]);
+   *data = reinterpret_cast<const double*>((size_t)extract<size_t>(pointer[0]));
+   return carr;
+}
+
+static CobremsGenerator::pyobject pyarray_out(int n, double **data)
+{
+   using boost::python::extract;
+   boost::python::object numpy = boost::python::import("numpy");
+   boost::python::object arr = numpy.attr("zeros")(n, "float64");
+   boost::python::object iface = arr.attr("__array_interface__");
+   boost::python::tuple pointer = extract<boost::python::tuple>(iface["data"]);
+   *data = reinterpret_cast<double*>((size_t)extract<size_t>(pointer[0]));
+   return arr;
+}
+
+static int pyarray_check(const CobremsGenerator::pyobject &a,
+                         const CobremsGenerator::pyobject &b)
+{
+   int n = boost::python::len(a);
+   if (boost::python::len(b) != n) {
+      PyErr_SetString(PyExc_ValueError,
+                      "CobremsGenerator: argument arrays differ in length");
+      boost::python::throw_error_already_set();
+   }
+   return n;
+}
+
+CobremsGenerator::pyobject CobremsGenerator::pyRate_dNtdx(pyobject xarr,
+                                                          int nthreads)
+{
+   const double *x;
+   double *rate;
+   pyobject xin = pyarray_in(xarr, &x);
+   int n = boost::python::len(xin);
+   pyobject out = pyarray_out(n, &rate);
+   PyThreadState *pystate = PyEval_SaveThread();
+   Rate_dNtdx(n, x, rate, nthreads);
+   PyEval_RestoreThread(pystate);
+   return out;
+}
+
+CobremsGenerator::pyobject CobremsGenerator::pyRate_dNcdx(pyobject xarr,
+                                                          int nthreads)
+{
+   const double *x;
+   double *rate;
+   pyobject xin = pyarray_in(xarr, &x);
+   int n = boost::python::len(xin);
+   pyobject out = pyarray_out(n, &rate);
+   PyThreadState *pystate = PyEval_SaveThread();
+   Rate_dNcdx(n, x, rate, nthreads);
+   PyEval_RestoreThread(pystate);
+   return out;
+}
+
+CobremsGenerator::pyobject CobremsGenerator::pyRate_dNidx(pyobject xarr,
+                                                          int nthreads)
+{
+   const double *x;
+   double *rate;
+   pyobject xin = pyarray_in(xarr, &x);
+   int n = boost::python::len(xin);
+   pyobject out = pyarray_out(n, &rate);
+   PyThreadState *pystate = PyEval_SaveThread();
+   Rate_dNidx(n, x, rate, nthreads);
+   PyEval_RestoreThread(pystate);
+   return out;
+}
+
+CobremsGenerator::pyobject CobremsGenerator::pyRate_dNcdxdp(pyobject xarr,
+                                                            pyobject phiarr,
+                                                            int nthreads)
+{
+   const double *x;
+   const double *phi;
+   double *rate;
+   pyobject xin = pyarray_in(xarr, &x);
+   pyobject phiin = pyarray_in(phiarr, &phi);
+   int n = pyarray_check(xin, phiin);
+   pyobject out = pyarray_out(n, &rate);
+   PyThreadState *pystate = PyEval_SaveThread();
+   Rate_dNcdxdp(n, x, phi, rate, nthreads);
+   PyEval_RestoreThread(pystate);
+   return out;
+}
+
+CobremsGenerator::pyobject CobremsGenerator::pyPolarization(pyobject xarr,
+                                                            pyobject theta2arr,
+                                                            int nthreads)
+{
+   const double *x;
+   const double *theta2;
+   double *pol;
+   pyobject xin = pyarray_in(xarr, &x);
+   pyobject theta2in = pyarray_in(theta2arr, &theta2);
+   int n = pyarray_check(xin, theta2in);
+   pyobject out = pyarray_out(n, &pol);
+   PyThreadState *pystate = PyEval_SaveThread();
+   Polarization(n, x, theta2, pol, nthreads);
+   PyEval_RestoreThread(pystate);
+   return out;
+}
+
+CobremsGenerator::pyobject CobremsGenerator::pyAcceptance(pyobject theta2arr,
+                                                          int nthreads)
+{
+   const double *theta2;
+   double *acc;
+   pyobject theta2in = pyarray_in(theta2arr, &theta2);
+   int n = boost::python::len(theta2in);
+   pyobject out = pyarray_out(n, &acc);
+   PyThreadState *pystate = PyEval_SaveThread();
+   Acceptance(n, theta2, acc, nthreads);
+   PyEval_RestoreThread(pystate);
+   return out;
+}
+
 double (CobremsGenerator::*Rate_dNtdx_1)(double) = &CobremsGenerator::Rate_dNtdx;
 double (CobremsGenerator::*Rate_dNtdx_3)(double, double, double) = &CobremsGenerator::Rate_dNtdx;
 double (CobremsGenerator::*Rate_dNcdx_1)(double) = &CobremsGenerator::Rate_dNcdx;
 double (CobremsGenerator::*Rate_dNcdx_3)(double, double, double) = &CobremsGenerator::Rate_dNcdx;
 double (CobremsGenerator::*Acceptance_1)(double) = &CobremsGenerator::Acceptance;
+double (CobremsGenerator::*Rate_dNidx_1)(double) = &CobremsGenerator::Rate_dNidx;
+double (CobremsGenerator::*Rate_dNcdxdp_2)(double, double) = &CobremsGenerator::Rate_dNcdxdp;
+double (CobremsGenerator::*Polarization_2)(double, double) = &CobremsGenerator::Polarization;
+
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(pyRate_dNtdx_overloads, pyRate_dNtdx, 1, 2)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(pyRate_dNcdx_overloads, pyRate_dNcdx, 1, 2)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(pyRate_dNidx_overloads, pyRate_dNidx, 1, 2)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(pyRate_dNcdxdp_overloads, pyRate_dNcdxdp, 2, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(pyPolarization_overloads, pyPolarization, 2, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(pyAcceptance_overloads, pyAcceptance, 1, 2)
 double (CobremsGenerator::*Acceptance_4)(double, double, double, double) = &CobremsGenerator::Acceptance;
 
 BOOST_PYTHON_MODULE(libcobrems)
@@ -1102,6 +1460,18 @@ BOOST_PYTHON_MODULE(libcobrems)
       .def("getPolarizedFlag", &CobremsGenerator::getPolarizedFlag)
       .def("setPolarizedFlag", &CobremsGenerator::setPolarizedFlag)
       .def("applyBeamCrystalConvolution", &CobremsGenerator::pyApplyBeamCrystalConvolution)
+      .def("Rate_dNtdx_array", &CobremsGenerator::pyRate_dNtdx,
+           pyRate_dNtdx_overloads())
+      .def("Rate_dNcdx_array", &CobremsGenerator::pyRate_dNcdx,
+           pyRate_dNcdx_overloads())
+      .def("Rate_dNidx_array", &CobremsGenerator::pyRate_dNidx,
+           pyRate_dNidx_overloads())
+      .def("Rate_dNcdxdp_array", &CobremsGenerator::pyRate_dNcdxdp,
+           pyRate_dNcdxdp_overloads())
+      .def("Polarization_array", &CobremsGenerator::pyPolarization,
+           pyPolarization_overloads())
+      .def("Acceptance_array", &CobremsGenerator::pyAcceptance,
+           pyAcceptance_overloads())
       .def("printBeamlineInfo", &CobremsGenerator::printBeamlineInfo)
       .def("printTargetCrystalInfo", &CobremsGenerator::printTargetCrystalInfo)
       .def("CoherentEnhancement", &CobremsGenerator::CoherentEnhancement)
@@ -1110,13 +1480,13 @@ BOOST_PYTHON_MODULE(libcobrems)
       .def("Rate_dNtdk", &CobremsGenerator::Rate_dNtdk)
       .def("Rate_dNcdx", Rate_dNcdx_1)
       .def("Rate_dNcdx", Rate_dNcdx_3)
-      .def("Rate_dNcdxdp", &CobremsGenerator::Rate_dNcdxdp)
-      .def("Rate_dNidx", &CobremsGenerator::Rate_dNidx)
+      .def("Rate_dNcdxdp", Rate_dNcdxdp_2)
+      .def("Rate_dNidx", Rate_dNidx_1)
       .def("Rate_dNBidx", &CobremsGenerator::Rate_dNBidx)
       .def("Rate_dNidxdt2", &CobremsGenerator::Rate_dNidxdt2)
       .def("Rate_para", &CobremsGenerator::Rate_para)
       .def("Rate_ortho", &CobremsGenerator::Rate_ortho)
-      .def("Polarization", &CobremsGenerator::Polarization)
+      .def("Polarization", Polarization_2)
       .def("Acceptance", Acceptance_1)
       .def("Acceptance", Acceptance_4)
       .def("Sigma2MS", &CobremsGenerator::Sigma2MS)
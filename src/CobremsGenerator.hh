@@ -132,6 +132,13 @@ class CobremsGenerator {
 #if BOOST_PYTHON_WRAPPING
    typedef boost::python::object pyobject;
    void pyApplyBeamCrystalConvolution(int nbins, pyobject xarr, pyobject yarr);
+   pyobject pyRate_dNtdx(pyobject xarr, int nthreads=1);
+   pyobject pyRate_dNcdx(pyobject xarr, int nthreads=1);
+   pyobject pyRate_dNidx(pyobject xarr, int nthreads=1);
+   pyobject pyRate_dNcdxdp(pyobject xarr, pyobject phiarr, int nthreads=1);
+   pyobject pyPolarization(pyobject xarr, pyobject theta2arr,
+                           int nthreads=1);
+   pyobject pyAcceptance(pyobject theta2arr, int nthreads=1);
 #endif
    void printBeamlineInfo();
    void printTargetCrystalInfo();
@@ -152,11 +159,29 @@ class CobremsGenerator {
                      double xshift_m, double yshift_m);
    double Acceptance(double theta2);
    double Sigma2MS(double thickness_m);
+
+   // Batch versions of the above over arrays of n points, for scans in x
+   // or angle at a fixed orientation of the crystal. The limits in x of
+   // the reciprocal lattice planes are computed once for the whole batch,
+   // and the points are divided between nthreads threads. The statistical
+   // record in fQ2theta2, fQ2weight is not filled by these.
+   void Rate_dNtdx(int n, const double *x, double *rate, int nthreads=1);
+   void Rate_dNcdx(int n, const double *x, double *rate, int nthreads=1);
+   void Rate_dNidx(int n, const double *x, double *rate, int nthreads=1);
+   void Rate_dNcdxdp(int n, const double *x, const double *phi,
+                     double *rate, int nthreads=1);
+   void Polarization(int n, const double *x, const double *theta2,
+                     double *pol, int nthreads=1);
+   void Acceptance(int n, const double *theta2, double *acc, int nthreads=1);
    double Sigma2MS_Kaune(double thickness_m);
    double Sigma2MS_PDG(double thickness_m);
    double Sigma2MS_Geant(double thickness_m);
    double Sigma2MS_Hanson(double thickness_m);
 
+   // version of the rate model, to be incremented whenever a change is
+   // made to this class that alters the rates that it computes
+   static const int model_version;
+
    // some math and physical constants
    static const double dpi;
    static const double me;
@@ -170,6 +195,32 @@ class CobremsGenerator {
  private:
    void resetTargetOrientation();
    void updateTargetOrientation();
+   void buildReciprocalLattice();
+
+   // the two passes over the reciprocal lattice made by Rate_dNcdxdp
+   void computePlaneLimits(double *qzs, double *xmax);
+   double sumPlanes(double x, double phi, const double *qzs,
+                    const double *xmax, bool record);
+
+   // a batch computation shared out between threads by runBatch
+   enum {
+      kBatch_dNtdx,
+      kBatch_dNcdx,
+      kBatch_dNidx,
+      kBatch_dNcdxdp,
+      kBatchPolarization,
+      kBatchAcceptance
+   };
+   struct batch_t {
+      int kind;
+      const double *u;                 // x, or theta2 for Acceptance
+      const double *v;                 // phi or theta2, if any
+      double *result;
+      std::vector<double> qzs;
+      std::vector<double> xmax;
+   };
+   void runBatch(batch_t &batch, int n, int nthreads);
+   void batchWorker(const batch_t *batch, int first, int last);
 
    // description of the radiator crystal lattice, here configured for diamond
    // but may be customized to describe any regular crystal
@@ -190,6 +241,16 @@ class CobremsGenerator {
          return *this;
       }
    };
+   // allowed reciprocal lattice vectors of the crystal, together with
+   // the parts of their contribution to the coherent rate that do not
+   // depend on the photon kinematics or the crystal orientation
+   struct reciprocal_plane_t {
+      double h;
+      double k;
+      double l;
+      double q2;                       // GeV^2
+      double weight;                   // S^2 FF^2 exp(-A q^2) / GeV^4
+   };
    struct crystal_parameters_t {
       std::string name;
       int nsites;
@@ -203,6 +264,7 @@ class CobremsGenerator {
       double betaFF;                   // 1/GeV^2
       std::vector<lattice_vector> ucell_site;
       lattice_vector primaryHKL;
+      std::vector<reciprocal_plane_t> planes;
    } fTargetCrystal;
    double fTargetThickness;
 
@@ -226,6 +288,10 @@ class CobremsGenerator {
 
    // parameters controlling Monte Carlo generation of photons
    double fPhotonEnergyMin;            // GeV
+
+   // scratch space for Rate_dNcdxdp, one entry per reciprocal plane
+   std::vector<double> fPlaneQz;
+   std::vector<double> fPlaneXmax;
 };
 
 inline void CobremsGenerator::setBeamEmittance(double emit_m_r) {
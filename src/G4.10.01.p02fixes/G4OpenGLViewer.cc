@@ -55,6 +55,9 @@
 #include "G4AttHolder.hh"
 #include "G4AttCheck.hh"
 #include "G4Text.hh"
+#ifdef CULL_DRAWING_OUTSIDE_VIEW
+#include "G4PhysicalVolumeViewCulling.hh"
+#endif
 
 #ifdef G4OPENGL_VERSION_2
 // We need to have a Wt gl drawer because we will draw inside the WtGL component (ImmediateWtViewer)
@@ -318,6 +321,16 @@ void G4OpenGLViewer::SetView () {
   if (!fSceneHandler.GetScene()) {
     return;
   }
+
+#ifdef CULL_DRAWING_OUTSIDE_VIEW
+  // A scene culled to the view it was last built for is visited again
+  // once the view moves outside of what it covers.
+  if (G4PhysicalVolumeViewCulling::NeedsRebuild
+      (&fSceneHandler, fVP, fWinSize_x, fWinSize_y)) {
+    NeedKernelVisit();
+  }
+#endif
+
   // Calculates view representation based on extent of object being
   // viewed and (initial) viewpoint.  (Note: it can change later due
   // to user interaction via visualization system's GUI.)
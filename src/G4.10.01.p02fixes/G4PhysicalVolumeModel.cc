@@ -52,6 +52,9 @@
 #include "G4AttValue.hh"
 #include "G4UnitsTable.hh"
 #include "G4Vector3D.hh"
+#ifdef CULL_DRAWING_OUTSIDE_VIEW
+#include "G4PhysicalVolumeViewCulling.hh"
+#endif
 
 #include <sstream>
 
@@ -171,12 +174,22 @@ void G4PhysicalVolumeModel::DescribeYourselfTo
 
   G4Transform3D startingTransformation = fTransform;
 
+#ifdef CULL_DRAWING_OUTSIDE_VIEW
+  // Exploded views move volumes after they are placed, so are not culled
+  G4PhysicalVolumeViewCulling::BeginScene
+    (sceneHandler, fpMP->IsCulling() && !fpMP->IsExplode());
+#endif
+
   VisitGeometryAndGetVisReps
     (fpTopPV,
      fRequestedDepth,
      startingTransformation,
      sceneHandler);
 
+#ifdef CULL_DRAWING_OUTSIDE_VIEW
+  G4PhysicalVolumeViewCulling::EndScene();
+#endif
+
   // Clear data...
   fCurrentDepth     = 0;
   fpCurrentPV       = 0;
@@ -574,6 +587,25 @@ void G4PhysicalVolumeModel::DescribeAndDescend
 
   thisToBeDrawn = thisToBeDrawn && (! thisToBeBypassed);
 
+#endif
+
+#ifdef CULL_DRAWING_OUTSIDE_VIEW
+
+  // Check if this volume is out of the view, or too small to be seen
+
+  bool thisToBeCulled = false;
+  G4bool daughtersToBeSeen = true;
+  G4int sidesToBeSeen = 0;
+  if (fCurrentDepth != 0) {
+    const G4VisExtent extent(pSol->GetExtent());
+    G4Point3D centre(extent.GetExtentCentre());
+    centre.transform(theNewAT);
+    thisToBeCulled = ! G4PhysicalVolumeViewCulling::Classify
+      (centre, extent.GetExtentRadius(), sidesToBeSeen, daughtersToBeSeen);
+  }
+
+  thisToBeDrawn = thisToBeDrawn && (! thisToBeCulled);
+
 #endif
 
   // Record thisToBeDrawn in path...
@@ -602,8 +634,28 @@ void G4PhysicalVolumeModel::DescribeAndDescend
       theNewAT = centering * newTranslation * oldRotation * oldScale;
     }
 
+#ifdef CULL_DRAWING_OUTSIDE_VIEW
+    // Small or distant volumes are drawn with fewer sides to curves...
+    G4int sides = fpMP->GetNoOfSides();
+    if (pVisAttribs->IsForceLineSegmentsPerCircle())
+      sides = pVisAttribs->GetForcedLineSegmentsPerCircle();
+    if (sidesToBeSeen > 0 && sidesToBeSeen < sides) {
+      if (!copyForVAM) {
+        pModifiedVisAtts = new G4VisAttributes(*pUnmodifiedVisAtts);
+        pVisAttribs = pModifiedVisAtts;
+        copyForVAM = true;
+      }
+      pModifiedVisAtts->SetForceLineSegmentsPerCircle(sidesToBeSeen);
+      G4PhysicalVolumeViewCulling::SetSimplifying(true);
+    }
+#endif
+
     DescribeSolid (theNewAT, pSol, pVisAttribs, sceneHandler);
 
+#ifdef CULL_DRAWING_OUTSIDE_VIEW
+    G4PhysicalVolumeViewCulling::SetSimplifying(false);
+#endif
+
   }
 
   // Make decision to draw daughters, if any.  There are various
@@ -624,6 +676,10 @@ void G4PhysicalVolumeModel::DescribeAndDescend
   else if (fAbort) daughtersToBeDrawn = false;
   // 4) The user has asked that the descent be curtailed...
   else if (fCurtailDescent) daughtersToBeDrawn = false;
+#ifdef CULL_DRAWING_OUTSIDE_VIEW
+  // 4a) The volume is out of view, or too small for its daughters to show...
+  else if (thisToBeCulled || !daughtersToBeSeen) daughtersToBeDrawn = false;
+#endif
 
   // Now, reasons that depend on culling policy...
   else {
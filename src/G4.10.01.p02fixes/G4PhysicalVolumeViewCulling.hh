@@ -0,0 +1,98 @@
+//
+// G4PhysicalVolumeViewCulling - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Extension to the patched G4PhysicalVolumeModel, which lets the OpenGL
+// stored viewers skip the parts of the geometry that are out of view or
+// too small on the screen to be seen, and draw the ones that are distant
+// or small with coarser polyhedra. It is built in with the compiler flag
+// CULL_DRAWING_OUTSIDE_VIEW, and follows the global culling switch of
+// /vis/viewer/set/culling at run time.
+//
+// Whenever the stored scene handler visits the geometry, the view that it
+// is built for is saved, and the field of view widened by a margin. The
+// volumes with bounding spheres outside of the widened field, or behind
+// the camera, are passed over together with their daughters, as are those
+// that would cover less than a pixel on the screen, and the daughters of
+// volumes covering only a few pixels are not visited. Curved surfaces are
+// drawn with a number of sides that goes with their size on the screen,
+// from the number in the view parameters down to a minimum of 6.
+//
+// The display lists in the store are kept as long as the view stays inside
+// of what it was built for, so that redrawing a view does not visit the
+// geometry again, and rotations by less than the margin allows or small
+// moves of the camera only replay the lists. The viewer asks for a new
+// visit of the geometry once it is panned, turned or zoomed out past the
+// margin, or zoomed in far enough for the coarse polyhedra to show.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. It is only
+// used by the visualization, which draws the geometry on the master.
+
+#ifndef G4PhysicalVolumeViewCulling_h
+#define G4PhysicalVolumeViewCulling_h 1
+
+#include "G4Point3D.hh"
+#include "G4Vector3D.hh"
+
+#include <map>
+
+class G4VGraphicsScene;
+class G4VSceneHandler;
+class G4ViewParameters;
+class G4Scene;
+
+class G4PhysicalVolumeViewCulling
+{
+ public:
+  // Save the view of the current viewer of the scene handler at the start
+  // of a visit to the geometry, and return true if it is to be culled.
+  static G4bool BeginScene(G4VGraphicsScene& sceneHandler, G4bool culling);
+  static void EndScene();
+
+  // Decide whether the volume with the given bounding sphere, in world
+  // coordinates, is drawn, and if so, with how many sides to its curved
+  // surfaces and whether its daughters are visited.
+  static G4bool Classify(const G4Point3D& centre, G4double radius,
+                         G4int& sides, G4bool& descend);
+
+  // Coarse polyhedra are not reused for other placements of a solid.
+  static G4bool IsSimplifying() { return fSimplifying; }
+  static void SetSimplifying(G4bool simple) { fSimplifying = simple; }
+
+  // Called by the viewer as it sets up a view, to check whether the scene
+  // in the store of its scene handler still covers it.
+  static G4bool NeedsRebuild(const G4VSceneHandler* sceneHandler,
+                             const G4ViewParameters& vp,
+                             G4int winX, G4int winY);
+
+ private:
+  G4PhysicalVolumeViewCulling() {}
+
+  struct view_t {
+    G4Point3D target;
+    G4Point3D camera;
+    G4Vector3D direction;   // unit vector from target to camera
+    G4bool perspective;
+    G4double nearDistance;
+    G4double halfHeight;    // of the shorter side of the near plane
+    G4double tanHalf;       // halfHeight over nearDistance, perspective
+    G4double corner;        // ratio of the corner to the half height
+    G4double visible;       // radius of the field at the target
+    G4double resolution;    // size of a pixel at the target
+    G4double depth;         // of the scene, seen from the target
+    G4int pixels;           // along the shorter side of the window
+    G4int sides;
+  };
+  static G4bool MakeView(view_t& view, const G4Scene* scene,
+                         const G4ViewParameters& vp, G4int winX, G4int winY);
+
+  static std::map<const G4VSceneHandler*, view_t> fBuilt;
+  static std::map<const G4VSceneHandler*, std::pair<G4int,G4int> > fWindow;
+  static const view_t* fCurrent;
+  static G4bool fSimplifying;
+};
+
+#endif
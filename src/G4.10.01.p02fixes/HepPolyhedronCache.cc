@@ -0,0 +1,236 @@
+//
+// HepPolyhedronCache - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#ifdef CACHE_BOOLEAN_POLYHEDRA
+
+#include "HepPolyhedronCache.hh"
+
+#include "G4AutoLock.hh"
+#include "G4ios.hh"
+
+#include <fstream>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+std::map<HepPolyhedronCache::key_t, HepPolyhedronCache::entry_t>
+HepPolyhedronCache::fEntries;
+std::deque<HepPolyhedronCache::key_t> HepPolyhedronCache::fOrder;
+std::string HepPolyhedronCache::fPath;
+G4bool HepPolyhedronCache::fLoaded = false;
+G4Mutex HepPolyhedronCache::fMutex = G4MUTEX_INITIALIZER;
+
+static const char kFileHeader[16] = "HepPolyhedron 1";
+
+static inline HepPolyhedronCache::key_t fnv1a(HepPolyhedronCache::key_t key,
+                                              const void *data, size_t len)
+{
+  const unsigned char *bytes = (const unsigned char*)data;
+  for (size_t i=0; i < len; ++i) {
+    key ^= bytes[i];
+    key *= 1099511628211ULL;
+  }
+  return key;
+}
+
+HepPolyhedronCache::key_t HepPolyhedronCache::Key
+(const HepPolyhedron& poly, G4int op, key_t key)
+{
+  if (key == 0)
+    key = 14695981039346656037ULL;
+  G4int counts[3] = {op, poly.GetNoVertices(), poly.GetNoFacets()};
+  key = fnv1a(key, counts, sizeof(counts));
+  for (G4int i=1; i <= counts[1]; ++i) {
+    G4Point3D v = poly.GetVertex(i);
+    G4double xyz[3] = {v.x(), v.y(), v.z()};
+    key = fnv1a(key, xyz, sizeof(xyz));
+  }
+  for (G4int i=1; i <= counts[2]; ++i) {
+    G4int n, nodes[4], flags[4];
+    poly.GetFacet(i, n, nodes, flags);
+    G4int face[4] = {0, 0, 0, 0};
+    for (G4int k=0; k < n; ++k)
+      face[k] = (flags[k] > 0)? nodes[k] : -nodes[k];
+    key = fnv1a(key, face, sizeof(face));
+  }
+  return key;
+}
+
+void HepPolyhedronCache::Pack(const HepPolyhedron& poly, entry_t& entry)
+{
+  G4int nnodes = poly.GetNoVertices();
+  G4int nfaces = poly.GetNoFacets();
+  entry.nodes.resize(3 * nnodes);
+  entry.faces.assign(4 * nfaces, 0);
+  for (G4int i=0; i < nnodes; ++i) {
+    G4Point3D v = poly.GetVertex(i + 1);
+    entry.nodes[3 * i] = v.x();
+    entry.nodes[3 * i + 1] = v.y();
+    entry.nodes[3 * i + 2] = v.z();
+  }
+  for (G4int i=0; i < nfaces; ++i) {
+    G4int n, nodes[4], flags[4];
+    poly.GetFacet(i + 1, n, nodes, flags);
+    for (G4int k=0; k < n; ++k)
+      entry.faces[4 * i + k] = (flags[k] > 0)? nodes[k] : -nodes[k];
+  }
+}
+
+void HepPolyhedronCache::Unpack(const entry_t& entry, HepPolyhedron& poly)
+{
+  // The neighbours of each facet are worked out again by createPolyhedron,
+  // while the signs of the vertex indices keep the visibility of the edges.
+
+  G4int nnodes = entry.nodes.size() / 3;
+  G4int nfaces = entry.faces.size() / 4;
+  if (nnodes == 0 || nfaces == 0) {
+    poly = HepPolyhedron();
+    return;
+  }
+  poly.createPolyhedron(nnodes, nfaces,
+                        (const G4double (*)[3])&entry.nodes[0],
+                        (const G4int (*)[4])&entry.faces[0]);
+}
+
+void HepPolyhedronCache::Insert(key_t key, const entry_t& entry)
+{
+  if (fEntries.find(key) == fEntries.end()) {
+    fOrder.push_back(key);
+    while (fOrder.size() > kMaxEntries) {
+      fEntries.erase(fOrder.front());
+      fOrder.pop_front();
+    }
+  }
+  fEntries[key] = entry;
+}
+
+G4bool HepPolyhedronCache::Lookup(key_t key, HepPolyhedron& result,
+                                  G4bool& ok)
+{
+  G4AutoLock barrier(&fMutex);
+  if (!fLoaded)
+    Load();
+  std::map<key_t, entry_t>::iterator iter = fEntries.find(key);
+  if (iter == fEntries.end())
+    return false;
+  ok = iter->second.ok;
+  if (ok)
+    Unpack(iter->second, result);
+  return true;
+}
+
+void HepPolyhedronCache::Store(key_t key, const HepPolyhedron& result,
+                               G4bool ok)
+{
+  entry_t entry;
+  entry.ok = ok;
+  if (ok)
+    Pack(result, entry);
+  G4AutoLock barrier(&fMutex);
+  Insert(key, entry);
+  Append(key, entry);
+}
+
+void HepPolyhedronCache::SetFile(const std::string& path)
+{
+  G4AutoLock barrier(&fMutex);
+  fPath = path;
+  fLoaded = false;
+}
+
+void HepPolyhedronCache::Load()
+{
+  // Reading stops at the first record that is cut short, such as the
+  // last one written by a job that was killed part way through it.
+
+  fLoaded = true;
+  if (fPath.size() == 0)
+    return;
+  std::ifstream file(fPath.c_str(), std::ios::binary);
+  char header[sizeof(kFileHeader)];
+  if (!file.read(header, sizeof(header)))
+    return;
+  if (memcmp(header, kFileHeader, sizeof(header)) != 0) {
+    G4cerr << "HepPolyhedronCache::Load warning - "
+           << fPath << " is not a polyhedron cache file, "
+           << "continuing without it." << G4endl;
+    fPath = "";
+    return;
+  }
+  int loaded = 0;
+  while (file) {
+    key_t key;
+    G4int counts[3];
+    if (!file.read((char*)&key, sizeof(key)) ||
+        !file.read((char*)counts, sizeof(counts)) ||
+        counts[1] < 0 || counts[2] < 0)
+    {
+      break;
+    }
+    entry_t entry;
+    entry.ok = counts[0];
+    entry.nodes.resize(3 * counts[1]);
+    entry.faces.resize(4 * counts[2]);
+    if (counts[1] > 0 &&
+        !file.read((char*)&entry.nodes[0],
+                   entry.nodes.size() * sizeof(G4double)))
+    {
+      break;
+    }
+    if (counts[2] > 0 &&
+        !file.read((char*)&entry.faces[0],
+                   entry.faces.size() * sizeof(G4int)))
+    {
+      break;
+    }
+    Insert(key, entry);
+    ++loaded;
+  }
+  G4cout << "HepPolyhedronCache: " << loaded << " boolean polyhedra "
+         << "read from " << fPath << G4endl;
+}
+
+void HepPolyhedronCache::Append(key_t key, const entry_t& entry)
+{
+  // Each record goes out in a single write to a file opened for append,
+  // so that jobs sharing the cache directory do not mix up their records.
+
+  if (fPath.size() == 0)
+    return;
+  std::string record;
+  int fd = open(fPath.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_EXCL, 0664);
+  if (fd >= 0)
+    record.append(kFileHeader, sizeof(kFileHeader));
+  else if (errno == EEXIST)
+    fd = open(fPath.c_str(), O_WRONLY | O_APPEND);
+  if (fd < 0) {
+    G4cerr << "HepPolyhedronCache::Append warning - "
+           << "unable to open " << fPath << " for writing, "
+           << "continuing without it." << G4endl;
+    fPath = "";
+    return;
+  }
+  G4int counts[3] = {entry.ok, (G4int)entry.nodes.size() / 3,
+                               (G4int)entry.faces.size() / 4};
+  record.append((const char*)&key, sizeof(key));
+  record.append((const char*)counts, sizeof(counts));
+  if (entry.nodes.size() > 0)
+    record.append((const char*)&entry.nodes[0],
+                  entry.nodes.size() * sizeof(G4double));
+  if (entry.faces.size() > 0)
+    record.append((const char*)&entry.faces[0],
+                  entry.faces.size() * sizeof(G4int));
+  if (write(fd, record.data(), record.size()) != (ssize_t)record.size()) {
+    G4cerr << "HepPolyhedronCache::Append warning - "
+           << "error writing to " << fPath << ", "
+           << "continuing without it." << G4endl;
+    fPath = "";
+  }
+  close(fd);
+}
+
+#endif
@@ -48,6 +48,9 @@
 #include "G4OpenGLTransform3D.hh"
 #include "G4OpenGLViewer.hh"
 #include "G4AttHolder.hh"
+#ifdef CULL_DRAWING_OUTSIDE_VIEW
+#include "G4PhysicalVolumeViewCulling.hh"
+#endif
 
 #include <typeinfo>
 
@@ -298,6 +301,11 @@ G4bool G4OpenGLStoredSceneHandler::AddPrimitivePreambleInternal(const G4Visible&
     if (!pLV)
       // Dummy model again?
       goto end_of_display_list_reuse_test;
+#ifdef CULL_DRAWING_OUTSIDE_VIEW
+    if (G4PhysicalVolumeViewCulling::IsSimplifying())
+      // coarse polyhedra must not stand in for the solid where it is near
+      goto end_of_display_list_reuse_test;
+#endif
     pSolid = pLV->GetSolid();
     EAxis axis = kRho;
     G4VPhysicalVolume* pCurrentPV = pPVModel->GetCurrentPV();
@@ -0,0 +1,195 @@
+//
+// G4PhysicalVolumeViewCulling - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#ifdef CULL_DRAWING_OUTSIDE_VIEW
+
+#include "G4PhysicalVolumeViewCulling.hh"
+
+#include "G4VGraphicsScene.hh"
+#include "G4VSceneHandler.hh"
+#include "G4VGraphicsSystem.hh"
+#include "G4VViewer.hh"
+#include "G4ViewParameters.hh"
+#include "G4Scene.hh"
+#include "G4VisExtent.hh"
+#include "G4PhysicalConstants.hh"
+
+#include <math.h>
+
+namespace {
+  const G4double kMargin = 1.5;        // widening of the field of view
+  const G4double kZoomLOD = 2.0;       // zoom in before choosing new sides
+  const G4double kMinPixels = 1.0;     // smallest volume drawn
+  const G4double kDescendPixels = 4.0; // smallest volume with daughters
+  const G4double kSegmentPixels = 4.0; // length of the sides of curves
+  const G4int kMinSides = 6;
+}
+
+std::map<const G4VSceneHandler*, G4PhysicalVolumeViewCulling::view_t>
+G4PhysicalVolumeViewCulling::fBuilt;
+std::map<const G4VSceneHandler*, std::pair<G4int,G4int> >
+G4PhysicalVolumeViewCulling::fWindow;
+const G4PhysicalVolumeViewCulling::view_t*
+G4PhysicalVolumeViewCulling::fCurrent = 0;
+G4bool G4PhysicalVolumeViewCulling::fSimplifying = false;
+
+G4bool G4PhysicalVolumeViewCulling::MakeView
+(view_t& view, const G4Scene* scene,
+ const G4ViewParameters& vp, G4int winX, G4int winY)
+{
+  // The view is laid out the same way as G4OpenGLViewer::SetView does it,
+  // except for stretched views, which are not culled.
+
+  const G4Vector3D scaleFactor = vp.GetScaleFactor();
+  if (scaleFactor.x() != 1 || scaleFactor.y() != 1 || scaleFactor.z() != 1)
+    return false;
+  if (winX <= 0 || winY <= 0)
+    return false;
+  G4double radius = scene->GetExtent().GetExtentRadius();
+  if (radius <= 0.) radius = 1.;
+  view.target = scene->GetStandardTargetPoint() + vp.GetCurrentTargetPoint();
+  view.direction = vp.GetViewpointDirection().unit();
+  const G4double cameraDistance = vp.GetCameraDistance(radius);
+  view.camera = view.target + cameraDistance * view.direction;
+  view.nearDistance = vp.GetNearDistance(cameraDistance, radius);
+  view.halfHeight = vp.GetFrontHalfHeight(view.nearDistance, radius);
+  view.perspective = (vp.GetFieldHalfAngle() != 0.);
+  view.tanHalf = view.halfHeight / view.nearDistance;
+  G4double aspect = (winX > winY)? (G4double)winX / winY :
+                                   (G4double)winY / winX;
+  view.corner = sqrt(1 + aspect * aspect);
+  view.pixels = (winX < winY)? winX : winY;
+  G4double halfHeight = (view.perspective)?
+                        cameraDistance * view.tanHalf : view.halfHeight;
+  view.visible = halfHeight * view.corner;
+  view.resolution = 2 * halfHeight / view.pixels;
+  view.depth = radius + (view.target - scene->GetExtent().GetExtentCentre())
+                        .mag();
+  view.sides = vp.GetNoOfSides();
+  return true;
+}
+
+G4bool G4PhysicalVolumeViewCulling::BeginScene
+(G4VGraphicsScene& sceneHandler, G4bool culling)
+{
+  // Only the OpenGL stored viewers rebuild their scenes when the view
+  // moves, the others get the full geometry, as do the scenes made up
+  // to find the extent of a model.
+
+  fCurrent = 0;
+  fSimplifying = false;
+  G4VSceneHandler* pSceneHandler =
+    dynamic_cast<G4VSceneHandler*>(&sceneHandler);
+  if (!pSceneHandler)
+    return false;
+  const G4VGraphicsSystem* pSystem = pSceneHandler->GetGraphicsSystem();
+  const G4VViewer* pViewer = pSceneHandler->GetCurrentViewer();
+  const G4Scene* pScene = pSceneHandler->GetScene();
+  if (!culling || !pSystem || !pViewer || !pScene ||
+      pSystem->GetName().find("OpenGLStored") != 0)
+  {
+    fBuilt.erase(pSceneHandler);
+    return false;
+  }
+  const G4ViewParameters& vp = pViewer->GetViewParameters();
+  G4int winX = vp.GetWindowSizeHintX();
+  G4int winY = vp.GetWindowSizeHintY();
+  std::map<const G4VSceneHandler*, std::pair<G4int,G4int> >::iterator win;
+  win = fWindow.find(pSceneHandler);
+  if (win != fWindow.end()) {
+    winX = win->second.first;
+    winY = win->second.second;
+  }
+  view_t view;
+  if (!MakeView(view, pScene, vp, winX, winY)) {
+    fBuilt.erase(pSceneHandler);
+    return false;
+  }
+  fBuilt[pSceneHandler] = view;
+  fCurrent = &fBuilt[pSceneHandler];
+  return true;
+}
+
+void G4PhysicalVolumeViewCulling::EndScene()
+{
+  fCurrent = 0;
+  fSimplifying = false;
+}
+
+G4bool G4PhysicalVolumeViewCulling::Classify
+(const G4Point3D& centre, G4double radius, G4int& sides, G4bool& descend)
+{
+  descend = true;
+  if (!fCurrent)
+    return true;
+  const view_t& view = *fCurrent;
+
+  // The sphere is tested against the cone of the field of view, or the
+  // cylinder for orthographic views, through the corners of the window.
+
+  G4Vector3D offset = view.camera - centre;
+  G4double along = offset.dot(view.direction);
+  G4double across = (offset - along * view.direction).mag();
+  G4double pixel;
+  if (view.perspective) {
+    if (along < -radius)
+      return false;
+    G4double tanField = view.tanHalf * view.corner * kMargin;
+    G4double cosField = 1 / sqrt(1 + tanField * tanField);
+    if ((across - along * tanField) * cosField > radius)
+      return false;
+    G4double nearest = along - radius;
+    if (nearest < view.nearDistance)
+      nearest = view.nearDistance;
+    pixel = 2 * nearest * view.tanHalf / view.pixels;
+  }
+  else {
+    if (across > view.visible * kMargin + radius)
+      return false;
+    pixel = view.resolution;
+  }
+
+  G4double size = 2 * radius / pixel;
+  if (size < kMinPixels)
+    return false;
+  descend = (size >= kDescendPixels);
+  G4int lod = (G4int)(pi * size / kSegmentPixels);
+  sides = view.sides;
+  if (lod < sides)
+    sides = (lod > kMinSides)? lod : kMinSides;
+  return true;
+}
+
+G4bool G4PhysicalVolumeViewCulling::NeedsRebuild
+(const G4VSceneHandler* sceneHandler,
+ const G4ViewParameters& vp, G4int winX, G4int winY)
+{
+  fWindow[sceneHandler] = std::make_pair(winX, winY);
+  std::map<const G4VSceneHandler*, view_t>::iterator iter;
+  iter = fBuilt.find(sceneHandler);
+  if (iter == fBuilt.end() || !sceneHandler->GetScene())
+    return false;
+  const view_t& built = iter->second;
+  view_t view;
+  if (!MakeView(view, sceneHandler->GetScene(), vp, winX, winY))
+    return true;
+  if (view.perspective != built.perspective || view.sides != built.sides)
+    return true;
+
+  // Turning the view moves the parts of the scene in front of and behind
+  // the target across the field by as much as its depth times the sine of
+  // the angle, which has to stay within the margin, with any panning.
+
+  G4double sine = view.direction.cross(built.direction).mag();
+  G4double shift = (view.target - built.target).mag();
+  if (view.perspective)
+    shift += (view.camera - built.camera).mag() * built.tanHalf;
+  if (view.visible + shift + built.depth * sine > built.visible * kMargin)
+    return true;
+  return (view.resolution * kZoomLOD < built.resolution);
+}
+
+#endif
@@ -0,0 +1,84 @@
+//
+// HepPolyhedronCache - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Cache of the results of the boolean operations on polyhedra done by
+// the patched HepPolyhedronProcessor, which makes up the polyhedra of
+// G4BooleanSolids and of the sections and cutaways of the visualization.
+// Some of the boolean solids in the GlueX geometry take seconds each to
+// process, and without the cache this is done over again every time the
+// scene is rebuilt. It is built in with the compiler flag
+// CACHE_BOOLEAN_POLYHEDRA.
+//
+// Entries are keyed by a hash of the contents of the polyhedra that go
+// into the operations, taken in order, together with the operations, so
+// that an entry is found again for as long as the solid and the number of
+// steps per circle in its tessellation stay the same, and never otherwise.
+// Operations that fail for every shift that the processor tries are kept
+// as well, so they are not tried over and over. The oldest entries are
+// dropped once the cache holds more than kMaxEntries.
+//
+// If a file is named for it, the cache is filled from there the first
+// time that it is used and new entries are appended to it, so that they
+// carry over to later jobs. hdgeant4 keeps this file next to the geometry
+// cache when the GEOMCACHE card is given.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. Its state is
+// guarded by a mutex, although only the visualization on the master
+// normally makes polyhedra.
+
+#ifndef HepPolyhedronCache_h
+#define HepPolyhedronCache_h 1
+
+#include "HepPolyhedron.h"
+#include "G4Threading.hh"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+class HepPolyhedronCache
+{
+ public:
+  typedef unsigned long long key_t;
+
+  // Fold the contents of a polyhedron, and the operation that it goes
+  // into, into the key of the result.
+  static key_t Key(const HepPolyhedron& poly, G4int op, key_t key = 0);
+
+  // Return true if the result for key is in the cache, with the
+  // outcome in ok and the polyhedron in result if it succeeded.
+  static G4bool Lookup(key_t key, HepPolyhedron& result, G4bool& ok);
+  static void Store(key_t key, const HepPolyhedron& result, G4bool ok);
+
+  // Name the file that the cache is kept in between jobs.
+  static void SetFile(const std::string& path);
+
+ private:
+  HepPolyhedronCache() {}
+
+  enum { kMaxEntries = 4096 };
+
+  struct entry_t {
+    G4bool ok;
+    std::vector<G4double> nodes;     // x, y, z of each vertex
+    std::vector<G4int> faces;        // 4 signed vertex indices per facet
+  };
+  static void Pack(const HepPolyhedron& poly, entry_t& entry);
+  static void Unpack(const entry_t& entry, HepPolyhedron& poly);
+  static void Insert(key_t key, const entry_t& entry);
+  static void Load();
+  static void Append(key_t key, const entry_t& entry);
+
+  static std::map<key_t, entry_t> fEntries;
+  static std::deque<key_t> fOrder;
+  static std::string fPath;
+  static G4bool fLoaded;
+  static G4Mutex fMutex;
+};
+
+#endif
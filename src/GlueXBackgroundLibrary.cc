@@ -0,0 +1,188 @@
+//
+// GlueXBackgroundLibrary - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXBackgroundLibrary.hh"
+
+#include "G4Track.hh"
+#include "G4StepPoint.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4ios.hh"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdio.h>
+#include <unistd.h>
+
+const int kLibraryVersion = 1;
+
+GlueXBackgroundLibrary *GlueXBackgroundLibrary::fRecorder = 0;
+G4Mutex GlueXBackgroundLibrary::fMutex = G4MUTEX_INITIALIZER;
+
+GlueXBackgroundLibrary::GlueXBackgroundLibrary(const std::string &filename)
+ : fFilename(filename),
+   fPlaneZ(0),
+   fTargetZ(0),
+   fGenerated(0),
+   fOpen(false),
+   fRecording(false)
+{
+   std::ifstream fin(filename.c_str(), std::ios::binary);
+   if (! fin.is_open()) {
+      G4cerr << "GlueXBackgroundLibrary error - "
+             << "unable to open background library file " << filename
+             << G4endl;
+      return;
+   }
+   std::string header;
+   std::getline(fin, header);
+   std::istringstream hin(header);
+   std::string tag;
+   int version = 0;
+   double zplane_cm = 0;
+   long int nphotons = 0;
+   if (! (hin >> tag >> version >> zplane_cm >> fGenerated >> nphotons) ||
+       tag != "GlueXBackgroundLibrary" || version != kLibraryVersion)
+   {
+      G4cerr << "GlueXBackgroundLibrary error - "
+             << "file " << filename << " is not a background library "
+             << "written by this version of the code." << G4endl;
+      return;
+   }
+   fPhotons.resize(nphotons);
+   if (nphotons > 0 &&
+       ! fin.read((char*)&fPhotons[0], nphotons * sizeof(photon_t)))
+   {
+      G4cerr << "GlueXBackgroundLibrary error - "
+             << "background library file " << filename
+             << " is truncated." << G4endl;
+      fPhotons.clear();
+      return;
+   }
+   fPlaneZ = zplane_cm * cm;
+   fOpen = (nphotons > 0);
+   G4cout << "GlueXBackgroundLibrary: " << nphotons << " beam photons "
+          << "at z = " << zplane_cm << " cm read from library " << filename
+          << ", yield " << GetYield() << " per beam photon" << G4endl;
+}
+
+GlueXBackgroundLibrary::GlueXBackgroundLibrary(const std::string &filename,
+                                               double zplane, double ztarget)
+ : fFilename(filename),
+   fPlaneZ(zplane),
+   fTargetZ(ztarget),
+   fGenerated(0),
+   fOpen(true),
+   fRecording(true)
+{
+   G4AutoLock barrier(&fMutex);
+   fRecorder = this;
+}
+
+GlueXBackgroundLibrary::~GlueXBackgroundLibrary()
+{
+   G4AutoLock barrier(&fMutex);
+   if (fRecorder == this)
+      fRecorder = 0;
+}
+
+GlueXBackgroundLibrary::GlueXBackgroundLibrary(GlueXBackgroundLibrary &src)
+{}
+
+GlueXBackgroundLibrary&
+GlueXBackgroundLibrary::operator=(GlueXBackgroundLibrary &src)
+{
+   return *this;
+}
+
+void GlueXBackgroundLibrary::Record(const G4Step *step)
+{
+   // Beam photons are started at t=0 in the bucket that crosses the
+   // target midplane at t=0, so the bucket time at the plane is just
+   // the light travel time from the target back to the plane. Each
+   // photon is stopped once it has been recorded, as a job making a
+   // library has no further use for it.
+
+   G4Track *track = step->GetTrack();
+   if (track->GetParentID() != 0 ||
+       track->GetDefinition()->GetPDGEncoding() != 22)
+   {
+      return;
+   }
+   G4StepPoint *pre = step->GetPreStepPoint();
+   G4StepPoint *post = step->GetPostStepPoint();
+   double z0 = pre->GetPosition().z();
+   double z1 = post->GetPosition().z();
+   if (z0 >= fPlaneZ || z1 < fPlaneZ)
+      return;
+
+   double f = (fPlaneZ - z0) / (z1 - z0);
+   G4ThreeVector pos = pre->GetPosition() +
+                       f * (post->GetPosition() - pre->GetPosition());
+   double t = pre->GetGlobalTime() +
+              f * (post->GetGlobalTime() - pre->GetGlobalTime());
+   G4ThreeVector mom = pre->GetMomentum();
+   G4ThreeVector pol = pre->GetPolarization();
+   photon_t photon;
+   photon.x = pos.x() / cm;
+   photon.y = pos.y() / cm;
+   photon.px = mom.x() / GeV;
+   photon.py = mom.y() / GeV;
+   photon.pz = mom.z() / GeV;
+   photon.polx = pol.x();
+   photon.poly = pol.y();
+   photon.polz = pol.z();
+   photon.dt = (t - (fPlaneZ - fTargetZ) / c_light) / ns;
+   track->SetTrackStatus(fStopAndKill);
+
+   G4AutoLock barrier(&fMutex);
+   fPhotons.push_back(photon);
+}
+
+bool GlueXBackgroundLibrary::Close(long int ngenerated)
+{
+   // Write the library file, replacing any old one only once the new
+   // one is complete, so that jobs reading the same library never see
+   // it partially written.
+
+   G4AutoLock barrier(&fMutex);
+   if (! fRecording)
+      return false;
+   fRecording = false;
+   fGenerated = ngenerated;
+   if (fRecorder == this)
+      fRecorder = 0;
+
+   std::stringstream tmpname;
+   tmpname << fFilename << ".tmp" << getpid();
+   std::string tmpfile = tmpname.str();
+   std::ofstream fout(tmpfile.c_str(), std::ios::binary);
+   if (! fout.is_open()) {
+      G4cerr << "GlueXBackgroundLibrary::Close warning - "
+             << "unable to write background library file " << tmpfile
+             << ", continuing without it." << G4endl;
+      return false;
+   }
+   fout << "GlueXBackgroundLibrary " << kLibraryVersion << " "
+        << std::setprecision(9) << fPlaneZ / cm << " "
+        << fGenerated << " " << fPhotons.size() << std::endl;
+   if (fPhotons.size() > 0)
+      fout.write((const char*)&fPhotons[0],
+                 fPhotons.size() * sizeof(photon_t));
+   fout.close();
+   if (rename(tmpfile.c_str(), fFilename.c_str()) != 0) {
+      G4cerr << "GlueXBackgroundLibrary::Close warning - "
+             << "unable to replace background library file " << fFilename
+             << ", continuing without it." << G4endl;
+      unlink(tmpfile.c_str());
+      return false;
+   }
+   G4cout << "GlueXBackgroundLibrary: " << fPhotons.size() << " of "
+          << fGenerated << " beam photons reached z = " << fPlaneZ / cm
+          << " cm, written to library " << fFilename << G4endl;
+   return true;
+}
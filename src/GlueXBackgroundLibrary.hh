@@ -0,0 +1,127 @@
+//
+// GlueXBackgroundLibrary - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Library of coherent bremsstrahlung beam photons that have already
+// been tracked from the radiator through the collimator system as far
+// as a fixed plane z = zplane downstream of it, typically the exit of
+// the collimator cave or the entrance to the target. A library is made
+// by a BEAM-source job with the BGRECORD card, which stops each primary
+// beam photon as it reaches the plane and records its position,
+// momentum, polarization and its arrival time relative to its beam
+// bucket. Photons that are absorbed before the plane are not recorded,
+// but they are counted, so that the library also knows the fraction of
+// beam photons that reach the plane. A job with the BGLIBRARY card then
+// superimposes beam background on its events by sampling photons from
+// the library and starting them at the plane, instead of generating
+// each one from the cobrems model and tracking it from the radiator.
+//
+// The library file is binary, with a one-line text header of the form
+//    GlueXBackgroundLibrary <version> <zplane[cm]> <ngenerated> <nphotons>
+// followed by nphotons records of type photon_t in native byte order.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. Once it is
+// loaded, a library is read-only, and recording is serialized with
+// a mutex.
+
+#ifndef GlueXBackgroundLibrary_h
+#define GlueXBackgroundLibrary_h 1
+
+#include "G4Threading.hh"
+#include "G4AutoLock.hh"
+#include "G4Step.hh"
+
+#include <string>
+#include <vector>
+
+class GlueXBackgroundLibrary
+{
+ public:
+   struct photon_t {
+      float x, y;              // position in the library plane (cm)
+      float px, py, pz;        // momentum (GeV/c)
+      float polx, poly, polz;  // polarization vector
+      float dt;                // arrival time - bucket time at plane (ns)
+   };
+
+   // Load an existing library for sampling.
+   GlueXBackgroundLibrary(const std::string &filename);
+   // Open a new library for recording at z = zplane, with bucket times
+   // at the plane referenced to the beam crossing the target at ztarget.
+   GlueXBackgroundLibrary(const std::string &filename,
+                          double zplane, double ztarget);
+   ~GlueXBackgroundLibrary();
+
+   bool is_open() const;
+   bool is_recording() const;
+
+   // the library being recorded in this process, if any
+   static GlueXBackgroundLibrary *GetRecorder();
+
+   // Record a primary beam photon if this step takes it across the plane.
+   void Record(const G4Step *step);
+   // Write out the library made from ngenerated beam photons.
+   bool Close(long int ngenerated);
+
+   double GetPlaneZ() const;
+   double GetYield() const;
+   int GetSize() const;
+   const photon_t &GetPhoton(int i) const;
+
+ protected:
+   GlueXBackgroundLibrary(GlueXBackgroundLibrary &src);
+   GlueXBackgroundLibrary& operator=(GlueXBackgroundLibrary &src);
+
+   std::string fFilename;
+   std::vector<photon_t> fPhotons;
+   double fPlaneZ;
+   double fTargetZ;
+   long int fGenerated;
+   bool fOpen;
+   bool fRecording;
+
+   static GlueXBackgroundLibrary *fRecorder;
+   static G4Mutex fMutex;
+};
+
+inline bool GlueXBackgroundLibrary::is_open() const
+{
+   return fOpen;
+}
+
+inline bool GlueXBackgroundLibrary::is_recording() const
+{
+   return fRecording;
+}
+
+inline GlueXBackgroundLibrary *GlueXBackgroundLibrary::GetRecorder()
+{
+   return fRecorder;
+}
+
+inline double GlueXBackgroundLibrary::GetPlaneZ() const
+{
+   return fPlaneZ;
+}
+
+inline double GlueXBackgroundLibrary::GetYield() const
+{
+   // fraction of beam photons that reach the library plane
+   return (fGenerated > 0)? fPhotons.size() / double(fGenerated) : 0;
+}
+
+inline int GlueXBackgroundLibrary::GetSize() const
+{
+   return fPhotons.size();
+}
+
+inline const GlueXBackgroundLibrary::photon_t &
+GlueXBackgroundLibrary::GetPhoton(int i) const
+{
+   return fPhotons[i];
+}
+
+#endif
@@ -0,0 +1,182 @@
+//
+// GlueXBeamPhotonPool - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXBeamPhotonPool.hh"
+
+#include "G4ios.hh"
+#include "Randomize.hh"
+#include "CLHEP/Random/RanecuEngine.h"
+
+#include <chrono>
+
+GlueXBeamPhotonPool::GlueXBeamPhotonPool(const CobremsGenerator &prototype,
+                                         int nproducers, int depth)
+ : fPrototype(prototype),
+   fHead(0),
+   fTail(0),
+   fStopping(false),
+   fNproduced(0),
+   fNpopped(0),
+   fNempty(0),
+   fNfull(0),
+   fFillSum(0)
+{
+   // The ring size is rounded up to a power of 2 so that positions
+   // can be mapped to slots with a mask. Each slot carries a sequence
+   // number that tells whether it is ready to be filled or emptied by
+   // the holder of a given position, following the bounded multiple
+   // producer, multiple consumer queue of D. Vyukov.
+
+   unsigned long size = 2;
+   while (size < (unsigned long)depth)
+      size *= 2;
+   fMask = size - 1;
+   fSlots = new slot_t[size];
+   for (unsigned long i=0; i < size; ++i)
+      fSlots[i].seq.store(i, std::memory_order_relaxed);
+
+   // The producer seeds are drawn from the engine of the calling thread,
+   // so that different jobs get different beam photons.
+
+   for (int i=0; i < nproducers; ++i) {
+      long seed = long(G4UniformRand() * 2147483646) + 1;
+      fProducers.push_back(std::thread(&GlueXBeamPhotonPool::ProducerLoop,
+                                       this, seed));
+   }
+   G4cout << "GlueXBeamPhotonPool: started " << nproducers
+          << " beam photon producer threads, pool depth " << size
+          << G4endl;
+}
+
+GlueXBeamPhotonPool::~GlueXBeamPhotonPool()
+{
+   fStopping = true;
+   for (unsigned int i=0; i < fProducers.size(); ++i)
+      fProducers[i].join();
+   PrintStatistics();
+   delete [] fSlots;
+}
+
+GlueXBeamPhotonPool::GlueXBeamPhotonPool(GlueXBeamPhotonPool &src)
+ : fPrototype(src.fPrototype)
+{}
+
+GlueXBeamPhotonPool& GlueXBeamPhotonPool::operator=(GlueXBeamPhotonPool &src)
+{
+   return *this;
+}
+
+bool GlueXBeamPhotonPool::Push(const beam_photon_t &photon)
+{
+   unsigned long pos = fTail.load(std::memory_order_relaxed);
+   while (true) {
+      slot_t &slot = fSlots[pos & fMask];
+      unsigned long seq = slot.seq.load(std::memory_order_acquire);
+      long diff = (long)seq - (long)pos;
+      if (diff == 0) {
+         if (fTail.compare_exchange_weak(pos, pos + 1,
+                                         std::memory_order_relaxed))
+         {
+            slot.photon = photon;
+            slot.seq.store(pos + 1, std::memory_order_release);
+            return true;
+         }
+      }
+      else if (diff < 0) {
+         return false;
+      }
+      else {
+         pos = fTail.load(std::memory_order_relaxed);
+      }
+   }
+}
+
+bool GlueXBeamPhotonPool::Pop(beam_photon_t &photon)
+{
+   long fill = fTail.load(std::memory_order_relaxed) -
+               fHead.load(std::memory_order_relaxed);
+   if (fill > 0)
+      fFillSum += fill;
+   unsigned long pos = fHead.load(std::memory_order_relaxed);
+   while (true) {
+      slot_t &slot = fSlots[pos & fMask];
+      unsigned long seq = slot.seq.load(std::memory_order_acquire);
+      long diff = (long)seq - (long)(pos + 1);
+      if (diff == 0) {
+         if (fHead.compare_exchange_weak(pos, pos + 1,
+                                         std::memory_order_relaxed))
+         {
+            photon = slot.photon;
+            slot.seq.store(pos + fMask + 1, std::memory_order_release);
+            ++fNpopped;
+            return true;
+         }
+      }
+      else if (diff < 0) {
+         ++fNempty;
+         return false;
+      }
+      else {
+         pos = fHead.load(std::memory_order_relaxed);
+      }
+   }
+}
+
+double GlueXBeamPhotonPool::GetFillLevel() const
+{
+   long fill = fTail.load(std::memory_order_relaxed) -
+               fHead.load(std::memory_order_relaxed);
+   return (fill > 0)? fill / double(fMask + 1) : 0;
+}
+
+void GlueXBeamPhotonPool::ProducerLoop(long seed)
+{
+   // Body of each producer thread, which generates photons and pushes
+   // them into the ring until the pool is destroyed, sleeping while the
+   // ring is full. A thread that is not started by Geant4 has no random
+   // engine of its own, so each producer makes one here from its seed.
+
+   CLHEP::RanecuEngine *engine = new CLHEP::RanecuEngine(seed);
+   G4Random::setTheEngine(engine);
+   CobremsGenerator cobrems(fPrototype);
+   GlueXPrimaryGeneratorAction::ImportanceSamplerStats coherentStats;
+   GlueXPrimaryGeneratorAction::ImportanceSamplerStats incoherentStats;
+
+   beam_photon_t photon;
+   bool ready = false;
+   bool waiting = false;
+   while (! fStopping) {
+      if (! ready) {
+         GlueXPrimaryGeneratorAction::GenerateBeamPhotonKinematics(&cobrems,
+                                      coherentStats, incoherentStats, photon);
+         ready = true;
+      }
+      if (Push(photon)) {
+         ++fNproduced;
+         ready = false;
+         waiting = false;
+      }
+      else {
+         if (! waiting)
+            ++fNfull;
+         waiting = true;
+         std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+   }
+   delete engine;
+}
+
+void GlueXBeamPhotonPool::PrintStatistics() const
+{
+   long ntaken = fNpopped + fNempty;
+   double meanfill = (ntaken > 0)? fFillSum / double(ntaken) : 0;
+   G4cout << "GlueXBeamPhotonPool: " << fNproduced << " beam photons "
+          << "produced, " << fNpopped << " taken from the pool, "
+          << fNempty << " generated by the workers because the pool "
+          << "was empty, producers waited " << fNfull << " times on a "
+          << "full pool, mean fill level " << 100 * meanfill / (fMask + 1)
+          << "%" << G4endl;
+}
@@ -0,0 +1,87 @@
+//
+// GlueXBeamPhotonPool - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Pool of coherent bremsstrahlung beam photons whose kinematics have
+// been generated ahead of time by a set of producer threads, so that
+// the worker threads only need to take a ready photon from the pool
+// when they start an event or superimpose beam background on one.
+// Each producer has its own copy of the CobremsGenerator prototype and
+// its own random number engine, and pushes its photons into a bounded
+// lock-free ring buffer shared by all of the producers and workers.
+// Producers sleep whenever the ring is full, so they only take cpu
+// when the workers are consuming photons. A worker that finds the ring
+// empty does not wait, but generates its own photon as it would without
+// the pool, so the pool can never slow down the simulation. The pool
+// is requested with the BEAMPOOL card in control.in.
+//
+// At the end of the job the pool reports its mean fill level and how
+// often the workers found it empty or the producers found it full. An
+// empty pool means that generation is the bottleneck, and more producer
+// threads would help; a full pool means that tracking is the bottleneck.
+// Note that photons are not taken from the pool in a reproducible order,
+// so events are not reproducible from the random seeds in this mode.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state, but it
+// is thread-safe in that its methods can be called concurrently
+// from several different threads without conflicts.
+
+#ifndef GlueXBeamPhotonPool_h
+#define GlueXBeamPhotonPool_h 1
+
+#include "GlueXPrimaryGeneratorAction.hh"
+#include "CobremsGenerator.hh"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+
+class GlueXBeamPhotonPool
+{
+ public:
+   typedef GlueXPrimaryGeneratorAction::beam_photon_t beam_photon_t;
+
+   GlueXBeamPhotonPool(const CobremsGenerator &prototype,
+                       int nproducers, int depth=4096);
+   ~GlueXBeamPhotonPool();
+
+   // Take the next ready photon from the pool, or return false
+   // without waiting if the pool is empty.
+   bool Pop(beam_photon_t &photon);
+
+   // fraction of the pool that is currently filled
+   double GetFillLevel() const;
+
+   void PrintStatistics() const;
+
+ protected:
+   GlueXBeamPhotonPool(GlueXBeamPhotonPool &src);
+   GlueXBeamPhotonPool& operator=(GlueXBeamPhotonPool &src);
+
+   bool Push(const beam_photon_t &photon);
+   void ProducerLoop(long seed);
+
+   struct slot_t {
+      std::atomic<unsigned long> seq;
+      beam_photon_t photon;
+   };
+
+   const CobremsGenerator &fPrototype;
+   slot_t *fSlots;
+   unsigned long fMask;
+   std::atomic<unsigned long> fHead;
+   std::atomic<unsigned long> fTail;
+   std::atomic<bool> fStopping;
+   std::vector<std::thread> fProducers;
+
+   std::atomic<long> fNproduced;
+   std::atomic<long> fNpopped;
+   std::atomic<long> fNempty;
+   std::atomic<long> fNfull;
+   std::atomic<long> fFillSum;
+};
+
+#endif
@@ -0,0 +1,203 @@
+//
+// GlueXCalibrationCache - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXCalibrationCache.hh"
+#include "GlueXUserOptions.hh"
+
+#include "G4ios.hh"
+
+#include <JANA/JApplication.h>
+#include <JANA/JCalibration.h>
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+
+std::map<GlueXCalibrationCache::table_key_t, GlueXCalibrationCache::table_t>
+                                          GlueXCalibrationCache::fTables;
+std::string GlueXCalibrationCache::fSnapshotFile;
+std::string GlueXCalibrationCache::fContext;
+int GlueXCalibrationCache::fSnapshotRead = 0;
+
+G4Mutex GlueXCalibrationCache::fMutex = G4MUTEX_INITIALIZER;
+
+const GlueXCalibrationCache::table_t *
+GlueXCalibrationCache::Fetch(const std::string &path, int form, int run)
+{
+   // Return the cached table, loading it from the snapshot file or
+   // from ccdb if it is not already in the cache, or null if it does
+   // not exist. The tables are never modified once they are entered
+   // in the cache, so the pointer remains valid for the whole job.
+
+   extern int run_number;
+   extern jana::JApplication *japp;
+   if (run < 0)
+      run = run_number;
+
+   G4AutoLock barrier(&fMutex);
+   if (! fSnapshotRead)
+      ReadSnapshot();
+
+   table_key_t key;
+   key.form = form;
+   key.run = run;
+   key.path = path;
+   key.context = fContext;
+   std::map<table_key_t, table_t>::iterator iter = fTables.find(key);
+   if (iter != fTables.end())
+      return &iter->second;
+
+   if (japp == 0) {
+      G4cerr << "GlueXCalibrationCache::Fetch error - "
+             << "jana global DApplication object not set, "
+             << "cannot continue." << G4endl;
+      exit(-1);
+   }
+   jana::JCalibration *jcalib = japp->GetJCalibration(run);
+   table_t table;
+   if (form == 0) {
+      table.resize(1);
+      if (jcalib->Get(path, table[0]))
+         return 0;
+   }
+   else if (jcalib->Get(path, table)) {
+      return 0;
+   }
+   iter = fTables.insert(std::make_pair(key, table)).first;
+   if (fSnapshotFile.size() > 0)
+      WriteSnapshot();
+   return &iter->second;
+}
+
+void GlueXCalibrationCache::ReadSnapshot()
+{
+   // Find the calibration context that the tables belong to, and load
+   // all of the tables in the snapshot file named on the TABLESNAPSHOT
+   // card, if any.
+
+   fSnapshotRead = 1;
+   const char *context = getenv("JANA_CALIB_CONTEXT");
+   fContext = (context && *context)? context : "default";
+   GlueXUserOptions *opts = GlueXUserOptions::GetInstance();
+   std::map<int, std::string> snapshot_opts;
+   if (opts == 0 || ! opts->Find("TABLESNAPSHOT", snapshot_opts))
+      return;
+   fSnapshotFile = snapshot_opts[1];
+
+   int ntables = LoadSnapshot();
+   if (ntables < 0) {
+      G4cout << "GlueXCalibrationCache: snapshot file " << fSnapshotFile
+             << " not found, it will be created." << G4endl;
+      return;
+   }
+   G4cout << "GlueXCalibrationCache: " << ntables << " tables read from "
+          << "snapshot file " << fSnapshotFile << G4endl;
+}
+
+int GlueXCalibrationCache::LoadSnapshot()
+{
+   // Add the tables in the snapshot file to the cache, except for any
+   // that are there already. The file is a text file with one line per
+   // table introducing it as
+   //    table <form> <run> <path> <rows> <context>
+   // where the context is the rest of the line, followed by one line
+   // per row of the form
+   //    <columns> <name> <value> <name> <value> ...
+   // Returns the number of tables added, or -1 if there is no file.
+
+   std::ifstream fin(fSnapshotFile.c_str());
+   if (! fin.is_open())
+      return -1;
+   int ntables = 0;
+   std::string line;
+   while (std::getline(fin, line)) {
+      std::istringstream sin(line);
+      std::string tag;
+      table_key_t key;
+      int nrows;
+      if (! (sin >> tag >> key.form >> key.run >> key.path >> nrows) ||
+          tag != "table")
+      {
+         continue;
+      }
+      std::getline(sin >> std::ws, key.context);
+      table_t table(nrows);
+      for (int row=0; row < nrows && std::getline(fin, line); ++row) {
+         std::istringstream rin(line);
+         int ncols = 0;
+         rin >> ncols;
+         for (int col=0; col < ncols; ++col) {
+            std::string name;
+            double value;
+            if (rin >> name >> value)
+               table[row][name] = value;
+         }
+      }
+      if (fTables.insert(std::make_pair(key, table)).second)
+         ++ntables;
+   }
+   return ntables;
+}
+
+void GlueXCalibrationCache::WriteSnapshot()
+{
+   // Rewrite the snapshot file with the full contents of the cache,
+   // replacing the old file only once the new one is complete, so that
+   // other jobs sharing the file never see it partially written. The
+   // tables that other jobs have added to the file since it was read
+   // are merged in first, while holding a lock that keeps them from
+   // replacing it at the same time.
+
+   std::string lockfile = fSnapshotFile + ".lock";
+   int lock = open(lockfile.c_str(), O_RDWR | O_CREAT, 0666);
+   if (lock >= 0 && flock(lock, LOCK_EX) != 0) {
+      close(lock);
+      lock = -1;
+   }
+   LoadSnapshot();
+
+   std::stringstream tmpname;
+   tmpname << fSnapshotFile << ".tmp" << getpid();
+   std::string tmpfile = tmpname.str();
+   std::ofstream fout(tmpfile.c_str());
+   if (! fout.is_open()) {
+      G4cerr << "GlueXCalibrationCache::WriteSnapshot warning - "
+             << "unable to write snapshot file " << tmpfile
+             << ", continuing without it." << G4endl;
+      if (lock >= 0)
+         close(lock);
+      return;
+   }
+   fout << std::setprecision(17);
+   std::map<table_key_t, table_t>::iterator iter;
+   for (iter = fTables.begin(); iter != fTables.end(); ++iter) {
+      const table_t &table = iter->second;
+      fout << "table " << iter->first.form << " " << iter->first.run
+           << " " << iter->first.path << " " << table.size()
+           << " " << iter->first.context << std::endl;
+      for (unsigned int row=0; row < table.size(); ++row) {
+         fout << table[row].size();
+         std::map<std::string, double>::const_iterator col;
+         for (col = table[row].begin(); col != table[row].end(); ++col)
+            fout << " " << col->first << " " << col->second;
+         fout << std::endl;
+      }
+   }
+   fout.close();
+   if (fout.fail() || rename(tmpfile.c_str(), fSnapshotFile.c_str()) != 0) {
+      G4cerr << "GlueXCalibrationCache::WriteSnapshot warning - "
+             << "unable to replace snapshot file " << fSnapshotFile
+             << ", continuing without it." << G4endl;
+      unlink(tmpfile.c_str());
+   }
+   if (lock >= 0)
+      close(lock);
+}
@@ -0,0 +1,112 @@
+//
+// GlueXCalibrationCache - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Process-wide cache of the calibration constants read from ccdb
+// through the JANA JCalibration interface, keyed by the table path,
+// the run number and the calibration context, which holds the ccdb
+// variation and calibration time as set with JANA_CALIB_CONTEXT. Each
+// table is fetched from ccdb at most once per
+// process, however many threads or sensitive detector objects ask
+// for it. If the TABLESNAPSHOT card is given in control.in, tables
+// are first looked for in the named snapshot file, and any that are
+// fetched from ccdb are added to it, so that later jobs using the
+// same snapshot do not need to contact the ccdb server at all. Jobs
+// sharing a snapshot file add their tables to it in turn, holding a
+// lock on it while they merge what the others have added and replace
+// the file, so that no job loses the tables written by another.
+//
+// The Get methods mirror JCalibration::Get, returning false on success
+// and true if the table could not be found.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. Access to
+// the cache is serialized with a mutex.
+
+#ifndef GlueXCalibrationCache_h
+#define GlueXCalibrationCache_h 1
+
+#include "G4Threading.hh"
+#include "G4AutoLock.hh"
+
+#include <map>
+#include <vector>
+#include <string>
+
+class GlueXCalibrationCache
+{
+ public:
+   template <typename T>
+   static bool Get(const std::string &path, std::map<std::string, T> &values,
+                   int run=-1);
+   template <typename T>
+   static bool Get(const std::string &path,
+                   std::vector<std::map<std::string, T> > &values,
+                   int run=-1);
+
+ private:
+   GlueXCalibrationCache() {}
+
+   typedef std::vector<std::map<std::string, double> > table_t;
+
+   struct table_key_t {
+      int form;               // key-value map (0) or list of rows (1)
+      int run;                // run number
+      std::string path;       // ccdb table path
+      std::string context;    // calibration context, eg. variation=mc
+      bool operator<(const table_key_t &k) const {
+         return (form != k.form)? form < k.form :
+                (run != k.run)? run < k.run :
+                (path != k.path)? path < k.path : context < k.context;
+      }
+   };
+
+   static const table_t *Fetch(const std::string &path, int form, int run);
+   static void ReadSnapshot();
+   static int LoadSnapshot();
+   static void WriteSnapshot();
+
+   static std::map<table_key_t, table_t> fTables;
+   static std::string fSnapshotFile;
+   static std::string fContext;
+   static int fSnapshotRead;
+   static G4Mutex fMutex;
+};
+
+template <typename T>
+bool GlueXCalibrationCache::Get(const std::string &path,
+                                std::map<std::string, T> &values, int run)
+{
+   const table_t *table = Fetch(path, 0, run);
+   if (table == 0)
+      return true;
+   values.clear();
+   if (table->size() > 0) {
+      std::map<std::string, double>::const_iterator iter;
+      for (iter = (*table)[0].begin(); iter != (*table)[0].end(); ++iter)
+         values[iter->first] = iter->second;
+   }
+   return false;
+}
+
+template <typename T>
+bool GlueXCalibrationCache::Get(const std::string &path,
+                                std::vector<std::map<std::string, T> > &values,
+                                int run)
+{
+   const table_t *table = Fetch(path, 1, run);
+   if (table == 0)
+      return true;
+   values.resize(table->size());
+   for (unsigned int row=0; row < table->size(); ++row) {
+      values[row].clear();
+      std::map<std::string, double>::const_iterator iter;
+      for (iter = (*table)[row].begin(); iter != (*table)[row].end(); ++iter)
+         values[row][iter->first] = iter->second;
+   }
+   return false;
+}
+
+#endif
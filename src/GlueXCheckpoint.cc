@@ -0,0 +1,179 @@
+//
+// GlueXCheckpoint - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXCheckpoint.hh"
+#include "GlueXUserOptions.hh"
+#include "HddmOutput.hh"
+
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+extern int run_number;
+
+const char *kCheckpointHeader = "hdgeant4 checkpoint";
+
+int GlueXCheckpoint::fEvery = 0;
+long int GlueXCheckpoint::fLastEvents = 0;
+long int GlueXCheckpoint::fEventsDone = 0;
+std::string GlueXCheckpoint::fFilename;
+std::string GlueXCheckpoint::fOutfile;
+std::string GlueXCheckpoint::fEngineState;
+
+void GlueXCheckpoint::Configure(int every, const std::string &filename,
+                                const std::string &outfile)
+{
+   fEvery = (every > 0)? every : 0;
+   fFilename = filename;
+   fOutfile = outfile;
+   if (fEvery > 0) {
+      G4cout << "GlueXCheckpoint: checkpoint every " << fEvery
+             << " events to " << fFilename << G4endl;
+   }
+}
+
+void GlueXCheckpoint::Resume()
+{
+   // Read the last checkpoint and put the output back the way it was
+   // then, to be called before the output is opened. The state of the
+   // random engine is kept to be restored once the engine is set up.
+
+   std::ifstream fin(fFilename.c_str());
+   std::string line;
+   if (! std::getline(fin, line) || line != kCheckpointHeader) {
+      G4cerr << "GlueXCheckpoint::Resume error - "
+             << "no checkpoint found in " << fFilename
+             << ", cannot resume." << G4endl;
+      exit(-1);
+   }
+   int runno = -1;
+   long int events = -1;
+   long int eventno = 0;
+   long int bytes = -1;
+   std::string outfile;
+   while (std::getline(fin, line)) {
+      std::stringstream words(line);
+      std::string key;
+      words >> key;
+      if (key == "run") {
+         words >> runno;
+      }
+      else if (key == "events") {
+         words >> events;
+      }
+      else if (key == "eventno") {
+         words >> eventno;
+      }
+      else if (key == "output") {
+         words >> bytes;
+         std::getline(words >> std::ws, outfile);
+      }
+      else if (key == "engine") {
+         std::stringstream rest;
+         rest << fin.rdbuf();
+         fEngineState = rest.str();
+         break;
+      }
+   }
+   if (events < 0 || fEngineState.size() == 0) {
+      G4cerr << "GlueXCheckpoint::Resume error - "
+             << "checkpoint file " << fFilename << " is incomplete, "
+             << "cannot resume." << G4endl;
+      exit(-1);
+   }
+   if (runno != run_number) {
+      G4cerr << "GlueXCheckpoint::Resume error - "
+             << "checkpoint in " << fFilename << " is for run " << runno
+             << ", not run " << run_number << ", cannot resume." << G4endl;
+      exit(-1);
+   }
+   if (outfile != fOutfile) {
+      G4cerr << "GlueXCheckpoint::Resume error - "
+             << "checkpoint in " << fFilename << " is for output file '"
+             << outfile << "', not '" << fOutfile << "', cannot resume."
+             << G4endl;
+      exit(-1);
+   }
+
+   std::map<int, std::string> infile;
+   std::map<int, int> trig_opts;
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   if ((user_opts->Find("INFILE", infile) ||
+        user_opts->Find("INFI", infile)) &&
+       user_opts->Find("TRIG", trig_opts) &&
+       trig_opts[1] > 0 && events >= trig_opts[1])
+   {
+      G4cout << "GlueXCheckpoint: all " << events << " events had been "
+             << "done at the last checkpoint, nothing more to do." << G4endl;
+      exit(0);
+   }
+
+   if (fOutfile.size() > 0 && bytes >= 0) {
+      struct stat st;
+      if (stat(fOutfile.c_str(), &st) != 0 || st.st_size < bytes ||
+          truncate(fOutfile.c_str(), bytes) != 0)
+      {
+         G4cerr << "GlueXCheckpoint::Resume error - "
+                << "output file " << fOutfile << " is shorter than at "
+                << "the checkpoint, cannot resume." << G4endl;
+         exit(-1);
+      }
+      HddmOutput::SetAppend();
+   }
+   HddmOutput::setEventNo(eventno);
+   fEventsDone = events;
+   fLastEvents = events;
+   G4cout << "GlueXCheckpoint: resuming after " << events << " events "
+          << "from checkpoint " << fFilename << G4endl;
+}
+
+void GlueXCheckpoint::RestoreEngine()
+{
+   if (fEngineState.size() == 0)
+      return;
+   std::stringstream state(fEngineState);
+   G4Random::getTheEngine()->get(state);
+   if (state.fail()) {
+      G4cerr << "GlueXCheckpoint::RestoreEngine error - "
+             << "unable to restore the random engine from "
+             << fFilename << ", cannot resume." << G4endl;
+      exit(-1);
+   }
+}
+
+void GlueXCheckpoint::Update(long int events)
+{
+   if (fEvery == 0 || events <= fLastEvents || events % fEvery != 0)
+      return;
+   fLastEvents = events;
+   long int bytes = HddmOutput::Checkpoint();
+   std::string tmpfile = fFilename + ".tmp";
+   std::ofstream fout(tmpfile.c_str());
+   fout << kCheckpointHeader << std::endl
+        << "run " << run_number << std::endl
+        << "events " << events << std::endl
+        << "eventno " << HddmOutput::getEventNo() << std::endl
+        << "output " << bytes << " " << fOutfile << std::endl
+        << "engine" << std::endl;
+   G4Random::getTheEngine()->put(fout);
+   fout.close();
+   if (fout.fail() || rename(tmpfile.c_str(), fFilename.c_str()) != 0) {
+      G4cerr << "GlueXCheckpoint::Update warning - "
+             << "unable to write checkpoint file " << fFilename
+             << ", continuing without it." << G4endl;
+      unlink(tmpfile.c_str());
+      return;
+   }
+   G4cout << "GlueXCheckpoint: checkpoint taken after " << events
+          << " events" << G4endl;
+}
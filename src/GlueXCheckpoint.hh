@@ -0,0 +1,80 @@
+//
+// GlueXCheckpoint - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// This class saves the state of a batch job every so many events, as
+// set by the SAVEPOINT card in control.in, so that a job killed part
+// way through, as happens without warning in preemptible batch slots,
+// can be continued from the last checkpoint instead of starting over.
+// A checkpoint is taken between two events, when everything from the
+// events before it has been handed over to the output. The output is
+// flushed to the file by finishing its hddm stream, so that the file is
+// complete and valid up to that point, and a new stream is started that
+// appends to it (see HddmOutput::Checkpoint). Then the checkpoint file
+// is written, replacing the last one only once it is complete, giving
+// the number of events generated so far, which is also the number of
+// events read from the INFILE input, the event number reached by the
+// output, the size of the output file, and the state of the random
+// number engine.
+//
+// Running hdgeant4 again with the -R option in the same directory
+// resumes the job from the checkpoint. The output file is cut back to
+// its size at the checkpoint, dropping the events written after it, and
+// the output appends to it, starting from the saved event number. The
+// random engine is restored, the events already done are passed over
+// without being generated, and INFILE input starts at the first record
+// not yet read, so that the events that follow come out the same as in
+// a job that was never interrupted. For this to hold in a multithreaded
+// build, where each worker thread would be reseeded by the master for
+// every event, a job with checkpoints is run with the sequential
+// G4RunManager, with its events generated from the saved engine.
+//
+// Checkpoints can only be taken between events when just one event is
+// being worked on at a time, so they are not available with several
+// worker threads, nor in the fork mode of hdgeant4, nor with the output
+// written in shards or streamed to mcsmear.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state.
+
+#ifndef GlueXCheckpoint_h
+#define GlueXCheckpoint_h 1
+
+#include <string>
+
+class GlueXCheckpoint
+{
+ public:
+   static void Configure(int every, const std::string &filename,
+                         const std::string &outfile);
+   static void Resume();
+   static void RestoreEngine();
+
+   // Called before each event is generated, with the number of events
+   // generated before it, to take a checkpoint when one is due.
+   static void Update(long int events);
+
+   // true once checkpoints have been configured for the job
+   static bool IsActive() {
+      return fFilename.size() > 0;
+   }
+
+   // number of events done before the checkpoint that the job resumed
+   static long int GetEventsDone() {
+      return fEventsDone;
+   }
+
+ private:
+   GlueXCheckpoint() {}
+
+   static int fEvery;               // events between checkpoints, or 0
+   static long int fLastEvents;     // events at the last checkpoint
+   static long int fEventsDone;     // events done before resuming
+   static std::string fFilename;    // checkpoint file
+   static std::string fOutfile;     // output file, if any
+   static std::string fEngineState; // random engine status to restore
+};
+
+#endif
@@ -9,6 +9,15 @@
 #include "GlueXMagneticField.hh"
 
 #include "GlueXSensitiveDetectorCDC.hh"
+#include "GlueXVolumeIdentifiers.hh"
+#include "GlueXGeometryCache.hh"
+#include "GlueXLayerReport.hh"
+#include "GlueXVoxelReport.hh"
+#include "GlueXFastShowerModel.hh"
+#include "GlueXUserOptions.hh"
+#ifdef CACHE_BOOLEAN_POLYHEDRA
+#include "HepPolyhedronCache.hh"
+#endif
 
 #include "G4Box.hh"
 #include "G4Material.hh"
@@ -21,12 +30,14 @@
 #include "G4MTRunManager.hh"
 #include "G4LogicalVolumeStore.hh"
 #include "G4TransportationManager.hh"
+#include "G4Navigator.hh"
 #include "G4MagIntegratorDriver.hh"
 #include "G4ChordFinder.hh"
 #include "G4Mag_UsualEqRhs.hh"
 #include "G4ExactHelixStepper.hh"
 #include "G4HelixMixedStepper.hh"
 #include "G4ClassicalRK4.hh"
+#include "G4CashKarpRKF45.hh"
 
 #include "G4UserLimits.hh"
 #include "G4SystemOfUnits.hh"
@@ -62,6 +73,7 @@ using namespace xercesc;
 
 G4Mutex GlueXDetectorConstruction::fMutex = G4MUTEX_INITIALIZER;
 std::list<GlueXDetectorConstruction*> GlueXDetectorConstruction::fInstance;
+G4ThreadLocal G4Navigator *GlueXDetectorConstruction::fFieldLocator = 0;
 
 GlueXDetectorConstruction::GlueXDetectorConstruction(G4String hddsFile)
 : fMaxStep(0),
@@ -118,6 +130,34 @@ GlueXDetectorConstruction::GlueXDetectorConstruction(G4String hddsFile)
       return;
    }
    
+   // If the GEOMCACHE card names a directory, the model is saved there
+   // after it is built, under a key made from the HDDS documents, and
+   // later jobs reading the same documents load it from there instead.
+   // The boolean polyhedra made for drawing the model are kept there too.
+
+   std::string cachedir;
+   std::string cachekey;
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   std::map<int, std::string> cache_opts;
+   if (user_opts && user_opts->Find("GEOMCACHE", cache_opts)) {
+      cachekey = GlueXGeometryCache::GetKey(hddsFile);
+      if (cachekey.size() > 0) {
+         cachedir = cache_opts[1];
+#ifdef CACHE_BOOLEAN_POLYHEDRA
+         HepPolyhedronCache::SetFile(cachedir + "/" + cachekey +
+                                     ".polyhedra");
+#endif
+         if (GlueXGeometryCache::Load(fHddsBuilder, cachedir, cachekey)) {
+            G4cout << "GlueXDetectorConstruction: geometry loaded from "
+                   << "cache in " << cachedir << G4endl;
+            XMLPlatformUtils::Terminate();
+            PrepareLayers();
+            fHddsBuilder.findDivisions();
+            return;
+         }
+      }
+   }
+
    int size=100;
    char *saved_cwd = new char[size];
    while (getcwd(saved_cwd, size) == 0)
@@ -155,9 +195,72 @@ GlueXDetectorConstruction::GlueXDetectorConstruction(G4String hddsFile)
       return;
    }
 
+   int pruned = fHddsBuilder.pruneSubsystems(document);
+   if (pruned > 0) {
+      G4cout << "GlueXDetectorConstruction: " << pruned
+             << " subsystem placements omitted or replaced by their "
+             << "envelopes" << G4endl;
+   }
    fHddsBuilder.translate(rootEl);
 
+   if (cachedir.size() > 0 &&
+       GlueXGeometryCache::Save(fHddsBuilder, cachedir, cachekey))
+   {
+      G4cout << "GlueXDetectorConstruction: geometry saved to cache in "
+             << cachedir << G4endl;
+   }
+
    XMLPlatformUtils::Terminate();
+   PrepareLayers();
+   fHddsBuilder.findDivisions();
+}
+
+void GlueXDetectorConstruction::PrepareLayers()
+{
+   // The MERGELAYERS card folds the volumes of each parallel world into
+   // the layer above it wherever that can be done without overlaps, to
+   // save the cost of navigating the extra worlds on every step, and
+   // the STRAWRINGS card replaces the placements of the straws in each
+   // ring of the CDC with a single parameterised volume per ring. The
+   // SMARTLESS cards then set the voxel quality factor of the volumes,
+   // and the VOXELREPORT and LAYERREPORT cards print the resulting
+   // voxels and what is left in each of the layers.
+   // This comes after the model is saved to the geometry cache, so the
+   // cache always holds the model as it was built from the documents.
+
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   if (user_opts == 0)
+      return;
+   std::map<int, double> merge_opts;
+   if (user_opts->Find("MERGELAYERS", merge_opts) && merge_opts[1] != 0) {
+      double tolerance = merge_opts[2] * mm;
+      int merged = fHddsBuilder.mergeLayers(tolerance);
+      G4cout << "GlueXDetectorConstruction: " << merged
+             << " geometry layers merged" << G4endl;
+   }
+   std::map<int, int> straw_opts;
+   if (user_opts->Find("STRAWRINGS", straw_opts) && straw_opts[1] != 0) {
+      int minstraws = (straw_opts[2] > 1)? straw_opts[2] : 16;
+      int rings = fHddsBuilder.buildStrawRings(minstraws);
+      G4cout << "GlueXDetectorConstruction: " << rings
+             << " straw rings built" << G4endl;
+   }
+   int tuned = fHddsBuilder.tuneSmartless();
+   if (tuned > 0) {
+      G4cout << "GlueXDetectorConstruction: voxel quality factor set "
+             << "by SMARTLESS cards for " << tuned << " volumes" << G4endl;
+   }
+   std::map<int, int> voxel_opts;
+   if (user_opts->Find("VOXELREPORT", voxel_opts)) {
+      int nvolumes = (voxel_opts[1] > 0)? voxel_opts[1] : 20;
+      GlueXVoxelReport::Print(nvolumes);
+   }
+   std::map<int, double> report_opts;
+   if (user_opts->Find("LAYERREPORT", report_opts)) {
+      int nrays = report_opts[1];
+      G4ThreeVector origin(0, 0, report_opts[2] * cm);
+      GlueXLayerReport::Print(&fHddsBuilder, nrays, origin);
+   }
 }
 
 GlueXDetectorConstruction::
@@ -177,6 +280,15 @@ GlueXDetectorConstruction::~GlueXDetectorConstruction()
    G4AutoLock barrier(&fMutex);
    fInstance.remove(this);
    delete fpDetectorMessenger;             
+   ReleaseFieldLocator();
+}
+
+void GlueXDetectorConstruction::ReleaseFieldLocator()
+{
+   if (fFieldLocator) {
+      delete fFieldLocator;
+      fFieldLocator = 0;
+   }
 }
 
 const GlueXDetectorConstruction *GlueXDetectorConstruction::GetInstance()
@@ -226,6 +338,7 @@ G4VPhysicalVolume* GlueXDetectorConstruction::Construct()
    worldvol->SetName("World");
    G4cout << " configured as " << worldvol->GetName() << G4endl;
    worldvol->SetVisAttributes(new G4VisAttributes(false));
+   GlueXFastShowerModel::Prepare();
    return new G4PVPlacement(0, G4ThreeVector(), worldvol, "World", 0, 0, 0);
 }
 
@@ -240,24 +353,49 @@ void GlueXDetectorConstruction::ConstructSDandField()
    if (rmtype != G4RunManager::sequentialRM)
       CloneF();
 
+   // The volume identifiers used by the sensitive detectors to label
+   // their hits are resolved from a table built here, once for all
+   // threads, from the identifier lists attached to the HDDS volumes.
+   GlueXVolumeIdentifiers::Build(&fHddsBuilder);
+
    G4SDManager* SDman = G4SDManager::GetSDMpointer();
-   GlueXSensitiveDetectorCDC* strawHandler = 0;
 
    // During geometry building, certain logical volumes were marked as
    // sensitive by adding them to a list. Now we need to go down that
    // list and pick out an explicit sensitive volume class to handle
-   // each one. If any are missing, report error.
+   // each one, from the table below. Volumes that share a sensitive
+   // detector name are handled by a single instance of the class.
+   // If any are missing, report error.
+
+   struct sensitive_detector_t {
+      const char *volname;
+      const char *sdname;
+      G4VSensitiveDetector *(*create)(const G4String &name);
+   };
+   static const sensitive_detector_t sdtable[] = {
+      {"STLA", "straw", &NewSensitiveDetector<GlueXSensitiveDetectorCDC>},
+      {"STRA", "straw", &NewSensitiveDetector<GlueXSensitiveDetectorCDC>},
+   };
+   const int sdtable_size = sizeof(sdtable) / sizeof(sdtable[0]);
+   std::map<std::string, G4VSensitiveDetector*> handlers;
+
    const std::map<int, G4LogicalVolume*>
    svolMap = fHddsBuilder.getSensitiveVolumes();
    std::map<int, G4LogicalVolume*>::const_iterator iter;
    for (iter = svolMap.begin(); iter != svolMap.end(); ++iter) {
       G4String volname = iter->second->GetName();
-      if (volname == "STLA" || volname == "STRA") {
-         if (strawHandler == 0) {
-            strawHandler = new GlueXSensitiveDetectorCDC("straw");
-            SDman->AddNewDetector(strawHandler);
+      int isd;
+      for (isd=0; isd < sdtable_size; ++isd) {
+         if (volname == sdtable[isd].volname)
+            break;
+      }
+      if (isd < sdtable_size) {
+         G4VSensitiveDetector *&handler = handlers[sdtable[isd].sdname];
+         if (handler == 0) {
+            handler = sdtable[isd].create(sdtable[isd].sdname);
+            SDman->AddNewDetector(handler);
          }
-         iter->second->SetSensitiveDetector(strawHandler);
+         iter->second->SetSensitiveDetector(handler);
       }
       else {
          G4cerr << "Warning from GlueXDetectorConstruction"
@@ -267,6 +405,10 @@ void GlueXDetectorConstruction::ConstructSDandField()
                 << G4endl;
       }
    }
+
+   // Fast shower models are thread-local, so each thread attaches its
+   // own to the envelope regions, see GlueXFastShowerModel.
+   GlueXFastShowerModel::Attach();
 }
 
 void GlueXDetectorConstruction::CloneF()
@@ -284,7 +426,18 @@ void GlueXDetectorConstruction::CloneF()
       G4FieldManager* clonedFM = 0;
       if (masterFM) {
          FMtoFMmap::iterator fmFound = masterToWorker.find(masterFM);
-         if (fmFound == masterToWorker.end()) {
+         if (fmFound == masterToWorker.end() &&
+             masterFM->GetDetectorField() == 0)
+         {
+
+            // Field-free region, its field manager only serves to stop
+            // the field of the mother from being inherited, so there is
+            // nothing to clone but an empty field manager...
+
+            clonedFM = new G4FieldManager();
+            masterToWorker[masterFM] = clonedFM;
+         }
+         else if (fmFound == masterToWorker.end()) {
 
             // First time we see this FM, let's clone and remember...
 
@@ -301,6 +454,7 @@ void GlueXDetectorConstruction::CloneF()
             }
             else if (dynamic_cast<const GlueXMappedMagField*>(field)) {
                GlueXMappedMagField &orig = *(GlueXMappedMagField*)field;
+               // map contents are shared with orig, not copied
                field_copy = new GlueXMappedMagField(orig);
             }
             else if (dynamic_cast<const GlueXComputedMagField*>(field)) {
@@ -329,6 +483,9 @@ void GlueXDetectorConstruction::CloneF()
             else if (dynamic_cast<const G4HelixMixedStepper*>(stepper)) {
                stepper_copy = new G4HelixMixedStepper(eqn_copy);
             }
+            else if (dynamic_cast<const G4CashKarpRKF45*>(stepper)) {
+               stepper_copy = new G4CashKarpRKF45(eqn_copy);
+            }
             else {
                G4cerr << "GlueXDetectorConstruction::CloneF error - "
                       << "unknown G4MagIntegratorStepper class found "
@@ -339,7 +496,12 @@ void GlueXDetectorConstruction::CloneF()
             G4ChordFinder *cfinder_copy = new G4ChordFinder(field_copy,
                                                             stepMinimum,
                                                             stepper_copy);
+            cfinder_copy->SetDeltaChord(cfinder->GetDeltaChord());
             clonedFM = new G4FieldManager(field_copy, cfinder_copy);
+            clonedFM->SetDeltaIntersection(masterFM->GetDeltaIntersection());
+            clonedFM->SetDeltaOneStep(masterFM->GetDeltaOneStep());
+            clonedFM->SetMaximumEpsilonStep(masterFM->GetMaximumEpsilonStep());
+            clonedFM->SetMinimumEpsilonStep(masterFM->GetMinimumEpsilonStep());
             masterToWorker[masterFM] = clonedFM;
          }
          else {
@@ -377,6 +539,47 @@ G4LogicalVolume*
    return fHddsBuilder.getWorldVolume(paraIndex);
 }
 
+const G4Field*
+GlueXDetectorConstruction::LocateField(const G4ThreeVector &pos) const
+{
+   // Find the field attached to the volume containing pos, or 0 if
+   // there is none there or the geometry has not yet been constructed.
+   // The point is located with a private per-thread navigator rather
+   // than with the tracking navigator, so that a call made in the middle
+   // of a step does not disturb the state of the tracking, and successive
+   // lookups at nearby points are resolved by a relative search starting
+   // from the last volume located.
+
+   G4TransportationManager *tmanager;
+   G4Navigator *tracker;
+   G4VPhysicalVolume *world;
+   if ((tmanager = G4TransportationManager::GetTransportationManager()) == 0 ||
+       (tracker = tmanager->GetNavigatorForTracking()) == 0 ||
+       (world = tracker->GetWorldVolume()) == 0)
+   {
+      return 0;
+   }
+   if (fFieldLocator == 0) {
+      fFieldLocator = new G4Navigator();
+      fFieldLocator->SetWorldVolume(world);
+   }
+   else if (fFieldLocator->GetWorldVolume() != world) {
+      fFieldLocator->SetWorldVolume(world);
+      fFieldLocator->ResetState();
+   }
+
+   G4VPhysicalVolume *pvol;
+   G4LogicalVolume *lvol;
+   G4FieldManager *fieldmgr;
+   if ((pvol = fFieldLocator->LocateGlobalPointAndSetup(pos, 0, true)) &&
+       (lvol = pvol->GetLogicalVolume()) &&
+       (fieldmgr = lvol->GetFieldManager()) )
+   {
+      return fieldmgr->GetDetectorField();
+   }
+   return 0;
+}
+
 G4ThreeVector
 GlueXDetectorConstruction::GetMagneticField(G4ThreeVector pos, double unit)
 const
@@ -386,19 +589,8 @@ const
    // the geometry. If geometry has not yet been constructed
    // the value returned is always zero.
 
-   G4TransportationManager *tmanager;
-   G4Navigator *navigator;
-   G4VPhysicalVolume *pvol;
-   G4LogicalVolume *lvol;
-   G4FieldManager *fieldmgr;
-   const G4Field *field;
-   if ((tmanager = G4TransportationManager::GetTransportationManager()) &&
-       (navigator = tmanager->GetNavigatorForTracking()) &&
-       (pvol = navigator->LocateGlobalPointAndSetup(pos)) &&
-       (lvol = pvol->GetLogicalVolume()) &&
-       (fieldmgr = lvol->GetFieldManager()) &&
-       (field = fieldmgr->GetDetectorField()) )
-   {
+   const G4Field *field = LocateField(pos);
+   if (field) {
       double Bfield[3];
       double xglob[4] = {pos[0], pos[1], pos[2], 0};
       field->GetFieldValue(xglob, Bfield);
@@ -408,6 +600,40 @@ const
    return G4ThreeVector();
 }
 
+void GlueXDetectorConstruction::GetMagneticFields(int npoints,
+                                                  const G4double *points,
+                                                  G4double *Bfield) const
+{
+   // Batch version of GetMagneticField for a set of points that all lie
+   // in the same volume, such as the clusters along one step, packed as
+   // x,y,z,t for each point as in G4Field::GetFieldValue. The fields are
+   // returned in Geant4 units packed as Bx,By,Bz. The volume is located
+   // only once, at the first point, and the GlueX field classes evaluate
+   // all of the points in one call.
+
+   if (npoints <= 0)
+      return;
+   G4ThreeVector pos(points[0], points[1], points[2]);
+   const G4Field *field = LocateField(pos);
+   if (field == 0) {
+      for (int n=0; n < npoints * 3; ++n)
+         Bfield[n] = 0;
+      return;
+   }
+   const GlueXMappedMagField *mapped;
+   const GlueXComputedMagField *computed;
+   const GlueXUniformMagField *uniform;
+   if ((mapped = dynamic_cast<const GlueXMappedMagField*>(field)))
+      mapped->GetFieldValues(npoints, points, Bfield);
+   else if ((computed = dynamic_cast<const GlueXComputedMagField*>(field)))
+      computed->GetFieldValues(npoints, points, Bfield);
+   else if ((uniform = dynamic_cast<const GlueXUniformMagField*>(field)))
+      uniform->GetFieldValues(npoints, points, Bfield);
+   else
+      for (int n=0; n < npoints; ++n)
+         field->GetFieldValue(&points[n * 4], &Bfield[n * 3]);
+}
+
 
 
 GlueXParallelWorld::GlueXParallelWorld(const GlueXParallelWorld &src)
@@ -5,7 +5,10 @@
 // version: may 12, 2012
 //
 // In the context of the Geant4 event-level multithreading model,
-// this class is "shared", ie. has no thread-local state.
+// this class is "shared", ie. has no thread-local state, apart
+// from the per-thread navigator used by GetMagneticField, which is
+// deleted on each thread by ReleaseFieldLocator, called from the
+// destructors of this class and of GlueXRunAction.
 
 #ifndef GlueXDetectorConstruction_h
 #define GlueXDetectorConstruction_h 1
@@ -27,6 +30,7 @@ class G4Box;
 class G4LogicalVolume;
 class G4VPhysicalVolume;
 class G4Material;
+class G4Navigator;
 class G4UserLimits;
 class GlueXDetectorMessenger;
 
@@ -58,11 +62,20 @@ class GlueXDetectorConstruction : public G4VUserDetectorConstruction
      G4LogicalVolume* GetParallelWorldVolume(int paraIndex) const;
 
      G4ThreeVector GetMagneticField(G4ThreeVector pos, double unit) const;
+     void GetMagneticFields(int npoints, const G4double *points,
+                            G4double *Bfield) const;
 
      static const GlueXDetectorConstruction* GetInstance();
      static const HddsG4Builder* GetBuilder();
 
+     // delete the navigator of the calling thread used by
+     // GetMagneticField, when the thread is done with it
+     static void ReleaseFieldLocator();
+
   private:
+     void PrepareLayers();
+     const G4Field *LocateField(const G4ThreeVector &pos) const;
+
      G4double fMaxStep;		// maximum step size for tracking
      G4double fUniformField;  	// optional uniform field (for testing)
      G4MagneticField* fpMagneticField; // pointer to the field manager
@@ -71,6 +84,7 @@ class GlueXDetectorConstruction : public G4VUserDetectorConstruction
 
      static G4Mutex fMutex;
      static std::list<GlueXDetectorConstruction*> fInstance;
+     static G4ThreadLocal G4Navigator *fFieldLocator;
 };
 
 class GlueXParallelWorld : public G4VUserParallelWorld
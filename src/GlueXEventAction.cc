@@ -5,6 +5,13 @@
 // version: may 12, 2012
  
 #include "GlueXEventAction.hh"
+#include "GlueXEventFilter.hh"
+#include "GlueXFastShowerModel.hh"
+#include "GlueXTelemetry.hh"
+#include "GlueXSubEvents.hh"
+#include "GlueXUserEventInformation.hh"
+#include "GlueXUserTrackInformation.hh"
+#include "GlueXSteppingVerbose.hh"
 
 #include "G4Event.hh"
 #include "G4EventManager.hh"
@@ -12,12 +19,33 @@
 #include "G4Trajectory.hh"
 #include "G4ios.hh"
 
-void GlueXEventAction::BeginOfEventAction(const G4Event*)
-{}
+void GlueXEventAction::BeginOfEventAction(const G4Event* evt)
+{
+  GlueXEventFilter::BeginOfEventFilters();
+  GlueXUserTrackInformation::BeginOfEvent();
+  GlueXFastShowerModel::BeginOfEvent(evt);
+  GlueXTelemetry::BeginOfEvent();
+}
 
 void GlueXEventAction::EndOfEventAction(const G4Event* evt)
 {
   G4int event_id = evt->GetEventID();
+  GlueXFastShowerModel::EndOfEvent();
+  GlueXTelemetry::EndOfEvent();
+  GlueXSteppingVerbose::FlushThread(false);
+
+  // events with no hits have not been seen by the event filters yet
+  //
+  GlueXUserEventInformation* info = (GlueXUserEventInformation*)
+                                    evt->GetUserInformation();
+  if (info)
+    info->getKeepEvent();
+
+  // the last bundle of an event split up to be tracked in parts merges
+  // the hits of all of them into the output record of the event
+  //
+  if (info && info->getSubEvents() > 1)
+    GlueXSubEvents::EndOfSubEvent(info);
   
   // get number of stored trajectories
   //
@@ -0,0 +1,274 @@
+//
+// GlueXEventFilter - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXEventFilter.hh"
+#include "GlueXSensitiveDetector.hh"
+#include "GlueXUserOptions.hh"
+
+#include "G4SDManager.hh"
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4StepPoint.hh"
+#include "G4Track.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <stdlib.h>
+#include <algorithm>
+
+//--------------------------------------------
+// event filter classes
+//--------------------------------------------
+
+static std::vector<G4LogicalVolume*> FindLogicalVolumes(const std::string &name)
+{
+   // The hdds geometry may make several logical volumes of the same
+   // name, so all of them are returned.
+
+   std::vector<G4LogicalVolume*> volumes;
+   G4LogicalVolumeStore *store = G4LogicalVolumeStore::GetInstance();
+   G4LogicalVolumeStore::iterator iter;
+   for (iter = store->begin(); iter != store->end(); ++iter) {
+      if ((*iter)->GetName() == name)
+         volumes.push_back(*iter);
+   }
+   if (volumes.size() == 0) {
+      G4cerr << "GlueXEventFilter error - "
+             << "volume " << name << " requested for an event filter "
+             << "in control.in is not found in the geometry, "
+             << "cannot continue." << G4endl;
+      exit(-1);
+   }
+   return volumes;
+}
+
+class GlueXHitCountFilter : public GlueXEventFilter
+{
+ // Events pass with at least fMinHits readout elements hit in the
+ // sensitive detector named fDetector.
+
+ public:
+   GlueXHitCountFilter(const std::map<int, std::string> &args)
+    : GlueXEventFilter(args),
+      fSD(0)
+   {
+      std::map<int, std::string>::const_iterator iter;
+      fDetector = ((iter = args.find(1)) != args.end())? iter->second : "";
+      fMinHits = ((iter = args.find(2)) != args.end())?
+                 atoi(iter->second.c_str()) : 1;
+   }
+
+   bool Accept() {
+      if (fSD == 0) {
+         G4SDManager *SDman = G4SDManager::GetSDMpointer();
+         fSD = dynamic_cast<GlueXSensitiveDetectorBase*>
+                           (SDman->FindSensitiveDetector(fDetector, false));
+         if (fSD == 0) {
+            G4cerr << "GlueXHitCountFilter error - "
+                   << "no sensitive detector named " << fDetector
+                   << " to filter events on its hits, "
+                   << "cannot continue." << G4endl;
+            exit(-1);
+         }
+      }
+      return (fSD->GetHitCount() >= fMinHits);
+   }
+
+ protected:
+   std::string fDetector;
+   int fMinHits;
+   GlueXSensitiveDetectorBase *fSD;
+};
+
+class GlueXAcceptanceFilter : public GlueXEventFilter
+{
+ // Events pass with at least fMinTracks primary tracks entering any
+ // placement of the volume named fVolume.
+
+ public:
+   GlueXAcceptanceFilter(const std::map<int, std::string> &args)
+    : GlueXEventFilter(args)
+   {
+      std::map<int, std::string>::const_iterator iter;
+      fVolume = ((iter = args.find(1)) != args.end())? iter->second : "";
+      fMinTracks = ((iter = args.find(2)) != args.end())?
+                   atoi(iter->second.c_str()) : 1;
+   }
+
+   void BeginOfEvent() {
+      if (fVolumes.size() == 0)
+         fVolumes = FindLogicalVolumes(fVolume);
+      fTracks.clear();
+   }
+
+   void Step(const G4Step *step) {
+      const G4Track *track = step->GetTrack();
+      if (track->GetParentID() != 0)
+         return;
+      G4StepPoint *post = step->GetPostStepPoint();
+      if (post->GetStepStatus() != fGeomBoundary ||
+          post->GetPhysicalVolume() == 0)
+      {
+         return;
+      }
+      G4LogicalVolume *lvol = post->GetPhysicalVolume()->GetLogicalVolume();
+      if (std::find(fVolumes.begin(), fVolumes.end(), lvol) == fVolumes.end())
+         return;
+      int id = track->GetTrackID();
+      if (std::find(fTracks.begin(), fTracks.end(), id) == fTracks.end())
+         fTracks.push_back(id);
+   }
+
+   bool Accept() {
+      return ((int)fTracks.size() >= fMinTracks);
+   }
+
+ protected:
+   std::string fVolume;
+   int fMinTracks;
+   std::vector<G4LogicalVolume*> fVolumes;
+   std::vector<int> fTracks;
+};
+
+class GlueXEnergyFilter : public GlueXEventFilter
+{
+ // Events pass with at least fMinEnergy deposited in all placements
+ // of the volume named fVolume.
+
+ public:
+   GlueXEnergyFilter(const std::map<int, std::string> &args)
+    : GlueXEventFilter(args),
+      fEnergy(0)
+   {
+      std::map<int, std::string>::const_iterator iter;
+      fVolume = ((iter = args.find(1)) != args.end())? iter->second : "";
+      fMinEnergy = ((iter = args.find(2)) != args.end())?
+                   atof(iter->second.c_str()) * GeV : 0;
+   }
+
+   void BeginOfEvent() {
+      if (fVolumes.size() == 0)
+         fVolumes = FindLogicalVolumes(fVolume);
+      fEnergy = 0;
+   }
+
+   void Step(const G4Step *step) {
+      double dE = step->GetTotalEnergyDeposit();
+      if (dE <= 0)
+         return;
+      G4LogicalVolume *lvol = step->GetPreStepPoint()->GetPhysicalVolume()
+                                  ->GetLogicalVolume();
+      if (std::find(fVolumes.begin(), fVolumes.end(), lvol) != fVolumes.end())
+         fEnergy += dE;
+   }
+
+   bool Accept() {
+      return (fEnergy >= fMinEnergy);
+   }
+
+ protected:
+   std::string fVolume;
+   double fMinEnergy;
+   double fEnergy;
+   std::vector<G4LogicalVolume*> fVolumes;
+};
+
+template <class FilterT>
+GlueXEventFilter *NewEventFilter(const std::map<int, std::string> &args)
+{
+   return new FilterT(args);
+}
+
+struct event_filter_t {
+   const char *card;
+   GlueXEventFilter *(*create)(const std::map<int, std::string> &args);
+};
+static const event_filter_t filter_table[] = {
+   {"FILTERHITS", &NewEventFilter<GlueXHitCountFilter>},
+   {"FILTERACCEPT", &NewEventFilter<GlueXAcceptanceFilter>},
+   {"FILTEREDEP", &NewEventFilter<GlueXEnergyFilter>},
+};
+const int filter_table_size = sizeof(filter_table) / sizeof(filter_table[0]);
+
+//--------------------------------------------
+// GlueXEventFilter
+//--------------------------------------------
+
+G4ThreadLocal std::vector<GlueXEventFilter*> *GlueXEventFilter::fFilters = 0;
+std::atomic<long> GlueXEventFilter::fAccepted(0);
+std::atomic<long> GlueXEventFilter::fRejected(0);
+std::atomic<long> GlueXEventFilter::fRejectedBy[filter_table_size];
+
+GlueXEventFilter::GlueXEventFilter(const GlueXEventFilter &src)
+{}
+
+GlueXEventFilter& GlueXEventFilter::operator=(const GlueXEventFilter &src)
+{
+   return *this;
+}
+
+std::vector<GlueXEventFilter*> &GlueXEventFilter::GetFilters()
+{
+   if (fFilters == 0) {
+      fFilters = new std::vector<GlueXEventFilter*>;
+      GlueXUserOptions *opts = GlueXUserOptions::GetInstance();
+      for (int i=0; opts && i < filter_table_size; ++i) {
+         std::map<int, std::string> args;
+         if (opts->Find(filter_table[i].card, args)) {
+            GlueXEventFilter *filter = filter_table[i].create(args);
+            filter->fType = i;
+            fFilters->push_back(filter);
+         }
+      }
+   }
+   return *fFilters;
+}
+
+void GlueXEventFilter::BeginOfEventFilters()
+{
+   std::vector<GlueXEventFilter*> &filters = GetFilters();
+   for (unsigned int i=0; i < filters.size(); ++i)
+      filters[i]->BeginOfEvent();
+}
+
+void GlueXEventFilter::ProcessStep(const G4Step *step)
+{
+   std::vector<GlueXEventFilter*> &filters = GetFilters();
+   for (unsigned int i=0; i < filters.size(); ++i)
+      filters[i]->Step(step);
+}
+
+bool GlueXEventFilter::AcceptEvent()
+{
+   std::vector<GlueXEventFilter*> &filters = GetFilters();
+   if (filters.size() == 0)
+      return true;
+   for (unsigned int i=0; i < filters.size(); ++i) {
+      if (! filters[i]->Accept()) {
+         ++fRejected;
+         ++fRejectedBy[filters[i]->fType];
+         return false;
+      }
+   }
+   ++fAccepted;
+   return true;
+}
+
+void GlueXEventFilter::PrintStatistics()
+{
+   long nevents = fAccepted + fRejected;
+   if (nevents == 0)
+      return;
+   G4cout << "GlueXEventFilter: " << fAccepted << " of " << nevents
+          << " events passed the event filters";
+   for (int i=0; i < filter_table_size; ++i) {
+      if (fRejectedBy[i] > 0)
+         G4cout << ", " << fRejectedBy[i] << " rejected by "
+                << filter_table[i].card;
+   }
+   G4cout << G4endl;
+}
@@ -0,0 +1,78 @@
+//
+// GlueXEventFilter - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Base class for filters that decide at the end of tracking whether an
+// event is worth keeping, before the sensitive detectors pack their hits
+// into the output record. Events that fail any of the filters skip the
+// hit packing and are not written out, which saves most of the cpu and
+// i/o after tracking in acceptance studies where most events are thrown
+// away. Each filter is requested by its own card in control.in:
+//
+//    FILTERHITS 'sdname' nmin   - at least nmin readout elements hit in
+//                                 the sensitive detector sdname, eg.
+//                                 FILTERHITS 'straw' 10 for CDC straws
+//    FILTERACCEPT 'volname' nmin - at least nmin (default 1) primary
+//                                 tracks entered volume volname
+//    FILTEREDEP 'volname' emin  - at least emin GeV deposited in all
+//                                 placements of volume volname
+//
+// A new filter is added by deriving a class from this one that takes
+// the arguments of its card in its constructor, and adding the card and
+// the class to the table of filter types in GlueXEventFilter.cc. Filters
+// that look at the tracking see every step through ProcessStep(), called
+// by GlueXSteppingAction, and are reset at the start of each event. The
+// decision is taken when it is first asked for, see getKeepEvent() in
+// GlueXUserEventInformation, and the number of events rejected by each
+// filter is reported at the end of the run.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "thread-local", ie. has thread-local state.
+// Separate object instances are created for each worker thread.
+
+#ifndef GlueXEventFilter_h
+#define GlueXEventFilter_h 1
+
+#include "G4Step.hh"
+#include "G4Threading.hh"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+
+class GlueXEventFilter
+{
+ public:
+   GlueXEventFilter(const std::map<int, std::string> &args) {}
+   virtual ~GlueXEventFilter() {}
+
+   virtual void BeginOfEvent() {}
+   virtual void Step(const G4Step *step) {}
+   virtual bool Accept() = 0;
+
+   // Apply all of the filters requested in control.in for the calling
+   // thread, the first time any is called on that thread creating them.
+   static void BeginOfEventFilters();
+   static void ProcessStep(const G4Step *step);
+   static bool AcceptEvent();
+
+   static void PrintStatistics();
+
+ protected:
+   GlueXEventFilter(const GlueXEventFilter &src);
+   GlueXEventFilter& operator=(const GlueXEventFilter &src);
+
+   static std::vector<GlueXEventFilter*> &GetFilters();
+
+   int fType;                 // index in the table of filter types
+
+   static G4ThreadLocal std::vector<GlueXEventFilter*> *fFilters;
+   static std::atomic<long> fAccepted;
+   static std::atomic<long> fRejected;
+   static std::atomic<long> fRejectedBy[];
+};
+
+#endif
@@ -0,0 +1,424 @@
+//
+// GlueXFastShowerModel - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXFastShowerModel.hh"
+#include "GlueXUserOptions.hh"
+
+#include "G4LogicalVolumeStore.hh"
+#include "G4TransportationManager.hh"
+#include "G4TouchableHistory.hh"
+#include "G4VSensitiveDetector.hh"
+#include "G4FastTrack.hh"
+#include "G4FastStep.hh"
+#include "G4VProcess.hh"
+#include "G4Gamma.hh"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4AutoLock.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <map>
+#include <math.h>
+#include <time.h>
+#include <stdlib.h>
+
+// Spots carry this much energy each, within the limits on their number
+const double kSpotEnergy = 10 * MeV;
+const int kMinSpots = 20;
+const int kMaxSpots = 2000;
+
+std::vector<GlueXFastShowerModel::envelope_t>
+GlueXFastShowerModel::fEnvelopes;
+std::atomic<long> *GlueXFastShowerModel::fShowers = 0;
+std::atomic<long> *GlueXFastShowerModel::fShowerKeV = 0;
+bool GlueXFastShowerModel::fValidate = false;
+std::vector<GlueXFastShowerModel::validation_t>
+GlueXFastShowerModel::fValidation[2];
+double GlueXFastShowerModel::fValidationCpu[2] = {0, 0};
+long GlueXFastShowerModel::fValidationEvents[2] = {0, 0};
+G4Mutex GlueXFastShowerModel::fMutex = G4MUTEX_INITIALIZER;
+G4ThreadLocal GlueXFastShowerModel::event_tally_t
+*GlueXFastShowerModel::fTally = 0;
+G4ThreadLocal bool GlueXFastShowerModel::fFullEvent = false;
+
+static double thread_cpu_seconds()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+GlueXFastShowerModel::GlueXFastShowerModel(int envelope)
+ : G4VFastSimulationModel("GlueXFastShower:" + fEnvelopes[envelope].volume,
+                          fEnvelopes[envelope].region),
+   fEnvelope(envelope)
+{
+   fNavigator = new G4Navigator();
+   fTouchable = new G4TouchableHistory();
+   fSpotStep = new G4Step();
+}
+
+GlueXFastShowerModel::~GlueXFastShowerModel()
+{
+   delete fNavigator;
+   delete fSpotStep;
+}
+
+void GlueXFastShowerModel::Prepare()
+{
+   if (fEnvelopes.size() > 0)
+      return;
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   std::map<int, std::string> shower_opts;
+   if (user_opts == 0 || ! user_opts->Find("FASTSHOWER", shower_opts))
+      return;
+
+   G4LogicalVolumeStore *store = G4LogicalVolumeStore::GetInstance();
+   std::map<int, std::string>::iterator opt;
+   for (opt = shower_opts.begin(); opt != shower_opts.end(); ++opt) {
+      std::vector<std::string> fields;
+      std::string arg(opt->second);
+      size_t start = 0;
+      size_t colon;
+      while ((colon = arg.find(':', start)) != arg.npos) {
+         fields.push_back(arg.substr(start, colon - start));
+         start = colon + 1;
+      }
+      fields.push_back(arg.substr(start));
+      double emin = (fields.size() > 1)? atof(fields[1].c_str()) : 0;
+      if (fields.size() > 3 || emin <= 0) {
+         G4cerr << "GlueXFastShowerModel::Prepare warning - "
+                << "entry " << arg << " on the FASTSHOWER card "
+                << "is not of the form 'volume:emin[:material]', "
+                << "continuing without it." << G4endl;
+         continue;
+      }
+      G4LogicalVolume *lvol = 0;
+      G4LogicalVolumeStore::iterator iter;
+      for (iter = store->begin(); iter != store->end(); ++iter) {
+         if ((*iter)->GetName() == fields[0]) {
+            lvol = *iter;
+            break;
+         }
+      }
+      if (lvol == 0) {
+         G4cerr << "GlueXFastShowerModel::Prepare warning - "
+                << "volume " << fields[0] << " on the FASTSHOWER card "
+                << "is not found in the geometry, "
+                << "continuing without it." << G4endl;
+         continue;
+      }
+      envelope_t env;
+      env.volume = fields[0];
+      env.emin = emin * MeV;
+      env.material = 0;
+      if (fields.size() > 2) {
+         env.material = G4Material::GetMaterial(fields[2], false);
+         if (env.material == 0) {
+            G4cerr << "GlueXFastShowerModel::Prepare warning - "
+                   << "material " << fields[2] << " on the FASTSHOWER "
+                   << "card is not defined, continuing with the material "
+                   << "of each shower instead." << G4endl;
+         }
+      }
+      if (lvol->IsRootRegion()) {
+         env.region = lvol->GetRegion();
+      }
+      else {
+         env.region = new G4Region("FASTSHOWER:" + env.volume);
+         env.region->AddRootLogicalVolume(lvol);
+      }
+      fEnvelopes.push_back(env);
+   }
+   if (fEnvelopes.size() == 0)
+      return;
+
+   std::map<int, int> validate_opts;
+   if (user_opts->Find("FASTSHOWERVALIDATE", validate_opts))
+      fValidate = (validate_opts[1] != 0);
+   fShowers = new std::atomic<long>[fEnvelopes.size()];
+   fShowerKeV = new std::atomic<long>[fEnvelopes.size()];
+   validation_t zero = {0, 0, 0, 0};
+   for (unsigned int i=0; i < fEnvelopes.size(); ++i) {
+      fShowers[i] = 0;
+      fShowerKeV[i] = 0;
+      fValidation[kFast].push_back(zero);
+      fValidation[kFull].push_back(zero);
+   }
+
+   G4cout << "GlueXFastShowerModel: parameterising showers";
+   for (unsigned int i=0; i < fEnvelopes.size(); ++i) {
+      G4cout << " above " << fEnvelopes[i].emin / MeV << " MeV in "
+             << fEnvelopes[i].volume << ",";
+   }
+   if (fValidate)
+      G4cout << " in even events only, for validation";
+   G4cout << " see the FASTSHOWER card in control.in" << G4endl;
+}
+
+void GlueXFastShowerModel::Attach()
+{
+   // The models are owned by the fast simulation managers of their
+   // regions for the life of the thread.
+
+   for (unsigned int i=0; i < fEnvelopes.size(); ++i)
+      new GlueXFastShowerModel(i);
+}
+
+bool GlueXFastShowerModel::IsShowering(const G4ParticleDefinition *particle)
+{
+   return (particle == G4Gamma::Definition() ||
+           particle == G4Electron::Definition() ||
+           particle == G4Positron::Definition());
+}
+
+G4bool GlueXFastShowerModel::IsApplicable(const G4ParticleDefinition &particle)
+{
+   return IsShowering(&particle);
+}
+
+G4bool GlueXFastShowerModel::ModelTrigger(const G4FastTrack &fastTrack)
+{
+   if (fFullEvent)
+      return false;
+   const G4Track *track = fastTrack.GetPrimaryTrack();
+   return (track->GetKineticEnergy() >= fEnvelopes[fEnvelope].emin);
+}
+
+void GlueXFastShowerModel::DoIt(const G4FastTrack &fastTrack,
+                                G4FastStep &fastStep)
+{
+   const G4Track *track = fastTrack.GetPrimaryTrack();
+   const G4ParticleDefinition *particle = track->GetDefinition();
+   double energy = track->GetKineticEnergy();
+   if (particle == G4Positron::Definition())
+      energy += 2 * electron_mass_c2;
+
+   // Shower parameters of the medium, with the critical energy taken
+   // from the mass-weighted mean atomic number, as in GFlash.
+
+   const G4Material *mate = fEnvelopes[fEnvelope].material;
+   if (mate == 0)
+      mate = track->GetMaterial();
+   double X0 = mate->GetRadlen();
+   double Z = 0;
+   const G4ElementVector *elements = mate->GetElementVector();
+   const G4double *fractions = mate->GetFractionVector();
+   for (unsigned int i=0; i < mate->GetNumberOfElements(); ++i)
+      Z += fractions[i] * (*elements)[i]->GetZ();
+   double Ec = 610 * MeV / (Z + 1.24);
+   double RM = 21.2052 * MeV * X0 / Ec;
+   double tmax = log(energy / Ec) +
+                 ((particle == G4Gamma::Definition())? 0.5 : -0.5);
+   const double beta = 0.5;
+   double alpha = 1 + beta * ((tmax > 0)? tmax : 0);
+
+   int nspots = (int)(energy / kSpotEnergy) + 1;
+   nspots = (nspots < kMinSpots)? kMinSpots :
+            (nspots > kMaxSpots)? kMaxSpots : nspots;
+   double espot = energy / nspots;
+   G4ThreeVector x0 = track->GetPosition();
+   G4ThreeVector dir = track->GetMomentumDirection();
+   G4ThreeVector u = dir.orthogonal().unit();
+   G4ThreeVector v = dir.cross(u);
+   double t0 = track->GetGlobalTime();
+   for (int n=0; n < nspots; ++n) {
+      double depth = CLHEP::RandGamma::shoot(alpha, beta) * X0;
+      double q = G4UniformRand();
+      double r = (q < 1)? RM / 3 * sqrt(q / (1 - q)) : 0;
+      double phi = twopi * G4UniformRand();
+      G4ThreeVector pos = x0 + dir * depth + (u * cos(phi) + v * sin(phi)) * r;
+      Deposit(track, pos, t0 + depth / c_light, espot);
+   }
+
+   fastStep.KillPrimaryTrack();
+   fastStep.ProposePrimaryTrackPathLength(0);
+   fastStep.ProposeTotalEnergyDeposited(energy);
+   ++fShowers[fEnvelope];
+   fShowerKeV[fEnvelope] += (long)(energy / keV);
+}
+
+void GlueXFastShowerModel::Deposit(const G4Track *track,
+                                   const G4ThreeVector &pos,
+                                   double time, double energy)
+{
+   // Hand the energy of a spot to the sensitive detector of the volume
+   // that it falls in, as a step of zero length by the showering track.
+
+   if (fNavigator->GetWorldVolume() == 0) {
+      G4TransportationManager *tmanager;
+      tmanager = G4TransportationManager::GetTransportationManager();
+      fNavigator->SetWorldVolume(tmanager->GetNavigatorForTracking()
+                                         ->GetWorldVolume());
+   }
+   fNavigator->LocateGlobalPointAndUpdateTouchable(pos, fTouchable(), false);
+   G4VPhysicalVolume *pvol = fTouchable->GetVolume();
+   if (pvol == 0)
+      return;
+   G4LogicalVolume *lvol = pvol->GetLogicalVolume();
+   G4VSensitiveDetector *sd = lvol->GetSensitiveDetector();
+   if (sd == 0)
+      return;
+   G4StepPoint *points[2] = {fSpotStep->GetPreStepPoint(),
+                             fSpotStep->GetPostStepPoint()};
+   for (int i=0; i < 2; ++i) {
+      points[i]->SetPosition(pos);
+      points[i]->SetGlobalTime(time);
+      points[i]->SetTouchableHandle(fTouchable);
+      points[i]->SetMaterial(lvol->GetMaterial());
+      points[i]->SetSensitiveDetector(sd);
+      points[i]->SetKineticEnergy(0);
+   }
+   fSpotStep->SetTrack(const_cast<G4Track*>(track));
+   fSpotStep->SetStepLength(0);
+   fSpotStep->SetTotalEnergyDeposit(energy);
+   sd->Hit(fSpotStep);
+
+   // In validation mode the spots count for what they put into the
+   // sensitive volumes of the envelope, as the steps of full showers do.
+   if (fTally && lvol->GetRegion() == fEnvelopes[fEnvelope].region)
+      fTally->deposited[fEnvelope] += energy;
+}
+
+int GlueXFastShowerModel::FindEnvelope(const G4Step *step)
+{
+   G4VPhysicalVolume *pvol = step->GetPreStepPoint()->GetPhysicalVolume();
+   if (pvol == 0)
+      return -1;
+   G4Region *region = pvol->GetLogicalVolume()->GetRegion();
+   for (unsigned int i=0; i < fEnvelopes.size(); ++i) {
+      if (fEnvelopes[i].region == region)
+         return i;
+   }
+   return -1;
+}
+
+void GlueXFastShowerModel::BeginOfEvent(const G4Event *event)
+{
+   if (! fValidate)
+      return;
+   fFullEvent = (event->GetEventID() % 2 != 0);
+   if (fTally == 0)
+      fTally = new event_tally_t;
+   fTally->mode = (fFullEvent)? kFull : kFast;
+   fTally->cpu0 = thread_cpu_seconds();
+   fTally->incident.assign(fEnvelopes.size(), 0);
+   fTally->deposited.assign(fEnvelopes.size(), 0);
+   fTally->steps.assign(fEnvelopes.size(), 0);
+   fTally->showerTracks.clear();
+}
+
+void GlueXFastShowerModel::ProcessStep(const G4Step *step)
+{
+   // Sum the energy deposited in the sensitive volumes of each envelope,
+   // and the energy of the showering particles reaching it, leaving out
+   // their descendants, which the model would never have seen. The step
+   // that hands a particle to the model proposes all of its energy as
+   // deposited, so that is left out as well, and the spots of the shower
+   // are counted as they are placed instead, see Deposit.
+
+   if (! fValidate || fTally == 0)
+      return;
+   const G4Track *track = step->GetTrack();
+   int id = track->GetTrackID();
+   bool counted = (fTally->showerTracks.count(id) > 0);
+   if (! counted && fTally->showerTracks.count(track->GetParentID()) > 0) {
+      fTally->showerTracks.insert(id);
+      counted = true;
+   }
+   int env = FindEnvelope(step);
+   if (env < 0)
+      return;
+   const G4StepPoint *pre = step->GetPreStepPoint();
+   const G4VProcess *process = step->GetPostStepPoint()->
+                                     GetProcessDefinedStep();
+   if ((process == 0 || process->GetProcessType() != fParameterisation) &&
+       pre->GetPhysicalVolume()->GetLogicalVolume()->GetSensitiveDetector())
+   {
+      fTally->deposited[env] += step->GetTotalEnergyDeposit();
+   }
+   ++fTally->steps[env];
+   const G4ParticleDefinition *particle = track->GetDefinition();
+   double ekin = pre->GetKineticEnergy();
+   if (! counted && ekin >= fEnvelopes[env].emin &&
+       IsShowering(particle))
+   {
+      if (particle == G4Positron::Definition())
+         ekin += 2 * electron_mass_c2;
+      fTally->incident[env] += ekin;
+      fTally->showerTracks.insert(id);
+   }
+}
+
+void GlueXFastShowerModel::EndOfEvent()
+{
+   if (! fValidate || fTally == 0)
+      return;
+   double cpu = thread_cpu_seconds() - fTally->cpu0;
+   G4AutoLock barrier(&fMutex);
+   int mode = fTally->mode;
+   fValidationCpu[mode] += cpu;
+   ++fValidationEvents[mode];
+   for (unsigned int i=0; i < fEnvelopes.size(); ++i) {
+      if (fTally->incident[i] > 0) {
+         double ratio = fTally->deposited[i] / fTally->incident[i];
+         validation_t &val = fValidation[mode][i];
+         ++val.events;
+         val.sumRatio += ratio;
+         val.sumRatio2 += ratio * ratio;
+         val.steps += fTally->steps[i];
+      }
+   }
+}
+
+void GlueXFastShowerModel::PrintStatistics()
+{
+   if (! IsEnabled())
+      return;
+   G4cout << "GlueXFastShowerModel:";
+   for (unsigned int i=0; i < fEnvelopes.size(); ++i) {
+      G4cout << " " << fShowers[i] << " showers of "
+             << fShowerKeV[i] * 1e-6 << " GeV in " << fEnvelopes[i].volume
+             << ((i + 1 < fEnvelopes.size())? "," : "");
+   }
+   G4cout << " parameterised" << G4endl;
+   if (! fValidate)
+      return;
+
+   const char *modes[2] = {"fast", "full"};
+   G4AutoLock barrier(&fMutex);
+   for (unsigned int i=0; i < fEnvelopes.size(); ++i) {
+      G4cout << "GlueXFastShowerModel: validation in "
+             << fEnvelopes[i].volume;
+      for (int mode=0; mode < 2; ++mode) {
+         const validation_t &val = fValidation[mode][i];
+         double mean = 0;
+         double rms = 0;
+         double steps = 0;
+         if (val.events > 0) {
+            mean = val.sumRatio / val.events;
+            rms = sqrt(fabs(val.sumRatio2 / val.events - mean * mean));
+            steps = val.steps / val.events;
+         }
+         G4cout << ((mode > 0)? "," : "") << " " << modes[mode] << " "
+                << val.events << " events, deposited/incident energy "
+                << mean << " +/- " << rms << ", " << steps
+                << " steps per event";
+      }
+      G4cout << G4endl;
+   }
+   G4cout << "GlueXFastShowerModel: cpu per event";
+   for (int mode=0; mode < 2; ++mode) {
+      double cpu = (fValidationEvents[mode] > 0)?
+                   fValidationCpu[mode] / fValidationEvents[mode] : 0;
+      G4cout << " " << cpu << " s " << modes[mode]
+             << ((mode == 0)? "," : "");
+   }
+   G4cout << G4endl;
+}
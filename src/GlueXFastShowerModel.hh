@@ -0,0 +1,146 @@
+//
+// GlueXFastShowerModel - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Fast simulation model that replaces the full tracking of electromagnetic
+// showers in the calorimeters by a parameterisation, since the many soft
+// steps of the showers in BCAL and FCAL take most of the time of a
+// photoproduction event. It is enabled by the FASTSHOWER card in
+// control.in, where each argument takes the form
+//
+//    'vol:emin[:material]'
+//
+// naming a logical volume to serve as the envelope of the model, the
+// minimum kinetic energy in MeV of the photons, electrons and positrons
+// that are handed over to it, and optionally the material to take the
+// shower parameters from. The envelope is made a root of a G4Region of
+// its own, unless it is already the root of one, and one model instance
+// is attached to each envelope region in each thread. Showers start
+// wherever a particle over the threshold is found inside the envelope.
+//
+// The parameterisation is that of GFlash for homogeneous media: each
+// shower is spread over a number of energy spots, with the depth of
+// each spot along the direction of the particle sampled from a gamma
+// distribution, in radiation lengths, peaking at ln(E/Ec) - 0.5 for
+// electrons and ln(E/Ec) + 0.5 for photons, with a slope of 0.5, and its
+// distance from the axis sampled from 2 r R^2 / (r^2 + R^2)^2 with
+// R = RM/3, so that 90% of the energy is within one Moliere radius RM.
+// Without a material on the card, the parameters are taken from the
+// material in which the particle is found. The energy of each spot is
+// handed to the sensitive detector of the volume it falls in through a
+// step of zero length, just as if a track had deposited it there, so
+// the model needs nothing from the sensitive detectors that it feeds.
+//
+// With the FASTSHOWERVALIDATE card, the model is only applied in events
+// with an even event number, and the events with odd numbers are fully
+// simulated, so that the two can be compared in the same job. For each
+// event and envelope, the ratio of the energy deposited in the sensitive
+// volumes of the envelope, by the steps of the full showers or by the
+// spots of the fast ones, to the energy of the showering particles that
+// reached it is taken, counting each particle only if none of its
+// ancestors was counted, and its mean and spread, the number of steps
+// taken in the envelope and the cpu time per event are printed for the
+// two halves at the end of the run.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "thread-local", ie. has thread-local state. Separate
+// model instances are created for each worker thread. The envelopes are
+// set up once by the master, and the statistics are shared.
+
+#ifndef GlueXFastShowerModel_h
+#define GlueXFastShowerModel_h 1
+
+#include "G4VFastSimulationModel.hh"
+#include "G4Navigator.hh"
+#include "G4TouchableHandle.hh"
+#include "G4Region.hh"
+#include "G4Material.hh"
+#include "G4Event.hh"
+#include "G4Step.hh"
+#include "G4Threading.hh"
+
+#include <string>
+#include <vector>
+#include <set>
+#include <atomic>
+
+class GlueXFastShowerModel : public G4VFastSimulationModel
+{
+ public:
+   GlueXFastShowerModel(int envelope);
+   virtual ~GlueXFastShowerModel();
+
+   virtual G4bool IsApplicable(const G4ParticleDefinition &particle);
+   virtual G4bool ModelTrigger(const G4FastTrack &fastTrack);
+   virtual void DoIt(const G4FastTrack &fastTrack, G4FastStep &fastStep);
+
+   // Read the cards and set up the envelope regions, to be called by
+   // the master during detector construction, before the physics.
+   static void Prepare();
+   // Create the model instances of the calling thread.
+   static void Attach();
+
+   static bool IsEnabled() {
+      return fEnvelopes.size() > 0;
+   }
+
+   // hooks for the validation mode, called from the user actions
+   static void BeginOfEvent(const G4Event *event);
+   static void ProcessStep(const G4Step *step);
+   static void EndOfEvent();
+
+   static void PrintStatistics();
+
+ private:
+   GlueXFastShowerModel(const GlueXFastShowerModel &src);
+   GlueXFastShowerModel &operator=(const GlueXFastShowerModel &src);
+
+   static bool IsShowering(const G4ParticleDefinition *particle);
+   void Deposit(const G4Track *track, const G4ThreeVector &pos,
+                double time, double energy);
+
+   int fEnvelope;
+   G4Navigator *fNavigator;
+   G4TouchableHandle fTouchable;
+   G4Step *fSpotStep;
+
+   struct envelope_t {
+      std::string volume;
+      G4Region *region;
+      double emin;
+      const G4Material *material;  // or 0 to take it from the track
+   };
+   static std::vector<envelope_t> fEnvelopes;
+   static std::atomic<long> *fShowers;       // per envelope
+   static std::atomic<long> *fShowerKeV;     // per envelope
+   static int FindEnvelope(const G4Step *step);
+
+   // validation mode sums, per envelope, for kFast and kFull events
+   enum { kFast, kFull };
+   struct validation_t {
+      long events;
+      double sumRatio;
+      double sumRatio2;
+      double steps;
+   };
+   static bool fValidate;
+   static std::vector<validation_t> fValidation[2];
+   static double fValidationCpu[2];
+   static long fValidationEvents[2];
+   static G4Mutex fMutex;
+
+   struct event_tally_t {
+      int mode;
+      double cpu0;
+      std::vector<double> incident;
+      std::vector<double> deposited;
+      std::vector<long> steps;
+      std::set<int> showerTracks;
+   };
+   static G4ThreadLocal event_tally_t *fTally;
+   static G4ThreadLocal bool fFullEvent;
+};
+
+#endif
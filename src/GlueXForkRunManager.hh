@@ -0,0 +1,53 @@
+//
+// GlueXForkRunManager - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Run manager for the fork mode of hdgeant4, derived from the run
+// manager given as the template argument. This is always G4RunManager,
+// even in multithreaded builds, because the threads of a G4MTRunManager
+// are started by Initialize, before the workers are forked, and the
+// forked workers would have no copies of them. Each /run/beamOn
+// first initializes the run in the main process without any events,
+// so that the physics tables are built before the workers are forked,
+// and then has GlueXProcessPool fork the workers, each of which runs
+// its share of the events and exits. Without the -f option it behaves
+// the same as the run manager it is derived from.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state.
+
+#ifndef _GlueXForkRunManager_
+#define _GlueXForkRunManager_
+
+#include <G4Run.hh>
+
+#include <GlueXProcessPool.hh>
+
+template <class RunManager>
+class GlueXForkRunManager : public RunManager
+{
+ public:
+
+   GlueXForkRunManager() {}
+   virtual ~GlueXForkRunManager() {}
+
+   virtual void BeamOn(G4int n_event, const char *macroFile=0,
+                       G4int n_select=-1)
+   {
+      if (GlueXProcessPool::GetProcessCount() == 0 || n_event <= 0) {
+         RunManager::BeamOn(n_event, macroFile, n_select);
+         return;
+      }
+      RunManager::BeamOn(0);
+      long int count;
+      if (GlueXProcessPool::Fork(n_event, count)) {
+         RunManager::BeamOn(count, macroFile, n_select);
+         const G4Run *run = this->GetCurrentRun();
+         GlueXProcessPool::Exit((run)? run->GetNumberOfEvent() : 0);
+      }
+   }
+};
+
+#endif // _GlueXForkRunManager_
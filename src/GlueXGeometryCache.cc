@@ -0,0 +1,582 @@
+//
+// GlueXGeometryCache - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXGeometryCache.hh"
+#include "GlueXUserOptions.hh"
+
+#include "G4GDMLParser.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4PVPlacement.hh"
+#include "G4Box.hh"
+#include "G4VisAttributes.hh"
+#include "G4Colour.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Version.hh"
+#include "G4ios.hh"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <vector>
+#include <set>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <libgen.h>
+
+const int kCacheVersion = 3;
+
+static void fnv1a(unsigned long long int &hash, const char *data, size_t n)
+{
+   for (size_t i=0; i < n; ++i) {
+      hash ^= (unsigned char)data[i];
+      hash *= 1099511628211ULL;
+   }
+}
+
+static void write_string(std::ostream &out, const std::string &str)
+{
+   // strings are written with their length in front, so that they
+   // may contain spaces or be empty
+
+   out << str.size() << " " << str << " ";
+}
+
+static bool read_string(std::istream &in, std::string &str)
+{
+   size_t len;
+   if (! (in >> len) || in.get() != ' ')
+      return false;
+   str.resize(len);
+   return (len == 0 || in.read(&str[0], len));
+}
+
+static void find_volumes(G4LogicalVolume *lvol,
+                         std::set<G4LogicalVolume*> &found)
+{
+   // collect lvol and all of the logical volumes placed inside it
+
+   if (! found.insert(lvol).second)
+      return;
+   for (int child = 0; child < (int)lvol->GetNoDaughters(); ++child)
+      find_volumes(lvol->GetDaughter(child)->GetLogicalVolume(), found);
+}
+
+struct volume_record_t {
+   std::string name;
+   int volId;
+   int layer;
+   int sensitive;
+   int region;                   // -1 for no field manager
+   int limits;                   // -1 if not a root of a G4Region
+   int unfilled;                 // 1 if the volume has no material
+   double smartless;             // voxel quality factor
+   int hasvis;
+   int visible;
+   double rgba[4];
+};
+
+std::string GlueXGeometryCache::GetKey(const std::string &hddsFile)
+{
+   // The key covers the names and contents of all of the .xml files
+   // in the directory of the top-level document, taken in the order
+   // of their names, along with the versions of the cache format and
+   // of Geant4, which writes and reads the GDML, and the SUBSYSOMIT
+   // and SUBSYSENVELOPE cards, which change what is translated.
+
+   std::vector<char> path(hddsFile.begin(), hddsFile.end());
+   path.push_back(0);
+   std::string topfile(basename(&path[0]));
+   path.assign(hddsFile.begin(), hddsFile.end());
+   path.push_back(0);
+   std::string topdir(dirname(&path[0]));
+   DIR *dirp = opendir(topdir.c_str());
+   if (dirp == 0)
+      return "";
+   std::vector<std::string> names;
+   struct dirent *entry;
+   while ((entry = readdir(dirp)) != 0) {
+      std::string name(entry->d_name);
+      if (name.size() > 4 && name.substr(name.size() - 4) == ".xml")
+         names.push_back(name);
+   }
+   closedir(dirp);
+   std::sort(names.begin(), names.end());
+
+   unsigned long long int hash = 14695981039346656037ULL;
+   std::vector<char> buffer(1 << 16);
+   for (unsigned int i=0; i < names.size(); ++i) {
+      std::string filename(topdir + "/" + names[i]);
+      std::ifstream fin(filename.c_str(), std::ios::binary);
+      if (! fin.is_open())
+         return "";
+      fnv1a(hash, names[i].c_str(), names[i].size() + 1);
+      while (fin.read(&buffer[0], buffer.size()) || fin.gcount() > 0)
+         fnv1a(hash, &buffer[0], fin.gcount());
+   }
+
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   const char *cards[] = {"SUBSYSOMIT", "SUBSYSENVELOPE"};
+   for (int c=0; c < 2 && user_opts; ++c) {
+      std::map<int, std::string> card_opts;
+      std::map<int, std::string>::iterator opt;
+      if (user_opts->Find(cards[c], card_opts)) {
+         fnv1a(hash, cards[c], strlen(cards[c]) + 1);
+         for (opt = card_opts.begin(); opt != card_opts.end(); ++opt)
+            fnv1a(hash, opt->second.c_str(), opt->second.size() + 1);
+      }
+   }
+
+   std::stringstream key;
+   key << "GlueXGeometryCache version " << kCacheVersion
+       << " geant4 " << G4VERSION_NUMBER
+       << " hdds " << topfile << " files " << names.size()
+       << " hash " << std::hex << std::setw(16) << std::setfill('0')
+       << hash;
+   return key.str();
+}
+
+std::string GlueXGeometryCache::CacheName(const std::string &cachedir,
+                                          const std::string &key,
+                                          const std::string &ext)
+{
+   unsigned long long int hash = 14695981039346656037ULL;
+   fnv1a(hash, key.c_str(), key.size());
+   std::stringstream name;
+   name << cachedir << "/hdds_geometry_"
+        << std::hex << std::setw(16) << std::setfill('0') << hash << ext;
+   return name.str();
+}
+
+bool GlueXGeometryCache::Save(HddsG4Builder &builder,
+                              const std::string &cachedir,
+                              const std::string &key)
+{
+   // Write the GDML file first and the file holding the rest of the
+   // builder state last, each one under a temporary name that is only
+   // renamed once it is complete, so that other jobs sharing the cache
+   // never see a partial entry. Jobs look for the second file first.
+
+   typedef HddsG4Builder::vpair_t vpair_t;
+   std::map<vpair_t,G4LogicalVolume*>::iterator iter;
+
+   // Only the volumes that are placed somewhere under a world volume
+   // are written to the GDML, where they are found by name when it is
+   // read back, so their names must be unique.
+
+   std::vector<G4LogicalVolume*> worlds;
+   std::set<G4LogicalVolume*> placed;
+   for (iter = builder.fLogicalVolumes.lower_bound(
+                                       vpair_t(builder.fWorldVolume,0));
+        iter != builder.fLogicalVolumes.end() &&
+        iter->first.first == builder.fWorldVolume;
+        ++iter)
+   {
+      worlds.push_back(iter->second);
+      find_volumes(iter->second, placed);
+   }
+   std::set<std::string> names;
+   G4Material *filler = 0;
+   for (iter = builder.fLogicalVolumes.begin();
+        iter != builder.fLogicalVolumes.end(); ++iter)
+   {
+      if (placed.find(iter->second) == placed.end())
+         continue;
+      if (! names.insert(iter->second->GetName()).second) {
+         G4cerr << "GlueXGeometryCache::Save warning - "
+                << "volume name " << iter->second->GetName()
+                << " is not unique, continuing without the cache."
+                << G4endl;
+         return false;
+      }
+      if (filler == 0)
+         filler = iter->second->GetMaterial();
+   }
+   if (worlds.size() == 0 || filler == 0 || names.size() != placed.size()) {
+      G4cerr << "GlueXGeometryCache::Save warning - "
+             << "geometry has volumes unknown to the builder, "
+             << "continuing without the cache." << G4endl;
+      return false;
+   }
+
+   std::string gdmlfile = CacheName(cachedir, key, ".gdml");
+   std::string datfile = CacheName(cachedir, key, ".dat");
+   std::stringstream tmpname;
+   tmpname << ".tmp" << getpid();
+   std::string tmpgdml = CacheName(cachedir, key, tmpname.str() + ".gdml");
+   std::string tmpdat = CacheName(cachedir, key, tmpname.str() + ".dat");
+   std::ofstream fout(tmpdat.c_str());
+   if (! fout.is_open()) {
+      G4cerr << "GlueXGeometryCache::Save warning - "
+             << "unable to write cache file " << tmpdat
+             << ", continuing without it." << G4endl;
+      return false;
+   }
+
+   // GDML can only write a single world, so the world volumes of all
+   // of the layers are placed inside a temporary container for the
+   // purpose. Volumes without a material, the ones that are reflected
+   // onto other layers, are given one for the time being because GDML
+   // requires it, and are marked as unfilled in the state file.
+
+   std::vector<G4LogicalVolume*> unfilled;
+   std::set<G4LogicalVolume*>::iterator piter;
+   for (piter = placed.begin(); piter != placed.end(); ++piter) {
+      if ((*piter)->GetMaterial() == 0) {
+         unfilled.push_back(*piter);
+         (*piter)->SetMaterial(filler);
+      }
+   }
+   G4Box *box = new G4Box("GlueXGeometryCache", 1*km, 1*km, 1*km);
+   G4LogicalVolume *container = new G4LogicalVolume(box, filler,
+                                                    "GlueXGeometryCache");
+   std::vector<G4VPhysicalVolume*> layers;
+   for (unsigned int i=0; i < worlds.size(); ++i) {
+      layers.push_back(new G4PVPlacement(0, G4ThreeVector(), worlds[i],
+                                         worlds[i]->GetName(),
+                                         container, false, i));
+   }
+   unlink(tmpgdml.c_str());
+   G4GDMLParser parser;
+   parser.Write(tmpgdml, container, true);
+   for (unsigned int i=0; i < layers.size(); ++i) {
+      container->RemoveDaughter(layers[i]);
+      delete layers[i];
+   }
+   delete container;
+   delete box;
+   for (unsigned int i=0; i < unfilled.size(); ++i)
+      unfilled[i]->SetMaterial(0);
+
+   fout << key << std::endl << std::setprecision(17);
+   write_string(fout, last_md5_checksum);
+   fout << builder.fWorldVolume << std::endl
+        << "volumes " << placed.size() << std::endl;
+   for (iter = builder.fLogicalVolumes.begin();
+        iter != builder.fLogicalVolumes.end(); ++iter)
+   {
+      G4LogicalVolume *lvol = iter->second;
+      if (placed.find(lvol) == placed.end())
+         continue;
+      std::map<int,G4LogicalVolume*>::iterator sens;
+      sens = builder.fSensitiveVolumes.find(iter->first.first);
+      int sensitive = (sens != builder.fSensitiveVolumes.end() &&
+                       sens->second == lvol);
+      int region = -1;
+      std::map<int,G4FieldManager*>::iterator miter;
+      for (miter = builder.fFieldManagers.begin();
+           miter != builder.fFieldManagers.end(); ++miter)
+      {
+         if (miter->second != 0 && miter->second == lvol->GetFieldManager())
+            region = miter->first;
+      }
+      int limits = -1;
+      std::map<int,G4Region*>::iterator giter;
+      for (giter = builder.fRegions.begin();
+           giter != builder.fRegions.end(); ++giter)
+      {
+         if (lvol->IsRootRegion() && giter->second == lvol->GetRegion())
+            limits = giter->first;
+      }
+      const G4VisAttributes *vis = lvol->GetVisAttributes();
+      write_string(fout, lvol->GetName());
+      fout << iter->first.first << " " << iter->first.second << " "
+           << sensitive << " " << region << " " << limits << " "
+           << (lvol->GetMaterial() == 0) << " " << lvol->GetSmartless()
+           << " " << (vis != 0);
+      if (vis != 0) {
+         G4Colour colour(vis->GetColour());
+         fout << " " << vis->IsVisible()
+              << " " << colour.GetRed() << " " << colour.GetGreen()
+              << " " << colour.GetBlue() << " " << colour.GetAlpha();
+      }
+      fout << std::endl;
+   }
+
+   fout << "regions " << builder.fRegionFields.size() << std::endl;
+   std::map<int,HddsG4Builder::region_field_t>::iterator riter;
+   for (riter = builder.fRegionFields.begin();
+        riter != builder.fRegionFields.end(); ++riter)
+   {
+      const HddsG4Builder::region_field_t &field = riter->second;
+      fout << riter->first << " ";
+      write_string(fout, builder.fRegionNames[riter->first]);
+      fout << field.type << " " << field.B[0] << " " << field.B[1] << " "
+           << field.B[2] << " " << field.unit;
+      for (int i=0; i < 9; ++i)
+         fout << " " << field.R[i];
+      for (int i=0; i < 3; ++i)
+         fout << " " << field.O[i];
+      fout << " ";
+      write_string(fout, field.function);
+      write_string(fout, field.method);
+      fout << field.maxArcStep << " ";
+      write_string(fout, field.tune.stepper);
+      fout << field.tune.minStep << " " << field.tune.deltaChord << " "
+           << field.tune.deltaIntersection << " "
+           << field.tune.deltaOneStep;
+      for (int i=0; i < 4; ++i)
+         fout << " " << field.limits.cuts[i];
+      fout << " " << field.limits.maxStep << " " << field.limits.minEkin
+           << " " << field.limits.maxTime << " "
+           << field.grids.size() << std::endl;
+      for (unsigned int g=0; g < field.grids.size(); ++g) {
+         const HddsG4Builder::field_grid_t &grid = field.grids[g];
+         fout << grid.cylindrical;
+         for (int i=0; i < 4; ++i)
+            fout << " " << grid.samples[i] << " " << grid.order[i]
+                 << " " << grid.sense[i] << " " << grid.lower[i]
+                 << " " << grid.upper[i];
+         fout << std::endl;
+      }
+      write_string(fout, field.mapfile);
+      fout << std::endl;
+   }
+
+   fout << "identifiers " << Refsys::fIdentifierTable.size() << std::endl;
+   std::map<int, std::map<std::string, std::vector<int> > >::iterator volume;
+   for (volume = Refsys::fIdentifierTable.begin();
+        volume != Refsys::fIdentifierTable.end(); ++volume)
+   {
+      fout << volume->first << " " << volume->second.size() << std::endl;
+      std::map<std::string, std::vector<int> >::iterator ident;
+      for (ident = volume->second.begin();
+           ident != volume->second.end(); ++ident)
+      {
+         write_string(fout, ident->first);
+         fout << ident->second.size();
+         for (unsigned int i=0; i < ident->second.size(); ++i)
+            fout << " " << ident->second[i];
+         fout << std::endl;
+      }
+   }
+   fout << "end" << std::endl;
+   fout.close();
+
+   if (! fout || rename(tmpgdml.c_str(), gdmlfile.c_str()) != 0 ||
+                 rename(tmpdat.c_str(), datfile.c_str()) != 0)
+   {
+      G4cerr << "GlueXGeometryCache::Save warning - "
+             << "unable to replace cache file " << datfile
+             << ", continuing without it." << G4endl;
+      unlink(tmpgdml.c_str());
+      unlink(tmpdat.c_str());
+      return false;
+   }
+   return true;
+}
+
+bool GlueXGeometryCache::Load(HddsG4Builder &builder,
+                              const std::string &cachedir,
+                              const std::string &key)
+{
+   // Everything in the state file is read and checked before the GDML
+   // is read, because once GDML has added the volumes to the Geant4
+   // stores there is no going back to building the geometry from hdds.
+
+   typedef HddsG4Builder::vpair_t vpair_t;
+   std::string gdmlfile = CacheName(cachedir, key, ".gdml");
+   std::string datfile = CacheName(cachedir, key, ".dat");
+   std::ifstream fin(datfile.c_str());
+   if (! fin.is_open())
+      return false;
+   std::string filekey;
+   std::getline(fin, filekey);
+   if (filekey != key)
+      return false;
+
+   std::string md5;
+   std::string tag;
+   int world;
+   unsigned int nvolumes = 0;
+   bool good = (read_string(fin, md5) &&
+                fin >> world >> tag >> nvolumes && tag == "volumes");
+   std::vector<volume_record_t> volumes(good? nvolumes : 0);
+   for (unsigned int v=0; good && v < nvolumes; ++v) {
+      volume_record_t &rec = volumes[v];
+      good = (read_string(fin, rec.name) &&
+              fin >> rec.volId >> rec.layer >> rec.sensitive >> rec.region
+                  >> rec.limits >> rec.unfilled >> rec.smartless >> rec.hasvis);
+      if (good && rec.hasvis) {
+         good = ! (fin >> rec.visible >> rec.rgba[0] >> rec.rgba[1]
+                      >> rec.rgba[2] >> rec.rgba[3]).fail();
+      }
+   }
+
+   unsigned int nregions = 0;
+   good = (good && fin >> tag >> nregions && tag == "regions");
+   std::map<int,std::string> regionNames;
+   std::map<int,HddsG4Builder::region_field_t> regionFields;
+   for (unsigned int r=0; good && r < nregions; ++r) {
+      int iregion;
+      unsigned int ngrids;
+      HddsG4Builder::region_field_t field;
+      good = (fin >> iregion && read_string(fin, regionNames[iregion]) &&
+              fin >> field.type >> field.B[0] >> field.B[1] >> field.B[2]
+                  >> field.unit);
+      for (int i=0; good && i < 9; ++i)
+         good = ! (fin >> field.R[i]).fail();
+      for (int i=0; good && i < 3; ++i)
+         good = ! (fin >> field.O[i]).fail();
+      good = (good && read_string(fin, field.function) &&
+              read_string(fin, field.method) && fin >> field.maxArcStep &&
+              read_string(fin, field.tune.stepper) &&
+              fin >> field.tune.minStep >> field.tune.deltaChord
+                  >> field.tune.deltaIntersection >> field.tune.deltaOneStep);
+      for (int i=0; good && i < 4; ++i)
+         good = ! (fin >> field.limits.cuts[i]).fail();
+      good = (good && fin >> field.limits.maxStep >> field.limits.minEkin
+                          >> field.limits.maxTime >> ngrids);
+      for (unsigned int g=0; good && g < ngrids; ++g) {
+         HddsG4Builder::field_grid_t grid;
+         good = ! (fin >> grid.cylindrical).fail();
+         for (int i=0; good && i < 4; ++i) {
+            good = ! (fin >> grid.samples[i] >> grid.order[i]
+                         >> grid.sense[i] >> grid.lower[i]
+                         >> grid.upper[i]).fail();
+         }
+         field.grids.push_back(grid);
+      }
+      good = (good && read_string(fin, field.mapfile));
+      regionFields[iregion] = field;
+   }
+
+   unsigned int nidents = 0;
+   good = (good && fin >> tag >> nidents && tag == "identifiers");
+   std::map<int, std::map<std::string, std::vector<int> > > identifiers;
+   for (unsigned int n=0; good && n < nidents; ++n) {
+      int volId;
+      unsigned int nkeys = 0;
+      good = ! (fin >> volId >> nkeys).fail();
+      for (unsigned int k=0; good && k < nkeys; ++k) {
+         std::string ident;
+         unsigned int nvalues = 0;
+         good = (read_string(fin, ident) && fin >> nvalues);
+         std::vector<int> &values = identifiers[volId][ident];
+         values.resize(good? nvalues : 0);
+         for (unsigned int i=0; good && i < nvalues; ++i)
+            good = ! (fin >> values[i]).fail();
+      }
+   }
+   good = (good && fin >> tag && tag == "end");
+
+   std::ifstream gdmlin(gdmlfile.c_str());
+   if (! good || ! gdmlin.is_open()) {
+      G4cerr << "GlueXGeometryCache::Load warning - "
+             << "cache file " << datfile << " is incomplete, "
+             << "continuing without it." << G4endl;
+      return false;
+   }
+   gdmlin.close();
+
+   // Read the GDML and take the world volumes of the layers back out
+   // of the temporary container they were written in.
+
+   G4GDMLParser parser;
+   parser.Read(gdmlfile, false);
+   G4VPhysicalVolume *top = parser.GetWorldVolume();
+   G4LogicalVolume *container = top->GetLogicalVolume();
+   delete top;
+   std::set<G4LogicalVolume*> placed;
+   for (int child = 0; child < (int)container->GetNoDaughters(); ++child)
+      find_volumes(container->GetDaughter(child)->GetLogicalVolume(), placed);
+   while (container->GetNoDaughters() > 0) {
+      G4VPhysicalVolume *pvol = container->GetDaughter(0);
+      container->RemoveDaughter(pvol);
+      delete pvol;
+   }
+   G4VSolid *box = container->GetSolid();
+   delete container;
+   delete box;
+
+   std::map<std::string,G4LogicalVolume*> byname;
+   std::set<G4LogicalVolume*>::iterator piter;
+   for (piter = placed.begin(); piter != placed.end(); ++piter)
+      byname[(*piter)->GetName()] = *piter;
+   bool matched = (byname.size() == volumes.size());
+   for (unsigned int v=0; v < volumes.size(); ++v) {
+      if (byname.find(volumes[v].name) == byname.end())
+         matched = false;
+   }
+   if (! matched) {
+      G4cerr << "GlueXGeometryCache::Load error - "
+             << "geometry in cache file " << gdmlfile
+             << " does not match " << datfile << ", "
+             << "remove them and try again." << G4endl;
+      exit(-1);
+   }
+
+   // Restore the state of the builder, rebuilding the magnetic fields,
+   // field managers and G4Regions of the regions from their descriptions.
+
+   builder.fWorldVolume = world;
+   last_md5_checksum = md5;
+   Refsys::fIdentifierTable = identifiers;
+   builder.fRegionNames = regionNames;
+   builder.fRegionFields = regionFields;
+   std::map<int,HddsG4Builder::region_field_t>::iterator riter;
+   for (riter = regionFields.begin(); riter != regionFields.end(); ++riter) {
+      builder.createRegionField(riter->first, riter->second);
+      builder.createRegionLimits(riter->first, riter->second.limits);
+      if (riter->second.type == HddsG4Builder::kMappedBfield &&
+          riter->second.mapfile.size() > 0)
+      {
+         builder.createRegionMaps(riter->first, riter->second);
+      }
+   }
+
+   std::map<G4LogicalVolume*,vpair_t> volIds;
+   for (unsigned int v=0; v < volumes.size(); ++v) {
+      const volume_record_t &rec = volumes[v];
+      G4LogicalVolume *lvol = byname[rec.name];
+      volIds[lvol] = vpair_t(rec.volId, rec.layer);
+      builder.fLogicalVolumes[vpair_t(rec.volId, rec.layer)] = lvol;
+      builder.indexVolume(vpair_t(rec.volId, rec.layer), lvol);
+      if (rec.sensitive)
+         builder.fSensitiveVolumes[rec.volId] = lvol;
+      if (rec.unfilled)
+         lvol->SetMaterial(0);
+      lvol->SetSmartless(rec.smartless);
+      if (rec.region >= 0)
+         lvol->SetFieldManager(builder.fFieldManagers[rec.region], false);
+      if (rec.limits >= 0 &&
+          builder.fRegions.find(rec.limits) != builder.fRegions.end())
+      {
+         builder.fRegions[rec.limits]->AddRootLogicalVolume(lvol);
+      }
+      if (rec.hasvis) {
+         G4Colour colour(rec.rgba[0], rec.rgba[1], rec.rgba[2], rec.rgba[3]);
+         lvol->SetVisAttributes(new G4VisAttributes(rec.visible, colour));
+      }
+   }
+
+   // The table of physical volumes holds the first placement of each
+   // copy of a volume on layer 0, as it did when built from hdds.
+
+   std::map<vpair_t,G4LogicalVolume*>::iterator iter;
+   for (iter = builder.fLogicalVolumes.begin();
+        iter != builder.fLogicalVolumes.end(); ++iter)
+   {
+      G4LogicalVolume *lvol = iter->second;
+      for (int child = 0; child < (int)lvol->GetNoDaughters(); ++child) {
+         G4VPhysicalVolume *pvol = lvol->GetDaughter(child);
+         vpair_t ids = volIds[pvol->GetLogicalVolume()];
+         if (ids.second == 0) {
+            vpair_t copy(ids.first, pvol->GetCopyNo());
+            if (builder.fPhysicalVolumes.find(copy) ==
+                builder.fPhysicalVolumes.end())
+            {
+               builder.fPhysicalVolumes[copy] = pvol;
+            }
+         }
+      }
+   }
+   return true;
+}
@@ -0,0 +1,68 @@
+//
+// GlueXGeometryCache - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Cache of the Geant4 model of the detector built by HddsG4Builder,
+// so that jobs can skip parsing and translating the HDDS documents at
+// startup, which takes a large part of the startup time of short jobs.
+// The cache is enabled with the GEOMCACHE card in control.in, naming
+// a directory in which the model is saved the first time that it is
+// built from a given set of HDDS documents. Later jobs using the same
+// documents read it back from there instead.
+//
+// The volumes, solids, materials and placements are saved with GDML, in
+// a single file holding the world volume of every geometry layer. GDML
+// has no place for the rest of the state of the builder, so a second
+// file alongside it holds the hdds volume ids and layers of the logical
+// volumes, their visualization attributes and voxel quality factors,
+// which of them are sensitive, the description of the magnetic field and
+// the production cuts and user limits of every region, and the volume
+// identifier tables of hdds, together with the geometry checksum. The
+// fields and G4Regions are rebuilt from their descriptions when the
+// cache is loaded, so the field maps are read as usual, and SWIMTUNE,
+// REGIONCUTS and REGIONLIMITS cards are honored.
+//
+// The files are named after a hash of the contents of all of the .xml
+// files in the directory of the top-level HDDS document, so that any
+// change to the documents there leads to a new cache entry. The
+// SUBSYSOMIT and SUBSYSENVELOPE cards, which leave parts of the
+// documents out of the model, are included in the hash as well.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. It is only
+// used by the master thread during detector construction.
+
+#ifndef GlueXGeometryCache_h
+#define GlueXGeometryCache_h 1
+
+#include "HddsG4Builder.hh"
+
+#include <string>
+
+class GlueXGeometryCache
+{
+ public:
+   // key identifying the HDDS documents read for the given top-level
+   // document, or an empty string if they cannot be read
+   static std::string GetKey(const std::string &hddsFile);
+
+   // restore the model from the cache in cachedir, returning false
+   // if there is no entry for key
+   static bool Load(HddsG4Builder &builder, const std::string &cachedir,
+                    const std::string &key);
+
+   // save the model into the cache in cachedir under key
+   static bool Save(HddsG4Builder &builder, const std::string &cachedir,
+                    const std::string &key);
+
+ protected:
+   GlueXGeometryCache();
+
+   static std::string CacheName(const std::string &cachedir,
+                                const std::string &key,
+                                const std::string &ext);
+};
+
+#endif
@@ -6,6 +6,9 @@
 
 #include "GlueXHitCDCstraw.hh"
 
+#include <algorithm>
+#include <math.h>
+
 G4ThreadLocal G4Allocator<GlueXHitCDCstraw>* GlueXHitCDCstrawAllocator = 0;
 
 GlueXHitCDCstraw::GlueXHitCDCstraw(G4int ring, G4int sector)
@@ -44,23 +47,67 @@ GlueXHitCDCstraw &GlueXHitCDCstraw::operator+=(const GlueXHitCDCstraw &right)
              << G4endl;
       return *this;
    }
-   std::vector<GlueXHitCDCstraw::hitinfo_t>::iterator hiter = hits.begin();
-   std::vector<GlueXHitCDCstraw::hitinfo_t>::const_iterator hitsrc;
-   for (hitsrc = right.hits.begin(); hitsrc != right.hits.end(); ++hitsrc) {
-      for (; hiter != hits.end(); ++hiter) {
-         if (hiter->t_ns > hitsrc->t_ns)
-            break;
+   std::vector<GlueXHitCDCstraw::hitinfo_t> merged(hits.size() +
+                                                   right.hits.size());
+   std::merge(hits.begin(), hits.end(), right.hits.begin(), right.hits.end(),
+              merged.begin(), earlier);
+   hits.swap(merged);
+   return *this;
+}
+
+void GlueXHitCDCstraw::merge_segments(G4double dz_cm, G4double dt0_ns)
+{
+   // Merge each hit with all of the hits after it in the list whose
+   // track passage time t0 and z are within dt0_ns and dz_cm of its
+   // own, as they come from the same track segment. The candidates
+   // for each hit are found by binary search in a list of the hits
+   // ordered by t0, so the cost is n log(n) instead of n^2 for the
+   // usual case of few hits from any one segment.
+
+   int nhits = hits.size();
+   if (nhits < 2)
+      return;
+   std::vector<std::pair<G4double, int> > by_t0(nhits);
+   for (int ih=0; ih < nhits; ++ih)
+      by_t0[ih] = std::make_pair(hits[ih].t0_ns, ih);
+   std::sort(by_t0.begin(), by_t0.end());
+   std::vector<int> merged(nhits, 0);
+   std::vector<int> group;
+   for (int ih=0; ih < nhits; ++ih) {
+      if (merged[ih])
+         continue;
+      std::vector<std::pair<G4double, int> >::iterator iter;
+      iter = std::lower_bound(by_t0.begin(), by_t0.end(),
+                              std::make_pair(hits[ih].t0_ns - dt0_ns, nhits));
+      group.clear();
+      for (; iter != by_t0.end() && iter->first < hits[ih].t0_ns + dt0_ns;
+           ++iter)
+      {
+         int ih2 = iter->second;
+         if (ih2 > ih && !merged[ih2] &&
+             fabs(hits[ih].z_cm - hits[ih2].z_cm) < dz_cm &&
+             fabs(hits[ih].t0_ns - hits[ih2].t0_ns) < dt0_ns)
+         {
+            group.push_back(ih2);
+         }
+      }
+      std::sort(group.begin(), group.end());
+      for (unsigned int ig=0; ig < group.size(); ++ig) {
+         int ih2 = group[ig];
+         hits[ih].q_fC += hits[ih2].q_fC;
+         if (hits[ih].t_ns > hits[ih2].t_ns) {
+            hits[ih].t_ns = hits[ih2].t_ns;
+            hits[ih].d_cm = hits[ih2].d_cm;
+         }
+         merged[ih2] = 1;
       }
-      hiter = hits.insert(hiter, GlueXHitCDCstraw::hitinfo_t());
-      hiter->q_fC = hitsrc->q_fC;
-      hiter->t_ns = hitsrc->t_ns;
-      hiter->d_cm = hitsrc->d_cm;
-      hiter->itrack_ = hitsrc->itrack_;
-      hiter->ptype_G3 = hitsrc->ptype_G3;
-      hiter->t0_ns = hitsrc->t0_ns;
-      hiter->z_cm = hitsrc->z_cm;
    }
-   return *this;
+   int nkept = 0;
+   for (int ih=0; ih < nhits; ++ih) {
+      if (!merged[ih])
+         hits[nkept++] = hits[ih];
+   }
+   hits.resize(nkept);
 }
 
 void GlueXHitCDCstraw::Draw() const
@@ -17,6 +17,8 @@
 #include "G4Allocator.hh"
 #include "G4SystemOfUnits.hh"
 
+#include <vector>
+
 class GlueXHitCDCstraw : public G4VHit
 {
  public:
@@ -46,6 +48,16 @@ class GlueXHitCDCstraw : public G4VHit
    };
    std::vector<hitinfo_t> hits;
 
+   // The hits list is kept in time order. Hits from the same track
+   // segment that were split up within the straw are merged in a single
+   // pass over a t0 ordering.
+
+   void Clear() { hits.clear(); }
+   void merge_segments(G4double dz_cm, G4double dt0_ns);
+   static bool earlier(const hitinfo_t &a, const hitinfo_t &b) {
+      return a.t_ns < b.t_ns;
+   }
+
    G4int GetKey() const { return GetKey(ring_, sector_); }
    static G4int GetKey(G4int ring, G4int sector) {
       return (ring << 20) + sector;
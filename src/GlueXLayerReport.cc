@@ -0,0 +1,139 @@
+//
+// GlueXLayerReport - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXLayerReport.hh"
+#include "HddsG4Builder.hh"
+
+#include "G4LogicalVolume.hh"
+#include "G4PVPlacement.hh"
+#include "G4Navigator.hh"
+#include "G4GeometryManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Timer.hh"
+#include "G4ios.hh"
+
+#include <math.h>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <set>
+
+const int kMaxStepsPerRay = 100000;
+
+void GlueXLayerReport::Print(const HddsG4Builder *builder, int nrays,
+                             const G4ThreeVector &origin)
+{
+   // For each layer, count the logical volumes in it, the ones among
+   // them that have a material, and the physical volumes placed, and
+   // time the navigation of nrays geantino rays spread evenly in
+   // direction from origin. The optimisations that Geant4 builds for
+   // navigation are built here for the purpose and removed again
+   // afterwards, as the geometry is not closed until the run starts.
+
+   std::vector<G4LogicalVolume*> worlds;
+   while (G4LogicalVolume *world = builder->getWorldVolume(worlds.size()))
+      worlds.push_back(world);
+   if (nrays > 0)
+      G4GeometryManager::GetInstance()->CloseGeometry(true, false);
+
+   G4cout << G4endl
+          << "GlueXLayerReport: " << worlds.size() << " geometry layers, "
+          << nrays << " rays from (" << origin.x() / cm << ","
+          << origin.y() / cm << "," << origin.z() / cm << ") cm"
+          << G4endl
+          << std::setw(20) << "world"
+          << std::setw(10) << "volumes"
+          << std::setw(10) << "filled"
+          << std::setw(12) << "placements"
+          << std::setw(12) << "steps/ray"
+          << std::setw(16) << "time/step(us)"
+          << std::setw(10) << "share"
+          << G4endl;
+
+   std::vector<int> nvolumes(worlds.size(), 0);
+   std::vector<int> nfilled(worlds.size(), 0);
+   std::vector<long int> nplaced(worlds.size(), 0);
+   std::vector<long int> nsteps(worlds.size(), 0);
+   std::vector<double> elapsed(worlds.size(), 0);
+   double total = 0;
+   for (unsigned int w=0; w < worlds.size(); ++w) {
+      std::vector<G4LogicalVolume*> volumes(1, worlds[w]);
+      std::set<G4LogicalVolume*> visited;
+      while (volumes.size() > 0) {
+         G4LogicalVolume *vol = volumes.back();
+         volumes.pop_back();
+         if (! visited.insert(vol).second)
+            continue;
+         nvolumes[w] += 1;
+         nfilled[w] += (vol->GetMaterial() != 0);
+         for (int child = 0; child < (int)vol->GetNoDaughters(); ++child) {
+            G4VPhysicalVolume *pvol = vol->GetDaughter(child);
+            nplaced[w] += pvol->GetMultiplicity();
+            volumes.push_back(pvol->GetLogicalVolume());
+         }
+      }
+
+      G4PVPlacement *top = new G4PVPlacement(0, G4ThreeVector(), worlds[w],
+                                             worlds[w]->GetName(), 0, 0, 0);
+      G4Navigator navigator;
+      navigator.SetWorldVolume(top);
+      G4Timer timer;
+      timer.Start();
+      for (int n=0; n < nrays; ++n) {
+         double costheta = 1 - (2 * n + 1.) / nrays;
+         double sintheta = sqrt(1 - costheta * costheta);
+         double phi = n * 2.399963229728653;  // golden angle
+         G4ThreeVector dir(sintheta * cos(phi), sintheta * sin(phi),
+                           costheta);
+         G4ThreeVector pos(origin);
+         navigator.LocateGlobalPointAndSetup(pos, &dir, false, false);
+         for (int step=0; step < kMaxStepsPerRay; ++step) {
+            double safety;
+            double length = navigator.ComputeStep(pos, dir, kInfinity,
+                                                  safety);
+            if (length >= kInfinity)
+               break;
+            pos += length * dir;
+            navigator.SetGeometricallyLimitedStep();
+            nsteps[w] += 1;
+            if (navigator.LocateGlobalPointAndSetup(pos, &dir, true) == 0)
+               break;
+         }
+      }
+      timer.Stop();
+      elapsed[w] = timer.GetUserElapsed();
+      total += elapsed[w];
+      delete top;
+   }
+   if (nrays > 0)
+      G4GeometryManager::GetInstance()->OpenGeometry();
+
+   for (unsigned int w=0; w < worlds.size(); ++w) {
+      std::stringstream name;
+      if (w == 0)
+         name << "mass world";
+      else
+         name << "parallel world " << w;
+      G4cout << std::setw(20) << name.str()
+             << std::setw(10) << nvolumes[w]
+             << std::setw(10) << nfilled[w]
+             << std::setw(12) << nplaced[w];
+      if (nrays > 0) {
+         G4cout << std::setw(12) << std::setprecision(4)
+                << nsteps[w] / double(nrays)
+                << std::setw(16) << std::setprecision(4)
+                << ((nsteps[w] > 0)? elapsed[w] / nsteps[w] * 1e6 : 0)
+                << std::setw(9) << std::setprecision(3)
+                << ((total > 0)? 100 * elapsed[w] / total : 0) << "%";
+      }
+      G4cout << G4endl;
+   }
+   if (worlds.size() > 1) {
+      G4cout << "Every step is navigated in each of the worlds above; "
+             << "the MERGELAYERS card removes layers that do not need "
+             << "to be separate." << G4endl;
+   }
+}
@@ -0,0 +1,38 @@
+//
+// GlueXLayerReport - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// This class reports the contents of each of the geometry layers built
+// by HddsG4Builder, ie. the mass world and each of the parallel worlds
+// that Geant4 navigates on every step, together with the time that it
+// takes to navigate a step in each one. The timing comes from a set of
+// geantino rays shot through each layer from a common origin, so that
+// the share of the tracking time that each parallel world costs can be
+// compared with what it contributes to the geometry. It is requested
+// with the LAYERREPORT card in control.in, and is best read alongside
+// the MERGELAYERS card, which removes layers that are not needed.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. It is only
+// meant to be run from the master thread before tracking starts.
+
+#ifndef GlueXLayerReport_h
+#define GlueXLayerReport_h 1
+
+#include <G4ThreeVector.hh>
+
+class HddsG4Builder;
+
+class GlueXLayerReport
+{
+ public:
+   static void Print(const HddsG4Builder *builder, int nrays,
+                     const G4ThreeVector &origin);
+
+ private:
+   GlueXLayerReport() {}
+};
+
+#endif
@@ -9,11 +9,25 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <stdint.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "GlueXMagneticField.hh"
 #include "GlueXUserOptions.hh"
 #include "GlueXDetectorConstruction.hh"
+#include "GlueXThreadAffinity.hh"
 #include "G4FieldManager.hh"
+#include "G4AutoLock.hh"
 #include "G4TransportationManager.hh"
 #include "G4SystemOfUnits.hh"
 
@@ -90,6 +104,20 @@ void GlueXUniformMagField::SetMagField(G4ThreeVector B, G4double unit)
    SetFieldValue(B *= unit);
 }
 
+void GlueXUniformMagField::GetFieldValues(int npoints,
+                                          const G4double *points,
+                                          G4double *Bfield) const
+{
+   // batch version of GetFieldValue, see GlueXMappedMagField
+
+   G4ThreeVector B = GetConstantFieldValue();
+   for (int n=0; n < npoints; ++n) {
+      Bfield[3 * n] = B[0];
+      Bfield[3 * n + 1] = B[1];
+      Bfield[3 * n + 2] = B[2];
+   }
+}
+
 G4ThreeVector GlueXUniformMagField::GetMagField(G4double unit) const
 {
    // supplementary magnetic field getter, allows user to specify factor
@@ -105,12 +133,111 @@ G4ThreeVector GlueXUniformMagField::GetMagField(G4double unit) const
 
 // Implementation code for class GlueXMappedMagField
 
+int GlueXMappedMagField::fMapCachePolicy = -1;
+std::map<GlueXMappedMagField::replica_key_t, GlueXMappedMagField::replica_t>
+    GlueXMappedMagField::fNodeReplicas;
+G4Mutex GlueXMappedMagField::fNodeReplicasMutex = G4MUTEX_INITIALIZER;
+
+// Binary field map files consist of the header below, followed by one
+// field_map_grid_record_t for each grid, followed by the map entries
+// as an array of 3 doubles per node starting at offset data_offset.
+// Binary map cache files are written in the directory named on the
+// GEOMCACHE card, under the full path of the original text map with the
+// slashes replaced and the suffix ".bin" appended, or beside the text map
+// with the suffix appended by the converter mode hdgeant4 -c. They record
+// the size and the mtime in ns of the text file so that stale caches are
+// detected and rewritten.
+
+#define FIELD_MAP_BINARY_MAGIC "HDGMAPB1"
+#define FIELD_MAP_BINARY_SUFFIX ".bin"
+
+struct field_map_binary_header_t {
+   char magic[8];
+   int32_t gridtype;
+   int32_t ngrids;
+   int32_t dim[3];
+   int32_t order[3];
+   int64_t text_size;
+   int64_t text_mtime;     // ns since the epoch
+   uint64_t nentries;
+   uint64_t data_offset;
+   uint64_t checksum;
+};
+
+struct field_map_grid_record_t {
+   int32_t sense[4];
+   double lower[3];
+   double upper[3];
+};
+
+static int64_t field_map_mtime(const struct stat &st)
+{
+   return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+static std::string field_cache_dir()
+{
+   // directory given on the GEOMCACHE card for the field caches,
+   // or "" if there is none, in which case no caches are written
+
+   std::map<int, std::string> cache_opts;
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   if (user_opts == 0 || ! user_opts->Find("GEOMCACHE", cache_opts))
+      return "";
+   return cache_opts[1];
+}
+
+static std::string field_map_cache_name(const char *mapS)
+{
+   // name of the binary cache file for the text map mapS in the
+   // field cache directory, or "" if there is none
+
+   std::string cachedir(field_cache_dir());
+   if (cachedir.size() == 0)
+      return "";
+   char path[PATH_MAX];
+   std::string name((realpath(mapS, path))? path : mapS);
+   std::replace(name.begin(), name.end(), '/', '_');
+   return cachedir + "/fieldmap" + name + FIELD_MAP_BINARY_SUFFIX;
+}
+
+static std::string const_map_source(double Bx, double By, double Bz)
+{
+   // description of a constant JANA map (tesla) for the cache key of
+   // grids resampled from it, written with enough digits to tell apart
+   // any two fields that differ
+
+   std::stringstream srcS;
+   srcS << "Const" << std::setprecision(17)
+        << "_" << Bx << "_" << By << "_" << Bz;
+   return srcS.str();
+}
+
+static uint64_t field_map_checksum(const void *data, size_t nbytes)
+{
+   // 64-bit FNV-1a hash of the map contents, used to detect truncated
+   // or corrupted binary map files
+
+   const unsigned char *bytes = (const unsigned char*)data;
+   uint64_t hash = 14695981039346656037ULL;
+   for (size_t i=0; i < nbytes; ++i) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+   }
+   return hash;
+}
+
 GlueXMappedMagField::GlueXMappedMagField(G4double Bmax, G4double unit,
                                          const G4AffineTransform &xform)
  : fUnit(unit),
    fBmax(Bmax),
    fXform(xform),
-   fGridtype(0)
+   fGridtype(0),
+   fMapEntries(0),
+   fMapEntryCount(0),
+   fStorage(0),
+   fBlock(1),
+   fBlockShift(0)
 { 
    // mapped magnetic field constructor, maximum field value Bmax required
    // as input. Factor unit converts B (Bmax and field components that will
@@ -124,11 +251,27 @@ GlueXMappedMagField::GlueXMappedMagField(G4double Bmax, G4double unit,
    // the object is ready for calls to GetFieldValue() or GetMagField().
  
    fXfinv = xform.Inverse();
+   for (int dim=0; dim < 3; ++dim)
+   {
+      fDim[dim] = 0;
+      fOrder[dim] = dim;
+      fMapD[dim] = 0;
+      fMapF[dim] = 0;
+      fCellBinScale[dim] = 0;
+   }
 }
 
 GlueXMappedMagField::~GlueXMappedMagField()
 { }
 
+GlueXMappedMagField::field_map_data_t::~field_map_data_t()
+{
+   // the last copy of the map to go away releases the mapped file
+
+   if (mmap_addr)
+      munmap(mmap_addr, mmap_size);
+}
+
 GlueXMappedMagField::GlueXMappedMagField(const GlueXMappedMagField &src)
  : G4MagneticField(src)
 {
@@ -140,7 +283,7 @@ GlueXMappedMagField::GlueXMappedMagField(const GlueXMappedMagField &src)
 GlueXMappedMagField& 
 GlueXMappedMagField::operator=(const GlueXMappedMagField &src)
 {
-   // assignment operator, map copies are deep so use sparingly
+   // assignment operator, map contents are shared with src, not copied
  
    fUnit = src.fUnit;
    fBmax = src.fBmax;
@@ -153,9 +296,55 @@ GlueXMappedMagField::operator=(const GlueXMappedMagField &src)
       fOrder[dim] = src.fOrder[dim];
    }
    fGrid = src.fGrid;
-   fFieldMap = src.fFieldMap;
+   for (int dim=0; dim < 3; ++dim)
+   {
+      fCellEdge[dim] = src.fCellEdge[dim];
+      fCellBin[dim] = src.fCellBin[dim];
+      fCellBinScale[dim] = src.fCellBinScale[dim];
+   }
+   fCellGrid = src.fCellGrid;
+   fMapData = src.fMapData;
+   fStorage = src.fStorage;
+   fBlock = src.fBlock;
+   fBlockShift = src.fBlockShift;
+   for (int dim=0; dim < 3; ++dim)
+   {
+      fStride[dim] = src.fStride[dim];
+   }
+   attach_map_data();
+   if (fMapData && GlueXThreadAffinity::GetReplicate() &&
+       GlueXThreadAffinity::GetNode() >= 0)
+   {
+      replicate_map_data(GlueXThreadAffinity::GetNode());
+   }
    return *this;
 }
+
+void GlueXMappedMagField::replicate_map_data(int node)
+{
+   // private helper method to switch this object over to a copy of its
+   // map data that lives on the given NUMA node, making the copy from
+   // the calling thread if there is none yet, see fNodeReplicas
+
+   G4AutoLock barrier(&fNodeReplicasMutex);
+   replica_key_t key(fMapData.get(), node);
+   std::map<replica_key_t, replica_t>::iterator iter;
+   iter = fNodeReplicas.find(key);
+   if (iter == fNodeReplicas.end())
+   {
+      std::shared_ptr<struct field_map_data_t> data(new field_map_data_t);
+      data->entries.assign(fMapEntries, fMapEntries + fMapEntryCount);
+      for (int dim=0; dim < 3; ++dim)
+      {
+         data->compD[dim] = fMapData->compD[dim];
+         data->compF[dim] = fMapData->compF[dim];
+      }
+      replica_t replica(fMapData, data);
+      iter = fNodeReplicas.insert(std::make_pair(key, replica)).first;
+   }
+   fMapData = iter->second.second;
+   attach_map_data();
+}
       
 void GlueXMappedMagField::SetMagFieldTransform(const G4AffineTransform &xform)
 {
@@ -173,6 +362,22 @@ const G4AffineTransform& GlueXMappedMagField::GetMagFieldTransform() const
    return fXform;
 }
  
+static int zero_based_order(const int axorder[4], int order[3])
+{
+   // converts the axis order axorder[1..3] given to AddCartesianGrid and
+   // AddCylindricalGrid, with axes numbered 1..3, into the zero-based
+   // order kept in fOrder, returning 0 unless it lists each axis once
+
+   for (int k=0; k < 3; ++k)
+   {
+      order[k] = axorder[k + 1] - 1;
+      if (order[k] < 0 || order[k] > 2)
+         return 0;
+   }
+   return (order[0] != order[1] && order[1] != order[2] &&
+           order[2] != order[0]);
+}
+
 int GlueXMappedMagField::AddCartesianGrid(const int axsamples[4],
                                           const int axorder[4],
                                           const int axsense[4],
@@ -191,22 +396,35 @@ int GlueXMappedMagField::AddCartesianGrid(const int axsamples[4],
    // total size of the map and eliminate redundancies.
    //     Input arrays all have the same component structure: x=1, y=2, z=3
    // and the 0'th component is unused. Units for axlower and axupper are cm.
-   // Values in axorder[1..3] should be in the range 1..3. Values in axsense
-   // should be either +1 or -1. Repeated calls to AddCartesianGrid must all
-   // agree in the contents of axsamples and axorder, but can differ in the
-   // remaining arguments. This is assumed but not checked.
+   // Values in axorder[1..3] list the axes 1..3 from the most slowly to
+   // the most rapidly varying in the map, and any other values are fatal.
+   // Values in axsense should be either +1 or -1. Repeated calls to
+   // AddCartesianGrid must all agree in the contents of axsamples and
+   // axorder, but can differ in the remaining arguments. This is assumed
+   // but not checked.
  
+   int order[3];
+   if (! zero_based_order(axorder, order))
+   {
+      G4cerr << "GlueXMappedMagField::AddCartesianGrid error - "
+             << "axorder must list each of the axes 1..3 once, "
+             << "cannot continue." << G4endl;
+      exit(1);
+   }
    fGridtype = 1;
    struct field_map_grid_t grid;
    for (int dim=0; dim < 3; ++dim)
    {
       fDim[dim] = axsamples[dim + 1];
-      fOrder[dim] = axorder[dim + 1];
+      fOrder[dim] = order[dim];
       grid.sense.push_back(axsense[dim + 1]);
       grid.lower.push_back(axlower[dim + 1]);
       grid.upper.push_back(axupper[dim + 1]);
+      grid.scale[dim] = (axupper[dim + 1] != axlower[dim + 1])?
+                        1 / (axupper[dim + 1] - axlower[dim + 1]) : 0;
    }
    fGrid.push_back(grid);
+   build_grid_index();
    return 1;
 }
 
@@ -228,23 +446,35 @@ int GlueXMappedMagField::AddCylindricalGrid(const int axsamples[4],
    // total size of the map and eliminate redundancies.
    //     Input arrays all have the same component structure: rho=1, phi=2, z=3
    // and the 0'th component is unused. Units for axlower and axupper are cm
-   // for rho and z, and radians for phi. Values in axorder[1..3] should be in
-   // the range 1..3. Values in axsense should be either +1 or -1. Repeated
-   // calls to AddCylindricalGrid must all agree in the contents of axsamples
-   // and axorder, but can differ in the remaining arguments. This is assumed
-   // but not checked.
+   // for rho and z, and radians for phi. Values in axorder[1..3] list the
+   // axes 1..3 from the most slowly to the most rapidly varying in the map,
+   // and any other values are fatal. Values in axsense should be either +1
+   // or -1. Repeated calls to AddCylindricalGrid must all agree in the
+   // contents of axsamples and axorder, but can differ in the remaining
+   // arguments. This is assumed but not checked.
  
+   int order[3];
+   if (! zero_based_order(axorder, order))
+   {
+      G4cerr << "GlueXMappedMagField::AddCylindricalGrid error - "
+             << "axorder must list each of the axes 1..3 once, "
+             << "cannot continue." << G4endl;
+      exit(1);
+   }
    fGridtype = 2;
    struct field_map_grid_t grid;
    for (int dim=0; dim < 3; ++dim)
    {
       fDim[dim] = axsamples[dim + 1];
-      fOrder[dim] = axorder[dim + 1];
+      fOrder[dim] = order[dim];
       grid.sense.push_back(axsense[dim + 1]);
       grid.lower.push_back(axlower[dim + 1]);
       grid.upper.push_back(axupper[dim + 1]);
+      grid.scale[dim] = (axupper[dim + 1] != axlower[dim + 1])?
+                        1 / (axupper[dim + 1] - axlower[dim + 1]) : 0;
    }
    fGrid.push_back(grid);
+   build_grid_index();
    return 1;
 }
 
@@ -265,6 +495,33 @@ int GlueXMappedMagField::ReadMapFile(const char *mapS)
    // one call to either AddCartesianGrid() or AddCylindricalGrid() must
    // have occurred on this object prior to the invocation of ReadMapFile.
 
+   // A binary map file (see WriteMapCache) is also accepted in place of
+   // the text file, and is mapped directly into memory. For text maps, a
+   // binary cache file made beside the original by hdgeant4 -c, or kept
+   // in the GEOMCACHE directory, is used instead if it exists and is up
+   // to date. Otherwise it is written to the GEOMCACHE directory, if one
+   // is given, for use by later jobs. Caches are disabled with the card
+   // MAGFIELDCACHE (see SetMapCachePolicy).
+
+   // The map is always read into a new data block, so that any copies
+   // of this object still sharing the previous map are not affected.
+
+   std::shared_ptr<struct field_map_data_t> data(new field_map_data_t);
+   std::string besideS(std::string(mapS) + FIELD_MAP_BINARY_SUFFIX);
+   std::string cacheS(field_map_cache_name(mapS));
+   int policy = GetMapCachePolicy();
+   if (map_binary_file(mapS, 0, *data) ||
+       (policy == 1 && map_binary_file(besideS.c_str(), mapS, *data)) ||
+       (policy == 1 && cacheS.size() > 0 &&
+        map_binary_file(cacheS.c_str(), mapS, *data)))
+   {
+      fMapData = data;
+      attach_map_data();
+      init_storage(*data);
+      attach_map_data();
+      return 1;
+   }
+
    std::ifstream mapfile(mapS);
    if (! mapfile.good())
    {
@@ -280,15 +537,395 @@ int GlueXMappedMagField::ReadMapFile(const char *mapS)
       mapfile >> entry.cart.x >> entry.cart.y >> entry.cart.z;
       if (mapfile.good())
       {
-         fFieldMap.push_back(entry);
+         data->entries.push_back(entry);
       }
       else {
          break;
       }
    }
+   fMapData = data;
+   attach_map_data();
+   if (policy == 2)
+   {
+      WriteMapCache(besideS.c_str(), mapS);
+   }
+   else if (policy == 1 && cacheS.size() > 0)
+   {
+      WriteMapCache(cacheS.c_str(), mapS);
+   }
+   init_storage(*data);
+   attach_map_data();
    return 1;
 }
 
+void GlueXMappedMagField::attach_map_data()
+{
+   // private helper method to set the raw pointers used for fast access
+   // to the contents of the shared map data block
+
+   const struct field_map_data_t *data = fMapData.get();
+   fMapEntries = 0;
+   fMapEntryCount = 0;
+   for (int dim=0; dim < 3; ++dim)
+   {
+      fMapD[dim] = 0;
+      fMapF[dim] = 0;
+   }
+   if (data == 0)
+   {
+      return;
+   }
+   else if (data->mmap_addr)
+   {
+      const struct field_map_binary_header_t *header =
+                   (const struct field_map_binary_header_t*)data->mmap_addr;
+      fMapEntries = (const union field_map_entry_t*)
+                    ((const char*)data->mmap_addr + header->data_offset);
+      fMapEntryCount = header->nentries;
+   }
+   else if (data->entries.size() > 0)
+   {
+      fMapEntries = &data->entries[0];
+      fMapEntryCount = data->entries.size();
+   }
+   for (int dim=0; dim < 3; ++dim)
+   {
+      if (data->compD[dim].size() > 0)
+         fMapD[dim] = &data->compD[dim][0];
+      if (data->compF[dim].size() > 0)
+         fMapF[dim] = &data->compF[dim][0];
+   }
+}
+
+int GlueXMappedMagField::WriteMapCache(const char *cacheS,
+                                       const char *textS) const
+{
+   // writes the map entries and grid description out to a binary map
+   // file that can be given to ReadMapFile in place of the text map.
+   // The file is first written under a temporary name and then renamed,
+   // so that concurrent jobs never see a partially written file. If the
+   // text original textS is given, its size and modification time are
+   // recorded for checking the cache validity. Failure to write the
+   // file is not an error for the simulation, so only a warning is given.
+
+   struct field_map_binary_header_t header;
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, FIELD_MAP_BINARY_MAGIC, sizeof(header.magic));
+   header.gridtype = fGridtype;
+   header.ngrids = fGrid.size();
+   for (int dim=0; dim < 3; ++dim)
+   {
+      header.dim[dim] = fDim[dim];
+      header.order[dim] = fOrder[dim] + 1;
+   }
+   struct stat textstat;
+   if (textS != 0 && stat(textS, &textstat) == 0)
+   {
+      header.text_size = textstat.st_size;
+      header.text_mtime = field_map_mtime(textstat);
+   }
+   header.nentries = fMapEntryCount;
+   size_t offset = sizeof(header) +
+                   fGrid.size() * sizeof(struct field_map_grid_record_t);
+   header.data_offset = (offset + 63) & ~(size_t)63;
+   header.checksum = field_map_checksum(fMapEntries, fMapEntryCount *
+                                        sizeof(union field_map_entry_t));
+
+   std::stringstream tmpS;
+   tmpS << cacheS << ".tmp" << getpid();
+   FILE *fout = fopen(tmpS.str().c_str(), "wb");
+   if (fout == 0)
+   {
+      G4cerr << "GlueXMappedMagField::WriteMapCache warning - "
+             << "cannot open " << tmpS.str() << " for writing, "
+             << "binary map cache not written." << G4endl;
+      return 0;
+   }
+   int ok = (fwrite(&header, sizeof(header), 1, fout) == 1);
+   std::vector<struct field_map_grid_t>::const_iterator iter;
+   for (iter = fGrid.begin(); ok && iter != fGrid.end(); ++iter)
+   {
+      struct field_map_grid_record_t record;
+      memset(&record, 0, sizeof(record));
+      for (int dim=0; dim < 3; ++dim)
+      {
+         record.sense[dim] = iter->sense[dim];
+         record.lower[dim] = iter->lower[dim];
+         record.upper[dim] = iter->upper[dim];
+      }
+      ok = (fwrite(&record, sizeof(record), 1, fout) == 1);
+   }
+   std::vector<char> padding(header.data_offset - offset, 0);
+   if (ok && padding.size() > 0)
+   {
+      ok = (fwrite(&padding[0], padding.size(), 1, fout) == 1);
+   }
+   if (ok && fMapEntryCount > 0)
+   {
+      ok = (fwrite(fMapEntries, sizeof(union field_map_entry_t),
+                   fMapEntryCount, fout) == fMapEntryCount);
+   }
+   if (fclose(fout) != 0 || ! ok ||
+       rename(tmpS.str().c_str(), cacheS) != 0)
+   {
+      G4cerr << "GlueXMappedMagField::WriteMapCache warning - "
+             << "error writing " << cacheS << ", "
+             << "binary map cache not written." << G4endl;
+      unlink(tmpS.str().c_str());
+      return 0;
+   }
+   return 1;
+}
+
+int GlueXMappedMagField::map_binary_file(const char *binS, const char *textS,
+                                         struct field_map_data_t &data)
+{
+   // private helper method to map a binary field map file into memory
+   // and attach it to the map data block. If textS is not null then
+   // the file is a cache for that text map, and is only accepted if it is
+   // not out of date with respect to it. In every case the header must
+   // agree with the grids declared on this object and the checksum must
+   // match the contents, otherwise the file is ignored and 0 is returned.
+
+   int fd = open(binS, O_RDONLY);
+   if (fd < 0)
+   {
+      return 0;
+   }
+   struct stat binstat;
+   struct field_map_binary_header_t header;
+   if (fstat(fd, &binstat) != 0 || binstat.st_size < (off_t)sizeof(header) ||
+       read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+       memcmp(header.magic, FIELD_MAP_BINARY_MAGIC, sizeof(header.magic)))
+   {
+      close(fd);
+      return 0;
+   }
+   const char *reason = 0;
+   struct stat textstat;
+   if (textS != 0 && (stat(textS, &textstat) != 0 ||
+                      textstat.st_size != header.text_size ||
+                      field_map_mtime(textstat) != header.text_mtime))
+   {
+      reason = "out of date";
+   }
+   else if (header.gridtype != fGridtype ||
+            header.ngrids != (int)fGrid.size() ||
+            header.dim[0] != fDim[0] || header.order[0] != fOrder[0] + 1 ||
+            header.dim[1] != fDim[1] || header.order[1] != fOrder[1] + 1 ||
+            header.dim[2] != fDim[2] || header.order[2] != fOrder[2] + 1)
+   {
+      reason = "inconsistent with the geometry";
+   }
+   else if (header.data_offset < sizeof(header) + header.ngrids *
+                                 sizeof(struct field_map_grid_record_t) ||
+            (uint64_t)binstat.st_size < header.data_offset +
+            header.nentries * sizeof(union field_map_entry_t))
+   {
+      reason = "truncated";
+   }
+   if (reason)
+   {
+      if (textS == 0)
+         G4cerr << "GlueXMappedMagField::ReadMapFile warning - "
+                << "binary map file " << binS << " is " << reason
+                << ", ignored." << G4endl;
+      close(fd);
+      return 0;
+   }
+   void *addr = mmap(0, binstat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if (addr == MAP_FAILED)
+   {
+      return 0;
+   }
+   const char *base = (const char*)addr;
+   const struct field_map_grid_record_t *records =
+                (const struct field_map_grid_record_t*)(base + sizeof(header));
+   for (int n=0; n < header.ngrids; ++n)
+   {
+      for (int dim=0; dim < 3; ++dim)
+      {
+         if (records[n].sense[dim] != fGrid[n].sense[dim] ||
+             records[n].lower[dim] != fGrid[n].lower[dim] ||
+             records[n].upper[dim] != fGrid[n].upper[dim])
+         {
+            reason = "inconsistent with the geometry";
+         }
+      }
+   }
+   const union field_map_entry_t *entries = 
+               (const union field_map_entry_t*)(base + header.data_offset);
+   if (reason == 0 && field_map_checksum(entries, header.nentries *
+                      sizeof(union field_map_entry_t)) != header.checksum)
+   {
+      reason = "corrupted";
+   }
+   if (reason)
+   {
+      G4cerr << "GlueXMappedMagField::ReadMapFile warning - "
+             << "binary map file " << binS << " is " << reason
+             << ", ignored." << G4endl;
+      munmap(addr, binstat.st_size);
+      return 0;
+   }
+   data.mmap_addr = addr;
+   data.mmap_size = binstat.st_size;
+   return 1;
+}
+
+void GlueXMappedMagField::SetMapCachePolicy(int policy)
+{
+   // overrides the MAGFIELDCACHE card setting for all subsequent calls
+   // to ReadMapFile, see the description of fMapCachePolicy in the header.
+   // It should be called before the geometry is constructed.
+
+   fMapCachePolicy = policy;
+}
+
+int GlueXMappedMagField::GetMapCachePolicy()
+{
+   // returns the binary map cache policy in force, taken from the user
+   // card MAGFIELDCACHE if it has not been set by SetMapCachePolicy.
+
+   if (fMapCachePolicy < 0)
+   {
+      std::map<int, int> cache_opts;
+      GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+      if (user_opts && user_opts->Find("MAGFIELDCACHE", cache_opts))
+         return cache_opts[1];
+      return 1;
+   }
+   return fMapCachePolicy;
+}
+
+void GlueXMappedMagField::init_storage(struct field_map_data_t &data)
+{
+   // private helper method to convert the map in the data block from
+   // the array of triplets read from the input file, or mapped from a
+   // binary map file, into the alternative storage engine, if one
+   // is requested by the user with the card
+   //    MAGFIELDSTORE <type> <block>
+   // where type is one of 'triplets' (default), 'double' or 'float', and
+   // block is the edge length of the node bricks (1 = no blocking).
+
+   fStorage = 0;
+   fBlock = 1;
+   fBlockShift = 0;
+   std::map<int, std::string> store_opts;
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   if (user_opts == 0 || ! user_opts->Find("MAGFIELDSTORE", store_opts))
+   {
+      return;
+   }
+   else if (store_opts[1] == "double")
+   {
+      fStorage = 1;
+   }
+   else if (store_opts[1] == "float")
+   {
+      fStorage = 2;
+   }
+   else if (store_opts[1] != "triplets")
+   {
+      G4cerr << "GlueXMappedMagField::init_storage error - "
+             << "unknown MAGFIELDSTORE type " << store_opts[1]
+             << ", cannot continue." << G4endl;
+      exit(1);
+   }
+   if (store_opts.find(2) != store_opts.end())
+   {
+      fBlock = atoi(store_opts[2].c_str());
+      while ((1 << fBlockShift) < fBlock)
+         ++fBlockShift;
+      if (fBlock < 1 || (1 << fBlockShift) != fBlock)
+      {
+         G4cerr << "GlueXMappedMagField::init_storage error - "
+                << "MAGFIELDSTORE block size must be a power of 2, "
+                << "cannot continue." << G4endl;
+         exit(1);
+      }
+   }
+   if (fStorage == 0)
+   {
+      fBlock = 1;
+      fBlockShift = 0;
+      return;
+   }
+
+   // The ordering of nodes in the input file is given by fOrder, which
+   // lists the axes from the slowest to the most rapidly varying, as
+   // described in the class header. A map file that is too short for
+   // the declared grid dimensions is rejected.
+
+   int forder[3];
+   forder[fOrder[0]] = fDim[fOrder[1]] * fDim[fOrder[2]];
+   forder[fOrder[1]] = fDim[fOrder[2]];
+   forder[fOrder[2]] = 1;
+   int nodes = fDim[0] * fDim[1] * fDim[2];
+   if ((int)fMapEntryCount < nodes)
+   {
+      G4cerr << "GlueXMappedMagField::init_storage warning - "
+             << "map file contains " << fMapEntryCount << " entries, "
+             << "expected " << nodes << ", MAGFIELDSTORE ignored."
+             << G4endl;
+      fStorage = 0;
+      return;
+   }
+
+   // Lay out the nodes in bricks of fBlock^3 nodes, with the bricks
+   // and the nodes inside each brick ordered with the last axis varying
+   // most rapidly. Partial bricks at the upper edges are padded.
+
+   int nbrick[3];
+   for (int dim=0; dim < 3; ++dim)
+      nbrick[dim] = (fDim[dim] + fBlock - 1) >> fBlockShift;
+   fStride[0] = nbrick[1] * nbrick[2];
+   fStride[1] = nbrick[2];
+   fStride[2] = 1;
+   size_t size = (size_t)nbrick[0] * nbrick[1] * nbrick[2] << 3 * fBlockShift;
+   for (int dim=0; dim < 3; ++dim)
+   {
+      if (fStorage == 1)
+         data.compD[dim].resize(size, 0);
+      else
+         data.compF[dim].resize(size, 0);
+   }
+   for (int i1=0; i1 < fDim[0]; ++i1)
+   {
+      for (int i2=0; i2 < fDim[1]; ++i2)
+      {
+         for (int i3=0; i3 < fDim[2]; ++i3)
+         {
+            int src = forder[0] * i1 + forder[1] * i2 + forder[2] * i3;
+            int dst = node_index(i1, i2, i3);
+            if (fStorage == 1)
+            {
+               data.compD[0][dst] = fMapEntries[src].cart.x;
+               data.compD[1][dst] = fMapEntries[src].cart.y;
+               data.compD[2][dst] = fMapEntries[src].cart.z;
+            }
+            else
+            {
+               data.compF[0][dst] = fMapEntries[src].cart.x;
+               data.compF[1][dst] = fMapEntries[src].cart.y;
+               data.compF[2][dst] = fMapEntries[src].cart.z;
+            }
+         }
+      }
+   }
+
+   // The original triplets are no longer needed, release them
+
+   std::vector<union field_map_entry_t>().swap(data.entries);
+   if (data.mmap_addr)
+   {
+      munmap(data.mmap_addr, data.mmap_size);
+      data.mmap_addr = 0;
+      data.mmap_size = 0;
+   }
+}
+
 G4ThreeVector GlueXMappedMagField::GetMagField(const G4double point[4],
                                                G4double unit) const
 {
@@ -301,6 +938,110 @@ G4ThreeVector GlueXMappedMagField::GetMagField(const G4double point[4],
    // field is rotated back into user coordinates and returned in the form
    // of a Cartesian 3-vector.
  
+   G4double B[3];
+   evaluate(point, B);
+   return G4ThreeVector(B[0], B[1], B[2]) *= 1 / unit;
+}
+
+void GlueXMappedMagField::GetFieldValue(const G4double point[4],
+                                        G4double Bfield[3] ) const
+{
+   // implements the standard G4MagneticField::GetFieldValue() interface
+
+   evaluate(point, Bfield);
+}
+
+void GlueXMappedMagField::GetFieldValues(int npoints,
+                                         const G4double *points,
+                                         G4double *Bfield) const
+{
+   // batch version of GetFieldValue, evaluates the field at npoints
+   // points stored consecutively as (x,y,z,t) in array points, and
+   // stores the results as (Bx,By,Bz) in consecutive elements of Bfield.
+   // The points are taken in blocks, and for each block the grid nodes
+   // and weights of every point are found first, then the field is
+   // interpolated at all of them in one loop per component without calls
+   // or branches, which the compiler vectorizes, reading the component
+   // arrays of the double or float storage engines (see MAGFIELDSTORE)
+   // or the triplets with a stride of 3, and finally the results are
+   // turned back into user coordinates.
+
+   const int block = 64;
+   int nodes[7][block];
+   G4double dur[3][block];
+   G4double B[3][block];
+   int igrid[block];
+   const int *node_ptr[7];
+   const G4double *dur_ptr[3];
+   G4double *B_ptr[3];
+   for (int i=0; i < 7; ++i)
+      node_ptr[i] = nodes[i];
+   for (int dim=0; dim < 3; ++dim)
+   {
+      dur_ptr[dim] = dur[dim];
+      B_ptr[dim] = B[dim];
+   }
+
+   for (int n0=0; n0 < npoints; n0 += block)
+   {
+      int n = (npoints - n0 < block)? npoints - n0 : block;
+      int inside = 0;
+      for (int k=0; k < n; ++k)
+      {
+         int node[7];
+         G4double w[3] = {0,0,0};
+         igrid[k] = map_stencil(points + 4 * (n0 + k), node, w);
+         for (int i=0; i < 7; ++i)
+            nodes[i][k] = (igrid[k] >= 0)? node[i] : 0;
+         for (int dim=0; dim < 3; ++dim)
+            dur[dim][k] = w[dim];
+         inside += (igrid[k] >= 0);
+      }
+      if (inside > 0)
+         interpolate_stencils(n, node_ptr, dur_ptr, B_ptr);
+      for (int k=0; k < n; ++k)
+      {
+         G4double Bk[3] = {B[0][k], B[1][k], B[2][k]};
+         user_field(igrid[k], Bk, Bfield + 3 * (n0 + k));
+      }
+   }
+}
+
+void GlueXMappedMagField::evaluate(const G4double point[3],
+                                   G4double Bfield[3]) const
+{
+   // private helper method that does the work of GetMagField, returning
+   // the field in standard G4 units in Bfield.
+
+   int node[7];
+   G4double dur[3];
+   G4double B[3] = {0,0,0};
+   int igrid = map_stencil(point, node, dur);
+   if (igrid >= 0)
+   {
+      const int *node_ptr[7] = {&node[0], &node[1], &node[2], &node[3],
+                                &node[4], &node[5], &node[6]};
+      const G4double *dur_ptr[3] = {&dur[0], &dur[1], &dur[2]};
+      G4double *B_ptr[3] = {&B[0], &B[1], &B[2]};
+      interpolate_stencils(1, node_ptr, dur_ptr, B_ptr);
+   }
+   user_field(igrid, B, Bfield);
+}
+
+int GlueXMappedMagField::map_stencil(const G4double point[3],
+                                     int node[7], G4double dur[3]) const
+{
+   // private helper method to find the grid nodes used to interpolate
+   // the field at point. The position is transformed into local map
+   // coordinates, and a 3D linear interpolation based on central
+   // estimates for the local field gradient is used, so the nodes are
+   // the one nearest to the point, followed by its lower and upper
+   // neighbours along each of the three axes, given as their offsets in
+   // the map storage (see node_offset), and the weights of the three
+   // gradients are returned in dur. The return value is the index of
+   // the grid containing the point, or -1 if there is none or any of
+   // the nodes is missing from the map.
+
    G4ThreeVector p(point[0], point[1], point[2]);
    fXfinv.ApplyPointTransform(p);
    double u[3];
@@ -318,106 +1059,283 @@ G4ThreeVector GlueXMappedMagField::GetMagField(const G4double point[4],
    }
    else
    {
-      return G4ThreeVector(0, 0, 1e-99);
+      return -1;
    }
 
-   double B[3] = {0,0,0};
-   std::vector<struct field_map_grid_t>::const_iterator iter;
-   for (iter = fGrid.begin(); iter != fGrid.end(); ++iter)
-   {
-      double unorm[3];
-      unorm[0] = (u[0] - iter->lower[0]) / (iter->upper[0] - iter->lower[0]);
-      unorm[1] = (u[1] - iter->lower[1]) / (iter->upper[1] - iter->lower[1]);
-      unorm[2] = (u[2] - iter->lower[2]) / (iter->upper[2] - iter->lower[2]);
-      if (unorm[0] < 0 || unorm[0] > 1 ||
-          unorm[1] < 0 || unorm[1] > 1 ||
-          unorm[2] < 0 || unorm[2] > 1)
+   int igrid = find_grid(u);
+   if (igrid < 0)
+      return -1;
+   const struct field_map_grid_t *grid = &fGrid[igrid];
+   double unorm[3];
+   unorm[0] = (u[0] - grid->lower[0]) * grid->scale[0];
+   unorm[1] = (u[1] - grid->lower[1]) * grid->scale[1];
+   unorm[2] = (u[2] - grid->lower[2]) * grid->scale[2];
+   int ui[3], ui0[3], ui1[3];
+   for (int dim = 0; dim < 3; ++dim)
+   {
+      double ur = unorm[dim] * (fDim[dim] - 1);
+      ui[dim] = ceil(ur - 0.5);
+      ui0[dim] = (ui[dim] > 0)? ui[dim] - 1 : ui[dim];
+      ui1[dim] = (ui[dim] < fDim[dim] - 1)? ui[dim] + 1 : ui[dim];
+      dur[dim] = (ur - ui[dim]) / (ui1[dim] - ui0[dim] + 1e-20);
+   }
+   node[0] = node_offset(ui[0], ui[1], ui[2]);
+   node[1] = node_offset(ui0[0], ui[1], ui[2]);
+   node[2] = node_offset(ui1[0], ui[1], ui[2]);
+   node[3] = node_offset(ui[0], ui0[1], ui[2]);
+   node[4] = node_offset(ui[0], ui1[1], ui[2]);
+   node[5] = node_offset(ui[0], ui[1], ui0[2]);
+   node[6] = node_offset(ui[0], ui[1], ui1[2]);
+   for (int i=0; i < 7; ++i)
+   {
+      if (node[i] < 0)
+         return -1;
+   }
+   return igrid;
+}
+
+template <typename T>
+static void interpolate_component(int npoints, const T *__restrict__ map,
+                                  int stride, const int *const node[7],
+                                  const G4double *const dur[3],
+                                  G4double *__restrict__ B)
+{
+   // interpolates one component of the field at npoints points, from
+   // the stencils of map nodes found by map_stencil, reading the values
+   // of the component for node offset i at map[i * stride]. The output
+   // does not overlap the map, so that the loop is vectorized with
+   // gathers from the map, without a run-time check for aliasing.
+
+   for (int k=0; k < npoints; ++k)
+   {
+      G4double B0 = map[node[0][k] * stride];
+      G4double grad0 = G4double(map[node[2][k] * stride]) -
+                       G4double(map[node[1][k] * stride]);
+      G4double grad1 = G4double(map[node[4][k] * stride]) -
+                       G4double(map[node[3][k] * stride]);
+      G4double grad2 = G4double(map[node[6][k] * stride]) -
+                       G4double(map[node[5][k] * stride]);
+      B[k] = B0 + (grad0 * dur[0][k] + grad1 * dur[1][k] + grad2 * dur[2][k]);
+   }
+}
+
+void GlueXMappedMagField::interpolate_stencils(int npoints,
+                                               const int *const node[7],
+                                               const G4double *const dur[3],
+                                               G4double *const B[3]) const
+{
+   // private helper method to interpolate the map components at npoints
+   // points, given their stencils of nodes and weights from map_stencil,
+   // storing the results in map coordinates in B[0..2][0..npoints-1]
+
+   for (int dim=0; dim < 3; ++dim)
+   {
+      if (fStorage == 1)
       {
-         break;
+         interpolate_component(npoints, fMapD[dim], 1, node, dur, B[dim]);
       }
-      double ur[3], dur[3];
-      int ui[3], ui0[3], ui1[3];
-      for (int dim = 0; dim < 3; ++dim)
+      else if (fStorage == 2)
       {
-         ur[dim] = unorm[dim] * (fDim[dim] - 1);
-         ui[dim] = ceil(ur[dim] - 0.5);
-         ui0[dim] = (ui[dim] > 0)? ui[dim] - 1 : ui[dim];
-         ui1[dim] = (ui[dim] < fDim[dim] - 1)? ui[dim] + 1 : ui[dim];
-         dur[dim] = (ur[dim] - ui[dim]) / (ui1[dim] - ui0[dim] + 1e-20);
-      }
-      double grad[3][3];
-      double mapfield0[3], mapfield1[3];
-      lookup_field(ui0[0], ui[1], ui[2], mapfield0);
-      lookup_field(ui1[0], ui[1], ui[2], mapfield1);
-      grad[0][0] = mapfield1[0] - mapfield0[0];
-      grad[1][0] = mapfield1[1] - mapfield0[1];
-      grad[2][0] = mapfield1[2] - mapfield0[2];
-      lookup_field(ui[0], ui0[1], ui[2], mapfield0);
-      lookup_field(ui[0], ui1[1], ui[2], mapfield1);
-      grad[0][1] = mapfield1[0] - mapfield0[0];
-      grad[1][1] = mapfield1[1] - mapfield0[1];
-      grad[2][1] = mapfield1[2] - mapfield0[2];
-      lookup_field(ui[0], ui[1], ui0[2], mapfield0);
-      lookup_field(ui[0], ui[1], ui1[2], mapfield1);
-      grad[0][2] = mapfield1[0] - mapfield0[0];
-      grad[1][2] = mapfield1[1] - mapfield0[1];
-      grad[2][2] = mapfield1[2] - mapfield0[2];
-
-      lookup_field(ui[0], ui[1], ui[2], B);
-      B[0] += grad[0][0] * dur[0] + grad[0][1] * dur[1] + grad[0][2] * dur[2];
-      B[1] += grad[1][0] * dur[0] + grad[1][1] * dur[1] + grad[1][2] * dur[2];
-      B[2] += grad[2][0] * dur[0] + grad[2][1] * dur[1] + grad[2][2] * dur[2];
-      B[0] *= iter->sense[0];
-      B[1] *= iter->sense[1];
-      B[2] *= iter->sense[2];
+         interpolate_component(npoints, fMapF[dim], 1, node, dur, B[dim]);
+      }
+      else
+      {
+         const G4double *map = &fMapEntries[0].cart.x + dim;
+         int stride = sizeof(union field_map_entry_t) / sizeof(G4double);
+         interpolate_component(npoints, map, stride, node, dur, B[dim]);
+      }
+   }
+}
+
+void GlueXMappedMagField::user_field(int igrid, const G4double B[3],
+                                     G4double Bfield[3]) const
+{
+   // private helper method to apply the sign reversals of grid igrid
+   // to the field B interpolated in map coordinates, or -1 if there is
+   // none, and return it in Bfield in user coordinates and standard G4
+   // units.
+
+   if (fGridtype != 1 && fGridtype != 2)
+   {
+      Bfield[0] = 0;
+      Bfield[1] = 0;
+      Bfield[2] = 1e-99;
+      return;
+   }
+   G4double Bmap[3] = {0,0,0};
+   if (igrid >= 0)
+   {
+      const struct field_map_grid_t *grid = &fGrid[igrid];
+      Bmap[0] = B[0] * grid->sense[0];
+      Bmap[1] = B[1] * grid->sense[1];
+      Bmap[2] = B[2] * grid->sense[2];
    }
 
    G4ThreeVector Bvec;
    if (fGridtype == 1)
    {
-      Bvec.set(B[0], B[1], B[2]);
+      Bvec.set(Bmap[0], Bmap[1], Bmap[2]);
    }
-   else if (fGridtype == 2)
+   else
    {
-      Bvec.setRhoPhiZ(B[0], B[1], B[2]);
+      Bvec.setRhoPhiZ(Bmap[0], Bmap[1], Bmap[2]);
    }
    fXform.ApplyAxisTransform(Bvec);
    if (Bvec[2] == 0)
       Bvec[2] = 1e-99; // avoid divide-by-zero by excluding |B|=0
-   return Bvec *= fUnit / unit;
+   Bfield[0] = Bvec[0] * fUnit;
+   Bfield[1] = Bvec[1] * fUnit;
+   Bfield[2] = Bvec[2] * fUnit;
 }
 
-void GlueXMappedMagField::GetFieldValue(const G4double point[4],
-                                        G4double Bfield[3] ) const
+void GlueXMappedMagField::build_grid_index()
 {
-   // implements the standard G4MagneticField::GetFieldValue() interface
+   // private helper method to rebuild the grid dispatch index after a
+   // grid has been added. Where grids overlap, the one that was added
+   // last takes precedence.
 
-   G4ThreeVector Bvec = GetMagField(point, 1);
-   Bfield[0] = Bvec[0];
-   Bfield[1] = Bvec[1];
-   Bfield[2] = Bvec[2];
+   for (int dim=0; dim < 3; ++dim)
+   {
+      std::vector<G4double> &edge = fCellEdge[dim];
+      edge.clear();
+      std::vector<struct field_map_grid_t>::const_iterator iter;
+      for (iter = fGrid.begin(); iter != fGrid.end(); ++iter)
+      {
+         edge.push_back(iter->lower[dim]);
+         edge.push_back(iter->upper[dim]);
+      }
+      std::sort(edge.begin(), edge.end());
+      edge.erase(std::unique(edge.begin(), edge.end()), edge.end());
+      if (edge.size() == 1)
+         edge.push_back(edge[0]);
+
+      // choose uniform bins no wider than the narrowest cell, so that
+      // each bin contains at most one cell boundary
+
+      double span = edge.back() - edge.front();
+      double minwidth = span;
+      for (unsigned int c=1; c < edge.size(); ++c)
+         minwidth = (edge[c] - edge[c-1] < minwidth)? edge[c] - edge[c-1]
+                                                     : minwidth;
+      int nbins = 1;
+      if (minwidth > 0)
+         nbins = (span / minwidth < 4096)? ceil(span / minwidth - 1e-9)
+                                         : 4096;
+      nbins = (nbins < 1)? 1 : nbins;
+      fCellBinScale[dim] = (span > 0)? nbins / span : 0;
+      fCellBin[dim].resize(nbins);
+      int ncells = edge.size() - 1;
+      int c = 0;
+      for (int bin=0; bin < nbins; ++bin)
+      {
+         double start = edge.front() + bin * span / nbins;
+         while (c < ncells - 1 && edge[c + 1] <= start)
+            ++c;
+         fCellBin[dim][bin] = c;
+      }
+   }
+
+   int ncells[3] = {(int)fCellEdge[0].size() - 1,
+                    (int)fCellEdge[1].size() - 1,
+                    (int)fCellEdge[2].size() - 1};
+   fCellGrid.assign(ncells[0] * ncells[1] * ncells[2], -1);
+   for (int c0=0; c0 < ncells[0]; ++c0)
+   {
+      for (int c1=0; c1 < ncells[1]; ++c1)
+      {
+         for (int c2=0; c2 < ncells[2]; ++c2)
+         {
+            int cell[3] = {c0, c1, c2};
+            double center[3];
+            for (int dim=0; dim < 3; ++dim)
+               center[dim] = (fCellEdge[dim][cell[dim]] +
+                              fCellEdge[dim][cell[dim] + 1]) / 2;
+            int index = (c0 * ncells[1] + c1) * ncells[2] + c2;
+            for (int ig=0; ig < (int)fGrid.size(); ++ig)
+            {
+               int inside = 1;
+               for (int dim=0; dim < 3; ++dim)
+               {
+                  double lo = fGrid[ig].lower[dim];
+                  double hi = fGrid[ig].upper[dim];
+                  if (center[dim] < std::min(lo, hi) ||
+                      center[dim] > std::max(lo, hi))
+                  {
+                     inside = 0;
+                  }
+               }
+               if (inside)
+                  fCellGrid[index] = ig;
+            }
+         }
+      }
+   }
 }
 
-int GlueXMappedMagField::lookup_field(int i1, int i2, int i3,
-                                      G4double mapvalue[3]) const
+int GlueXMappedMagField::find_grid(const G4double u[3]) const
 {
-   // private helper method to perform lookup of the field at a single
-   // site in the field map. Many such accesses are performed in a 
-   // single interpolation of the field, so it should be reasonably
-   // efficient.
+   // private helper method to look up the grid that contains the point u
+   // in map coordinates, returning its index in fGrid or -1 if none.
+
+   if (fCellGrid.size() == 0)
+      return -1;
+   int cell[3];
+   for (int dim=0; dim < 3; ++dim)
+   {
+      const std::vector<G4double> &edge = fCellEdge[dim];
+      if (u[dim] < edge.front() || u[dim] > edge.back())
+         return -1;
+      int bin = (u[dim] - edge.front()) * fCellBinScale[dim];
+      int nbins = fCellBin[dim].size();
+      bin = (bin < nbins)? bin : nbins - 1;
+      int c = fCellBin[dim][bin];
+      int ncells = edge.size() - 1;
+      while (c < ncells - 1 && u[dim] > edge[c + 1])
+         ++c;
+      cell[dim] = c;
+   }
+   int ncells1 = fCellEdge[1].size() - 1;
+   int ncells2 = fCellEdge[2].size() - 1;
+   return fCellGrid[(cell[0] * ncells1 + cell[1]) * ncells2 + cell[2]];
+}
+
+int GlueXMappedMagField::node_offset(int i1, int i2, int i3) const
+{
+   // private helper method to find the position of a grid node in the
+   // map storage, as its index in the component arrays of the alternative
+   // storage engines or in the array of triplets, or -1 if the node is
+   // beyond the end of the triplets read from the map file.
+
+   if (fStorage != 0)
+   {
+      return node_index(i1, i2, i3);
+   }
 
    int ivec[3] = {i1, i2, i3};
    int iord[3] = {ivec[fOrder[0]], ivec[fOrder[1]], ivec[fOrder[2]]};
    int nord[3] = {fDim[fOrder[0]], fDim[fOrder[1]], fDim[fOrder[2]]};
-   int index = nord[1] * (nord[0] * iord[0] + iord[1]) + iord[2];
-   if (index < (int)fFieldMap.size())
+   int index = nord[2] * (nord[1] * iord[0] + iord[1]) + iord[2];
+   if (index < (int)fMapEntryCount)
    {
-      mapvalue[0] = fFieldMap[index].cart.x;
-      mapvalue[1] = fFieldMap[index].cart.y;
-      mapvalue[2] = fFieldMap[index].cart.z;
-      return 1;
+      return index;
    }
-   return 0;
+   return -1;
+}
+
+int GlueXMappedMagField::node_index(int i1, int i2, int i3) const
+{
+   // private helper method to compute the position of a grid node in
+   // the component arrays of the alternative storage engine, using the
+   // strides precomputed in init_storage(). Indices are assumed to lie
+   // inside the grid, as guaranteed by the caller.
+
+   int mask = fBlock - 1;
+   int brick = fStride[0] * (i1 >> fBlockShift) +
+               fStride[1] * (i2 >> fBlockShift) +
+               fStride[2] * (i3 >> fBlockShift);
+   return (brick << 3 * fBlockShift) +
+          ((((i1 & mask) << fBlockShift) + (i2 & mask)) << fBlockShift) +
+          (i3 & mask);
 }
 
 
@@ -428,13 +1346,19 @@ int GlueXMappedMagField::lookup_field(int i1, int i2, int i3,
 // the choice to use for any case where the field is not uniform, and the
 // map is not stored in the specific format specified for HDDS field maps.
 
+G4ThreadLocal long int GlueXComputedMagField::fCacheHits = 0;
+G4ThreadLocal long int GlueXComputedMagField::fCacheMisses = 0;
+
 GlueXComputedMagField::GlueXComputedMagField(G4double Bmax, G4double unit,
                                              const G4AffineTransform &xform)
  : fUnit(unit),
    fBmax(Bmax),
    fXform(xform),
    fJanaFieldMap(0),
-   fJanaFieldMapPS(0)
+   fJanaFieldMapPS(0),
+   fCacheTolerance(0),
+   fCacheValid(0),
+   fResampled(0)
 {
    // computed magnetic field constructor, maximum field value Bmax required
    // as input. Factor unit converts B (Bmax and field components that will
@@ -445,6 +1369,10 @@ GlueXComputedMagField::GlueXComputedMagField(G4double Bmax, G4double unit,
    // rotation from xform is performed on B before it is returned to the user.
    // Note that method SetFunction() must be issued before the object is ready
    // for calls to GetFieldValue() or GetMagField().
+
+   fXfinv = xform.Inverse();
+   for (int i=0; i < 3; ++i)
+      fCacheP[i] = fCacheB[i] = 0;
 }
 
 GlueXComputedMagField::~GlueXComputedMagField()
@@ -466,9 +1394,21 @@ GlueXComputedMagField::operator=(const GlueXComputedMagField &src)
    fBmax = src.fBmax;
    fUnit = src.fUnit;
    fXform = src.fXform;
+   fXfinv = src.fXfinv;
    fFunction = src.fFunction;
    fJanaFieldMap = src.fJanaFieldMap;
    fJanaFieldMapPS = src.fJanaFieldMapPS;
+   fCacheTolerance = src.fCacheTolerance;
+   fCacheValid = 0;
+   fMapSource = src.fMapSource;
+   fResampled = src.fResampled;
+   for (int i=0; i < 3; ++i) {
+      fRsDim[i] = src.fRsDim[i];
+      fRsLower[i] = src.fRsLower[i];
+      fRsUpper[i] = src.fRsUpper[i];
+      fRsScale[i] = src.fRsScale[i];
+   }
+   fRsTable = src.fRsTable;
    return *this;
 }
 
@@ -528,6 +1468,7 @@ void GlueXComputedMagField::SetFunction(std::string function)
          if (map_opts.size() > 0) {
             fJanaFieldMap = new DMagneticFieldMapFineMesh(japp, run_number,
                                                           map_opts[1]);
+            fMapSource = "CalibDB_" + map_opts[1];
          }
 
          // otherwise see if we can load the name of the 
@@ -549,6 +1490,7 @@ void GlueXComputedMagField::SetFunction(std::string function)
 	       else
 	          fJanaFieldMap = new DMagneticFieldMapFineMesh(japp,
                                       run_number, map_name["map_name"]);
+               fMapSource = "CalibDB_" + map_name["map_name"];
 	    }
             else {
                G4cerr << "Error in GlueXComputedMagField::SetFunction - "
@@ -561,12 +1503,14 @@ void GlueXComputedMagField::SetFunction(std::string function)
       }
       else if (type_opts[1] =="NoField") {
          fJanaFieldMap = new DMagneticFieldMapNoField(japp);
+         fMapSource = "NoField";
       }
       else if (type_opts[1] == "Const") {
          const GlueXDetectorConstruction *geom =
                GlueXDetectorConstruction::GetInstance();
          double field_T = (geom)? geom->GetUniformField(tesla) : 1.9;
          fJanaFieldMap = new DMagneticFieldMapConst(0.0, 0.0, field_T);
+         fMapSource = const_map_source(0.0, 0.0, field_T);
       }
       else {
          G4cerr << "Error in GlueXComputedMagField::SetFunction - "
@@ -574,6 +1518,23 @@ void GlueXComputedMagField::SetFunction(std::string function)
                 << ", cannot continue." << G4endl;
          exit(-1);
       }
+
+      // enable the lookup cache if requested in control.in
+
+      std::map<int, double> cache_opts;
+      if (GlueXUserOptions::GetInstance()->Find("BFIELDCACHE", cache_opts))
+         fCacheTolerance = cache_opts[1];
+      fCacheValid = 0;
+
+      // resample the map onto a native grid if requested in control.in
+
+      std::map<int, double> resample_opts;
+      if (GlueXUserOptions::GetInstance()->Find("BFIELDRESAMPLE",
+                                                resample_opts))
+      {
+         fFunction = function;
+         resample_map(1, resample_opts);
+      }
    }
 
    else if (function == "gufld_ps(r,B)") {
@@ -592,6 +1553,7 @@ void GlueXComputedMagField::SetFunction(std::string function)
          if (map_opts.size() > 0) {
             fJanaFieldMapPS = new DMagneticFieldMapPS2DMap(japp, run_number,
                                                            map_opts[1]);
+            fMapSource = "CalibDB_" + map_opts[1];
          }
          else {
 
@@ -610,6 +1572,7 @@ void GlueXComputedMagField::SetFunction(std::string function)
             else if (map_name.find("map_name") != map_name.end()) {
 	       fJanaFieldMapPS = new DMagneticFieldMapPS2DMap(japp,
                                      run_number, map_name["map_name"]);
+               fMapSource = "CalibDB_" + map_name["map_name"];
 	    }
             else {
                G4cerr << "Error in GlueXComputedMagField::SetFunction - "
@@ -622,6 +1585,7 @@ void GlueXComputedMagField::SetFunction(std::string function)
       }
       else if (type_opts[1] == "Const") {
          fJanaFieldMapPS = new DMagneticFieldMapPSConst(0.0, 1.64, 0.0);
+         fMapSource = const_map_source(0.0, 1.64, 0.0);
       }
       else {
          G4cerr << "Error in GlueXComputedMagField::SetFunction - "
@@ -629,6 +1593,16 @@ void GlueXComputedMagField::SetFunction(std::string function)
                 << ", cannot continue." << G4endl;
          exit(-1);
       }
+
+      // resample the map onto a native grid if requested in control.in
+
+      std::map<int, double> resample_opts;
+      if (GlueXUserOptions::GetInstance()->Find("PSBFIELDRESAMPLE",
+                                                resample_opts))
+      {
+         fFunction = function;
+         resample_map(2, resample_opts);
+      }
    }
 
    fFunction = function;
@@ -672,11 +1646,44 @@ G4ThreeVector GlueXComputedMagField::GetMagField(const G4double point[4],
    G4ThreeVector p(point[0] / cm, point[1] / cm, point[2] / cm);
    fXfinv.ApplyPointTransform(p);
    double B[3] = {0,0,0};
+   double pmap[3] = {p[0], p[1], p[2]};
+   if (fResampled && interpolate_resampled(pmap, B)) {
+      G4ThreeVector Bvec(B[0], B[1], B[2]);
+      fXform.ApplyAxisTransform(Bvec);
+      if (Bvec[2] == 0)
+         Bvec[2] = 1e-99; // avoid divide-by-zero by excluding |B|=0
+      return Bvec *= fUnit / unit;
+   }
    DMagneticFieldMap *mapso = fJanaFieldMap;
                      //dynamic_cast <DMagneticFieldMap* const> (fJanaFieldMap);
    DMagneticFieldMapPS *mapps = fJanaFieldMapPS;
                      //dynamic_cast <DMagneticFieldMapPS* const> (fJanaFieldMapPS);
-   if (mapso)
+   if (mapso && fCacheTolerance > 0) {
+      double dp[3] = {p[0] - fCacheP[0], p[1] - fCacheP[1], p[2] - fCacheP[2]};
+      if (fCacheValid && dp[0]*dp[0] + dp[1]*dp[1] + dp[2]*dp[2] <
+                         fCacheTolerance * fCacheTolerance)
+      {
+         ++fCacheHits;
+         for (int i=0; i < 3; ++i)
+            B[i] = fCacheB[i] + fCacheG[i][0] * dp[0] +
+                                fCacheG[i][1] * dp[1] +
+                                fCacheG[i][2] * dp[2];
+      }
+      else {
+         ++fCacheMisses;
+         mapso->GetField(p[0], p[1], p[2], B[0], B[1], B[2]);
+         mapso->GetFieldGradient(p[0], p[1], p[2],
+                                 fCacheG[0][0], fCacheG[0][1], fCacheG[0][2],
+                                 fCacheG[1][0], fCacheG[1][1], fCacheG[1][2],
+                                 fCacheG[2][0], fCacheG[2][1], fCacheG[2][2]);
+         for (int i=0; i < 3; ++i) {
+            fCacheP[i] = p[i];
+            fCacheB[i] = B[i];
+         }
+         fCacheValid = 1;
+      }
+   }
+   else if (mapso)
       mapso->GetField(p[0], p[1], p[2], B[0], B[1], B[2]);
    else if (mapps)
       mapps->GetField(p[0], p[1], p[2], B[0], B[1], B[2]);
@@ -697,3 +1704,332 @@ void GlueXComputedMagField::GetFieldValue(const G4double point[4],
    Bfield[1] = Bvec[1];
    Bfield[2] = Bvec[2];
 }
+
+void GlueXComputedMagField::GetFieldValues(int npoints,
+                                           const G4double *points,
+                                           G4double *Bfield) const
+{
+   // batch version of GetFieldValue, with the same layout of points and
+   // Bfield as in GlueXMappedMagField, evaluating the points one at a time
+   // because the JANA maps and the lookup cache only take a single point
+
+   for (int n=0; n < npoints; ++n) {
+      G4ThreeVector Bvec = GlueXComputedMagField::GetMagField(points + 4 * n, 1);
+      Bfield[3 * n] = Bvec[0];
+      Bfield[3 * n + 1] = Bvec[1];
+      Bfield[3 * n + 2] = Bvec[2];
+   }
+}
+
+void GlueXComputedMagField::PrintCacheStatistics()
+{
+   // prints the hit and miss counts of the lookup cache accumulated
+   // by the calling thread since the last call, and resets them
+
+   long int lookups = fCacheHits + fCacheMisses;
+   if (lookups > 0) {
+      G4cout << "GlueXComputedMagField lookup cache: "
+             << fCacheHits << " hits, " << fCacheMisses << " misses ("
+             << 100. * fCacheHits / lookups << "% hit rate)" << G4endl;
+   }
+   fCacheHits = 0;
+   fCacheMisses = 0;
+}
+
+void GlueXComputedMagField::lookup_jana(const G4double p[3],
+                                        G4double B[3]) const
+{
+   // private helper method to look up the field in the JANA map at point
+   // p given in map coordinates (cm), bypassing the cache and grid
+
+   B[0] = B[1] = B[2] = 0;
+   if (fJanaFieldMap)
+      fJanaFieldMap->GetField(p[0], p[1], p[2], B[0], B[1], B[2]);
+   else if (fJanaFieldMapPS)
+      fJanaFieldMapPS->GetField(p[0], p[1], p[2], B[0], B[1], B[2]);
+}
+
+int GlueXComputedMagField::interpolate_resampled(const G4double p[3],
+                                                 G4double B[3]) const
+{
+   // private helper method to interpolate the resampled grid at point p
+   // given in map coordinates (cm). Returns 0 without touching B if p lies
+   // outside the grid, otherwise the Cartesian field components are
+   // returned in B and the return value is 1.
+
+   G4double u[3];
+   if (fResampled == 1) {
+      u[0] = sqrt(p[0] * p[0] + p[1] * p[1]);
+      u[1] = 0;
+      u[2] = p[2];
+   }
+   else {
+      u[0] = p[0];
+      u[1] = p[1];
+      u[2] = p[2];
+   }
+   int i0[3];
+   G4double w1[3];
+   for (int i=0; i < 3; ++i) {
+      if (fRsDim[i] == 1) {
+         i0[i] = 0;
+         w1[i] = 0;
+         continue;
+      }
+      else if (u[i] < fRsLower[i] || u[i] > fRsUpper[i]) {
+         return 0;
+      }
+      G4double x = (u[i] - fRsLower[i]) * fRsScale[i];
+      i0[i] = (int)x;
+      if (i0[i] > fRsDim[i] - 2)
+         i0[i] = fRsDim[i] - 2;
+      w1[i] = x - i0[i];
+   }
+   const std::vector<G4double> &table = *fRsTable;
+   G4double Bu[3] = {0,0,0};
+   for (int c=0; c < 8; ++c) {
+      int di[3] = {c >> 2, (c >> 1) & 1, c & 1};
+      G4double w = 1;
+      for (int i=0; i < 3; ++i) {
+         w *= (di[i])? w1[i] : 1 - w1[i];
+         if (di[i] && fRsDim[i] == 1)
+            w = 0;
+      }
+      if (w == 0)
+         continue;
+      int node = ((i0[0] + di[0]) * fRsDim[1] + i0[1] + di[1]) * fRsDim[2] +
+                  i0[2] + di[2];
+      Bu[0] += w * table[3 * node];
+      Bu[1] += w * table[3 * node + 1];
+      Bu[2] += w * table[3 * node + 2];
+   }
+   if (fResampled == 1) {
+      G4double rho = u[0];
+      G4double cosphi = (rho > 0)? p[0] / rho : 1;
+      G4double sinphi = (rho > 0)? p[1] / rho : 0;
+      B[0] = Bu[0] * cosphi - Bu[1] * sinphi;
+      B[1] = Bu[0] * sinphi + Bu[1] * cosphi;
+      B[2] = Bu[2];
+   }
+   else {
+      B[0] = Bu[0];
+      B[1] = Bu[1];
+      B[2] = Bu[2];
+   }
+   return 1;
+}
+
+// Resampled grids are cached on disk in files with the following header,
+// followed by the table of 3 doubles per node.
+
+#define RESAMPLED_MAP_MAGIC "HDGRSMP1"
+
+struct resampled_map_header_t {
+   char magic[8];
+   char key[256];
+   int32_t kind;
+   int32_t dim[3];
+   double lower[3];
+   double upper[3];
+   double maxdev;
+   double maxdev_at[3];
+   double maxfield;
+   uint64_t checksum;
+};
+
+void GlueXComputedMagField::resample_map(int kind,
+                                         std::map<int, double> &opts)
+{
+   // private helper method to sample the JANA map onto a native grid,
+   // either cylindrical (kind=1) with options from card BFIELDRESAMPLE
+   //    nr nz rmax zmin zmax
+   // or Cartesian (kind=2) with options from card PSBFIELDRESAMPLE
+   //    nx ny nz xmin xmax ymin ymax zmin zmax
+   // with all bounds in cm in map coordinates. The grid is validated by
+   // comparing the interpolated field with the JANA map at the center of
+   // every grid cell, and the maximum deviation found is reported. If the
+   // GEOMCACHE card names a directory, the grid and validation results
+   // are saved to a cache file there, which is reused by later jobs with
+   // the same map, run number and grid parameters.
+
+   int dim[3];
+   G4double lower[3], upper[3];
+   if (kind == 1 && opts.size() >= 5) {
+      dim[0] = opts[1];
+      dim[1] = 1;
+      dim[2] = opts[2];
+      lower[0] = 0;
+      upper[0] = opts[3];
+      lower[1] = upper[1] = 0;
+      lower[2] = opts[4];
+      upper[2] = opts[5];
+   }
+   else if (kind == 2 && opts.size() >= 9) {
+      for (int i=0; i < 3; ++i) {
+         dim[i] = opts[i + 1];
+         lower[i] = opts[2 * i + 4];
+         upper[i] = opts[2 * i + 5];
+      }
+   }
+   else {
+      G4cerr << "Error in GlueXComputedMagField::resample_map - "
+             << "wrong number of arguments to the "
+             << ((kind == 1)? "BFIELDRESAMPLE" : "PSBFIELDRESAMPLE")
+             << " card, cannot continue." << G4endl;
+      exit(-1);
+   }
+   for (int i=0; i < 3; ++i) {
+      if (dim[i] < 1 || (dim[i] > 1 && upper[i] <= lower[i])) {
+         G4cerr << "Error in GlueXComputedMagField::resample_map - "
+                << "invalid grid dimensions or bounds, cannot continue."
+                << G4endl;
+         exit(-1);
+      }
+   }
+   fResampled = 0;
+   for (int i=0; i < 3; ++i) {
+      fRsDim[i] = dim[i];
+      fRsLower[i] = lower[i];
+      fRsUpper[i] = upper[i];
+      fRsScale[i] = (dim[i] > 1)? (dim[i] - 1) / (upper[i] - lower[i]) : 0;
+   }
+   size_t nodes = (size_t)dim[0] * dim[1] * dim[2];
+
+   extern int run_number;
+   std::stringstream keyS;
+   keyS << fFunction.substr(0, 8) << "_" << fMapSource << "_run" << run_number
+        << "_kind" << kind << std::setprecision(17);
+   for (int i=0; i < 3; ++i)
+      keyS << "_" << dim[i] << "_" << lower[i] << "_" << upper[i];
+   std::string key(keyS.str());
+   for (size_t c=0; c < key.size(); ++c) {
+      if (! isalnum(key[c]) && key[c] != '.' && key[c] != '-')
+         key[c] = '_';
+   }
+   if (key.size() >= sizeof(resampled_map_header_t::key)) {
+      std::stringstream hashS;
+      hashS << key.substr(0, 200) << "_" << std::hex
+            << field_map_checksum(key.c_str(), key.size());
+      key = hashS.str();
+   }
+   std::string cachedir(field_cache_dir());
+   std::string cacheS;
+   if (cachedir.size() > 0)
+      cacheS = cachedir + "/bfield_resampled_" + key + ".bin";
+
+   // Try to load the grid from a previous job
+
+   struct resampled_map_header_t header;
+   std::vector<G4double> *table = new std::vector<G4double>(3 * nodes);
+   int loaded = 0;
+   FILE *fin = (cacheS.size() > 0)? fopen(cacheS.c_str(), "rb") : 0;
+   if (fin) {
+      if (fread(&header, sizeof(header), 1, fin) == 1 &&
+          memcmp(header.magic, RESAMPLED_MAP_MAGIC, 8) == 0 &&
+          memchr(header.key, 0, sizeof(header.key)) != 0 &&
+          key == header.key && header.kind == kind &&
+          fread(&(*table)[0], sizeof(G4double), 3 * nodes, fin) == 3 * nodes &&
+          field_map_checksum(&(*table)[0], 3 * nodes * sizeof(G4double)) ==
+          header.checksum)
+      {
+         loaded = 1;
+      }
+      fclose(fin);
+   }
+
+   // Otherwise sample the JANA map, validate, and save the result
+
+   if (! loaded) {
+      for (int i0=0; i0 < dim[0]; ++i0) {
+         for (int i1=0; i1 < dim[1]; ++i1) {
+            for (int i2=0; i2 < dim[2]; ++i2) {
+               G4double p[3], B[3];
+               p[0] = lower[0] + ((dim[0] > 1)? i0 / fRsScale[0] : 0);
+               p[1] = lower[1] + ((dim[1] > 1)? i1 / fRsScale[1] : 0);
+               p[2] = lower[2] + ((dim[2] > 1)? i2 / fRsScale[2] : 0);
+               lookup_jana(p, B);
+               size_t node = ((size_t)i0 * dim[1] + i1) * dim[2] + i2;
+               (*table)[3 * node] = B[0];
+               (*table)[3 * node + 1] = B[1];
+               (*table)[3 * node + 2] = B[2];
+            }
+         }
+      }
+      fRsTable.reset(table);
+      fResampled = kind;
+
+      memset(&header, 0, sizeof(header));
+      memcpy(header.magic, RESAMPLED_MAP_MAGIC, 8);
+      strncpy(header.key, key.c_str(), sizeof(header.key) - 1);
+      header.kind = kind;
+      for (int i=0; i < 3; ++i) {
+         header.dim[i] = dim[i];
+         header.lower[i] = lower[i];
+         header.upper[i] = upper[i];
+      }
+      int ncell[3];
+      for (int i=0; i < 3; ++i)
+         ncell[i] = (dim[i] > 1)? dim[i] - 1 : 1;
+      for (int i0=0; i0 < ncell[0]; ++i0) {
+         for (int i1=0; i1 < ncell[1]; ++i1) {
+            for (int i2=0; i2 < ncell[2]; ++i2) {
+               G4double u[3], p[3], B0[3], B1[3];
+               u[0] = lower[0] + ((dim[0] > 1)? (i0 + 0.5) / fRsScale[0] : 0);
+               u[1] = lower[1] + ((dim[1] > 1)? (i1 + 0.5) / fRsScale[1] : 0);
+               u[2] = lower[2] + ((dim[2] > 1)? (i2 + 0.5) / fRsScale[2] : 0);
+               p[0] = u[0];
+               p[1] = u[1];
+               p[2] = u[2];
+               lookup_jana(p, B0);
+               interpolate_resampled(p, B1);
+               G4double dev = sqrt(pow(B1[0] - B0[0], 2) +
+                                   pow(B1[1] - B0[1], 2) +
+                                   pow(B1[2] - B0[2], 2));
+               G4double mag = sqrt(B0[0]*B0[0] + B0[1]*B0[1] + B0[2]*B0[2]);
+               if (dev > header.maxdev) {
+                  header.maxdev = dev;
+                  header.maxdev_at[0] = u[0];
+                  header.maxdev_at[1] = u[1];
+                  header.maxdev_at[2] = u[2];
+               }
+               if (mag > header.maxfield)
+                  header.maxfield = mag;
+            }
+         }
+      }
+      header.checksum = field_map_checksum(&(*table)[0],
+                                           3 * nodes * sizeof(G4double));
+      if (cacheS.size() > 0) {
+         std::stringstream tmpS;
+         tmpS << cacheS << ".tmp" << getpid();
+         FILE *fout = fopen(tmpS.str().c_str(), "wb");
+         if (fout == 0 ||
+             fwrite(&header, sizeof(header), 1, fout) != 1 ||
+             fwrite(&(*table)[0], sizeof(G4double), 3 * nodes, fout) !=
+             3 * nodes || fclose(fout) != 0 ||
+             rename(tmpS.str().c_str(), cacheS.c_str()) != 0)
+         {
+            G4cerr << "GlueXComputedMagField::resample_map warning - "
+                   << "unable to write resampled field cache " << cacheS
+                   << G4endl;
+            unlink(tmpS.str().c_str());
+            cacheS.clear();
+         }
+      }
+   }
+   else {
+      fRsTable.reset(table);
+      fResampled = kind;
+   }
+
+   G4cout << "GlueXComputedMagField: " << fFunction << " resampled on a "
+          << dim[0] << "x" << dim[1] << "x" << dim[2]
+          << ((kind == 1)? " (r,phi,z)" : " (x,y,z)") << " grid"
+          << ((loaded)? " from cache " : (cacheS.size() > 0)? ", saved to "
+                                                            : "")
+          << cacheS << G4endl
+          << "   max deviation from source map " << header.maxdev
+          << " at (" << header.maxdev_at[0] << "," << header.maxdev_at[1]
+          << "," << header.maxdev_at[2] << ") cm, max field "
+          << header.maxfield << G4endl;
+}
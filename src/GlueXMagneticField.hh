@@ -7,15 +7,22 @@
 // In the context of the Geant4 event-level multithreading model,
 // this class is "thread-local", ie. has thread-local state.
 // Separate object instances are created for each worker thread.
+// The immutable contents of mapped and computed field maps are
+// shared between the worker thread instances.
 
 #ifndef GlueXMagneticField_H
 #define GlueXMagneticField_H
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <map>
+#include <new>
+#include <stdlib.h>
 
 #include <G4UniformMagField.hh>
 #include <G4AffineTransform.hh>
+#include <G4Threading.hh>
 #include <HDGEOMETRY/DMagneticFieldMap.h>
 #include <HDGEOMETRY/DMagneticFieldMapPS.h>
 
@@ -33,6 +40,8 @@ class GlueXUniformMagField: public G4UniformMagField
 
    virtual void SetMagField(G4ThreeVector B, G4double unit);
    virtual G4ThreeVector GetMagField(G4double unit) const;
+   virtual void GetFieldValues(int npoints, const G4double *points,
+                                            G4double *Bfield) const;
 
  private:
    G4AffineTransform fXform;   // converts field map coordinates to region
@@ -61,11 +70,17 @@ class GlueXMappedMagField: public G4MagneticField
                                   const G4double axlower[4],
                                   const G4double axupper[4]);
    virtual int ReadMapFile(const char *mapS);
+   virtual int WriteMapCache(const char *cacheS, const char *textS=0) const;
+
+   static void SetMapCachePolicy(int policy);
+   static int GetMapCachePolicy();
 
    virtual G4ThreeVector GetMagField(const G4double point[4],
                                      G4double unit) const;
    virtual void  GetFieldValue(const G4double point[4],
                                      G4double *Bfield ) const;
+   virtual void GetFieldValues(int npoints, const G4double *points,
+                                            G4double *Bfield) const;
    double GetBmax(G4double unit) const { return fBmax * fUnit/unit; }
 
  private:
@@ -76,7 +91,8 @@ class GlueXMappedMagField: public G4MagneticField
    int fGridtype;              // none (0), cartesian (1), or cylindrical (2)
    int fDim[3];                // sample grid dimensions (x,y,z) or (r,phi,z)
    int fOrder[3];              // specifies how the 3D grid is strung out into
-                               // a 1D array, eg. cartesian (2,3,1) indicates
+                               // a 1D array, axes numbered from 0, eg.
+                               // cartesian (1,2,0) indicates
                                // index = fDim[0] * (fDim[2] * iy + iz) + ix
 
    struct field_map_grid_t {
@@ -84,9 +100,26 @@ class GlueXMappedMagField: public G4MagneticField
       std::vector<G4double> lower;  // grid starting coordinate, by dimension
       std::vector<G4double> upper;  // grid ending coordinate, by dimension
                                     // in cm for length, radians for angle
+      G4double scale[3];            // 1/(upper-lower), or 0 if upper=lower
    };
    std::vector<struct field_map_grid_t> fGrid;
 
+   // Index for dispatching a point to the grid that contains it in O(1)
+   // time, however many replicas of the map have been registered. The
+   // boundaries of all grids along each axis cut space into a lattice of
+   // cells, each of which lies wholly inside or outside any given grid,
+   // and the cell table records which grid (if any) covers each cell.
+   // The cell along each axis is found with a table of uniform bins no
+   // wider than the narrowest cell, so no search is needed.
+
+   std::vector<G4double> fCellEdge[3]; // sorted cell boundaries, by axis
+   std::vector<int> fCellBin[3];       // first cell in each uniform bin
+   G4double fCellBinScale[3];          // uniform bins per unit coordinate
+   std::vector<int> fCellGrid;         // index in fGrid by cell, or -1
+
+   void build_grid_index();
+   int find_grid(const G4double u[3]) const;
+
    union field_map_entry_t {
       struct cartesian_map_entry_t {
          G4double x, y, z;
@@ -95,9 +128,106 @@ class GlueXMappedMagField: public G4MagneticField
          G4double r, phi, z;
       } cyl;
    };
-   std::vector<union field_map_entry_t> fFieldMap;
 
-   int lookup_field(int i1, int i2, int i3, G4double mapvalue[3]) const;
+   template <typename T>
+   struct aligned_allocator {
+      typedef T value_type;
+      aligned_allocator() {}
+      template <typename U>
+      aligned_allocator(const aligned_allocator<U> &) {}
+      T *allocate(size_t n) {
+         void *ptr = 0;
+         if (posix_memalign(&ptr, 64, n * sizeof(T)) != 0)
+            throw std::bad_alloc();
+         return static_cast<T*>(ptr);
+      }
+      void deallocate(T *ptr, size_t) { free(ptr); }
+      template <typename U>
+      bool operator==(const aligned_allocator<U> &) const { return true; }
+      template <typename U>
+      bool operator!=(const aligned_allocator<U> &) const { return false; }
+   };
+   typedef std::vector<float, aligned_allocator<float> > float_array_t;
+   typedef std::vector<G4double, aligned_allocator<G4double> > double_array_t;
+
+   // The contents of the map are held in a field_map_data_t block that
+   // is filled once by ReadMapFile and never modified afterwards, so it
+   // can be shared by reference counting between the master object and
+   // all of its worker thread copies. Copies only carry the transforms
+   // and the grid description. The entries are stored either in vector
+   // entries (text maps) or in a binary map file that has been mapped into
+   // memory with mmap, which is then also shared between processes on the
+   // same host. The raw pointers below point into the shared block, and
+   // are cached in the object for fast access.
+
+   struct field_map_data_t {
+      field_map_data_t() : mmap_addr(0), mmap_size(0) {}
+      ~field_map_data_t();
+      std::vector<union field_map_entry_t> entries;
+      void *mmap_addr;            // mapped binary map file, or null
+      size_t mmap_size;           // size of the mapped region
+      double_array_t compD[3];    // component arrays of G4double
+      float_array_t compF[3];     // component arrays of float
+   };
+   std::shared_ptr<const struct field_map_data_t> fMapData;
+
+   const union field_map_entry_t *fMapEntries;
+   size_t fMapEntryCount;
+   const G4double *fMapD[3];   // component arrays of G4double, if fStorage=1
+   const float *fMapF[3];      // component arrays of float, if fStorage=2
+
+   static int fMapCachePolicy; // 0 = never use binary map cache files,
+                               // 1 = read them if valid, else write them
+                               //     to the GEOMCACHE directory if any,
+                               // 2 = always rewrite them beside the map,
+                               // -1 = take value from MAGFIELDCACHE card
+
+   int map_binary_file(const char *binS, const char *textS,
+                       struct field_map_data_t &data);
+
+   // Copies of the map data block made for worker threads pinned to a
+   // NUMA node other than the one holding the original, when enabled
+   // on the PINTHREADS card (see GlueXThreadAffinity). The first copy
+   // of the map made on each node fills the replica for that node, so
+   // that its pages are allocated there, and later ones share it. The
+   // original is held along with its replicas, so its address stays
+   // unique as the key.
+
+   typedef std::pair<const struct field_map_data_t*, int> replica_key_t;
+   typedef std::pair<std::shared_ptr<const struct field_map_data_t>,
+                     std::shared_ptr<const struct field_map_data_t> >
+           replica_t;
+   static std::map<replica_key_t, replica_t> fNodeReplicas;
+   static G4Mutex fNodeReplicasMutex;
+   void replicate_map_data(int node);
+
+   // Optional alternative storage engine for the map, selected with the
+   // MAGFIELDSTORE card in control.in. Instead of an array of G4double
+   // triplets (fStorage=0, the default) the map components are stored in
+   // separate contiguous arrays of G4double (fStorage=1) or float
+   // (fStorage=2) aligned on cache line boundaries, with the node index
+   // computed from precomputed strides. If fBlock > 1 the nodes are
+   // further arranged into cubic bricks of fBlock^3 nodes each, so that
+   // the 7-point interpolation stencil stays within a few cache lines.
+
+   int fStorage;               // map storage: array of triplets (0),
+                               // component arrays of doubles (1) or floats (2)
+   int fBlock;                 // edge length of node bricks, power of 2 or 1
+   int fBlockShift;            // log2(fBlock)
+   int fStride[3];             // map index strides for axes (x,y,z)/(r,phi,z),
+                               // in units of nodes or bricks if fBlock > 1
+
+   void evaluate(const G4double point[3], G4double Bfield[3]) const;
+   int map_stencil(const G4double point[3], int node[7],
+                   G4double dur[3]) const;
+   void interpolate_stencils(int npoints, const int *const node[7],
+                             const G4double *const dur[3],
+                             G4double *const B[3]) const;
+   void user_field(int igrid, const G4double B[3], G4double Bfield[3]) const;
+   int node_offset(int i1, int i2, int i3) const;
+   int node_index(int i1, int i2, int i3) const;
+   void init_storage(struct field_map_data_t &data);
+   void attach_map_data();
 };
 
 class GlueXComputedMagField: public G4MagneticField
@@ -119,8 +249,12 @@ class GlueXComputedMagField: public G4MagneticField
                                      G4double unit) const;
    virtual void  GetFieldValue(const G4double point[4],
                                      G4double *Bfield ) const;
+   virtual void GetFieldValues(int npoints, const G4double *points,
+                                            G4double *Bfield) const;
    double GetBmax(G4double unit) const { return fBmax * fUnit/unit; }
 
+   static void PrintCacheStatistics();
+
  private:
    G4double fUnit;                 // converts stored map into G4 field units
    G4double fBmax;                 // max value of mapped field (may be useful)
@@ -133,6 +267,47 @@ class GlueXComputedMagField: public G4MagneticField
    DMagneticFieldMapPS *fJanaFieldMapPS; // object from JANA framework that 
                                    // contains the pair spectrometer field map,
                                    // normally read from the ccdb database
+
+   // Optional lookup cache for the solenoid map, enabled by the BFIELDCACHE
+   // card. The field and its gradient are saved at the last point looked
+   // up in the JANA map, and any later lookup within fCacheTolerance of
+   // that point is answered by a first-order Taylor expansion about it,
+   // without calling JANA. Consecutive substeps of a track mostly fall
+   // in this case. The cache lives in the object, each worker thread
+   // having its own copy, and the hit/miss counters are per thread.
+
+   G4double fCacheTolerance;       // max distance from cached point (cm),
+                                   // or 0 to disable the cache
+   mutable int fCacheValid;        // cached point is set (1) or not (0)
+   mutable G4double fCacheP[3];    // cached point in map coordinates (cm)
+   mutable G4double fCacheB[3];    // field at the cached point
+   mutable G4double fCacheG[3][3]; // field gradient dB[i]/dx[j] there
+
+   static G4ThreadLocal long int fCacheHits;
+   static G4ThreadLocal long int fCacheMisses;
+
+   // Optional resampling of the JANA map onto a native grid at startup,
+   // enabled by the BFIELDRESAMPLE and PSBFIELDRESAMPLE cards. The solenoid
+   // is sampled in cylindrical symmetry on an (r,z) grid, and the pair
+   // spectrometer on a Cartesian (x,y,z) grid. Inside the grid the field
+   // is obtained by trilinear interpolation, outside it the JANA map is
+   // still used. The table is immutable once built and is shared between
+   // copies. It can be cached in the GEOMCACHE directory, keyed by the
+   // map source, run number and grid.
+
+   std::string fMapSource;         // CalibDB_<map name>, NoField or
+                                   // Const_<Bx>_<By>_<Bz> (tesla)
+   int fResampled;                 // none (0), cylindrical (1), cartesian (2)
+   int fRsDim[3];                  // grid dimensions, (r,1,z) or (x,y,z)
+   G4double fRsLower[3];           // grid lower bounds (cm)
+   G4double fRsUpper[3];           // grid upper bounds (cm)
+   G4double fRsScale[3];           // grid nodes per cm, by axis
+   std::shared_ptr<const std::vector<G4double> > fRsTable;
+                                   // (Br,Bphi,Bz) or (Bx,By,Bz) by node
+
+   void lookup_jana(const G4double p[3], G4double B[3]) const;
+   int interpolate_resampled(const G4double p[3], G4double B[3]) const;
+   void resample_map(int kind, std::map<int, double> &opts);
 };
 
 #endif
@@ -0,0 +1,270 @@
+//
+// GlueXOverlapChecker - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXOverlapChecker.hh"
+#include "HddsG4Builder.hh"
+
+#include "G4VSolid.hh"
+#include "G4AffineTransform.hh"
+#include "G4VoxelLimits.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <set>
+#include <stdlib.h>
+
+GlueXOverlapChecker::GlueXOverlapChecker(const HddsG4Builder *builder)
+ : fResolution(1000),
+   fTolerance(0),
+   fNextTask(0)
+{
+   // Make a list of the daughters of every logical volume found in
+   // the geometry layers, each one once, and find the bounding box of
+   // each of them in the frame of its mother.
+
+   std::set<G4LogicalVolume*> visited;
+   for (int layer=0; builder->getWorldVolume(layer) != 0; ++layer) {
+      std::vector<G4LogicalVolume*> volumes;
+      volumes.push_back(builder->getWorldVolume(layer));
+      while (volumes.size() > 0) {
+         G4LogicalVolume *mother = volumes.back();
+         volumes.pop_back();
+         if (! visited.insert(mother).second)
+            continue;
+         int ndaughters = mother->GetNoDaughters();
+         std::vector<check_extent_t> &extents = fExtents[mother];
+         extents.resize(ndaughters);
+         for (int child = 0; child < ndaughters; ++child) {
+            G4VPhysicalVolume *pvol = mother->GetDaughter(child);
+            volumes.push_back(pvol->GetLogicalVolume());
+            check_task_t task = {layer, mother, child};
+            fTasks.push_back(task);
+            extents[child].valid = ! pvol->IsReplicated();
+            if (extents[child].valid) {
+               G4VSolid *solid = pvol->GetLogicalVolume()->GetSolid();
+               G4AffineTransform Tm(pvol->GetRotation(),
+                                    pvol->GetTranslation());
+               G4VoxelLimits unlimited;
+               double lower[3], upper[3];
+               EAxis axes[3] = {kXAxis, kYAxis, kZAxis};
+               for (int i=0; i < 3; ++i) {
+                  extents[child].valid &=
+                     solid->CalculateExtent(axes[i], unlimited, Tm,
+                                            lower[i], upper[i]);
+               }
+               extents[child].lower = G4ThreeVector(lower[0], lower[1],
+                                                    lower[2]);
+               extents[child].upper = G4ThreeVector(upper[0], upper[1],
+                                                    upper[2]);
+            }
+         }
+      }
+   }
+}
+
+static void VolumeSeeds(int layer, const G4LogicalVolume *mother,
+                        int daughter, long int seeds[3])
+{
+   // Seeds for the points sampled on a daughter volume, hashed (FNV-1a)
+   // from its layer, the name of its mother and its index in the mother,
+   // which do not depend on the thread or on the order of the checks.
+
+   unsigned long long hash = 14695981039346656037ULL;
+   std::string key(mother->GetName());
+   key += "/" + std::to_string(layer) + "/" + std::to_string(daughter);
+   for (unsigned int i=0; i < key.size(); ++i) {
+      hash ^= (unsigned char)key[i];
+      hash *= 1099511628211ULL;
+   }
+   seeds[0] = (long int)(hash & 0x7fffffff) + 1;
+   seeds[1] = (long int)((hash >> 32) & 0x7fffffff) + 1;
+   seeds[2] = 0;
+}
+
+int GlueXOverlapChecker::Run(int nthreads, int resolution, double tolerance,
+                             const std::string &reportfile)
+{
+   // Check all of the daughters with resolution points on the surface
+   // of each, using nthreads threads, and write the report. Intrusions
+   // less than tolerance are ignored. Returns the number of daughters
+   // found to overlap a sibling or extrude from their mother.
+
+#ifndef G4MULTITHREADED
+   nthreads = 1;
+#endif
+   nthreads = (nthreads > 0)? nthreads : 1;
+   fResolution = resolution;
+   fTolerance = tolerance;
+   fResults.resize(fTasks.size());
+   fNextTask = 0;
+   G4cout << "GlueXOverlapChecker: checking " << fTasks.size()
+          << " daughter volumes with " << resolution << " points each, "
+          << "using " << nthreads << " threads" << G4endl;
+
+   std::chrono::steady_clock::time_point start;
+   start = std::chrono::steady_clock::now();
+   std::vector<std::thread> workers;
+   for (int n=0; n < nthreads; ++n)
+      workers.push_back(std::thread(&GlueXOverlapChecker::Worker, this));
+   for (int n=0; n < nthreads; ++n)
+      workers[n].join();
+   std::chrono::duration<double> elapsed;
+   elapsed = std::chrono::steady_clock::now() - start;
+
+   std::ofstream report(reportfile.c_str());
+   if (! report.good()) {
+      G4cerr << "GlueXOverlapChecker::Run error - "
+             << "unable to open report file " << reportfile
+             << ", cannot continue." << G4endl;
+      exit(-1);
+   }
+   const char *status_names[] = {"ok", "extrusion", "overlap", "skipped"};
+   int count[4] = {0};
+   report << "layer\tmother\tdaughter\tcopy\tfilled\tstatus\tother"
+          << "\tdepth_mm\tx_mm\ty_mm\tz_mm\tseconds" << std::endl
+          << std::setprecision(6);
+   for (unsigned int n=0; n < fTasks.size(); ++n) {
+      const check_task_t &task = fTasks[n];
+      const check_result_t &result = fResults[n];
+      G4VPhysicalVolume *pvol = task.mother->GetDaughter(task.daughter);
+      count[result.status] += 1;
+      report << task.layer << "\t" << task.mother->GetName() << "\t"
+             << pvol->GetName() << "\t" << pvol->GetCopyNo() << "\t"
+             << (pvol->GetLogicalVolume()->GetMaterial() != 0) << "\t"
+             << status_names[result.status] << "\t";
+      if (result.other)
+         report << result.other->GetName() << ":"
+                << result.other->GetCopyNo();
+      else
+         report << "-";
+      report << "\t" << result.depth / mm
+             << "\t" << result.point.x() / mm
+             << "\t" << result.point.y() / mm
+             << "\t" << result.point.z() / mm
+             << "\t" << result.seconds << std::endl;
+   }
+   G4cout << "GlueXOverlapChecker: " << count[kOk] << " ok, "
+          << count[kExtrusion] << " extrusions, "
+          << count[kOverlap] << " overlaps, "
+          << count[kSkipped] << " skipped, in " << elapsed.count()
+          << " s, report written to " << reportfile << G4endl;
+   return count[kExtrusion] + count[kOverlap];
+}
+
+void GlueXOverlapChecker::Worker()
+{
+   // Take the next task from the list until there are none left.
+
+   int n;
+   while ((n = fNextTask++) < (int)fTasks.size())
+      Check(fTasks[n], fResults[n]);
+}
+
+void GlueXOverlapChecker::Check(const check_task_t &task,
+                                check_result_t &result) const
+{
+   // Sample points on the surface of the daughter, and record the
+   // deepest one that lies outside of the mother or inside a sibling,
+   // then check that none of the siblings is entirely inside of it.
+   // The transformations follow G4PVPlacement::CheckOverlaps.
+
+   std::chrono::steady_clock::time_point start;
+   start = std::chrono::steady_clock::now();
+   result.status = kOk;
+   result.other = 0;
+   result.depth = 0;
+   result.point = G4ThreeVector();
+   G4VPhysicalVolume *pvol = task.mother->GetDaughter(task.daughter);
+   if (pvol->IsReplicated()) {
+      result.status = kSkipped;
+      result.seconds = 0;
+      return;
+   }
+   long int seeds[3];
+   VolumeSeeds(task.layer, task.mother, task.daughter, seeds);
+   G4Random::setTheSeeds(seeds);
+
+   const std::vector<check_extent_t> &extents =
+                                      fExtents.find(task.mother)->second;
+   const check_extent_t &mine = extents[task.daughter];
+   std::vector<G4VPhysicalVolume*> siblings;
+   std::vector<G4AffineTransform> toSibling;
+   for (int child = 0; child < (int)extents.size(); ++child) {
+      const check_extent_t &theirs = extents[child];
+      if (child == task.daughter || ! theirs.valid)
+         continue;
+      if (mine.valid &&
+          (theirs.lower.x() > mine.upper.x() + fTolerance ||
+           theirs.lower.y() > mine.upper.y() + fTolerance ||
+           theirs.lower.z() > mine.upper.z() + fTolerance ||
+           theirs.upper.x() < mine.lower.x() - fTolerance ||
+           theirs.upper.y() < mine.lower.y() - fTolerance ||
+           theirs.upper.z() < mine.lower.z() - fTolerance))
+      {
+         continue;
+      }
+      G4VPhysicalVolume *sibling = task.mother->GetDaughter(child);
+      siblings.push_back(sibling);
+      toSibling.push_back(G4AffineTransform(sibling->GetRotation(),
+                                            sibling->GetTranslation())
+                          .Inverse());
+   }
+
+   G4VSolid *solid = pvol->GetLogicalVolume()->GetSolid();
+   G4VSolid *motherSolid = task.mother->GetSolid();
+   G4AffineTransform Tm(pvol->GetRotation(), pvol->GetTranslation());
+   for (int i=0; i < fResolution; ++i) {
+      G4ThreeVector mp = Tm.TransformPoint(solid->GetPointOnSurface());
+      if (motherSolid->Inside(mp) == kOutside) {
+         double depth = motherSolid->DistanceToIn(mp);
+         if (depth > fTolerance && depth > result.depth) {
+            result.status = kExtrusion;
+            result.other = 0;
+            result.depth = depth;
+            result.point = mp;
+         }
+      }
+      for (unsigned int s=0; s < siblings.size(); ++s) {
+         G4VSolid *sibSolid = siblings[s]->GetLogicalVolume()->GetSolid();
+         G4ThreeVector md = toSibling[s].TransformPoint(mp);
+         if (sibSolid->Inside(md) == kInside) {
+            double depth = sibSolid->DistanceToOut(md);
+            if (depth > fTolerance && depth > result.depth) {
+               result.status = kOverlap;
+               result.other = siblings[s];
+               result.depth = depth;
+               result.point = mp;
+            }
+         }
+      }
+   }
+
+   G4AffineTransform toDaughter = Tm.Inverse();
+   for (unsigned int s=0; s < siblings.size(); ++s) {
+      G4VSolid *sibSolid = siblings[s]->GetLogicalVolume()->GetSolid();
+      G4AffineTransform Td(siblings[s]->GetRotation(),
+                           siblings[s]->GetTranslation());
+      G4ThreeVector mp = Td.TransformPoint(sibSolid->GetPointOnSurface());
+      G4ThreeVector dp = toDaughter.TransformPoint(mp);
+      if (solid->Inside(dp) == kInside) {
+         double depth = solid->DistanceToOut(dp);
+         if (depth > fTolerance && depth > result.depth) {
+            result.status = kOverlap;
+            result.other = siblings[s];
+            result.depth = depth;
+            result.point = mp;
+         }
+      }
+   }
+   std::chrono::duration<double> elapsed;
+   elapsed = std::chrono::steady_clock::now() - start;
+   result.seconds = elapsed.count();
+}
@@ -0,0 +1,105 @@
+//
+// GlueXOverlapChecker - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// This class checks the whole geometry built by HddsG4Builder for
+// overlaps, the same way as G4PVPlacement::CheckOverlaps does during
+// construction when CHECK_OVERLAPS_MM is defined, but spreading the
+// work over a pool of threads and writing the results to a report
+// file that can be read by scripts. A point sample is taken on the
+// surface of every daughter of every logical volume in each geometry
+// layer, and each point is tested against the mother and against all
+// of the siblings of the daughter whose bounding boxes intersect its
+// own, which are the only ones that it could overlap, so that the time
+// does not grow as the square of the number of daughters in volumes
+// like the CDC. Each logical volume is checked only once, even if it
+// is placed many times. Overlaps between volumes on different layers
+// are allowed by design, so each layer is checked on its own. This is
+// the -o mode of hdgeant4, and is configured with the OVERLAPCHECK
+// card in control.in.
+//
+// The report has one line per daughter volume checked, with columns
+// separated by tabs, beginning with a header line that names them.
+// The status column is one of ok, extrusion (the daughter sticks out
+// of its mother), overlap (it intersects a sibling, named in the other
+// column) or skipped (replicas and parameterised volumes, which are
+// constructed not to overlap). The depth is the largest intrusion
+// found, in mm, and the point is where it was found, in the frame of
+// the mother. The points on each daughter are drawn from the random
+// engine of the thread checking it, seeded first from a hash of the
+// layer, the mother and the daughter number, so that the same points are
+// taken on every run, with any number of threads.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. It runs its
+// own threads, which only read the geometry, and it must be run with
+// the geometry open, before the run manager is initialized. Without
+// a multithreaded Geant4 build, the solids and the random engine are
+// not thread-safe, so only one thread is used.
+
+#ifndef GlueXOverlapChecker_h
+#define GlueXOverlapChecker_h 1
+
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4ThreeVector.hh"
+
+#include <vector>
+#include <string>
+#include <map>
+#include <atomic>
+
+class HddsG4Builder;
+
+class GlueXOverlapChecker
+{
+ public:
+   GlueXOverlapChecker(const HddsG4Builder *builder);
+
+   int Run(int nthreads, int resolution, double tolerance,
+           const std::string &reportfile);
+
+   enum check_status_t {
+      kOk,
+      kExtrusion,
+      kOverlap,
+      kSkipped
+   };
+
+ private:
+   GlueXOverlapChecker(const GlueXOverlapChecker &src);
+   GlueXOverlapChecker &operator=(const GlueXOverlapChecker &src);
+
+   struct check_task_t {
+      int layer;
+      G4LogicalVolume *mother;
+      int daughter;
+   };
+   struct check_result_t {
+      check_status_t status;
+      G4VPhysicalVolume *other;
+      double depth;
+      G4ThreeVector point;
+      double seconds;
+   };
+
+   struct check_extent_t {
+      bool valid;
+      G4ThreeVector lower;
+      G4ThreeVector upper;
+   };
+
+   void Check(const check_task_t &task, check_result_t &result) const;
+   void Worker();
+
+   int fResolution;
+   double fTolerance;
+   std::vector<check_task_t> fTasks;
+   std::vector<check_result_t> fResults;
+   std::map<G4LogicalVolume*, std::vector<check_extent_t> > fExtents;
+   std::atomic<int> fNextTask;
+};
+
+#endif
@@ -12,12 +12,18 @@
 
 #include "GlueXPathFinder.hh"
 #include "G4TransportationManager.hh"
+#include "G4EventManager.hh"
+#include "G4TrackingManager.hh"
+#include "G4Event.hh"
+#include "G4Track.hh"
 
-G4VPhysicalVolume* GlueXPathFinder::GetLocatedVolume()
+G4ThreadLocal GlueXPathFinder::step_memo_t *GlueXPathFinder::fMemo = 0;
+
+int GlueXPathFinder::FindWorld()
 {
    // Search through the parallel worlds from highest to lowest
-   // and return the first physical volume found that has a defined
-   // material, or a null pointer if not found.
+   // and return the index of the first one where the located
+   // physical volume has a defined material, or -1 if none.
 
    G4PathFinder *pathfinder = G4PathFinder::GetInstance();
    int Nworlds = G4TransportationManager::GetTransportationManager()
@@ -27,26 +33,80 @@ G4VPhysicalVolume* GlueXPathFinder::GetLocatedVolume()
       G4LogicalVolume *lvol = (pvol)? pvol->GetLogicalVolume() : 0;
       G4Material *mat = (lvol)? lvol->GetMaterial() : 0;
       if (mat)
-         return pvol;
+         return world;
    }
-   return 0;
+   return -1;
+}
+
+GlueXPathFinder::step_memo_t *GlueXPathFinder::GetMemo()
+{
+   // Return the memo for the current step of the track being tracked,
+   // filled in with the result of the search through the worlds, or
+   // a null pointer if no track is being tracked at the moment.
+
+   G4EventManager *evmgr = G4EventManager::GetEventManager();
+   const G4Event *event = (evmgr)? evmgr->GetConstCurrentEvent() : 0;
+   if (event == 0)
+      return 0;
+   const G4Track *track = evmgr->GetTrackingManager()->GetTrack();
+   if (track == 0)
+      return 0;
+   if (fMemo == 0) {
+      fMemo = new step_memo_t;
+      fMemo->event = -1;
+   }
+   if (fMemo->event != event->GetEventID() ||
+       fMemo->track != track->GetTrackID() ||
+       fMemo->step != track->GetCurrentStepNumber() ||
+       fMemo->position != track->GetPosition())
+   {
+      fMemo->event = event->GetEventID();
+      fMemo->track = track->GetTrackID();
+      fMemo->step = track->GetCurrentStepNumber();
+      fMemo->position = track->GetPosition();
+      fMemo->world = FindWorld();
+      fMemo->volume = (fMemo->world < 0)? 0 :
+                      G4PathFinder::GetInstance()->
+                      GetLocatedVolume(fMemo->world);
+      fMemo->touchable = G4TouchableHandle();
+      fMemo->touched = false;
+   }
+   return fMemo;
+}
+
+G4VPhysicalVolume* GlueXPathFinder::GetLocatedVolume()
+{
+   // Return the first physical volume found with a defined material,
+   // searching the parallel worlds from highest to lowest, or a null
+   // pointer if not found.
+
+   step_memo_t *memo = GetMemo();
+   if (memo)
+      return memo->volume;
+   int world = FindWorld();
+   if (world < 0)
+      return 0;
+   return G4PathFinder::GetInstance()->GetLocatedVolume(world);
 }
 
 G4TouchableHandle GlueXPathFinder::CreateTouchableHandle()
 {
-   // Search through the parallel worlds from highest to lowest
-   // and return the first touchable found that has a defined
-   // material, or a null pointer if not found.
+   // Return the first touchable found with a defined material,
+   // searching the parallel worlds from highest to lowest, or a null
+   // pointer if not found. Within a step, the same touchable is
+   // shared by all of the callers.
 
-   G4PathFinder *pathfinder = G4PathFinder::GetInstance();
-   int Nworlds = G4TransportationManager::GetTransportationManager()
-                                          ->GetNoWorlds();
-   for (int world = Nworlds - 1; world >= 0; --world) {
-      G4VPhysicalVolume *pvol = pathfinder->GetLocatedVolume(world);
-      G4LogicalVolume *lvol = (pvol)? pvol->GetLogicalVolume() : 0;
-      G4Material *mat = (lvol)? lvol->GetMaterial() : 0;
-      if (mat)
-         return pathfinder->CreateTouchableHandle(world);
+   step_memo_t *memo = GetMemo();
+   if (memo) {
+      if (! memo->touched && memo->world >= 0) {
+         memo->touchable = G4PathFinder::GetInstance()->
+                           CreateTouchableHandle(memo->world);
+      }
+      memo->touched = true;
+      return memo->touchable;
    }
-   return G4TouchableHandle();
+   int world = FindWorld();
+   if (world < 0)
+      return G4TouchableHandle();
+   return G4PathFinder::GetInstance()->CreateTouchableHandle(world);
 }
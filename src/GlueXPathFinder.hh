@@ -9,6 +9,15 @@
 // for efficient lookup of volume information in a
 // multi-layer mass geometry.
 //
+// The search through the layers is done once per step of
+// the current track, the first time that it is asked for.
+// Later requests in the same step, eg. from the stepping
+// verbose, sensitive detectors or user stepping actions,
+// are answered from a memo of the result, which is keyed
+// on the event, track and step number and the position of
+// the track, so that it is renewed whenever the track has
+// moved on. Outside of tracking the search is always done.
+//
 // In the context of the Geant4 event-level multithreading model,
 // this class is "thread-local", ie. has thread-local state.
 
@@ -26,6 +35,21 @@ class GlueXPathFinder
    static G4TouchableHandle CreateTouchableHandle();
 
  private:
+   struct step_memo_t {
+      int event;
+      int track;
+      int step;
+      G4ThreeVector position;
+      int world;
+      G4VPhysicalVolume *volume;
+      G4TouchableHandle touchable;
+      bool touched;
+   };
+   static step_memo_t *GetMemo();
+   static int FindWorld();
+
+   static G4ThreadLocal step_memo_t *fMemo;
+
    GlueXPathFinder() {}
    GlueXPathFinder(GlueXPathFinder&) {}
    GlueXPathFinder &operator=(GlueXPathFinder&) { return *this; }
@@ -9,6 +9,15 @@
 
 #include <G4TransportationManager.hh>
 #include <G4ParallelWorldPhysics.hh>
+#include <G4StepLimiterPhysics.hh>
+#include <G4ProductionCuts.hh>
+#include <G4Region.hh>
+#include <G4FastSimulationManagerProcess.hh>
+#include <G4ProcessManager.hh>
+#include <G4Gamma.hh>
+#include <G4Electron.hh>
+#include <G4Positron.hh>
+#include <GlueXFastShowerModel.hh>
 
 GlueXPhysicsList::GlueXPhysicsList(const GlueXDetectorConstruction *geometry)
  : QGSP_FTFP_BERT()
@@ -27,4 +36,45 @@ GlueXPhysicsList::GlueXPhysicsList(const GlueXDetectorConstruction *geometry)
     G4String name = geometry->GetParallelWorldName(para);
     RegisterPhysics(new G4ParallelWorldPhysics(name, true));
   }
+
+  // Regions built from hdds with production cuts of their own take the
+  // default cut value for any particle that they leave at zero, and the
+  // step limiter and special cuts processes that enforce G4UserLimits
+  // are only added if some region has user limits.
+
+  const HddsG4Builder *builder = GlueXDetectorConstruction::GetBuilder();
+  bool limited = false;
+  if (builder) {
+    std::map<int, G4Region*> regions = builder->getRegions();
+    std::map<int, G4Region*>::iterator iter;
+    for (iter = regions.begin(); iter != regions.end(); ++iter) {
+      G4ProductionCuts *cuts = iter->second->GetProductionCuts();
+      for (int p=0; cuts && p < 4; ++p) {
+        if (cuts->GetProductionCut(p) <= 0)
+          cuts->SetProductionCut(GetDefaultCutValue(), p);
+      }
+      if (iter->second->GetUserLimits())
+        limited = true;
+    }
+  }
+  if (limited)
+    RegisterPhysics(new G4StepLimiterPhysics());
+}
+
+void GlueXPhysicsList::ConstructProcess()
+{
+  QGSP_FTFP_BERT::ConstructProcess();
+
+  // Showering particles are offered to the fast simulation models of
+  // the FASTSHOWER envelopes, see GlueXFastShowerModel.
+
+  if (GlueXFastShowerModel::IsEnabled()) {
+    G4ParticleDefinition *particles[3] = {G4Gamma::Definition(),
+                                          G4Electron::Definition(),
+                                          G4Positron::Definition()};
+    for (int i=0; i < 3; ++i) {
+      G4ProcessManager *pmanager = particles[i]->GetProcessManager();
+      pmanager->AddDiscreteProcess(new G4FastSimulationManagerProcess());
+    }
+  }
 }
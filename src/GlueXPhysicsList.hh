@@ -20,6 +20,8 @@ class GlueXPhysicsList: public QGSP_FTFP_BERT
 {
  public:
    GlueXPhysicsList(const GlueXDetectorConstruction *geometry=0);
+
+   virtual void ConstructProcess();
 };
 
 #endif
@@ -0,0 +1,135 @@
+//
+// GlueXPointProbe - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+
+#include "GlueXPointProbe.hh"
+#include "GlueXMagneticField.hh"
+
+#include <G4TransportationManager.hh>
+#include <G4PhysicalVolumeStore.hh>
+#include <G4LogicalVolumeStore.hh>
+#include <G4FieldManager.hh>
+#include <G4Material.hh>
+#ifdef G4MULTITHREADED
+#include <G4WorkerThread.hh>
+#endif
+
+GlueXPointProbe::GlueXPointProbe()
+ : fGlobalField(0)
+{
+   G4TransportationManager *tmanager = G4TransportationManager::
+                                       GetTransportationManager();
+   std::vector<G4VPhysicalVolume*>::iterator iter =
+                                             tmanager->GetWorldsIterator();
+   for (int world=0; world < (int)tmanager->GetNoWorlds(); ++world)
+      fWorlds.push_back(iter[world]);
+   G4PhysicalVolumeStore *pvstore = G4PhysicalVolumeStore::GetInstance();
+   for (unsigned int i=0; i < pvstore->size(); ++i)
+      fVolumeIndex[(*pvstore)[i]] = i;
+   G4LogicalVolumeStore *lvstore = G4LogicalVolumeStore::GetInstance();
+   for (unsigned int i=0; i < lvstore->size(); ++i) {
+      G4FieldManager *fieldmgr = (*lvstore)[i]->GetFieldManager();
+      if (fieldmgr)
+         fFields[(*lvstore)[i]] = fieldmgr->GetDetectorField();
+   }
+   G4FieldManager *globalmgr = tmanager->GetFieldManager();
+   fGlobalField = (globalmgr)? globalmgr->GetDetectorField() : 0;
+}
+
+const G4Field *GlueXPointProbe::CloneField(const G4Field *field)
+{
+   // Mapped and computed fields cache their last lookup in the object.
+   const GlueXMappedMagField *mapped =
+                              dynamic_cast<const GlueXMappedMagField*>(field);
+   if (mapped)
+      return new GlueXMappedMagField(*mapped);
+   const GlueXComputedMagField *computed =
+                              dynamic_cast<const GlueXComputedMagField*>(field);
+   if (computed)
+      return new GlueXComputedMagField(*computed);
+   return 0;
+}
+
+GlueXPointProbe::Locator::Locator(const GlueXPointProbe *probe, bool worker)
+ : fProbe(probe),
+   fWorker(worker),
+   fLastLayer(-1)
+{
+#ifdef G4MULTITHREADED
+   if (fWorker)
+      G4WorkerThread::BuildGeometryAndPhysicsVector();
+#endif
+   for (unsigned int world=0; world < probe->fWorlds.size(); ++world) {
+      fNavigators.push_back(new G4Navigator());
+      fNavigators[world]->SetWorldVolume(probe->fWorlds[world]);
+   }
+   if (probe->fGlobalField)
+      fClones[probe->fGlobalField] = CloneField(probe->fGlobalField);
+   std::map<const G4LogicalVolume*, const G4Field*>::const_iterator fiter;
+   for (fiter = probe->fFields.begin(); fiter != probe->fFields.end(); ++fiter)
+   {
+      if (fClones.find(fiter->second) == fClones.end())
+         fClones[fiter->second] = CloneField(fiter->second);
+   }
+}
+
+GlueXPointProbe::Locator::~Locator()
+{
+   std::map<const G4Field*, const G4Field*>::iterator citer;
+   for (citer = fClones.begin(); citer != fClones.end(); ++citer)
+      delete citer->second;
+   for (unsigned int world=0; world < fNavigators.size(); ++world)
+      delete fNavigators[world];
+#ifdef G4MULTITHREADED
+   if (fWorker)
+      G4WorkerThread::DestroyGeometryAndPhysicsVector();
+#endif
+}
+
+void GlueXPointProbe::Locator::Locate(const G4ThreeVector &point,
+                                      point_t &result)
+{
+   result.volume = -1;
+   result.copy = 0;
+   result.layer = -1;
+   result.material = -1;
+   fLastLayer = -1;
+   const G4Field *field = fProbe->fGlobalField;
+   for (int world = fNavigators.size() - 1; world >= 0; --world) {
+      G4VPhysicalVolume *pvol = fNavigators[world]->
+                                LocateGlobalPointAndSetup(point, 0, false);
+      G4LogicalVolume *lvol = (pvol)? pvol->GetLogicalVolume() : 0;
+      if (lvol && lvol->GetMaterial()) {
+         std::map<const G4VPhysicalVolume*, int>::const_iterator viter;
+         viter = fProbe->fVolumeIndex.find(pvol);
+         result.volume = (viter != fProbe->fVolumeIndex.end())?
+                         viter->second : -1;
+         result.copy = pvol->GetCopyNo();
+         result.layer = world;
+         result.material = lvol->GetMaterial()->GetIndex();
+         std::map<const G4LogicalVolume*, const G4Field*>::const_iterator fiter;
+         fiter = fProbe->fFields.find(lvol);
+         if (fiter != fProbe->fFields.end())
+            field = fiter->second;
+         fLastLayer = world;
+         break;
+      }
+   }
+   double B[3] = {0, 0, 0};
+   if (field) {
+      double xglob[4] = {point[0], point[1], point[2], 0};
+      const G4Field *own = fClones[field];
+      ((own)? own : field)->GetFieldValue(xglob, B);
+   }
+   result.B.set(B[0], B[1], B[2]);
+}
+
+G4TouchableHistory *GlueXPointProbe::Locator::CreateTouchable() const
+{
+   if (fLastLayer < 0)
+      return 0;
+   return fNavigators[fLastLayer]->CreateTouchableHistory();
+}
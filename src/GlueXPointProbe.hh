@@ -0,0 +1,93 @@
+//
+// GlueXPointProbe - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Finds the volume, material and magnetic field at arbitrary points in
+// the geometry, for the probePoints call of the python bindings and the
+// query server mode of hdgeant4, see GlueXQueryServer. The tables that
+// it needs, the geometry layers and the fields attached to the logical
+// volumes, are taken from the geometry once it has been initialized,
+// when the probe is constructed. The point is found in each layer in
+// turn from the top, as with picking, and taken from the first layer
+// where it lies in a volume with a material.
+//
+// The points are located by a Locator, which has its own navigators
+// and copies of the field maps, which keep a cache of the last lookup,
+// so that any number of threads can probe the geometry at once, each
+// with a Locator of its own. A Locator made for a thread other than
+// the master sets up the worker copies of the geometry split classes
+// for that thread while it exists.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. Its tables
+// are only read once it is constructed. Each Locator belongs to the
+// thread that created it.
+
+#ifndef GlueXPointProbe_h
+#define GlueXPointProbe_h 1
+
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Navigator.hh"
+#include "G4TouchableHistory.hh"
+#include "G4Field.hh"
+#include "G4ThreeVector.hh"
+
+#include <vector>
+#include <map>
+
+class GlueXPointProbe
+{
+ public:
+   GlueXPointProbe();
+   ~GlueXPointProbe() {}
+
+   struct point_t {
+      int volume;            // index in the physical volume store, or -1
+      int copy;              // copy number of the volume
+      int layer;             // geometry layer where it was found, or -1
+      int material;          // index in the material table, or -1
+      G4ThreeVector B;       // magnetic field, in Geant4 units
+   };
+
+   class Locator {
+    public:
+      Locator(const GlueXPointProbe *probe, bool worker);
+      ~Locator();
+
+      void Locate(const G4ThreeVector &point, point_t &result);
+
+      // Touchable of the volume where the last point was found, to be
+      // deleted by the caller, or 0 if it was outside the geometry.
+      G4TouchableHistory *CreateTouchable() const;
+
+    private:
+      Locator(const Locator &src);
+      Locator &operator=(const Locator &src);
+
+      const GlueXPointProbe *fProbe;
+      bool fWorker;
+      int fLastLayer;
+      std::vector<G4Navigator*> fNavigators;
+      std::map<const G4Field*, const G4Field*> fClones;
+   };
+
+   int GetLayerCount() const {
+      return fWorlds.size();
+   }
+
+ protected:
+   GlueXPointProbe(const GlueXPointProbe &src);
+   GlueXPointProbe &operator=(const GlueXPointProbe &src);
+
+   static const G4Field *CloneField(const G4Field *field);
+
+   std::vector<G4VPhysicalVolume*> fWorlds;
+   std::map<const G4VPhysicalVolume*, int> fVolumeIndex;
+   std::map<const G4LogicalVolume*, const G4Field*> fFields;
+   const G4Field *fGlobalField;
+};
+
+#endif
@@ -6,8 +6,12 @@
 
 #include "GlueXPrimaryGeneratorAction.hh"
 #include "GlueXUserEventInformation.hh"
+#include "GlueXCheckpoint.hh"
 #include "GlueXUserTrackInformation.hh"
 #include "GlueXUserOptions.hh"
+#include "GlueXCalibrationCache.hh"
+#include "GlueXBeamPhotonPool.hh"
+#include "GlueXSubEvents.hh"
 
 #include "G4Event.hh"
 #include "G4ParticleGun.hh"
@@ -16,11 +20,23 @@
 #include "G4SystemOfUnits.hh"
 #include "G4PhysicalConstants.hh"
 #include "Randomize.hh"
+#include "G4Poisson.hh"
+#include "G4Navigator.hh"
+#include "G4TransportationManager.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Material.hh"
 
 #include <JANA/jerror.h>
 #include <JANA/JApplication.h>
 #include <JANA/JCalibration.h>
 
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <stdio.h>
+#include <unistd.h>
+
 typedef GlueXPrimaryGeneratorAction::source_type_t source_type_t;
 typedef GlueXPrimaryGeneratorAction::single_particle_gun_t particle_gun_t;
 typedef GlueXPrimaryGeneratorAction::ImportanceSampler ImportanceSampler;
@@ -28,11 +44,13 @@ typedef GlueXPrimaryGeneratorAction::ImportanceSampler ImportanceSampler;
 int GlueXPrimaryGeneratorAction::instanceCount = 0;
 source_type_t GlueXPrimaryGeneratorAction::fSourceType = SOURCE_TYPE_NONE;
 
-std::ifstream *GlueXPrimaryGeneratorAction::fHDDMinfile = 0;
-hddm_s::istream *GlueXPrimaryGeneratorAction::fHDDMistream = 0;
-CobremsGenerator *GlueXPrimaryGeneratorAction::fCobremsGenerator = 0;
+HddmInput *GlueXPrimaryGeneratorAction::fHDDMinput = 0;
+int GlueXPrimaryGeneratorAction::fInputSlice = 0;
+int GlueXPrimaryGeneratorAction::fInputSlices = 0;
+GlueXBackgroundLibrary *GlueXPrimaryGeneratorAction::fBackgroundLibrary = 0;
+GlueXBeamPhotonPool *GlueXPrimaryGeneratorAction::fBeamPhotonPool = 0;
+CobremsGenerator *GlueXPrimaryGeneratorAction::fCobremsPrototype = 0;
 G4ParticleTable *GlueXPrimaryGeneratorAction::fParticleTable = 0;
-GlueXParticleGun *GlueXPrimaryGeneratorAction::fParticleGun = 0;
 particle_gun_t GlueXPrimaryGeneratorAction::fGunParticle;
 
 double GlueXPrimaryGeneratorAction::fBeamBucketPeriod = 0;
@@ -41,6 +59,10 @@ double GlueXPrimaryGeneratorAction::fBeamBackgroundGateStart = 0;
 double GlueXPrimaryGeneratorAction::fBeamBackgroundGateStop = 0;
 double GlueXPrimaryGeneratorAction::fL1triggerTimeSigma = 10 * ns;
 double GlueXPrimaryGeneratorAction::fBeamStartZ = -24 * m;
+bool GlueXPrimaryGeneratorAction::fBeamFastForward = false;
+double GlueXPrimaryGeneratorAction::fBeamFastForwardZ = 0;
+std::atomic<long> GlueXPrimaryGeneratorAction::fBeamPhotonsForwarded(0);
+std::atomic<long> GlueXPrimaryGeneratorAction::fBeamPhotonsAbsorbed(0);
 double GlueXPrimaryGeneratorAction::fTargetCenterZ = 65 * cm;
 double GlueXPrimaryGeneratorAction::fTargetLength = 29.9746 * cm;
 double GlueXPrimaryGeneratorAction::fBeamDiameter = 0.5 * cm;
@@ -54,13 +76,125 @@ double GlueXPrimaryGeneratorAction::fIncoherentPDFtheta02;
 
 G4Mutex GlueXPrimaryGeneratorAction::fMutex = G4MUTEX_INITIALIZER;
 
-static std::map<int,int> PDGtoGeant3type;
+// Particle type conversion tables. The Geant3 to PDG table was imported
+// from ROOT source file TDatabasePDG.cc, and the PDG to Geant3 table is
+// its inverse, sorted by PDG code for binary search. Both are checked
+// against each other at compile time.
+
+const int kGeant3MaxType = 48;
+
+constexpr int kGeant3ToPdg[kGeant3MaxType + 1] = {
+      0,
+      22,       // 1  photon
+      -11,      // 2  e+
+      11,       // 3  e-
+      12,       // 4  e-neutrino (NB: flavour undefined by Geant)
+      -13,      // 5  mu+
+      13,       // 6  mu-
+      111,      // 7  pi0
+      211,      // 8  pi+
+      -211,     // 9  pi-
+      130,      // 10 K long
+      321,      // 11 K+
+      -321,     // 12 K-
+      2112,     // 13 n
+      2212,     // 14 p
+      -2212,    // 15 anti-proton
+      310,      // 16 K short
+      221,      // 17 eta
+      3122,     // 18 Lambda
+      3222,     // 19 Sigma+
+      3212,     // 20 Sigma0
+      3112,     // 21 Sigma-
+      3322,     // 22 Xi0
+      3312,     // 23 Xi-
+      3334,     // 24 Omega- (PB)
+      -2112,    // 25 anti-neutron
+      -3122,    // 26 anti-Lambda
+      -3222,    // 27 Sigma-
+      -3212,    // 28 Sigma0
+      -3112,    // 29 Sigma+ (PB)
+      -3322,    // 30 Xi0
+      -3312,    // 31 Xi+
+      -3334,    // 32 Omega+ (PB)
+      -15,      // 33 tau+
+      15,       // 34 tau-
+      411,      // 35 D+
+      -411,     // 36 D-
+      421,      // 37 D0
+      -421,     // 38 D0
+      431,      // 39 Ds+
+      -431,     // 40 anti Ds-
+      4122,     // 41 Lamba_c+
+      24,       // 42 W+
+      -24,      // 43 W-
+      23,       // 44 Z
+      0,        // 45 deuteron
+      0,        // 46 triton
+      0,        // 47 alpha
+      0         // 48 G nu ? PDG ID 0 is undefined
+};
+
+struct pdg_geant3_t {
+   int pdg;
+   int g3;
+};
+
+constexpr pdg_geant3_t kPdgToGeant3[] = {
+   {-3334, 32}, {-3322, 30}, {-3312, 31}, {-3222, 27}, {-3212, 28},
+   {-3122, 26}, {-3112, 29}, {-2212, 15}, {-2112, 25}, {-431, 40},
+   {-421, 38},  {-411, 36},  {-321, 12},  {-211, 9},   {-24, 43},
+   {-15, 33},   {-13, 5},    {-11, 2},    {11, 3},     {12, 4},
+   {13, 6},     {15, 34},    {22, 1},     {23, 44},    {24, 42},
+   {111, 7},    {130, 10},   {211, 8},    {221, 17},   {310, 16},
+   {321, 11},   {411, 35},   {421, 37},   {431, 39},   {2112, 13},
+   {2212, 14},  {3112, 21},  {3122, 18},  {3212, 20},  {3222, 19},
+   {3312, 23},  {3322, 22},  {3334, 24},  {4122, 41}
+};
+
+const int kNumPdgTypes = sizeof(kPdgToGeant3) / sizeof(pdg_geant3_t);
+
+constexpr bool pdg_table_sorted(int i)
+{
+   return (i + 1 >= kNumPdgTypes) ||
+          (kPdgToGeant3[i].pdg < kPdgToGeant3[i + 1].pdg &&
+           pdg_table_sorted(i + 1));
+}
+
+constexpr bool pdg_table_inverts(int i)
+{
+   return (i >= kNumPdgTypes) ||
+          (kGeant3ToPdg[kPdgToGeant3[i].g3] == kPdgToGeant3[i].pdg &&
+           pdg_table_inverts(i + 1));
+}
+
+constexpr int geant3_table_count(int g3)
+{
+   return (g3 > kGeant3MaxType)? 0 :
+          (kGeant3ToPdg[g3] != 0) + geant3_table_count(g3 + 1);
+}
+
+static_assert(pdg_table_sorted(0),
+              "kPdgToGeant3 must be sorted by PDG code");
+static_assert(pdg_table_inverts(0),
+              "kPdgToGeant3 must invert kGeant3ToPdg");
+static_assert(geant3_table_count(1) == kNumPdgTypes,
+              "kPdgToGeant3 must cover every type in kGeant3ToPdg");
+
+inline bool pdg_less(const pdg_geant3_t &a, int pdg)
+{
+   return a.pdg < pdg;
+}
 
 //--------------------------------------------
 // GlueXPrimaryGeneratorAction (constructor)
 //--------------------------------------------
 
 GlueXPrimaryGeneratorAction::GlueXPrimaryGeneratorAction()
+ : fCobremsGenerator(0),
+   fParticleGun(0),
+   fBeamForwardZ(0),
+   fBeamForwardReady(false)
 {
    G4AutoLock barrier(&fMutex);
    ++instanceCount;
@@ -69,10 +203,10 @@ GlueXPrimaryGeneratorAction::GlueXPrimaryGeneratorAction()
    // gets read and parsed only once, by the first constructor.
 
    if (fSourceType != SOURCE_TYPE_NONE) {
+      InitThreadGenerators();
       return;
    }
 
-   fParticleGun = new GlueXParticleGun();
    fParticleTable = G4ParticleTable::GetParticleTable();
    
    GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
@@ -87,27 +221,11 @@ GlueXPrimaryGeneratorAction::GlueXPrimaryGeneratorAction()
    std::map<int,double> beampars;
    std::map<int,double> kinepars;
 
-   // Three event source options are supported:
-   // 1) external generator, hddm input stream source
-   // 2) internal coherent bremsstrahlung beam generator
-   // 3) internal particle gun generator
- 
-   if (user_opts->Find("INFILE", infile) ||
-       user_opts->Find("INFI", infile))
-   {
-      fHDDMinfile = new std::ifstream(infile[1].c_str());
-      if (!fHDDMinfile->is_open()) {
-         G4cerr << "GlueXPrimaryGeneratorAction error: "
-                << "Unable to open HDDM input file: " << infile[1]
-                << G4endl;
-         exit(-1);
-      }
-      fHDDMistream = new hddm_s::istream(*fHDDMinfile);
-      G4cout << "Opened input file: " << infile[1] << G4endl;
-      fSourceType = SOURCE_TYPE_HDDM;
-   }
+   // The BEAM card configures the coherent bremsstrahlung beam, which
+   // is either the event source itself, or else the source of the random
+   // beam background superimposed on events from the other sources.
 
-   else if (user_opts->Find("BEAM", beampars))
+   if (user_opts->Find("BEAM", beampars))
    {
       double beamE0 = beampars[1];
       double beamEpeak = beampars[2];
@@ -125,32 +243,88 @@ GlueXPrimaryGeneratorAction::GlueXPrimaryGeneratorAction()
          exit(-1);
       }
 
-      fCobremsGenerator = new CobremsGenerator(beamE0, beamEpeak);
-      fCobremsGenerator->setPhotonEnergyMin(beamEmin);
-      fCobremsGenerator->setCollimatorDistance(radColDist);
-      fCobremsGenerator->setCollimatorDiameter(colDiam);
-      fCobremsGenerator->setBeamEmittance(beamEmit);
-      fCobremsGenerator->setTargetThickness(radThick);
-      prepareCobremsImportanceSamplingPDFs();
+      fCobremsPrototype = new CobremsGenerator(beamE0, beamEpeak);
+      fCobremsPrototype->setPhotonEnergyMin(beamEmin);
+      fCobremsPrototype->setCollimatorDistance(radColDist);
+      fCobremsPrototype->setCollimatorDiameter(colDiam);
+      fCobremsPrototype->setBeamEmittance(beamEmit);
+      fCobremsPrototype->setTargetThickness(radThick);
+      prepareCobremsImportanceSamplingPDFs(fCobremsPrototype);
+
+      std::map<int, double> fwdpars;
+      if (user_opts->Find("BEAMFASTFWD", fwdpars) && fwdpars[1] != 0) {
+         fBeamFastForward = true;
+         fBeamFastForwardZ = fwdpars[2] * cm;
+      }
+   }
 
-      std::map<int, double> bgratepars;
-      std::map<int, double> bggatepars;
-      if (user_opts->Find("BGRATE", bgratepars) &&
-          user_opts->Find("BGGATE", bggatepars))
+   std::map<int, double> bgratepars;
+   std::map<int, double> bggatepars;
+   if (user_opts->Find("BGRATE", bgratepars) &&
+       user_opts->Find("BGGATE", bggatepars))
+   {
+      fBeamBackgroundRate = bgratepars[1] / ns;
+      fBeamBackgroundGateStart = bggatepars[1] * ns;
+      fBeamBackgroundGateStop = bggatepars[2] * ns;
+      if (fBeamBackgroundRate > 0 &&
+          fBeamBackgroundGateStart >= fBeamBackgroundGateStop)
       {
-         fBeamBackgroundRate = bgratepars[1] * 1/s;
-         fBeamBackgroundGateStart = bgratepars[1] * ns;
-         fBeamBackgroundGateStop = bgratepars[2] * ns;
-         if (fBeamBackgroundRate > 0 &&
-             fBeamBackgroundGateStart >= fBeamBackgroundGateStop)
-         {
-            G4cerr << "GlueXPrimaryGeneratorAction error: "
-                   << "BGRATE is non-zero, but the time window specified "
-                   << "in BGGATE is invalid."
-                   << G4endl;
-            exit(-1);
-         }
+         G4cerr << "GlueXPrimaryGeneratorAction error: "
+                << "BGRATE is non-zero, but the time window specified "
+                << "in BGGATE is invalid."
+                << G4endl;
+         exit(-1);
       }
+   }
+
+   std::map<int, std::string> bglibrary;
+   std::map<int, std::string> bgrecord;
+   if (user_opts->Find("BGLIBRARY", bglibrary)) {
+      fBackgroundLibrary = new GlueXBackgroundLibrary(bglibrary[1]);
+      if (! fBackgroundLibrary->is_open()) {
+         G4cerr << "GlueXPrimaryGeneratorAction error: "
+                << "BGLIBRARY card specified in control.in but the "
+                << "library " << bglibrary[1] << " could not be loaded, "
+                << "cannot continue." << G4endl;
+         exit(-1);
+      }
+   }
+   else if (user_opts->Find("BGRECORD", bgrecord)) {
+      double zplane = atof(bgrecord[2].c_str()) * cm;
+      fBackgroundLibrary = new GlueXBackgroundLibrary(bgrecord[1], zplane,
+                                                      fTargetCenterZ);
+   }
+   if (fBeamBackgroundRate > 0 && fCobremsPrototype == 0 &&
+       fBackgroundLibrary == 0)
+   {
+      G4cerr << "GlueXPrimaryGeneratorAction error: "
+             << "BGRATE is non-zero, but there is neither a BEAM card "
+             << "nor a BGLIBRARY card to generate the background from, "
+             << "cannot continue." << G4endl;
+      exit(-1);
+   }
+
+   // Three event source options are supported:
+   // 1) external generator, hddm input stream source
+   // 2) internal coherent bremsstrahlung beam generator
+   // 3) internal particle gun generator
+ 
+   if (user_opts->Find("INFILE", infile) ||
+       user_opts->Find("INFI", infile))
+   {
+      fHDDMinput = OpenInput(infile[1]);
+      if (!fHDDMinput->is_open()) {
+         G4cerr << "GlueXPrimaryGeneratorAction error: "
+                << "Unable to open HDDM input file: " << infile[1]
+                << G4endl;
+         exit(-1);
+      }
+      G4cout << "Opened input file: " << infile[1] << G4endl;
+      fSourceType = SOURCE_TYPE_HDDM;
+   }
+
+   else if (fCobremsPrototype)
+   {
       fSourceType = SOURCE_TYPE_COBREMS_GEN;
    }
 
@@ -180,7 +354,6 @@ GlueXPrimaryGeneratorAction::GlueXPrimaryGeneratorAction()
                 << " was specified in the control.in file." << G4endl;
          exit(-1);
       }
-      fParticleGun->SetParticleDefinition(fGunParticle.partDef);
 
       double x(0), y(0), z(65 * cm);
       std::map<int,double> scappars;
@@ -215,9 +388,54 @@ GlueXPrimaryGeneratorAction::GlueXPrimaryGeneratorAction()
          fGunParticle.phi = 0;
          fGunParticle.deltaPhi = 360 * degree;
       }
+
+      fGunParticle.multiplicity = 1;
+      fGunParticle.smearEach = false;
+      std::map<int,double> multpars;
+      if (user_opts->Find("KINEMULT", multpars)) {
+         if (multpars[1] >= 1)
+            fGunParticle.multiplicity = int(multpars[1]);
+         fGunParticle.smearEach = (multpars[2] != 0);
+      }
       fSourceType = SOURCE_TYPE_PARTICLE_GUN;
    }
 
+   if (fBackgroundLibrary && fBackgroundLibrary->is_recording() &&
+       fSourceType != SOURCE_TYPE_COBREMS_GEN)
+   {
+      G4cerr << "GlueXPrimaryGeneratorAction error: "
+             << "BGRECORD card specified in control.in, but a background "
+             << "library can only be recorded with the BEAM event source, "
+             << "cannot continue." << G4endl;
+      exit(-1);
+   }
+
+   // Beam photons can be generated ahead on separate producer threads,
+   // if they are needed either as the event source or as background.
+
+   std::map<int,int> poolpars;
+   if (fCobremsPrototype && user_opts->Find("BEAMPOOL", poolpars) &&
+       poolpars[1] > 0 && GlueXUserEventInformation::GetEventSeeding())
+   {
+      G4cout << "GlueXPrimaryGeneratorAction: BEAMPOOL card ignored, "
+             << "since the photons it makes ahead cannot be reproduced "
+             << "event by event with EVENTSEEDS." << G4endl;
+   }
+   else if (fCobremsPrototype && user_opts->Find("BEAMPOOL", poolpars) &&
+            poolpars[1] > 0)
+   {
+      bool library = (fBackgroundLibrary &&
+                      ! fBackgroundLibrary->is_recording());
+      if (fSourceType == SOURCE_TYPE_COBREMS_GEN ||
+          (fSourceType == SOURCE_TYPE_HDDM && fBeamBackgroundRate > 0 &&
+           ! library))
+      {
+         int depth = (poolpars[2] > 0)? poolpars[2] : 4096;
+         fBeamPhotonPool = new GlueXBeamPhotonPool(*fCobremsPrototype,
+                                                   poolpars[1], depth);
+      }
+   }
+
    std::map<int,double> trefsigma;
    if (user_opts->Find("trefsigma", trefsigma)) {
       fL1triggerTimeSigma = trefsigma[1] * ns;
@@ -225,14 +443,25 @@ GlueXPrimaryGeneratorAction::GlueXPrimaryGeneratorAction()
    else {
       fL1triggerTimeSigma = 10 * ns;
    }
+
+   std::map<int,int> subpars;
+   if (user_opts->Find("SUBEVENTS", subpars) && subpars[1] > 1)
+      GlueXSubEvents::Configure(subpars[1], subpars[2]);
+
+   InitThreadGenerators();
 }
 
 GlueXPrimaryGeneratorAction::GlueXPrimaryGeneratorAction(const
                              GlueXPrimaryGeneratorAction &src)
- : G4VUserPrimaryGeneratorAction(src)
+ : G4VUserPrimaryGeneratorAction(src),
+   fCobremsGenerator(0),
+   fParticleGun(0),
+   fBeamForwardZ(0),
+   fBeamForwardReady(false)
 {
    G4AutoLock barrier(&fMutex);
    ++instanceCount;
+   InitThreadGenerators();
 }
 
 GlueXPrimaryGeneratorAction &GlueXPrimaryGeneratorAction::operator=(const
@@ -248,26 +477,162 @@ GlueXPrimaryGeneratorAction &GlueXPrimaryGeneratorAction::operator=(const
 
 GlueXPrimaryGeneratorAction::~GlueXPrimaryGeneratorAction()
 {
+   if (fCobremsGenerator)
+      delete fCobremsGenerator;
+   delete fParticleGun;
+
    G4AutoLock barrier(&fMutex);
    if (--instanceCount == 0) {
-      if (fHDDMistream)
-         delete fHDDMistream;
-      if (fHDDMinfile)
-         delete fHDDMinfile;
-      if (fCobremsGenerator)
-         delete fCobremsGenerator;
-      delete fParticleGun;
+      if (fHDDMinput)
+         delete fHDDMinput;
+      if (fBeamPhotonPool)
+         delete fBeamPhotonPool;
+      if (fCobremsPrototype)
+         delete fCobremsPrototype;
+      if (fBackgroundLibrary) {
+         if (fBackgroundLibrary->is_recording())
+            fBackgroundLibrary->Close(fEventCount);
+         delete fBackgroundLibrary;
+      }
+   }
+}
+
+HddmInput *GlueXPrimaryGeneratorAction::OpenInput(const std::string &filename)
+{
+   // Open the input file following the INPREFETCH, SKIP, TRIG, INSLICE
+   // and INFILTER cards, taking only the part of it set by SliceInput.
+
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   int depth = 8;
+   int skip = 0;
+   int trig = 0;
+   int slice = 0;
+   int nslices = 0;
+   std::map<int,int> prefetch_opts;
+   std::map<int,int> skip_opts;
+   std::map<int,int> trig_opts;
+   std::map<int,int> slice_opts;
+   std::map<int,std::string> filter_opts;
+   if (user_opts->Find("INPREFETCH", prefetch_opts))
+      depth = prefetch_opts[1];
+   if (user_opts->Find("SKIP", skip_opts))
+      skip = skip_opts[1];
+   if (user_opts->Find("TRIG", trig_opts))
+      trig = trig_opts[1];
+   if (user_opts->Find("INSLICE", slice_opts)) {
+      slice = slice_opts[1];
+      nslices = slice_opts[2];
+   }
+   HddmInputFilter *filter = 0;
+   if (user_opts->Find("INFILTER", filter_opts))
+      filter = new HddmInputFilter(filter_opts);
+
+   // With a filter, the events done before a checkpoint are counted
+   // among the records that pass it, not the records that were read.
+
+   long int done = GlueXCheckpoint::GetEventsDone();
+   if (done > 0) {
+      if (filter)
+         filter->Skip(done);
+      else
+         skip += done;
+      if (trig > 0)
+         trig -= done;
+   }
+   if (fInputSlices > 1) {
+      if (nslices == 0) {
+         slice = 0;
+         nslices = 1;
+      }
+      slice = slice * fInputSlices + fInputSlice;
+      nslices *= fInputSlices;
+   }
+   return new HddmInput(filename, depth, skip, trig, slice, nslices, filter);
+}
+
+void GlueXPrimaryGeneratorAction::SliceInput(int slice, int nslices)
+{
+   // If the input is already open, as happens in a worker process
+   // forked after the generator was built, it is opened again on its
+   // slice. The old reader belongs to the parent process, and any reader
+   // thread it had did not survive the fork, so it is left alone.
+
+   G4AutoLock barrier(&fMutex);
+   fInputSlice = slice;
+   fInputSlices = nslices;
+   std::map<int,std::string> infile;
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   if (fHDDMinput && (user_opts->Find("INFILE", infile) ||
+                      user_opts->Find("INFI", infile)))
+   {
+      fHDDMinput = OpenInput(infile[1]);
+      if (!fHDDMinput->is_open()) {
+         G4cerr << "GlueXPrimaryGeneratorAction::SliceInput error - "
+                << "Unable to open HDDM input file: " << infile[1]
+                << G4endl;
+         exit(-1);
+      }
    }
 }
 
-void GlueXPrimaryGeneratorAction::prepareCobremsImportanceSamplingPDFs()
+void GlueXPrimaryGeneratorAction::InitThreadGenerators()
+{
+   // Create the generator objects belonging to this instance, which
+   // carry state that changes from one event to the next. The beam
+   // generator is a copy of the prototype configured from control.in,
+   // so that setTargetOrientation() and the reciprocal lattice sums
+   // done for each photon do not interfere between threads.
+
+   fParticleGun = new GlueXParticleGun();
+   if (fSourceType == SOURCE_TYPE_PARTICLE_GUN)
+      fParticleGun->SetParticleDefinition(fGunParticle.partDef);
+   if (fCobremsPrototype)
+      fCobremsGenerator = new CobremsGenerator(*fCobremsPrototype);
+}
+
+int GlueXPrimaryGeneratorAction::NextEventCount()
+{
+   G4AutoLock barrier(&fMutex);
+   return ++fEventCount;
+}
+
+void GlueXPrimaryGeneratorAction::prepareCobremsImportanceSamplingPDFs(
+                                  CobremsGenerator *cobrems)
 {
    // Construct lookup tables representing the PDFs used for
    // importance-sampling the coherent bremsstrahlung kinematics.
+   // If the BEAMPDFCACHE card names a directory, the tables are saved
+   // there in a file named for a hash of the beam parameters, and later
+   // jobs with the same beam load them from it instead of recomputing.
+
+   std::string cachefile;
+   std::string key = cobremsPDFsCacheKey(cobrems);
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   std::map<int, std::string> cache_opts;
+   if (user_opts && user_opts->Find("BEAMPDFCACHE", cache_opts)) {
+      unsigned long long int hash = 14695981039346656037ULL;
+      for (unsigned int i=0; i < key.size(); ++i) {
+         hash ^= (unsigned char)key[i];
+         hash *= 1099511628211ULL;
+      }
+      std::stringstream name;
+      name << cache_opts[1] << "/cobrems_pdfs_"
+           << std::hex << std::setw(16) << std::setfill('0') << hash
+           << ".dat";
+      cachefile = name.str();
+      if (readCobremsPDFs(cachefile, key)) {
+         G4cout << "GlueXPrimaryGeneratorAction: importance-sampling PDFs "
+                << "loaded from cache file " << cachefile << G4endl;
+         fCoherentPDFx.prepareGuide();
+         fIncoherentPDFlogx.prepareGuide();
+         fIncoherentPDFy.prepareGuide();
+         return;
+      }
+   }
 
    const int Ndim = 500;
-   double Emin = fCobremsGenerator->getPhotonEnergyMin() * GeV;
-   double Emax = fCobremsGenerator->getBeamEnergy() * GeV;
+   double Emin = cobrems->getPhotonEnergyMin() * GeV;
+   double Emax = cobrems->getBeamEnergy() * GeV;
    double sum;
 
    // Compute approximate PDF for dNc/dx
@@ -276,9 +641,9 @@ void GlueXPrimaryGeneratorAction::prepareCobremsImportanceSamplingPDFs()
    double xarr[Ndim + 1], yarr[Ndim + 1];
    for (int i=0; i <= Ndim; ++i) {
       xarr[i] = xmin + i * dx;
-      yarr[i] = twopi * fCobremsGenerator->Rate_dNcdxdp(xarr[i], pi/2);
+      yarr[i] = twopi * cobrems->Rate_dNcdxdp(xarr[i], pi/2);
    }
-   fCobremsGenerator->applyBeamCrystalConvolution(Ndim + 1, xarr, yarr);
+   cobrems->applyBeamCrystalConvolution(Ndim + 1, xarr, yarr);
    sum = 0;
    for (int i=0; i <= Ndim; ++i) {
       sum += (i > 0)? (yarr[i] + yarr[i - 1]) / 2 : 0;
@@ -298,7 +663,7 @@ void GlueXPrimaryGeneratorAction::prepareCobremsImportanceSamplingPDFs()
    for (int i=0; i <= Ndim; ++i) {
       double logx = logxmin + i * dlogx;
       double x = exp(logx);
-      double dNidx = fCobremsGenerator->Rate_dNidxdt2(x, 0);
+      double dNidx = cobrems->Rate_dNidxdt2(x, 0);
       double dNidlogx = dNidx * x;
       fIncoherentPDFlogx.randvar.push_back(logx);
       fIncoherentPDFlogx.density.push_back(dNidlogx);
@@ -318,7 +683,7 @@ void GlueXPrimaryGeneratorAction::prepareCobremsImportanceSamplingPDFs()
    for (int i=0; i <= Ndim; ++i) {
       double y = ymin + i * dy;
       double theta2 = fIncoherentPDFtheta02 * (1 / y - 1);
-      double dNidxdt2 = fCobremsGenerator->Rate_dNidxdt2(0.5, theta2);
+      double dNidxdt2 = cobrems->Rate_dNidxdt2(0.5, theta2);
       fIncoherentPDFy.randvar.push_back(y);
       fIncoherentPDFy.density.push_back(dNidxdt2);
       fIncoherentPDFy.integral.push_back(sum);
@@ -334,6 +699,141 @@ void GlueXPrimaryGeneratorAction::prepareCobremsImportanceSamplingPDFs()
    // warnings about Pcut violations.
    fCoherentPDFx.Pcut = .001;
    fIncoherentPDFlogx.Pcut = .001;
+
+   if (cachefile.size() > 0)
+      writeCobremsPDFs(cachefile, key);
+
+   fCoherentPDFx.prepareGuide();
+   fIncoherentPDFlogx.prepareGuide();
+   fIncoherentPDFy.prepareGuide();
+}
+
+std::string GlueXPrimaryGeneratorAction::cobremsPDFsCacheKey(
+                                         CobremsGenerator *gen)
+{
+   // Return a string that identifies all of the parameters on which the
+   // importance-sampling PDFs depend, including the rate model version.
+
+   std::stringstream key;
+   key << std::setprecision(17)
+       << "CobremsGenerator model " << CobremsGenerator::model_version
+       << " crystal " << gen->getTargetCrystal()
+       << " E0 " << gen->getBeamEnergy()
+       << " Erms " << gen->getBeamErms()
+       << " emit " << gen->getBeamEmittance()
+       << " spot " << gen->getCollimatorSpotrms()
+       << " coldist " << gen->getCollimatorDistance()
+       << " coldiam " << gen->getCollimatorDiameter()
+       << " thick " << gen->getTargetThickness()
+       << " mosaic " << gen->getTargetCrystalMosaicSpread()
+       << " theta " << gen->getTargetThetax()
+       << " " << gen->getTargetThetay()
+       << " " << gen->getTargetThetaz()
+       << " Emin " << gen->getPhotonEnergyMin()
+       << " flags " << gen->getCollimatedFlag()
+       << " " << gen->getPolarizedFlag();
+   return key.str();
+}
+
+bool GlueXPrimaryGeneratorAction::readCobremsPDFs(const std::string &cachefile,
+                                                  const std::string &key)
+{
+   // Load the importance-sampling PDFs from the cache file, if it exists
+   // and was written for the same parameters, as given by key.
+
+   std::ifstream fin(cachefile.c_str());
+   if (! fin.is_open())
+      return false;
+   std::string filekey;
+   std::getline(fin, filekey);
+   if (filekey != key)
+      return false;
+   double theta02;
+   if (! (fin >> theta02) ||
+       ! fCoherentPDFx.read(fin) ||
+       ! fIncoherentPDFlogx.read(fin) ||
+       ! fIncoherentPDFy.read(fin))
+   {
+      fCoherentPDFx = ImportanceSampler();
+      fIncoherentPDFlogx = ImportanceSampler();
+      fIncoherentPDFy = ImportanceSampler();
+      return false;
+   }
+   fIncoherentPDFtheta02 = theta02;
+   return true;
+}
+
+void GlueXPrimaryGeneratorAction::writeCobremsPDFs(const std::string &cachefile,
+                                                   const std::string &key)
+{
+   // Save the importance-sampling PDFs to the cache file, replacing any
+   // old one only once the new one is complete, so that other jobs
+   // sharing the cache never see it partially written.
+
+   std::stringstream tmpname;
+   tmpname << cachefile << ".tmp" << getpid();
+   std::string tmpfile = tmpname.str();
+   std::ofstream fout(tmpfile.c_str());
+   if (! fout.is_open()) {
+      G4cerr << "GlueXPrimaryGeneratorAction::writeCobremsPDFs warning - "
+             << "unable to write cache file " << tmpfile
+             << ", continuing without it." << G4endl;
+      return;
+   }
+   fout << key << std::endl
+        << std::setprecision(17) << fIncoherentPDFtheta02 << std::endl;
+   fCoherentPDFx.write(fout);
+   fIncoherentPDFlogx.write(fout);
+   fIncoherentPDFy.write(fout);
+   fout.close();
+   if (rename(tmpfile.c_str(), cachefile.c_str()) != 0) {
+      G4cerr << "GlueXPrimaryGeneratorAction::writeCobremsPDFs warning - "
+             << "unable to replace cache file " << cachefile
+             << ", continuing without it." << G4endl;
+      unlink(tmpfile.c_str());
+   }
+}
+
+void GlueXPrimaryGeneratorAction::ImportanceSampler::write(std::ostream &out)
+                                                            const
+{
+   out << std::setprecision(17) << Pcut << " " << randvar.size() << std::endl;
+   for (unsigned int i=0; i < randvar.size(); ++i) {
+      out << randvar[i] << " " << density[i] << " " << integral[i]
+          << std::endl;
+   }
+}
+
+bool GlueXPrimaryGeneratorAction::ImportanceSampler::read(std::istream &in)
+{
+   int n = 0;
+   if (! (in >> Pcut >> n) || n < 2)
+      return false;
+   randvar.resize(n);
+   density.resize(n);
+   integral.resize(n);
+   for (int i=0; i < n; ++i) {
+      if (! (in >> randvar[i] >> density[i] >> integral[i]))
+         return false;
+   }
+   return true;
+}
+
+void GlueXPrimaryGeneratorAction::ImportanceSampler::prepareGuide()
+{
+   // Build the guide table for sample(), with one entry per bin of the
+   // table, such that guide[j] is the first bin whose upper integral
+   // is not less than j / guide.size().
+
+   int nbins = integral.size() - 1;
+   guide.resize(nbins);
+   int i = 1;
+   for (int j=0; j < nbins; ++j) {
+      double u = j / double(nbins);
+      while (i < nbins && integral[i] < u)
+         ++i;
+      guide[j] = i;
+   }
 }
 
 //--------------------------------------------
@@ -342,22 +842,46 @@ void GlueXPrimaryGeneratorAction::prepareCobremsImportanceSamplingPDFs()
 
 void GlueXPrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 {
-   G4AutoLock barrier(&fMutex);
+   // With the SUBEVENTS card, the bundles queued from events that were
+   // split up come before any new event, which is generated in a scratch
+   // event to be split in its turn, see GlueXSubEvents. A job resumed
+   // from a checkpoint passes over the events done before it, and
+   // otherwise a checkpoint is taken here if one is due, before anything
+   // is drawn from the random engine for the next event.
+
+   if (GlueXSubEvents::IsEnabled() && GlueXSubEvents::Next(anEvent))
+      return;
+   {
+      G4AutoLock barrier(&fMutex);
+      if (fEventCount < GlueXCheckpoint::GetEventsDone()) {
+         ++fEventCount;
+         anEvent->SetEventAborted();
+         return;
+      }
+      GlueXCheckpoint::Update(fEventCount);
+   }
 
+   G4Event *event = anEvent;
+   if (GlueXSubEvents::IsEnabled())
+      event = new G4Event(anEvent->GetEventID());
    switch(fSourceType){
       case SOURCE_TYPE_HDDM:
-         GeneratePrimariesHDDM(anEvent);
+         GeneratePrimariesHDDM(event);
          break;
       case SOURCE_TYPE_COBREMS_GEN:
-         GeneratePrimariesCobrems(anEvent);
+         GeneratePrimariesCobrems(event);
          break;
       case SOURCE_TYPE_PARTICLE_GUN:
-         GeneratePrimariesParticleGun(anEvent);
+         GeneratePrimariesParticleGun(event);
          break;
       default:
          G4cout << "No event source selected, cannot continue!" << G4endl;
          exit(-1);
    }
+   if (event != anEvent) {
+      GlueXSubEvents::Split(event, anEvent);
+      delete event;
+   }
 }   
 
 //--------------------------------------------
@@ -370,53 +894,82 @@ void GlueXPrimaryGeneratorAction::GeneratePrimariesParticleGun(G4Event* anEvent)
    // a message whenever the momentum or energy is changed, unless
    // the other is 0. Here, we reset the particle gun energy using 
    // our own derived class. (Sheesh!!)
-   fParticleGun->Reset();
-
-   // place and smear the particle gun origin
-   G4ThreeVector pos(fGunParticle.pos);
-   if (fGunParticle.deltaR > 0) {
-      double dx, dy;
-      while (true) {
-         double rx = G4UniformRand() - 0.5;
-         double ry = G4UniformRand() - 0.5;
-         if (rx*rx + ry*ry <= 0.25) {
-            dx = rx * 2 * fGunParticle.deltaR;
-            dy = ry * 2 * fGunParticle.deltaR;
-            break;
+   //
+   // With the KINEMULT card, several independent particles are fired
+   // per event, each from its own primary vertex, to spread the fixed
+   // cost of an event over many particles. If requested, the origin is
+   // smeared separately for each particle, otherwise they all share it.
+
+   int count = NextEventCount();
+   anEvent->SetEventID(count);
+   long int eventno = GlueXUserEventInformation::GetEventNumber(count);
+   bool seeded = GlueXUserEventInformation::SeedEvent(eventno);
+
+   std::vector<G4ThreeVector> vertices;
+   std::vector<G4ThreeVector> momenta;
+   for (int n=0; n < fGunParticle.multiplicity; ++n) {
+      fParticleGun->Reset();
+
+      // place and smear the particle gun origin
+      if (n == 0 || fGunParticle.smearEach) {
+         G4ThreeVector pos(fGunParticle.pos);
+         if (fGunParticle.deltaR > 0) {
+            double dx, dy;
+            while (true) {
+               double rx = G4UniformRand() - 0.5;
+               double ry = G4UniformRand() - 0.5;
+               if (rx*rx + ry*ry <= 0.25) {
+                  dx = rx * 2 * fGunParticle.deltaR;
+                  dy = ry * 2 * fGunParticle.deltaR;
+                  break;
+               }
+            }
+            pos += G4ThreeVector(dx, dy, 0);
+         }
+         if (fGunParticle.deltaZ > 0) {
+            double dz = (G4UniformRand() - 0.5) * fGunParticle.deltaZ;
+            pos += G4ThreeVector(0, 0, dz);
          }
+         vertices.push_back(pos);
+      }
+      else {
+         vertices.push_back(vertices[0]);
       }
-      pos += G4ThreeVector(dx, dy, 0);
-   }
-   if (fGunParticle.deltaZ > 0) {
-      double dz = (G4UniformRand() - 0.5) * fGunParticle.deltaZ;
-      pos += G4ThreeVector(0, 0, dz);
-   }
-   fParticleGun->SetParticlePosition(pos);
-
-   // Assign and optionally smear the particle momentum
-   double p = fGunParticle.mom;
-   double thetap = fGunParticle.theta;
-   double phip = fGunParticle.phi;
-   if (fGunParticle.deltaMom > 0)
-      p += (G4UniformRand() - 0.5) * fGunParticle.deltaMom;
-   if (fGunParticle.deltaTheta > 0)
-      thetap += (G4UniformRand() - 0.5) * fGunParticle.deltaTheta;
-   if (fGunParticle.deltaPhi > 0)
-      phip += (G4UniformRand() - 0.5) * fGunParticle.deltaPhi;
-   G4ThreeVector mom(p * sin(thetap) * cos(phip),
-                     p * sin(thetap) * sin(phip),
-                     p * cos(thetap));
-   fParticleGun->SetParticleMomentum(mom);
-
-   // Set the event number and fire the gun
-   anEvent->SetEventID(++fEventCount);
-   fParticleGun->GeneratePrimaryVertex(anEvent);
-
-   // Store generated particle info so it can be written to output file
-   pos *= 1 / cm; // convert to cm
-   mom *= 1 / GeV; // convert to GeV
+      fParticleGun->SetParticlePosition(vertices[n]);
+
+      // Assign and optionally smear the particle momentum
+      double p = fGunParticle.mom;
+      double thetap = fGunParticle.theta;
+      double phip = fGunParticle.phi;
+      if (fGunParticle.deltaMom > 0)
+         p += (G4UniformRand() - 0.5) * fGunParticle.deltaMom;
+      if (fGunParticle.deltaTheta > 0)
+         thetap += (G4UniformRand() - 0.5) * fGunParticle.deltaTheta;
+      if (fGunParticle.deltaPhi > 0)
+         phip += (G4UniformRand() - 0.5) * fGunParticle.deltaPhi;
+      G4ThreeVector mom(p * sin(thetap) * cos(phip),
+                        p * sin(thetap) * sin(phip),
+                        p * cos(thetap));
+      fParticleGun->SetParticleMomentum(mom);
+      momenta.push_back(mom);
+
+      // fire the gun
+      fParticleGun->GeneratePrimaryVertex(anEvent);
+   }
+
+   // Store generated particle info so it can be written to output file,
+   // one vertex per particle so that they can be told apart downstream
+   for (int n=0; n < fGunParticle.multiplicity; ++n) {
+      vertices[n] *= 1 / cm; // convert to cm
+      momenta[n] *= 1 / GeV; // convert to GeV
+   }
    int type = fGunParticle.geantType;
-   anEvent->SetUserInformation(new GlueXUserEventInformation(type, pos, mom));
+   GlueXUserEventInformation *info = new GlueXUserEventInformation(type,
+                                                     vertices, momenta);
+   info->setSerialNumber(count - 1);
+   if (seeded)
+      info->getOutputRecord()->getPhysicsEvent(0).setEventNo(eventno);
+   anEvent->SetUserInformation(info);
 }
 
 //--------------------------------------------
@@ -425,24 +978,33 @@ void GlueXPrimaryGeneratorAction::GeneratePrimariesParticleGun(G4Event* anEvent)
 
 void GlueXPrimaryGeneratorAction::GeneratePrimariesHDDM(G4Event* anEvent)
 {
-   if (! fHDDMinfile->good()) {
+   // Records are decoded ahead of time by the input reader thread,
+   // so here we only need to take the next one from its queue.
+
+   long int serial;
+   hddm_s::HDDM *hddmevent = fHDDMinput->Next(&serial);
+   if (hddmevent == 0) {
       anEvent->SetEventAborted();
       return;
    }
+   {
+      G4AutoLock barrier(&fMutex);
+      ++fEventCount;
 
-   hddm_s::HDDM *hddmevent = new hddm_s::HDDM;
-   try {
-      *fHDDMistream >> *hddmevent;
-   }
-   catch(std::exception e) {
-      G4cout << e.what() << G4endl;
-      anEvent->SetEventAborted();
-      return;
+      extern int run_number;
+      if (fBeamBucketPeriod == 0)
+         getBeamBucketPeriod(run_number);
+         // getBeamBucketPeriod(it_vertex->getRunNo());
    }
 
-   // Store generated event info so it can be written to output file
-   ++fEventCount;
-   anEvent->SetUserInformation(new GlueXUserEventInformation(hddmevent));
+   // Store generated event info so it can be written to output file,
+   // seeding the event from its number in the input first if requested
+   if (hddmevent->getPhysicsEvents().size() > 0)
+      GlueXUserEventInformation::SeedEvent(hddmevent->getPhysicsEvent(0)
+                                                     .getEventNo());
+   GlueXUserEventInformation *info = new GlueXUserEventInformation(hddmevent);
+   info->setSerialNumber(serial);
+   anEvent->SetUserInformation(info);
 
    // Unpack generated event and prepare initial state for simulation
    int Nprimaries = 0;
@@ -482,11 +1044,6 @@ void GlueXPrimaryGeneratorAction::GeneratePrimariesHDDM(G4Event* anEvent)
       // the L1 trigger signal. The spread in the L1 relative to the
       // interacting bunch time is parameterized as a Gaussian.
 
-      extern int run_number;
-      if (fBeamBucketPeriod == 0)
-         getBeamBucketPeriod(run_number);
-         // getBeamBucketPeriod(it_vertex->getRunNo());
-
       double t0, t0rf;
       double lightSpeed = 2.99792e8 * m/s;
       t0 = (origin.getT() * ns) + fL1triggerTimeSigma * G4RandGauss::shoot();
@@ -542,33 +1099,221 @@ void GlueXPrimaryGeneratorAction::GeneratePrimariesHDDM(G4Event* anEvent)
 
    // Superimpose any request background minimum-bias beam interactions
 
-   if (fBeamBackgroundRate > 0) {
-      double t = fBeamBackgroundGateStart;
-      while (true) {
-         t += -log(G4UniformRand()) / fBeamBackgroundRate;
-         if (t > fBeamBackgroundGateStop)
-            break;
-         GenerateBeamPhoton(anEvent, t);
-      }
+   if (fBeamBackgroundRate > 0)
+      GenerateBeamBackground(anEvent);
+}
+
+void GlueXPrimaryGeneratorAction::GenerateBeamBackground(G4Event* anEvent)
+{
+   // Pile-up stage for random beam background. The number of background
+   // photons in the gate is Poisson distributed, and their times are
+   // independent and uniform over the gate, so the whole list for the
+   // event is drawn up front in one pass: first the count, then all of
+   // the times together in one call to the random engine. This gives
+   // the same distribution as stepping through the gate one exponential
+   // interval at a time. The photons are then generated in time order,
+   // either from the cobrems model starting upstream of the collimator,
+   // or else by sampling the background library, in which case the rate
+   // is reduced by the fraction of beam photons that reach its plane.
+
+   double gate = fBeamBackgroundGateStop - fBeamBackgroundGateStart;
+   double mean = fBeamBackgroundRate * gate;
+   if (fBackgroundLibrary && ! fBackgroundLibrary->is_recording())
+      mean *= fBackgroundLibrary->GetYield();
+   int nphotons = G4Poisson(mean);
+   if (nphotons == 0)
+      return;
+   std::vector<double> times(nphotons);
+   G4RandFlat::shootArray(nphotons, &times[0],
+                          fBeamBackgroundGateStart, fBeamBackgroundGateStop);
+   std::sort(times.begin(), times.end());
+
+   if (fBackgroundLibrary && ! fBackgroundLibrary->is_recording()) {
+      int nlib = fBackgroundLibrary->GetSize();
+      std::vector<double> u(nphotons);
+      G4RandFlat::shootArray(nphotons, &u[0]);
+      for (int n=0; n < nphotons; ++n)
+         GenerateLibraryPhoton(anEvent, times[n], int(u[n] * nlib));
+   }
+   else {
+      for (int n=0; n < nphotons; ++n)
+         GenerateBeamPhoton(anEvent, times[n], true);
    }
 }
 
+void GlueXPrimaryGeneratorAction::GenerateLibraryPhoton(G4Event* anEvent,
+                                                        double t0, int i)
+{
+   // Starts photon i from the background library at the library plane,
+   // in the beam bucket identified by t0 as in GenerateBeamPhoton.
+
+   typedef GlueXBackgroundLibrary::photon_t photon_t;
+   const photon_t &rec = fBackgroundLibrary->GetPhoton(i);
+   G4ParticleDefinition *part = fParticleTable->FindParticle("gamma");
+   double zplane = fBackgroundLibrary->GetPlaneZ();
+   G4ThreeVector vtx(rec.x * cm, rec.y * cm, zplane);
+   G4ThreeVector pol(rec.polx, rec.poly, rec.polz);
+
+   double lightSpeed = 2.99792e8 * m/s;
+   double t0rf = fBeamBucketPeriod * int(t0 / fBeamBucketPeriod + 0.5);
+   t0rf += (zplane - fTargetCenterZ) / lightSpeed + rec.dt * ns;
+   G4PrimaryVertex* vertex = new G4PrimaryVertex(vtx, t0rf);
+   G4PrimaryParticle* photon = new G4PrimaryParticle(part, rec.px * GeV,
+                                                     rec.py * GeV,
+                                                     rec.pz * GeV);
+   photon->SetPolarization(pol);
+   vertex->SetPrimary(photon);
+   anEvent->AddPrimaryVertex(vertex);
+}
+
 void GlueXPrimaryGeneratorAction::GeneratePrimariesCobrems(G4Event* anEvent)
 {
+   int count = NextEventCount();
+   GlueXUserEventInformation::SeedEvent(
+                              GlueXUserEventInformation::GetEventNumber(count));
    GenerateBeamPhoton(anEvent, 0);
-   ++fEventCount;
 }
 
 void GlueXPrimaryGeneratorAction::GenerateBeamPhoton(G4Event* anEvent,
-                                                     double t0)
+                                                     double t0,
+                                                     bool background)
 {
    // Generates a single beam photon according to the coherent bremsstrahlung
    // model defined by class CobremsGenerator.  The photon begins its lifetime
    // just upstream of the primary collimator (WARNING: position is hard-wired
    // in the code below) and is tracked by the simulation from there forward.
    // Its time t0 should identify its beam bucket, ie. the time the photon
-   // would reach the midplane of the target. To enable beam motion spreading,
-   // define the beam box size below.
+   // would reach the midplane of the target.
+   // The kinematics are taken ready-made from the beam photon pool if
+   // one was requested with the BEAMPOOL card and it is not empty, and
+   // are otherwise generated here, see GenerateBeamPhotonKinematics.
+   // The transverse position of the photon at the start is where it
+   // meets the collimator, so if BEAMFASTFWD is on, those that fall
+   // outside of the aperture are dropped here if they are background,
+   // and those inside it skip ahead to the first material downstream.
+   // A photon that is the event itself is always tracked, from the
+   // start if it hits the collimator.
+
+   beam_photon_t beam;
+   if (fBeamPhotonPool == 0 || ! fBeamPhotonPool->Pop(beam)) {
+      GenerateBeamPhotonKinematics(fCobremsGenerator, fCoherentStats,
+                                   fIncoherentStats, beam);
+   }
+   double zstart = fBeamStartZ;
+   if (fBeamFastForward) {
+      double rcol = fCobremsGenerator->getCollimatorDiameter() * m / 2;
+      if (beam.vtx.perp2() > rcol * rcol) {
+         if (background) {
+            ++fBeamPhotonsAbsorbed;
+            return;
+         }
+      }
+      else {
+         if (! fBeamForwardReady) {
+            fBeamForwardZ = FindBeamForwardZ();
+            fBeamForwardReady = true;
+         }
+         if (fBeamForwardZ > zstart) {
+            beam.vtx += beam.mom * ((fBeamForwardZ - zstart) / beam.mom.z());
+            zstart = fBeamForwardZ;
+            ++fBeamPhotonsForwarded;
+         }
+      }
+   }
+
+   // Generate a new primary for the beam photon
+   G4ParticleDefinition *part = fParticleTable->FindParticle("gamma");
+   double lightSpeed = 2.99792e8 * m/s;
+   double t0rf = fBeamBucketPeriod * int(t0 / fBeamBucketPeriod + 0.5);
+   t0rf += (zstart - fTargetCenterZ) / lightSpeed;
+   G4PrimaryVertex* vertex = new G4PrimaryVertex(beam.vtx, t0rf);
+   G4PrimaryParticle* photon = new G4PrimaryParticle(part, beam.mom.x(),
+                                                     beam.mom.y(),
+                                                     beam.mom.z());
+   photon->SetPolarization(beam.pol);
+   vertex->SetPrimary(photon);
+   anEvent->AddPrimaryVertex(vertex);
+      
+   // call hitTagger(vertex,vertex,plab,plab,0.,1,0,0)
+}
+
+double GlueXPrimaryGeneratorAction::FindBeamForwardZ()
+{
+   // Return the plane where photons through the collimator aperture are
+   // handed over to the tracking, which unless it was given on the card
+   // is found by walking from fBeamStartZ along the beam axis, through
+   // the collimator hole, up to the first volume filled with anything
+   // denser than the beamline vacuum, stopping 1 mm short of it.
+
+   const double kVacuumDensity = 1e-5 * g/cm3;
+   const int kMaxSteps = 10000;
+   if (fBeamFastForwardZ != 0)
+      return fBeamFastForwardZ;
+   G4Navigator *tracker = G4TransportationManager::GetTransportationManager()
+                                                 ->GetNavigatorForTracking();
+   if (tracker == 0 || tracker->GetWorldVolume() == 0)
+      return fBeamStartZ;
+   G4Navigator navigator;
+   navigator.SetWorldVolume(tracker->GetWorldVolume());
+   G4ThreeVector dir(0, 0, 1);
+   G4ThreeVector pos(0, 0, fBeamStartZ);
+   G4VPhysicalVolume *pvol;
+   pvol = navigator.LocateGlobalPointAndSetup(pos, &dir, false, false);
+   for (int step=0; pvol != 0; ++step) {
+      G4Material *mat = pvol->GetLogicalVolume()->GetMaterial();
+      if (mat != 0 && mat->GetDensity() > kVacuumDensity)
+         break;
+      double safety;
+      double length = navigator.ComputeStep(pos, dir, kInfinity, safety);
+      if (length >= kInfinity || step >= kMaxSteps) {
+         pvol = 0;
+         break;
+      }
+      pos += length * dir;
+      navigator.SetGeometricallyLimitedStep();
+      pvol = navigator.LocateGlobalPointAndSetup(pos, &dir, true);
+   }
+   if (pvol == 0) {
+      G4cerr << "GlueXPrimaryGeneratorAction::FindBeamForwardZ warning - "
+             << "no material found along the beam axis downstream of "
+             << "z = " << fBeamStartZ / cm << " cm, "
+             << "continuing without BEAMFASTFWD." << G4endl;
+      return fBeamStartZ;
+   }
+   double zstop = pos.z() - 1 * mm;
+   if (zstop < fBeamStartZ)
+      zstop = fBeamStartZ;
+   G4AutoLock barrier(&fMutex);
+   static bool reported = false;
+   if (! reported) {
+      G4cout << "GlueXPrimaryGeneratorAction: beam photons through the "
+             << "collimator start at z = " << zstop / cm << " cm, "
+             << "upstream of " << pvol->GetName() << G4endl;
+      reported = true;
+   }
+   return zstop;
+}
+
+void GlueXPrimaryGeneratorAction::PrintBeamStatistics()
+{
+   if (fBeamPhotonsForwarded + fBeamPhotonsAbsorbed == 0)
+      return;
+   G4cout << "GlueXPrimaryGeneratorAction: " << fBeamPhotonsForwarded
+          << " beam photons moved ahead to the first material along the "
+          << "beamline, " << fBeamPhotonsAbsorbed << " background photons "
+          << "dropped outside of the collimator aperture" << G4endl;
+}
+
+void GlueXPrimaryGeneratorAction::GenerateBeamPhotonKinematics(
+                                  CobremsGenerator *cobrems,
+                                  ImportanceSamplerStats &coherentStats,
+                                  ImportanceSamplerStats &incoherentStats,
+                                  beam_photon_t &beam)
+{
+   // Generates the kinematics of a single beam photon using the given
+   // coherent bremsstrahlung generator and sampling statistics, which
+   // belong either to a worker thread or to a beam photon pool producer.
+   // To enable beam motion spreading, define the beam box size below.
 
 #define BEAM_PHOTON_START_Z (-24 * m)
 // #define BEAM_BOX_SIZE (5 * mm)
@@ -633,127 +1378,87 @@ void GlueXPrimaryGeneratorAction::GenerateBeamPhoton(G4Event* anEvent,
 
    double phiMosaic = twopi * G4UniformRand();
    double rhoMosaic = sqrt(-2 * log(G4UniformRand()));
-   rhoMosaic *= fCobremsGenerator->getTargetCrystalMosaicSpread() * m*radian;
+   rhoMosaic *= cobrems->getTargetCrystalMosaicSpread() * m*radian;
    double thxMosaic = rhoMosaic * cos(phiMosaic);
    double thyMosaic = rhoMosaic * sin(phiMosaic);
 
-   double xemittance = fCobremsGenerator->getBeamEmittance() * m;
+   double xemittance = cobrems->getBeamEmittance() * m;
    double yemittance = xemittance / 2.5; // nominal, should be checked
-   double xspotsize = fCobremsGenerator->getCollimatorSpotrms() * m;
+   double xspotsize = cobrems->getCollimatorSpotrms() * m;
    double yspotsize = xspotsize; // nominal, should be checked
    double thxBeam = (xemittance / xspotsize) * sqrt(-2 * log(G4UniformRand()));
    double thyBeam = (yemittance / yspotsize) * sqrt(-2 * log(G4UniformRand()));
 
-   double raddz = fCobremsGenerator->getTargetThickness() * m;
-   double varMS = fCobremsGenerator->Sigma2MS(raddz * G4UniformRand());
+   double raddz = cobrems->getTargetThickness() * m;
+   double varMS = cobrems->Sigma2MS(raddz * G4UniformRand());
    double thxMS = sqrt(-2 * varMS * log(G4UniformRand()));
    double thyMS = sqrt(-2 * varMS * log(G4UniformRand()));
 
-   double targetThetax = fCobremsGenerator->getTargetThetax() * radian;
-   double targetThetay = fCobremsGenerator->getTargetThetay() * radian;
-   double targetThetaz = fCobremsGenerator->getTargetThetaz() * radian;
+   double targetThetax = cobrems->getTargetThetax() * radian;
+   double targetThetay = cobrems->getTargetThetay() * radian;
+   double targetThetaz = cobrems->getTargetThetaz() * radian;
    double thetax = thxBeam + thxMS - targetThetax - thxMosaic;
    double thetay = thyBeam + thyMS - targetThetay - thyMosaic;
    double thetaz = -targetThetaz;
-   fCobremsGenerator->setTargetOrientation(thetax, thetay, thetaz);
+   cobrems->setTargetOrientation(thetax, thetay, thetaz);
 
    // Generate with importance sampling
    double x, phi, theta2;
    double polarization = 0;
-   double Scoherent = fCoherentPDFx.Npassed / 
-                      (fCoherentPDFx.Psum / fCoherentPDFx.Npassed);
-   double Sincoherent = fIncoherentPDFlogx.Npassed /
-                        (fIncoherentPDFlogx.Psum / fIncoherentPDFlogx.Npassed);
+   double Scoherent = coherentStats.Npassed / 
+                      (coherentStats.Psum / coherentStats.Npassed);
+   double Sincoherent = incoherentStats.Npassed /
+                        (incoherentStats.Psum / incoherentStats.Npassed);
    if (Scoherent < Sincoherent) {
       while (true) {                             // try coherent generation
          double dNcdxPDF;
-         double u = G4UniformRand();
-         for (unsigned int i=1; i < fCoherentPDFx.randvar.size(); ++i) {
-            if (u <= fCoherentPDFx.integral[i]) {
-               double x0 = fCoherentPDFx.randvar[i - 1];
-               double x1 = fCoherentPDFx.randvar[i];
-               double f0 = fCoherentPDFx.density[i - 1];
-               double f1 = fCoherentPDFx.density[i];
-               double u0 = fCoherentPDFx.integral[i - 1];
-               double u1 = fCoherentPDFx.integral[i];
-               x = (x0 * (u1 - u) + x1 * (u - u0)) / (u1 - u0);
-               dNcdxPDF = (f0 * (u1 - u) + f1 * (u - u0)) / (u1 - u0);
-               break;
-            }
-         }
-         double dNcdx = twopi * fCobremsGenerator->Rate_dNcdxdp(x, pi / 4);
+         x = fCoherentPDFx.sample(G4UniformRand(), dNcdxPDF);
+         double dNcdx = twopi * cobrems->Rate_dNcdxdp(x, pi / 4);
          double Pfactor = dNcdx / dNcdxPDF;
-         if (Pfactor > fCoherentPDFx.Pmax)
-            fCoherentPDFx.Pmax = Pfactor;
+         if (Pfactor > coherentStats.Pmax)
+            coherentStats.Pmax = Pfactor;
          if (Pfactor > fCoherentPDFx.Pcut) {
             G4cout << "Warning in GenerateBeamPhoton - Pfactor " << Pfactor
                    << " exceeds fCoherentPDFx.Pcut = " << fCoherentPDFx.Pcut
                    << ", please increase." << G4endl;
          }
          if (G4UniformRand() * fCoherentPDFx.Pcut > Pfactor) {
-            ++fCoherentPDFx.Nfailed;
+            ++coherentStats.Nfailed;
             continue;
          }
-         fCoherentPDFx.Psum += Pfactor;
-         ++fCoherentPDFx.Npassed;
+         coherentStats.Psum += Pfactor;
+         ++coherentStats.Npassed;
 
          double fmax = dNcdx / pi;
          while (true) {
             phi = twopi * G4UniformRand();
-            double f = fCobremsGenerator->Rate_dNcdxdp(x, phi);
+            double f = cobrems->Rate_dNcdxdp(x, phi);
             if (G4UniformRand() * fmax < f)
                break;
          }
-         double uq = G4UniformRand();
-         for (unsigned int i=0; i < fCobremsGenerator->fQ2theta2.size(); ++i) {
-            if (uq <= fCobremsGenerator->fQ2weight[i]) {
-               theta2 = fCobremsGenerator->fQ2theta2[i];
-               break;
-            }
-         }
-         polarization = fCobremsGenerator->Polarization(x, theta2);
+         const std::vector<double> &q2weight = cobrems->fQ2weight;
+         double uq = G4UniformRand() * q2weight.back();
+         int iq = std::lower_bound(q2weight.begin(), q2weight.end(), uq) -
+                  q2weight.begin();
+         theta2 = cobrems->fQ2theta2[iq];
+         polarization = cobrems->Polarization(x, theta2);
          break;
       }
    }
    else {
       while (true) {                           // try incoherent generation
          double dNidxdyPDF;
-         double u = G4UniformRand();
-         for (unsigned int i=1; i < fIncoherentPDFlogx.randvar.size(); ++i) {
-            if (u <= fIncoherentPDFlogx.integral[i]) {
-               double logx0 = fIncoherentPDFlogx.randvar[i - 1];
-               double logx1 = fIncoherentPDFlogx.randvar[i];
-               double f0 = fIncoherentPDFlogx.density[i - 1];
-               double f1 = fIncoherentPDFlogx.density[i];
-               double u0 = fIncoherentPDFlogx.integral[i - 1];
-               double u1 = fIncoherentPDFlogx.integral[i];
-               double logx = (logx0 * (u1 - u) + logx1 * (u - u0)) / (u1 - u0);
-               dNidxdyPDF = (f0 * (u1 - u) + f1 * (u - u0)) / (u1 - u0);
-               x = exp(logx);
-               break;
-            }
-         }
-         double y;
-         double uy = G4UniformRand();
-         for (unsigned int i=1; i < fIncoherentPDFy.randvar.size(); ++i) {
-            if (uy <= fIncoherentPDFy.integral[i]) {
-               double y0 = fIncoherentPDFy.randvar[i - 1];
-               double y1 = fIncoherentPDFy.randvar[i];
-               double f0 = fIncoherentPDFy.density[i - 1];
-               double f1 = fIncoherentPDFy.density[i];
-               double u0 = fIncoherentPDFy.integral[i - 1];
-               double u1 = fIncoherentPDFy.integral[i];
-               y = (y0 * (u1 - uy) + y1 * (uy - u0)) / (u1 - u0);
-               dNidxdyPDF *= (f0 * (u1 - uy) + f1 * (uy - u0)) / (u1 - u0);
-               break;
-            }
-         }
+         double logx = fIncoherentPDFlogx.sample(G4UniformRand(), dNidxdyPDF);
+         x = exp(logx);
+         double dNidyPDF;
+         double y = fIncoherentPDFy.sample(G4UniformRand(), dNidyPDF);
+         dNidxdyPDF *= dNidyPDF;
          theta2 = fIncoherentPDFtheta02 * (1 / (y + 1e-99) - 1);
-         double dNidxdy = fCobremsGenerator->Rate_dNidxdt2(x, theta2) *
+         double dNidxdy = cobrems->Rate_dNidxdt2(x, theta2) *
                           fIncoherentPDFtheta02 / (y*y + 1e-99);
          double Pfactor = dNidxdy / dNidxdyPDF;
-         if (Pfactor > fIncoherentPDFlogx.Pmax)
-            fIncoherentPDFlogx.Pmax = Pfactor;
+         if (Pfactor > incoherentStats.Pmax)
+            incoherentStats.Pmax = Pfactor;
          if (Pfactor > fIncoherentPDFlogx.Pcut) {
             G4cout << "Warning in GenerateBeamPhoton - Pfactor " << Pfactor
                    << " exceeds fIncoherentPDFlogx.Pcut = " 
@@ -761,11 +1466,11 @@ void GlueXPrimaryGeneratorAction::GenerateBeamPhoton(G4Event* anEvent,
                    << G4endl;
          }
          if (G4UniformRand() * fIncoherentPDFlogx.Pcut > Pfactor) {
-            ++fIncoherentPDFlogx.Nfailed;
+            ++incoherentStats.Nfailed;
             continue;
          }
-         ++fIncoherentPDFlogx.Psum += Pfactor;
-         ++fIncoherentPDFlogx.Npassed;
+         ++incoherentStats.Psum += Pfactor;
+         ++incoherentStats.Npassed;
 
          phi = twopi * G4UniformRand();
          polarization = 0;
@@ -774,9 +1479,8 @@ void GlueXPrimaryGeneratorAction::GenerateBeamPhoton(G4Event* anEvent,
    }
 
    // Define the particle kinematics and polarization in lab coordinates
-   G4ParticleDefinition *part = fParticleTable->FindParticle("gamma");
-   double Emax = fCobremsGenerator->getBeamEnergy() * GeV;
-   double Erms = fCobremsGenerator->getBeamErms() * GeV;
+   double Emax = cobrems->getBeamEnergy() * GeV;
+   double Erms = cobrems->getBeamErms() * GeV;
    double Ebeam = Emax + Erms * G4RandGauss::shoot();
    double theta = sqrt(theta2) * electron_mass_c2 / Emax;
    double alphax = thxBeam + thxMS + theta * cos(phi);
@@ -786,9 +1490,9 @@ void GlueXPrimaryGeneratorAction::GenerateBeamPhoton(G4Event* anEvent,
    double py = pabs * alphay;
    double pz = sqrt(pabs*pabs - px*px - py*py);
    double colphi = twopi * G4UniformRand();
-   double vspotrms = fCobremsGenerator->getCollimatorSpotrms() * m;
+   double vspotrms = cobrems->getCollimatorSpotrms() * m;
    double colrho = vspotrms * sqrt(-2 * log(G4UniformRand()));
-   double colDist = fCobremsGenerator->getCollimatorDistance() * m;
+   double colDist = cobrems->getCollimatorDistance() * m;
    double radx = colrho * cos(colphi) - colDist * thxBeam;
    double rady = colrho * sin(colphi) - colDist * thyBeam;
    double colx = radx + colDist * alphax;
@@ -797,96 +1501,54 @@ void GlueXPrimaryGeneratorAction::GenerateBeamPhoton(G4Event* anEvent,
    colx += BEAM_BOX_SIZE * (G4UniformRand() - 0.5);
    coly += BEAM_BOX_SIZE * (G4UniformRand() - 0.5);
 #endif
-   G4ThreeVector vtx(colx, coly, fBeamStartZ);
-   G4ThreeVector pol(0, polarization, -polarization * py / pz);
-
-   // Generate a new primary for the beam photon
-   double lightSpeed = 2.99792e8 * m/s;
-   double t0rf = fBeamBucketPeriod * int(t0 / fBeamBucketPeriod + 0.5);
-   t0rf += (fBeamStartZ - fTargetCenterZ) / lightSpeed;
-   G4PrimaryVertex* vertex = new G4PrimaryVertex(vtx, t0rf);
-   G4PrimaryParticle* photon = new G4PrimaryParticle(part, px, py, pz);
-   photon->SetPolarization(pol);
-   vertex->SetPrimary(photon);
-   anEvent->AddPrimaryVertex(vertex);
-      
-   // call hitTagger(vertex,vertex,plab,plab,0.,1,0,0)
+   beam.x = x;
+   beam.theta2 = theta2;
+   beam.phi = phi;
+   beam.polarization = polarization;
+   beam.vtx.set(colx, coly, fBeamStartZ);
+   beam.mom.set(px, py, pz);
+   beam.pol.set(0, polarization, -polarization * py / pz);
 }
 
 // Convert particle types from Geant3 types to PDG scheme
 
 int GlueXPrimaryGeneratorAction::ConvertGeant3ToPdg(int Geant3type)
 {
-   // This method was imported from ROOT source file TDatabasePDG.cc
-
-   switch (Geant3type) {
-
-      case 1   : return 22;       // photon
-      case 25  : return -2112;    // anti-neutron
-      case 2   : return -11;      // e+
-      case 26  : return -3122;    // anti-Lambda
-      case 3   : return 11;       // e-
-      case 27  : return -3222;    // Sigma-
-      case 4   : return 12;       // e-neutrino (NB: flavour undefined by Geant)
-      case 28  : return -3212;    // Sigma0
-      case 5   : return -13;      // mu+
-      case 29  : return -3112;    // Sigma+ (PB)*/
-      case 6   : return 13;       // mu-
-      case 30  : return -3322;    // Xi0
-      case 7   : return 111;      // pi0
-      case 31  : return -3312;    // Xi+
-      case 8   : return 211;      // pi+
-      case 32  : return -3334;    // Omega+ (PB)
-      case 9   : return -211;     // pi-
-      case 33  : return -15;      // tau+
-      case 10  : return 130;      // K long
-      case 34  : return 15;       // tau-
-      case 11  : return 321;      // K+
-      case 35  : return 411;      // D+
-      case 12  : return -321;     // K-
-      case 36  : return -411;     // D-
-      case 13  : return 2112;     // n
-      case 37  : return 421;      // D0
-      case 14  : return 2212;     // p
-      case 38  : return -421;     // D0
-      case 15  : return -2212;    // anti-proton
-      case 39  : return 431;      // Ds+
-      case 16  : return 310;      // K short
-      case 40  : return -431;     // anti Ds-
-      case 17  : return 221;      // eta
-      case 41  : return 4122;     // Lamba_c+
-      case 18  : return 3122;     // Lambda
-      case 42  : return 24;       // W+
-      case 19  : return 3222;     // Sigma+
-      case 43  : return -24;      // W-
-      case 20  : return 3212;     // Sigma0
-      case 44  : return 23;       // Z
-      case 21  : return 3112;     // Sigma-
-      case 45  : return 0;        // deuteron
-      case 22  : return 3322;     // Xi0
-      case 46  : return 0;        // triton
-      case 23  : return 3312;     // Xi-
-      case 47  : return 0;        // alpha
-      case 24  : return 3334;     // Omega- (PB)
-      case 48  : return 0;        // G nu ? PDG ID 0 is undefined
-
-      default  : return 0;
-
-   }
+   if (Geant3type > 0 && Geant3type <= kGeant3MaxType)
+      return kGeant3ToPdg[Geant3type];
+   return 0;
 }
 
 // Convert particle types from PDG scheme to Geant3 types
 
 int GlueXPrimaryGeneratorAction::ConvertPdgToGeant3(int PDGtype)
 {
-   // Invert the table contained in ConvertGeant3ToPdg
+   const pdg_geant3_t *end = kPdgToGeant3 + kNumPdgTypes;
+   const pdg_geant3_t *iter = std::lower_bound(kPdgToGeant3, end,
+                                               PDGtype, pdg_less);
+   return (iter != end && iter->pdg == PDGtype)? iter->g3 : 0;
+}
 
-   int geant3MaxType = 99;
-   if ((int)PDGtoGeant3type.size() < geant3MaxType) {
-      for (int g3type=1; g3type <= geant3MaxType; ++g3type)
-         PDGtoGeant3type[ConvertGeant3ToPdg(g3type)] = g3type;
+G4ParticleDefinition *GlueXPrimaryGeneratorAction::GetParticleDefinition(
+                                                   int Geant3type)
+{
+   // Return the particle definition for a Geant3 type, or null if it
+   // has none, from a table that is filled for each thread on first use.
+
+   static G4ThreadLocal G4ParticleDefinition *partDef[kGeant3MaxType + 1];
+   static G4ThreadLocal int partDefReady = 0;
+   if (! partDefReady) {
+      G4ParticleTable *table = G4ParticleTable::GetParticleTable();
+      partDef[0] = 0;
+      for (int g3type=1; g3type <= kGeant3MaxType; ++g3type) {
+         int pdgtype = kGeant3ToPdg[g3type];
+         partDef[g3type] = (pdgtype != 0)? table->FindParticle(pdgtype) : 0;
+      }
+      partDefReady = 1;
    }
-   return PDGtoGeant3type[PDGtype];
+   if (Geant3type > 0 && Geant3type <= kGeant3MaxType)
+      return partDef[Geant3type];
+   return 0;
 }
 
 double GlueXPrimaryGeneratorAction::getBeamBucketPeriod(int runno)
@@ -895,10 +1557,9 @@ double GlueXPrimaryGeneratorAction::getBeamBucketPeriod(int runno)
    // unless the user has already set the value by hand.
 
    if (runno > 0) {
-      jana::JCalibration *jcalib = japp->GetJCalibration(runno);
       std::map<std::string, double> result;
       std::string map_key("/PHOTON_BEAM/RF/rf_period");
-      if (jcalib->Get(map_key, result)) {
+      if (GlueXCalibrationCache::Get(map_key, result, runno)) {
          G4cerr << "Error in GeneratePrimariesHDDM - "
                 << "error fetching " << map_key << " from ccdb, "
                 << "cannot continue." << G4endl;
@@ -919,10 +1580,17 @@ double GlueXPrimaryGeneratorAction::getBeamBucketPeriod(int runno)
 
 double GlueXPrimaryGeneratorAction::GetMassPDG(int PDGtype)
 {
-   return fParticleTable->FindParticle(PDGtype)->GetPDGMass();
+   G4ParticleDefinition *partDef;
+   int g3type = ConvertPdgToGeant3(PDGtype);
+   if (g3type > 0)
+      partDef = GetParticleDefinition(g3type);
+   else
+      partDef = G4ParticleTable::GetParticleTable()->FindParticle(PDGtype);
+   return (partDef)? partDef->GetPDGMass() : 0;
 }
 
 double GlueXPrimaryGeneratorAction::GetMass(int Geant3Type)
 {
-   return GetMassPDG(ConvertGeant3ToPdg(fGunParticle.geantType));
+   G4ParticleDefinition *partDef = GetParticleDefinition(Geant3Type);
+   return (partDef)? partDef->GetPDGMass() : 0;
 }
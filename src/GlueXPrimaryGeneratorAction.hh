@@ -7,10 +7,23 @@
 // In the context of the Geant4 event-level multithreading model,
 // this class is "thread-local", ie. has thread-local state.
 // Separate object instances are created for each worker thread,
-// but virtually all of its functions need to be serialized, so
-// it maintains its own interlocks for this purpose. Resources
-// are created once when the first object is instantiated, and
-// destroyed once when the last object is destroyed.
+// each with its own particle gun, coherent bremsstrahlung generator
+// and importance-sampling counters, so that events can be generated
+// in parallel. Shared resources (the input stream, the user options
+// and the importance-sampling PDF tables) are created once when the
+// first object is instantiated, are read-only after that except for
+// the input stream, and are destroyed once when the last object is
+// destroyed. The HDDM input stream is thread-safe, see HddmInput, and
+// only updating the event counter is serialized using its own interlock.
+// Random beam background requested with BGRATE is superimposed on each
+// event by a separate pile-up stage, GenerateBeamBackground, optionally
+// sampling a pre-tracked library of beam photons, see GlueXBackgroundLibrary.
+// Beam photon kinematics can also be generated ahead of time on separate
+// producer threads, see GlueXBeamPhotonPool. With the BEAMFASTFWD card,
+// background beam photons that miss the collimator aperture are dropped
+// before tracking, and the rest are moved along their straight lines of
+// flight through the beamline vacuum to just before the first material,
+// see GenerateBeamPhoton.
 
 #ifndef _GLUEXPRIMARYGENERATORACTION_H_
 #define _GLUEXPRIMARYGENERATORACTION_H_
@@ -19,6 +32,8 @@
 #include "G4AutoLock.hh"
 
 #include "CobremsGenerator.hh"
+#include "HddmInput.hh"
+#include "GlueXBackgroundLibrary.hh"
 #include "G4VUserPrimaryGeneratorAction.hh"
 #include "G4ParticleDefinition.hh"
 #include "GlueXParticleGun.hh"
@@ -29,8 +44,11 @@
 #include <HDDM/hddm_s.hpp>
 
 #include <fstream>
+#include <string>
+#include <atomic>
 
 class G4Event;
+class GlueXBeamPhotonPool;
 
 class GlueXPrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 {
@@ -52,21 +70,44 @@ class GlueXPrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
    void GeneratePrimariesHDDM(G4Event* anEvent);
    void GeneratePrimariesParticleGun(G4Event* anEvent);
    void GeneratePrimariesCobrems(G4Event* anEvent);
-   void GenerateBeamPhoton(G4Event* anEvent, double t0);
+   void GenerateBeamPhoton(G4Event* anEvent, double t0,
+                           bool background=false);
+   void GenerateBeamBackground(G4Event* anEvent);
+   void GenerateLibraryPhoton(G4Event* anEvent, double t0, int i);
 
    static int ConvertGeant3ToPdg(int Geant3Type);
    static int ConvertPdgToGeant3(int PDGtype);
    static double GetMassPDG(int PDGtype);
    static double GetMass(int Geant3Type);
+   static G4ParticleDefinition *GetParticleDefinition(int Geant3Type);
+
+   // Report on the beam photons dropped at the collimator and moved
+   // ahead to the first material as requested by the BEAMFASTFWD card.
+   static void PrintBeamStatistics();
+
+   // Divide the INFILE input (or the slice of it selected by INSLICE)
+   // into nslices equal parts and read only the given one of them, as
+   // done by each worker process in the fork mode of hdgeant4.
+   static void SliceInput(int slice, int nslices);
  
  private:
    static int instanceCount;
    static source_type_t fSourceType;
-   static std::ifstream *fHDDMinfile;
-   static hddm_s::istream *fHDDMistream;
-   static CobremsGenerator *fCobremsGenerator;
+   static HddmInput *fHDDMinput;
+   static GlueXBackgroundLibrary *fBackgroundLibrary;
+   static GlueXBeamPhotonPool *fBeamPhotonPool;
+   static CobremsGenerator *fCobremsPrototype;
    static G4ParticleTable *fParticleTable;
-   static GlueXParticleGun *fParticleGun;
+
+   CobremsGenerator *fCobremsGenerator;
+   GlueXParticleGun *fParticleGun;
+
+   void InitThreadGenerators();
+   int NextEventCount();
+
+   static HddmInput *OpenInput(const std::string &filename);
+   static int fInputSlice;
+   static int fInputSlices;
 
  public:
    struct single_particle_gun_t {
@@ -82,6 +123,8 @@ class GlueXPrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
       double deltaMom;
       double deltaTheta;
       double deltaPhi;
+      int multiplicity;
+      bool smearEach;
    };
 
  private:
@@ -94,6 +137,19 @@ class GlueXPrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
    static double fL1triggerTimeSigma;
    static double fBeamStartZ;
 
+   // The BEAMFASTFWD card, with the plane where beam photons are handed
+   // over to the tracking, or 0 to find it by walking along the beam
+   // axis through the geometry, which each thread does for itself the
+   // first time it needs it.
+   static bool fBeamFastForward;
+   static double fBeamFastForwardZ;
+   static std::atomic<long> fBeamPhotonsForwarded;
+   static std::atomic<long> fBeamPhotonsAbsorbed;
+   double fBeamForwardZ;
+   bool fBeamForwardReady;
+
+   double FindBeamForwardZ();
+
    static int fEventCount;
 
    // The following parameters describe the dimensions of the target
@@ -152,32 +208,108 @@ class GlueXPrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 
    // The following tables contain PDFs for importance-sampling the
    // kinematic variables in coherent bremsstrahlung beam generation.
+   // The tables are shared by all threads, and are read-only once
+   // they have been filled. The running statistics of the sampling
+   // are kept separately for each thread. Each table is inverted by
+   // sample(), using a guide table built by prepareGuide() after the
+   // table is filled to jump directly to the bin containing u, or to
+   // within a few bins of it, so that the cost of one sample does not
+   // grow with the size of the table.
  
    struct ImportanceSampler {
       std::vector<double> randvar;
       std::vector<double> density;
       std::vector<double> integral;
-      double Psum;
+      std::vector<int> guide;
       double Pcut;
+
+      ImportanceSampler()
+       : Pcut(1) {}
+
+      void prepareGuide();
+      double sample(double u, double &pdf) const;
+      void write(std::ostream &out) const;
+      bool read(std::istream &in);
+   };
+
+   struct ImportanceSamplerStats {
+      double Psum;
       double Pmax;
       int Nfailed;
       int Npassed;
 
-      ImportanceSampler()
-       : Psum(0), Pcut(1), Pmax(0), Nfailed(0), Npassed(0) {}
+      ImportanceSamplerStats()
+       : Psum(0), Pmax(0), Nfailed(0), Npassed(0) {}
+   };
+
+   // Ready-to-shoot kinematics of one beam photon, as generated by
+   // GenerateBeamPhotonKinematics, starting at z = fBeamStartZ.
+
+   struct beam_photon_t {
+      double x;               // photon energy / electron beam energy
+      double theta2;          // polar angle^2 in units of (me/E0)^2
+      double phi;             // azimuthal angle
+      double polarization;    // degree of linear polarization
+      G4ThreeVector vtx;      // starting point
+      G4ThreeVector mom;      // momentum
+      G4ThreeVector pol;      // polarization vector
    };
 
+   static void GenerateBeamPhotonKinematics(CobremsGenerator *cobrems,
+                                        ImportanceSamplerStats &coherentStats,
+                                        ImportanceSamplerStats &incoherentStats,
+                                        beam_photon_t &beam);
+
+   // Fill the importance-sampling tables from the rates given by cobrems,
+   // as done once for the beam generator, and read them back, which the
+   // benchmark test/sampler_bench also does from outside of a job.
+   static void prepareCobremsImportanceSamplingPDFs(CobremsGenerator *cobrems);
+   static const ImportanceSampler &getCoherentPDFx() {
+      return fCoherentPDFx;
+   }
+   static const ImportanceSampler &getIncoherentPDFlogx() {
+      return fIncoherentPDFlogx;
+   }
+   static const ImportanceSampler &getIncoherentPDFy() {
+      return fIncoherentPDFy;
+   }
+
  private:
    static ImportanceSampler fCoherentPDFx; 
    static ImportanceSampler fIncoherentPDFlogx;
    static ImportanceSampler fIncoherentPDFy;
 
+   ImportanceSamplerStats fCoherentStats;
+   ImportanceSamplerStats fIncoherentStats;
+
    static double fIncoherentPDFtheta02;
 
-   void prepareCobremsImportanceSamplingPDFs();
+   static std::string cobremsPDFsCacheKey(CobremsGenerator *gen);
+   static bool readCobremsPDFs(const std::string &cachefile,
+                               const std::string &key);
+   static void writeCobremsPDFs(const std::string &cachefile,
+                                const std::string &key);
 
  private:
    static G4Mutex fMutex;
 };
 
+inline double GlueXPrimaryGeneratorAction::ImportanceSampler::sample(double u,
+                                                          double &pdf) const
+{
+   // Return the value of randvar at which the cumulative distribution
+   // in integral takes the value u in [0,1), interpolating linearly
+   // within the bin, and the interpolated density at that point in pdf.
+   // The bin is the first one whose upper integral is not less than u.
+
+   int nbins = integral.size() - 1;
+   int i = guide[int(u * guide.size())];
+   while (i < nbins && u > integral[i])
+      ++i;
+   double u0 = integral[i - 1];
+   double u1 = integral[i];
+   pdf = (density[i - 1] * (u1 - u) + density[i] * (u - u0)) / (u1 - u0);
+   return (randvar[i - 1] * (u1 - u) + randvar[i] * (u - u0)) / (u1 - u0);
+}
+
 #endif
@@ -0,0 +1,274 @@
+//
+// GlueXProcessPool - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXProcessPool.hh"
+#include "GlueXPrimaryGeneratorAction.hh"
+#include "GlueXUserEventInformation.hh"
+#include "GlueXUserOptions.hh"
+#include "GlueXSteppingVerbose.hh"
+#include "HddmOutput.hh"
+#include "HddmInput.hh"
+
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+extern int run_number;
+
+// must agree with the limit on the shards that hdgeant4 -m looks for
+const int kMaxShards = 1000;
+
+int GlueXProcessPool::fProcesses = 0;
+int GlueXProcessPool::fWorker = -1;
+int GlueXProcessPool::fRuns = 0;
+long int GlueXProcessPool::fEvents = 0;
+int GlueXProcessPool::fPipe = -1;
+int GlueXProcessPool::fShard = -1;
+std::vector<int> GlueXProcessPool::fShards;
+std::string GlueXProcessPool::fOutputFile;
+int GlueXProcessPool::fOutputDepth = 64;
+int GlueXProcessPool::fOutputWindow = 0;
+int GlueXProcessPool::fOutputKeep = 0;
+HddmOutput *GlueXProcessPool::fOutput = 0;
+
+static bool have_input_file()
+{
+   std::map<int, std::string> infile;
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   return (user_opts->Find("INFILE", infile) ||
+           user_opts->Find("INFI", infile));
+}
+
+void GlueXProcessPool::Configure(int nprocs)
+{
+   // Called once from main, after the random number engine has been
+   // seeded and before the event generators are built.
+
+   fProcesses = (nprocs > 0)? nprocs : 0;
+   if (fProcesses == 0)
+      return;
+   if (! GlueXUserEventInformation::GetEventSeeding()) {
+      const long int *seeds = G4Random::getTheSeeds();
+      long int base = seeds[0] * 2147483563L + seeds[1];
+      GlueXUserEventInformation::SetEventSeeding(base, 0);
+      G4cout << "GlueXProcessPool: events are seeded from their event "
+             << "numbers, with base seed " << base << G4endl;
+   }
+
+   // The input index is built here, if it is needed, so that the
+   // workers do not all try to write it at once.
+
+   std::map<int, std::string> infile;
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   if (user_opts->Find("INFILE", infile) || user_opts->Find("INFI", infile))
+      HddmInput index(infile[1], 0, 0, 0, 0, 1);
+   G4cout << "GlueXProcessPool: events of each run divided between "
+          << fProcesses << " worker processes" << G4endl;
+}
+
+void GlueXProcessPool::SetOutput(const std::string &filename, int depth,
+                                 int window, int keep)
+{
+   // The output is opened by each worker on its own shard, instead
+   // of by main, with the settings from the OUTWRITER card.
+
+   fOutputFile = filename;
+   fOutputDepth = depth;
+   fOutputWindow = window;
+   fOutputKeep = keep;
+}
+
+bool GlueXProcessPool::Fork(long int nevents, long int &count)
+{
+   if ((fRuns + 1) * fProcesses > kMaxShards) {
+      G4cerr << "GlueXProcessPool::Fork error - "
+             << "too many output shards for " << fRuns + 1 << " runs "
+             << "on " << fProcesses << " worker processes, "
+             << "cannot continue." << G4endl;
+      exit(-1);
+   }
+   bool input = have_input_file();
+   if (input && fRuns > 0) {
+      G4cerr << "GlueXProcessPool::Fork error - "
+             << "the INFILE input was divided between the workers of "
+             << "the first run, it cannot be read by another run."
+             << G4endl;
+      exit(-1);
+   }
+
+   // Anything still buffered would be written again by every worker.
+
+   G4cout.flush();
+   G4cerr.flush();
+   std::cout.flush();
+   std::cerr.flush();
+   fflush(0);
+
+   std::chrono::steady_clock::time_point start;
+   start = std::chrono::steady_clock::now();
+   std::vector<pid_t> pids;
+   std::vector<int> pipes;
+   for (int k=0; k < fProcesses; ++k) {
+      int fds[2];
+      if (pipe(fds) != 0) {
+         G4cerr << "GlueXProcessPool::Fork error - "
+                << "unable to create a pipe for worker process " << k
+                << ", cannot continue." << G4endl;
+         exit(-1);
+      }
+      pid_t pid = fork();
+      if (pid == 0) {
+         close(fds[0]);
+         for (unsigned int i=0; i < pipes.size(); ++i)
+            close(pipes[i]);
+         fWorker = k;
+         fPipe = fds[1];
+         long int first = nevents * k / fProcesses;
+         long int last = nevents * (k + 1) / fProcesses;
+         long int offset = GlueXUserEventInformation::GetEventNumber(0) +
+                           fEvents + first;
+         GlueXUserEventInformation::SetEventSeedOffset(offset);
+         HddmOutput::setEventNo(offset);
+         count = last - first;
+         if (input) {
+            GlueXPrimaryGeneratorAction::SliceInput(k, fProcesses);
+            count = nevents;
+         }
+         if (fOutputFile.size() > 0) {
+            fShard = fRuns * fProcesses + k;
+            fOutput = new HddmOutput(HddmOutput::ShardName(fOutputFile,
+                                                           fShard),
+                                     fOutputDepth, fOutputWindow);
+            fOutput->setRunNo(run_number);
+         }
+         return true;
+      }
+      else if (pid < 0) {
+         G4cerr << "GlueXProcessPool::Fork error - "
+                << "unable to start worker process " << k
+                << ", cannot continue." << G4endl;
+         exit(-1);
+      }
+      close(fds[1]);
+      pids.push_back(pid);
+      pipes.push_back(fds[0]);
+   }
+
+   // Each worker writes one line of summary to its pipe just before
+   // it exits, which is read here as the workers finish.
+
+   int failed = 0;
+   long int total_events = 0;
+   double total_cpu = 0;
+   for (int k=0; k < fProcesses; ++k) {
+      std::string summary;
+      char buf[256];
+      ssize_t n;
+      while ((n = read(pipes[k], buf, sizeof(buf))) > 0)
+         summary.append(buf, n);
+      close(pipes[k]);
+      int status = 0;
+      waitpid(pids[k], &status, 0);
+      long int events = 0;
+      double cpu = 0;
+      long int maxrss = 0;
+      int shard = -1;
+      std::stringstream words(summary);
+      if (! WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+          ! (words >> events >> cpu >> maxrss >> shard))
+      {
+         G4cerr << "GlueXProcessPool::Fork error - "
+                << "worker process " << k << " (pid " << pids[k] << ") "
+                << "failed with exit status " << WEXITSTATUS(status);
+         if (WIFSIGNALED(status))
+            G4cerr << ", killed by signal " << WTERMSIG(status);
+         G4cerr << G4endl;
+         ++failed;
+         continue;
+      }
+      G4cout << "GlueXProcessPool: worker " << k << " (pid " << pids[k]
+             << ") ran " << events << " events in " << cpu << " s cpu, "
+             << "peak resident memory " << maxrss / 1024 << " MB"
+             << G4endl;
+      total_events += events;
+      total_cpu += cpu;
+      if (shard >= 0)
+         fShards.push_back(shard);
+   }
+   std::chrono::duration<double> elapsed;
+   elapsed = std::chrono::steady_clock::now() - start;
+   G4cout << "GlueXProcessPool: run " << fRuns << " finished "
+          << total_events << " events on " << fProcesses
+          << " worker processes in " << elapsed.count() << " s, using "
+          << total_cpu << " s cpu" << G4endl;
+   if (failed > 0) {
+      G4cerr << "GlueXProcessPool::Fork error - "
+             << failed << " of the worker processes failed, "
+             << "the output shards have been left in place, "
+             << "cannot continue." << G4endl;
+      exit(-1);
+   }
+   fEvents += nevents;
+   ++fRuns;
+   return false;
+}
+
+void GlueXProcessPool::Exit(long int nevents)
+{
+   // Close the output shard and report back to main. The worker leaves
+   // with _exit, because the objects it shares with main, such as the
+   // reader thread of the input, were not copied by the fork and must
+   // not be cleaned up here.
+
+   if (fOutput)
+      delete fOutput;
+   fOutput = 0;
+   GlueXSteppingVerbose::FlushThread(true);
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+   double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+                usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+   std::stringstream summary;
+   summary << nevents << " " << cpu << " " << usage.ru_maxrss << " "
+           << fShard << std::endl;
+   std::string line = summary.str();
+   if (write(fPipe, line.c_str(), line.size()) != (ssize_t)line.size()) {
+      G4cerr << "GlueXProcessPool::Exit warning - "
+             << "unable to send the summary of worker " << fWorker
+             << " to the main process." << G4endl;
+   }
+   close(fPipe);
+   G4cout.flush();
+   G4cerr.flush();
+   std::cout.flush();
+   std::cerr.flush();
+   fflush(0);
+   _exit(0);
+}
+
+void GlueXProcessPool::Finish()
+{
+   if (fProcesses == 0 || fRuns == 0 || fOutputFile.size() == 0)
+      return;
+   else if (fOutputKeep) {
+      G4cout << "GlueXProcessPool: output left in the shards of "
+             << fOutputFile << ", they can be merged with hdgeant4 -m"
+             << G4endl;
+   }
+   else {
+      HddmOutput::MergeShards(fOutputFile, fShards);
+   }
+}
@@ -0,0 +1,83 @@
+//
+// GlueXProcessPool - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// This class runs the events of each /run/beamOn on a pool of worker
+// processes forked from the main process, for sites where the jana
+// and ccdb plugins cannot be used from several threads, so that the
+// G4MTRunManager is not an option. The main process does all of the
+// initialization once, including the geometry, the field maps, the
+// physics tables and the event generators, and the workers are forked
+// from it at the start of each run, so that they share all of these
+// tables with it copy-on-write instead of each building its own copy.
+// This is the -f option of hdgeant4, which gives the number of worker
+// processes. Each worker runs its events one at a time with the
+// sequential run manager, so it cannot be combined with -t.
+//
+// The events of a run are divided between the workers in contiguous
+// ranges of event numbers. Events from the particle gun and the beam
+// generator are seeded one by one from their event numbers, as with
+// the EVENTSEEDS card, which is turned on with the seeds from RNDM as
+// the base if it is not given, so that the results do not depend on
+// the number of workers. With INFILE input, each worker reads its own
+// slice of the input, as with the INSLICE card, and the run ends for
+// each worker at the end of its slice. Each worker writes its own
+// shard of the OUTFILE, named as the shards of OUTSHARDS, and sends a
+// summary back to the main process when it is done, including the id of
+// its shard. The main process prints the summaries of all the workers at
+// the end of each run, and merges exactly the shards listed in them into
+// the OUTFILE at the end of the job, unless OUTSHARDS 1 asks for them to
+// be kept.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. It is only
+// used from the master thread, before any worker threads are started.
+
+#ifndef GlueXProcessPool_h
+#define GlueXProcessPool_h 1
+
+#include <string>
+#include <vector>
+
+class HddmOutput;
+
+class GlueXProcessPool
+{
+ public:
+   static void Configure(int nprocs);
+   static void SetOutput(const std::string &filename, int depth, int window,
+                         int keep);
+
+   static int GetProcessCount() {
+      return fProcesses;
+   }
+
+   // Fork the workers for a run of nevents events. Returns true in each
+   // worker, with the number of events it is to run in count, or false
+   // in the main process once all of the workers have finished.
+   static bool Fork(long int nevents, long int &count);
+   // End the worker process, after it has run nevents events.
+   static void Exit(long int nevents);
+   // Merge the output shards of the workers, at the end of the job.
+   static void Finish();
+
+ private:
+   GlueXProcessPool() {}
+
+   static int fProcesses;       // number of worker processes, or 0
+   static int fWorker;          // index of this worker, or -1 in main
+   static int fRuns;            // number of runs forked so far
+   static long int fEvents;     // number of events in those runs
+   static int fPipe;            // summary pipe to main, in a worker
+   static int fShard;           // output shard id, in a worker, or -1
+   static std::vector<int> fShards;  // shards written, in main
+   static std::string fOutputFile;
+   static int fOutputDepth;
+   static int fOutputWindow;
+   static int fOutputKeep;
+   static HddmOutput *fOutput;  // output shard, in a worker
+};
+
+#endif
@@ -0,0 +1,275 @@
+//
+// GlueXQueryServer - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+
+#include "GlueXQueryServer.hh"
+#include "GlueXVolumeIdentifiers.hh"
+
+#include <G4Material.hh>
+#include <G4SystemOfUnits.hh>
+#include <G4ios.hh>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sstream>
+#include <thread>
+#include <chrono>
+
+volatile sig_atomic_t GlueXQueryServer::fStopping = 0;
+std::atomic<int> GlueXQueryServer::fActive(0);
+std::atomic<long> GlueXQueryServer::fConnections(0);
+std::atomic<long> GlueXQueryServer::fRequests(0);
+std::atomic<long> GlueXQueryServer::fPoints(0);
+G4Mutex GlueXQueryServer::fMutex = G4MUTEX_INITIALIZER;
+
+GlueXQueryServer::GlueXQueryServer(const std::string &socketpath)
+ : fSocketPath(socketpath)
+{
+   fProbe = new GlueXPointProbe();
+}
+
+GlueXQueryServer::~GlueXQueryServer()
+{
+   delete fProbe;
+}
+
+void GlueXQueryServer::Stop(int signum)
+{
+   fStopping = 1;
+}
+
+int GlueXQueryServer::Run()
+{
+   // Listen on the socket and serve the clients that connect to it,
+   // until asked to stop. The return value is 0 on a normal shutdown,
+   // or 1 if the socket could not be set up.
+
+   struct sockaddr_un addr;
+   if (fSocketPath.size() >= sizeof(addr.sun_path)) {
+      G4cerr << "GlueXQueryServer::Run error - "
+             << "socket path " << fSocketPath << " is too long, "
+             << "cannot continue." << G4endl;
+      return 1;
+   }
+   int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   strncpy(addr.sun_path, fSocketPath.c_str(), sizeof(addr.sun_path) - 1);
+   unlink(fSocketPath.c_str());
+   if (sock < 0 || bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+       listen(sock, 64) != 0)
+   {
+      G4cerr << "GlueXQueryServer::Run error - "
+             << "unable to listen on socket " << fSocketPath << ": "
+             << strerror(errno) << ", cannot continue." << G4endl;
+      if (sock >= 0)
+         close(sock);
+      return 1;
+   }
+   signal(SIGINT, Stop);
+   signal(SIGTERM, Stop);
+   signal(SIGPIPE, SIG_IGN);
+   G4cout << "GlueXQueryServer listening on " << fSocketPath << G4endl;
+
+   while (! fStopping) {
+      struct pollfd pfd;
+      pfd.fd = sock;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      if (poll(&pfd, 1, 200) <= 0)
+         continue;
+      int client = accept(sock, 0, 0);
+      if (client < 0)
+         continue;
+      ++fConnections;
+#ifdef G4MULTITHREADED
+      {
+         G4AutoLock barrier(&fMutex);
+         fClients.insert(client);
+      }
+      ++fActive;
+      std::thread(&GlueXQueryServer::Serve, this, client, true).detach();
+#else
+      ++fActive;
+      Serve(client, false);
+#endif
+   }
+
+   // Clients still connected are cut off, and their threads finish up
+   // before the geometry can be taken down.
+   {
+      G4AutoLock barrier(&fMutex);
+      std::set<int>::iterator iter;
+      for (iter = fClients.begin(); iter != fClients.end(); ++iter)
+         shutdown(*iter, SHUT_RDWR);
+   }
+   while (fActive > 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   close(sock);
+   unlink(fSocketPath.c_str());
+
+   G4cout << "GlueXQueryServer statistics:" << G4endl
+          << "   " << fConnections << " connections" << G4endl
+          << "   " << fRequests << " requests" << G4endl
+          << "   " << fPoints << " points" << G4endl;
+   return 0;
+}
+
+void GlueXQueryServer::Serve(int client, bool worker)
+{
+   // Answer the requests sent on one connection, until the client
+   // closes it or asks for the server to stop.
+
+   {
+      GlueXPointProbe::Locator locator(fProbe, worker);
+      std::vector<int> keys;
+      std::string buffer;
+      size_t next = 0;
+      std::string line;
+      std::string reply;
+      while (ReadLine(client, buffer, next, line)) {
+         std::istringstream request(line);
+         std::string word;
+         if (! (request >> word))
+            continue;
+         ++fRequests;
+         reply.clear();
+         if (word == "POINTS") {
+            long int npoints = -1;
+            request >> npoints;
+            if (npoints < 0) {
+               reply = "error POINTS needs the number of points\n";
+               npoints = 0;
+            }
+            for (long int n=0; n < npoints; ++n) {
+               double x, y, z;
+               if (! ReadLine(client, buffer, next, line))
+                  break;
+               std::istringstream coords(line);
+               if (coords >> x >> y >> z)
+                  Answer(locator, G4ThreeVector(x*cm, y*cm, z*cm), keys,
+                         reply);
+               else
+                  reply += "error expected x y z, found " + line + "\n";
+            }
+         }
+         else if (word == "IDENT") {
+            keys.clear();
+            std::string name;
+            while (request >> name)
+               keys.push_back(GlueXVolumeIdentifiers::GetKey(name));
+            reply = "ok\n";
+         }
+         else if (word == "QUIT") {
+            break;
+         }
+         else if (word == "SHUTDOWN") {
+            fStopping = 1;
+            break;
+         }
+         else {
+            std::istringstream coords(line);
+            double x, y, z;
+            if (coords >> x >> y >> z)
+               Answer(locator, G4ThreeVector(x*cm, y*cm, z*cm), keys, reply);
+            else
+               reply = "error unknown request " + line + "\n";
+         }
+         if (! WriteAll(client, reply))
+            break;
+      }
+   }
+   {
+      G4AutoLock barrier(&fMutex);
+      fClients.erase(client);
+   }
+   close(client);
+   --fActive;
+}
+
+void GlueXQueryServer::Answer(GlueXPointProbe::Locator &locator,
+                              const G4ThreeVector &point,
+                              const std::vector<int> &keys,
+                              std::string &reply) const
+{
+   GlueXPointProbe::point_t found;
+   locator.Locate(point, found);
+   ++fPoints;
+   char field[80];
+   snprintf(field, sizeof(field), "%d ", found.layer);
+   reply += field;
+   G4TouchableHistory *touch = locator.CreateTouchable();
+   if (touch) {
+      for (int depth = touch->GetHistoryDepth(); depth >= 0; --depth) {
+         reply += "/" + touch->GetVolume(depth)->GetName();
+         snprintf(field, sizeof(field), ":%d", touch->GetReplicaNumber(depth));
+         reply += field;
+      }
+      reply += " " + (*G4Material::GetMaterialTable())[found.material]->
+                     GetName();
+   }
+   else {
+      reply += "- -";
+   }
+   snprintf(field, sizeof(field), " %.7g %.7g %.7g", found.B[0] / tesla,
+            found.B[1] / tesla, found.B[2] / tesla);
+   reply += field;
+   for (unsigned int i=0; i < keys.size(); ++i) {
+      int ident = (touch && keys[i] >= 0)?
+                  GlueXVolumeIdentifiers::GetIdent(keys[i], touch) : -1;
+      snprintf(field, sizeof(field), " %d", ident);
+      reply += field;
+   }
+   reply += "\n";
+   if (touch)
+      delete touch;
+}
+
+bool GlueXQueryServer::ReadLine(int client, std::string &buffer,
+                                size_t &next, std::string &line)
+{
+   // Take the next line from the buffer, starting at offset next, and
+   // read more from the client as needed, returning false when the
+   // connection is closed.
+
+   size_t eol;
+   while ((eol = buffer.find('\n', next)) == buffer.npos) {
+      buffer.erase(0, next);
+      next = 0;
+      char chunk[65536];
+      ssize_t nread = recv(client, chunk, sizeof(chunk), 0);
+      if (nread < 0 && errno == EINTR)
+         continue;
+      else if (nread <= 0)
+         return false;
+      buffer.append(chunk, nread);
+   }
+   line.assign(buffer, next, eol - next);
+   next = eol + 1;
+   return true;
+}
+
+bool GlueXQueryServer::WriteAll(int client, const std::string &reply)
+{
+   size_t sent = 0;
+   while (sent < reply.size()) {
+      ssize_t nsent = send(client, reply.data() + sent, reply.size() - sent,
+                           MSG_NOSIGNAL);
+      if (nsent < 0 && errno == EINTR)
+         continue;
+      else if (nsent <= 0)
+         return false;
+      sent += nsent;
+   }
+   return true;
+}
@@ -0,0 +1,88 @@
+//
+// GlueXQueryServer - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Answers queries about points in the geometry, for reconstruction and
+// validation programs that would otherwise start a whole simulation job
+// each time to find where a point lies or what the field is there. This
+// is the -q<socket> mode of hdgeant4: once the geometry and the fields
+// have been initialized, the server listens on a unix-domain socket at
+// the given path, and answers requests from any number of clients at
+// once until it gets a SHUTDOWN request, or a SIGINT or SIGTERM.
+//
+// The requests and replies are lines of text. A request for a batch of
+// points is a line POINTS n followed by n lines with x y z in cm, and a
+// line with just x y z is a batch of one. For every point the reply is a
+// line with
+//
+//    layer path material Bx By Bz [ident ...]
+//
+// where layer is the geometry layer where it was found, see
+// GlueXPointProbe, path is the list of volumes from the world down to
+// the one containing the point, each as /name:copy, material is the
+// name of its material and B is the magnetic field in Tesla. A point
+// outside the geometry has layer -1, path and material -, and the field
+// of the world. The identifiers are the values of the HDDS identifiers
+// named on the last request IDENT name ... on the connection, such as
+// ring and straw, or -1 where the point is not in a volume that defines
+// them. IDENT is answered with ok, an unknown request with error and a
+// description, and QUIT closes the connection. The replies to a batch
+// are sent together, so clients get the best throughput by sending the
+// points they need in large batches over a connection that they keep
+// open, see test/geomquery.py.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. Each client
+// connection is served on a thread of its own, with its own Locator,
+// see GlueXPointProbe. Without a multithreaded Geant4 build the clients
+// are served one at a time on the master thread.
+
+#ifndef GlueXQueryServer_h
+#define GlueXQueryServer_h 1
+
+#include "GlueXPointProbe.hh"
+#include "G4Threading.hh"
+#include "G4AutoLock.hh"
+
+#include <signal.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <atomic>
+
+class GlueXQueryServer
+{
+ public:
+   GlueXQueryServer(const std::string &socketpath);
+   ~GlueXQueryServer();
+
+   int Run();
+
+ private:
+   GlueXQueryServer(const GlueXQueryServer &src);
+   GlueXQueryServer &operator=(const GlueXQueryServer &src);
+
+   void Serve(int client, bool worker);
+   void Answer(GlueXPointProbe::Locator &locator, const G4ThreeVector &point,
+               const std::vector<int> &keys, std::string &reply) const;
+
+   static bool ReadLine(int client, std::string &buffer, size_t &next,
+                        std::string &line);
+   static bool WriteAll(int client, const std::string &reply);
+   static void Stop(int signum);
+
+   std::string fSocketPath;
+   GlueXPointProbe *fProbe;
+   std::set<int> fClients;
+
+   static volatile sig_atomic_t fStopping;
+   static std::atomic<int> fActive;
+   static std::atomic<long> fConnections;
+   static std::atomic<long> fRequests;
+   static std::atomic<long> fPoints;
+   static G4Mutex fMutex;
+};
+
+#endif
@@ -5,62 +5,103 @@
 // version: may 12, 2012
 
 #include "GlueXRunAction.hh"
+#include "GlueXDetectorConstruction.hh"
+#include "GlueXMagneticField.hh"
+#include "GlueXEventFilter.hh"
+#include "GlueXTrackKiller.hh"
+#include "GlueXFastShowerModel.hh"
+#include "GlueXStepProfiler.hh"
+#include "GlueXTelemetry.hh"
+#include "GlueXSteppingVerbose.hh"
+#include "GlueXPrimaryGeneratorAction.hh"
+#include "HddmInputFilter.hh"
+#include "GlueXSubEvents.hh"
 
 #include "G4Run.hh"
 
 #include "G4MTRunManager.hh"
-#include "G4PhysicalVolumeStore.hh"
 #include "G4VPhysicalVolume.hh"
-#include "G4PVDivision.hh"
-
-#include "assert.h"
 
 G4Mutex GlueXRunAction::fMutex = G4MUTEX_INITIALIZER;
 
+GlueXRunAction::~GlueXRunAction()
+{
+   for (unsigned int i=0; i < fDivisionRotations.size(); ++i)
+      delete fDivisionRotations[i];
+
+   // The worker threads are done when their run actions are deleted.
+   GlueXDetectorConstruction::ReleaseFieldLocator();
+}
+
 void GlueXRunAction::BeginOfRunAction(const G4Run* aRun)
 {
-   G4AutoLock barrier(&fMutex);
    G4cout << "### Run " << aRun->GetRunID() << " start." << G4endl;
 
+   // The volumes named on the KILL cards are looked up once, by the
+   // first thread to start a run, see GlueXTrackKiller.
+
+   GlueXTrackKiller::Prepare();
+   GlueXStepProfiler::Prepare();
+   GlueXTelemetry::BeginOfRun(aRun->GetRunID());
+
    // This section was added to deal with a specific bug related to
    // GPVDivision volumes that need to have a thread-local instance
    // of the rotation matrix. As soon as the Geant4 team releases a
-   // proper fix for this bug, this section can go away.
+   // proper fix for this bug, this section can go away. The list of
+   // divisions is made once when the geometry is built, and the clones
+   // are made on the first run on each worker and kept until the thread
+   // exits, so starting a run takes no lock. The rotation of a division
+   // is only set again if it has been reset since the last run.
 
    G4RunManager::RMType rmtype = G4RunManager::GetRunManager()->
                                                GetRunManagerType();
    if (rmtype == G4RunManager::workerRM) {
-      G4PhysicalVolumeStore* const physVolStore = 
-                             G4PhysicalVolumeStore::GetInstance();
-      assert (physVolStore != NULL);
-      for (G4PhysicalVolumeStore::const_iterator iter = physVolStore->begin();
-           iter != physVolStore->end();
-           ++iter)
+      const HddsG4Builder *builder = GlueXDetectorConstruction::GetBuilder();
+      if (builder == 0)
+         return;
+      const std::vector<G4VPhysicalVolume*> &divisions =
+                                            builder->getDivisions();
+      for (unsigned int i=fDivisionRotations.size();
+           i < divisions.size(); ++i)
       {
-         G4VPhysicalVolume *pvol = *iter;
-         if (dynamic_cast<G4PVDivision*>(pvol)) {
-            G4RotationMatrix *masterRmat = pvol->GetRotation();
-            G4RotationMatrix *workerRmat;
-            if (masterRmat)
-               workerRmat = new G4RotationMatrix(*masterRmat);
-            else
-               workerRmat = new G4RotationMatrix();
-            pvol->SetRotation(workerRmat);
-            usedRmatrix.push_back(workerRmat);
-         }
+         G4RotationMatrix *masterRmat = divisions[i]->GetRotation();
+         if (masterRmat)
+            fDivisionRotations.push_back(new G4RotationMatrix(*masterRmat));
+         else
+            fDivisionRotations.push_back(new G4RotationMatrix());
+      }
+      for (unsigned int i=0; i < divisions.size(); ++i) {
+         if (divisions[i]->GetRotation() != fDivisionRotations[i])
+            divisions[i]->SetRotation(fDivisionRotations[i]);
       }
    }
 }
 
 void GlueXRunAction::EndOfRunAction(const G4Run*)
 {
-   // Clean up the thread-local clones of G4RotationMatrix that were
-   // created in the BeginOfRunAction. As soon as the Geant4 team 
-   // releases a proper fix for this bug, this section can go away.
- 
-   std::list<G4RotationMatrix*>::iterator iter;
-   for (iter = usedRmatrix.begin(); iter != usedRmatrix.end(); ++iter)
-      delete *iter;
-   usedRmatrix.clear();
+   // Report on the magnetic field lookup cache for this thread
+
+   G4AutoLock barrier(&fMutex);
+   GlueXComputedMagField::PrintCacheStatistics();
+
+   // Each thread adds its tracking profile to the totals for the run,
+   // see GlueXStepProfiler.
 
+   GlueXStepProfiler::Merge();
+   GlueXTelemetry::EndOfRun();
+   GlueXSteppingVerbose::FlushThread(true);
+
+   // The master finishes its run after all of the workers, so it
+   // reports on the event filters for the whole job.
+
+   if (G4Threading::IsMasterThread()) {
+      HddmInputFilter::PrintStatistics();
+      GlueXPrimaryGeneratorAction::PrintBeamStatistics();
+      GlueXSubEvents::PrintStatistics();
+      GlueXEventFilter::PrintStatistics();
+      GlueXTrackKiller::PrintStatistics();
+      GlueXFastShowerModel::PrintStatistics();
+      GlueXStepProfiler::PrintReport();
+      GlueXTelemetry::PrintSummary();
+   }
 }
@@ -19,19 +19,26 @@
 
 #include "globals.hh"
 
-#include <list>
+#include <vector>
 
 class G4Run;
 
 class GlueXRunAction : public G4UserRunAction
 {
  public:
+   GlueXRunAction() {}
+   virtual ~GlueXRunAction();
+
    void BeginOfRunAction(const G4Run*);
    void EndOfRunAction(const G4Run*);
 
  private:
    static G4Mutex fMutex;
-   std::list<G4RotationMatrix*> usedRmatrix;
+
+   // thread-local clones of the rotation matrices of the division
+   // volumes, in the order of HddsG4Builder::getDivisions, made the
+   // first time that a run starts on this worker thread
+   std::vector<G4RotationMatrix*> fDivisionRotations;
 };
 
 #endif
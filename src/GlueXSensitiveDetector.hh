@@ -0,0 +1,347 @@
+//
+// GlueXSensitiveDetector - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Common base for the GlueX sensitive detector classes, templated on the
+// class HitT used to accumulate the hits in one readout element (straw,
+// block, paddle...) and the class PointT used to record the truth points
+// of tracks passing through the detector. It takes care of the parts of
+// the job that are the same for all detectors:
+//
+//  * HitT objects for every readout element are created once and
+//    held in a dense array indexed by a compact element number, which
+//    the derived class fills in its constructor. A list of elements
+//    touched in the current event is kept, so that clearing them and
+//    iterating over them costs in proportion to the number of hits.
+//    HitT must provide a Clear() method that empties it, but keeps
+//    any memory it has allocated for reuse in the next event.
+//  * PointT objects are taken from an arena that is reused from one
+//    event to the next, with NewPoint(). Which points are recorded is
+//    selected by the TRUTHPOINTS card in control.in, to be checked with
+//    KeepPoint() before a point is taken:
+//       TRUTHPOINTS 0   no truth points
+//       TRUTHPOINTS 1   points from primary tracks only
+//       TRUTHPOINTS 2   first point of each track in each element
+//       TRUTHPOINTS 3   all points (default)
+//    The OUTLEVEL card can lower this further, to primary tracks only
+//    for hits plus primaries, or to no points for hits only.
+//  * HDDS identifiers are looked up with interned keys from the shared
+//    table in GlueXVolumeIdentifiers.
+//  * FindHitSlot() finds where a hit belongs in a time-ordered list of
+//    hits, merging it with an earlier one within the two-hit resolution.
+//  * EndOfEvent() finds the output record and its hitView, and calls
+//    the derived class PackHits() once to export all of the hits for
+//    the event to it, unless the event has been rejected by one of the
+//    event filters, see GlueXEventFilter.
+//  * When an event is tracked in bundles, see GlueXSubEvents, EndOfEvent()
+//    instead hands over a copy of the hits and points of the bundle, and
+//    PackSubEvents() later loads those of all of the bundles back in, in
+//    order, and packs them together. The derived class provides MergeHit()
+//    to add the hits of one element from a bundle to those already there,
+//    and RenumberPoint() to give a point the track ids of the whole event.
+//
+// The non-template base class GlueXSensitiveDetectorBase lets other
+// code, such as the event filters, ask how many readout elements were
+// hit in a detector without knowing its hit classes.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "thread-local", ie. has thread-local state. Separate
+// object instances are created for each worker thread.
+
+#ifndef GlueXSensitiveDetector_h
+#define GlueXSensitiveDetector_h 1
+
+#include "G4VSensitiveDetector.hh"
+#include "G4EventManager.hh"
+#include "G4Track.hh"
+#include "G4ios.hh"
+
+#include "GlueXUserEventInformation.hh"
+#include "GlueXSubEvents.hh"
+#include "GlueXUserOptions.hh"
+#include "GlueXVolumeIdentifiers.hh"
+#include "HddmOutput.hh"
+
+#include <HDDM/hddm_s.hpp>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <utility>
+#include <map>
+#include <stdlib.h>
+
+template <class InfoT>
+inline bool info_earlier(const InfoT &a, const InfoT &b)
+{
+   return a.t_ns < b.t_ns;
+}
+
+class GlueXSensitiveDetectorBase : public G4VSensitiveDetector
+{
+ public:
+   GlueXSensitiveDetectorBase(const G4String& name)
+    : G4VSensitiveDetector(name) {}
+   virtual ~GlueXSensitiveDetectorBase() {}
+
+   // number of readout elements with hits in the current event
+   virtual int GetHitCount() const = 0;
+
+   // Pack the hits saved from the bundles of an event, one entry for
+   // each bundle or null if it had none, see GlueXSubEvents.
+   virtual void PackSubEvents(std::vector<GlueXSubEvents::hits_t*> &parts,
+                              hddm_s::HitView &hitview) = 0;
+};
+
+// Hits and points of one bundle of an event, see GlueXSubEvents
+
+template <class HitT, class PointT>
+class GlueXSubEventHits : public GlueXSubEvents::hits_t
+{
+ public:
+   std::vector<int> elements;
+   std::vector<HitT> hits;
+   std::vector<PointT> points;
+};
+
+template <class HitT, class PointT>
+class GlueXSensitiveDetector : public GlueXSensitiveDetectorBase
+{
+ public:
+   GlueXSensitiveDetector(const G4String& name);
+   virtual ~GlueXSensitiveDetector() {}
+
+   virtual void Initialize(G4HCofThisEvent* hitCollection);
+   virtual void EndOfEvent(G4HCofThisEvent* hitCollection);
+
+   virtual int GetHitCount() const {
+      return fHitsTouched.size();
+   }
+
+   virtual void PackSubEvents(std::vector<GlueXSubEvents::hits_t*> &parts,
+                              hddm_s::HitView &hitview);
+
+   // Return the hit in a time-ordered list of hits that a new hit at
+   // time t_ns should merge with, ie. the first hit after t_ns - resol_ns,
+   // if that is within resol_ns of it. Otherwise insert a new (default)
+   // hit in front of it with t_ns = 1e99, or return hits.end() if the
+   // new hit comes after all of the existing ones.
+   template <class InfoT>
+   static typename std::vector<InfoT>::iterator
+   FindHitSlot(std::vector<InfoT> &hits, double t_ns, double resol_ns);
+
+ protected:
+   std::vector<HitT> fHits;          // all readout elements, dense
+   std::vector<int> fHitsTouched;    // elements with hits in this event
+   std::vector<char> fHitTouched;    // flags, by element index
+   std::vector<PointT> fPoints;      // truth point arena
+   unsigned int fPointCount;         // points in use in this event
+   int fPointMode;                   // selection set by TRUTHPOINTS card
+   int fEventCount;                  // events seen by this object
+   std::vector<std::pair<int, int> > fPointTrack; // (event, track) of
+                                     // last point taken, by element
+
+   HitT *GetHit(int index) {
+      if (fHitTouched.size() < fHits.size())
+         fHitTouched.resize(fHits.size(), 0);
+      if (! fHitTouched[index]) {
+         fHitTouched[index] = 1;
+         fHitsTouched.push_back(index);
+      }
+      return &fHits[index];
+   }
+
+   // Return whether a point from track in element index should be
+   // recorded according to fPointMode. In mode 2 only the first point
+   // is kept, relying on Geant4 tracking one track at a time.
+   bool KeepPoint(const G4Track *track, int index) {
+      if (fPointMode >= 3)
+         return true;
+      else if (fPointMode == 1)
+         return (track->GetParentID() == 0);
+      else if (fPointMode == 2) {
+         if (fPointTrack.size() < fHits.size())
+            fPointTrack.resize(fHits.size(), std::pair<int, int>(-1, 0));
+         std::pair<int, int> stamp(fEventCount, track->GetTrackID());
+         if (fPointTrack[index] == stamp)
+            return false;
+         fPointTrack[index] = stamp;
+         return true;
+      }
+      return false;
+   }
+
+   // The pointer returned by NewPoint is only valid until the next call
+   PointT *NewPoint() {
+      if (fPointCount == fPoints.size())
+         fPoints.push_back(PointT());
+      return &fPoints[fPointCount++];
+   }
+
+   static int GetIdentKey(const std::string &identifier) {
+      return GlueXVolumeIdentifiers::GetKey(identifier);
+   }
+   static int GetIdent(int key, const G4VTouchable *touch) {
+      return GlueXVolumeIdentifiers::GetIdent(key, touch);
+   }
+
+   // Called by EndOfEvent with fHitsTouched sorted in increasing order
+   virtual void PackHits(hddm_s::HitView &hitview) = 0;
+
+   // Called by PackSubEvents for every element with hits in a bundle,
+   // in bundle order, and for each of its points.
+   virtual void MergeHit(HitT &hit, const HitT &from,
+                         const GlueXSubEvents::hits_t &part) = 0;
+   virtual void RenumberPoint(PointT &point,
+                              const GlueXSubEvents::hits_t &part) = 0;
+};
+
+template <class HitT, class PointT>
+GlueXSensitiveDetector<HitT, PointT>::GlueXSensitiveDetector(
+                                      const G4String& name)
+ : GlueXSensitiveDetectorBase(name),
+   fPointCount(0),
+   fPointMode(3),
+   fEventCount(0)
+{
+   GlueXUserOptions *opts = GlueXUserOptions::GetInstance();
+   std::map<int, int> points_opts;
+   if (opts && opts->Find("TRUTHPOINTS", points_opts))
+      fPointMode = points_opts[1];
+   int level = HddmOutput::getOutputLevel();
+   if (level == HddmOutput::OUTPUT_HITS)
+      fPointMode = 0;
+   else if (level == HddmOutput::OUTPUT_PRIMARIES && fPointMode > 1)
+      fPointMode = 1;
+}
+
+template <class HitT, class PointT>
+void GlueXSensitiveDetector<HitT, PointT>::Initialize(G4HCofThisEvent*)
+{
+   ++fEventCount;
+   for (unsigned int i=0; i < fHitsTouched.size(); ++i) {
+      fHits[fHitsTouched[i]].Clear();
+      fHitTouched[fHitsTouched[i]] = 0;
+   }
+   fHitsTouched.clear();
+   fPointCount = 0;
+}
+
+template <class HitT, class PointT>
+void GlueXSensitiveDetector<HitT, PointT>::EndOfEvent(G4HCofThisEvent*)
+{
+   if (fHitsTouched.size() == 0 && fPointCount == 0)
+      return;
+
+   G4EventManager* mgr = G4EventManager::GetEventManager();
+   GlueXUserEventInformation* info = (GlueXUserEventInformation*)
+                                     mgr->GetUserInformation();
+   if (info == 0)
+      return;
+   else if (info->getSubEvents() > 1) {
+      GlueXSubEventHits<HitT, PointT> *part;
+      part = new GlueXSubEventHits<HitT, PointT>;
+      part->elements = fHitsTouched;
+      part->hits.reserve(fHitsTouched.size());
+      for (unsigned int i=0; i < fHitsTouched.size(); ++i)
+         part->hits.push_back(fHits[fHitsTouched[i]]);
+      part->points.assign(fPoints.begin(), fPoints.begin() + fPointCount);
+      GlueXSubEvents::SaveHits(info, GetFullPathName(), part);
+      return;
+   }
+   else if (! info->getKeepEvent())
+      return;
+   std::sort(fHitsTouched.begin(), fHitsTouched.end());
+
+   if (verboseLevel > 1) {
+      G4cout << G4endl
+             << "--------> Hits Collection: in this event there are "
+             << fHitsTouched.size() << " elements with hits in "
+             << SensitiveDetectorName << ": " << G4endl;
+      for (unsigned int i=0; i < fHitsTouched.size(); ++i)
+         fHits[fHitsTouched[i]].Print();
+
+      G4cout << G4endl
+             << "--------> Hits Collection: in this event there are "
+             << fPointCount << " truth points in "
+             << SensitiveDetectorName << ": " << G4endl;
+      for (unsigned int i=0; i < fPointCount; ++i)
+         fPoints[i].Print();
+   }
+
+   // pack hits into ouptut hddm record
+
+   hddm_s::HDDM *record = info->getOutputRecord();
+   if (record == 0) {
+      G4cerr << "GlueXSensitiveDetector::EndOfEvent error - "
+             << "hits seen in " << SensitiveDetectorName
+             << " but no output hddm record to save them into, "
+             << "cannot continue!" << G4endl;
+      exit(1);
+   }
+
+   if (record->getPhysicsEvents().size() == 0)
+      record->addPhysicsEvents();
+   if (record->getHitViews().size() == 0)
+      record->getPhysicsEvent().addHitViews();
+   PackHits(record->getPhysicsEvent().getHitView());
+}
+
+template <class HitT, class PointT>
+void GlueXSensitiveDetector<HitT, PointT>::PackSubEvents(
+                         std::vector<GlueXSubEvents::hits_t*> &parts,
+                         hddm_s::HitView &hitview)
+{
+   // The hits of this detector for the bundle just tracked on this thread
+   // have already been saved, so the arrays are free to be loaded again.
+
+   Initialize(0);
+   for (unsigned int k=0; k < parts.size(); ++k) {
+      GlueXSubEventHits<HitT, PointT> *part;
+      part = dynamic_cast<GlueXSubEventHits<HitT, PointT>*>(parts[k]);
+      if (part == 0)
+         continue;
+      for (unsigned int i=0; i < part->elements.size(); ++i)
+         MergeHit(*GetHit(part->elements[i]), part->hits[i], *part);
+      for (unsigned int i=0; i < part->points.size(); ++i) {
+         PointT *point = NewPoint();
+         *point = part->points[i];
+         RenumberPoint(*point, *part);
+      }
+   }
+   if (fHitsTouched.size() == 0 && fPointCount == 0)
+      return;
+   std::sort(fHitsTouched.begin(), fHitsTouched.end());
+   PackHits(hitview);
+}
+
+template <class HitT, class PointT>
+template <class InfoT>
+typename std::vector<InfoT>::iterator
+GlueXSensitiveDetector<HitT, PointT>::FindHitSlot(std::vector<InfoT> &hits,
+                                                  double t_ns,
+                                                  double resol_ns)
+{
+   typename std::vector<InfoT>::iterator hiter;
+   InfoT key;
+   key.t_ns = t_ns - resol_ns;
+   hiter = std::upper_bound(hits.begin(), hits.end(), key, info_earlier<InfoT>);
+   if (hiter != hits.end() && hiter->t_ns - t_ns >= resol_ns) {
+      hiter = hits.insert(hiter, InfoT());
+      hiter->t_ns = 1e99;
+   }
+   return hiter;
+}
+
+// Factory for registering detector classes by volume name, see
+// GlueXDetectorConstruction::ConstructSDandField
+
+template <class SD>
+G4VSensitiveDetector *NewSensitiveDetector(const G4String& name)
+{
+   return new SD(name);
+}
+
+#endif
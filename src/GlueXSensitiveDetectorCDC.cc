@@ -10,6 +10,8 @@
 #include "GlueXUserEventInformation.hh"
 #include "GlueXUserTrackInformation.hh"
 #include "GlueXUserOptions.hh"
+#include "GlueXVolumeIdentifiers.hh"
+#include "GlueXCalibrationCache.hh"
 
 #include <CLHEP/Random/RandPoisson.h>
 #include <Randomize.hh>
@@ -21,11 +23,10 @@
 #include "G4SDManager.hh"
 #include "G4ios.hh"
 
-#include <JANA/JApplication.h>
-
 #include <stdio.h>
-#include <malloc.h>
 #include <math.h>
+#include <sstream>
+#include <algorithm>
 
 const double fC = 1e-15 * coulomb;
 const double GlueXSensitiveDetectorCDC::ELECTRON_CHARGE = 1.6022e-4*fC;
@@ -69,17 +70,44 @@ double GlueXSensitiveDetectorCDC::fDrift_time[CDC_DRIFT_TABLE_LEN];
 double GlueXSensitiveDetectorCDC::fDrift_distance[CDC_DRIFT_TABLE_LEN];
 double GlueXSensitiveDetectorCDC::fBscale_par1;
 double GlueXSensitiveDetectorCDC::fBscale_par2;
+double GlueXSensitiveDetectorCDC::DRIFT_TABLE_STEP = 0.001*cm;
+double GlueXSensitiveDetectorCDC::DRIFT_TABLE_MAX = 1.0*cm;
+double GlueXSensitiveDetectorCDC::BSCALE_TABLE_STEP = 0.01*tesla;
+double GlueXSensitiveDetectorCDC::BSCALE_TABLE_MAX = 4.0*tesla;
+std::vector<GlueXSensitiveDetectorCDC::drift_node_t>
+                                 GlueXSensitiveDetectorCDC::fDrift_table;
+std::vector<double> GlueXSensitiveDetectorCDC::fBscale_table;
+
+// Default ASIC response parameters, used if none are found in ccdb
+double GlueXSensitiveDetectorCDC::fAsic_par[11] = {
+                     -0.01986, 0.01802, -0.001097, 10.3, 11.72,
+                     -0.03701, 35.84, 15.93, 0.006141, 80.95, 24.77};
+double GlueXSensitiveDetectorCDC::ASIC_KERNEL_STEP = 0.1*ns;
+std::vector<double> GlueXSensitiveDetectorCDC::fAsic_kernel;
+std::vector<double> GlueXSensitiveDetectorCDC::fAsic_envelope;
 
 G4Mutex GlueXSensitiveDetectorCDC::fMutex = G4MUTEX_INITIALIZER;
 
-std::map<G4LogicalVolume*, int> GlueXSensitiveDetectorCDC::fVolumeTable;
+// Number of straws in each ring of the CDC, from the inside out
+const int GlueXSensitiveDetectorCDC::CDC_RING_STRAWS[CDC_NUM_RINGS] = {
+                     42, 42, 54, 54, 66, 66, 80, 80, 93, 93, 106, 106,
+                     123, 123, 135, 135, 146, 146, 158, 158, 170, 170,
+                     182, 182, 197, 197, 209, 209};
+int GlueXSensitiveDetectorCDC::fRingOffset[CDC_NUM_RINGS] = {0};
+
+int GlueXSensitiveDetectorCDC::fRingKey = -1;
+int GlueXSensitiveDetectorCDC::fSectorKey = -1;
 
 GlueXSensitiveDetectorCDC::GlueXSensitiveDetectorCDC(const G4String& name)
- : G4VSensitiveDetector(name),
-   fStrawsMap(0), fPointsMap(0)
+ : GlueXSensitiveDetector<GlueXHitCDCstraw, GlueXHitCDCpoint>(name)
 {
-   collectionName.insert("CDCHitsCollection");
-   collectionName.insert("CDCPointsCollection");
+   // Create the dense array of straws for the hits, see GetStrawIndex
+
+   fHits.reserve(CDC_NUM_STRAWS);
+   for (int ring=1; ring <= CDC_NUM_RINGS; ++ring) {
+      for (int sector=1; sector <= CDC_RING_STRAWS[ring-1]; ++sector)
+         fHits.push_back(GlueXHitCDCstraw(ring, sector));
+   }
 
    // The rest of this only needs to happen once, the first time an object
    // of this type is instantiated for this configuration of geometry and
@@ -89,17 +117,8 @@ GlueXSensitiveDetectorCDC::GlueXSensitiveDetectorCDC(const G4String& name)
 
    G4AutoLock barrier(&fMutex);
    if (instanceCount++ == 0) {
-      extern int run_number;
-      extern jana::JApplication *japp;
-      if (japp == 0) {
-         G4cerr << "Error in GlueXSensitiveDetector constructor - "
-                << "jana global DApplication object not set, "
-                << "cannot continue." << G4endl;
-         exit(-1);
-      }
-      jana::JCalibration *jcalib = japp->GetJCalibration(run_number);
-      std::map<string, float> cdc_parms;
-      jcalib->Get("CDC/cdc_parms", cdc_parms);
+      std::map<std::string, float> cdc_parms;
+      GlueXCalibrationCache::Get("CDC/cdc_parms", cdc_parms);
       DRIFT_SPEED = cdc_parms.at("CDC_DRIFT_SPEED");
       TWO_HIT_TIME_RESOL = cdc_parms.at("CDC_TWO_HIT_RESOL");
       MAX_HITS = cdc_parms.at("CDC_MAX_HITS");
@@ -113,20 +132,20 @@ GlueXSensitiveDetectorCDC::GlueXSensitiveDetectorCDC(const G4String& name)
       if (B.mag() > 1e-3) {
          int nvalues = CDC_DRIFT_TABLE_LEN;
          std::vector< std::map<std::string, float> > values;
-         jcalib->Get("CDC/cdc_drift_table", values);
+         GlueXCalibrationCache::Get("CDC/cdc_drift_table", values);
          for (int k=0; k < nvalues; ++k) {
             fDrift_distance[k] = 0.01 * k; // 100 micron increments;
             fDrift_time[k] = values[k]["t"] * 1000; // from us to ns
          }
-         std::map<string, float> cdc_drift_parms;
-         jcalib->Get("CDC/cdc_drift_parms", cdc_drift_parms);
+         std::map<std::string, float> cdc_drift_parms;
+         GlueXCalibrationCache::Get("CDC/cdc_drift_parms", cdc_drift_parms);
          fBscale_par1 = cdc_drift_parms.at("bscale_par1");
          fBscale_par2 = cdc_drift_parms.at("bscale_par2");
       }
       else {
          int nvalues = CDC_DRIFT_TABLE_LEN;
          std::vector< std::map<std::string, float> > values;
-         jcalib->Get("CDC/cdc_drift_table::NoBField", values);
+         GlueXCalibrationCache::Get("CDC/cdc_drift_table::NoBField", values);
          for (int k=0; k < nvalues; ++k) {
             fDrift_distance[k] = 0.01 * k; // 100 micron increments;
             fDrift_time[k] = values[k]["t"] * 1000; // from us to ns
@@ -134,8 +153,29 @@ GlueXSensitiveDetectorCDC::GlueXSensitiveDetectorCDC(const G4String& name)
          fBscale_par1 = 0;
          fBscale_par2 = 0;
       }
+      std::map<std::string, float> asic_parms;
+      if (GlueXCalibrationCache::Get("CDC/asic_response_parms",
+                                    asic_parms) == false)
+      {
+         for (int ipar=0; ipar < 11; ++ipar) {
+            std::stringstream key;
+            key << "par" << ipar;
+            if (asic_parms.find(key.str()) != asic_parms.end())
+               fAsic_par[ipar] = asic_parms.at(key.str());
+         }
+      }
       G4cout << "CDC: ALL parameters loaded from ccdb" << G4endl;
 
+      InitDriftTable();
+      InitAsicKernel();
+
+      for (int ring=1; ring < CDC_NUM_RINGS; ++ring) {
+         fRingOffset[ring] = fRingOffset[ring-1] + CDC_RING_STRAWS[ring-1];
+      }
+
+      fRingKey = GlueXVolumeIdentifiers::GetKey("ring");
+      fSectorKey = GlueXVolumeIdentifiers::GetKey("sector");
+
       // Check for "driftclusters" option in control.in
 
       GlueXUserOptions *opts = GlueXUserOptions::GetInstance();
@@ -149,8 +189,7 @@ GlueXSensitiveDetectorCDC::GlueXSensitiveDetectorCDC(const G4String& name)
 
 GlueXSensitiveDetectorCDC::GlueXSensitiveDetectorCDC(
                      const GlueXSensitiveDetectorCDC &src)
- : G4VSensitiveDetector(src),
-   fStrawsMap(src.fStrawsMap), fPointsMap(src.fPointsMap)
+ : GlueXSensitiveDetector<GlueXHitCDCstraw, GlueXHitCDCpoint>(src)
 {
    ++instanceCount;
 }
@@ -158,9 +197,7 @@ GlueXSensitiveDetectorCDC::GlueXSensitiveDetectorCDC(
 GlueXSensitiveDetectorCDC &GlueXSensitiveDetectorCDC::operator=(const
                                          GlueXSensitiveDetectorCDC &src)
 {
-   *(G4VSensitiveDetector*)this = src;
-   fStrawsMap = src.fStrawsMap;
-   fPointsMap = src.fPointsMap;
+   GlueXSensitiveDetector<GlueXHitCDCstraw, GlueXHitCDCpoint>::operator=(src);
    return *this;
 }
 
@@ -169,15 +206,17 @@ GlueXSensitiveDetectorCDC::~GlueXSensitiveDetectorCDC()
    --instanceCount;
 }
 
-void GlueXSensitiveDetectorCDC::Initialize(G4HCofThisEvent* hce)
+int GlueXSensitiveDetectorCDC::GetStrawIndex(int ring, int sector)
 {
-   fStrawsMap = new 
-                GlueXHitsMapCDCstraw(SensitiveDetectorName, collectionName[0]);
-   fPointsMap = new
-                GlueXHitsMapCDCpoint(SensitiveDetectorName, collectionName[1]);
-   G4SDManager *sdm = G4SDManager::GetSDMpointer();
-   hce->AddHitsCollection(sdm->GetCollectionID(collectionName[0]), fStrawsMap);
-   hce->AddHitsCollection(sdm->GetCollectionID(collectionName[1]), fPointsMap);
+   // Return the index of straw (ring,sector) in the dense straw array,
+   // or -1 if there is no such straw in the CDC.
+
+   if (ring < 1 || ring > CDC_NUM_RINGS ||
+       sector < 1 || sector > CDC_RING_STRAWS[ring-1])
+   {
+      return -1;
+   }
+   return fRingOffset[ring-1] + sector - 1;
 }
 
 G4bool GlueXSensitiveDetectorCDC::ProcessHits(G4Step* step, 
@@ -224,7 +263,7 @@ G4bool GlueXSensitiveDetectorCDC::ProcessHits(G4Step* step,
    // Deal with tracks exiting the ends of the straws
    if (fabs(x2local[2]) >= 75.45*cm) {
       int sign = (xoutlocal[2] > 0)? 1 : -1;
-      int ring = GetIdent("ring", touch);
+      int ring = GlueXVolumeIdentifiers::GetIdent(fRingKey, touch);
       if (ring <= 4 || (ring >= 13 && ring <= 16) || ring >= 25) {
          alpha = (sign * 75.45*cm - xinlocal[2]) / (dxlocal[2] + 1e-30);
          x2local = xinlocal + alpha * dxlocal;
@@ -273,43 +312,47 @@ G4bool GlueXSensitiveDetectorCDC::ProcessHits(G4Step* step,
    double dr = dx.mag();
    double dEdx = (dr > 1e-3*cm)? dEsum/dr : 0;
 
+   int ring = GlueXVolumeIdentifiers::GetIdent(fRingKey, touch);
+   int sector = GlueXVolumeIdentifiers::GetIdent(fSectorKey, touch);
+   int index = GetStrawIndex(ring, sector);
+   if (index < 0) {
+      G4cerr << "GlueXSensitiveDetectorCDC::ProcessHits error - "
+             << "hit in unknown straw ring=" << ring
+             << " sector=" << sector << ", ignoring it." << G4endl;
+      return false;
+   }
+
    // Post the hit to the points list in the
-   // order of appearance in the event simulation.
+   // order of appearance in the event simulation,
+   // if selected by the TRUTHPOINTS card.
    // TODO: this section should be protected by if (history == 0)
 
-   GlueXHitCDCpoint* newPoint = new GlueXHitCDCpoint();
-   G4int key = fPointsMap->entries();
-   fPointsMap->add(key, newPoint);
    G4Track *track = step->GetTrack();
-   int pdgtype = track->GetDynamicParticle()->GetPDGcode();
-   int g3type = GlueXPrimaryGeneratorAction::ConvertPdgToGeant3(pdgtype);
-   GlueXUserTrackInformation *trackinfo = (GlueXUserTrackInformation*)
-                                          track->GetUserInformation();
-   newPoint->ptype_G3 = g3type;
-   newPoint->track_ = track->GetTrackID();
-   newPoint->trackID_ = trackinfo->GetGlueXTrackID();
-   newPoint->primary_ = (track->GetParentID() == 0);
-   newPoint->t_ns = t/ns;
-   newPoint->z_cm = x[2]/cm;
-   newPoint->r_cm = x.perp()/cm;
-   newPoint->phi_rad = x.phi();
-   newPoint->dradius_cm = dradius/cm;
-   newPoint->px_GeV = pin[0]/GeV;
-   newPoint->py_GeV = pin[1]/GeV;
-   newPoint->pz_GeV = pin[2]/GeV;
-   newPoint->dEdx_GeV_cm = dEdx/(GeV/cm);
+   if (KeepPoint(track, index)) {
+      GlueXHitCDCpoint* newPoint = NewPoint();
+      int pdgtype = track->GetDynamicParticle()->GetPDGcode();
+      int g3type = GlueXPrimaryGeneratorAction::ConvertPdgToGeant3(pdgtype);
+      GlueXUserTrackInformation *trackinfo =
+         GlueXUserTrackInformation::Get(track);
+      newPoint->ptype_G3 = g3type;
+      newPoint->track_ = track->GetTrackID();
+      newPoint->trackID_ = trackinfo->GetGlueXTrackID();
+      newPoint->primary_ = (track->GetParentID() == 0);
+      newPoint->t_ns = t/ns;
+      newPoint->z_cm = x[2]/cm;
+      newPoint->r_cm = x.perp()/cm;
+      newPoint->phi_rad = x.phi();
+      newPoint->dradius_cm = dradius/cm;
+      newPoint->px_GeV = pin[0]/GeV;
+      newPoint->py_GeV = pin[1]/GeV;
+      newPoint->pz_GeV = pin[2]/GeV;
+      newPoint->dEdx_GeV_cm = dEdx/(GeV/cm);
+   }
 
    // Post the hit to the straw hits map, ordered by straw index
 
    if (dEsum > 0) {
-      int ring = GetIdent("ring", touch);
-      int sector = GetIdent("sector", touch);
-      int key = GlueXHitCDCstraw::GetKey(ring, sector);
-      GlueXHitCDCstraw *straw = (*fStrawsMap)[key];
-      if (straw == 0) {
-         straw = new GlueXHitCDCstraw(ring, sector);
-         fStrawsMap->add(key, straw);
-      }
+      GlueXHitCDCstraw *straw = GetHit(index);
 
       // Simulate number of primary ion pairs.
       // The total number of ion pairs depends on the energy deposition 
@@ -323,81 +366,39 @@ G4bool GlueXSensitiveDetectorCDC::ProcessHits(G4Step* step,
          add_cluster(straw, track, n_p, t, x, xlocal);
       }
       else {
-         // Loop over the number of primary ion pairs,
-         // generating a cluster at a random position
-         // along the track within the straw.
-         for (int n=0; n < n_p; n++) {
-            double u = G4RandFlat::shoot();
-            xlocal = xinlocal + u * dxlocal;
-            x = xin + u * dx;
-            add_cluster(straw, track, 1, t, x, xlocal);
-         }
+         // Generate a cluster for each of the primary ion pairs,
+         // at a random position along the track within the straw.
+         add_clusters(straw, track, n_p, t, xin, dx, xinlocal, dxlocal);
       }
    }
    return true;
 }
 
-void GlueXSensitiveDetectorCDC::EndOfEvent(G4HCofThisEvent*)
+void GlueXSensitiveDetectorCDC::PackHits(hddm_s::HitView &hitview)
 {
-   std::map<int,GlueXHitCDCstraw*> *straws = fStrawsMap->GetMap();
-   std::map<int,GlueXHitCDCpoint*> *points = fPointsMap->GetMap();
-   if (straws->size() == 0 && points->size() == 0)
-      return;
-   std::map<int,GlueXHitCDCstraw*>::iterator siter;
-   std::map<int,GlueXHitCDCpoint*>::iterator piter;
-
-   if (verboseLevel > 1) { 
-      G4cout << G4endl
-             << "--------> Hits Collection: in this event there are "
-             << straws->size() << " straws with hits in the CDC: "
-             << G4endl;
-      for (siter = straws->begin(); siter != straws->end(); ++siter)
-         siter->second->Print();
-
-      G4cout << G4endl
-             << "--------> Hits Collection: in this event there are "
-             << points->size() << " truth points in the CDC: "
-             << G4endl;
-      for (piter = points->begin(); piter != points->end(); ++piter)
-         piter->second->Print();
-   }
-
-   // pack hits into ouptut hddm record
- 
-   G4EventManager* mgr = G4EventManager::GetEventManager();
-   G4VUserEventInformation* info = mgr->GetUserInformation();
-   hddm_s::HDDM *record = ((GlueXUserEventInformation*)info)->getOutputRecord();
-   if (record == 0) {
-      G4cerr << "GlueXSensitiveDetectorCDC::EndOfEvent error - "
-             << "hits seen but no output hddm record to save them into, "
-             << "cannot continue!" << G4endl;
-      exit(1);
-   }
-
-   if (record->getPhysicsEvents().size() == 0) 
-      record->addPhysicsEvents();
-   if (record->getHitViews().size() == 0) 
-      record->getPhysicsEvent().addHitViews();
-   hddm_s::HitView &hitview = record->getPhysicsEvent().getHitView();
    if (hitview.getCentralDCs().size() == 0)
       hitview.addCentralDCs();
    hddm_s::CentralDC &centralDC = hitview.getCentralDC();
 
-   // Collect and output the strawTruthHits
+   // Collect the strawTruthHits
 
-   for (siter = straws->begin(); siter != straws->end(); ++siter) {
-      std::vector<GlueXHitCDCstraw::hitinfo_t> &hits = siter->second->hits;
+   int nstraws = 0;
+   for (unsigned int is=0; is < fHitsTouched.size(); ++is) {
+      GlueXHitCDCstraw *strawhit = &fHits[fHitsTouched[is]];
+      std::vector<GlueXHitCDCstraw::hitinfo_t> &hits = strawhit->hits;
 
       // If doing driftclusters generate a sampled waveform and 
       // analyze it to rebuild the hits list from scratch.
 
-      if (fDrift_clusters) {
+      if (fDrift_clusters && hits.size() > 0) {
          // store waveform data in sampled sequence with 1 ns bins
          int num_samples = int(CDC_TIME_WINDOW/ns);
-         double *samples = new double[num_samples];
-         for (int i=0; i < num_samples; i++) {
-            samples[i] = cdc_wire_signal_mV(double(i), siter->second);
-         }
+         if ((int)fSamples.size() < num_samples)
+            fSamples.resize(num_samples);
+         double *samples = &fSamples[0];
+         int first, last;
+         GetWaveformWindow(strawhit, num_samples, first, last);
+         cdc_wire_signal_mV(strawhit, samples, first, last);
 
          // take the earliest hit to identify the track parameters
          double dradius_cm = hits[0].d_cm;
@@ -407,7 +408,7 @@ void GlueXSensitiveDetectorCDC::EndOfEvent(G4HCofThisEvent*)
          hits.clear();
          double q_mV_ns = 0.; 
          int over_threshold = 0;
-         for (int i=0; i < num_samples; ++i) {
+         for (int i=first; i < last; ++i) {
             if (samples[i] >= THRESH_MV) {
                if (!over_threshold) {
                   hits.push_back(GlueXHitCDCstraw::hitinfo_t());
@@ -425,69 +426,71 @@ void GlueXSensitiveDetectorCDC::EndOfEvent(G4HCofThisEvent*)
                q_mV_ns = 0;
             }
          }
-         delete [] samples;
       }
       else {
          // merge multiple hits coming from the same track segment
          // that got split up by interactions within the straw volume
-         for (unsigned int ih=0; ih < hits.size(); ++ih) {
-            for (unsigned int ih2 = ih + 1; ih2 < hits.size(); ++ih2) {
-               if (fabs(hits[ih].z_cm - hits[ih2].z_cm) < 1 &&
-                   fabs(hits[ih].t0_ns - hits[ih2].t0_ns) < 1)
-               {
-                  hits[ih].q_fC += hits[ih2].q_fC;
-                  if (hits[ih].t_ns > hits[ih2].t_ns) {
-                     hits[ih].t_ns = hits[ih2].t_ns;
-                     hits[ih].d_cm = hits[ih2].d_cm;
-                  }
-                  hits.erase(hits.begin() + ih2);
-                 --ih2;
-               }
-            }
-         }
+         strawhit->merge_segments(1, 1);
       }
+      nstraws += (hits.size() > 0);
+   }
 
-      if (hits.size() > 0) {
-         hddm_s::CdcStrawList straw = centralDC.addCdcStraws(1);
-         straw(0).setRing(siter->second->ring_);
-         straw(0).setStraw(siter->second->sector_);
-         for (int ih=0; ih < (int)hits.size(); ++ih) {
-            hddm_s::CdcStrawTruthHitList thit = straw(0).addCdcStrawTruthHits(1);
-            thit(0).setQ(hits[ih].q_fC);
-            thit(0).setT(hits[ih].t_ns);
-            thit(0).setD(hits[ih].d_cm);
-            thit(0).setItrack(hits[ih].itrack_);
-            thit(0).setPtype(hits[ih].ptype_G3);
-         }
+   // Output the strawTruthHits, allocating the output lists
+   // for all of the straws and then all of the hits in a straw at once
+
+   hddm_s::CdcStrawList straws = centralDC.addCdcStraws(nstraws);
+   int istraw = 0;
+   for (unsigned int is=0; is < fHitsTouched.size(); ++is) {
+      GlueXHitCDCstraw *strawhit = &fHits[fHitsTouched[is]];
+      std::vector<GlueXHitCDCstraw::hitinfo_t> &hits = strawhit->hits;
+      if (hits.size() == 0)
+         continue;
+      hddm_s::CdcStraw &straw = straws(istraw++);
+      straw.setRing(strawhit->ring_);
+      straw.setStraw(strawhit->sector_);
+      hddm_s::CdcStrawTruthHitList thits =
+                                   straw.addCdcStrawTruthHits(hits.size());
+      for (int ih=0; ih < (int)hits.size(); ++ih) {
+         hddm_s::CdcStrawTruthHit &thit = thits(ih);
+         thit.setQ(hits[ih].q_fC);
+         thit.setT(hits[ih].t_ns);
+         thit.setD(hits[ih].d_cm);
+         thit.setItrack(hits[ih].itrack_);
+         thit.setPtype(hits[ih].ptype_G3);
       }
    }
 
-   // Collect and output the strawTruthPoints
-   for (piter = points->begin(); piter != points->end(); ++piter) {
-      hddm_s::CdcTruthPointList point = centralDC.addCdcTruthPoints(1);
-      point(0).setDEdx(piter->second->dEdx_GeV_cm);
-      point(0).setDradius(piter->second->dradius_cm);
-      point(0).setPrimary(piter->second->primary_);
-      point(0).setPtype(piter->second->ptype_G3);
-      point(0).setPx(piter->second->px_GeV);
-      point(0).setPy(piter->second->py_GeV);
-      point(0).setPz(piter->second->pz_GeV);
-      point(0).setR(piter->second->r_cm);
-      point(0).setPhi(piter->second->phi_rad);
-      point(0).setZ(piter->second->z_cm);
-      point(0).setT(piter->second->t_ns);
-      point(0).setTrack(piter->second->track_);
-      hddm_s::TrackIDList tid = point(0).addTrackIDs();
-      tid(0).setItrack(piter->second->trackID_);
+   // Output the strawTruthPoints
+
+   if (fPointCount == 0)
+      return;
+   hddm_s::CdcTruthPointList points = centralDC.addCdcTruthPoints(fPointCount);
+   for (unsigned int ip=0; ip < fPointCount; ++ip) {
+      GlueXHitCDCpoint *pt = &fPoints[ip];
+      hddm_s::CdcTruthPoint &point = points(ip);
+      point.setDEdx(pt->dEdx_GeV_cm);
+      point.setDradius(pt->dradius_cm);
+      point.setPrimary(pt->primary_);
+      point.setPtype(pt->ptype_G3);
+      point.setPx(pt->px_GeV);
+      point.setPy(pt->py_GeV);
+      point.setPz(pt->pz_GeV);
+      point.setR(pt->r_cm);
+      point.setPhi(pt->phi_rad);
+      point.setZ(pt->z_cm);
+      point.setT(pt->t_ns);
+      point.setTrack(pt->track_);
+      hddm_s::TrackIDList tid = point.addTrackIDs();
+      tid(0).setItrack(pt->trackID_);
    }
 }
 
 double GlueXSensitiveDetectorCDC::asic_response(double t_ns)
 {
-   // Simulation of the ASIC response to a pulse due to a cluster
+   // Simulation of the ASIC response to a pulse due to a cluster,
+   // only used to fill the fAsic_kernel table at startup
 
-   double par[11] = {-0.01986, 0.01802, -0.001097, 10.3, 11.72,
-                     -0.03701, 35.84, 15.93, 0.006141, 80.95, 24.77};
+   double *par = fAsic_par;
    if (t_ns < par[3])
       return par[0] * t_ns + par[1] * t_ns*t_ns + par[2] * t_ns*t_ns*t_ns;
    else
@@ -499,21 +502,181 @@ double GlueXSensitiveDetectorCDC::asic_response(double t_ns)
              par[8] * exp(-pow((t_ns - par[9])/par[10], 2));
 }
 
-double GlueXSensitiveDetectorCDC::cdc_wire_signal_mV(double t_ns,
-                                                     GlueXHitCDCstraw *straw)
+void GlueXSensitiveDetectorCDC::InitAsicKernel()
+{
+   // Tabulate the ASIC response over the readout window, then drop
+   // the tail beyond the last point where it exceeds 1e-6 of its peak
+
+   int ksize = int(CDC_TIME_WINDOW / ASIC_KERNEL_STEP) + 2;
+   fAsic_kernel.resize(ksize);
+   double peak = 0;
+   for (int k=0; k < ksize; ++k) {
+      fAsic_kernel[k] = asic_response(k * ASIC_KERNEL_STEP / ns);
+      peak = (fabs(fAsic_kernel[k]) > peak)? fabs(fAsic_kernel[k]) : peak;
+   }
+   while (ksize > 2 && fabs(fAsic_kernel[ksize - 1]) < 1e-6 * peak)
+      --ksize;
+   fAsic_kernel.resize(ksize + 1, 0.);
+   fAsic_envelope.resize(ksize + 1);
+   fAsic_envelope[ksize] = 0;
+   for (int k=ksize - 1; k >= 0; --k) {
+      double a = fabs(fAsic_kernel[k]);
+      fAsic_envelope[k] = (a > fAsic_envelope[k+1])? a : fAsic_envelope[k+1];
+   }
+}
+
+void GlueXSensitiveDetectorCDC::GetWaveformWindow(const GlueXHitCDCstraw *straw,
+                                                  int num_samples,
+                                                  int &first, int &last)
 {
-   // Simulation of signal on a wire
+   // Find the range [first,last) of samples outside of which the
+   // waveform is guaranteed to be below THRESH_MV. It starts at the
+   // first sample after the earliest cluster, and ends once the summed
+   // response envelope of all clusters, placed at the time of the
+   // latest cluster, has fallen below threshold (plus one sample so
+   // that a pulse still open at that point is closed in the scan).
 
    double asic_gain = 0.5; // mV/fC
-   double signal_mV = 0;
-   std::vector<GlueXHitCDCstraw::hitinfo_t>::iterator hiter;
+   const std::vector<GlueXHitCDCstraw::hitinfo_t> &hits = straw->hits;
+   if (hits.size() == 0 || THRESH_MV <= 0) {
+      first = 0;
+      last = (hits.size() == 0)? 0 : num_samples;
+      return;
+   }
+   double tmin = hits[0].t_ns;
+   double tmax = hits[0].t_ns;
+   double amp = 0;
+   std::vector<GlueXHitCDCstraw::hitinfo_t>::const_iterator hiter;
+   for (hiter = hits.begin(); hiter != hits.end(); ++hiter) {
+      tmin = (hiter->t_ns < tmin)? hiter->t_ns : tmin;
+      tmax = (hiter->t_ns > tmax)? hiter->t_ns : tmax;
+      amp += asic_gain * fabs(hiter->q_fC);
+   }
+   int lo = 0;
+   int hi = fAsic_envelope.size() - 1;
+   while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (amp * fAsic_envelope[mid] < THRESH_MV)
+         hi = mid;
+      else
+         lo = mid + 1;
+   }
+   double tend = tmax + lo * ASIC_KERNEL_STEP / ns;
+   first = (tmin < 0)? 0 : int(floor(tmin)) + 1;
+   last = int(ceil(tend)) + 2;
+   first = (first < num_samples)? first : num_samples;
+   last = (last < num_samples)? last : num_samples;
+}
+
+void GlueXSensitiveDetectorCDC::cdc_wire_signal_mV(const GlueXHitCDCstraw *straw,
+                                                   double *samples,
+                                                   int first, int last)
+{
+   // Simulation of signal on a wire, sampled in 1 ns bins, built up
+   // by adding one copy of the tabulated ASIC response for each cluster
+   // starting at the first sample after the cluster time. Only samples
+   // in the range [first,last) are computed.
+
+   double asic_gain = 0.5; // mV/fC
+   for (int i=first; i < last; ++i)
+      samples[i] = 0;
+   double kscale = ns / ASIC_KERNEL_STEP;
+   int klast = fAsic_kernel.size() - 2;
+   std::vector<GlueXHitCDCstraw::hitinfo_t>::const_iterator hiter;
    for (hiter = straw->hits.begin(); hiter != straw->hits.end(); ++hiter) {
-      if (t_ns > hiter->t_ns) {
-         double my_time_ns = t_ns - hiter->t_ns;
-         signal_mV += asic_gain * hiter->q_fC * asic_response(my_time_ns);
+      int i0 = (hiter->t_ns < 0)? 0 : int(floor(hiter->t_ns)) + 1;
+      i0 = (i0 > first)? i0 : first;
+      double amp = asic_gain * hiter->q_fC;
+      for (int i=i0; i < last; ++i) {
+         double u = (i - hiter->t_ns) * kscale;
+         int k = int(u);
+         if (k >= klast)
+            break;
+         double f = u - k;
+         samples[i] += amp * (fAsic_kernel[k] + 
+                              f * (fAsic_kernel[k+1] - fAsic_kernel[k]));
       }
-  }
-  return signal_mV;
+   }
+}
+
+void GlueXSensitiveDetectorCDC::InitDriftTable()
+{
+   // Tabulate the drift time from the ccdb table on a fine uniform grid
+   // in drift radius, by 4-point polynomial interpolation inside the
+   // table and crude linear extrapolation near and beyond its end, and
+   // the longitudinal diffusion width from its polynomial parameterization.
+   // The field scale factor is tabulated separately on a grid in |B|.
+
+   int nsize = int(DRIFT_TABLE_MAX / DRIFT_TABLE_STEP + 0.5) + 1;
+   fDrift_table.resize(nsize);
+   for (int k=0; k < nsize; ++k) {
+      double dradius_cm = k * DRIFT_TABLE_STEP / cm;
+      double d2 = dradius_cm * dradius_cm;
+      double d3 = dradius_cm * d2;  
+      double my_t_ns;
+      double my_t_err;
+      int i = (int)(dradius_cm * 100);
+      if (i >= CDC_DRIFT_TABLE_LEN - 3) {
+         my_t_ns = fDrift_time[CDC_DRIFT_TABLE_LEN - 3] + 
+                   (dradius_cm - fDrift_distance[CDC_DRIFT_TABLE_LEN - 3]) *
+                   (fDrift_time[CDC_DRIFT_TABLE_LEN - 1] -
+                    fDrift_time[CDC_DRIFT_TABLE_LEN - 3]) / 0.02;
+      }
+      else {
+         int index = (i < 1)? 0 : i - 1;
+         polint(&fDrift_distance[index],
+                &fDrift_time[index], 4, dradius_cm, &my_t_ns, &my_t_err);
+      }
+      fDrift_table[k].t_ns = my_t_ns;
+      fDrift_table[k].sigma_ns = 7.515 * dradius_cm - 2.139 * d2 + 12.63 * d3;
+   }
+
+   int bsize = int(BSCALE_TABLE_MAX / BSCALE_TABLE_STEP + 0.5) + 1;
+   fBscale_table.resize(bsize);
+   for (int j=0; j < bsize; ++j) {
+      double BmagT = j * BSCALE_TABLE_STEP / tesla;
+      fBscale_table[j] = 1 / (1 - fBscale_par1 - fBscale_par2 * BmagT);
+   }
+}
+
+inline double GlueXSensitiveDetectorCDC::bscale_factor(double BmagT)
+{
+   // Look up the drift time scale factor for field |B| in the table,
+   // see InitDriftTable()
+
+   double v = BmagT * (tesla / BSCALE_TABLE_STEP);
+   int j = int(v);
+   int jmax = fBscale_table.size() - 2;
+   j = (j < jmax)? j : jmax;
+   double g = v - j;
+   return fBscale_table[j] + g * (fBscale_table[j+1] - fBscale_table[j]);
+}
+
+inline double GlueXSensitiveDetectorCDC::drift_time_ns(double dradius_cm,
+                                                       double bscale,
+                                                       double gauss)
+{
+   // Look up the drift time and diffusion width for this radius in the
+   // table, see InitDriftTable(), and smear the time by gauss times the
+   // longitudinal diffusion width.
+
+   double u = dradius_cm * (cm / DRIFT_TABLE_STEP);
+   int k = int(u);
+   int kmax = fDrift_table.size() - 2;
+   k = (k < kmax)? k : kmax;
+   double f = u - k;
+   const drift_node_t *node = &fDrift_table[k];
+   double tdrift_ns = bscale * (node[0].t_ns + f * (node[1].t_ns -
+                                                    node[0].t_ns));
+   double dt_ns = node[0].sigma_ns + f * (node[1].sigma_ns -
+                                          node[0].sigma_ns);
+   tdrift_ns += dt_ns * gauss;
+
+   // Prevent unphysical times (drift electrons arriving 
+   // at wire before particle passes the doca to the wire) 
+   double v_max = 0.08; // guess for now based on Garfield, near wire 
+   double tmin_ns = dradius_cm / v_max;
+   return (tdrift_ns < tmin_ns)? tmin_ns : tdrift_ns;
 }
 
 void GlueXSensitiveDetectorCDC::add_cluster(GlueXHitCDCstraw *straw,
@@ -528,8 +691,6 @@ void GlueXSensitiveDetectorCDC::add_cluster(GlueXHitCDCstraw *straw,
 
    // drift radius 
    double dradius_cm = xlocal.perp() / cm;
-   double d2 = dradius_cm * dradius_cm;
-   double d3 = dradius_cm * d2;  
 
    // Find the drift time for this cluster. Drift time depends on B:
    // (dependence derived from Garfield calculations)
@@ -538,40 +699,8 @@ void GlueXSensitiveDetectorCDC::add_cluster(GlueXHitCDCstraw *straw,
                      ->GetMagneticField(x, tesla);
    double BmagT = B.mag();
 
-  // Check for closeness to boundaries of the drift table
-
-   double my_t_ns;
-   double my_t_err;
-   int i = (int)(dradius_cm * 100);
-   if (i >= CDC_DRIFT_TABLE_LEN - 3) {
-      // Do a crude linear extrapolation
-      my_t_ns = fDrift_time[CDC_DRIFT_TABLE_LEN - 3] + 
-                (dradius_cm - fDrift_distance[CDC_DRIFT_TABLE_LEN - 3]) *
-                (fDrift_time[CDC_DRIFT_TABLE_LEN - 1] -
-                 fDrift_time[CDC_DRIFT_TABLE_LEN - 3]) / 0.02;
-   }
-   else {
-      int index = (i < 1)? 0 : i - 1;
-
-      // Interpolate over the drift table to find 
-      // an approximation for the drift time
-      polint(&fDrift_distance[index],
-             &fDrift_time[index], 4, dradius_cm, &my_t_ns, &my_t_err);
-   }
-   double tdrift_ns = my_t_ns / (1 - fBscale_par1 - fBscale_par2 * BmagT);
-
-   // Longitudinal diffusion 
-
-   double dt_ns = (7.515 * dradius_cm - 2.139 * d2 + 12.63 * d3) * ns;
-   tdrift_ns += dt_ns * G4RandGauss::shoot();
-
-   // Prevent unphysical times (drift electrons arriving 
-   // at wire before particle passes the doca to the wire) 
-   double v_max = 0.08; // guess for now based on Garfield, near wire 
-   double tmin_ns = dradius_cm / v_max;
-   if (tdrift_ns < tmin_ns) {
-      tdrift_ns = tmin_ns;
-   }
+   double bscale = bscale_factor(BmagT);
+   double tdrift_ns = drift_time_ns(dradius_cm, bscale, G4RandGauss::shoot());
    double total_time = t + tdrift_ns*ns;
 
    // Skip cluster if the time would go beyond readout window
@@ -601,19 +730,10 @@ void GlueXSensitiveDetectorCDC::add_cluster(GlueXHitCDCstraw *straw,
    // Add the hit to the hits vector, maintaining strict time ordering
 
    std::vector<GlueXHitCDCstraw::hitinfo_t>::iterator hiter;
-   for (hiter = straw->hits.begin(); hiter != straw->hits.end(); ++hiter) {
-      if (fabs(hiter->t_ns - total_time) < TWO_HIT_TIME_RESOL) {
-         break;
-      }
-      else if (hiter->t_ns > total_time) {
-         hiter = straw->hits.insert(hiter, GlueXHitCDCstraw::hitinfo_t());
-         hiter->t_ns = 1e99;
-         break;
-      }
-   }
+   hiter = FindHitSlot(straw->hits, total_time, TWO_HIT_TIME_RESOL);
 
-   GlueXUserTrackInformation *trackinfo = (GlueXUserTrackInformation*)
-                                          track->GetUserInformation();
+   GlueXUserTrackInformation *trackinfo =
+      GlueXUserTrackInformation::Get(track);
    if (hiter != straw->hits.end()) {             // merge with former hit
       // Use the time from the earlier hit but add the charge
       hiter->q_fC += q_fC;
@@ -648,6 +768,159 @@ void GlueXSensitiveDetectorCDC::add_cluster(GlueXHitCDCstraw *straw,
    }
 }
 
+void GlueXSensitiveDetectorCDC::MergeHit(GlueXHitCDCstraw &straw,
+                                         const GlueXHitCDCstraw &from,
+                                         const GlueXSubEvents::hits_t &part)
+{
+   // The hits in a straw from one bundle of an event are merged into those
+   // from the bundles before it one at a time, the same way as add_cluster
+   // merges a new cluster, keeping the charge and the earliest hit info.
+
+   for (unsigned int ih=0; ih < from.hits.size(); ++ih) {
+      GlueXHitCDCstraw::hitinfo_t hit = from.hits[ih];
+      hit.itrack_ = part.RenumberGlueXTrack((int)hit.itrack_);
+      std::vector<GlueXHitCDCstraw::hitinfo_t>::iterator hiter;
+      hiter = FindHitSlot(straw.hits, hit.t_ns*ns, TWO_HIT_TIME_RESOL);
+      if (hiter != straw.hits.end()) {
+         double q_fC = hiter->q_fC + hit.q_fC;
+         if (hiter->t_ns > hit.t_ns)
+            *hiter = hit;
+         hiter->q_fC = q_fC;
+      }
+      else if ((int)straw.hits.size() < MAX_HITS) {
+         straw.hits.push_back(hit);
+      }
+      else {
+         G4cerr << "GlueXSensitiveDetectorCDC::MergeHit error: "
+                << "max hit count " << MAX_HITS << " exceeded, truncating!"
+                << G4endl;
+         break;
+      }
+   }
+}
+
+void GlueXSensitiveDetectorCDC::RenumberPoint(GlueXHitCDCpoint &point,
+                                         const GlueXSubEvents::hits_t &part)
+{
+   point.track_ = part.RenumberTrack(point.track_);
+   point.trackID_ = part.RenumberGlueXTrack(point.trackID_);
+}
+
+void GlueXSensitiveDetectorCDC::add_clusters(GlueXHitCDCstraw *straw,
+                                             G4Track *track,
+                                             int n_p,
+                                             double t,
+                                             G4ThreeVector xin,
+                                             G4ThreeVector dx,
+                                             G4ThreeVector xinlocal,
+                                             G4ThreeVector dxlocal)
+{
+   // Generate n_p single-ion-pair clusters at random positions along the
+   // step, as add_cluster would do one at a time, but drawing all of the
+   // random numbers in bulk and looking up the field at all of the
+   // cluster positions in a single batch call to the field map. The
+   // new clusters are then sorted by time and merged with the existing
+   // hits on the straw in a single pass, following the same rules for
+   // merging within TWO_HIT_TIME_RESOL as add_cluster.
+
+   if (n_p <= 0)
+      return;
+   fClusterU.resize(n_p);
+   fClusterGauss.resize(n_p);
+   fClusterSecondaries.resize(n_p);
+   G4RandFlat::shootArray(n_p, &fClusterU[0]);
+   G4RandGauss::shootArray(n_p, &fClusterGauss[0]);
+   CLHEP::RandPoisson::shootArray(n_p, &fClusterSecondaries[0],
+                                  N_SECOND_PER_PRIMARY);
+
+   fClusterPoints.resize(n_p * 4);
+   fClusterField.resize(n_p * 3);
+   for (int n=0; n < n_p; ++n) {
+      G4ThreeVector x = xin + fClusterU[n] * dx;
+      fClusterPoints[n * 4] = x[0];
+      fClusterPoints[n * 4 + 1] = x[1];
+      fClusterPoints[n * 4 + 2] = x[2];
+      fClusterPoints[n * 4 + 3] = t;
+   }
+   GlueXDetectorConstruction::GetInstance()
+      ->GetMagneticFields(n_p, &fClusterPoints[0], &fClusterField[0]);
+
+   GlueXUserTrackInformation *trackinfo =
+      GlueXUserTrackInformation::Get(track);
+   int pdgtype = track->GetDynamicParticle()->GetPDGcode();
+   int g3type = GlueXPrimaryGeneratorAction::ConvertPdgToGeant3(pdgtype);
+   GlueXHitCDCstraw::hitinfo_t newhit;
+   newhit.itrack_ = trackinfo->GetGlueXTrackID();
+   newhit.ptype_G3 = g3type;
+   newhit.t0_ns = t/ns;
+   double q_unit_fC = GAS_GAIN * ELECTRON_CHARGE/fC;
+
+   fClusters.clear();
+   for (int n=0; n < n_p; ++n) {
+      double u = fClusterU[n];
+      double dradius_cm = (xinlocal + u * dxlocal).perp() / cm;
+      G4ThreeVector B(fClusterField[n * 3], fClusterField[n * 3 + 1],
+                      fClusterField[n * 3 + 2]);
+      double bscale = bscale_factor(B.mag() / tesla);
+      double tdrift_ns = drift_time_ns(dradius_cm, bscale, fClusterGauss[n]);
+      double total_time = t + tdrift_ns*ns;
+      if (total_time > CDC_TIME_WINDOW)
+         continue;
+      newhit.t_ns = total_time/ns;
+      newhit.q_fC = q_unit_fC * (1 + fClusterSecondaries[n]);
+      newhit.d_cm = dradius_cm;
+      newhit.z_cm = (xin[2] + u * dx[2])/cm;
+      fClusters.push_back(newhit);
+   }
+   std::sort(fClusters.begin(), fClusters.end(),
+             GlueXHitCDCstraw::earlier);
+
+   // Sweep through the existing hits and the new clusters together in
+   // time order. Each new cluster merges with the first hit that is
+   // within the two-hit resolution or later than it, or else goes after
+   // all of them. Merging adds the charge and keeps the earlier time, so
+   // the output stays time ordered.
+
+   std::vector<GlueXHitCDCstraw::hitinfo_t> &hits = straw->hits;
+   fMergedHits.clear();
+   fMergedHits.reserve(hits.size() + fClusters.size());
+   unsigned int i = 0;
+   for (unsigned int n=0; n < fClusters.size(); ++n) {
+      GlueXHitCDCstraw::hitinfo_t &cluster = fClusters[n];
+      double tlow = cluster.t_ns - TWO_HIT_TIME_RESOL/ns;
+      while (i < hits.size() && hits[i].t_ns <= tlow)
+         fMergedHits.push_back(hits[i++]);
+      GlueXHitCDCstraw::hitinfo_t *hit = 0;
+      if (fMergedHits.size() > 0 && fMergedHits.back().t_ns > tlow)
+         hit = &fMergedHits.back();
+      else if (i < hits.size() && hits[i].t_ns - cluster.t_ns <
+                                  TWO_HIT_TIME_RESOL/ns)
+         hit = &hits[i];
+      if (hit) {                                  // merge with former hit
+         hit->q_fC += cluster.q_fC;
+         if (hit->t_ns > cluster.t_ns) {
+            double q_fC = hit->q_fC;
+            *hit = cluster;
+            hit->q_fC = q_fC;
+         }
+      }
+      else if (i < hits.size() ||                 // insert before next hit
+               (int)(fMergedHits.size() + hits.size() - i) < MAX_HITS)
+      {
+         fMergedHits.push_back(cluster);
+      }
+      else {
+         G4cerr << "GlueXSensitiveDetectorCDC::add_clusters error: "
+                << "max hit count " << MAX_HITS << " exceeded, truncating!"
+                << G4endl;
+      }
+   }
+   if (fMergedHits.size() > 0) {
+      fMergedHits.insert(fMergedHits.end(), hits.begin() + i, hits.end());
+      hits.swap(fMergedHits);
+   }
+}
+
 void GlueXSensitiveDetectorCDC::polint(double *xa, double *ya, int n,
                                        double x, double *y, double *dy)
 {
@@ -657,8 +930,12 @@ void GlueXSensitiveDetectorCDC::polint(double *xa, double *ya, int n,
    // Scientific Computing" (Fortran), Cambrigde University Press,
    // pp. 80-82.
 
-   double *c = NULL;
-   double *d = NULL;
+   // The workspace is held on the stack, in place of the original
+   // malloc/free, for the short stencils used here.
+
+   const int nmax = 8;
+   double c[nmax];
+   double d[nmax];
    double den;
    double dif;
    double dift;
@@ -670,17 +947,11 @@ void GlueXSensitiveDetectorCDC::polint(double *xa, double *ya, int n,
    int m;
    int ns;
 
-   if ((c = (double*)malloc(n*sizeof(double))) == NULL ||
-       (d = (double*)malloc(n*sizeof(double))) == NULL )
-   {
-      fprintf(stderr, "polint error: allocating workspace\n" );
+   if (n > nmax) {
+      fprintf(stderr, "polint error: more than %d points requested\n", nmax);
       fprintf(stderr, "polint error: setting y = 0 and dy = 1e9\n" );
       *y = 0.0;
       *dy = 1.e9;
-      if (c != NULL)
-         free(c);
-      if (d != NULL )
-         free(d);
       return;
    }
 
@@ -708,10 +979,6 @@ void GlueXSensitiveDetectorCDC::polint(double *xa, double *ya, int n,
             fprintf( stderr, "polint error: setting y = 0 and dy = 1e9\n" );
             *y = 0.0;
             *dy = 1.e9;
-            if (c != NULL)
-               free(c);
-            if (d != NULL)
-               free(d);
             return;
          }
          den = w/den;
@@ -727,31 +994,11 @@ void GlueXSensitiveDetectorCDC::polint(double *xa, double *ya, int n,
       }
       *y = (*y)+(*dy);
    }
-
-   if (c != NULL)
-      free(c);
-   if (d != NULL)
-      free(d);
 }
 
 int GlueXSensitiveDetectorCDC::GetIdent(std::string div, 
                                         const G4VTouchable *touch)
 {
-   const HddsG4Builder* bldr = GlueXDetectorConstruction::GetBuilder();
-   std::map<std::string, std::vector<int> >::const_iterator iter;
-   std::map<std::string, std::vector<int> > *identifiers;
-   int max_depth = touch->GetHistoryDepth();
-   for (int depth = 0; depth < max_depth; ++depth) {
-      G4VPhysicalVolume *pvol = touch->GetVolume(depth);
-      G4LogicalVolume *lvol = pvol->GetLogicalVolume();
-      int volId = fVolumeTable[lvol];
-      if (volId == 0) {
-         volId = bldr->getVolumeId(lvol);
-         fVolumeTable[lvol] = volId;
-      }
-      identifiers = &Refsys::fIdentifierTable[volId];
-      if ((iter = identifiers->find(div)) != identifiers->end())
-         return iter->second[pvol->GetCopyNo() - 1];
-   }
-   return -1;
+   return GlueXVolumeIdentifiers::GetIdent(
+                        GlueXVolumeIdentifiers::GetKey(div), touch);
 }
@@ -11,7 +11,7 @@
 #ifndef GlueXSensitiveDetectorCDC_h
 #define GlueXSensitiveDetectorCDC_h 1
 
-#include "G4VSensitiveDetector.hh"
+#include "GlueXSensitiveDetector.hh"
 #include "G4VPhysicalVolume.hh"
 #include "G4Threading.hh"
 #include "G4AutoLock.hh"
@@ -24,7 +24,8 @@
 class G4Step;
 class G4HCofThisEvent;
 
-class GlueXSensitiveDetectorCDC : public G4VSensitiveDetector
+class GlueXSensitiveDetectorCDC
+ : public GlueXSensitiveDetector<GlueXHitCDCstraw, GlueXHitCDCpoint>
 {
  public:
    GlueXSensitiveDetectorCDC(const G4String& name);
@@ -32,24 +33,53 @@ class GlueXSensitiveDetectorCDC : public G4VSensitiveDetector
    GlueXSensitiveDetectorCDC &operator=(const GlueXSensitiveDetectorCDC &right);
    virtual ~GlueXSensitiveDetectorCDC();
   
-   virtual void Initialize(G4HCofThisEvent* hitCollection);
    virtual G4bool ProcessHits(G4Step* step, G4TouchableHistory* unused);
-   virtual void EndOfEvent(G4HCofThisEvent* hitCollection);
 
    int GetIdent(std::string div, const G4VTouchable *touch);
+   static int GetStrawIndex(int ring, int sector);
+
+   // Waveform synthesis for drift-cluster mode, public so that it can
+   // be benchmarked outside of a simulation run (test/cdcwave_bench.cc)
+   static void InitAsicKernel();
+   static void GetWaveformWindow(const GlueXHitCDCstraw *straw,
+                                 int num_samples, int &first, int &last);
+   static void cdc_wire_signal_mV(const GlueXHitCDCstraw *straw,
+                                  double *samples, int first, int last);
 
  private:
-   double asic_response(double t_ns); 
-   double cdc_wire_signal_mV(double t_ns, GlueXHitCDCstraw *straw);
+   static double asic_response(double t_ns); 
+   virtual void PackHits(hddm_s::HitView &hitview);
+   virtual void MergeHit(GlueXHitCDCstraw &straw,
+                         const GlueXHitCDCstraw &from,
+                         const GlueXSubEvents::hits_t &part);
+   virtual void RenumberPoint(GlueXHitCDCpoint &point,
+                              const GlueXSubEvents::hits_t &part);
    void add_cluster(GlueXHitCDCstraw *straw, G4Track *track, int n_p,
                     double t, G4ThreeVector xlocal, G4ThreeVector xglobal);
-   void polint(double *xa, double *ya, int n, double x, double *y, double *dy);
+   void add_clusters(GlueXHitCDCstraw *straw, G4Track *track, int n_p,
+                     double t, G4ThreeVector xin, G4ThreeVector dx,
+                     G4ThreeVector xinlocal, G4ThreeVector dxlocal);
+   static double bscale_factor(double BmagT);
+   static double drift_time_ns(double dradius_cm, double bscale,
+                               double gauss);
+   static void InitDriftTable();
+   static void polint(double *xa, double *ya, int n, double x,
+                      double *y, double *dy);
 
  private:
-   GlueXHitsMapCDCstraw* fStrawsMap;
-   GlueXHitsMapCDCpoint* fPointsMap;
+   std::vector<double> fSamples;  // waveform buffer, reused for all straws
+
+   // scratch space for add_clusters, reused for all steps
+   std::vector<GlueXHitCDCstraw::hitinfo_t> fClusters;
+   std::vector<GlueXHitCDCstraw::hitinfo_t> fMergedHits;
+   std::vector<double> fClusterU;
+   std::vector<double> fClusterGauss;
+   std::vector<long> fClusterSecondaries;
+   std::vector<double> fClusterPoints;
+   std::vector<double> fClusterField;
 
-   static std::map<G4LogicalVolume*, int> fVolumeTable;
+   static int fRingKey;           // interned identifier keys,
+   static int fSectorKey;         // see GlueXVolumeIdentifiers
 
    static const double ELECTRON_CHARGE;
    static double DRIFT_SPEED;
@@ -64,12 +94,47 @@ class GlueXSensitiveDetectorCDC : public G4VSensitiveDetector
    static int MAX_HITS;
 
    static int fDrift_clusters;
+
+#define CDC_NUM_RINGS 28
+#define CDC_NUM_STRAWS 3522
+   static const int CDC_RING_STRAWS[CDC_NUM_RINGS];
+   static int fRingOffset[CDC_NUM_RINGS];
 #define CDC_DRIFT_TABLE_LEN 78
    static double fDrift_time[CDC_DRIFT_TABLE_LEN];
    static double fDrift_distance[CDC_DRIFT_TABLE_LEN];
    static double fBscale_par1;
    static double fBscale_par2;
 
+   // Drift time and longitudinal diffusion width as functions of the
+   // drift radius, tabulated at construction time from the ccdb drift
+   // table in steps of DRIFT_TABLE_STEP, and the magnetic field scale
+   // factor 1/(1 - bscale_par1 - bscale_par2 |B|) tabulated in steps of
+   // BSCALE_TABLE_STEP. The field dependence is a pure scale factor, so
+   // the drift time over (radius, |B|) is the product of the two tables.
+   // Both are evaluated by linear interpolation, and extrapolated from
+   // their last interval beyond the end of the table.
+   struct drift_node_t {
+      double t_ns;               // drift time at |B|=0
+      double sigma_ns;           // longitudinal diffusion width
+   };
+   static double DRIFT_TABLE_STEP;
+   static double DRIFT_TABLE_MAX;
+   static double BSCALE_TABLE_STEP;
+   static double BSCALE_TABLE_MAX;
+   static std::vector<drift_node_t> fDrift_table;
+   static std::vector<double> fBscale_table;
+
+   // ASIC response to a unit cluster, tabulated at construction time
+   // in steps of ASIC_KERNEL_STEP starting at t=0, and truncated where
+   // the tail becomes negligible. The analytic form of the response
+   // in asic_response() is parameterized by fAsic_par. The envelope
+   // table holds the maximum of |response| from each point onwards, to
+   // bound the extent of the waveform above threshold.
+   static double ASIC_KERNEL_STEP;
+   static double fAsic_par[11];
+   static std::vector<double> fAsic_kernel;
+   static std::vector<double> fAsic_envelope;
+
    static int instanceCount;
    static G4Mutex fMutex;
 };
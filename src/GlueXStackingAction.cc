@@ -0,0 +1,18 @@
+//
+// GlueXStackingAction class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXStackingAction.hh"
+#include "GlueXTrackKiller.hh"
+
+#include "G4Track.hh"
+
+G4ClassificationOfNewTrack
+GlueXStackingAction::ClassifyNewTrack(const G4Track* aTrack)
+{
+   if (GlueXTrackKiller::KillNewTrack(aTrack))
+      return fKill;
+   return fUrgent;
+}
@@ -0,0 +1,29 @@
+//
+// GlueXStackingAction class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Drops new tracks that GlueXTrackKiller says can never produce a
+// recorded hit, before any time is spent tracking them. All others
+// go on the urgent stack, as they would without a stacking action.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "thread-local", ie. has thread-local state.
+// Separate object instances are created for each worker thread.
+
+#ifndef _GLUEXSTACKINGACTION_
+#define _GLUEXSTACKINGACTION_
+
+#include "G4UserStackingAction.hh"
+
+class GlueXStackingAction : public G4UserStackingAction
+{
+ public:
+   GlueXStackingAction() {}
+   ~GlueXStackingAction() {}
+
+   virtual G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track*);
+};
+
+#endif // _GLUEXSTACKINGACTION_
@@ -0,0 +1,223 @@
+//
+// GlueXStepProfiler - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXStepProfiler.hh"
+#include "GlueXUserOptions.hh"
+
+#include "G4LogicalVolumeStore.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4AutoLock.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+G4ThreadLocal GlueXStepProfiler::thread_table_t
+*GlueXStepProfiler::fTable = 0;
+std::map<GlueXStepProfiler::name_key_t, GlueXStepProfiler::profile_total_t>
+GlueXStepProfiler::fTotals;
+bool GlueXStepProfiler::fPrepared = false;
+int GlueXStepProfiler::fTopLines = 0;
+double GlueXStepProfiler::fTickSeconds = 1e-9;
+G4Mutex GlueXStepProfiler::fMutex = G4MUTEX_INITIALIZER;
+
+static inline unsigned long long read_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+   return __rdtsc();
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static double clock_seconds()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void GlueXStepProfiler::Prepare()
+{
+   G4AutoLock barrier(&fMutex);
+   if (fPrepared)
+      return;
+   fPrepared = true;
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   std::map<int, int> profile_opts;
+   if (user_opts == 0 || ! user_opts->Find("STEPPROFILE", profile_opts) ||
+       profile_opts[1] <= 0)
+   {
+      return;
+   }
+
+   // The rate of the timestamp counter is measured against the clock
+   // over a short interval, where it does not count in nanoseconds.
+
+#if defined(__x86_64__) || defined(__i386__)
+   double t0 = clock_seconds();
+   unsigned long long c0 = read_ticks();
+   double t1 = t0;
+   while (t1 - t0 < 0.02)
+      t1 = clock_seconds();
+   unsigned long long c1 = read_ticks();
+   fTickSeconds = (t1 - t0) / (c1 - c0);
+#endif
+   fTopLines = profile_opts[1];
+   G4cout << "GlueXStepProfiler: profiling the tracking time, with the "
+          << "timestamp counter at " << 1e-9 / fTickSeconds << " GHz"
+          << G4endl;
+}
+
+void GlueXStepProfiler::StartTrack(const G4Track *track)
+{
+   if (fTopLines == 0)
+      return;
+   if (fTable == 0) {
+      fTable = new thread_table_t;
+      fTable->current = 0;
+   }
+   row_key_t key(track->GetDefinition(), track->GetCreatorProcess());
+   profile_row_t *&row = fTable->rows[key];
+   if (row == 0) {
+      row = new profile_row_t;
+      row->particle = key.first;
+      row->creator = key.second;
+      profile_cell_t zero = {0, 0};
+      row->cells.assign(G4LogicalVolumeStore::GetInstance()->size(), zero);
+   }
+   fTable->current = row;
+   fTable->last = read_ticks();
+}
+
+void GlueXStepProfiler::ProcessStep(const G4Step *step)
+{
+   if (fTopLines == 0 || fTable == 0 || fTable->current == 0)
+      return;
+   unsigned long long now = read_ticks();
+   G4VPhysicalVolume *pvol = step->GetPreStepPoint()->GetPhysicalVolume();
+   if (pvol) {
+      unsigned int id = pvol->GetLogicalVolume()->GetInstanceID();
+      std::vector<profile_cell_t> &cells = fTable->current->cells;
+      if (id >= cells.size()) {
+         profile_cell_t zero = {0, 0};
+         cells.resize(id + 1, zero);
+      }
+      ++cells[id].steps;
+      cells[id].ticks += now - fTable->last;
+   }
+   fTable->last = now;
+}
+
+void GlueXStepProfiler::Merge()
+{
+   if (fTopLines == 0 || fTable == 0)
+      return;
+   std::map<int, std::string> volumes;
+   G4LogicalVolumeStore *store = G4LogicalVolumeStore::GetInstance();
+   G4LogicalVolumeStore::iterator iter;
+   for (iter = store->begin(); iter != store->end(); ++iter)
+      volumes[(*iter)->GetInstanceID()] = (*iter)->GetName();
+
+   G4AutoLock barrier(&fMutex);
+   std::map<row_key_t, profile_row_t*>::iterator riter;
+   for (riter = fTable->rows.begin(); riter != fTable->rows.end(); ++riter) {
+      profile_row_t *row = riter->second;
+      std::string particle(row->particle->GetParticleName());
+      std::string creator((row->creator)? row->creator->GetProcessName()
+                                        : G4String("primary"));
+      for (unsigned int id=0; id < row->cells.size(); ++id) {
+         if (row->cells[id].steps == 0)
+            continue;
+         name_key_t key(volumes[id], std::make_pair(particle, creator));
+         profile_total_t &total = fTotals[key];
+         total.steps += row->cells[id].steps;
+         total.seconds += row->cells[id].ticks * fTickSeconds;
+      }
+      delete row;
+   }
+   fTable->rows.clear();
+   fTable->current = 0;
+}
+
+static bool by_seconds(const std::pair<double, std::string> &a,
+                       const std::pair<double, std::string> &b)
+{
+   return a.first > b.first;
+}
+
+void GlueXStepProfiler::PrintReport()
+{
+   if (fTopLines == 0)
+      return;
+   G4AutoLock barrier(&fMutex);
+   double seconds = 0;
+   long steps = 0;
+   std::map<std::string, profile_total_t> byVolume;
+   std::vector<std::pair<double, std::string> > lines;
+   std::map<name_key_t, profile_total_t>::iterator iter;
+   for (iter = fTotals.begin(); iter != fTotals.end(); ++iter) {
+      const profile_total_t &total = iter->second;
+      seconds += total.seconds;
+      steps += total.steps;
+      profile_total_t &vol = byVolume[iter->first.first];
+      vol.steps += total.steps;
+      vol.seconds += total.seconds;
+      std::stringstream line;
+      line << std::setw(10) << total.steps << " "
+           << std::setw(8) << 1e9 * total.seconds / total.steps << "  "
+           << iter->first.first << " " << iter->first.second.first
+           << " " << iter->first.second.second;
+      lines.push_back(std::make_pair(total.seconds, line.str()));
+   }
+   if (steps == 0)
+      return;
+
+   std::sort(lines.begin(), lines.end(), by_seconds);
+   G4cout << "GlueXStepProfiler: " << seconds << " s in " << steps
+          << " steps, top " << fTopLines << " of " << lines.size()
+          << " by volume, particle and creator process:" << G4endl
+          << "   time(s)  share      steps  ns/step  "
+          << "volume particle creator" << G4endl;
+   for (int i=0; i < fTopLines && i < (int)lines.size(); ++i) {
+      G4cout << std::setw(10) << lines[i].first << " "
+             << std::setw(5) << std::fixed << std::setprecision(1)
+             << 100 * lines[i].first / seconds << "% "
+             << std::resetiosflags(std::ios::fixed) << std::setprecision(6)
+             << lines[i].second << G4endl;
+   }
+
+   lines.clear();
+   std::map<std::string, profile_total_t>::iterator viter;
+   for (viter = byVolume.begin(); viter != byVolume.end(); ++viter) {
+      std::stringstream line;
+      line << std::setw(10) << viter->second.steps << " "
+           << std::setw(8) << 1e9 * viter->second.seconds
+                                  / viter->second.steps
+           << "  " << viter->first;
+      lines.push_back(std::make_pair(viter->second.seconds, line.str()));
+   }
+   std::sort(lines.begin(), lines.end(), by_seconds);
+   G4cout << "GlueXStepProfiler: top " << fTopLines << " of "
+          << lines.size() << " by volume:" << G4endl
+          << "   time(s)  share      steps  ns/step  volume" << G4endl;
+   for (int i=0; i < fTopLines && i < (int)lines.size(); ++i) {
+      G4cout << std::setw(10) << lines[i].first << " "
+             << std::setw(5) << std::fixed << std::setprecision(1)
+             << 100 * lines[i].first / seconds << "% "
+             << std::resetiosflags(std::ios::fixed) << std::setprecision(6)
+             << lines[i].second << G4endl;
+   }
+   fTotals.clear();
+}
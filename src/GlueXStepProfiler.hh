@@ -0,0 +1,102 @@
+//
+// GlueXStepProfiler - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Profiler of the tracking, which finds out where the time of a job goes
+// by volume, particle and the process that created the track, so as to
+// guide where the KILL cards and fast shower models are best applied. It
+// is switched on at run time by the STEPPROFILE card in control.in, with
+// the number of lines to show in each part of the report, and costs
+// nothing more than a test on each step otherwise.
+//
+// The time between one call to the stepping action and the next is
+// taken with the cpu timestamp counter where there is one, or else the
+// monotonic clock, and is counted against the step that ends with the
+// second call, along with the step itself, in the volume where the step
+// started. The time from the start of a track to its first step is
+// counted the same way. This is elapsed time rather than cpu time, so
+// the two only agree when each worker thread has a cpu of its own. Time
+// spent outside of the tracking of steps, in the primary generator, the
+// stacking or the output, is not counted.
+//
+// Each thread keeps its own tables, with a row for each combination of
+// particle and creator process, looked up once at the start of a track,
+// holding an entry for every logical volume, indexed by instance id, so
+// that nothing more than two additions is done on each step. At the end
+// of each run the tables of all threads are merged by name, and the
+// master prints a report ranked by time, of the combinations of volume,
+// particle and creator, followed by the totals for each volume.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "thread-local", ie. has thread-local state. The tables
+// are held by each thread, and merged under a lock at the end of a run.
+
+#ifndef GlueXStepProfiler_h
+#define GlueXStepProfiler_h 1
+
+#include "G4Track.hh"
+#include "G4Step.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4VProcess.hh"
+#include "G4Threading.hh"
+
+#include <string>
+#include <vector>
+#include <map>
+
+class GlueXStepProfiler
+{
+ public:
+   // Read the card, the first time it is called, at the start of a run.
+   static void Prepare();
+
+   static bool IsActive() {
+      return fTopLines > 0;
+   }
+
+   static void StartTrack(const G4Track *track);
+   static void ProcessStep(const G4Step *step);
+
+   // Add the tables of the calling thread to the totals for the run.
+   static void Merge();
+   // Print the totals for the run and start over, by the master.
+   static void PrintReport();
+
+ private:
+   GlueXStepProfiler() {}
+
+   struct profile_cell_t {
+      long steps;
+      unsigned long long ticks;
+   };
+   struct profile_row_t {
+      const G4ParticleDefinition *particle;
+      const G4VProcess *creator;
+      std::vector<profile_cell_t> cells;    // by volume instance id
+   };
+   typedef std::pair<const G4ParticleDefinition*, const G4VProcess*>
+           row_key_t;
+   struct thread_table_t {
+      std::map<row_key_t, profile_row_t*> rows;
+      profile_row_t *current;
+      unsigned long long last;
+   };
+   static G4ThreadLocal thread_table_t *fTable;
+
+   struct profile_total_t {
+      long steps;
+      double seconds;
+   };
+   typedef std::pair<std::string, std::pair<std::string, std::string> >
+           name_key_t;                      // volume, particle, creator
+   static std::map<name_key_t, profile_total_t> fTotals;
+
+   static bool fPrepared;
+   static int fTopLines;
+   static double fTickSeconds;
+   static G4Mutex fMutex;
+};
+
+#endif
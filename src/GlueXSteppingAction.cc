@@ -5,8 +5,38 @@
 // version: may 12, 2012
 
 #include "GlueXSteppingAction.hh"
+#include "GlueXBackgroundLibrary.hh"
+#include "GlueXEventFilter.hh"
+#include "GlueXFastShowerModel.hh"
+#include "GlueXTrackKiller.hh"
+#include "GlueXStepProfiler.hh"
+#include "GlueXTelemetry.hh"
 #include "G4SteppingManager.hh"
 
-void GlueXSteppingAction::UserSteppingAction(const G4Step*)
+void GlueXSteppingAction::UserSteppingAction(const G4Step* step)
 { 
+   // Time since the last step, when profiling, see GlueXStepProfiler
+
+   GlueXStepProfiler::ProcessStep(step);
+   GlueXTelemetry::CountStep();
+
+   // A job recording a background library stops the beam photons
+   // as they reach the library plane, see GlueXBackgroundLibrary.
+
+   GlueXBackgroundLibrary *library = GlueXBackgroundLibrary::GetRecorder();
+   if (library)
+      library->Record(step);
+
+   // Event filters that look at the tracking, see GlueXEventFilter
+
+   GlueXEventFilter::ProcessStep(step);
+
+   // Energy sums for the validation of the fast shower model, if any
+
+   GlueXFastShowerModel::ProcessStep(step);
+
+   // Tracks past the limits of the KILL cards stop here, after the
+   // filters have seen their last step, see GlueXTrackKiller.
+
+   GlueXTrackKiller::ProcessStep(step);
 }
@@ -6,18 +6,75 @@
 
 #include "GlueXSteppingVerbose.hh"
 #include "GlueXPathFinder.hh"
+#include "GlueXUserOptions.hh"
+#include "GlueXProcessPool.hh"
+#include "HddmOutput.hh"
 
 #include "G4TransportationManager.hh"
 #include "G4Navigator.hh"
 #include "G4SteppingManager.hh"
 #include "G4UnitsTable.hh"
+#include "G4EventManager.hh"
+#include "G4Event.hh"
+
+#include <sstream>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 #define G4setw std::setw
 
+static_assert(sizeof(GlueXSteppingVerbose::trace_record_t) == 48 &&
+              sizeof(GlueXSteppingVerbose::name_record_t) == 48,
+              "step trace records must be 48 bytes");
+
 G4Mutex GlueXSteppingVerbose::fMutex = G4MUTEX_INITIALIZER;
+std::string GlueXSteppingVerbose::fTraceFile;
+bool GlueXSteppingVerbose::fTraceChecked = false;
+
+// pseudo-processes, keyed in the process table by these addresses
+static const char kUserLimit[] = "UserLimit";
+static const char kOutOfWorld[] = "OutOfWorld";
+static const char kInitStep[] = "initStep";
+
+GlueXSteppingVerbose::GlueXSteppingVerbose()
+ : fTrace(0)
+{
+   G4AutoLock barrier(&fMutex);
+   if (! fTraceChecked) {
+      fTraceChecked = true;
+      GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+      std::map<int, std::string> trace_opts;
+      if (user_opts && user_opts->Find("STEPTRACE", trace_opts))
+         fTraceFile = trace_opts[1];
+   }
+}
+
+GlueXSteppingVerbose::~GlueXSteppingVerbose()
+{
+   if (fTrace) {
+      FlushTrace();
+      fTrace->close();
+      delete fTrace;
+   }
+}
 
 void GlueXSteppingVerbose::StepInfo()
 {
+   if (fTraceFile.size() > 0) {
+      if (verboseLevel >= 1) {
+         CopyState();
+         const G4VProcess* process
+                       = fStep->GetPostStepPoint()->GetProcessDefinedStep();
+         const void *proc = (process)? (const void*)process : kUserLimit;
+         if (fStepStatus == fWorldBoundary)
+            proc = kOutOfWorld;
+         G4VPhysicalVolume *pvol = GlueXPathFinder::GetLocatedVolume();
+         TraceStep(pvol, proc);
+      }
+      return;
+   }
+
    G4AutoLock barrier(&fMutex);
    CopyState();
    G4int prec = G4cout.precision(5);
@@ -95,6 +152,14 @@ void GlueXSteppingVerbose::StepInfo()
 
 void GlueXSteppingVerbose::TrackingStarted()
 {
+   if (fTraceFile.size() > 0) {
+      if (verboseLevel > 0) {
+         CopyState();
+         TraceStep(fTrack->GetVolume(), kInitStep);
+      }
+      return;
+   }
+
    G4AutoLock barrier(&fMutex);
    CopyState();
    G4int prec = G4cout.precision(5);
@@ -148,3 +213,119 @@ void GlueXSteppingVerbose::TrackingStarted()
 
    G4cout.precision(prec);
 }
+
+void GlueXSteppingVerbose::TraceStep(G4VPhysicalVolume *pvol,
+                                     const void *proc)
+{
+   // Nothing is shared between threads here, each one having its own
+   // instance of this class and its own trace file.
+
+   if (fTrace == 0) {
+      std::string filename(fTraceFile);
+      int thread = G4Threading::G4GetThreadId();
+      if (thread >= 0)
+         filename = HddmOutput::ShardName(filename, thread);
+      if (GlueXProcessPool::GetProcessCount() > 0) {
+         std::stringstream pid;
+         pid << "." << getpid();
+         filename += pid.str();
+      }
+      fTrace = new std::ofstream(filename.c_str(), std::ios::binary);
+      if (! fTrace->is_open()) {
+         G4cerr << "GlueXSteppingVerbose::TraceStep error - "
+                << "unable to open step trace file " << filename
+                << ", cannot continue." << G4endl;
+         exit(-1);
+      }
+      fTraceBuffer.reserve(kTraceBuffer);
+      TraceName(kFileHeader, kTraceVersion, "hdgeant4 step trace");
+   }
+
+   int volume = 0;
+   int copyno = 0;
+   if (pvol) {
+      std::map<const G4VPhysicalVolume*, int>::iterator viter;
+      viter = fTraceVolumes.find(pvol);
+      if (viter == fTraceVolumes.end()) {
+         volume = fTraceVolumes.size() + 1;
+         fTraceVolumes[pvol] = volume;
+         TraceName(kVolumeName, volume, pvol->GetName());
+      }
+      else {
+         volume = viter->second;
+      }
+      copyno = pvol->GetCopyNo();
+   }
+   int process;
+   std::map<const void*, int>::iterator piter = fTraceProcesses.find(proc);
+   if (piter == fTraceProcesses.end()) {
+      process = fTraceProcesses.size() + 1;
+      fTraceProcesses[proc] = process;
+      if (proc == kUserLimit || proc == kOutOfWorld || proc == kInitStep)
+         TraceName(kProcessName, process, (const char*)proc);
+      else
+         TraceName(kProcessName, process,
+                   ((const G4VProcess*)proc)->GetProcessName());
+   }
+   else {
+      process = piter->second;
+   }
+
+   const G4Event *event = G4EventManager::GetEventManager()
+                                         ->GetConstCurrentEvent();
+   trace_record_t rec;
+   rec.event = (event)? event->GetEventID() : 0;
+   rec.track = fTrack->GetTrackID();
+   rec.step = fTrack->GetCurrentStepNumber();
+   rec.copyno = copyno;
+   rec.volume = volume;
+   rec.process = process;
+   rec.x = fTrack->GetPosition().x();
+   rec.y = fTrack->GetPosition().y();
+   rec.z = fTrack->GetPosition().z();
+   rec.Ekin = fTrack->GetKineticEnergy();
+   rec.dE = fStep->GetTotalEnergyDeposit();
+   rec.ds = fStep->GetStepLength();
+   rec.s = fTrack->GetTrackLength();
+   fTraceBuffer.push_back(rec);
+   if (fTraceBuffer.size() >= kTraceBuffer)
+      FlushTrace();
+}
+
+void GlueXSteppingVerbose::TraceName(int kind, int id,
+                                     const std::string &name)
+{
+   // Name records go through the same buffer as the steps, so that each
+   // one comes ahead of the first step that refers to it.
+
+   name_record_t rec;
+   memset(&rec, 0, sizeof(rec));
+   rec.kind = kind;
+   rec.id = id;
+   strncpy(rec.name, name.c_str(), sizeof(rec.name) - 1);
+   trace_record_t step;
+   memcpy(&step, &rec, sizeof(step));
+   fTraceBuffer.push_back(step);
+}
+
+void GlueXSteppingVerbose::FlushThread(bool sync)
+{
+   if (fTraceFile.size() == 0)
+      return;
+   GlueXSteppingVerbose *verbose = dynamic_cast<GlueXSteppingVerbose*>
+                                   (G4VSteppingVerbose::GetInstance());
+   if (verbose && verbose->fTrace) {
+      verbose->FlushTrace();
+      if (sync)
+         verbose->fTrace->flush();
+   }
+}
+
+void GlueXSteppingVerbose::FlushTrace()
+{
+   if (fTrace && fTraceBuffer.size() > 0) {
+      fTrace->write((const char*)&fTraceBuffer[0],
+                    fTraceBuffer.size() * sizeof(trace_record_t));
+      fTraceBuffer.clear();
+   }
+}
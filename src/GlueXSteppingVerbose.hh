@@ -9,6 +9,18 @@
 // Separate object instances are created for each worker thread.
 // However its output actions need to be serialized, so it keeps
 // its own set of interlocks for this purpose.
+//
+// With the STEPTRACE card in control.in, the steps are written instead
+// as fixed-size binary records to a trace file of each thread, named
+// after the file given on the card the same way as the output shards,
+// with no formatting and no locking, so that a tracking log can be kept
+// of long runs without slowing them down. Each record holds the event,
+// track and step numbers, the position, kinetic energy, energy deposit,
+// step and track length in Geant4 units, and the copy number and ids of
+// the volume and the process that limited the step. The ids refer to
+// name records that are written to the file as each new volume or
+// process is first met, so the file can be read without the geometry.
+// The layout is described in test/trackdiff.py, which reads it.
 
 class GlueXSteppingVerbose;
 
@@ -16,16 +28,67 @@ class GlueXSteppingVerbose;
 #define GlueXSteppingVerbose_h 1
 
 #include "G4SteppingVerbose.hh"
+#include "G4VPhysicalVolume.hh"
 #include "G4Threading.hh"
 #include "G4AutoLock.hh"
 
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+
 class GlueXSteppingVerbose : public G4SteppingVerbose 
 {
  public:
+   GlueXSteppingVerbose();
+   ~GlueXSteppingVerbose();
+
    void StepInfo();
    void TrackingStarted();
 
+   // Hand the step records buffered by the calling thread to its trace
+   // file, at the end of every event, and with sync also write them out
+   // to disk, at the end of each run and before a fork mode worker
+   // leaves with _exit, which does not run the destructor.
+   static void FlushThread(bool sync);
+
+   // All records are 48 bytes, the first word telling them apart.
+   enum {
+      kTraceVersion = 1,
+      kTraceBuffer = 4096,       // records written at a time
+      kVolumeName = -1,
+      kProcessName = -2,
+      kFileHeader = -3
+   };
+   struct trace_record_t {
+      int event;                 // >= 0 for a step, else a record kind
+      int track;
+      int step;
+      int copyno;
+      unsigned short volume;
+      unsigned short process;
+      float x, y, z;             // mm
+      float Ekin, dE;            // MeV
+      float ds, s;               // mm
+   };
+   struct name_record_t {
+      int kind;
+      int id;
+      char name[40];
+   };
+
  private:
+   void TraceStep(G4VPhysicalVolume *pvol, const void *proc);
+   void TraceName(int kind, int id, const std::string &name);
+   void FlushTrace();
+
+   std::ofstream *fTrace;
+   std::vector<trace_record_t> fTraceBuffer;
+   std::map<const G4VPhysicalVolume*, int> fTraceVolumes;
+   std::map<const void*, int> fTraceProcesses;  // G4VProcess or name
+
+   static std::string fTraceFile;
+   static bool fTraceChecked;
    static G4Mutex fMutex;
 };
 
@@ -0,0 +1,243 @@
+//
+// GlueXStrawRing - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXStrawRing.hh"
+
+#include "G4Tubs.hh"
+#include "G4Hype.hh"
+#include "G4PVPlacement.hh"
+#include "G4VisAttributes.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <math.h>
+#include <sstream>
+#include <algorithm>
+
+// straw positions and orientations must repeat to within these limits
+const double kPositionTolerance = 1e-6*mm;
+const double kRotationTolerance = 1e-9;
+
+// clearance between the envelope of a ring and the straws inside it
+const double kEnvelopeClearance = 1e-3*mm;
+
+GlueXStrawRingParameterisation::GlueXStrawRingParameterisation(
+                                int nstraws, double dphi,
+                                const G4ThreeVector &translation,
+                                const G4RotationMatrix &rotation)
+ : fTranslations(nstraws),
+   fRotations(nstraws)
+{
+   // The straw with index n is the first one, placed at translation
+   // with object rotation rotation, turned by n*dphi about the z axis.
+
+   for (int n=0; n < nstraws; ++n) {
+      G4RotationMatrix turn;
+      turn.rotateZ(n * dphi);
+      fTranslations[n] = turn * translation;
+      fRotations[n] = (turn * rotation).inverse();
+   }
+}
+
+void GlueXStrawRingParameterisation::ComputeTransformation(const G4int index,
+                                               G4VPhysicalVolume *pvol) const
+{
+   pvol->SetTranslation(fTranslations[index]);
+   pvol->SetRotation(const_cast<G4RotationMatrix*>(&fRotations[index]));
+}
+
+GlueXStrawRing::GlueXStrawRing(const G4String &name, G4LogicalVolume *straw,
+                               G4LogicalVolume *envelope, int firstCopy,
+                               GlueXStrawRingParameterisation *param)
+ : G4PVParameterised(name, straw, envelope, kUndefined,
+                     param->GetNstraws(), param),
+   fFirstCopy(firstCopy),
+   fParam(param)
+{
+   SetCopyNo(0);
+}
+
+GlueXStrawRing::~GlueXStrawRing()
+{
+   delete fParam;
+}
+
+void GlueXStrawRing::SetCopyNo(G4int index)
+{
+   G4PVParameterised::SetCopyNo(index + fFirstCopy);
+}
+
+static bool earlier_copy(G4VPhysicalVolume *a, G4VPhysicalVolume *b)
+{
+   return a->GetCopyNo() < b->GetCopyNo();
+}
+
+int GlueXStrawRing::Convert(G4LogicalVolume *mother, int minstraws,
+                            std::map<G4VPhysicalVolume*,
+                                     G4VPhysicalVolume*> &replaced)
+{
+   // Look through the daughters of mother for runs of placements of the
+   // same full-phi tube volume at the same radius and z, with consecutive
+   // copy numbers, and convert those with at least minstraws straws into
+   // rings. Every placement that is replaced is entered in replaced,
+   // together with the ring that replaces it. Returns the number of
+   // rings that were made.
+
+   std::map<G4LogicalVolume*, std::vector<G4VPhysicalVolume*> > tubes;
+   for (int child = 0; child < (int)mother->GetNoDaughters(); ++child) {
+      G4VPhysicalVolume *pvol = mother->GetDaughter(child);
+      if (pvol->IsReplicated())
+         return 0;
+      G4Tubs *tube = dynamic_cast<G4Tubs*>(pvol->GetLogicalVolume()
+                                                ->GetSolid());
+      if (tube && tube->GetDeltaPhiAngle() > 2*M_PI - kRotationTolerance)
+         tubes[pvol->GetLogicalVolume()].push_back(pvol);
+   }
+
+   int rings = 0;
+   std::map<G4LogicalVolume*, std::vector<G4VPhysicalVolume*> >::iterator
+       iter;
+   for (iter = tubes.begin(); iter != tubes.end(); ++iter) {
+      std::vector<G4VPhysicalVolume*> &placed = iter->second;
+      if ((int)placed.size() < minstraws)
+         continue;
+      std::sort(placed.begin(), placed.end(), earlier_copy);
+      unsigned int first = 0;
+      while (first < placed.size()) {
+         G4ThreeVector pos0 = placed[first]->GetTranslation();
+         unsigned int last = first + 1;
+         while (last < placed.size() &&
+                placed[last]->GetCopyNo() ==
+                placed[last - 1]->GetCopyNo() + 1 &&
+                fabs(placed[last]->GetTranslation().perp() - pos0.perp())
+                < kPositionTolerance &&
+                fabs(placed[last]->GetTranslation().z() - pos0.z())
+                < kPositionTolerance)
+         {
+            ++last;
+         }
+         if ((int)(last - first) >= minstraws) {
+            std::vector<G4VPhysicalVolume*> straws(placed.begin() + first,
+                                                   placed.begin() + last);
+            rings += ConvertRing(mother, straws, replaced);
+         }
+         first = last;
+      }
+   }
+   return rings;
+}
+
+bool GlueXStrawRing::ConvertRing(G4LogicalVolume *mother,
+                                 std::vector<G4VPhysicalVolume*> &straws,
+                                 std::map<G4VPhysicalVolume*,
+                                          G4VPhysicalVolume*> &replaced)
+{
+   // Check that the straws are the first one rotated by equal steps
+   // in phi about the z axis, with its axis tilted, if at all, only
+   // in the direction of phi, and replace them with a ring inside an
+   // envelope that holds nothing else.
+
+   int nstraws = straws.size();
+   if (nstraws < 2)
+      return false;
+   G4ThreeVector pos0 = straws[0]->GetTranslation();
+   G4RotationMatrix rot0 = straws[0]->GetObjectRotationValue();
+   double dphi = straws[1]->GetTranslation().phi() - pos0.phi();
+   dphi -= 2*M_PI * floor(dphi / (2*M_PI) + 0.5);
+   if (pos0.perp() < kPositionTolerance || fabs(dphi) * nstraws > 2*M_PI +
+       kRotationTolerance)
+   {
+      return false;
+   }
+   for (int n=1; n < nstraws; ++n) {
+      G4RotationMatrix turn;
+      turn.rotateZ(n * dphi);
+      if ((straws[n]->GetTranslation() - turn * pos0).mag()
+          > kPositionTolerance ||
+          ! straws[n]->GetObjectRotationValue().isNear(turn * rot0,
+                                                       kRotationTolerance))
+      {
+         return false;
+      }
+   }
+   G4ThreeVector axis = rot0 * G4ThreeVector(0, 0, 1);
+   G4ThreeVector radial(pos0.x(), pos0.y(), 0);
+   if (fabs(axis.dot(radial.unit())) > kRotationTolerance)
+      return false;
+
+   // The straw axis is a line at distance r0 from the z axis at its
+   // centre, reaching rho(z) = sqrt(r0^2 + (z tan(stereo))^2) at height
+   // z about the centre, and the straw occupies radii rho(z) +/- a at
+   // height z, where a is its outer radius. The surfaces of the G4Hype
+   // envelope are lines in (z^2, r^2) that are tangent to (rho -/+ a)^2
+   // at half of the maximum z^2, which lie below (rho - a)^2 and above
+   // (rho + a)^2 everywhere, since one is convex and the other concave.
+
+   G4Tubs *tube = (G4Tubs*)straws[0]->GetLogicalVolume()->GetSolid();
+   double a = tube->GetOuterRadius();
+   double r0 = pos0.perp();
+   double cosa = fabs(axis.z());
+   double sina = sqrt(1 - cosa * cosa);
+   double tan2 = (sina * sina) / (cosa * cosa);
+   double halfz = tube->GetZHalfLength() * cosa + a * sina
+                  + kEnvelopeClearance;
+   double ustar = halfz * halfz / 2;
+   double rhostar = sqrt(r0 * r0 + tan2 * ustar);
+   double slope_in = tan2 * (1 - a / rhostar);
+   double slope_out = tan2 * (1 + a / rhostar);
+   double waist2_in = pow(rhostar - a, 2) - slope_in * ustar;
+   double waist2_out = pow(rhostar + a, 2) - slope_out * ustar;
+   if (waist2_in <= 0 || slope_in < 0)
+      return false;
+   double rin = sqrt(waist2_in) - kEnvelopeClearance;
+   double rout = sqrt(waist2_out) + kEnvelopeClearance;
+   if (rin <= 0)
+      return false;
+
+   // Take the straws out of the mother and put the envelope in, then
+   // put them back if the envelope would overlap anything else there.
+
+   for (int n=0; n < nstraws; ++n)
+      mother->RemoveDaughter(straws[n]);
+   std::stringstream name;
+   name << straws[0]->GetLogicalVolume()->GetName() << "_ring"
+        << straws[0]->GetCopyNo();
+   G4Hype *hype = new G4Hype(name.str(), rin, rout,
+                             atan(sqrt(slope_in)), atan(sqrt(slope_out)),
+                             halfz);
+   G4LogicalVolume *envelope = new G4LogicalVolume(hype,
+                                               mother->GetMaterial(),
+                                               name.str(),
+                                               mother->GetFieldManager());
+   envelope->SetVisAttributes(new G4VisAttributes(false));
+   G4ThreeVector centre(0, 0, pos0.z());
+   G4PVPlacement *wrapper = new G4PVPlacement(0, centre, envelope,
+                                              name.str(), mother, 0, 0);
+   if (wrapper->CheckOverlaps(1000, 0, false)) {
+      mother->RemoveDaughter(wrapper);
+      delete wrapper;
+      delete envelope->GetVisAttributes();
+      delete envelope;
+      delete hype;
+      for (int n=0; n < nstraws; ++n)
+         mother->AddDaughter(straws[n]);
+      return false;
+   }
+
+   GlueXStrawRingParameterisation *param;
+   param = new GlueXStrawRingParameterisation(nstraws, dphi,
+                                              pos0 - centre, rot0);
+   GlueXStrawRing *ring = new GlueXStrawRing(straws[0]->GetName(),
+                                             straws[0]->GetLogicalVolume(),
+                                             envelope,
+                                             straws[0]->GetCopyNo(),
+                                             param);
+   for (int n=0; n < nstraws; ++n) {
+      replaced[straws[n]] = ring;
+      delete straws[n];
+   }
+   return true;
+}
@@ -0,0 +1,118 @@
+//
+// GlueXStrawRing - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// This class is an optional representation of a ring of identical
+// straw tubes, such as the rings of the CDC, that replaces the many
+// individual placements made by HddsG4Builder with a single volume
+// parameterised by the position of the straw around the ring. Each
+// ring is wrapped in a thin hyperbolic envelope that just contains
+// its straws, so that the navigator only ever looks at the straws of
+// one ring at a time, and the position and orientation of each straw
+// is computed from its index in the ring, since all of the straws in
+// a ring are copies of the first one rotated about the z axis.
+//
+// The copy numbers of the straws are those of the placements that
+// they replace, so identifiers like ring and sector that HDDS attaches
+// to the straws by copy number are unchanged, and GetCopyNo() returns
+// the same thing as before. The replica number recorded in touchables
+// is the index of the straw in the ring, counting from zero, so code
+// looking at a touchable should call GetCopyNumber(touch, depth) to
+// convert between them.
+//
+// Rings are converted with the static Convert method, which looks for
+// runs of at least a given number of placements of the same tube volume
+// inside of a mother, with consecutive copy numbers, that are the same
+// rotation of each other about the z axis, and converts those whose
+// envelope does not overlap any of the other volumes in the mother.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. The copy
+// number kept by the underlying G4PVParameterised is thread-local.
+
+#ifndef GlueXStrawRing_h
+#define GlueXStrawRing_h 1
+
+#include "G4PVParameterised.hh"
+#include "G4VPVParameterisation.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VTouchable.hh"
+#include "G4RotationMatrix.hh"
+#include "G4ThreeVector.hh"
+
+#include <vector>
+#include <map>
+
+class GlueXStrawRingParameterisation : public G4VPVParameterisation
+{
+ public:
+   GlueXStrawRingParameterisation(int nstraws, double dphi,
+                                  const G4ThreeVector &translation,
+                                  const G4RotationMatrix &rotation);
+
+   virtual void ComputeTransformation(const G4int index,
+                                      G4VPhysicalVolume *pvol) const;
+
+   int GetNstraws() const {
+      return fTranslations.size();
+   }
+
+ private:
+   std::vector<G4ThreeVector> fTranslations;  // by index in the ring
+   std::vector<G4RotationMatrix> fRotations;  // frame rotation, by index
+};
+
+class GlueXStrawRing : public G4PVParameterised
+{
+ public:
+   GlueXStrawRing(const G4String &name, G4LogicalVolume *straw,
+                  G4LogicalVolume *envelope, int firstCopy,
+                  GlueXStrawRingParameterisation *param);
+   virtual ~GlueXStrawRing();
+
+   virtual void SetCopyNo(G4int index);
+
+   int GetFirstCopy() const {
+      return fFirstCopy;
+   }
+
+   static int GetCopyNumber(const G4VTouchable *touch, int depth);
+
+   static int Convert(G4LogicalVolume *mother, int minstraws,
+                      std::map<G4VPhysicalVolume*,
+                               G4VPhysicalVolume*> &replaced);
+
+ private:
+   GlueXStrawRing(const GlueXStrawRing &src);
+   GlueXStrawRing &operator=(const GlueXStrawRing &src);
+
+   static bool ConvertRing(G4LogicalVolume *mother,
+                           std::vector<G4VPhysicalVolume*> &straws,
+                           std::map<G4VPhysicalVolume*,
+                                    G4VPhysicalVolume*> &replaced);
+
+   int fFirstCopy;
+   GlueXStrawRingParameterisation *fParam;
+};
+
+inline int GlueXStrawRing::GetCopyNumber(const G4VTouchable *touch,
+                                         int depth)
+{
+   // Return the copy number of the volume at the given depth in the
+   // touchable, as it was placed by HddsG4Builder. For replicated
+   // volumes this comes from the replica number kept in the touchable,
+   // since the copy number of the physical volume itself follows the
+   // navigator, which may have moved on since the touchable was made.
+
+   G4VPhysicalVolume *pvol = touch->GetVolume(depth);
+   if (! pvol->IsReplicated())
+      return pvol->GetCopyNo();
+   GlueXStrawRing *ring = dynamic_cast<GlueXStrawRing*>(pvol);
+   if (ring)
+      return touch->GetReplicaNumber(depth) + ring->fFirstCopy;
+   return touch->GetReplicaNumber(depth);
+}
+
+#endif
@@ -0,0 +1,361 @@
+//
+// GlueXSubEvents - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXSubEvents.hh"
+#include "GlueXSensitiveDetector.hh"
+#include "GlueXUserEventInformation.hh"
+
+#include "G4PrimaryVertex.hh"
+#include "G4SDManager.hh"
+#include "G4RunManager.hh"
+#include "G4Run.hh"
+#include "G4AutoLock.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+
+int GlueXSubEvents::fBundles = 0;
+int GlueXSubEvents::fMinVertices = 0;
+int GlueXSubEvents::fRunID = -1;
+int GlueXSubEvents::fSlots = 0;
+int GlueXSubEvents::fTotalSlots = 0;
+std::deque<GlueXSubEvents::bundle_t> GlueXSubEvents::fPending;
+std::map<long int, GlueXSubEvents::merge_t> GlueXSubEvents::fMerges;
+G4ThreadLocal int GlueXSubEvents::fMaxTrackID = 0;
+G4Mutex GlueXSubEvents::fMutex = G4MUTEX_INITIALIZER;
+
+std::atomic<long> GlueXSubEvents::fEventsSplit(0);
+std::atomic<long> GlueXSubEvents::fEventsWhole(0);
+std::atomic<long> GlueXSubEvents::fBundlesTracked(0);
+
+void GlueXSubEvents::Configure(int nbundles, int minvertices)
+{
+   // Called once from the master thread before the run starts.
+
+   fBundles = nbundles;
+   fMinVertices = (minvertices > 0)? minvertices : 2 * nbundles;
+   if (fBundles > 1) {
+      G4cout << "GlueXSubEvents: events with at least " << fMinVertices
+             << " primary vertices are tracked in " << fBundles
+             << " bundles" << G4endl;
+   }
+}
+
+bool GlueXSubEvents::Next(G4Event *anEvent)
+{
+   // Every call takes an event slot of the run, counted here so that
+   // Split() knows how many of them are left for new bundles.
+
+   bundle_t bundle;
+   {
+      G4AutoLock barrier(&fMutex);
+      const G4Run *run = G4RunManager::GetRunManager()->GetCurrentRun();
+      if (run && run->GetRunID() != fRunID) {
+         fRunID = run->GetRunID();
+         fTotalSlots = run->GetNumberOfEventToBeProcessed();
+         fSlots = 0;
+      }
+      ++fSlots;
+      if (fPending.size() == 0)
+         return false;
+      bundle_t &front = fPending.front();
+      bundle.parent = front.parent;
+      bundle.index = front.index;
+      bundle.count = front.count;
+      bundle.eventID = front.eventID;
+      bundle.seeds[0] = front.seeds[0];
+      bundle.seeds[1] = front.seeds[1];
+      bundle.vertices.swap(front.vertices);
+      fPending.pop_front();
+   }
+
+   fMaxTrackID = 0;
+   G4Random::setTheSeeds(bundle.seeds);
+   G4cout << "New bundle " << bundle.index << " of " << bundle.count
+          << " of event " << bundle.eventID << " with starting seeds "
+          << bundle.seeds[0] << ", " << bundle.seeds[1] << G4endl;
+   anEvent->SetEventID(bundle.eventID);
+   Fill(anEvent, bundle.vertices, 0, bundle.vertices.size());
+   anEvent->SetUserInformation(new GlueXUserEventInformation(bundle.parent,
+                                                             bundle.index,
+                                                             bundle.count));
+   ++fBundlesTracked;
+   return true;
+}
+
+void GlueXSubEvents::Split(G4Event *scratch, G4Event *anEvent)
+{
+   // The primaries of a G4Event cannot be taken out of it again, so the
+   // event is generated in scratch, and its vertices are copied over to
+   // anEvent, or to the bundles queued for later, as it is divided up.
+
+   anEvent->SetEventID(scratch->GetEventID());
+   if (scratch->IsAborted())
+      anEvent->SetEventAborted();
+   GlueXUserEventInformation *info = (GlueXUserEventInformation*)
+                                     scratch->GetUserInformation();
+   scratch->SetUserInformation(0);
+   anEvent->SetUserInformation(info);
+   fMaxTrackID = 0;
+
+   std::vector<vertex_t> vertices;
+   bool simple = Extract(scratch, vertices);
+   int nvertices = vertices.size();
+   int nbundles = std::min(fBundles, nvertices);
+   if (info == 0 || scratch->IsAborted() || info->getSerialNumber() < 0) {
+      Fill(anEvent, vertices, 0, nvertices);
+      return;
+   }
+   else if (! simple || nvertices < fMinVertices || nbundles < 2) {
+      Fill(anEvent, vertices, 0, nvertices);
+      ++fEventsWhole;
+      return;
+   }
+
+   long int start[2] = {0, info->getSerialNumber()};
+   hddm_s::ReactionList rea = info->getOutputRecord()->getReactions();
+   if (rea.size() > 0) {
+      hddm_s::RandomList rnd = rea(0).getRandoms();
+      if (rnd.size() > 0) {
+         start[0] = rnd(0).getSeed1();
+         start[1] = rnd(0).getSeed2();
+      }
+   }
+
+   std::vector<unsigned int> first(nbundles + 1);
+   for (int k=0; k <= nbundles; ++k)
+      first[k] = (long int)k * nvertices / nbundles;
+   {
+      G4AutoLock barrier(&fMutex);
+      if (fSlots + (int)fPending.size() + nbundles - 1 > fTotalSlots)
+         nbundles = 1;
+      else {
+         long int parent = info->getSerialNumber();
+         merge_t &merge = fMerges[parent];
+         merge.left = nbundles;
+         merge.keep = false;
+         merge.record = 0;
+         merge.primaries.assign(nbundles, 0);
+         merge.maxTrackID.assign(nbundles, 0);
+         for (int k=0; k < nbundles; ++k) {
+            for (unsigned int i=first[k]; i < first[k + 1]; ++i)
+               merge.primaries[k] += vertices[i].particles.size();
+            if (k == 0)
+               continue;
+            fPending.push_back(bundle_t());
+            bundle_t &bundle = fPending.back();
+            bundle.parent = parent;
+            bundle.index = k;
+            bundle.count = nbundles;
+            bundle.eventID = scratch->GetEventID();
+            GlueXUserEventInformation::GetSubEventSeeds(start, k,
+                                                        bundle.seeds);
+            bundle.vertices.assign(vertices.begin() + first[k],
+                                   vertices.begin() + first[k + 1]);
+         }
+      }
+   }
+   if (nbundles == 1) {
+      Fill(anEvent, vertices, 0, nvertices);
+      ++fEventsWhole;
+      return;
+   }
+   info->setSubEvent(0, nbundles);
+   Fill(anEvent, vertices, 0, first[1]);
+   ++fEventsSplit;
+}
+
+bool GlueXSubEvents::Extract(G4Event *event, std::vector<vertex_t> &vertices)
+{
+   // Returns false if any of the primaries has daughters, whose track
+   // ids would not follow the simple numbering assumed for the bundles.
+
+   bool simple = true;
+   G4PrimaryVertex *vtx;
+   for (vtx = event->GetPrimaryVertex(); vtx != 0; vtx = vtx->GetNext()) {
+      vertices.push_back(vertex_t());
+      vertex_t &vertex = vertices.back();
+      vertex.pos = vtx->GetPosition();
+      vertex.t0 = vtx->GetT0();
+      vertex.weight = vtx->GetWeight();
+      G4PrimaryParticle *primary;
+      for (primary = vtx->GetPrimary(); primary != 0;
+           primary = primary->GetNext())
+      {
+         vertex.particles.push_back(particle_t());
+         simple &= Extract(primary, vertex.particles.back());
+      }
+   }
+   return simple;
+}
+
+bool GlueXSubEvents::Extract(G4PrimaryParticle *primary,
+                             particle_t &particle)
+{
+   particle.def = primary->GetParticleDefinition();
+   particle.mom = primary->GetMomentum();
+   particle.pol = primary->GetPolarization();
+   particle.mass = primary->GetMass();
+   particle.charge = primary->GetCharge();
+   particle.weight = primary->GetWeight();
+   particle.properTime = primary->GetProperTime();
+   G4PrimaryParticle *daughter;
+   for (daughter = primary->GetDaughter(); daughter != 0;
+        daughter = daughter->GetNext())
+   {
+      particle.daughters.push_back(particle_t());
+      Extract(daughter, particle.daughters.back());
+   }
+   return (particle.daughters.size() == 0);
+}
+
+void GlueXSubEvents::Fill(G4Event *event,
+                          const std::vector<vertex_t> &vertices,
+                          unsigned int first, unsigned int last)
+{
+   for (unsigned int i=first; i < last; ++i) {
+      const vertex_t &vertex = vertices[i];
+      G4PrimaryVertex *vtx = new G4PrimaryVertex(vertex.pos, vertex.t0);
+      vtx->SetWeight(vertex.weight);
+      for (unsigned int n=0; n < vertex.particles.size(); ++n)
+         vtx->SetPrimary(NewParticle(vertex.particles[n]));
+      event->AddPrimaryVertex(vtx);
+   }
+}
+
+G4PrimaryParticle *GlueXSubEvents::NewParticle(const particle_t &particle)
+{
+   // The mass goes in first, so that SetMomentum gets the kinetic energy
+   // right for particles generated off their mass shell.
+
+   G4PrimaryParticle *primary = new G4PrimaryParticle(particle.def);
+   primary->SetMass(particle.mass);
+   primary->SetCharge(particle.charge);
+   primary->SetMomentum(particle.mom.x(), particle.mom.y(), particle.mom.z());
+   primary->SetPolarization(particle.pol);
+   primary->SetWeight(particle.weight);
+   primary->SetProperTime(particle.properTime);
+   for (unsigned int n=0; n < particle.daughters.size(); ++n)
+      primary->SetDaughter(NewParticle(particle.daughters[n]));
+   return primary;
+}
+
+void GlueXSubEvents::SaveHits(GlueXUserEventInformation *info,
+                              const std::string &sdname, hits_t *hits)
+{
+   G4AutoLock barrier(&fMutex);
+   std::map<long int, merge_t>::iterator iter;
+   iter = fMerges.find(info->getSerialNumber());
+   if (iter == fMerges.end()) {
+      delete hits;
+      return;
+   }
+   std::vector<hits_t*> &parts = iter->second.hits[sdname];
+   parts.resize(info->getSubEvents(), 0);
+   delete parts[info->getSubEvent()];
+   parts[info->getSubEvent()] = hits;
+}
+
+void GlueXSubEvents::EndOfSubEvent(GlueXUserEventInformation *info)
+{
+   // The last bundle of the event to finish does the merge, without
+   // holding the lock, once the event has been taken out of the table.
+
+   bool keep = info->getKeepEvent();
+   int index = info->getSubEvent();
+   merge_t merge;
+   {
+      G4AutoLock barrier(&fMutex);
+      std::map<long int, merge_t>::iterator iter;
+      iter = fMerges.find(info->getSerialNumber());
+      if (iter == fMerges.end())
+         return;
+      merge_t &pending = iter->second;
+      pending.keep = pending.keep || keep;
+      pending.maxTrackID[index] = fMaxTrackID;
+      if (index == 0)
+         pending.record = info->takeOutputRecord();
+      if (--pending.left > 0)
+         return;
+      merge.keep = pending.keep;
+      merge.record = pending.record;
+      merge.primaries.swap(pending.primaries);
+      merge.maxTrackID.swap(pending.maxTrackID);
+      merge.hits.swap(pending.hits);
+      fMerges.erase(iter);
+   }
+   Merge(merge, info);
+}
+
+void GlueXSubEvents::Merge(merge_t &merge, GlueXUserEventInformation *info)
+{
+   // The primaries keep the ids they would have in the whole event, and
+   // the secondaries of each bundle are numbered on from the last id used
+   // by the bundles before it, starting after all of the primaries.
+
+   int nbundles = merge.primaries.size();
+   std::vector<int> primaryOffset(nbundles);
+   std::vector<int> secondaryOffset(nbundles);
+   int primaries = 0;
+   for (int k=0; k < nbundles; ++k)
+      primaries += merge.primaries[k];
+   int nprimary = 0;
+   int nsecondary = primaries;
+   for (int k=0; k < nbundles; ++k) {
+      primaryOffset[k] = nprimary;
+      secondaryOffset[k] = nsecondary - merge.primaries[k];
+      nprimary += merge.primaries[k];
+      nsecondary += std::max(merge.maxTrackID[k], merge.primaries[k]) -
+                    merge.primaries[k];
+   }
+
+   hddm_s::HDDM *record = merge.record;
+   std::map<std::string, std::vector<hits_t*> >::iterator iter;
+   for (iter = merge.hits.begin(); iter != merge.hits.end(); ++iter) {
+      std::vector<hits_t*> &parts = iter->second;
+      if (record == 0 || ! merge.keep)
+         continue;
+      for (unsigned int k=0; k < parts.size(); ++k) {
+         if (parts[k] == 0)
+            continue;
+         parts[k]->fPrimaries = merge.primaries[k];
+         parts[k]->fPrimaryOffset = primaryOffset[k];
+         parts[k]->fSecondaryOffset = secondaryOffset[k];
+      }
+      G4VSensitiveDetector *sd = G4SDManager::GetSDMpointer()
+                                 ->FindSensitiveDetector(iter->first, false);
+      GlueXSensitiveDetectorBase *gluexsd;
+      gluexsd = dynamic_cast<GlueXSensitiveDetectorBase*>(sd);
+      if (gluexsd == 0) {
+         G4cerr << "GlueXSubEvents::Merge warning - "
+                << "no sensitive detector " << iter->first
+                << " on this thread to merge its hits, "
+                << "continuing without them." << G4endl;
+         continue;
+      }
+      if (record->getPhysicsEvents().size() == 0)
+         record->addPhysicsEvents();
+      if (record->getHitViews().size() == 0)
+         record->getPhysicsEvent().addHitViews();
+      gluexsd->PackSubEvents(parts, record->getPhysicsEvent().getHitView());
+   }
+   for (iter = merge.hits.begin(); iter != merge.hits.end(); ++iter) {
+      for (unsigned int k=0; k < iter->second.size(); ++k)
+         delete iter->second[k];
+   }
+   info->adoptOutputRecord(record, merge.keep);
+}
+
+void GlueXSubEvents::PrintStatistics()
+{
+   long nevents = fEventsSplit + fEventsWhole;
+   if (nevents == 0)
+      return;
+   G4cout << "GlueXSubEvents: " << fEventsSplit << " of " << nevents
+          << " events split into bundles, " << fBundlesTracked
+          << " bundles tracked apart from their events" << G4endl;
+}
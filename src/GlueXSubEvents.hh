@@ -0,0 +1,186 @@
+//
+// GlueXSubEvents - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Splits events with many primary vertices, such as those with heavy
+// BGRATE pile-up, into bundles of vertices that are tracked as separate
+// events, so that one large event can be spread over several worker
+// threads instead of holding up the end of the run on one of them. It is
+// requested by the SUBEVENTS card in control.in:
+//
+//    SUBEVENTS nbundles minvertices
+//
+// which divides every event with at least minvertices (default 2*nbundles)
+// primary vertices into nbundles bundles of consecutive vertices, the
+// first of them holding the vertex of the physics event. Events with
+// primaries that have predefined daughters are not split.
+//
+// The first bundle is tracked in the event slot where the event was
+// generated, and the others are queued to be taken, ahead of any new
+// event, by the next calls to GeneratePrimaries on any thread. Each of
+// them takes one event slot of the /run/beamOn, so an event is only split
+// if there are enough slots left in the run for all of its bundles, and
+// is otherwise tracked whole. With the INFILE or the particle gun event
+// sources, beamOn should be given enough events beyond TRIG to leave room
+// for the extra bundles; the slots that are left over cost nothing. The
+// random engine for each bundle but the first is seeded from the starting
+// seeds of the event and the bundle number, see GetSubEventSeeds() in
+// GlueXUserEventInformation, so that with the EVENTSEEDS card the bundles,
+// and the event made from them, come out the same whatever thread tracks
+// them and whatever the number of threads.
+//
+// The sensitive detectors hand over the hits and truth points of each
+// bundle at the end of tracking, with SaveHits(). When the last bundle of
+// an event has been tracked, the thread that tracked it merges the hits
+// of all of them in bundle order, each detector combining the hits in one
+// readout element in the same way as it does for the hits from separate
+// tracks in an event, see PackSubEvents() in GlueXSensitiveDetector, and
+// packs them into the output record of the event, which is then written
+// with the serial number of the event. The tracks of each bundle are
+// renumbered in the merged event so that the primaries come out in the
+// same order as in the whole event, followed by their secondaries bundle
+// after bundle. The event filters look at each bundle in turn, and the
+// event is kept if any of its bundles pass them.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state apart from the
+// number of tracks made in the event being tracked by each thread. The
+// queue of bundles and the hits waiting to be merged are guarded by a
+// mutex.
+
+#ifndef GlueXSubEvents_h
+#define GlueXSubEvents_h 1
+
+#include "G4Event.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4Track.hh"
+#include "G4ThreeVector.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4Threading.hh"
+
+#include <HDDM/hddm_s.hpp>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <atomic>
+
+class GlueXUserEventInformation;
+
+class GlueXSubEvents
+{
+ public:
+   // Hits and truth points of one sensitive detector in one bundle, as
+   // saved by the detector, see GlueXSensitiveDetector. The numbering of
+   // the tracks in the merged event is filled in before they are merged.
+   class hits_t {
+    public:
+      hits_t() : fPrimaries(0), fPrimaryOffset(0), fSecondaryOffset(0) {}
+      virtual ~hits_t() {}
+
+      // Geant4 track id in the merged event of track id in the bundle
+      int RenumberTrack(int id) const {
+         return (id <= fPrimaries)? id + fPrimaryOffset
+                                  : id + fSecondaryOffset;
+      }
+      // GlueX track id, ie. the id of the primary, in the merged event
+      int RenumberGlueXTrack(int id) const {
+         return (id > 0)? id + fPrimaryOffset : id;
+      }
+
+      int fPrimaries;        // primaries in the bundle
+      int fPrimaryOffset;    // primaries in the bundles before it
+      int fSecondaryOffset;  // added to the ids of its secondaries
+   };
+
+   static void Configure(int nbundles, int minvertices);
+   static bool IsEnabled() {
+      return fBundles > 1;
+   }
+
+   // Called at the start of GeneratePrimaries, to fill anEvent with the
+   // next bundle in the queue, if there is one, returning false when the
+   // queue is empty and a new event is to be generated.
+   static bool Next(G4Event *anEvent);
+
+   // Called after a new event has been generated in scratch, to fill
+   // anEvent with its vertices, or with those of its first bundle if it
+   // is split, queueing the others.
+   static void Split(G4Event *scratch, G4Event *anEvent);
+
+   // Called by the sensitive detectors at the end of tracking a bundle,
+   // which takes over hits, and by GlueXEventAction after them.
+   static void SaveHits(GlueXUserEventInformation *info,
+                        const std::string &sdname, hits_t *hits);
+   static void EndOfSubEvent(GlueXUserEventInformation *info);
+
+   // Called by GlueXTrackingAction as each track starts.
+   static void NoteTrack(const G4Track *track) {
+      if (fBundles > 1 && track->GetTrackID() > fMaxTrackID)
+         fMaxTrackID = track->GetTrackID();
+   }
+
+   static void PrintStatistics();
+
+ private:
+   GlueXSubEvents() {}
+
+   struct particle_t {
+      const G4ParticleDefinition *def;
+      G4ThreeVector mom;
+      G4ThreeVector pol;
+      double mass;
+      double charge;
+      double weight;
+      double properTime;
+      std::vector<particle_t> daughters;
+   };
+   struct vertex_t {
+      G4ThreeVector pos;
+      double t0;
+      double weight;
+      std::vector<particle_t> particles;
+   };
+   struct bundle_t {
+      long int parent;       // serial number of the event
+      int index;             // bundle number, from 0
+      int count;             // number of bundles in the event
+      int eventID;
+      long int seeds[2];
+      std::vector<vertex_t> vertices;
+   };
+   struct merge_t {
+      int left;              // bundles still being tracked
+      bool keep;             // any of them passed the event filters
+      hddm_s::HDDM *record;  // output record of the event
+      std::vector<int> primaries;
+      std::vector<int> maxTrackID;
+      std::map<std::string, std::vector<hits_t*> > hits;
+   };
+
+   static bool Extract(G4Event *event, std::vector<vertex_t> &vertices);
+   static bool Extract(G4PrimaryParticle *primary, particle_t &particle);
+   static void Fill(G4Event *event, const std::vector<vertex_t> &vertices,
+                    unsigned int first, unsigned int last);
+   static G4PrimaryParticle *NewParticle(const particle_t &particle);
+   static void Merge(merge_t &merge, GlueXUserEventInformation *info);
+
+   static int fBundles;                // bundles per split event
+   static int fMinVertices;            // vertices for an event to split
+   static int fRunID;                  // run whose slots are counted
+   static int fSlots;                  // event slots used in the run
+   static int fTotalSlots;             // event slots in the run
+   static std::deque<bundle_t> fPending;
+   static std::map<long int, merge_t> fMerges;
+   static G4ThreadLocal int fMaxTrackID;
+   static G4Mutex fMutex;
+
+   static std::atomic<long> fEventsSplit;
+   static std::atomic<long> fEventsWhole;
+   static std::atomic<long> fBundlesTracked;
+};
+
+#endif
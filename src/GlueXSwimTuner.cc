@@ -0,0 +1,239 @@
+//
+// GlueXSwimTuner class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXSwimTuner.hh"
+#include "GlueXMagneticField.hh"
+#include "GlueXUserOptions.hh"
+#include "HddsG4Builder.hh"
+
+#include "G4FieldManager.hh"
+#include "G4FieldTrack.hh"
+#include "G4ChargeState.hh"
+#include "G4ChordFinder.hh"
+#include "G4Mag_UsualEqRhs.hh"
+#include "G4MagIntegratorStepper.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Timer.hh"
+#include "Randomize.hh"
+
+#include <math.h>
+#include <iomanip>
+
+// candidate settings scanned for each field region
+
+static const char *stepper_names[] = {"ExactHelix", "HelixMixed",
+                                      "ClassicalRK4", "CashKarpRKF45"};
+static const double min_steps[] = {0.01, 0.1, 1.0};        // mm
+static const double delta_chords[] = {0.025, 0.25, 1.0};   // mm
+static const double delta_onesteps[] = {0.01, 0.1, 1.0};   // mm
+
+#define NELEM(array) (sizeof(array) / sizeof(array[0]))
+
+GlueXSwimTuner::GlueXSwimTuner(const HddsG4Builder *builder)
+ : fBuilder(builder),
+   fTracks(100),
+   fLength(1000 * mm),
+   fMaxStep(100 * mm),
+   fTolerance(0.1 * mm)
+{
+   // The benchmark parameters can be set with the SWIMBENCH card in
+   // control.in, giving the number of reference tracks, the length of
+   // each track (cm), the step length between geometry boundaries (cm)
+   // and the endpoint accuracy required (mm).
+
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   std::map<int, double> bench_opts;
+   if (user_opts && user_opts->Find("SWIMBENCH", bench_opts)) {
+      if (bench_opts.find(1) != bench_opts.end() && bench_opts[1] > 0)
+         fTracks = bench_opts[1];
+      if (bench_opts.find(2) != bench_opts.end() && bench_opts[2] > 0)
+         fLength = bench_opts[2] * cm;
+      if (bench_opts.find(3) != bench_opts.end() && bench_opts[3] > 0)
+         fMaxStep = bench_opts[3] * cm;
+      if (bench_opts.find(4) != bench_opts.end() && bench_opts[4] > 0)
+         fTolerance = bench_opts[4] * mm;
+   }
+}
+
+GlueXSwimTuner::~GlueXSwimTuner() { }
+
+void GlueXSwimTuner::Run()
+{
+   // Swim the reference tracks through every field region with each of
+   // the candidate settings, and print a table of results followed by
+   // the recommended SWIMTUNE card for the region. The deltaIntersection
+   // parameter only matters when a step crosses a volume boundary, which
+   // does not happen here, so it is recommended at the same ratio to
+   // deltaOneStep as in the Geant4 defaults.
+
+   if (fBuilder == 0) {
+      G4cerr << "GlueXSwimTuner::Run error - "
+             << "geometry has not been built, cannot continue."
+             << G4endl;
+      return;
+   }
+
+   const std::map<int, G4FieldManager*> fieldmgrs =
+                                        fBuilder->getFieldManagers();
+   std::map<int, G4FieldManager*>::const_iterator iter;
+   for (iter = fieldmgrs.begin(); iter != fieldmgrs.end(); ++iter) {
+      G4MagneticField *field = (G4MagneticField*)
+                               iter->second->GetDetectorField();
+      G4ThreeVector origin;
+      if (dynamic_cast<GlueXUniformMagField*>(field)) {
+         GlueXUniformMagField *fld = (GlueXUniformMagField*)field;
+         origin = fld->GetMagFieldTransform().NetTranslation();
+      }
+      else if (dynamic_cast<GlueXMappedMagField*>(field)) {
+         GlueXMappedMagField *fld = (GlueXMappedMagField*)field;
+         origin = fld->GetMagFieldTransform().NetTranslation();
+      }
+      else if (dynamic_cast<GlueXComputedMagField*>(field)) {
+         GlueXComputedMagField *fld = (GlueXComputedMagField*)field;
+         origin = fld->GetMagFieldTransform().NetTranslation();
+      }
+      else {
+         continue;
+      }
+      std::string region = fBuilder->getRegionName(iter->first);
+
+      // generate pions in random directions from the region origin,
+      // with momenta between 0.1 and 2 GeV/c
+
+      fTrack.clear();
+      for (int n=0; n < fTracks; ++n) {
+         swim_track_t track;
+         double costheta = 2 * G4UniformRand() - 1;
+         double phi = 2 * M_PI * G4UniformRand();
+         double sintheta = sqrt(1 - costheta * costheta);
+         track.pos = origin;
+         track.dir = G4ThreeVector(sintheta * cos(phi),
+                                   sintheta * sin(phi), costheta);
+         track.mom = (0.1 + 1.9 * G4UniformRand()) * GeV;
+         track.charge = (G4UniformRand() < 0.5)? -1 : +1;
+         fTrack.push_back(track);
+      }
+
+      std::vector<G4ThreeVector> refpoint;
+      swim_config_t refconfig = {"ClassicalRK4", 1e-4, 1e-4, 1e-6};
+      swim(field, refconfig, refpoint, 1);
+
+      G4cout << G4endl
+             << "GlueXSwimTuner: field region " << region
+             << ", " << fTracks << " tracks of " << fLength / cm
+             << " cm" << G4endl
+             << std::setw(16) << "stepper"
+             << std::setw(10) << "minStep"
+             << std::setw(12) << "deltaChord"
+             << std::setw(14) << "deltaOneStep"
+             << std::setw(14) << "time/track"
+             << std::setw(14) << "max.dev."
+             << G4endl;
+
+      swim_config_t best = refconfig;
+      double best_time = -1;
+      double best_dev = 0;
+      for (unsigned int is=0; is < NELEM(stepper_names); ++is) {
+         for (unsigned int im=0; im < NELEM(min_steps); ++im) {
+            for (unsigned int ic=0; ic < NELEM(delta_chords); ++ic) {
+               for (unsigned int io=0; io < NELEM(delta_onesteps); ++io) {
+                  swim_config_t config = {stepper_names[is],
+                                          min_steps[im],
+                                          delta_chords[ic],
+                                          delta_onesteps[io]};
+                  std::vector<G4ThreeVector> endpoint;
+                  double time = swim(field, config, endpoint);
+                  double maxdev = 0;
+                  for (int n=0; n < fTracks; ++n) {
+                     double dev = (endpoint[n] - refpoint[n]).mag();
+                     maxdev = (dev > maxdev)? dev : maxdev;
+                  }
+                  G4cout << std::setw(16) << config.stepper
+                         << std::setw(10) << config.minStep
+                         << std::setw(12) << config.deltaChord
+                         << std::setw(14) << config.deltaOneStep
+                         << std::setw(11) << time / fTracks * 1e3 << " ms"
+                         << std::setw(11) << maxdev / mm << " mm"
+                         << G4endl;
+                  if (maxdev < fTolerance &&
+                      (best_time < 0 || time < best_time))
+                  {
+                     best = config;
+                     best_time = time;
+                     best_dev = maxdev;
+                  }
+               }
+            }
+         }
+      }
+
+      if (best_time < 0) {
+         G4cout << "GlueXSwimTuner: no setting meets the tolerance of "
+                << fTolerance / mm << " mm in region " << region
+                << ", recommending the reference setting." << G4endl;
+      }
+      else {
+         G4cout << "GlueXSwimTuner: fastest setting in region " << region
+                << " is " << best_time / fTracks * 1e3 << " ms/track"
+                << " with max deviation " << best_dev / mm << " mm"
+                << G4endl;
+      }
+      G4cout << "SWIMTUNE:" << region << " '" << best.stepper << "' "
+             << best.minStep << " " << best.deltaChord << " "
+             << best.deltaOneStep / 10 << " " << best.deltaOneStep
+             << G4endl;
+   }
+}
+
+double GlueXSwimTuner::swim(G4MagneticField *field,
+                            const swim_config_t &config,
+                            std::vector<G4ThreeVector> &endpoint,
+                            int reference)
+{
+   // Swim the reference tracks through the field for fLength, in steps
+   // of at most fMaxStep as the propagator would take them between
+   // volume boundaries, and return the cpu time taken in seconds.
+   // The relative accuracy of each step is limited to the same range
+   // as in G4FieldManager, except for the reference swim.
+
+   G4Mag_UsualEqRhs eqn(field);
+   G4MagIntegratorStepper *stepper;
+   stepper = HddsG4Builder::createStepper(config.stepper, &eqn);
+   G4ChordFinder cfinder(field, config.minStep * mm, stepper);
+   cfinder.SetDeltaChord(config.deltaChord * mm);
+   const double mass = 139.57 * MeV;
+
+   endpoint.resize(fTrack.size());
+   G4Timer timer;
+   timer.Start();
+   for (unsigned int n=0; n < fTrack.size(); ++n) {
+      swim_track_t &track = fTrack[n];
+      G4ChargeState chargeState(track.charge, 0, 0);
+      eqn.SetChargeMomentumMass(chargeState, track.mom, mass);
+      double ekin = sqrt(track.mom * track.mom + mass * mass) - mass;
+      G4FieldTrack ftrack(track.pos, 0, track.dir, ekin, mass,
+                          track.charge, G4ThreeVector());
+      double s = 0;
+      for (int nstep=0; nstep < 1000000 && s < fLength * (1 - 1e-12);
+           ++nstep)
+      {
+         double h = (fLength - s < fMaxStep)? fLength - s : fMaxStep;
+         double eps = config.deltaOneStep * mm / h;
+         if (! reference) {
+            eps = (eps < 5e-5)? 5e-5 : (eps > 1e-3)? 1e-3 : eps;
+         }
+         double done = cfinder.AdvanceChordLimited(ftrack, h, eps,
+                                                   ftrack.GetPosition(), 0);
+         if (done <= 0)
+            break;
+         s += done;
+      }
+      endpoint[n] = ftrack.GetPosition();
+   }
+   timer.Stop();
+   delete stepper;
+   return timer.GetUserElapsed();
+}
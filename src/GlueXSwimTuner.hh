@@ -0,0 +1,64 @@
+//
+// GlueXSwimTuner class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// This class benchmarks the tracking of charged particles through
+// each of the magnetic field regions built by HddsG4Builder, using a
+// range of field steppers and chord finder settings. For each setting
+// it measures the time spent and the deviation of the track endpoints
+// from a reference computed with very tight tolerances, and it prints
+// the fastest setting that meets the accuracy requirement as a
+// SWIMTUNE card that can be pasted into control.in.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. It is only
+// meant to be run from the master thread before tracking starts.
+
+#ifndef GlueXSwimTuner_h
+#define GlueXSwimTuner_h 1
+
+#include <vector>
+#include <string>
+
+#include <G4ThreeVector.hh>
+#include <G4MagneticField.hh>
+
+class HddsG4Builder;
+
+class GlueXSwimTuner
+{
+ public:
+   GlueXSwimTuner(const HddsG4Builder *builder);
+   ~GlueXSwimTuner();
+
+   void Run();
+
+   struct swim_config_t {
+      std::string stepper;       // stepper class name
+      double minStep;            // chord finder minimum step (mm)
+      double deltaChord;         // max miss distance of chord (mm)
+      double deltaOneStep;       // position accuracy of each step (mm)
+   };
+
+ private:
+   const HddsG4Builder *fBuilder;
+   int fTracks;                // number of reference tracks per region
+   double fLength;             // path length of each track (mm)
+   double fMaxStep;            // length of each tracking step (mm)
+   double fTolerance;          // max endpoint deviation allowed (mm)
+
+   struct swim_track_t {
+      G4ThreeVector pos;       // starting point
+      G4ThreeVector dir;       // initial direction
+      double mom;              // momentum (MeV/c)
+      double charge;           // charge (units of eplus)
+   };
+   std::vector<swim_track_t> fTrack;
+
+   double swim(G4MagneticField *field, const swim_config_t &config,
+               std::vector<G4ThreeVector> &endpoint, int reference=0);
+};
+
+#endif
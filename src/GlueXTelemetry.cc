@@ -0,0 +1,187 @@
+//
+// GlueXTelemetry - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXTelemetry.hh"
+#include "GlueXUserOptions.hh"
+#include "HddmOutput.hh"
+
+#include "G4AutoLock.hh"
+#include "G4ios.hh"
+
+#include <map>
+#include <sstream>
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+G4ThreadLocal GlueXTelemetry::tally_t *GlueXTelemetry::fTally = 0;
+GlueXTelemetry::tally_t GlueXTelemetry::fTotals;
+bool GlueXTelemetry::fPrepared = false;
+double GlueXTelemetry::fInterval = 0;
+double GlueXTelemetry::fRunStart = 0;
+std::ofstream *GlueXTelemetry::fFile = 0;
+G4Mutex GlueXTelemetry::fMutex = G4MUTEX_INITIALIZER;
+
+static double clock_seconds()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void GlueXTelemetry::Clear(tally_t &tally)
+{
+   tally.events = 0;
+   tally.steps = 0;
+   tally.seconds = 0;
+   tally.maxSeconds = 0;
+   for (int i=0; i < kBins; ++i)
+      tally.histogram[i] = 0;
+   tally.eventStart = 0;
+   tally.lastReport = clock_seconds();
+   tally.lastEvents = 0;
+}
+
+void GlueXTelemetry::BeginOfRun(int runno)
+{
+   G4AutoLock barrier(&fMutex);
+   if (! fPrepared) {
+      fPrepared = true;
+      GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+      std::map<int, std::string> telemetry_opts;
+      if (user_opts && user_opts->Find("TELEMETRY", telemetry_opts)) {
+         fInterval = atof(telemetry_opts[1].c_str());
+         if (fInterval > 0 && telemetry_opts.find(2) != telemetry_opts.end())
+         {
+            fFile = new std::ofstream(telemetry_opts[2].c_str(),
+                                      std::ios::app);
+            if (! fFile->is_open()) {
+               G4cerr << "GlueXTelemetry::BeginOfRun warning - "
+                      << "unable to open telemetry file "
+                      << telemetry_opts[2] << ", continuing with "
+                      << "stderr instead." << G4endl;
+               delete fFile;
+               fFile = 0;
+            }
+         }
+      }
+   }
+   if (fInterval <= 0)
+      return;
+   if (G4Threading::IsMasterThread()) {
+      Clear(fTotals);
+      fTotals.runno = runno;
+      fRunStart = clock_seconds();
+   }
+   if (fTally == 0)
+      fTally = new tally_t;
+   Clear(*fTally);
+   fTally->runno = runno;
+}
+
+void GlueXTelemetry::BeginOfEvent()
+{
+   if (fTally)
+      fTally->eventStart = clock_seconds();
+}
+
+void GlueXTelemetry::EndOfEvent()
+{
+   if (fTally == 0)
+      return;
+   double now = clock_seconds();
+   double seconds = now - fTally->eventStart;
+   ++fTally->events;
+   fTally->seconds += seconds;
+   if (seconds > fTally->maxSeconds)
+      fTally->maxSeconds = seconds;
+   int bin = (seconds > 0)? (int)floor(10 * log10(seconds / 1e-5)) : 0;
+   bin = (bin < 0)? 0 : (bin >= kBins)? kBins - 1 : bin;
+   ++fTally->histogram[bin];
+
+   if (now - fTally->lastReport >= fInterval) {
+      double rate = (fTally->events - fTally->lastEvents) /
+                    (now - fTally->lastReport);
+      fTally->lastReport = now;
+      fTally->lastEvents = fTally->events;
+      G4AutoLock barrier(&fMutex);
+      Report(*fTally, "interval", G4Threading::G4GetThreadId(), rate);
+   }
+}
+
+void GlueXTelemetry::EndOfRun()
+{
+   if (fTally == 0 || fTally->events == 0)
+      return;
+   G4AutoLock barrier(&fMutex);
+   fTotals.events += fTally->events;
+   fTotals.steps += fTally->steps;
+   fTotals.seconds += fTally->seconds;
+   if (fTally->maxSeconds > fTotals.maxSeconds)
+      fTotals.maxSeconds = fTally->maxSeconds;
+   for (int i=0; i < kBins; ++i)
+      fTotals.histogram[i] += fTally->histogram[i];
+   fTally->events = 0;
+}
+
+void GlueXTelemetry::PrintSummary()
+{
+   // Runs without events, such as the one that the fork mode of hdgeant4
+   // starts in the main process before forking, are not reported.
+
+   if (fInterval <= 0 || fTotals.events == 0)
+      return;
+   G4AutoLock barrier(&fMutex);
+   double elapsed = clock_seconds() - fRunStart;
+   Report(fTotals, "run", -1, (elapsed > 0)? fTotals.events / elapsed : 0);
+}
+
+double GlueXTelemetry::Quantile(const tally_t &tally, double q)
+{
+   // upper edge of the bin holding the quantile, in ms
+
+   if (tally.events == 0)
+      return 0;
+   long count = 0;
+   for (int i=0; i < kBins; ++i) {
+      count += tally.histogram[i];
+      if (count >= q * tally.events)
+         return 1e-2 * pow(10., (i + 1) / 10.);
+   }
+   return tally.maxSeconds * 1e3;
+}
+
+void GlueXTelemetry::Report(const tally_t &tally, const char *kind,
+                            int thread, double rate)
+{
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+   long events = (tally.events > 0)? tally.events : 1;
+   std::stringstream line;
+   line << "{\"telemetry\": \"" << kind << "\""
+        << ", \"pid\": " << getpid()
+        << ", \"thread\": " << thread
+        << ", \"run\": " << tally.runno
+        << ", \"elapsed_s\": " << clock_seconds() - fRunStart
+        << ", \"events\": " << tally.events
+        << ", \"events_per_s\": " << rate
+        << ", \"event_ms_mean\": " << 1e3 * tally.seconds / events
+        << ", \"event_ms_p50\": " << Quantile(tally, 0.50)
+        << ", \"event_ms_p90\": " << Quantile(tally, 0.90)
+        << ", \"event_ms_p99\": " << Quantile(tally, 0.99)
+        << ", \"event_ms_max\": " << 1e3 * tally.maxSeconds
+        << ", \"steps_per_event\": " << (double)tally.steps / events
+        << ", \"peak_rss_kb\": " << usage.ru_maxrss
+        << ", \"hddm_bytes\": " << HddmOutput::getBytesWritten()
+        << "}";
+   if (fFile)
+      *fFile << line.str() << std::endl;
+   else
+      std::cerr << line.str() << std::endl;
+}
@@ -0,0 +1,89 @@
+//
+// GlueXTelemetry - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Throughput and memory telemetry, for keeping an eye on farm jobs and
+// spotting configurations that run slow or leak memory without having
+// to attach a profiler. It is turned on by the TELEMETRY card in
+// control.in, giving the interval in seconds between reports and
+// optionally the file they are appended to, or else they go to stderr.
+//
+// Each worker thread counts its events, the time taken by each of them,
+// from the start of the event action to its end, and the steps tracked
+// in them. Once the interval has passed since its last report, a thread
+// writes one line of JSON at the end of its next event, with the event
+// rate over the interval, the mean, median, 90% and 99% quantiles and
+// maximum of the event time since the start of the run, the mean number
+// of steps per event, and the peak resident memory of the process and
+// the number of bytes written to the HDDM output so far. At the end of
+// each run, the counters of all threads are merged and the master writes
+// a summary line of the same form for the whole run. The quantiles are
+// taken from a histogram with ten bins for each factor of ten in time,
+// so they are good to about 25%. Lines carry the process id, so that
+// the reports of the workers in the fork mode of hdgeant4 can be told
+// apart in a common file.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "thread-local", ie. has thread-local state. Each thread
+// keeps its own counters, which are merged under a lock at the end of
+// the run.
+
+#ifndef GlueXTelemetry_h
+#define GlueXTelemetry_h 1
+
+#include "G4Threading.hh"
+
+#include <string>
+#include <fstream>
+
+class GlueXTelemetry
+{
+ public:
+   // Read the card, the first time it is called, at the start of a run,
+   // and start the counters of the calling thread over.
+   static void BeginOfRun(int runno);
+   static void BeginOfEvent();
+   static void EndOfEvent();
+   // Add the counters of the calling thread to the totals for the run.
+   static void EndOfRun();
+   // Write the summary for the run and start over, by the master.
+   static void PrintSummary();
+
+   static void CountStep() {
+      if (fTally)
+         ++fTally->steps;
+   }
+
+ private:
+   GlueXTelemetry() {}
+
+   enum { kBins = 100 };         // 10 us to 10^5 s, 10 bins per decade
+
+   struct tally_t {
+      int runno;
+      long events;
+      long steps;
+      double seconds;            // sum of event times
+      double maxSeconds;
+      long histogram[kBins];
+      double eventStart;
+      double lastReport;
+      long lastEvents;
+   };
+   static G4ThreadLocal tally_t *fTally;
+   static tally_t fTotals;       // guarded by fMutex
+   static void Clear(tally_t &tally);
+   static void Report(const tally_t &tally, const char *kind, int thread,
+                      double rate);
+   static double Quantile(const tally_t &tally, double q);
+
+   static bool fPrepared;
+   static double fInterval;
+   static double fRunStart;
+   static std::ofstream *fFile;
+   static G4Mutex fMutex;
+};
+
+#endif
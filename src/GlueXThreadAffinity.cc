@@ -0,0 +1,224 @@
+//
+// GlueXThreadAffinity - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXThreadAffinity.hh"
+
+#include "G4ios.hh"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <set>
+#include <stdlib.h>
+#include <sched.h>
+#include <dirent.h>
+
+std::vector<int> GlueXThreadAffinity::fCpus;
+std::map<int, int> GlueXThreadAffinity::fCpuNode;
+int GlueXThreadAffinity::fNodeCount = 1;
+int GlueXThreadAffinity::fReplicate = 0;
+G4ThreadLocal int GlueXThreadAffinity::fNode = -1;
+
+// placement order of a cpu, compared member by member
+struct cpu_slot_t {
+   int node;
+   int rank;      // index of this hardware thread among those of its core
+   int package;
+   int core;
+   int cpu;
+   bool operator<(const cpu_slot_t &other) const {
+      if (node != other.node)
+         return node < other.node;
+      if (rank != other.rank)
+         return rank < other.rank;
+      if (package != other.package)
+         return package < other.package;
+      if (core != other.core)
+         return core < other.core;
+      return cpu < other.cpu;
+   }
+};
+
+int GlueXThreadAffinity::Configure(const std::string &policy, int replicate)
+{
+   // Work out the cpu that each worker thread is to be pinned to under
+   // the named policy, returning the number of cpus in the list, or 0
+   // if the threads are not to be pinned.
+
+   fCpus.clear();
+   fCpuNode.clear();
+   fNodeCount = 1;
+   fReplicate = 0;
+   if (policy.size() == 0 || policy == "none")
+      return 0;
+
+   cpu_set_t allowed;
+   CPU_ZERO(&allowed);
+   if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+      G4cerr << "GlueXThreadAffinity::Configure warning - "
+             << "cannot read the cpus allowed for this process, "
+             << "continuing without thread pinning." << G4endl;
+      return 0;
+   }
+
+   // Find the node of each cpu from the cpu lists of the nodes in /sys
+
+   DIR *dirp = opendir("/sys/devices/system/node");
+   struct dirent *entry;
+   while (dirp && (entry = readdir(dirp)) != 0) {
+      std::string name(entry->d_name);
+      if (name.size() < 5 || name.substr(0, 4) != "node" ||
+          name.find_first_not_of("0123456789", 4) != name.npos)
+      {
+         continue;
+      }
+      int node = atoi(name.substr(4).c_str());
+      std::string path("/sys/devices/system/node/" + name + "/cpulist");
+      std::ifstream fin(path.c_str());
+      std::string list;
+      std::vector<int> cpus;
+      if (fin >> list && parseCpuList(list, cpus)) {
+         for (unsigned int i=0; i < cpus.size(); ++i)
+            fCpuNode[cpus[i]] = node;
+      }
+   }
+   if (dirp)
+      closedir(dirp);
+
+   std::vector<cpu_slot_t> slots;
+   std::map<std::pair<int,int>, int> threads_per_core;
+   std::set<int> nodes;
+   for (int cpu=0; cpu < CPU_SETSIZE; ++cpu) {
+      if (! CPU_ISSET(cpu, &allowed))
+         continue;
+      cpu_slot_t slot;
+      slot.node = (fCpuNode.count(cpu))? fCpuNode[cpu] : 0;
+      slot.package = readTopology("physical_package_id", cpu);
+      slot.core = readTopology("core_id", cpu);
+      slot.rank = threads_per_core[std::make_pair(slot.package,
+                                                  slot.core)]++;
+      slot.cpu = cpu;
+      slots.push_back(slot);
+      nodes.insert(slot.node);
+   }
+
+   if (policy == "compact") {
+      for (unsigned int i=0; i < slots.size(); ++i)
+         slots[i].rank = 0;
+      std::sort(slots.begin(), slots.end());
+      for (unsigned int i=0; i < slots.size(); ++i)
+         fCpus.push_back(slots[i].cpu);
+   }
+   else if (policy == "scatter") {
+      std::sort(slots.begin(), slots.end());
+      std::map<int, std::vector<int> > node_cpus;
+      for (unsigned int i=0; i < slots.size(); ++i)
+         node_cpus[slots[i].node].push_back(slots[i].cpu);
+      for (unsigned int n=0; fCpus.size() < slots.size(); ++n) {
+         std::map<int, std::vector<int> >::iterator iter;
+         for (iter = node_cpus.begin(); iter != node_cpus.end(); ++iter) {
+            if (n < iter->second.size())
+               fCpus.push_back(iter->second[n]);
+         }
+      }
+   }
+   else if (! parseCpuList(policy, fCpus)) {
+      G4cerr << "GlueXThreadAffinity::Configure warning - "
+             << "unknown thread placement policy " << policy
+             << ", continuing without thread pinning." << G4endl;
+      fCpus.clear();
+      return 0;
+   }
+   else {
+      nodes.clear();
+      for (unsigned int i=0; i < fCpus.size(); ++i)
+         nodes.insert((fCpuNode.count(fCpus[i]))? fCpuNode[fCpus[i]] : 0);
+   }
+   if (fCpus.size() == 0) {
+      G4cerr << "GlueXThreadAffinity::Configure warning - "
+             << "no cpus found for thread placement, "
+             << "continuing without thread pinning." << G4endl;
+      return 0;
+   }
+   fNodeCount = nodes.size();
+   fReplicate = replicate;
+
+   std::stringstream list;
+   for (unsigned int i=0; i < fCpus.size() && i < 16; ++i)
+      list << ((i > 0)? "," : "") << fCpus[i];
+   if (fCpus.size() > 16)
+      list << ",...";
+   G4cout << "GlueXThreadAffinity: workers pinned by " << policy
+          << " policy to cpus " << list.str() << " on " << fNodeCount
+          << " NUMA node" << ((fNodeCount > 1)? "s" : "")
+          << ((GetReplicate())? ", shared tables replicated per node" : "")
+          << G4endl;
+   return fCpus.size();
+}
+
+int GlueXThreadAffinity::PinThread(int thread)
+{
+   // Pin the calling thread to the cpu for the given thread index,
+   // and record its node. Returns the cpu, or -1 if it was not pinned.
+
+   if (fCpus.size() == 0 || thread < 0)
+      return -1;
+   int cpu = fCpus[thread % fCpus.size()];
+   cpu_set_t mask;
+   CPU_ZERO(&mask);
+   CPU_SET(cpu, &mask);
+   if (sched_setaffinity(0, sizeof(mask), &mask) != 0) {
+      G4cerr << "GlueXThreadAffinity::PinThread warning - "
+             << "cannot pin thread " << thread << " to cpu " << cpu
+             << ", continuing without it." << G4endl;
+      return -1;
+   }
+   std::map<int, int>::const_iterator iter = fCpuNode.find(cpu);
+   fNode = (iter != fCpuNode.end())? iter->second : 0;
+   return cpu;
+}
+
+bool GlueXThreadAffinity::parseCpuList(const std::string &list,
+                                       std::vector<int> &cpus)
+{
+   // Parse a list of cpus in the format of the kernel cpulist files,
+   // ie. numbers and ranges separated by commas, eg. 0-3,8,10-11.
+
+   std::stringstream items(list);
+   std::string item;
+   while (std::getline(items, item, ',')) {
+      size_t dash = item.find('-');
+      std::string first(item.substr(0, dash));
+      std::string last((dash != item.npos)? item.substr(dash + 1) : first);
+      if (first.size() == 0 || last.size() == 0 ||
+          first.find_first_not_of("0123456789") != first.npos ||
+          last.find_first_not_of("0123456789") != last.npos)
+      {
+         return false;
+      }
+      int lo = atoi(first.c_str());
+      int hi = atoi(last.c_str());
+      if (hi < lo || hi >= CPU_SETSIZE)
+         return false;
+      for (int cpu=lo; cpu <= hi; ++cpu)
+         cpus.push_back(cpu);
+   }
+   return cpus.size() > 0;
+}
+
+int GlueXThreadAffinity::readTopology(const char *path, int cpu)
+{
+   // Read one of the topology numbers of a cpu from /sys,
+   // returning the cpu number itself if it is not there.
+
+   std::stringstream name;
+   name << "/sys/devices/system/cpu/cpu" << cpu << "/topology/" << path;
+   std::ifstream fin(name.str().c_str());
+   int value;
+   if (fin >> value)
+      return value;
+   return cpu;
+}
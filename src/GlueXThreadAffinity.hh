@@ -0,0 +1,74 @@
+//
+// GlueXThreadAffinity - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// This class pins the worker threads started with the -t option of
+// hdgeant4 to cpus chosen by a placement policy, so that they do not
+// migrate between the sockets of multi-socket hosts, and keeps track
+// of the NUMA node that each of them runs on. The policy comes from
+// the PINTHREADS card in control.in, or the -p option, and is one of
+//    none    - threads are left to the scheduler (the default)
+//    compact - threads fill the cpus of one node before the next, with
+//              the hardware threads of each core next to each other
+//    scatter - threads are dealt out to the nodes in turn, using one
+//              hardware thread of every core in a node before any second
+//    <list>  - an explicit list of cpus, eg. 0-7,16-23, taken in order
+// Only the cpus that the process is allowed to run on are used for
+// compact and scatter placement, and when there are more threads than
+// cpus they wrap around. The topology is read from /sys, and a host
+// without NUMA information there is treated as a single node.
+//
+// Workers are pinned by GlueXUserWorkerInitialization as they start,
+// before they build their copies of the geometry and fields, so that
+// the memory of those is allocated on the node where it is used. With
+// replication enabled on the PINTHREADS card, large read-only tables
+// shared between the threads, such as the mapped field maps, are also
+// copied once per node by the first worker to start there, and shared
+// by the workers on that node (see GlueXMappedMagField).
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state, apart from
+// the node number of the calling thread. It is configured from the
+// master thread before the workers start.
+
+#ifndef GlueXThreadAffinity_h
+#define GlueXThreadAffinity_h 1
+
+#include <G4Threading.hh>
+
+#include <vector>
+#include <string>
+#include <map>
+
+class GlueXThreadAffinity
+{
+ public:
+   static int Configure(const std::string &policy, int replicate);
+   static int PinThread(int thread);
+
+   static int GetNode() {
+      return fNode;
+   }
+   static int GetNodeCount() {
+      return fNodeCount;
+   }
+   static bool GetReplicate() {
+      return fReplicate && fNodeCount > 1;
+   }
+
+ private:
+   GlueXThreadAffinity() {}
+
+   static bool parseCpuList(const std::string &list, std::vector<int> &cpus);
+   static int readTopology(const char *path, int cpu);
+
+   static std::vector<int> fCpus;        // cpu for each thread, cyclic
+   static std::map<int, int> fCpuNode;   // NUMA node of each cpu
+   static int fNodeCount;                // number of nodes in use
+   static int fReplicate;                // replicate shared tables per node
+   static G4ThreadLocal int fNode;       // node of this thread, or -1
+};
+
+#endif
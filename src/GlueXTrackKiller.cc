@@ -0,0 +1,270 @@
+//
+// GlueXTrackKiller - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXTrackKiller.hh"
+#include "GlueXDetectorConstruction.hh"
+#include "GlueXUserOptions.hh"
+#include "HddsG4Builder.hh"
+
+#include "G4LogicalVolumeStore.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4AutoLock.hh"
+#include "G4ios.hh"
+
+#include <map>
+#include <stdlib.h>
+
+bool GlueXTrackKiller::fPrepared = false;
+bool GlueXTrackKiller::fActive = false;
+double GlueXTrackKiller::fMaxTime = 0;
+std::vector<std::string> GlueXTrackKiller::fRegionNames;
+std::vector<double> GlueXTrackKiller::fRegionMinEnergy;
+std::vector<int> GlueXTrackKiller::fRegionOf;
+std::vector<std::string> GlueXTrackKiller::fEntryNames;
+std::vector<int> GlueXTrackKiller::fEntryOf;
+std::atomic<long> *GlueXTrackKiller::fKilled[kKillReasons];
+G4Mutex GlueXTrackKiller::fMutex = G4MUTEX_INITIALIZER;
+
+static std::string hdds_name(const G4LogicalVolume *lvol)
+{
+   // The copies of a volume that HddsG4Builder makes for the parallel
+   // layers of the geometry are named <name>::<layer>, and are matched
+   // by the hdds name of the original.
+
+   std::string name(lvol->GetName());
+   size_t colons = name.rfind("::");
+   if (colons != name.npos && colons + 2 < name.size() &&
+       name.find_first_not_of("0123456789", colons + 2) == name.npos)
+   {
+      name.erase(colons);
+   }
+   return name;
+}
+
+void GlueXTrackKiller::Prepare()
+{
+   G4AutoLock barrier(&fMutex);
+   if (fPrepared)
+      return;
+   fPrepared = true;
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   if (user_opts == 0)
+      return;
+
+   std::map<int, double> time_opts;
+   if (user_opts->Find("KILLTIME", time_opts) && time_opts[1] > 0)
+      fMaxTime = time_opts[1] * ns;
+
+   // Region 0 holds everything not inside a KILLENERGY volume
+
+   std::map<std::string, int> regions;
+   fRegionNames.push_back("elsewhere");
+   fRegionMinEnergy.push_back(0);
+   std::map<int, std::string> energy_opts;
+   std::map<int, std::string>::iterator opt;
+   if (user_opts->Find("KILLENERGY", energy_opts)) {
+      for (opt = energy_opts.begin(); opt != energy_opts.end(); ++opt) {
+         size_t colon = opt->second.find(':');
+         double emin = (colon != opt->second.npos)?
+                       atof(opt->second.substr(colon + 1).c_str()) : 0;
+         if (emin <= 0) {
+            G4cerr << "GlueXTrackKiller::Prepare warning - "
+                   << "entry " << opt->second << " on the KILLENERGY card "
+                   << "is not of the form 'volume:emin', "
+                   << "continuing without it." << G4endl;
+            continue;
+         }
+         regions[opt->second.substr(0, colon)] = fRegionNames.size();
+         fRegionNames.push_back(opt->second.substr(0, colon));
+         fRegionMinEnergy.push_back(emin * MeV);
+      }
+   }
+   std::map<int, std::string> entry_opts;
+   std::map<std::string, int> entries;
+   if (user_opts->Find("KILLVOLUMES", entry_opts)) {
+      for (opt = entry_opts.begin(); opt != entry_opts.end(); ++opt) {
+         entries[opt->second] = fEntryNames.size();
+         fEntryNames.push_back(opt->second);
+      }
+   }
+   fActive = (fMaxTime > 0 || fRegionNames.size() > 1 ||
+              fEntryNames.size() > 0);
+   if (! fActive)
+      return;
+
+   // Tabulate the region and the entry rule of every logical volume by
+   // its instance id, so that they are found in constant time on each
+   // step, walking down from the world volume of every layer so that
+   // each volume takes the region of the innermost KILLENERGY volume
+   // that it is inside.
+
+   G4LogicalVolumeStore *store = G4LogicalVolumeStore::GetInstance();
+   G4LogicalVolumeStore::iterator iter;
+   int nvolumes = 0;
+   for (iter = store->begin(); iter != store->end(); ++iter) {
+      if ((*iter)->GetInstanceID() >= nvolumes)
+         nvolumes = (*iter)->GetInstanceID() + 1;
+   }
+   fRegionOf.assign(nvolumes, 0);
+   fEntryOf.assign(nvolumes, -1);
+   std::vector<int> found(fEntryNames.size(), 0);
+   for (iter = store->begin(); iter != store->end(); ++iter) {
+      std::map<std::string, int>::iterator entry;
+      entry = entries.find(hdds_name(*iter));
+      if (entry != entries.end()) {
+         fEntryOf[(*iter)->GetInstanceID()] = entry->second;
+         found[entry->second] = 1;
+      }
+   }
+   for (unsigned int i=0; i < fEntryNames.size(); ++i) {
+      if (! found[i]) {
+         G4cerr << "GlueXTrackKiller::Prepare warning - "
+                << "volume " << fEntryNames[i] << " on the KILLVOLUMES "
+                << "card is not found in the geometry, "
+                << "continuing without it." << G4endl;
+      }
+   }
+
+   found.assign(fRegionNames.size(), 0);
+   std::vector<char> visited(nvolumes, 0);
+   std::vector<std::pair<G4LogicalVolume*, int> > pending;
+   const HddsG4Builder *builder = GlueXDetectorConstruction::GetBuilder();
+   for (int layer=0; builder && builder->getWorldVolume(layer); ++layer)
+      pending.push_back(std::make_pair(builder->getWorldVolume(layer), 0));
+   while (pending.size() > 0) {
+      G4LogicalVolume *lvol = pending.back().first;
+      int region = pending.back().second;
+      pending.pop_back();
+      int id = lvol->GetInstanceID();
+      if (visited[id])
+         continue;
+      visited[id] = 1;
+      std::map<std::string, int>::iterator named;
+      named = regions.find(hdds_name(lvol));
+      if (named != regions.end()) {
+         region = named->second;
+         found[region] = 1;
+      }
+      fRegionOf[id] = region;
+      for (int i=0; i < lvol->GetNoDaughters(); ++i) {
+         G4LogicalVolume *child = lvol->GetDaughter(i)->GetLogicalVolume();
+         pending.push_back(std::make_pair(child, region));
+      }
+   }
+   for (unsigned int i=1; i < fRegionNames.size(); ++i) {
+      if (! found[i]) {
+         G4cerr << "GlueXTrackKiller::Prepare warning - "
+                << "volume " << fRegionNames[i] << " on the KILLENERGY "
+                << "card is not found in the geometry, "
+                << "continuing without it." << G4endl;
+      }
+   }
+
+   fKilled[kKillTime] = new std::atomic<long>[fRegionNames.size()];
+   fKilled[kKillEnergy] = new std::atomic<long>[fRegionNames.size()];
+   fKilled[kKillEntry] = new std::atomic<long>[fEntryNames.size() + 1];
+   for (unsigned int i=0; i < fRegionNames.size(); ++i) {
+      fKilled[kKillTime][i] = 0;
+      fKilled[kKillEnergy][i] = 0;
+   }
+   for (unsigned int i=0; i < fEntryNames.size(); ++i)
+      fKilled[kKillEntry][i] = 0;
+
+   G4cout << "GlueXTrackKiller: killing tracks";
+   if (fMaxTime > 0)
+      G4cout << " after " << fMaxTime / ns << " ns,";
+   for (unsigned int i=1; i < fRegionNames.size(); ++i) {
+      G4cout << " below " << fRegionMinEnergy[i] / MeV << " MeV in "
+             << fRegionNames[i] << ",";
+   }
+   for (unsigned int i=0; i < fEntryNames.size(); ++i)
+      G4cout << " entering " << fEntryNames[i] << ",";
+   G4cout << " see the KILL cards in control.in" << G4endl;
+}
+
+bool GlueXTrackKiller::CheckTrack(G4LogicalVolume *lvol, double time,
+                                  double ekin, bool entering)
+{
+   int id = lvol->GetInstanceID();
+   if (id < 0 || id >= (int)fRegionOf.size())
+      return false;
+   int region = fRegionOf[id];
+   if (fMaxTime > 0 && time > fMaxTime) {
+      ++fKilled[kKillTime][region];
+      return true;
+   }
+   if (ekin < fRegionMinEnergy[region]) {
+      ++fKilled[kKillEnergy][region];
+      return true;
+   }
+   if (entering && fEntryOf[id] >= 0) {
+      ++fKilled[kKillEntry][fEntryOf[id]];
+      return true;
+   }
+   return false;
+}
+
+bool GlueXTrackKiller::KillNewTrack(const G4Track *track)
+{
+   // Primary tracks have not been placed in the geometry yet when
+   // they are stacked, so they are only looked at as they step.
+
+   if (! fActive || track->GetParentID() == 0)
+      return false;
+   const G4VPhysicalVolume *pvol = track->GetVolume();
+   if (pvol == 0)
+      return false;
+   return CheckTrack(pvol->GetLogicalVolume(), track->GetGlobalTime(),
+                     track->GetKineticEnergy(), true);
+}
+
+void GlueXTrackKiller::ProcessStep(const G4Step *step)
+{
+   if (! fActive)
+      return;
+   G4Track *track = step->GetTrack();
+   if (track->GetTrackStatus() != fAlive)
+      return;
+   G4StepPoint *post = step->GetPostStepPoint();
+   G4VPhysicalVolume *pvol = post->GetPhysicalVolume();
+   if (pvol == 0)
+      return;
+   if (CheckTrack(pvol->GetLogicalVolume(), post->GetGlobalTime(),
+                  post->GetKineticEnergy(),
+                  post->GetStepStatus() == fGeomBoundary))
+   {
+      track->SetTrackStatus(fStopAndKill);
+   }
+}
+
+void GlueXTrackKiller::PrintStatistics()
+{
+   if (! fActive)
+      return;
+   long total = 0;
+   for (unsigned int i=0; i < fRegionNames.size(); ++i)
+      total += fKilled[kKillTime][i] + fKilled[kKillEnergy][i];
+   for (unsigned int i=0; i < fEntryNames.size(); ++i)
+      total += fKilled[kKillEntry][i];
+   G4cout << "GlueXTrackKiller: " << total << " tracks killed";
+   if (fMaxTime > 0) {
+      G4cout << ", after " << fMaxTime / ns << " ns:";
+      for (unsigned int i=0; i < fRegionNames.size(); ++i)
+         G4cout << " " << fKilled[kKillTime][i] << " " << fRegionNames[i];
+   }
+   if (fRegionNames.size() > 1) {
+      G4cout << ", below threshold:";
+      for (unsigned int i=1; i < fRegionNames.size(); ++i)
+         G4cout << " " << fKilled[kKillEnergy][i] << " " << fRegionNames[i];
+   }
+   if (fEntryNames.size() > 0) {
+      G4cout << ", on entry:";
+      for (unsigned int i=0; i < fEntryNames.size(); ++i)
+         G4cout << " " << fKilled[kKillEntry][i] << " " << fEntryNames[i];
+   }
+   G4cout << G4endl;
+}
@@ -0,0 +1,95 @@
+//
+// GlueXTrackKiller - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Stops tracks that can no longer contribute to any recorded hit, so
+// that the time is not spent following them to the end of their range,
+// as happens with the neutrons and the soft showers in the beam dump,
+// the walls of the hall and the magnet yoke. The policy is set by the
+// following cards in control.in, and is applied to each new track by
+// GlueXStackingAction, which drops it before it is ever tracked, and to
+// each step by GlueXSteppingAction.
+//
+//    KILLTIME tmax              - tracks are killed once their global
+//                                 time passes tmax ns, eg. at the end
+//                                 of the 1 us readout window of the CDC
+//    KILLENERGY 'vol:emin' ...  - tracks inside the volume vol, or any
+//                                 volume inside it, are killed once their
+//                                 kinetic energy falls below emin MeV,
+//                                 with the innermost volume named taking
+//                                 precedence
+//    KILLVOLUMES 'vol' ...      - tracks are killed as soon as they enter
+//                                 any placement of the volume vol, or if
+//                                 they are created inside one
+//
+// Volumes are named by their logical volume names, as in the hdds
+// geometry, and the copies of them on the parallel layers of the
+// geometry are covered by the same rules.
+// A volume that is placed both inside and outside of a KILLENERGY volume
+// takes the threshold of the first placement found in the geometry tree.
+// The number of tracks killed by each rule and where is reported at the
+// end of the run.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. The tables are
+// built once at the start of the first run, and are read-only after
+// that, and the counters are atomic.
+
+#ifndef GlueXTrackKiller_h
+#define GlueXTrackKiller_h 1
+
+#include "G4Track.hh"
+#include "G4Step.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Threading.hh"
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+class GlueXTrackKiller
+{
+ public:
+   // Read the cards and tabulate the volumes, the first time it is
+   // called, to be called at the start of each run.
+   static void Prepare();
+
+   static bool IsActive() {
+      return fActive;
+   }
+
+   // true if a new track is to be killed before it is tracked
+   static bool KillNewTrack(const G4Track *track);
+   // kill the track if the step has taken it past one of the limits
+   static void ProcessStep(const G4Step *step);
+
+   static void PrintStatistics();
+
+   enum kill_reason_t {
+      kKillTime,
+      kKillEnergy,
+      kKillEntry,
+      kKillReasons
+   };
+
+ private:
+   GlueXTrackKiller() {}
+
+   static bool CheckTrack(G4LogicalVolume *lvol, double time, double ekin,
+                          bool entering);
+
+   static bool fPrepared;
+   static bool fActive;
+   static double fMaxTime;
+   static std::vector<std::string> fRegionNames;  // 0 is the rest
+   static std::vector<double> fRegionMinEnergy;
+   static std::vector<int> fRegionOf;             // by volume instance id
+   static std::vector<std::string> fEntryNames;
+   static std::vector<int> fEntryOf;              // by volume instance id
+   static std::atomic<long> *fKilled[kKillReasons];
+   static G4Mutex fMutex;
+};
+
+#endif
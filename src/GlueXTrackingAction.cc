@@ -9,15 +9,122 @@
 #include "G4Track.hh"
 #include "G4TrackVector.hh"
 #include "GlueXUserTrackInformation.hh"
+#include "GlueXUserOptions.hh"
+#include "GlueXStepProfiler.hh"
+#include "GlueXTrajectory.hh"
+#include "GlueXSubEvents.hh"
+#include "G4VVisManager.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <map>
+#include <stdlib.h>
+
+// thinning that keeps only the first and the last points of a track
+const double kBirthAndDeath = 1e9 * mm;
 
 GlueXTrackingAction::GlueXTrackingAction()
-{;}
+ : fLazy(false),
+   fTrajectoryMode(kTrajectoryAuto),
+   fTrajectoryThinning(0)
+{
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   std::map<int, std::string> info_opts;
+   if (user_opts && user_opts->Find("TRACKINFO", info_opts)) {
+      if (info_opts[1] == "lazy") {
+         fLazy = true;
+      }
+      else if (info_opts[1] != "copy") {
+         G4cerr << "GlueXTrackingAction constructor warning - "
+                << "unknown TRACKINFO mode " << info_opts[1]
+                << ", continuing with 'copy'." << G4endl;
+      }
+   }
+
+   std::map<int, std::string> traj_opts;
+   if (user_opts && user_opts->Find("TRAJECTORIES", traj_opts)) {
+      std::string mode(traj_opts[1]);
+      size_t colon = mode.find(':');
+      if (colon != mode.npos) {
+         fTrajectoryThinning = atof(mode.substr(colon + 1).c_str()) * mm;
+         mode = mode.substr(0, colon);
+      }
+      // The integer modes of hdgeant, which kept the birth and death
+      // points (1, 2) or the full trajectories (3 to 5) of the primary
+      // or of all tracks, are taken as the nearest of the modes here.
+      if (mode.size() > 0 && mode.find_first_not_of("0123456789") == mode.npos)
+      {
+         int legacy = atoi(mode.c_str());
+         if (legacy == 0) {
+            mode = "off";
+         }
+         else if (legacy <= 2) {
+            mode = (legacy == 1)? "primaries" : "compact";
+            if (colon == std::string::npos)
+               fTrajectoryThinning = kBirthAndDeath;
+         }
+         else if (legacy <= 5) {
+            mode = "full";
+         }
+      }
+      if (mode == "auto")
+         fTrajectoryMode = kTrajectoryAuto;
+      else if (mode == "off")
+         fTrajectoryMode = kTrajectoryOff;
+      else if (mode == "full")
+         fTrajectoryMode = kTrajectoryFull;
+      else if (mode == "compact")
+         fTrajectoryMode = kTrajectoryCompact;
+      else if (mode == "primaries")
+         fTrajectoryMode = kTrajectoryPrimaries;
+      else {
+         G4cerr << "GlueXTrackingAction constructor warning - "
+                << "unknown TRAJECTORIES mode " << mode
+                << ", continuing with 'auto'." << G4endl;
+      }
+   }
+}
 
 GlueXTrackingAction::~GlueXTrackingAction()
 {;}
 
 void GlueXTrackingAction::PreUserTrackingAction(const G4Track* aTrack)
 {
+   GlueXStepProfiler::StartTrack(aTrack);
+   GlueXSubEvents::NoteTrack(aTrack);
+
+   // The visualization manager is only created once the run manager has
+   // been initialized, after this object, so it is looked for here.
+
+   switch (fTrajectoryMode) {
+    case kTrajectoryAuto:
+      if (G4VVisManager::GetConcreteInstance() == 0)
+         fpTrackingManager->SetStoreTrajectory(0);
+      break;
+    case kTrajectoryOff:
+      fpTrackingManager->SetStoreTrajectory(0);
+      break;
+    case kTrajectoryFull:
+      if (fpTrackingManager->GetStoreTrajectory() == 0)
+         fpTrackingManager->SetStoreTrajectory(1);
+      break;
+    case kTrajectoryCompact:
+    case kTrajectoryPrimaries:
+      if (fTrajectoryMode == kTrajectoryCompact || aTrack->GetParentID() == 0)
+      {
+         fpTrackingManager->SetStoreTrajectory(1);
+         fpTrackingManager->SetTrajectory(new GlueXTrajectory(aTrack,
+                                              fTrajectoryThinning));
+      }
+      else {
+         fpTrackingManager->SetStoreTrajectory(0);
+      }
+      break;
+   }
+
+   if (fLazy) {
+      GlueXUserTrackInformation::Share(aTrack);
+      return;
+   }
    if (aTrack->GetParentID() == 0 && aTrack->GetUserInformation() == 0) {
       GlueXUserTrackInformation* anInfo = new GlueXUserTrackInformation(aTrack);
       G4Track* theTrack = (G4Track*)aTrack;
@@ -28,7 +135,7 @@ void GlueXTrackingAction::PreUserTrackingAction(const G4Track* aTrack)
 void GlueXTrackingAction::PostUserTrackingAction(const G4Track* aTrack)
 {
    G4TrackVector* secondaries = fpTrackingManager->GimmeSecondaries();
-   if (secondaries) {
+   if (secondaries && ! fLazy) {
       GlueXUserTrackInformation* info = (GlueXUserTrackInformation*)
                                         aTrack->GetUserInformation();
       size_t nSeco = secondaries->size();
@@ -4,6 +4,13 @@
 // author: richard.t.jones at uconn.edu
 // version: september 23, 2016
 //
+// The TRAJECTORIES card in control.in chooses what trajectories are kept.
+// By default none are stored unless the visualization is active, since
+// nothing else in a batch job looks at them, and otherwise the setting
+// of /tracking/storeTrajectory is left alone. The compact modes give the
+// tracks a GlueXTrajectory instead of a G4Trajectory, either for all of
+// them or only for the primaries, with points thinned to a given spacing.
+//
 // In the context of the Geant4 event-level multithreading model,
 // this class is "thread-local", ie. has thread-local state.
 // Separate object instances are created for each worker thread.
@@ -22,6 +29,19 @@ class GlueXTrackingAction : public G4UserTrackingAction
    
    virtual void PreUserTrackingAction(const G4Track*);
    virtual void PostUserTrackingAction(const G4Track*);
+
+ private:
+   bool fLazy;      // share track information, see GlueXUserTrackInformation
+
+   enum {
+      kTrajectoryAuto,           // off unless the visualization is active
+      kTrajectoryOff,
+      kTrajectoryFull,           // G4Trajectory, or as set by /tracking
+      kTrajectoryCompact,        // GlueXTrajectory for every track
+      kTrajectoryPrimaries       // GlueXTrajectory for primary tracks only
+   };
+   int fTrajectoryMode;
+   double fTrajectoryThinning;   // least distance between points kept
 };
 
 #endif // _GLUEXTRACKINGACTION_
@@ -0,0 +1,50 @@
+//
+// GlueXTrajectory - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXTrajectory.hh"
+
+G4ThreadLocal G4Allocator<GlueXTrajectory> *GlueXTrajectoryAllocator = 0;
+
+GlueXTrajectory::GlueXTrajectory(const G4Track *track, double thinning)
+ : fTrackID(track->GetTrackID()),
+   fParentID(track->GetParentID()),
+   fParticle(track->GetDefinition()),
+   fMomentum(track->GetMomentum()),
+   fThinning2(thinning * thinning)
+{
+   fPoints.push_back(new G4TrajectoryPoint(track->GetPosition()));
+}
+
+GlueXTrajectory::~GlueXTrajectory()
+{
+   for (unsigned int i=0; i < fPoints.size(); ++i)
+      delete fPoints[i];
+}
+
+void GlueXTrajectory::AppendStep(const G4Step *step)
+{
+   const G4ThreeVector &pos = step->GetPostStepPoint()->GetPosition();
+   if ((pos - fPoints.back()->GetPosition()).mag2() >= fThinning2 ||
+       step->GetTrack()->GetTrackStatus() != fAlive)
+   {
+      fPoints.push_back(new G4TrajectoryPoint(pos));
+   }
+}
+
+void GlueXTrajectory::MergeTrajectory(G4VTrajectory *secondTrajectory)
+{
+   // The first point of the second trajectory is the last of this one.
+
+   if (secondTrajectory == 0)
+      return;
+   GlueXTrajectory *second = (GlueXTrajectory*)secondTrajectory;
+   for (unsigned int i=1; i < second->fPoints.size(); ++i)
+      fPoints.push_back(second->fPoints[i]);
+   if (second->fPoints.size() > 0) {
+      delete second->fPoints[0];
+      second->fPoints.clear();
+   }
+}
@@ -0,0 +1,86 @@
+//
+// GlueXTrajectory - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Compact trajectory, for jobs that need the trajectories of the tracks,
+// to draw them or to look at them in the event action, without paying
+// for a point at every step the way that G4Trajectory does. A new point
+// is only kept once the track has moved the given distance from the last
+// one kept, or at the end of the track, so a track that curls up in the
+// field keeps its shape but a shower does not leave a point for every
+// step of every electron. Only the initial momentum and the identity of
+// the particle are kept besides the points. It is selected with the
+// TRAJECTORIES card in control.in, see GlueXTrackingAction.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "thread-local", ie. has thread-local state.
+// Separate object instances are created for each worker thread,
+// taken from a thread-local G4Allocator.
+
+#ifndef GlueXTrajectory_h
+#define GlueXTrajectory_h 1
+
+#include "G4VTrajectory.hh"
+#include "G4TrajectoryPoint.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4Track.hh"
+#include "G4Step.hh"
+#include "G4Allocator.hh"
+
+#include <vector>
+
+class GlueXTrajectory : public G4VTrajectory
+{
+ public:
+   GlueXTrajectory(const G4Track *track, double thinning);
+   virtual ~GlueXTrajectory();
+
+   void *operator new(size_t);
+   void operator delete(void *traj);
+   int operator==(const GlueXTrajectory &right) const {
+      return (this == &right);
+   }
+
+   virtual G4int GetTrackID() const { return fTrackID; }
+   virtual G4int GetParentID() const { return fParentID; }
+   virtual G4String GetParticleName() const {
+      return fParticle->GetParticleName();
+   }
+   virtual G4double GetCharge() const { return fParticle->GetPDGCharge(); }
+   virtual G4int GetPDGEncoding() const {
+      return fParticle->GetPDGEncoding();
+   }
+   virtual G4ThreeVector GetInitialMomentum() const { return fMomentum; }
+
+   virtual int GetPointEntries() const { return fPoints.size(); }
+   virtual G4VTrajectoryPoint *GetPoint(G4int i) const { return fPoints[i]; }
+
+   virtual void AppendStep(const G4Step *step);
+   virtual void MergeTrajectory(G4VTrajectory *secondTrajectory);
+
+ private:
+   G4int fTrackID;
+   G4int fParentID;
+   const G4ParticleDefinition *fParticle;
+   G4ThreeVector fMomentum;
+   double fThinning2;             // square of the least distance kept
+   std::vector<G4TrajectoryPoint*> fPoints;
+};
+
+extern G4ThreadLocal G4Allocator<GlueXTrajectory> *GlueXTrajectoryAllocator;
+
+inline void* GlueXTrajectory::operator new(size_t)
+{
+   if (!GlueXTrajectoryAllocator)
+      GlueXTrajectoryAllocator = new G4Allocator<GlueXTrajectory>;
+   return (void *) GlueXTrajectoryAllocator->MallocSingle();
+}
+
+inline void GlueXTrajectory::operator delete(void *traj)
+{
+   GlueXTrajectoryAllocator->FreeSingle((GlueXTrajectory*) traj);
+}
+
+#endif
@@ -17,6 +17,7 @@
 #include <GlueXEventAction.hh>
 #include <GlueXTrackingAction.hh>
 #include <GlueXSteppingAction.hh>
+#include <GlueXStackingAction.hh>
 #include <GlueXSteppingVerbose.hh>
 
 class GlueXUserActionInitialization : public G4VUserActionInitialization
@@ -31,6 +32,7 @@ class GlueXUserActionInitialization : public G4VUserActionInitialization
       SetUserAction(new GlueXEventAction());
       SetUserAction(new GlueXTrackingAction());
       SetUserAction(new GlueXSteppingAction());
+      SetUserAction(new GlueXStackingAction());
       SetUserAction(new GlueXPrimaryGeneratorAction());
    }
 
@@ -7,14 +7,36 @@
 #include "GlueXUserEventInformation.hh"
 #include "GlueXPrimaryGeneratorAction.hh"
 #include "GlueXUserOptions.hh"
+#include "GlueXEventFilter.hh"
 #include "HddmOutput.hh"
+#include "HddmRecordPool.hh"
 #include "HddsG4Builder.hh"
 
+extern int run_number;
+
+bool GlueXUserEventInformation::fEventSeeding = false;
+long int GlueXUserEventInformation::fEventSeedBase = 0;
+long int GlueXUserEventInformation::fEventSeedOffset = 0;
+G4ThreadLocal long int GlueXUserEventInformation::fStartSeeds[2] = {0, 0};
+G4ThreadLocal bool GlueXUserEventInformation::fStartSeedsSet = false;
+
+static unsigned long long int splitmix64(unsigned long long int x)
+{
+   x += 0x9e3779b97f4a7c15ULL;
+   x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+   x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+   return x ^ (x >> 31);
+}
+
 GlueXUserEventInformation::GlueXUserEventInformation(hddm_s::HDDM *hddmevent)
- : fKeepEvent(true)
+ : fKeepEvent(true),
+   fFiltered(false),
+   fSerial(-1),
+   fSubEvent(0),
+   fSubEvents(1)
 {
    if (hddmevent == 0) {
-      fOutputRecord = new hddm_s::HDDM();
+      fOutputRecord = HddmRecordPool::Get();
       fNprimaries = 0;
    }
    else {
@@ -28,12 +50,62 @@ GlueXUserEventInformation::GlueXUserEventInformation(hddm_s::HDDM *hddmevent)
 GlueXUserEventInformation::GlueXUserEventInformation(int geanttype,
                                                      G4ThreeVector &pos, 
                                                      G4ThreeVector &mom)
- : fKeepEvent(true)
+ : fKeepEvent(true),
+   fFiltered(false),
+   fSerial(-1),
+   fSubEvent(0),
+   fSubEvents(1)
 {
-   fOutputRecord = new hddm_s::HDDM();
+   fOutputRecord = HddmRecordPool::Get();
+   hddm_s::PhysicsEventList pev = fOutputRecord->addPhysicsEvents();
+   hddm_s::ReactionList rea = pev(0).addReactions();
+   AddGunVertex(rea(0), geanttype, pos, mom, 1);
+   SetRandomSeeds();
+}
+
+GlueXUserEventInformation::GlueXUserEventInformation(int geanttype,
+                                       std::vector<G4ThreeVector> &pos,
+                                       std::vector<G4ThreeVector> &mom)
+ : fKeepEvent(true),
+   fFiltered(false),
+   fSerial(-1),
+   fSubEvent(0),
+   fSubEvents(1)
+{
+   // Record each particle from a multi-particle gun event as a separate
+   // vertex with a single product, numbered 1,2,... in the order they
+   // were fired, which is also the order of their Geant4 track ids.
+
+   fOutputRecord = HddmRecordPool::Get();
    hddm_s::PhysicsEventList pev = fOutputRecord->addPhysicsEvents();
    hddm_s::ReactionList rea = pev(0).addReactions();
-   hddm_s::VertexList ver = rea(0).addVertices();
+   for (unsigned int n=0; n < pos.size(); ++n)
+      AddGunVertex(rea(0), geanttype, pos[n], mom[n], n + 1);
+   SetRandomSeeds();
+}
+
+GlueXUserEventInformation::GlueXUserEventInformation(long int parent,
+                                                     int subevent,
+                                                     int subevents)
+ : fOutputRecord(0),
+   fKeepEvent(true),
+   fFiltered(false),
+   fNprimaries(0),
+   fSerial(parent),
+   fSubEvent(subevent),
+   fSubEvents(subevents)
+{
+   // The bundles after the first have no output record of their own,
+   // and their random engine is seeded by GlueXSubEvents.
+}
+
+void GlueXUserEventInformation::AddGunVertex(hddm_s::Reaction &reaction,
+                                             int geanttype,
+                                             const G4ThreeVector &pos,
+                                             const G4ThreeVector &mom,
+                                             int id)
+{
+   hddm_s::VertexList ver = reaction.addVertices();
    hddm_s::OriginList ori = ver(0).addOrigins();
    ori(0).setVx(pos[0]);
    ori(0).setVy(pos[1]);
@@ -41,7 +113,7 @@ GlueXUserEventInformation::GlueXUserEventInformation(int geanttype,
    hddm_s::ProductList pro = ver(0).addProducts();
    pro(0).setType((Particle_t)geanttype);
    pro(0).setPdgtype(GlueXPrimaryGeneratorAction::ConvertGeant3ToPdg(geanttype));
-   pro(0).setId(1);
+   pro(0).setId(id);
    pro(0).setParentid(0);
    pro(0).setMech(0);
    hddm_s::MomentumList pmo = pro(0).addMomenta();
@@ -50,33 +122,114 @@ GlueXUserEventInformation::GlueXUserEventInformation(int geanttype,
    pmo(0).setPz(mom[2]);
    double mass = GlueXPrimaryGeneratorAction::GetMass(geanttype) / GeV;
    pmo(0).setE(sqrt(mass*mass + mom[0]*mom[0] + mom[1]*mom[1] + mom[2]*mom[2]));
-   SetRandomSeeds();
 }
 
 GlueXUserEventInformation::~GlueXUserEventInformation()
 {
-   static bool geometry_record_written = false;
-   if (fOutputRecord != 0 && ! geometry_record_written) {
-      hddm_s::GeometryList geom = fOutputRecord->addGeometrys();
-      geom(0).setMd5simulation(last_md5_checksum);
-      geometry_record_written = true;
-   }
+   // The output takes over the record and writes it out in the
+   // background, see HddmOutput, after which it goes back to the pool.
+   // Below full truth output, the random seeds are left out, and for
+   // hits only so are the reactions with their vertices and products.
 
    if (fOutputRecord != 0 && fKeepEvent) {
-      hddm_s::PhysicsEvent &event = fOutputRecord->getPhysicsEvent(0);
-      event.setRunNo(HddmOutput::getRunNo());
-      if (event.getEventNo() == 0) {
-         int evno = HddmOutput::getEventNo();
-         event.setEventNo(++evno);
-         HddmOutput::setEventNo(evno);
+      int level = HddmOutput::getOutputLevel();
+      if (level < HddmOutput::OUTPUT_TRUTH &&
+          fOutputRecord->getPhysicsEvents().size() > 0)
+      {
+         hddm_s::PhysicsEvent &event = fOutputRecord->getPhysicsEvent(0);
+         if (level == HddmOutput::OUTPUT_HITS) {
+            event.deleteReactions();
+         }
+         else {
+            hddm_s::ReactionList rea = event.getReactions();
+            hddm_s::ReactionList::iterator iter;
+            for (iter = rea.begin(); iter != rea.end(); ++iter)
+               iter->deleteRandoms();
+         }
       }
-      HddmOutput::WriteOutputHDDM(*fOutputRecord);
-      delete fOutputRecord;
+      HddmOutput::WriteOutputHDDM(fOutputRecord, fSerial);
+   }
+   else {
+      HddmRecordPool::Release(fOutputRecord);
    }
 }
 
+hddm_s::HDDM *GlueXUserEventInformation::takeOutputRecord()
+{
+   hddm_s::HDDM *record = fOutputRecord;
+   fOutputRecord = 0;
+   return record;
+}
+
+void GlueXUserEventInformation::adoptOutputRecord(hddm_s::HDDM *record,
+                                                  bool keep)
+{
+   HddmRecordPool::Release(fOutputRecord);
+   fOutputRecord = record;
+   fKeepEvent = keep;
+   fFiltered = true;
+}
+
+bool GlueXUserEventInformation::getKeepEvent()
+{
+   if (! fFiltered) {
+      fFiltered = true;
+      fKeepEvent = GlueXEventFilter::AcceptEvent();
+   }
+   return fKeepEvent;
+}
+
+void GlueXUserEventInformation::SetEventSeeding(long int base,
+                                                long int offset)
+{
+   // Called once from the master thread before the run starts.
+
+   fEventSeeding = true;
+   fEventSeedBase = base;
+   fEventSeedOffset = offset;
+}
+
+void GlueXUserEventInformation::GetEventSeeds(int runno, long int eventno,
+                                              long int seed[2])
+{
+   // The seeds are a counter-based function of (base, run, event), made
+   // by chaining the splitmix64 finalizer over them, and reduced to the
+   // ranges of the two seeds of RanecuEngine.
+
+   unsigned long long int key = splitmix64(fEventSeedBase);
+   key = splitmix64(key ^ (unsigned long long int)runno);
+   key = splitmix64(key ^ (unsigned long long int)eventno);
+   seed[0] = 1 + splitmix64(key ^ 1) % 2147483562ULL;
+   seed[1] = 1 + splitmix64(key ^ 2) % 2147483398ULL;
+}
+
+void GlueXUserEventInformation::GetSubEventSeeds(const long int start[2],
+                                                 int subevent,
+                                                 long int seed[2])
+{
+   unsigned long long int key = splitmix64(fEventSeedBase);
+   key = splitmix64(key ^ (unsigned long long int)start[0]);
+   key = splitmix64(key ^ (unsigned long long int)start[1]);
+   key = splitmix64(key ^ (unsigned long long int)subevent);
+   seed[0] = 1 + splitmix64(key ^ 1) % 2147483562ULL;
+   seed[1] = 1 + splitmix64(key ^ 2) % 2147483398ULL;
+}
+
+bool GlueXUserEventInformation::SeedEvent(long int eventno)
+{
+   if (! fEventSeeding)
+      return false;
+   GetEventSeeds(run_number, eventno, fStartSeeds);
+   G4Random::setTheSeeds(fStartSeeds);
+   fStartSeedsSet = true;
+   return true;
+}
+
 void GlueXUserEventInformation::SetRandomSeeds()
 {
+   // Seeds found in the input record take precedence, otherwise the
+   // seeds that the event started with are recorded in the output.
+
    hddm_s::ReactionList rea = fOutputRecord->getReactions();
    hddm_s::RandomList rnd = rea(0).getRandoms();
    if (rnd.size() > 0) {
@@ -84,9 +237,12 @@ void GlueXUserEventInformation::SetRandomSeeds()
       seed[0] = rnd(0).getSeed1();
       seed[1] = rnd(0).getSeed2();
       G4Random::setTheSeeds(seed);
+      fStartSeedsSet = false;
    }
    else {
-      const long int *seed = G4Random::getTheSeeds();
+      const long int *seed = (fStartSeedsSet)? fStartSeeds :
+                                               G4Random::getTheSeeds();
+      fStartSeedsSet = false;
       rnd = rea(0).addRandoms();
       rnd(0).setSeed1(seed[0]);
       rnd(0).setSeed2(seed[1]);
@@ -28,19 +28,94 @@ class GlueXUserEventInformation: public G4VUserEventInformation
    GlueXUserEventInformation(hddm_s::HDDM *hddmevent=NULL);
    GlueXUserEventInformation(int geanttype, G4ThreeVector &pos, 
                                             G4ThreeVector &mom);
+   GlueXUserEventInformation(int geanttype, std::vector<G4ThreeVector> &pos,
+                                            std::vector<G4ThreeVector> &mom);
+   GlueXUserEventInformation(long int parent, int subevent, int subevents);
    ~GlueXUserEventInformation();
 
    void SetRandomSeeds();
    void Print() const;
 
+   // With the EVENTSEEDS card, the random engine of the thread running
+   // each event is seeded at the start of the event from a hash of the
+   // run number, the event number and a base seed, so that the event
+   // comes out the same whatever thread runs it, in whatever job. The
+   // event number is the number of the event in its job plus the offset
+   // given on the card, or the one in the input record. SeedEvent must
+   // be called before the first random number of the event is drawn, and
+   // returns false if per-event seeding is not enabled.
+   static void SetEventSeeding(long int base, long int offset);
+   static bool GetEventSeeding() {
+      return fEventSeeding;
+   }
+   static long int GetEventNumber(long int count) {
+      return count + fEventSeedOffset;
+   }
+   static void SetEventSeedOffset(long int offset) {
+      fEventSeedOffset = offset;
+   }
+   static bool SeedEvent(long int eventno);
+   static void GetEventSeeds(int runno, long int eventno, long int seed[2]);
+
+   // Seeds for bundle subevent of an event that started with seeds start,
+   // see GlueXSubEvents.
+   static void GetSubEventSeeds(const long int start[2], int subevent,
+                                long int seed[2]);
+
    hddm_s::HDDM *getOutputRecord() {
       return fOutputRecord;
    }
 
+   // position of the event in the input order, used to write the
+   // output events in the same order, see HddmOutput
+   void setSerialNumber(long int serial) {
+      fSerial = serial;
+   }
+   long int getSerialNumber() const {
+      return fSerial;
+   }
+
+   // With the SUBEVENTS card, an event may be tracked in several bundles
+   // of its primary vertices, see GlueXSubEvents. Each bundle has its own
+   // object with the serial number of the event, and the output record of
+   // the event is handed from the first bundle to the last one tracked,
+   // along with the decision of the event filters over all of them.
+   void setSubEvent(int subevent, int subevents) {
+      fSubEvent = subevent;
+      fSubEvents = subevents;
+   }
+   int getSubEvent() const {
+      return fSubEvent;
+   }
+   int getSubEvents() const {
+      return fSubEvents;
+   }
+   hddm_s::HDDM *takeOutputRecord();
+   void adoptOutputRecord(hddm_s::HDDM *record, bool keep);
+
+   // Whether the event is to be written to the output, decided by the
+   // event filters the first time it is asked, see GlueXEventFilter.
+   // This must only be called once the event has been tracked.
+   bool getKeepEvent();
+
  protected:
+   void AddGunVertex(hddm_s::Reaction &reaction, int geanttype,
+                     const G4ThreeVector &pos, const G4ThreeVector &mom,
+                     int id);
+
    hddm_s::HDDM *fOutputRecord;
    bool fKeepEvent;
+   bool fFiltered;
    int fNprimaries;
+   long int fSerial;
+   int fSubEvent;
+   int fSubEvents;
+
+   static bool fEventSeeding;
+   static long int fEventSeedBase;
+   static long int fEventSeedOffset;
+   static G4ThreadLocal long int fStartSeeds[2];
+   static G4ThreadLocal bool fStartSeedsSet;
 };
 
 #endif // _GLUEXUSEREVENTINFORMATION_
@@ -10,11 +10,128 @@
 #include <GlueXUserOptions.hh>
 #include <G4ios.hh>
 #include <unistd.h>
+#include <string.h>
+#include <ctype.h>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 
 G4Mutex GlueXUserOptions::fMutex = G4MUTEX_INITIALIZER;
 std::list<GlueXUserOptions*> GlueXUserOptions::fInstance;
+std::atomic<GlueXUserOptions*> GlueXUserOptions::fPrimary(0);
+
+// Table of the cards known to HDGeant4, with the kinds of their arguments,
+// one letter for each: n for a number, s for a string, which may be given
+// either quoted or bare, ending with * if the last kind may be repeated
+// for any number of further arguments. A card may always be given with
+// fewer arguments than are listed. Names ending with a colon are also
+// accepted with a suffix, as in SWIMTUNE:<region>. The geant3 cards at
+// the end are accepted for compatibility with old control.in files, but
+// are not used by HDGeant4. New cards need to be added here to have their
+// arguments checked. No card may start with C, because every line that
+// starts with c or C is a comment; ReadControl_in refuses a table that
+// has one, and the geant3 cards CKOV, COMP and CUTS are read as comments.
+
+struct card_schema_t {
+   const char *name;
+   const char *args;
+};
+
+static const card_schema_t card_schema[] = {
+   {"INFILE", "s"},
+   {"INFI", "s"},
+   {"INPREFETCH", "n"},
+   {"INSLICE", "nn"},
+   {"INFILTER", "snnnnnnn"},
+   {"SKIP", "n"},
+   {"TRIG", "n"},
+   {"RUNG", "n*"},
+   {"RUNNO", "n"},
+   {"BEAM", "nnnnnnn"},
+   {"BEAMFASTFWD", "n*"},
+   {"BEAMPOOL", "nn"},
+   {"BEAMPDFCACHE", "s"},
+   {"TREFSIGMA", "n"},
+   {"KINE", "n*"},
+   {"KINEMULT", "n*"},
+   {"SCAP", "nnn"},
+   {"TGTWIDTH", "n*"},
+   {"BGRATE", "n"},
+   {"BGGATE", "nn"},
+   {"BGLIBRARY", "s"},
+   {"BGRECORD", "sn"},
+   {"SUBEVENTS", "nn"},
+   {"OUTFILE", "s"},
+   {"OUTLEVEL", "n"},
+   {"OUTCOMPRESS", "ss"},
+   {"OUTWRITER", "nn"},
+   {"OUTSHARDS", "n*"},
+   {"POSTSMEAR", "n"},
+   {"DELETEUNSMEARED", "n"},
+   {"MCSMEAROPTS", "s"},
+   {"SAVEPOINT", "ns"},
+   {"RNDM", "nn"},
+   {"EVENTSEEDS", "nn"},
+   {"PINTHREADS", "sn"},
+   {"OVERLAPCHECK", "nns"},
+   {"TELEMETRY", "ns"},
+   {"STEPPROFILE", "n"},
+   {"STEPTRACE", "s*"},
+   {"TRACKINFO", "s"},
+   {"TRAJECTORIES", "s"},
+   {"TRUTHPOINTS", "n"},
+   {"DRIFTCLUSTERS", "n"},
+   {"KILLTIME", "n"},
+   {"KILLENERGY", "s*"},
+   {"KILLVOLUMES", "s*"},
+   {"FASTSHOWER", "s*"},
+   {"FASTSHOWERVALIDATE", "n"},
+   {"BFIELDMAP", "s"},
+   {"BFIELDTYPE", "s"},
+   {"BFIELDCACHE", "n"},
+   {"BFIELDRESAMPLE", "nnnnn"},
+   {"PSBFIELDMAP", "s"},
+   {"PSBFIELDTYPE", "s"},
+   {"PSBFIELDRESAMPLE", "n*"},
+   {"MAGFIELDSTORE", "sn"},
+   {"MAGFIELDCACHE", "n"},
+   {"SWIMTUNE:", "snnnn"},
+   {"SWIMBENCH", "nnnn"},
+   {"REGIONCUTS:", "nnnn"},
+   {"REGIONLIMITS:", "nnn"},
+   {"SMARTLESS:", "n"},
+   {"VOXELREPORT", "n"},
+   {"GEOMCACHE", "s"},
+   {"SUBSYSOMIT", "s*"},
+   {"SUBSYSENVELOPE", "s*"},
+   {"MERGELAYERS", "nn"},
+   {"LAYERREPORT", "nn"},
+   {"STRAWRINGS", "nn"},
+   {"TABLESNAPSHOT", "s"},
+   {"FILTERHITS", "sn"},
+   {"FILTERACCEPT", "sn"},
+   {"FILTEREDEP", "sn"},
+   {"END", ""},
+   // geant3 cards
+   {"ABAN", "s*"},
+   {"AUTO", "s*"},
+   {"BREM", "s*"},
+   {"DCAY", "s*"},
+   {"DEBU", "s*"},
+   {"DRAY", "s*"},
+   {"GELH", "s*"},
+   {"HADR", "s*"},
+   {"HALO", "s*"},
+   {"LABS", "s*"},
+   {"LOSS", "s*"},
+   {"MULS", "s*"},
+   {"NOSECONDARIES", "s*"},
+   {"PAIR", "s*"},
+   {"SAVEHITS", "s*"},
+   {"SHOWERSINCOL", "s*"},
+   {"SWIT", "s*"},
+   {0, 0}
+};
 
 GlueXUserOptions::GlueXUserOptions()
 {
@@ -32,6 +149,7 @@ GlueXUserOptions::GlueXUserOptions()
 
    G4AutoLock barrier(&fMutex);
    fInstance.push_back(this);
+   fPrimary = fInstance.front();
 }
 
 GlueXUserOptions::~GlueXUserOptions()
@@ -40,6 +158,7 @@ GlueXUserOptions::~GlueXUserOptions()
 
    G4AutoLock barrier(&fMutex);
    fInstance.remove(this);
+   fPrimary = (fInstance.size() > 0)? fInstance.front() : 0;
 }
 
 GlueXUserOptions::GlueXUserOptions(const GlueXUserOptions &src)
@@ -47,8 +166,9 @@ GlueXUserOptions::GlueXUserOptions(const GlueXUserOptions &src)
    // This is a thread-safe implementation of a copy constructor
 
    G4AutoLock barrier(&fMutex);
-   fKeyValue = src.fKeyValue;
+   fCards = src.fCards;
    fInstance.push_back(this);
+   fPrimary = fInstance.front();
 }
 
 GlueXUserOptions &GlueXUserOptions::operator=(const GlueXUserOptions &src)
@@ -56,7 +176,7 @@ GlueXUserOptions &GlueXUserOptions::operator=(const GlueXUserOptions &src)
    // This is a thread-safe implementation of an assignment operator
 
    G4AutoLock barrier(&fMutex);
-   fKeyValue = src.fKeyValue;
+   fCards = src.fCards;
    return *this;
 }
 
@@ -65,18 +185,33 @@ GlueXUserOptions *GlueXUserOptions::GetInstance()
    // Generally one only needs a single instance of this object
    // per process, and this static method lets any component in the
    // application obtain the primary instance, if any. If none has
-   // yet been constructed, it returns zero.
+   // yet been constructed, it returns zero. The primary instance is
+   // kept up to date by the constructors and the destructor, so that
+   // looking it up does not need to take the lock.
 
-   if (fInstance.size() > 0)
-      return *fInstance.begin();
-   else
-      return 0;
+   return fPrimary.load(std::memory_order_acquire);
 }
 
 int GlueXUserOptions::ReadControl_in(const char *ctrlin)
 {
    // Opens a geant3-style (FFREAD) input control file (default name
-   // control.in) and stores its contents as key/value pairs.
+   // control.in) and parses its cards into the values returned by Find.
+   // Lines that are blank, or that start with c or C, are comments.
+   // Cards that are not known get a warning and are kept with all of
+   // their arguments as strings. The return value is the number of cards
+   // read, or zero if the file cannot be opened or any known card is
+   // malformed.
+
+   for (int i=0; card_schema[i].name; ++i) {
+      if (card_schema[i].name[0] == 'c' || card_schema[i].name[0] == 'C') {
+         G4cerr << "Error in GlueXUserOptions::ReadControl_in: "
+                << "card " << card_schema[i].name << " in the table of "
+                << "known cards starts with C and would be read as a "
+                << "comment, cannot continue."
+                << G4endl;
+         return 0;
+      }
+   }
 
    std::ifstream fin(ctrlin);
    if (!fin.good()) {
@@ -87,211 +222,224 @@ int GlueXUserOptions::ReadControl_in(const char *ctrlin)
    }
 
    G4AutoLock barrier(&fMutex);
-  
+
    int ncards = 0;
-   char card[9999];
-   while (fin.getline(card, 9999).good()) {
-      std::string cards(card);
-      size_t strt = cards.find_first_not_of(" ");
-      if (strt == cards.npos) {
+   int nerrors = 0;
+   int nline = 0;
+   std::string cards;
+   while (std::getline(fin, cards)) {
+      ++nline;
+      size_t strt = cards.find_first_not_of(" \t\r");
+      if (strt == cards.npos || cards[strt] == 'c' || cards[strt] == 'C') {
          continue;
       }
-      else if (cards[strt] == 'c' || cards[strt] == 'C') {
-         continue;
+      size_t stop = cards.find_first_of(" \t\r", strt);
+      std::string key(askey(cards.substr(strt, stop - strt)));
+      const char *kinds = ArgKinds(key);
+      if (kinds == 0) {
+         G4cerr << "Warning in GlueXUserOptions::ReadControl_in: "
+                << ctrlin << " line " << nline
+                << ": unknown card " << key << ", not checked"
+                << G4endl;
+         kinds = "s*";
       }
-      size_t stop = cards.substr(strt).find_first_of(" ");
-      if (stop == cards.npos) {
-         std::string key(askey(cards.substr(strt)));
-         fKeyValue[key] = ".TRUE.";
+      std::string args;
+      if (stop != cards.npos)
+         args = cards.substr(stop);
+      card_t card;
+      std::string error;
+      if (! Parse(kinds, args, card, error)) {
+         G4cerr << "Error in GlueXUserOptions::ReadControl_in: "
+                << ctrlin << " line " << nline
+                << ": card " << key << " " << error
+                << G4endl;
+         ++nerrors;
          continue;
       }
-      else {
-         std::string key(askey(cards.substr(strt, stop - strt)));
-         size_t args = strt + stop;
-         size_t argo = cards.substr(args).find_first_not_of(" ");
-         if (argo == cards.npos) {
-            fKeyValue[key] = ".TRUE.";
-         }
-         else {
-            fKeyValue[key] = cards.substr(args + argo);
-         }
-      }
+      fCards[key] = card;
       ++ncards;
    }
-   return ncards;
+   return (nerrors > 0)? 0 : ncards;
 }
 
-int GlueXUserOptions::Find(const char *name, 
-                           std::map<int, std::string> &value) const
+const char *GlueXUserOptions::ArgKinds(const std::string &key)
 {
-   // Look up name in the options key/value table and, if found, break
-   // up the value string into tokens and return them as a map from
-   // field number to string value. Return value is 1 (found) or 0
-   // (not found).
-
-   std::map<std::string, std::string>::const_iterator item =
-                                       fKeyValue.find(askey(name));
-   if (item == fKeyValue.end()) {
-      return 0;
+   // Look up the card in the table of known cards and return the kinds
+   // of its arguments, or zero if it is unknown.
+
+   for (int i=0; card_schema[i].name; ++i) {
+      const char *name = card_schema[i].name;
+      size_t len = strlen(name);
+      if (name[len - 1] == ':') {
+         if (key.compare(0, len - 1, name, len - 1) == 0 &&
+             (key.size() == len - 1 || (key.size() > len && key[len - 1] == ':')))
+         {
+            return card_schema[i].args;
+         }
+      }
+      else if (key == name) {
+         return card_schema[i].args;
+      }
    }
+   return 0;
+}
+
+bool GlueXUserOptions::Parse(const char *kinds, const std::string &args,
+                             card_t &card, std::string &error)
+{
+   // Break up the arguments of a card into fields, numbered from 1, and
+   // check them against the kinds of arguments the card takes. A field
+   // is either a string in single quotes or a token ending at the next
+   // blank, and may be preceded by N= to give its field number, or by
+   // n* to repeat it n times. Every field goes into the string values
+   // of the card, and those that are not quoted and start with the text
+   // of a number also go into its double and int values, the int value
+   // of a field that is all one number being that number truncated, so
+   // that 1e6 and 08 both come out as written. A card with no arguments
+   // has the single string value .TRUE. as in FFREAD.
+
+   size_t nkinds = strlen(kinds);
+   bool repeats = (nkinds > 0 && kinds[nkinds - 1] == '*');
+   if (repeats)
+      --nkinds;
 
-   std::string args(item->second);
-   value.clear();
-   size_t p=0;
-   int narg=1;
-   while (p != args.npos) {
-      size_t pfin;
-      pfin = args.substr(p).find_first_not_of(" ");
-      if (pfin == args.npos) {
+   const char *p = args.c_str();
+   int narg = 1;
+   while (true) {
+      while (*p == ' ' || *p == '\t' || *p == '\r')
+         ++p;
+      if (*p == 0)
          break;
+      const char *q = p;
+      while (isdigit(*q))
+         ++q;
+      if (q > p && *q == '=') {
+         narg = atoi(p);
+         if (narg < 1) {
+            error = "has a bad field number in " + args.substr(p - args.c_str());
+            return false;
+         }
+         p = q + 1;
+         for (q = p; isdigit(*q); ++q) {}
       }
-      p += pfin;
-      pfin = args.substr(p).find_first_not_of("0123456789");
-      if (pfin != args.npos && pfin > 0 && args[p + pfin] == '=') {
-         std::string substr(args.substr(p, pfin));
-         narg = atoi(substr.c_str());
-         p += pfin + 1;
-         pfin = args.substr(p).find_first_not_of("0123456789");
-      }
-      int nrep=1;
-      if (pfin != args.npos && pfin > 0 && args[p + pfin] == '*') {
-         std::string substr(args.substr(p, pfin));
-         nrep = atoi(substr.c_str());
-         p += pfin + 1;
+      int nrep = 1;
+      if (q > p && *q == '*') {
+         nrep = atoi(p);
+         p = q + 1;
       }
-      if (args[p] == '\'') {
-         pfin = args.substr(p + 1).find_first_of("'");
-         for (int rep=0; rep < nrep; ++rep, ++narg) {
-            value[narg] = args.substr(p + 1, pfin);
+      std::string value;
+      bool quoted = (*p == '\'');
+      if (quoted) {
+         const char *end = strchr(p + 1, '\'');
+         if (end == 0) {
+            error = "has an unterminated string " + std::string(p);
+            return false;
+         }
+         value.assign(p + 1, end);
+         p = end + 1;
+         if (*p != 0 && *p != ' ' && *p != '\t' && *p != '\r') {
+            error = "has no blank after the string '" + value + "'";
+            return false;
          }
       }
       else {
-         pfin = args.substr(p).find_first_of(" ");
-         for (int rep=0; rep < nrep; ++rep, ++narg) {
-            value[narg] = args.substr(p, pfin);
-         }
+         const char *end = p;
+         while (*end != 0 && *end != ' ' && *end != '\t' && *end != '\r')
+            ++end;
+         value.assign(p, end);
+         p = end;
       }
-      if (pfin == args.npos) {
-         break;
+
+      char *dend;
+      double dval = strtod(value.c_str(), &dend);
+      bool isdouble = (! quoted && dend > value.c_str());
+      bool isnumber = (isdouble && *dend == 0);
+      char *iend;
+      long int ival = strtol(value.c_str(), &iend, 10);
+      bool isint = (! quoted && iend > value.c_str());
+      if (isnumber && dval > -2147483648. && dval < 2147483648.) {
+         ival = (long int)dval;
+         isint = true;
       }
-      else {
-         p += pfin + 1;
+      for (int rep=0; rep < nrep; ++rep, ++narg) {
+         size_t n = narg;
+         char kind = (n <= nkinds)? kinds[n - 1] :
+                     (repeats)? kinds[nkinds - 1] : 0;
+         std::stringstream field;
+         field << narg;
+         if (kind == 0) {
+            error = "has too many arguments, field " + field.str() +
+                    " is " + value;
+            return false;
+         }
+         else if (kind == 'n' && ! isnumber) {
+            error = "needs a number for field " + field.str() +
+                    ", found " + ((quoted)? "'" + value + "'" : value);
+            return false;
+         }
+         card.strings[narg] = value;
+         if (isdouble)
+            card.doubles[narg] = dval;
+         if (isint)
+            card.ints[narg] = ival;
       }
    }
-   return 1;
+   if (narg == 1)
+      card.strings[1] = ".TRUE.";
+   return true;
 }
 
-int GlueXUserOptions::Find(const char *name, 
-                           std::map<int, double> &value) const
+const GlueXUserOptions::card_t *GlueXUserOptions::Lookup(const char *name)
+                                                         const
 {
-   // Look up name in the options key/value table and, if found, break
-   // up the value into tokens and return them as a map from field number
-   // to double. If the field does not contain a textual representation
-   // of double then it is not saved in the map. Return value is 1 (found)
+   std::map<std::string, card_t>::const_iterator item =
+                                 fCards.find(askey(name));
+   if (item == fCards.end())
+      return 0;
+   return &item->second;
+}
+
+int GlueXUserOptions::Find(const char *name,
+                           std::map<int, std::string> &value) const
+{
+   // Look up name in the options table and, if found, return its fields
+   // as a map from field number to string value. Return value is 1 (found)
    // or 0 (not found).
 
-   std::map<std::string, std::string>::const_iterator item =
-                                       fKeyValue.find(askey(name));
-   if (item == fKeyValue.end()) {
+   const card_t *card = Lookup(name);
+   if (card == 0)
       return 0;
-   }
+   value = card->strings;
+   return 1;
+}
 
-   std::string args(item->second);
-   value.clear();
-   size_t p=0;
-   int narg=1;
-   while (p != args.npos) {
-      size_t pfin;
-      pfin = args.substr(p).find_first_not_of(" ");
-      if (pfin == args.npos) {
-         break;
-      }
-      p += pfin;
-      pfin = args.substr(p).find_first_not_of("0123456789");
-      if (pfin != args.npos && pfin > 0 && args[p + pfin] == '=') {
-         std::string substr(args.substr(p, pfin));
-         narg = atoi(substr.c_str());
-         p = pfin + 1;
-         pfin = args.substr(p).find_first_not_of("0123456789");
-      }
-      int nrep=1;
-      if (pfin != args.npos && pfin > 0 && args[p + pfin] == '*') {
-         std::string substr(args.substr(p, pfin));
-         nrep = atoi(substr.c_str());
-         p += pfin + 1;
-      }
-      char *end;
-      std::string subarg(args.substr(p));
-      const char *start = subarg.c_str();
-      double dval = strtod(start, &end);
-      if (end > start) {
-         for (int rep=0; rep < nrep; ++rep, ++narg) {
-            value[narg] = dval;
-         }
-         p += end - start;
-      }
-      else {
-         pfin = args.substr(p).find_first_of(" ");
-         p = (pfin == args.npos)? pfin : p + pfin;
-      }
-   }
+int GlueXUserOptions::Find(const char *name,
+                           std::map<int, double> &value) const
+{
+   // Look up name in the options table and, if found, return its fields
+   // as a map from field number to double. If the field does not contain
+   // a textual representation of double then it is not saved in the map.
+   // Return value is 1 (found) or 0 (not found).
+
+   const card_t *card = Lookup(name);
+   if (card == 0)
+      return 0;
+   value = card->doubles;
    return 1;
 }
 
 int GlueXUserOptions::Find(const char *name,
                            std::map<int, int> &value) const
 {
-   // Look up name in the options key/value table and, if found, break
-   // up the value into tokens and return them as a map from field number
-   // to int. If the field does not contain a textual representation
-   // of int then it is not saved in the map. Return value is 1 (found)
-   // or 0 (not found).
+   // Look up name in the options table and, if found, return its fields
+   // as a map from field number to int. If the field does not contain
+   // a textual representation of int then it is not saved in the map.
+   // Return value is 1 (found) or 0 (not found).
 
-   std::map<std::string, std::string>::const_iterator item =
-                                       fKeyValue.find(askey(name));
-   if (item == fKeyValue.end()) {
+   const card_t *card = Lookup(name);
+   if (card == 0)
       return 0;
-   }
-
-   std::string args(item->second);
-   value.clear();
-   size_t p=0;
-   int narg=1;
-   while (p != args.npos) {
-      size_t pfin;
-      pfin = args.substr(p).find_first_not_of(" ");
-      if (pfin == args.npos) {
-         break;
-      }
-      p += pfin;
-      pfin = args.substr(p).find_first_not_of("0123456789");
-      if (pfin != args.npos && pfin > 0 && args[p + pfin] == '=') {
-         std::string substr(args.substr(p, pfin));
-         narg = atoi(substr.c_str());
-         p += pfin + 1;
-         pfin = args.substr(p).find_first_not_of("0123456789");
-      }
-      int nrep=1;
-      if (pfin != args.npos && pfin > 0 && args[p + pfin] == '*') {
-         std::string substr(args.substr(p, pfin));
-         nrep = atoi(substr.c_str());
-         p += pfin + 1;
-      }
-      char *end;
-      std::string subarg(args.substr(p));
-      const char *start = subarg.c_str();
-      double ival = strtol(start, &end, 0);
-      if (end != start) {
-         for (int rep=0; rep < nrep; ++rep, ++narg) {
-            value[narg] = ival;
-         }
-         p += end - start;
-      }
-      else {
-         pfin = args.substr(p).find_first_of(" ");
-         p = (pfin == args.npos)? pfin : p + pfin;
-      }
-   }
+   value = card->ints;
    return 1;
 }
 
@@ -4,8 +4,21 @@
 // author: richard.t.jones at uconn.edu
 // version: may 28, 2015
 //
+// The cards are parsed once, as they are read by ReadControl_in(), into
+// the string, double and int values that are returned by Find(), so that
+// looking up a card does no parsing and takes no lock. Each card is also
+// checked as it is read against the table of the cards known to HDGeant4
+// at the top of GlueXUserOptions.cc, which gives the kind of each of its
+// arguments, and ReadControl_in() reports every known card that has the
+// wrong arguments and returns zero if it finds any, so that a mistyped
+// value stops the job at startup instead of being silently ignored.
+// Cards that are not in the table, such as the geant3 cards that older
+// control.in files carry, are kept as strings with a warning.
+//
 // In the context of the Geant4 event-level multithreading model,
-// this class is "shared", ie. has no thread-local state.
+// this class is "shared", ie. has no thread-local state. The cards
+// are read before any worker threads are started, and are not changed
+// after that, so any thread can look them up without locking.
 
 #ifndef _GLUEXUSEROPTIONS_
 #define _GLUEXUSEROPTIONS_
@@ -14,6 +27,7 @@
 #include <string>
 #include <list>
 #include <map>
+#include <atomic>
 
 #include "G4Threading.hh"
 #include "G4AutoLock.hh"
@@ -40,11 +54,23 @@ class GlueXUserOptions
    int Find(const char *name, std::map<int, int> &value) const;
 
  private:
+   struct card_t {
+      std::map<int, std::string> strings;
+      std::map<int, double> doubles;
+      std::map<int, int> ints;
+   };
+
    std::string askey(const std::string name) const;
+   const card_t *Lookup(const char *name) const;
+
+   static const char *ArgKinds(const std::string &key);
+   static bool Parse(const char *kinds, const std::string &args,
+                     card_t &card, std::string &error);
 
    static G4Mutex fMutex;
    static std::list<GlueXUserOptions*> fInstance;
-   std::map<std::string, std::string> fKeyValue;
+   static std::atomic<GlueXUserOptions*> fPrimary;
+   std::map<std::string, card_t> fCards;
 };
 
 #endif
@@ -0,0 +1,73 @@
+//
+// GlueXUserTrackInformation class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXUserTrackInformation.hh"
+
+G4ThreadLocal G4Allocator<GlueXUserTrackInformation>*
+              GlueXUserTrackInformationAllocator = 0;
+
+G4ThreadLocal GlueXUserTrackInformation::shared_table_t
+*GlueXUserTrackInformation::fShared = 0;
+
+GlueXUserTrackInformation::shared_table_t *
+GlueXUserTrackInformation::GetSharedTable()
+{
+   if (fShared == 0)
+      fShared = new shared_table_t;
+   return fShared;
+}
+
+void GlueXUserTrackInformation::BeginOfEvent()
+{
+   // The table is emptied, and the objects in it released, at the start
+   // of every G4Event, including the bundles of an event split up by
+   // GlueXSubEvents, which carry the event id of the event they belong
+   // to, so that the track ids of one are never taken for the other.
+
+   if (fShared == 0)
+      return;
+   for (unsigned int i=0; i < fShared->owned.size(); ++i)
+      delete fShared->owned[i];
+   fShared->owned.clear();
+   fShared->byTrack.clear();
+}
+
+void GlueXUserTrackInformation::Share(const G4Track *trk)
+{
+   if (trk->GetUserInformation())
+      return;
+   shared_table_t *table = GetSharedTable();
+   int id = trk->GetTrackID();
+   if (id >= (int)table->byTrack.size())
+      table->byTrack.resize(id + 1, 0);
+   if (table->byTrack[id])
+      return;
+   int parent = trk->GetParentID();
+   GlueXUserTrackInformation *info = 0;
+   if (parent > 0 && parent < (int)table->byTrack.size())
+      info = table->byTrack[parent];
+   if (info == 0) {
+      info = new GlueXUserTrackInformation(trk);
+      table->owned.push_back(info);
+   }
+   table->byTrack[id] = info;
+}
+
+GlueXUserTrackInformation *
+GlueXUserTrackInformation::Detach(const G4Track *trk)
+{
+   G4VUserTrackInformation *own = trk->GetUserInformation();
+   if (own)
+      return (GlueXUserTrackInformation*)own;
+   GlueXUserTrackInformation *shared = Get(trk);
+   if (shared == 0)
+      return 0;
+   shared_table_t *table = GetSharedTable();
+   GlueXUserTrackInformation *info = new GlueXUserTrackInformation(shared);
+   table->owned.push_back(info);
+   table->byTrack[trk->GetTrackID()] = info;
+   return info;
+}
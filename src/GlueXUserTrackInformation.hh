@@ -4,6 +4,21 @@
 // author: richard.t.jones at uconn.edu
 // version: aug 1, 2015
 //
+// Every track carries the GlueX track id and history of the primary it
+// descends from. The objects are taken from a thread-local G4Allocator,
+// as are the CDC hits, since a new one is made for each secondary of
+// every track, which can be millions of them in an event with showers.
+//
+// With the card TRACKINFO 'lazy' in control.in, secondaries are given no
+// object of their own. The object of each primary is kept in a per-event
+// table, indexed by the Geant4 track id, which is filled in for each
+// secondary as it starts to be tracked with the same object as its
+// parent, and all of them are released together at the start of the
+// next event. Code that needs to change the information of a track,
+// without changing it for its ancestors or its other descendants, first
+// takes a copy of its own with Detach(). In either mode, the information
+// of a track is to be found with Get(), not from G4Track directly.
+//
 // In the context of the Geant4 event-level multithreading model,
 // this class is "thread-local", ie. has thread-local state.
 // Separate object instances are created for each worker thread.
@@ -13,11 +28,14 @@
 
 #include "G4VUserTrackInformation.hh"
 #include "G4Track.hh"
+#include "G4Allocator.hh"
+
+#include <vector>
 
 class GlueXUserTrackInformation: public G4VUserTrackInformation
 {
  public:
-   GlueXUserTrackInformation() 
+   GlueXUserTrackInformation()
    : fGlueXTrackID(0), fGlueXHistory(0)
    {}
 
@@ -30,6 +48,9 @@ class GlueXUserTrackInformation: public G4VUserTrackInformation
      fGlueXHistory(info->GetGlueXHistory())
    {}
 
+   void *operator new(size_t);
+   void operator delete(void *info);
+
    int GetGlueXTrackID() { return fGlueXTrackID; }
    int GetGlueXHistory() { return fGlueXHistory; }
 
@@ -45,9 +66,54 @@ class GlueXUserTrackInformation: public G4VUserTrackInformation
              << ", history=" << fGlueXHistory << G4endl;
    }
 
+   // information of a track, whether its own or shared in lazy mode
+   static GlueXUserTrackInformation *Get(const G4Track *trk);
+   // information of a track that it does not share with any other
+   static GlueXUserTrackInformation *Detach(const G4Track *trk);
+   // enter a track in the table of the lazy mode, as it starts
+   static void Share(const G4Track *trk);
+   // empty the table of the lazy mode, at the start of each G4Event
+   static void BeginOfEvent();
+
  private:
    int fGlueXTrackID;
    int fGlueXHistory;
+
+   struct shared_table_t {
+      std::vector<GlueXUserTrackInformation*> byTrack;
+      std::vector<GlueXUserTrackInformation*> owned;
+   };
+   static G4ThreadLocal shared_table_t *fShared;
+   static shared_table_t *GetSharedTable();
 };
 
+extern G4ThreadLocal G4Allocator<GlueXUserTrackInformation>*
+                     GlueXUserTrackInformationAllocator;
+
+inline void* GlueXUserTrackInformation::operator new(size_t)
+{
+   if (!GlueXUserTrackInformationAllocator)
+      GlueXUserTrackInformationAllocator =
+                               new G4Allocator<GlueXUserTrackInformation>;
+   return (void *) GlueXUserTrackInformationAllocator->MallocSingle();
+}
+
+inline void GlueXUserTrackInformation::operator delete(void *info)
+{
+   GlueXUserTrackInformationAllocator->FreeSingle(
+                                 (GlueXUserTrackInformation*) info);
+}
+
+inline GlueXUserTrackInformation *
+GlueXUserTrackInformation::Get(const G4Track *trk)
+{
+   G4VUserTrackInformation *info = trk->GetUserInformation();
+   if (info)
+      return (GlueXUserTrackInformation*)info;
+   int id = trk->GetTrackID();
+   if (fShared && id < (int)fShared->byTrack.size())
+      return fShared->byTrack[id];
+   return 0;
+}
+
 #endif // _GLUEXUSERTRACKINFORMATION_
@@ -0,0 +1,41 @@
+//
+// GlueXUserWorkerInitialization - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Pins each worker thread to its cpu as it starts, according to the
+// placement policy set in GlueXThreadAffinity, before the worker builds
+// its copies of the geometry, fields and physics tables.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state.
+
+#ifndef _GlueXUserWorkerInitialization_
+#define _GlueXUserWorkerInitialization_
+
+#include <G4UserWorkerInitialization.hh>
+#include <G4Threading.hh>
+#include <G4ios.hh>
+
+#include <GlueXThreadAffinity.hh>
+
+class GlueXUserWorkerInitialization : public G4UserWorkerInitialization
+{
+ public:
+
+   GlueXUserWorkerInitialization() {}
+   ~GlueXUserWorkerInitialization() {}
+
+   virtual void WorkerInitialize() const {
+      int thread = G4Threading::G4GetThreadId();
+      int cpu = GlueXThreadAffinity::PinThread(thread);
+      if (cpu >= 0) {
+         G4cout << "worker thread " << thread << " pinned to cpu " << cpu
+                << " on NUMA node " << GlueXThreadAffinity::GetNode()
+                << G4endl;
+      }
+   }
+};
+
+#endif // _GlueXUserWorkerInitialization_
@@ -0,0 +1,95 @@
+//
+// GlueXVolumeIdentifiers - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXVolumeIdentifiers.hh"
+#include "HddsG4Builder.hh"
+
+#include "G4LogicalVolumeStore.hh"
+#include "G4ios.hh"
+
+int GlueXVolumeIdentifiers::fBuilt = 0;
+std::map<std::string, int> GlueXVolumeIdentifiers::fKeys;
+std::vector<int> GlueXVolumeIdentifiers::fVolumeFirst;
+std::vector<int> GlueXVolumeIdentifiers::fVolumeCount;
+std::vector<GlueXVolumeIdentifiers::ident_entry_t>
+                                   GlueXVolumeIdentifiers::fEntries;
+std::vector<int> GlueXVolumeIdentifiers::fValues;
+
+G4Mutex GlueXVolumeIdentifiers::fMutex = G4MUTEX_INITIALIZER;
+
+void GlueXVolumeIdentifiers::Build(const HddsG4Builder *builder)
+{
+   // Copy the identifier lists that the builder attached to each HDDS
+   // volume into the table, indexed by the instance id of every logical
+   // volume in the store that was created from it. This only happens
+   // once, the first time it is called for a geometry. The HDDS volume
+   // of each logical volume is found from the inverse index kept by the
+   // builder. Volumes that the builder adds to the geometry after it is
+   // translated, like the envelopes of straw rings, have no identifiers.
+
+   G4AutoLock barrier(&fMutex);
+   if (fBuilt)
+      return;
+
+   G4LogicalVolumeStore *store = G4LogicalVolumeStore::GetInstance();
+   G4LogicalVolumeStore::const_iterator iter;
+   int max_lvid = -1;
+   for (iter = store->begin(); iter != store->end(); ++iter) {
+      int lvid = (*iter)->GetInstanceID();
+      max_lvid = (lvid > max_lvid)? lvid : max_lvid;
+   }
+   fVolumeFirst.assign(max_lvid + 1, 0);
+   fVolumeCount.assign(max_lvid + 1, 0);
+
+   for (iter = store->begin(); iter != store->end(); ++iter) {
+      int lvid = (*iter)->GetInstanceID();
+      int volId, layer;
+      if (! builder->findVolume(*iter, volId, layer))
+         continue;
+      std::map<int, std::map<std::string, std::vector<int> > >::iterator
+         volume = Refsys::fIdentifierTable.find(volId);
+      if (volume == Refsys::fIdentifierTable.end())
+         continue;
+      fVolumeFirst[lvid] = fEntries.size();
+      std::map<std::string, std::vector<int> >::iterator ident;
+      for (ident = volume->second.begin();
+           ident != volume->second.end(); ++ident)
+      {
+         int key = fKeys.size();
+         if (fKeys.find(ident->first) == fKeys.end())
+            fKeys[ident->first] = key;
+         else
+            key = fKeys[ident->first];
+         ident_entry_t entry;
+         entry.key = key;
+         entry.first = fValues.size();
+         entry.count = ident->second.size();
+         fValues.insert(fValues.end(), ident->second.begin(),
+                                       ident->second.end());
+         fEntries.push_back(entry);
+      }
+      fVolumeCount[lvid] = fEntries.size() - fVolumeFirst[lvid];
+   }
+   if (fEntries.size() == 0)
+      fEntries.resize(1);  // so that &fEntries[first] is always valid
+   fBuilt = 1;
+}
+
+int GlueXVolumeIdentifiers::GetKey(const std::string &identifier)
+{
+   // Return the interned key for the named identifier, or -1 if it is
+   // not defined on any volume in the geometry.
+
+   G4AutoLock barrier(&fMutex);
+   if (! fBuilt) {
+      G4cerr << "GlueXVolumeIdentifiers::GetKey error - "
+             << "called before the identifier table was built, "
+             << "cannot continue." << G4endl;
+      exit(1);
+   }
+   std::map<std::string, int>::iterator iter = fKeys.find(identifier);
+   return (iter == fKeys.end())? -1 : iter->second;
+}
@@ -0,0 +1,86 @@
+//
+// GlueXVolumeIdentifiers - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// This class resolves the HDDS identifiers (ring, sector, module, ...)
+// of a touchable from a flat table that is built once from the geometry
+// at ConstructSDandField time, instead of walking through string-keyed
+// maps and reverse-searching the builder's volume list on every step.
+// Identifier names are interned into small integer keys, which the
+// sensitive detectors look up once at construction time.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. The table
+// is filled under a lock by the first thread to call Build(), and is
+// read-only from then on.
+
+#ifndef GlueXVolumeIdentifiers_h
+#define GlueXVolumeIdentifiers_h 1
+
+#include "G4LogicalVolume.hh"
+#include "G4VTouchable.hh"
+#include "GlueXStrawRing.hh"
+#include "G4Threading.hh"
+#include "G4AutoLock.hh"
+
+#include <vector>
+#include <string>
+#include <map>
+
+class HddsG4Builder;
+
+class GlueXVolumeIdentifiers
+{
+ public:
+   static void Build(const HddsG4Builder *builder);
+   static int GetKey(const std::string &identifier);
+   static int GetIdent(int key, const G4VTouchable *touch);
+
+ private:
+   GlueXVolumeIdentifiers() {}
+
+   struct ident_entry_t {
+      int key;                // interned identifier name
+      int first;              // index of first value in fValues
+      int count;              // number of values, one per copy number
+   };
+
+   static int fBuilt;
+   static std::map<std::string, int> fKeys;
+   static std::vector<int> fVolumeFirst;   // by logical volume instance id,
+   static std::vector<int> fVolumeCount;   // the range of its entries
+   static std::vector<ident_entry_t> fEntries;
+   static std::vector<int> fValues;
+
+   static G4Mutex fMutex;
+};
+
+inline int GlueXVolumeIdentifiers::GetIdent(int key, const G4VTouchable *touch)
+{
+   // Return the value of identifier key for the innermost volume in the
+   // touchable history that defines it, or -1 if none does.
+
+   int max_depth = touch->GetHistoryDepth();
+   for (int depth = 0; depth < max_depth; ++depth) {
+      G4VPhysicalVolume *pvol = touch->GetVolume(depth);
+      int lvid = pvol->GetLogicalVolume()->GetInstanceID();
+      if (lvid >= (int)fVolumeFirst.size())
+         continue;
+      const ident_entry_t *entry = &fEntries[fVolumeFirst[lvid]];
+      const ident_entry_t *end = entry + fVolumeCount[lvid];
+      for (; entry != end; ++entry) {
+         if (entry->key == key) {
+            int copy = (pvol->IsReplicated())?
+                       GlueXStrawRing::GetCopyNumber(touch, depth) - 1 :
+                       pvol->GetCopyNo() - 1;
+            return (copy >= 0 && copy < entry->count)?
+                   fValues[entry->first + copy] : -1;
+         }
+      }
+   }
+   return -1;
+}
+
+#endif
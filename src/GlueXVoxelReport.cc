@@ -0,0 +1,89 @@
+//
+// GlueXVoxelReport - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "GlueXVoxelReport.hh"
+
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4SmartVoxelHeader.hh"
+#include "G4SmartVoxelStat.hh"
+#include "G4Timer.hh"
+#include "G4ios.hh"
+#include "voxeldefs.hh"
+
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+static bool slower(const G4SmartVoxelStat &a, const G4SmartVoxelStat &b)
+{
+   return a.GetTotalTime() > b.GetTotalTime();
+}
+
+void GlueXVoxelReport::Print(int nvolumes)
+{
+   // Build the voxels of every volume that Geant4 would voxelize when
+   // the geometry is closed, and print the nvolumes of them that took
+   // the longest to build, followed by the totals for all of them.
+
+   G4LogicalVolumeStore *store = G4LogicalVolumeStore::GetInstance();
+   std::vector<G4SmartVoxelStat> stats;
+   G4Timer timer;
+   for (unsigned int n=0; n < store->size(); ++n) {
+      G4LogicalVolume *lvol = (*store)[n];
+      int ndaughters = lvol->GetNoDaughters();
+      if ((lvol->IsToOptimise() && ndaughters >= kMinVoxelVolumesLevel1) ||
+          (ndaughters == 1 && lvol->GetDaughter(0)->IsReplicated() &&
+           lvol->GetDaughter(0)->GetRegularStructureId() != 1))
+      {
+         timer.Start();
+         G4SmartVoxelHeader *head = new G4SmartVoxelHeader(lvol);
+         timer.Stop();
+         stats.push_back(G4SmartVoxelStat(lvol, head,
+                                          timer.GetSystemElapsed(),
+                                          timer.GetUserElapsed()));
+         delete head;
+      }
+   }
+   std::sort(stats.begin(), stats.end(), slower);
+
+   G4cout << G4endl
+          << "GlueXVoxelReport: " << stats.size()
+          << " voxelized volumes, the " << nvolumes
+          << " slowest to build are" << G4endl
+          << std::setw(24) << "volume"
+          << std::setw(10) << "daughters"
+          << std::setw(10) << "smartless"
+          << std::setw(8) << "heads"
+          << std::setw(10) << "nodes"
+          << std::setw(12) << "memory(kB)"
+          << std::setw(10) << "time(ms)"
+          << G4endl;
+   long int memory = 0;
+   double time = 0;
+   for (unsigned int n=0; n < stats.size(); ++n) {
+      const G4LogicalVolume *lvol = stats[n].GetVolume();
+      memory += stats[n].GetMemoryUse();
+      time += stats[n].GetTotalTime();
+      if ((int)n < nvolumes) {
+         G4cout << std::setw(24) << lvol->GetName()
+                << std::setw(10) << lvol->GetNoDaughters()
+                << std::setw(10) << lvol->GetSmartless()
+                << std::setw(8) << stats[n].GetNumberHeads()
+                << std::setw(10) << stats[n].GetNumberNodes()
+                << std::setw(12) << std::setprecision(4)
+                << stats[n].GetMemoryUse() / 1024.
+                << std::setw(10) << std::setprecision(4)
+                << stats[n].GetTotalTime() * 1e3
+                << G4endl;
+      }
+   }
+   G4cout << std::setw(24) << "total"
+          << std::setw(38) << ""
+          << std::setw(12) << std::setprecision(4) << memory / 1024.
+          << std::setw(10) << std::setprecision(4) << time * 1e3
+          << G4endl;
+}
@@ -0,0 +1,33 @@
+//
+// GlueXVoxelReport - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// This class reports the memory taken by the smart voxels that Geant4
+// builds for each of the mother volumes in the geometry, and the time
+// that it takes to build them, together with the quality factor used
+// for each one (see G4LogicalVolume::SetSmartless). This is what is
+// needed to choose values for the smartless attributes in HDDS or the
+// SMARTLESS cards in control.in, which trade startup time and memory
+// against navigation speed. It is requested with the VOXELREPORT card.
+// The voxels are built here for the purpose of the report and deleted
+// again, so the geometry is left as it was.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. It is only
+// meant to be run from the master thread before tracking starts.
+
+#ifndef GlueXVoxelReport_h
+#define GlueXVoxelReport_h 1
+
+class GlueXVoxelReport
+{
+ public:
+   static void Print(int nvolumes);
+
+ private:
+   GlueXVoxelReport() {}
+};
+
+#endif
@@ -0,0 +1,311 @@
+//
+// class implementation for HddmInput
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "HddmInput.hh"
+#include "HddmRecordPool.hh"
+
+#include "G4ios.hh"
+
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+HddmInput::HddmInput(const std::string &filename, int depth,
+                     int skip, int maxevents, int slice, int nslices,
+                     HddmInputFilter *filter)
+ : fFilename(filename),
+   fHDDMistream(0),
+   fDepth(depth),
+   fSkip(skip),
+   fMaxEvents(maxevents),
+   fMaxRecords(0),
+   fEventsRead(0),
+   fRecordsRead(0),
+   fFilter(filter),
+   fSerial(0),
+   fEndOfInput(false),
+   fReaderDone(false),
+   fStopping(false)
+{
+   fHDDMinfile = new std::ifstream(filename.c_str());
+   if (! fHDDMinfile->is_open()) {
+      return;
+   }
+   fHDDMistream = new hddm_s::istream(*fHDDMinfile);
+
+   // Seek directly to the first record to be read, using the index
+
+   if (fSkip > 0 || nslices > 0) {
+      std::vector<hddm_s::streamposition> index;
+      if (! ReadIndex(index)) {
+         G4cout << "HddmInput: building event index for input file "
+                << fFilename << G4endl;
+         BuildIndex(index);
+         WriteIndex(index);
+      }
+      int nevents = index.size();
+      int first = 0;
+      int last = nevents;
+      if (nslices > 0) {
+         if (slice < 0 || slice >= nslices) {
+            G4cerr << "HddmInput error - "
+                   << "INSLICE " << slice << " " << nslices
+                   << " is not a valid slice of the input, "
+                   << "cannot continue." << G4endl;
+            exit(-1);
+         }
+         first = (long int)nevents * slice / nslices;
+         last = (long int)nevents * (slice + 1) / nslices;
+      }
+      first += fSkip;
+      if (first < last) {
+         fMaxRecords = last - first;
+         if (fMaxEvents > 0 && fMaxEvents < fMaxRecords && fFilter == 0)
+            fMaxRecords = fMaxEvents;
+         fHDDMistream->setPosition(index[first]);
+      }
+      else {
+         fEndOfInput = true;
+      }
+      fSkip = 0;
+      G4cout << "HddmInput: reading events " << first << " to "
+             << first + fMaxRecords << " of " << nevents
+             << " in input file " << fFilename << G4endl;
+   }
+
+   if (fDepth > 0) {
+      fReader = std::thread(&HddmInput::ReaderLoop, this);
+   }
+}
+
+HddmInput::~HddmInput()
+{
+   if (fReader.joinable()) {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fStopping = true;
+      fNotFull.notify_all();
+      lock.unlock();
+      fReader.join();
+   }
+   while (fQueue.size() > 0) {
+      delete fQueue.front();
+      fQueue.pop_front();
+   }
+   if (fHDDMistream)
+      delete fHDDMistream;
+   if (fFilter)
+      delete fFilter;
+   delete fHDDMinfile;
+}
+
+HddmInput::HddmInput(HddmInput &src)
+{}
+
+HddmInput& HddmInput::operator=(HddmInput &src)
+{
+   return *this;
+}
+
+hddm_s::HDDM *HddmInput::Read()
+{
+   // Read the next record to be processed from the input stream,
+   // discarding any that are still to be skipped or that fail the
+   // filter, or return null at the end of the input. This is only ever called by one thread
+   // at a time: the reader thread, or else the caller of Next().
+
+   while (! fEndOfInput) {
+      if (fMaxEvents > 0 && fEventsRead >= fMaxEvents) {
+         fEndOfInput = true;
+         break;
+      }
+      if (fMaxRecords > 0 && fRecordsRead >= fMaxRecords) {
+         fEndOfInput = true;
+         break;
+      }
+      if (! fHDDMinfile->good()) {
+         fEndOfInput = true;
+         break;
+      }
+      hddm_s::HDDM *record = HddmRecordPool::Get();
+      try {
+         *fHDDMistream >> *record;
+      }
+      catch(std::exception &e) {
+         G4cout << e.what() << G4endl;
+         HddmRecordPool::Release(record);
+         fEndOfInput = true;
+         break;
+      }
+      ++fRecordsRead;
+      if (fSkip > 0) {
+         --fSkip;
+         HddmRecordPool::Release(record);
+         continue;
+      }
+      if (fFilter && ! fFilter->Accept(*record)) {
+         HddmRecordPool::Release(record);
+         continue;
+      }
+      ++fEventsRead;
+      return record;
+   }
+   return 0;
+}
+
+void HddmInput::ReaderLoop()
+{
+   // Body of the reader thread, which decodes records from the input
+   // stream and appends them to the queue, waiting whenever the queue
+   // holds fDepth records, until the end of the input.
+
+   while (true) {
+      hddm_s::HDDM *record = Read();
+      std::unique_lock<std::mutex> lock(fMutex);
+      while (! fStopping && (int)fQueue.size() >= fDepth)
+         fNotFull.wait(lock);
+      if (record == 0 || fStopping) {
+         HddmRecordPool::Release(record);
+         fReaderDone = true;
+         fNotEmpty.notify_all();
+         return;
+      }
+      fQueue.push_back(record);
+      fNotEmpty.notify_one();
+   }
+}
+
+hddm_s::HDDM *HddmInput::Next(long int *serial)
+{
+   std::unique_lock<std::mutex> lock(fMutex);
+   hddm_s::HDDM *record = 0;
+   if (fDepth <= 0 || fHDDMistream == 0) {
+      record = (fHDDMistream)? Read() : 0;
+   }
+   else {
+      while (fQueue.size() == 0 && ! fReaderDone)
+         fNotEmpty.wait(lock);
+      if (fQueue.size() == 0)
+         return 0;
+      record = fQueue.front();
+      fQueue.pop_front();
+      fNotFull.notify_one();
+   }
+   if (record && serial)
+      *serial = fSerial;
+   if (record)
+      ++fSerial;
+   return record;
+}
+
+std::string HddmInput::IndexStamp()
+{
+   // Return the header line that identifies the index belonging to
+   // the current version of the input file.
+
+   struct stat st;
+   std::stringstream stamp;
+   stamp << "hddm_s index";
+   if (stat(fFilename.c_str(), &st) == 0)
+      stamp << " " << st.st_size << " " << st.st_mtime;
+   return stamp.str();
+}
+
+bool HddmInput::ReadIndex(std::vector<hddm_s::streamposition> &index)
+{
+   // Load the sidecar index of the input file, if it exists and was
+   // made from the current version of the file. The index is a text
+   // file with a header line from IndexStamp(), then the number of
+   // records, then one line per record with its stream position as
+   //    <block_start> <block_offset> <block_status>
+
+   std::ifstream fin((fFilename + ".idx").c_str());
+   if (! fin.is_open())
+      return false;
+   std::string stamp;
+   std::getline(fin, stamp);
+   if (stamp != IndexStamp())
+      return false;
+   int nevents = 0;
+   fin >> nevents;
+   index.resize(nevents);
+   for (int i=0; i < nevents; ++i) {
+      if (! (fin >> index[i].block_start
+                 >> index[i].block_offset
+                 >> index[i].block_status))
+      {
+         index.clear();
+         return false;
+      }
+   }
+   return true;
+}
+
+bool HddmInput::WriteIndex(const std::vector<hddm_s::streamposition> &index)
+{
+   // Save the index next to the input file, replacing any old one only
+   // once the new one is complete, so that other jobs reading the same
+   // input never see it partially written. If the input lives in a
+   // directory that this job cannot write, such as a read-only data
+   // area, the index is only kept in memory for this job, without a
+   // warning since there is nothing the user needs to fix.
+
+   size_t slash = fFilename.rfind('/');
+   std::string dir = (slash == fFilename.npos)? "." :
+                     fFilename.substr(0, slash + 1);
+   if (access(dir.c_str(), W_OK) != 0)
+      return false;
+   std::stringstream tmpname;
+   tmpname << fFilename << ".idx.tmp" << getpid();
+   std::string tmpfile = tmpname.str();
+   std::ofstream fout(tmpfile.c_str());
+   if (! fout.is_open()) {
+      G4cerr << "HddmInput::WriteIndex warning - "
+             << "unable to write index file " << tmpfile
+             << ", continuing without it." << G4endl;
+      return false;
+   }
+   fout << IndexStamp() << std::endl
+        << index.size() << std::endl;
+   for (unsigned int i=0; i < index.size(); ++i) {
+      fout << index[i].block_start << " "
+           << index[i].block_offset << " "
+           << index[i].block_status << std::endl;
+   }
+   fout.close();
+   if (rename(tmpfile.c_str(), (fFilename + ".idx").c_str()) != 0) {
+      G4cerr << "HddmInput::WriteIndex warning - "
+             << "unable to replace index file " << fFilename << ".idx"
+             << ", continuing without it." << G4endl;
+      unlink(tmpfile.c_str());
+      return false;
+   }
+   return true;
+}
+
+void HddmInput::BuildIndex(std::vector<hddm_s::streamposition> &index)
+{
+   // Make one pass through the input file on a separate stream,
+   // recording the position of each record before it is read.
+
+   index.clear();
+   std::ifstream fin(fFilename.c_str());
+   hddm_s::istream sin(fin);
+   while (fin.good()) {
+      hddm_s::streamposition pos = sin.getPosition();
+      hddm_s::HDDM record;
+      try {
+         sin >> record;
+      }
+      catch(std::exception &e) {
+         break;
+      }
+      if (! fin.good() && record.getPhysicsEvents().size() == 0)
+         break;
+      index.push_back(pos);
+   }
+}
@@ -0,0 +1,110 @@
+//
+// HddmInput - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Reader for the hddm_s input event stream named on the INFILE card,
+// used as the source of events from an external generator. Records are
+// read and decoded ahead by a dedicated reader thread into a bounded
+// queue, so that decompression and unpacking of the input stream are
+// taken off the critical path of the worker threads, which only need to
+// pop a ready record from the queue. The depth of the queue is set by
+// the INPREFETCH card in control.in, with a depth of 0 meaning that
+// no reader thread is started and each record is read by the worker
+// that asks for it, as before. The SKIP and TRIG cards are applied by
+// the reader, discarding the first SKIP records of the input and ending
+// the input after TRIG more records have been read.
+//
+// To start reading partway into a large input file without streaming
+// through the earlier records, a sidecar index <filename>.idx is kept
+// next to the input, holding the stream position of every record.
+// It is built by a single pass over the file the first time it is
+// needed, and rebuilt automatically if the input file changes. If the
+// directory of the input is not writable, the index is built in memory
+// for each job that needs it instead. With
+// the index, SKIP seeks directly to its first record, and the INSLICE
+// card "INSLICE k M" selects the k'th of M equal slices of the input
+// (k = 0..M-1), so that M batch jobs can divide one file between them.
+//
+// If an HddmInputFilter is given, it is applied by the reader to each
+// record after the skip, and the records that fail it are dropped there,
+// so they never reach the workers. TRIG then counts the records that pass.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state, but it
+// is thread-safe in that its methods can be called concurrently
+// from several different threads without conflicts.
+
+#ifndef _HDDMINPUT_
+#define _HDDMINPUT_
+
+#include <HDDM/hddm_s.hpp>
+
+#include "HddmInputFilter.hh"
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class HddmInput
+{
+ public:
+   HddmInput(const std::string &filename, int depth=8,
+             int skip=0, int maxevents=0, int slice=0, int nslices=0,
+             HddmInputFilter *filter=0);
+   ~HddmInput();
+
+   bool is_open() const;
+
+   // Return the next input record, which is then owned by the caller,
+   // or null if the end of the input has been reached. If serial is
+   // given, it receives the position of the record among those that
+   // have been returned so far, counting from 0.
+   hddm_s::HDDM *Next(long int *serial=0);
+
+ protected:
+   HddmInput(HddmInput &src);
+   HddmInput& operator=(HddmInput &src);
+
+   hddm_s::HDDM *Read();
+   void ReaderLoop();
+
+   bool ReadIndex(std::vector<hddm_s::streamposition> &index);
+   bool WriteIndex(const std::vector<hddm_s::streamposition> &index);
+   void BuildIndex(std::vector<hddm_s::streamposition> &index);
+   std::string IndexStamp();
+
+   std::string fFilename;
+
+   std::ifstream *fHDDMinfile;
+   hddm_s::istream *fHDDMistream;
+   int fDepth;
+   int fSkip;
+   int fMaxEvents;
+   int fMaxRecords;
+   int fEventsRead;
+   int fRecordsRead;
+   HddmInputFilter *fFilter;
+   long int fSerial;      // guarded by fMutex
+   bool fEndOfInput;      // touched only by the thread calling Read()
+   bool fReaderDone;      // the following are guarded by fMutex
+   bool fStopping;
+
+   std::deque<hddm_s::HDDM*> fQueue;
+   std::mutex fMutex;
+   std::condition_variable fNotEmpty;
+   std::condition_variable fNotFull;
+   std::thread fReader;
+};
+
+inline bool HddmInput::is_open() const
+{
+   return fHDDMinfile->is_open();
+}
+
+#endif
@@ -0,0 +1,198 @@
+//
+// class implementation for HddmInputFilter
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "HddmInputFilter.hh"
+#include "GlueXPrimaryGeneratorAction.hh"
+
+#include "G4ParticleTable.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <stdlib.h>
+#include <math.h>
+
+std::atomic<long> HddmInputFilter::fAccepted(0);
+std::atomic<long> HddmInputFilter::fRejected(0);
+
+static double filter_limit(const std::map<int, std::string> &args,
+                           int field, double value)
+{
+   // Return the number in the given field of the INFILTER card, or the
+   // default value if the field is not given. Anything else in the field
+   // is an error, so that limits run together into one field, or not
+   // numbers at all, cannot be silently dropped.
+
+   std::map<int, std::string>::const_iterator iter = args.find(field);
+   if (iter == args.end())
+      return value;
+   char *end;
+   value = strtod(iter->second.c_str(), &end);
+   if (end == iter->second.c_str() || *end != 0) {
+      G4cerr << "HddmInputFilter error - "
+             << "INFILTER field " << field << " should be a number, "
+             << "found '" << iter->second << "', cannot continue."
+             << G4endl;
+      exit(-1);
+   }
+   return value;
+}
+
+HddmInputFilter::HddmInputFilter(const std::map<int, std::string> &args)
+ : fType(kAnyType),
+   fPdgType(0),
+   fMinProducts(1),
+   fMinMomentum(0),
+   fMaxMomentum(1e30),
+   fMinCosTheta(-1),
+   fMaxCosTheta(1),
+   fMinZ(-1e30),
+   fMaxZ(1e30),
+   fSkip(0)
+{
+   std::map<int, std::string>::const_iterator iter;
+   std::string type = ((iter = args.find(1)) != args.end())? iter->second
+                                                            : "any";
+   if (args.size() > 0 && args.rbegin()->first > 8) {
+      G4cerr << "HddmInputFilter error - "
+             << "INFILTER takes at most 8 fields, found "
+             << args.rbegin()->first << ", cannot continue." << G4endl;
+      exit(-1);
+   }
+   fMinProducts = (int)filter_limit(args, 2, fMinProducts);
+   fMinMomentum = filter_limit(args, 3, fMinMomentum);
+   fMaxMomentum = filter_limit(args, 4, fMaxMomentum);
+   if (args.find(5) != args.end())
+      fMaxCosTheta = cos(filter_limit(args, 5, 0) * degree);
+   if (args.find(6) != args.end())
+      fMinCosTheta = cos(filter_limit(args, 6, 0) * degree);
+   fMinZ = filter_limit(args, 7, fMinZ);
+   fMaxZ = filter_limit(args, 8, fMaxZ);
+
+   // The charges of the particles are looked up here, once, because the
+   // particle table cannot be used from the reader thread of HddmInput.
+
+   G4ParticleTable *table = G4ParticleTable::GetParticleTable();
+   G4ParticleTable::G4PTblDicIterator *piter = table->GetIterator();
+   piter->reset();
+   while ((*piter)()) {
+      G4ParticleDefinition *part = piter->value();
+      fCharge[part->GetPDGEncoding()] = part->GetPDGCharge() / eplus;
+   }
+
+   char *end;
+   int pdgtype = strtol(type.c_str(), &end, 10);
+   if (type == "any" || type == "*") {
+      fType = kAnyType;
+   }
+   else if (type == "charged") {
+      fType = kCharged;
+   }
+   else if (type == "neutral") {
+      fType = kNeutral;
+   }
+   else if (type.size() > 0 && *end == 0) {
+      fType = kPdgType;
+      fPdgType = abs(pdgtype);
+   }
+   else if (table->FindParticle(type)) {
+      fType = kPdgType;
+      fPdgType = abs(table->FindParticle(type)->GetPDGEncoding());
+   }
+   else {
+      G4cerr << "HddmInputFilter error - "
+             << "INFILTER particle type " << type
+             << " is not any, charged, neutral or a known particle, "
+             << "cannot continue." << G4endl;
+      exit(-1);
+   }
+}
+
+HddmInputFilter::HddmInputFilter(const HddmInputFilter &src)
+{}
+
+HddmInputFilter& HddmInputFilter::operator=(const HddmInputFilter &src)
+{
+   return *this;
+}
+
+bool HddmInputFilter::Select(hddm_s::Product &product) const
+{
+   // The type of each product is worked out the same way as in
+   // GlueXPrimaryGeneratorAction::GeneratePrimariesHDDM.
+
+   int g3type = product.getType();
+   int pdgtype = product.getPdgtype();
+   if (g3type <= 0)
+      return false;
+   else if (pdgtype <= 0 || pdgtype >= 999999)
+      pdgtype = GlueXPrimaryGeneratorAction::ConvertGeant3ToPdg(g3type);
+   if (fType == kPdgType && abs(pdgtype) != fPdgType)
+      return false;
+   if (fType == kCharged || fType == kNeutral) {
+      double charge = 0;
+      std::map<int, double>::const_iterator iter = fCharge.find(pdgtype);
+      if (iter != fCharge.end())
+         charge = iter->second;
+      else if (pdgtype >= 1000000000)
+         charge = (pdgtype / 10000) % 1000;
+      if ((charge != 0) != (fType == kCharged))
+         return false;
+   }
+
+   hddm_s::Momentum &momentum = product.getMomentum();
+   double px = momentum.getPx();
+   double py = momentum.getPy();
+   double pz = momentum.getPz();
+   double p = sqrt(px*px + py*py + pz*pz);
+   if (p < fMinMomentum || p > fMaxMomentum)
+      return false;
+   double costheta = (p > 0)? pz / p : 1;
+   return (costheta >= fMinCosTheta && costheta <= fMaxCosTheta);
+}
+
+bool HddmInputFilter::Accept(hddm_s::HDDM &record)
+{
+   int nselected = 0;
+   hddm_s::VertexList vertices = record.getVertices();
+   hddm_s::VertexList::iterator it_vertex;
+   for (it_vertex = vertices.begin();
+        it_vertex != vertices.end() && nselected < fMinProducts; ++it_vertex)
+   {
+      double z = it_vertex->getOrigin().getVz();
+      if (z < fMinZ || z > fMaxZ)
+         continue;
+      hddm_s::ProductList &products = it_vertex->getProducts();
+      hddm_s::ProductList::iterator it_product;
+      for (it_product = products.begin();
+           it_product != products.end(); ++it_product)
+      {
+         if (Select(*it_product))
+            ++nselected;
+      }
+   }
+   if (nselected < fMinProducts) {
+      if (fSkip == 0)
+         ++fRejected;
+      return false;
+   }
+   if (fSkip > 0) {
+      --fSkip;
+      return false;
+   }
+   ++fAccepted;
+   return true;
+}
+
+void HddmInputFilter::PrintStatistics()
+{
+   long nevents = fAccepted + fRejected;
+   if (nevents == 0)
+      return;
+   G4cout << "HddmInputFilter: " << fAccepted << " of " << nevents
+          << " input events passed the INFILTER cut, "
+          << fRejected << " rejected before tracking" << G4endl;
+}
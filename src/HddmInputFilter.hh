@@ -0,0 +1,88 @@
+//
+// HddmInputFilter - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Kinematic cut on the events read from the INFILE input stream, applied
+// by HddmInput as each record is read, so that in studies which only need
+// a small part of the generated events the rest are dropped before they
+// are unpacked into primaries, tracked or written out. With a reader
+// thread running, see HddmInput, the cut is done on that thread, off the
+// critical path of the workers. It is requested by the INFILTER card:
+//
+//    INFILTER 'type' nmin pmin pmax thetamin thetamax zmin zmax
+//
+// which passes the events that contain at least nmin (default 1) final
+// state products of the given type, with total momentum between pmin and
+// pmax in GeV/c and polar angle between thetamin and thetamax in degrees,
+// that come from a vertex with z between zmin and zmax in cm, as these are
+// written in the input record. The type is one of 'any', 'charged' or
+// 'neutral', or else the name of a Geant4 particle or its PDG code, which
+// matches the antiparticle as well. Limits that are not given are open.
+//
+// The cut counts events read from the input, so that the TRIG card then
+// gives the number of events that pass. Events that are passed over when
+// a job resumes from a checkpoint are counted the same way, see Skip().
+// The numbers of events that passed and failed the cut are reported at
+// the end of the run.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state. Its tables
+// are made once when it is created, and the counters are atomic.
+
+#ifndef _HDDMINPUTFILTER_
+#define _HDDMINPUTFILTER_
+
+#include <HDDM/hddm_s.hpp>
+
+#include <string>
+#include <map>
+#include <atomic>
+
+class HddmInputFilter
+{
+ public:
+   HddmInputFilter(const std::map<int, std::string> &args);
+   ~HddmInputFilter() {}
+
+   // Return true if the record passes the cut, counting it.
+   bool Accept(hddm_s::HDDM &record);
+
+   // Pass over the next n records that would pass the cut, without
+   // counting them, as done when resuming from a checkpoint.
+   void Skip(long int n) { fSkip = n; }
+
+   static void PrintStatistics();
+
+ protected:
+   HddmInputFilter(const HddmInputFilter &src);
+   HddmInputFilter& operator=(const HddmInputFilter &src);
+
+   enum {
+      kAnyType,
+      kCharged,
+      kNeutral,
+      kPdgType
+   };
+
+   bool Select(hddm_s::Product &product) const;
+
+   int fType;
+   int fPdgType;
+   int fMinProducts;
+   double fMinMomentum;     // GeV/c
+   double fMaxMomentum;
+   double fMinCosTheta;
+   double fMaxCosTheta;
+   double fMinZ;            // cm
+   double fMaxZ;
+   long int fSkip;          // touched only by the thread calling Accept()
+
+   std::map<int, double> fCharge;
+
+   static std::atomic<long> fAccepted;
+   static std::atomic<long> fRejected;
+};
+
+#endif
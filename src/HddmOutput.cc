@@ -6,29 +6,120 @@
 
 #include "HddmOutput.hh"
 
+#include "HddmRecordPool.hh"
+#include "hddsCommon.hpp"
+
+#include "G4ios.hh"
+
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+const int kMaxShards = 1000;
+const int kSampleInterval = 16;
+const std::string kOutputLevelPrefix = "hdgeant4 output level ";
+
+typedef std::chrono::steady_clock timer_clock;
+
+static double SecondsSince(const timer_clock::time_point &t0)
+{
+   return std::chrono::duration<double>(timer_clock::now() - t0).count();
+}
+
 int HddmOutput::fRunNo = 0;
-int HddmOutput::fEventNo = 0;
-std::ofstream *HddmOutput::fHDDMoutfile = 0;
-hddm_s::ostream *HddmOutput::fHDDMostream = 0;
+std::atomic<int> HddmOutput::fEventNo(0);
+int HddmOutput::fOutputLevel = HddmOutput::OUTPUT_TRUTH;
+HddmOutput::stream_t *HddmOutput::fOutput = 0;
+int HddmOutput::fCompression = 0;
+int HddmOutput::fIntegrity = 0;
+HddmOutput::stream_stats_t HddmOutput::fStats = {0, 0, 0, 0, 0, 0, 0};
+bool HddmOutput::fSmearing = false;
+std::string HddmOutput::fSmearOptions;
+int HddmOutput::fSmearPid = 0;
+bool HddmOutput::fAppend = false;
+
+int HddmOutput::fDepth = 0;
+int HddmOutput::fWindow = 0;
+bool HddmOutput::fStopping = false;
+std::deque<HddmOutput::queue_entry_t> HddmOutput::fQueue;
+std::mutex HddmOutput::fMutex;
+std::condition_variable HddmOutput::fNotEmpty;
+std::condition_variable HddmOutput::fNotFull;
+std::thread HddmOutput::fWriter;
+bool HddmOutput::fRolledOver = false;
+std::condition_variable HddmOutput::fRolled;
+long int HddmOutput::fRolledBytes = -1;
+std::atomic<long int> HddmOutput::fBytesWritten(0);
+std::map<long int, hddm_s::HDDM*> HddmOutput::fPending;
+long int HddmOutput::fNextSerial = 0;
+std::string HddmOutput::fFilename;
+int HddmOutput::fShardMode = HddmOutput::SHARDS_NONE;
+std::vector<HddmOutput::stream_t*> HddmOutput::fShards;
+std::vector<int> HddmOutput::fShardIds;
+G4ThreadLocal HddmOutput::stream_t *HddmOutput::fShard = 0;
 
-HddmOutput::HddmOutput(const std::string &filename)
+HddmOutput::HddmOutput(const std::string &filename, int depth, int window,
+                       int shards)
 {
-   if (fHDDMostream != 0) {
-      delete fHDDMostream;
-      delete fHDDMoutfile;
+   if (fOutput != 0) {
+      CloseStream(fOutput, false);
+      fOutput = 0;
+   }
+   fFilename = filename;
+   fShardMode = shards;
+   fStats = stream_stats_t();
+   if (fShardMode != SHARDS_NONE)
+      return;
+   if (fSmearing) {
+      int fd = StartSmearing(filename);
+      fOutput = OpenStream(filename);
+      close(fd);
+   }
+   else {
+      fOutput = OpenStream(filename, fAppend);
+      fOutput->geometryWritten = fAppend;
+   }
+   fDepth = depth;
+   fWindow = window;
+   fStopping = false;
+   if (fDepth > 0 && ! fWriter.joinable()) {
+      fWriter = std::thread(&HddmOutput::WriterLoop);
    }
-   fHDDMoutfile = new std::ofstream(filename);
-   fHDDMostream = new hddm_s::ostream(*fHDDMoutfile);
 }
 
 HddmOutput::~HddmOutput()
 {
-   if (fHDDMostream != 0) {
-      delete fHDDMostream;
-      delete fHDDMoutfile;
-      fHDDMostream = 0;
-      fHDDMoutfile = 0;
+   if (fWriter.joinable()) {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fStopping = true;
+      fNotEmpty.notify_all();
+      lock.unlock();
+      fWriter.join();
+   }
+   if (fShardMode != SHARDS_NONE) {
+      for (unsigned int i=0; i < fShards.size(); ++i)
+         CloseStream(fShards[i]);
+      fShards.clear();
+      if (fShardMode == SHARDS_MERGED)
+         MergeShards(fFilename, fShardIds);
+      fShardIds.clear();
+      fShardMode = SHARDS_NONE;
    }
+   if (fOutput != 0) {
+      CloseStream(fOutput);
+      fOutput = 0;
+      if (fSmearPid > 0)
+         FinishSmearing();
+   }
+   PrintStatistics();
 }
 
 HddmOutput::HddmOutput(HddmOutput &src)
@@ -39,9 +130,581 @@ HddmOutput& HddmOutput::operator=(HddmOutput &src)
    return *this;
 }
 
-void HddmOutput::WriteOutputHDDM(hddm_s::HDDM &record)
+void HddmOutput::SetCompression(int compression, int integrity)
+{
+   fCompression = compression;
+   fIntegrity = integrity;
+}
+
+void HddmOutput::SetAppend()
+{
+   fAppend = true;
+}
+
+long int HddmOutput::Checkpoint()
+{
+   // With a writer thread, a null record is queued behind the records
+   // already handed over, and the writer rolls the stream over when it
+   // gets to it, after writing out any that it was holding back.
+
+   std::unique_lock<std::mutex> lock(fMutex);
+   if (fOutput == 0 || fShardMode != SHARDS_NONE || fSmearing)
+      return -1;
+   if (fWriter.joinable()) {
+      fRolledOver = false;
+      fQueue.push_back(queue_entry_t(-1, (hddm_s::HDDM*)0));
+      fNotEmpty.notify_one();
+      while (! fRolledOver)
+         fRolled.wait(lock);
+   }
+   else {
+      lock.unlock();
+      RollOver();
+   }
+   return fRolledBytes;
+}
+
+void HddmOutput::RollOver()
+{
+   // Closing the stream writes out its last block, which leaves the
+   // file complete, before it is opened again for appending.
+
+   CloseStream(fOutput);
+   struct stat st;
+   fRolledBytes = (stat(fFilename.c_str(), &st) == 0)? st.st_size : -1;
+   fOutput = OpenStream(fFilename, true);
+   fOutput->geometryWritten = true;
+}
+
+void HddmOutput::SetSmearStream(const std::string &options)
+{
+   fSmearing = true;
+   fSmearOptions = options;
+}
+
+int HddmOutput::StartSmearing(const std::string &filename)
+{
+   // Make the output file a named pipe and start mcsmear reading from
+   // it, returning a descriptor open on the write end once mcsmear has
+   // opened it, so that opening the output stream does not block. The
+   // job must not be killed by a broken pipe if mcsmear dies, but carry
+   // on to report it.
+
+   struct stat st;
+   if (lstat(filename.c_str(), &st) == 0 && ! S_ISFIFO(st.st_mode))
+      unlink(filename.c_str());
+   if (mkfifo(filename.c_str(), 0600) != 0 && errno != EEXIST) {
+      G4cerr << "HddmOutput::StartSmearing error - "
+             << "unable to create a pipe named " << filename
+             << " to stream the output to mcsmear." << G4endl;
+      exit(-1);
+   }
+   signal(SIGPIPE, SIG_IGN);
+   std::string command = "mcsmear " + fSmearOptions + " " + filename;
+   fSmearPid = fork();
+   if (fSmearPid == 0) {
+      execl("/bin/sh", "sh", "-c", command.c_str(), (char*)0);
+      _exit(127);
+   }
+   else if (fSmearPid < 0) {
+      G4cerr << "HddmOutput::StartSmearing error - "
+             << "unable to start mcsmear." << G4endl;
+      exit(-1);
+   }
+   int fd;
+   while ((fd = open(filename.c_str(), O_WRONLY | O_NONBLOCK)) < 0) {
+      int status;
+      if (errno != ENXIO || waitpid(fSmearPid, &status, WNOHANG) != 0) {
+         G4cerr << "HddmOutput::StartSmearing error - "
+                << "mcsmear did not start reading the output stream, "
+                << "command was: " << command << G4endl;
+         unlink(filename.c_str());
+         exit(-1);
+      }
+      usleep(10000);
+   }
+   G4cout << "HddmOutput: streaming output to " << command << G4endl;
+   return fd;
+}
+
+void HddmOutput::FinishSmearing()
+{
+   int status = 0;
+   waitpid(fSmearPid, &status, 0);
+   fSmearPid = 0;
+   unlink(fFilename.c_str());
+   if (! WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      G4cerr << "HddmOutput::FinishSmearing warning - "
+             << "mcsmear did not finish cleanly, exit status "
+             << WEXITSTATUS(status) << ", "
+             << "the smeared output may be incomplete." << G4endl;
+   }
+   else {
+      G4cout << "HddmOutput: mcsmear finished smearing the output stream"
+             << G4endl;
+   }
+}
+
+HddmOutput::stream_t *HddmOutput::OpenStream(const std::string &filename,
+                                             bool append)
+{
+   std::ios::openmode mode = std::ios::out | std::ios::binary;
+   if (append)
+      mode |= std::ios::app;
+   stream_t *output = new stream_t;
+   output->filebuf = new timed_filebuf;
+   if (output->filebuf->open(filename.c_str(), mode) == 0)
+   {
+      G4cerr << "HddmOutput::OpenStream error - "
+             << "unable to open output file " << filename << G4endl;
+      exit(-1);
+   }
+   output->file = new std::ostream(output->filebuf);
+   output->stream = new hddm_s::ostream(*output->file);
+   if (fCompression != 0)
+      output->stream->setCompression(fCompression);
+   if (fIntegrity != 0)
+      output->stream->setIntegrityChecks(fIntegrity);
+   output->samplebuf = new counting_buf;
+   output->samplefile = new std::ostream(output->samplebuf);
+   output->sample = new hddm_s::ostream(*output->samplefile);
+   output->geometryWritten = false;
+   output->records = 0;
+   output->streamTime = 0;
+   output->sampled = 0;
+   output->sampleBytes = 0;
+   output->sampleTime = 0;
+   return output;
+}
+
+void HddmOutput::CloseStream(stream_t *output, bool tally)
+{
+   // Closing the stream flushes the last block of compressed output,
+   // so it is counted as part of the time spent in the stream.
+
+   timer_clock::time_point t0 = timer_clock::now();
+   delete output->stream;
+   delete output->file;
+   output->filebuf->close();
+   output->streamTime += SecondsSince(t0);
+   if (tally) {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fStats.records += output->records;
+      fStats.bytes += output->filebuf->fBytes;
+      fStats.streamTime += output->streamTime;
+      fStats.writeTime += output->filebuf->fTime;
+      fStats.sampled += output->sampled;
+      fStats.sampleBytes += output->sampleBytes;
+      fStats.sampleTime += output->sampleTime;
+   }
+   delete output->filebuf;
+   delete output->sample;
+   delete output->samplefile;
+   delete output->samplebuf;
+   delete output;
+}
+
+void HddmOutput::PrintStatistics()
+{
+   // The time in the output streams covers serialization, compression
+   // and handing the result to the file; the samples give the first
+   // and the file buffer the last, leaving compression as the rest.
+
+   if (fStats.records == 0)
+      return;
+   double scale = (fStats.sampled > 0)? fStats.records /
+                                        double(fStats.sampled) : 0;
+   double rawBytes = fStats.sampleBytes * scale;
+   double serialTime = fStats.sampleTime * scale;
+   double compressTime = fStats.streamTime - serialTime - fStats.writeTime;
+   if (fCompression == 0 || compressTime < 0)
+      compressTime = 0;
+   G4cout << "HddmOutput: " << fStats.records << " events written, "
+          << fStats.bytes << " bytes";
+   if (fStats.bytes > 0 && rawBytes > 0) {
+      G4cout << " (compression ratio " << std::setprecision(3)
+             << rawBytes / fStats.bytes << " for an estimated "
+             << long(rawBytes) << " bytes uncompressed)";
+   }
+   G4cout << ", time spent in serialization " << std::setprecision(3)
+          << serialTime << " s, compression " << compressTime
+          << " s, writing " << fStats.writeTime << " s" << G4endl;
+}
+
+void HddmOutput::WriteOutputHDDM(hddm_s::HDDM *record, long int serial)
+{
+   // Queue the record for the writer thread, waiting if the queue is
+   // full so that a slow output device holds back the workers rather
+   // than letting finished events pile up in memory.
+
+   if (fShardMode != SHARDS_NONE) {
+      WriteShard(record);
+      return;
+   }
+   std::unique_lock<std::mutex> lock(fMutex);
+   if (fOutput == 0) {
+      HddmRecordPool::Release(record);
+      return;
+   }
+   if (! fWriter.joinable()) {
+      Write(record, fOutput);
+      return;
+   }
+   while ((int)fQueue.size() >= fDepth)
+      fNotFull.wait(lock);
+   fQueue.push_back(queue_entry_t(serial, record));
+   fNotEmpty.notify_one();
+}
+
+void HddmOutput::Write(hddm_s::HDDM *record, stream_t *output)
 {
-   if (fHDDMostream != 0) {
-      *fHDDMostream << record;
+   // Stamp the record with the run number, and with the next event
+   // number if it does not already have one, then serialize it to the
+   // output stream. The first record written also carries the checksum
+   // of the geometry used for the simulation and the output level.
+   // This is only ever called
+   // by one thread at a time for a given stream: the writer thread, or
+   // the caller of WriteOutputHDDM() holding the lock, or the owner of
+   // the shard.
+
+   if (! output->geometryWritten) {
+      StampFirstRecord(record, last_md5_checksum, OutputLevelTag());
+      output->geometryWritten = true;
+   }
+   hddm_s::PhysicsEvent &event = record->getPhysicsEvent(0);
+   event.setRunNo(fRunNo);
+   if (event.getEventNo() == 0)
+      event.setEventNo(++fEventNo);
+   WriteRecord(record, output);
+   HddmRecordPool::Release(record);
+}
+
+void HddmOutput::StampFirstRecord(hddm_s::HDDM *record,
+                                  const std::string &md5,
+                                  const std::string &level)
+{
+   hddm_s::GeometryList geom = record->addGeometrys();
+   geom(0).setMd5simulation(md5);
+   hddm_s::DataVersionStringList vers = record->getPhysicsEvent(0)
+                                               .addDataVersionStrings();
+   vers(0).setText(level);
+}
+
+std::string HddmOutput::OutputLevelTag()
+{
+   std::stringstream tag;
+   tag << kOutputLevelPrefix << fOutputLevel;
+   if (fOutputLevel == OUTPUT_HITS)
+      tag << " (hits only)";
+   else if (fOutputLevel == OUTPUT_PRIMARIES)
+      tag << " (hits plus primaries)";
+   else
+      tag << " (full truth)";
+   return tag.str();
+}
+
+void HddmOutput::WriteRecord(hddm_s::HDDM *record, stream_t *output)
+{
+   // Every kSampleInterval'th record is also serialized without any
+   // compression to a stream that only counts its bytes, giving an
+   // estimate of the size of the output before compression and of the
+   // time that the output stream spends on serialization alone.
+
+   if (output->records % kSampleInterval == 0) {
+      long int bytes0 = output->samplebuf->fBytes;
+      timer_clock::time_point t0 = timer_clock::now();
+      *output->sample << *record;
+      output->sampleTime += SecondsSince(t0);
+      output->sampleBytes += output->samplebuf->fBytes - bytes0;
+      ++output->sampled;
+   }
+   timer_clock::time_point t0 = timer_clock::now();
+   *output->stream << *record;
+   output->streamTime += SecondsSince(t0);
+   ++output->records;
+}
+
+void HddmOutput::WriterLoop()
+{
+   // Body of the writer thread, which takes records from the queue and
+   // writes them out until the output is closed. With a reorder window,
+   // records are held in fPending until all of the records before them
+   // have been written, or until more than fWindow records are held, in
+   // which case the missing ones are given up on, as they may belong to
+   // events that were aborted or not kept.
+
+   std::unique_lock<std::mutex> lock(fMutex);
+   while (true) {
+      while (! fStopping && fQueue.size() == 0)
+         fNotEmpty.wait(lock);
+      if (fQueue.size() == 0)
+         break;
+      queue_entry_t entry = fQueue.front();
+      fQueue.pop_front();
+      fNotFull.notify_one();
+      lock.unlock();
+
+      if (entry.second == 0) {
+         while (fPending.size() > 0) {
+            fNextSerial = std::max(fNextSerial, fPending.begin()->first + 1);
+            Write(fPending.begin()->second, fOutput);
+            fPending.erase(fPending.begin());
+         }
+         RollOver();
+         lock.lock();
+         fRolledOver = true;
+         fRolled.notify_all();
+         continue;
+      }
+      else if (fWindow <= 0 || entry.first < 0) {
+         Write(entry.second, fOutput);
+      }
+      else {
+         fPending[entry.first] = entry.second;
+         while (fPending.size() > 0 &&
+                (fPending.begin()->first <= fNextSerial ||
+                 (int)fPending.size() > fWindow))
+         {
+            fNextSerial = std::max(fNextSerial, fPending.begin()->first + 1);
+            Write(fPending.begin()->second, fOutput);
+            fPending.erase(fPending.begin());
+         }
+      }
+      lock.lock();
+   }
+   lock.unlock();
+
+   while (fPending.size() > 0) {
+      Write(fPending.begin()->second, fOutput);
+      fPending.erase(fPending.begin());
+   }
+}
+
+void HddmOutput::WriteShard(hddm_s::HDDM *record)
+{
+   // Write the record to the shard belonging to the calling thread,
+   // opening it the first time the thread writes an event. When the
+   // shards are merged, the geometry checksum is added at the merge,
+   // otherwise each shard gets its own copy.
+
+   if (fShard == 0) {
+      int id = G4Threading::G4GetThreadId();
+      std::string name = ShardName(fFilename, (id > 0)? id : 0);
+      fShard = OpenStream(name);
+      fShard->geometryWritten = (fShardMode == SHARDS_MERGED);
+      std::unique_lock<std::mutex> lock(fMutex);
+      fShards.push_back(fShard);
+      fShardIds.push_back((id > 0)? id : 0);
+   }
+   Write(record, fShard);
+}
+
+std::streamsize HddmOutput::timed_filebuf::xsputn(const char *s,
+                                                  std::streamsize n)
+{
+   // The base class xsputn may call overflow to flush the buffer, so
+   // the bytes and time are counted here for the whole call, and
+   // overflow only counts when it is called directly by the stream.
+
+   timer_clock::time_point t0 = timer_clock::now();
+   fInPut = true;
+   std::streamsize count = std::filebuf::xsputn(s, n);
+   fInPut = false;
+   fTime += SecondsSince(t0);
+   fBytes += count;
+   fBytesWritten += count;
+   return count;
+}
+
+HddmOutput::timed_filebuf::int_type
+HddmOutput::timed_filebuf::overflow(int_type c)
+{
+   if (fInPut)
+      return std::filebuf::overflow(c);
+   timer_clock::time_point t0 = timer_clock::now();
+   int_type res = std::filebuf::overflow(c);
+   fTime += SecondsSince(t0);
+   if (! traits_type::eq_int_type(c, traits_type::eof()) &&
+       ! traits_type::eq_int_type(res, traits_type::eof()))
+   {
+      ++fBytes;
+      ++fBytesWritten;
+   }
+   return res;
+}
+
+int HddmOutput::timed_filebuf::sync()
+{
+   timer_clock::time_point t0 = timer_clock::now();
+   int res = std::filebuf::sync();
+   fTime += SecondsSince(t0);
+   return res;
+}
+
+std::streamsize HddmOutput::counting_buf::xsputn(const char *s,
+                                                 std::streamsize n)
+{
+   fBytes += n;
+   return n;
+}
+
+HddmOutput::counting_buf::int_type
+HddmOutput::counting_buf::overflow(int_type c)
+{
+   if (traits_type::eq_int_type(c, traits_type::eof()))
+      return traits_type::not_eof(c);
+   ++fBytes;
+   return c;
+}
+
+std::string HddmOutput::ShardName(const std::string &filename, int shard)
+{
+   std::stringstream suffix;
+   suffix << ".t" << std::setw(2) << std::setfill('0') << shard;
+   size_t dot = filename.rfind('.');
+   size_t slash = filename.rfind('/');
+   if (dot == filename.npos || (slash != filename.npos && dot < slash))
+      return filename + suffix.str();
+   return filename.substr(0, dot) + suffix.str() + filename.substr(dot);
+}
+
+static hddm_s::HDDM *ReadShardRecord(std::ifstream *fin,
+                                     hddm_s::istream *istr)
+{
+   if (! fin->good())
+      return 0;
+   hddm_s::HDDM *record = HddmRecordPool::Get();
+   try {
+      *istr >> *record;
+   }
+   catch(std::exception &e) {
+      HddmRecordPool::Release(record);
+      return 0;
+   }
+   return record;
+}
+
+int HddmOutput::MergeShards(const std::string &filename)
+{
+   // Merge whatever shards of filename are found on disk, as left by an
+   // earlier job that kept them, see hdgeant4 -m.
+
+   std::vector<int> shards;
+   for (int id=0; id < kMaxShards; ++id) {
+      struct stat st;
+      if (stat(ShardName(filename, id).c_str(), &st) == 0)
+         shards.push_back(id);
+   }
+   return MergeShards(filename, shards);
+}
+
+int HddmOutput::MergeShards(const std::string &filename,
+                            const std::vector<int> &shards)
+{
+   // Merge the listed shards of filename into a single file of that name,
+   // taking the records from each shard in turn in order of increasing
+   // event number, so that the result is the same as if the events had
+   // been written to a single stream as they were completed. The merged
+   // file replaces any old one only once it is complete, and then the
+   // shards are removed. Other shards of the same name, such as those
+   // left by an earlier job, are not touched.
+
+   std::vector<std::string> names;
+   std::vector<std::ifstream*> files;
+   std::vector<hddm_s::istream*> streams;
+   for (unsigned int i=0; i < shards.size(); ++i) {
+      std::string name = ShardName(filename, shards[i]);
+      std::ifstream *fin = new std::ifstream(name.c_str());
+      if (! fin->is_open()) {
+         G4cerr << "HddmOutput::MergeShards error - "
+                << "unable to open output shard " << name
+                << ", the shards have been left in place." << G4endl;
+         delete fin;
+         for (unsigned int j=0; j < names.size(); ++j) {
+            delete streams[j];
+            delete files[j];
+         }
+         return 0;
+      }
+      names.push_back(name);
+      files.push_back(fin);
+      streams.push_back(new hddm_s::istream(*fin));
+   }
+   if (names.size() == 0)
+      return 0;
+
+   std::stringstream tmpname;
+   tmpname << filename << ".tmp" << getpid();
+   std::string tmpfile = tmpname.str();
+   stream_t *output = OpenStream(tmpfile);
+   std::vector<hddm_s::HDDM*> next(names.size());
+   for (unsigned int i=0; i < names.size(); ++i)
+      next[i] = ReadShardRecord(files[i], streams[i]);
+   // Shards that were kept each carry the geometry checksum and output
+   // level, which are needed when merging them in a job that has not
+   // built the geometry or read the OUTLEVEL card.
+
+   std::string md5 = last_md5_checksum;
+   std::string level;
+   int nevents = 0;
+   while (true) {
+      int first = -1;
+      int firstno = 0;
+      for (unsigned int i=0; i < names.size(); ++i) {
+         if (next[i] == 0)
+            continue;
+         int evno = next[i]->getPhysicsEvent(0).getEventNo();
+         if (first < 0 || evno < firstno) {
+            first = i;
+            firstno = evno;
+         }
+      }
+      if (first < 0)
+         break;
+      hddm_s::HDDM *record = next[first];
+      hddm_s::GeometryList geoms = record->getGeometrys();
+      if (geoms.size() > 0) {
+         if (md5.size() == 0)
+            md5 = geoms(0).getMd5simulation();
+         record->deleteGeometrys();
+      }
+      hddm_s::PhysicsEvent &event = record->getPhysicsEvent(0);
+      for (int iv=0; iv < event.getDataVersionStrings().size(); ) {
+         std::string text = event.getDataVersionStrings()(iv).getText();
+         if (text.find(kOutputLevelPrefix) == 0) {
+            if (level.size() == 0)
+               level = text;
+            event.deleteDataVersionStrings(1, iv);
+         }
+         else {
+            ++iv;
+         }
+      }
+      if (nevents == 0)
+         StampFirstRecord(record, md5, (level.size() > 0)? level :
+                                                           OutputLevelTag());
+      WriteRecord(record, output);
+      HddmRecordPool::Release(record);
+      next[first] = ReadShardRecord(files[first], streams[first]);
+      ++nevents;
+   }
+   CloseStream(output, false);
+   for (unsigned int i=0; i < names.size(); ++i) {
+      delete streams[i];
+      delete files[i];
+   }
+
+   if (rename(tmpfile.c_str(), filename.c_str()) != 0) {
+      G4cerr << "HddmOutput::MergeShards error - "
+             << "unable to replace output file " << filename
+             << ", the shards have been left in place." << G4endl;
+      unlink(tmpfile.c_str());
+      return 0;
    }
+   for (unsigned int i=0; i < names.size(); ++i)
+      unlink(names[i].c_str());
+   G4cout << "HddmOutput: merged " << nevents << " events from "
+          << names.size() << " shards into output file " << filename
+          << G4endl;
+   return nevents;
 }
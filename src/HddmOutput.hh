@@ -4,39 +4,266 @@
 // author: richard.t.jones at uconn.edu
 // version: september 21, 2016
 //
+// Writer for the hddm_s output event stream named on the OUTFILE card.
+// Finished event records are handed over by whichever worker thread
+// completes the event, and are queued for a dedicated writer thread
+// that owns the output stream, so that serialization and compression
+// of the output are taken off the critical path of the workers. The
+// writer assigns the event numbers of records that do not have one,
+// in the order they are written. The OUTWRITER card in control.in sets
+// the depth of the queue, with a depth of 0 meaning that no writer
+// thread is started and each record is written by the worker that
+// finishes it, under a lock. By default records are written in the
+// order that they are completed, but if a reorder window is given on
+// the OUTWRITER card they are written in the order of their serial
+// numbers, ie. the order the events were read from the input or shot
+// by the particle gun, holding back up to that many records while
+// waiting for the next one in sequence to arrive.
+//
+// On machines with many cores, the OUTSHARDS card instead gives each
+// worker thread its own output file, or shard, named after the OUTFILE
+// with the thread number inserted before the extension, for example
+// out.t03.hddm for thread 3 of out.hddm, which the worker writes itself
+// with no contention between threads. At the end of the job the shards
+// are merged into the OUTFILE, interleaved by event number, and removed,
+// unless the shards are to be kept, in which case each one is a valid
+// output file by itself. Shards that were kept can be merged later using
+// the -m option of hdgeant4. Event numbers are assigned across all of
+// the shards from one counter, and only the first event in the merged
+// file carries the geometry checksum, as with a single output stream.
+//
+// The OUTCOMPRESS card selects the compression applied by the hddm_s
+// stream to everything written, including the shards and merged output,
+// and the integrity check to go with it. The hddm_s streams do not offer
+// a choice of compression level, nor any way to compress the blocks of
+// one stream on several threads, so the way to spread compression over
+// many cores is to combine OUTCOMPRESS with OUTSHARDS, which has each
+// worker compress its own shard. At the end of the job the output
+// reports the number of bytes written and the time spent in the output
+// streams, with the uncompressed size and the time taken to serialize
+// the records without compression estimated from a sample of records
+// that are also written to an uncompressed stream that goes nowhere.
+// This allows the time to be split between serialization, compression
+// and writing to the file, which is timed at the level of the file
+// buffer.
+//
+// The OUTLEVEL card sets how much of the truth information goes into
+// the output, see output_level_t below. The level is recorded in the
+// first record of the output, next to the geometry checksum, as a
+// dataVersionString of the form "hdgeant4 output level 1 (hits plus
+// primaries)", so that readers can tell what to expect.
+//
+// With POSTSMEAR 2 in control.in, the output is streamed to mcsmear as it
+// is written instead of going to disk. The OUTFILE is made a named pipe,
+// mcsmear is started on it with the options on the MCSMEAROPTS card, and
+// the smearing runs alongside the simulation. At the end of the job the
+// output waits for mcsmear to finish and removes the pipe, leaving only
+// the smeared file written by mcsmear. Streaming cannot be combined with
+// OUTSHARDS, as mcsmear reads only one input stream.
+//
+// For the checkpoints of GlueXCheckpoint, the output can be flushed
+// to the file by finishing the hddm stream once all of the records
+// handed over so far have been written, leaving a complete file, and
+// starting a new stream that appends to it. Readers of hddm_s take the
+// header of the new stream part way through the file in the same way
+// as in hddm files that have been joined with cat. A job that resumes
+// from a checkpoint also appends its output to the existing file.
+//
 // In the context of the Geant4 event-level multithreading model,
-// this class is "shared", ie. has no thread-local state, but it
-// is thread-safe in that its methods can be called concurrently
-// from several different threads without conflicts.
+// this class is "shared", ie. has no thread-local state apart from
+// the output shard of each worker thread, and it is thread-safe in that
+// its methods can be called concurrently from several different threads
+// without conflicts.
 
 #ifndef _HDDMOUTPUT_
 #define _HDDMOUTPUT_
 
+#include "G4Threading.hh"
+
 #include <HDDM/hddm_s.hpp>
 #include <fstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <streambuf>
 
 class HddmOutput
 {
  public:
-   HddmOutput(const std::string &filename);
+   enum shard_mode_t {
+      SHARDS_NONE,               // single output stream
+      SHARDS_MERGED,             // shards merged at the end of the job
+      SHARDS_KEPT                // shards left as separate files
+   };
+
+   enum output_level_t {
+      OUTPUT_HITS,               // hits only, no truth information
+      OUTPUT_PRIMARIES,          // hits, primary vertices and products,
+                                 // and truth points of primary tracks
+      OUTPUT_TRUTH               // everything, including random seeds
+   };
+
+   HddmOutput(const std::string &filename, int depth=64, int window=0,
+              int shards=SHARDS_NONE);
    ~HddmOutput();
 
-   static void WriteOutputHDDM(hddm_s::HDDM &record);
+   // set the hddm_s compression and integrity flags of the output streams,
+   // to be called before the output is opened
+   static void SetCompression(int compression, int integrity=0);
+
+   // stream the output to mcsmear with the given options, to be called
+   // before the output is opened
+   static void SetSmearStream(const std::string &options);
+
+   // append to the output file instead of replacing it, to be called
+   // before the output is opened
+   static void SetAppend();
+
+   // Finish the output stream with all of the records handed over so
+   // far and start a new one appending to the file, returning the size
+   // of the file at the end of the old stream, or -1 if there is no
+   // output. Not available with shards or mcsmear streaming.
+   static long int Checkpoint();
+
+   // name of the shard written by a given thread
+   static std::string ShardName(const std::string &filename, int shard);
+   // merge any shards of filename into it, returning the number of events
+   static int MergeShards(const std::string &filename);
+   // same, for exactly the given list of shards made by this job
+   static int MergeShards(const std::string &filename,
+                          const std::vector<int> &shards);
+
+   // Hand over a finished record to be written, which is then owned
+   // by the output. The serial number gives its place in the input
+   // order, or -1 if it has none.
+   static void WriteOutputHDDM(hddm_s::HDDM *record, long int serial=-1);
+
+   // total bytes written to the output files so far, by all streams
+   static long int getBytesWritten();
+
    static int getRunNo();
    static int getEventNo();
    static void setRunNo(int runno);
    static void setEventNo(int eventno);
+   static int getOutputLevel();
+   static void setOutputLevel(int level);
 
  protected:
    HddmOutput(HddmOutput &src);
    HddmOutput& operator=(HddmOutput &src);
 
+   // file buffer that counts the bytes going to the file and the
+   // time spent handing them to it
+   class timed_filebuf : public std::filebuf {
+    public:
+      timed_filebuf() : fBytes(0), fTime(0), fInPut(false) {}
+      long int fBytes;
+      double fTime;
+    protected:
+      bool fInPut;       // inside xsputn, which does the counting
+      std::streamsize xsputn(const char *s, std::streamsize n);
+      int_type overflow(int_type c);
+      int sync();
+   };
+
+   // stream buffer that throws away what it is given, only counting it
+   class counting_buf : public std::streambuf {
+    public:
+      counting_buf() : fBytes(0) {}
+      long int fBytes;
+    protected:
+      std::streamsize xsputn(const char *s, std::streamsize n);
+      int_type overflow(int_type c);
+   };
+
+   struct stream_t {
+      timed_filebuf *filebuf;
+      std::ostream *file;
+      hddm_s::ostream *stream;
+      counting_buf *samplebuf;   // uncompressed stream for sampling
+      std::ostream *samplefile;
+      hddm_s::ostream *sample;
+      bool geometryWritten;
+      long int records;
+      double streamTime;         // time spent in the output stream
+      long int sampled;          // records also written to the sample
+      long int sampleBytes;
+      double sampleTime;
+   };
+
+   struct stream_stats_t {
+      long int records;
+      long int bytes;
+      double streamTime;
+      double writeTime;
+      long int sampled;
+      long int sampleBytes;
+      double sampleTime;
+   };
+
+   static stream_t *OpenStream(const std::string &filename,
+                               bool append=false);
+   static void CloseStream(stream_t *output, bool tally=true);
+   static void WriteRecord(hddm_s::HDDM *record, stream_t *output);
+   static void PrintStatistics();
+   static void StampFirstRecord(hddm_s::HDDM *record, const std::string &md5,
+                                const std::string &level);
+   static std::string OutputLevelTag();
+   static int StartSmearing(const std::string &filename);
+   static void FinishSmearing();
+
+   static void Write(hddm_s::HDDM *record, stream_t *output);
+   static void WriterLoop();
+   static void WriteShard(hddm_s::HDDM *record);
+   static void RollOver();
+
    static int fRunNo;
-   static int fEventNo;
-   static std::ofstream *fHDDMoutfile;
-   static hddm_s::ostream *fHDDMostream;
+   static std::atomic<int> fEventNo;
+   static int fOutputLevel;
+   static stream_t *fOutput;
+   static int fCompression;
+   static int fIntegrity;
+   static stream_stats_t fStats;              // guarded by fMutex
+   static bool fSmearing;
+   static std::string fSmearOptions;
+   static int fSmearPid;
+   static bool fAppend;
+
+   typedef std::pair<long int, hddm_s::HDDM*> queue_entry_t;
+
+   static int fDepth;
+   static int fWindow;
+   static bool fStopping;        // the following are guarded by fMutex
+   static std::deque<queue_entry_t> fQueue;
+   static std::mutex fMutex;
+   static std::condition_variable fNotEmpty;
+   static std::condition_variable fNotFull;
+   static std::thread fWriter;
+   static bool fRolledOver;
+   static std::condition_variable fRolled;
+   static long int fRolledBytes;
+   static std::atomic<long int> fBytesWritten;
+
+   static std::map<long int, hddm_s::HDDM*> fPending;  // writer only
+   static long int fNextSerial;
+
+   static std::string fFilename;
+   static int fShardMode;
+   static std::vector<stream_t*> fShards;     // guarded by fMutex
+   static std::vector<int> fShardIds;         // guarded by fMutex
+   static G4ThreadLocal stream_t *fShard;
 };
 
+inline long int HddmOutput::getBytesWritten()
+{
+   return fBytesWritten;
+}
+
 inline int HddmOutput::getRunNo()
 {
    return fRunNo;
@@ -57,4 +284,14 @@ inline void HddmOutput::setEventNo(int eventno)
    fEventNo = eventno;
 }
 
+inline int HddmOutput::getOutputLevel()
+{
+   return fOutputLevel;
+}
+
+inline void HddmOutput::setOutputLevel(int level)
+{
+   fOutputLevel = level;
+}
+
 #endif
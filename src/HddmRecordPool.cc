@@ -0,0 +1,67 @@
+//
+// HddmRecordPool - class implementation
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+
+#include "HddmRecordPool.hh"
+
+const unsigned int kCacheSize = 16;
+const unsigned int kMaxShared = 1024;
+
+std::vector<hddm_s::HDDM*> HddmRecordPool::fShared;
+std::mutex HddmRecordPool::fMutex;
+G4ThreadLocal std::vector<hddm_s::HDDM*> *HddmRecordPool::fCache = 0;
+
+HddmRecordPool::HddmRecordPool()
+{}
+
+HddmRecordPool::HddmRecordPool(HddmRecordPool &src)
+{}
+
+HddmRecordPool& HddmRecordPool::operator=(HddmRecordPool &src)
+{
+   return *this;
+}
+
+hddm_s::HDDM *HddmRecordPool::Get()
+{
+   if (fCache == 0) {
+      fCache = new std::vector<hddm_s::HDDM*>;
+      fCache->reserve(kCacheSize);
+   }
+   if (fCache->size() == 0) {
+      std::unique_lock<std::mutex> lock(fMutex);
+      while (fShared.size() > 0 && fCache->size() < kCacheSize / 2) {
+         fCache->push_back(fShared.back());
+         fShared.pop_back();
+      }
+   }
+   if (fCache->size() == 0)
+      return new hddm_s::HDDM;
+   hddm_s::HDDM *record = fCache->back();
+   fCache->pop_back();
+   return record;
+}
+
+void HddmRecordPool::Release(hddm_s::HDDM *record)
+{
+   if (record == 0)
+      return;
+   record->clear();
+   if (fCache == 0) {
+      fCache = new std::vector<hddm_s::HDDM*>;
+      fCache->reserve(kCacheSize);
+   }
+   if (fCache->size() >= kCacheSize) {
+      std::unique_lock<std::mutex> lock(fMutex);
+      while (fCache->size() > kCacheSize / 2) {
+         if (fShared.size() < kMaxShared)
+            fShared.push_back(fCache->back());
+         else
+            delete fCache->back();
+         fCache->pop_back();
+      }
+   }
+   fCache->push_back(record);
+}
@@ -0,0 +1,58 @@
+//
+// HddmRecordPool - class header
+//
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// Pool of recycled hddm_s::HDDM event records, used in place of new
+// and delete for the records that carry each event from the input or
+// generator through the simulation to the output. A record is taken from
+// the pool with Get() and handed back with Release() once it has been
+// written out or discarded, which clears it and keeps it for reuse. Each
+// thread keeps a small cache of free records of its own, so that taking
+// and releasing records normally needs no lock. Records are released
+// mainly by the output writer and taken mainly by the worker threads and
+// the input reader, so a thread whose cache fills up passes half of it
+// to a shared list, and a thread whose cache is empty refills it from
+// there, taking several records at a time under one lock.
+//
+// Note that clearing a record frees the elements below the top level,
+// as the hddm_s element lists keep no spare capacity of their own, so it
+// is the allocation of the record itself and the clearing of the old one
+// that are saved here, and the latter is moved off the worker threads.
+//
+// In the context of the Geant4 event-level multithreading model,
+// this class is "shared", ie. has no thread-local state apart from
+// the cache of free records of each thread, and it is thread-safe in
+// that its methods can be called concurrently from several different
+// threads without conflicts.
+
+#ifndef _HDDMRECORDPOOL_
+#define _HDDMRECORDPOOL_
+
+#include "G4Threading.hh"
+
+#include <HDDM/hddm_s.hpp>
+#include <vector>
+#include <mutex>
+
+class HddmRecordPool
+{
+ public:
+   // take an empty record from the pool, or make a new one
+   static hddm_s::HDDM *Get();
+
+   // clear a record and return it to the pool, which then owns it
+   static void Release(hddm_s::HDDM *record);
+
+ protected:
+   HddmRecordPool();
+   HddmRecordPool(HddmRecordPool &src);
+   HddmRecordPool& operator=(HddmRecordPool &src);
+
+   static std::vector<hddm_s::HDDM*> fShared;   // guarded by fMutex
+   static std::mutex fMutex;
+   static G4ThreadLocal std::vector<hddm_s::HDDM*> *fCache;
+};
+
+#endif
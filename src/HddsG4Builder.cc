@@ -27,6 +27,12 @@
 #include <G4HelixMixedStepper.hh>
 #include <G4ClassicalRK4.hh>
 #include <G4ChordFinder.hh>
+#include <G4CashKarpRKF45.hh>
+#include <G4ProductionCuts.hh>
+#include <G4UserLimits.hh>
+
+#include <GlueXUserOptions.hh>
+#include <GlueXStrawRing.hh>
 
 #include <assert.h>
 #include <stdlib.h>
@@ -37,6 +43,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <set>
 #include <string>
 #include <iomanip>
 #include <vector>
@@ -58,9 +65,15 @@ HddsG4Builder::HddsG4Builder(const HddsG4Builder &src)
    fElements = src.fElements;
    fMaterials = src.fMaterials;
    fMagneticRegions = src.fMagneticRegions;
+   fFieldManagers = src.fFieldManagers;
+   fRegionNames = src.fRegionNames;
+   fRegionFields = src.fRegionFields;
+   fRegions = src.fRegions;
    fLogicalVolumes = src.fLogicalVolumes;
+   fVolumeIndex = src.fVolumeIndex;
    fPhysicalVolumes = src.fPhysicalVolumes;
    fSensitiveVolumes = src.fSensitiveVolumes;
+   fDivisions = src.fDivisions;
    fRotations = src.fRotations;
    fCurrentMother = src.fCurrentMother;
    fCurrentPlacement = src.fCurrentPlacement;
@@ -415,6 +428,9 @@ int HddsG4Builder::createSolid(DOMElement* el, Refsys& ref)
    G4FieldManager* fieldmgr = fFieldManagers[ref.fRegionID];
    fLogicalVolumes[newvol] = new G4LogicalVolume(solid,fMaterials[imate],
                                                  S(nameS),fieldmgr);
+   indexVolume(newvol, fLogicalVolumes[newvol]);
+   if (fRegions.find(ref.fRegionID) != fRegions.end())
+      fRegions[ref.fRegionID]->AddRootLogicalVolume(fLogicalVolumes[newvol]);
    G4Material* mate = fMaterials[imate];
    double dens = mate->GetDensity();
    double dmod = (int)(dens*97.345/(g/cm3)) % 20;
@@ -430,6 +446,17 @@ int HddsG4Builder::createSolid(DOMElement* el, Refsys& ref)
       fSensitiveVolumes[ivolu] = fLogicalVolumes[newvol];
    }
 
+   // An optional smartless attribute sets the quality factor used by
+   // Geant4 in building the voxels of this volume, instead of the
+   // default; a higher value trades memory for navigation speed.
+
+   XString smartS(el->getAttribute(X("smartless")));
+   double smartless = atof(S(smartS));
+   if (smartless > 0)
+   {
+      fLogicalVolumes[newvol]->SetSmartless(smartless);
+   }
+
    G4MaterialPropertiesTable *mpt = fMaterials[imate]->GetMaterialPropertiesTable();
    if (mpt)
    {
@@ -636,6 +663,9 @@ HddsG4Builder::addNewLayer(int volume_id, int layer)
    {
       fLogicalVolumes[newvol] = new G4LogicalVolume(solid,0,str.str(),fieldmgr);
    }
+   fLogicalVolumes[newvol]->SetSmartless(fLogicalVolumes[oldvol]
+                                         ->GetSmartless());
+   indexVolume(newvol, fLogicalVolumes[newvol]);
 
    // If this is the top-level (world) volume then it cannot be
    // placed here, so simply return here.
@@ -787,6 +817,9 @@ int HddsG4Builder::createDivision(XString& divStr, Refsys& ref)
    G4FieldManager* fieldmgr = fFieldManagers[ref.fRegionID];
    fLogicalVolumes[myvol] = new G4LogicalVolume(solid,material,
                                                 S(divStr),fieldmgr);
+   indexVolume(myvol, fLogicalVolumes[myvol]);
+   if (fRegions.find(ref.fRegionID) != fRegions.end())
+      fRegions[ref.fRegionID]->AddRootLogicalVolume(fLogicalVolumes[myvol]);
    fLogicalVolumes[myvol]->SetVisAttributes(new G4VisAttributes(false));
    vpair_t mydiv(myvoluI,0);
    fPhysicalVolumes[mydiv] = new G4PVDivision(S(divStr),
@@ -911,11 +944,6 @@ int HddsG4Builder::createRegion(DOMElement* el, Refsys& ref)
    std::map<vpair_t,G4LogicalVolume*>::iterator moms;
    moms = fLogicalVolumes.find(vpair_t(motherI,0));
 
-   G4double *R = (G4double*)ref.fMRmatrix;
-   G4double *O = ref.fMOrigin;
-   G4AffineTransform xform(CLHEP::HepRotation(CLHEP::HepRep3x3(R)),
-                           CLHEP::Hep3Vector(O[0],O[1],O[2]));
-
    if (ref.fRegion)
    {
       DOMNodeList* noBfieldL;
@@ -923,31 +951,78 @@ int HddsG4Builder::createRegion(DOMElement* el, Refsys& ref)
       DOMNodeList* mapBfieldL;
       DOMNodeList* compBfieldL;
       DOMNodeList* swimL;
+      DOMNodeList* cutsL;
+      DOMNodeList* limitsL;
       noBfieldL = ref.fRegion->getElementsByTagName(X("noBfield"));
       uniBfieldL = ref.fRegion->getElementsByTagName(X("uniformBfield"));
       mapBfieldL = ref.fRegion->getElementsByTagName(X("mappedBfield"));
       compBfieldL = ref.fRegion->getElementsByTagName(X("computedBfield"));
       swimL = ref.fRegion->getElementsByTagName(X("swim"));
-      double maxArcStep = 0;
-      XString methodS("helix");
+      cutsL = ref.fRegion->getElementsByTagName(X("productionCuts"));
+      limitsL = ref.fRegion->getElementsByTagName(X("userLimits"));
+      XString regionS(ref.fRegion->getAttribute(X("name")));
+      fRegionNames[iregion] = S(regionS);
+      region_field_t field;
+      field.type = kNoFieldElement;
+      field.B[0] = field.B[1] = field.B[2] = 0;
+      field.unit = 0;
+      for (int i=0; i < 9; ++i)
+         field.R[i] = ((G4double*)ref.fMRmatrix)[i];
+      for (int i=0; i < 3; ++i)
+         field.O[i] = ref.fMOrigin[i];
+      field.method = "helix";
+      field.maxArcStep = 0;
+      swim_tuning_t tune = {"", 0, 0, 0, 0};
+      field.tune = tune;
       if (swimL->getLength() > 0)
       {
          DOMElement* swimEl = (DOMElement*)swimL->item(0);
-         methodS = swimEl->getAttribute(X("method"));
+         XString methodS(swimEl->getAttribute(X("method")));
+         field.method = S(methodS);
          Units unit;
          unit.getConversions(swimEl);
          XString stepS(swimEl->getAttribute(X("maxArcStep")));
-         maxArcStep = atof(S(stepS))/unit.rad;
+         field.maxArcStep = atof(S(stepS))/unit.rad;
+         XString stepperS(swimEl->getAttribute(X("stepper")));
+         field.tune.stepper = S(stepperS);
+         XString minStepS(swimEl->getAttribute(X("minStep")));
+         field.tune.minStep = atof(S(minStepS))/unit.cm * cm;
+         XString chordS(swimEl->getAttribute(X("deltaChord")));
+         field.tune.deltaChord = atof(S(chordS))/unit.cm * cm;
+         XString isectS(swimEl->getAttribute(X("deltaIntersection")));
+         field.tune.deltaIntersection = atof(S(isectS))/unit.cm * cm;
+         XString onestepS(swimEl->getAttribute(X("deltaOneStep")));
+         field.tune.deltaOneStep = atof(S(onestepS))/unit.cm * cm;
+      }
+      region_limits_t limits = {{0, 0, 0, 0}, 0, 0, 0};
+      field.limits = limits;
+      if (cutsL->getLength() > 0)
+      {
+         DOMElement* cutsEl = (DOMElement*)cutsL->item(0);
+         Units unit;
+         unit.getConversions(cutsEl);
+         const char *particles[4] = {"gamma", "electron", "positron",
+                                     "proton"};
+         for (int p=0; p < 4; ++p) {
+            XString cutS(cutsEl->getAttribute(X(particles[p])));
+            field.limits.cuts[p] = atof(S(cutS))/unit.cm * cm;
+         }
+      }
+      if (limitsL->getLength() > 0)
+      {
+         DOMElement* limitsEl = (DOMElement*)limitsL->item(0);
+         Units unit;
+         unit.getConversions(limitsEl);
+         XString stepS(limitsEl->getAttribute(X("maxStep")));
+         field.limits.maxStep = atof(S(stepS))/unit.cm * cm;
+         XString ekinS(limitsEl->getAttribute(X("minEkin")));
+         field.limits.minEkin = atof(S(ekinS))/unit.GeV * GeV;
+         XString timeS(limitsEl->getAttribute(X("maxTime")));
+         field.limits.maxTime = atof(S(timeS))/unit.ns * ns;
       }
       if (noBfieldL->getLength() > 0)
       {
-         fMagneticRegions[iregion] = 0;
-         G4ThreeVector Bvec(0,0,1e-99);
-         G4UniformMagField *fld = new G4UniformMagField(Bvec);
-         G4Mag_EqRhs *eqn = new G4Mag_UsualEqRhs(fld);
-         G4MagIntegratorStepper *stepper = new G4ExactHelixStepper(eqn);
-         G4ChordFinder *cfinder = new G4ChordFinder(fld, 1e+99, stepper);
-         fFieldManagers[iregion] = new G4FieldManager(fld, cfinder);
+         field.type = kNoBfield;
       }
       else if (uniBfieldL->getLength() > 0)
       {
@@ -956,16 +1031,9 @@ int HddsG4Builder::createRegion(DOMElement* el, Refsys& ref)
          funit.getConversions(uniBfieldEl);
          XString bvecS(uniBfieldEl->getAttribute(X("Bx_By_Bz")));
          std::stringstream str(S(bvecS));
-         double B[3];
-         str >> B[0] >> B[1] >> B[2];
-         double u = kilogauss/funit.kG;
-         G4ThreeVector Bvec(B[0],B[1],B[2]);
-         GlueXUniformMagField *fld = new GlueXUniformMagField(Bvec,u,xform);
-         fMagneticRegions[iregion] = fld;
-         G4Mag_EqRhs *eqn = new G4Mag_UsualEqRhs(fld);
-         G4MagIntegratorStepper *stepper = new G4ExactHelixStepper(eqn);
-         G4ChordFinder *cfinder = new G4ChordFinder(fld, 0.01, stepper);
-         fFieldManagers[iregion] = new G4FieldManager(fld, cfinder);
+         str >> field.B[0] >> field.B[1] >> field.B[2];
+         field.unit = kilogauss/funit.kG;
+         field.type = kUniformBfield;
       }
       else if (mapBfieldL->getLength() > 0)
       {
@@ -974,26 +1042,9 @@ int HddsG4Builder::createRegion(DOMElement* el, Refsys& ref)
          funit.getConversions(mapBfieldEl);
          XString bvecS(mapBfieldEl->getAttribute(X("maxBfield")));
          std::stringstream str(S(bvecS));
-         double Bmax;
-         str >> Bmax;
-         double u = kilogauss/funit.kG;
-         GlueXMappedMagField *fld = new GlueXMappedMagField(Bmax,u,xform);
-         fMagneticRegions[iregion] = fld;
-         G4Mag_EqRhs *eqn = new G4Mag_UsualEqRhs(fld);
-         G4MagIntegratorStepper *stepper;
-         if (methodS == "RungeKutta") {
-            stepper = new G4ClassicalRK4(eqn);
-         }
-         else {
-            stepper = new G4HelixMixedStepper(eqn);
-         }
-         G4ChordFinder *cfinder = new G4ChordFinder(fld, 0.01, stepper);
-         if (maxArcStep > 0) {
-            double rmin = 0.1 / (0.03 * Bmax * u) * meter;
-            double max_miss = rmin * (1 - cos(maxArcStep / 2));
-            cfinder->SetDeltaChord(max_miss);
-         }
-         fFieldManagers[iregion] = new G4FieldManager(fld, cfinder);
+         str >> field.B[0];
+         field.unit = kilogauss/funit.kG;
+         field.type = kMappedBfield;
       }
       else if (compBfieldL->getLength() > 0)
       {
@@ -1002,28 +1053,15 @@ int HddsG4Builder::createRegion(DOMElement* el, Refsys& ref)
          funit.getConversions(compBfieldEl);
          XString bvecS(compBfieldEl->getAttribute(X("maxBfield")));
          std::stringstream str(S(bvecS));
-         double Bmax;
-         str >> Bmax;
-         double u = kilogauss/funit.kG;
-         GlueXComputedMagField *fld = new GlueXComputedMagField(Bmax,u,xform);
-         fld->SetFunction(XString(compBfieldEl->getAttribute(X("function"))));
-         fMagneticRegions[iregion] = fld;
-         G4Mag_EqRhs *eqn = new G4Mag_UsualEqRhs(fld);
-         G4MagIntegratorStepper *stepper;
-         if (methodS == "RungeKutta") {
-            stepper = new G4ClassicalRK4(eqn);
-         }
-         else {
-            stepper = new G4HelixMixedStepper(eqn);
-         }
-         G4ChordFinder *cfinder = new G4ChordFinder(fld, 0.01, stepper);
-         if (maxArcStep > 0) {
-            double rmin = 0.1 / (0.03 * Bmax * u) * meter;
-            double max_miss = rmin * (1 - cos(maxArcStep / 2));
-            cfinder->SetDeltaChord(max_miss);
-         }
-         fFieldManagers[iregion] = new G4FieldManager(fld, cfinder);
+         str >> field.B[0];
+         field.unit = kilogauss/funit.kG;
+         XString funcS(compBfieldEl->getAttribute(X("function")));
+         field.function = S(funcS);
+         field.type = kComputedBfield;
       }
+      fRegionFields[iregion] = field;
+      createRegionField(iregion, field);
+      createRegionLimits(iregion, field.limits);
    }
 
 #ifdef LINUX_CPUTIME_PROFILING
@@ -1033,6 +1071,271 @@ int HddsG4Builder::createRegion(DOMElement* el, Refsys& ref)
    return iregion;
 }
 
+void HddsG4Builder::createRegionField(int iregion,
+                                      const region_field_t &field)
+{
+   // Build the magnetic field and field manager of a region from the
+   // field description taken from hdds, applying any swim tuning from
+   // control.in on top of the tuning found in hdds.
+
+   swim_tuning_t tune = field.tune;
+   getSwimTuning(fRegionNames[iregion], tune);
+   G4AffineTransform xform(CLHEP::HepRotation(CLHEP::HepRep3x3(field.R)),
+                           CLHEP::Hep3Vector(field.O[0],field.O[1],field.O[2]));
+   double Bmax = field.B[0];
+   double u = field.unit;
+   double max_miss = 0;
+   if (field.maxArcStep > 0 && Bmax * u > 0) {
+      double rmin = 0.1 / (0.03 * Bmax * u) * meter;
+      max_miss = rmin * (1 - cos(field.maxArcStep / 2));
+   }
+   std::string stepperS((field.method == "RungeKutta")? "ClassicalRK4"
+                                                      : "HelixMixed");
+   if (field.type == kNoBfield)
+   {
+      // An empty field manager is attached to field-free regions,
+      // rather than none at all, so that they do not inherit the
+      // field manager of their mother volume. Geant4 transports
+      // charged particles in straight lines through any volume
+      // whose field manager has no detector field.
+
+      fMagneticRegions[iregion] = 0;
+      fFieldManagers[iregion] = new G4FieldManager();
+   }
+   else if (field.type == kUniformBfield)
+   {
+      G4ThreeVector Bvec(field.B[0],field.B[1],field.B[2]);
+      GlueXUniformMagField *fld = new GlueXUniformMagField(Bvec,u,xform);
+      fMagneticRegions[iregion] = fld;
+      fFieldManagers[iregion] = createFieldManager(fld, tune,
+                                                   "ExactHelix", 0);
+   }
+   else if (field.type == kMappedBfield)
+   {
+      GlueXMappedMagField *fld = new GlueXMappedMagField(Bmax,u,xform);
+      fMagneticRegions[iregion] = fld;
+      fFieldManagers[iregion] = createFieldManager(fld, tune, stepperS,
+                                                   max_miss);
+   }
+   else if (field.type == kComputedBfield)
+   {
+      GlueXComputedMagField *fld = new GlueXComputedMagField(Bmax,u,xform);
+      fld->SetFunction(field.function);
+      fMagneticRegions[iregion] = fld;
+      fFieldManagers[iregion] = createFieldManager(fld, tune, stepperS,
+                                                   max_miss);
+   }
+}
+
+void HddsG4Builder::createRegionMaps(int iregion,
+                                     const region_field_t &field)
+{
+   // Load the field map of a region with a mapped field, after the
+   // field itself has been created by createRegionField.
+
+   GlueXMappedMagField *magfield = (GlueXMappedMagField*)
+                                   fMagneticRegions[iregion];
+   // The grid order holds, by axis, the position (1..3) of the axis in
+   // the samples of the grid, the first one varying most slowly in the
+   // map, but the field takes the list of axes (1..3) in that sequence.
+
+   std::vector<field_grid_t>::const_iterator grid;
+   for (grid = field.grids.begin(); grid != field.grids.end(); ++grid)
+   {
+      int samples[4], order[4] = {0,0,0,0}, sense[4];
+      double lower[4], upper[4];
+      for (int i=0; i < 4; ++i) {
+         samples[i] = grid->samples[i];
+         sense[i] = grid->sense[i];
+         lower[i] = grid->lower[i];
+         upper[i] = grid->upper[i];
+      }
+      for (int axis=1; axis <= 3; ++axis) {
+         int position = grid->order[axis - 1];
+         if (position >= 1 && position <= 3)
+            order[position] = axis;
+      }
+      if (grid->cylindrical)
+         magfield->AddCylindricalGrid(samples, order, sense, lower, upper);
+      else
+         magfield->AddCartesianGrid(samples, order, sense, lower, upper);
+   }
+   magfield->ReadMapFile(field.mapfile.c_str());
+}
+
+void HddsG4Builder::getSwimTuning(const std::string &region,
+                                  swim_tuning_t &tune) const
+{
+   // Override the swim tuning of a field region from control.in, if a
+   // card SWIMTUNE:<region> is present, or else a card SWIMTUNE that
+   // applies to all field regions. The card arguments are the stepper
+   // name, followed by minStep, deltaChord, deltaIntersection and
+   // deltaOneStep in mm; arguments that are omitted or zero are left
+   // as they were found in the hdds description.
+
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   if (user_opts == 0)
+      return;
+   std::map<int, std::string> tune_opts;
+   std::string key("SWIMTUNE:" + region);
+   if (user_opts->Find(key.c_str(), tune_opts) ||
+       user_opts->Find("SWIMTUNE", tune_opts))
+   {
+      if (tune_opts.find(1) != tune_opts.end() && tune_opts[1].size() > 0)
+         tune.stepper = tune_opts[1];
+      double *value[5] = {0, &tune.minStep, &tune.deltaChord,
+                          &tune.deltaIntersection, &tune.deltaOneStep};
+      for (int arg=2; arg <= 5; ++arg) {
+         if (tune_opts.find(arg) != tune_opts.end()) {
+            double v = atof(tune_opts[arg].c_str()) * mm;
+            if (v > 0)
+               *value[arg-1] = v;
+         }
+      }
+   }
+}
+
+void HddsG4Builder::createRegionLimits(int iregion,
+                                       const region_limits_t &limits)
+{
+   // Build a G4Region with the production cuts and user limits of a
+   // region, applying any overrides from control.in on top of what was
+   // found in hdds, if there are any. Cuts that are left at zero are
+   // filled in with the default cut value by GlueXPhysicsList. Every
+   // logical volume of the region is made a root of the G4Region as it
+   // is created, so that volumes of other regions placed inside them
+   // are not taken over, unless they have no G4Region of their own.
+
+   region_limits_t lim = limits;
+   getRegionLimits(fRegionNames[iregion], lim);
+   bool cuts = false;
+   for (int p=0; p < 4; ++p)
+      cuts |= (lim.cuts[p] > 0);
+   bool user = (lim.maxStep > 0 || lim.minEkin > 0 || lim.maxTime > 0);
+   if (! cuts && ! user)
+      return;
+
+   G4Region *region = new G4Region(fRegionNames[iregion]);
+   G4cout << "HddsG4Builder: region " << fRegionNames[iregion];
+   if (cuts) {
+      G4ProductionCuts *pcuts = new G4ProductionCuts();
+      G4cout << " production cuts";
+      for (int p=0; p < 4; ++p) {
+         pcuts->SetProductionCut(lim.cuts[p], p);
+         G4cout << " " << lim.cuts[p] / mm;
+      }
+      G4cout << " mm";
+      region->SetProductionCuts(pcuts);
+   }
+   if (user) {
+      G4UserLimits *ulimits = new G4UserLimits();
+      if (lim.maxStep > 0)
+         ulimits->SetMaxAllowedStep(lim.maxStep);
+      if (lim.minEkin > 0)
+         ulimits->SetUserMinEkine(lim.minEkin);
+      if (lim.maxTime > 0)
+         ulimits->SetUserMaxTime(lim.maxTime);
+      G4cout << " user limits " << lim.maxStep / mm << " mm "
+             << lim.minEkin / MeV << " MeV " << lim.maxTime / ns << " ns";
+      region->SetUserLimits(ulimits);
+   }
+   G4cout << G4endl;
+   fRegions[iregion] = region;
+}
+
+void HddsG4Builder::getRegionLimits(const std::string &region,
+                                    region_limits_t &limits) const
+{
+   // Override the production cuts and user limits of a region from
+   // control.in, if a card REGIONCUTS:<region> or REGIONLIMITS:<region>
+   // is present, or else a card REGIONCUTS or REGIONLIMITS that applies
+   // to all regions. The REGIONCUTS arguments are the range cuts for
+   // gammas, electrons, positrons and protons in mm, and the REGIONLIMITS
+   // arguments are the maximum step in mm, the minimum kinetic energy
+   // in MeV and the maximum global time in ns; arguments that are
+   // omitted or zero are left as they were found in the hdds description.
+
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   if (user_opts == 0)
+      return;
+   std::map<int, double> cuts_opts;
+   std::string key("REGIONCUTS:" + region);
+   if (user_opts->Find(key.c_str(), cuts_opts) ||
+       user_opts->Find("REGIONCUTS", cuts_opts))
+   {
+      for (int arg=1; arg <= 4; ++arg) {
+         if (cuts_opts.find(arg) != cuts_opts.end() && cuts_opts[arg] > 0)
+            limits.cuts[arg-1] = cuts_opts[arg] * mm;
+      }
+   }
+   std::map<int, double> limits_opts;
+   key = "REGIONLIMITS:" + region;
+   if (user_opts->Find(key.c_str(), limits_opts) ||
+       user_opts->Find("REGIONLIMITS", limits_opts))
+   {
+      double *value[3] = {&limits.maxStep, &limits.minEkin, &limits.maxTime};
+      double units[3] = {mm, MeV, ns};
+      for (int arg=1; arg <= 3; ++arg) {
+         if (limits_opts.find(arg) != limits_opts.end() &&
+             limits_opts[arg] > 0)
+         {
+            *value[arg-1] = limits_opts[arg] * units[arg-1];
+         }
+      }
+   }
+}
+
+G4FieldManager* HddsG4Builder::createFieldManager(G4MagneticField *fld,
+                                                 const swim_tuning_t &tune,
+                                         const std::string &defaultStepper,
+                                                 double defaultDeltaChord)
+{
+   // Build the equation of motion, stepper, chord finder and field
+   // manager for a field region, applying any tuning parameters that
+   // were specified for it on top of the builder defaults.
+
+   G4Mag_EqRhs *eqn = new G4Mag_UsualEqRhs(fld);
+   std::string stepperS((tune.stepper.size() > 0)? tune.stepper
+                                                  : defaultStepper);
+   G4MagIntegratorStepper *stepper = createStepper(stepperS, eqn);
+   if (stepper == 0) {
+      G4cerr << "HddsG4Builder::createFieldManager error - "
+             << "unknown stepper " << stepperS << " requested, "
+             << "cannot continue." << G4endl;
+      exit(1);
+   }
+   double minStep = (tune.minStep > 0)? tune.minStep : 0.01;
+   G4ChordFinder *cfinder = new G4ChordFinder(fld, minStep, stepper);
+   if (tune.deltaChord > 0)
+      cfinder->SetDeltaChord(tune.deltaChord);
+   else if (defaultDeltaChord > 0)
+      cfinder->SetDeltaChord(defaultDeltaChord);
+   G4FieldManager *fieldmgr = new G4FieldManager(fld, cfinder);
+   if (tune.deltaIntersection > 0)
+      fieldmgr->SetDeltaIntersection(tune.deltaIntersection);
+   if (tune.deltaOneStep > 0)
+      fieldmgr->SetDeltaOneStep(tune.deltaOneStep);
+   return fieldmgr;
+}
+
+G4MagIntegratorStepper* HddsG4Builder::createStepper(const std::string &name,
+                                                    G4Mag_EqRhs *eqn)
+{
+   // Construct a field stepper given the name of its Geant4 class,
+   // without the G4 prefix and Stepper suffix, returns zero if the
+   // name is not one of the supported steppers.
+
+   if (name == "ExactHelix")
+      return new G4ExactHelixStepper(eqn);
+   else if (name == "HelixMixed")
+      return new G4HelixMixedStepper(eqn);
+   else if (name == "ClassicalRK4" || name == "RungeKutta")
+      return new G4ClassicalRK4(eqn);
+   else if (name == "CashKarpRKF45")
+      return new G4CashKarpRKF45(eqn);
+   return 0;
+}
+
 void HddsG4Builder::createSetFunctions(DOMElement* el, const XString& ident)
 {
 #ifdef LINUX_CPUTIME_PROFILING
@@ -1414,8 +1717,8 @@ void HddsG4Builder::createMapFunctions(DOMElement* el, const XString& ident)
       if (iregionS.size() == 0)
          continue;
       int iregion = atoi(S(iregionS));
-      GlueXMappedMagField *magfield = (GlueXMappedMagField*)
-                                      fMagneticRegions[iregion];
+      region_field_t &rfield = fRegionFields[iregion];
+      rfield.grids.clear();
       int axorder[] = {0,0,0,0};
       int axsamples[] = {0,0,0,0};
 
@@ -1425,7 +1728,8 @@ void HddsG4Builder::createMapFunctions(DOMElement* el, const XString& ident)
       for (ngrid = 0; ngrid < (int)gridL->getLength(); ++ngrid)
       {
          int axsense[] = {1,1,1,1};
-         double axlower[4], axupper[4];
+         double axlower[] = {0,0,0,0};
+         double axupper[] = {0,0,0,0};
          DOMElement* gridEl = (DOMElement*)gridL->item(ngrid);
          XString typeS(gridEl->getAttribute(X("type")));
          if (gridtype.size() > 0 && typeS != gridtype)
@@ -1544,22 +1848,23 @@ void HddsG4Builder::createMapFunctions(DOMElement* el, const XString& ident)
             }
          }
 
-         if (gridtype == "cartesian")
-         {
-            magfield->AddCartesianGrid(axsamples, axorder, axsense,
-                                       axlower, axupper);
-         }
-         else if (gridtype == "cylindrical")
-         {
-            magfield->AddCylindricalGrid(axsamples, axorder, axsense,
-                                         axlower, axupper);
-         }
-         else
+         if (gridtype != "cartesian" && gridtype != "cylindrical")
          {
             G4cerr << APP_NAME << " error: unrecognized grid type " 
                    << S(gridtype) << G4endl;
             exit(1);
          }
+         field_grid_t grid;
+         grid.cylindrical = (gridtype == "cylindrical");
+         for (int i=0; i < 4; ++i)
+         {
+            grid.samples[i] = axsamples[i];
+            grid.order[i] = axorder[i];
+            grid.sense[i] = axsense[i];
+            grid.lower[i] = axlower[i];
+            grid.upper[i] = axupper[i];
+         }
+         rfield.grids.push_back(grid);
       }
 
       XString mapS(mapfEl->getAttribute(X("map")));
@@ -1577,7 +1882,8 @@ void HddsG4Builder::createMapFunctions(DOMElement* el, const XString& ident)
          exit(1);
       }
       mapS.erase(0,7);
-      magfield->ReadMapFile(S(mapS));
+      rfield.mapfile = S(mapS);
+      createRegionMaps(iregion, rfield);
    }
 
    // Apply a post-build fix to ensure that every point in the geometry
@@ -1591,6 +1897,91 @@ void HddsG4Builder::createMapFunctions(DOMElement* el, const XString& ident)
 #endif
 }
 
+int HddsG4Builder::pruneSubsystems(DOMDocument* document)
+{
+   // Edit the hdds document before it is translated, so that the
+   // compositions named on the SUBSYSOMIT card are not placed anywhere,
+   // and those named on the SUBSYSENVELOPE card are replaced by their
+   // envelope volume, with nothing inside it. An envelope can be given
+   // another hdds material by writing the entry as <name>:<material>.
+   // Returns the number of placements that were removed or replaced.
+
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   if (user_opts == 0)
+      return 0;
+   std::map<std::string, std::string> replacement;
+   std::map<int, std::string> omit_opts;
+   std::map<int, std::string> envelope_opts;
+   std::map<int, std::string>::iterator opt;
+   if (user_opts->Find("SUBSYSOMIT", omit_opts)) {
+      for (opt = omit_opts.begin(); opt != omit_opts.end(); ++opt)
+         replacement[opt->second] = "";
+   }
+   if (user_opts->Find("SUBSYSENVELOPE", envelope_opts)) {
+      for (opt = envelope_opts.begin(); opt != envelope_opts.end(); ++opt) {
+         std::string name(opt->second);
+         std::string material;
+         size_t colon = name.find(':');
+         if (colon != name.npos) {
+            material = name.substr(colon + 1);
+            name = name.substr(0, colon);
+         }
+         DOMElement* compEl = document->getElementById(X(name.c_str()));
+         XString tagS((compEl)? compEl->getTagName() : X(""));
+         XString envelopeS((compEl)? compEl->getAttribute(X("envelope"))
+                                   : X(""));
+         if (tagS != "composition" || envelopeS.size() == 0) {
+            G4cerr << APP_NAME << " warning - subsystem " << name
+                   << " on the SUBSYSENVELOPE card is not a composition "
+                   << "with an envelope, continuing without it." << G4endl;
+            continue;
+         }
+         if (material.size() > 0) {
+            if (document->getElementById(X(material.c_str())) == 0) {
+               G4cerr << APP_NAME << " warning - material " << material
+                      << " on the SUBSYSENVELOPE card is not defined, "
+                      << "continuing without it." << G4endl;
+            }
+            else {
+               DOMElement* envEl = document->getElementById(envelopeS.
+                                                            unicode_str());
+               if (envEl)
+                  envEl->setAttribute(X("material"), X(material.c_str()));
+            }
+         }
+         replacement[name] = S(envelopeS);
+      }
+   }
+   if (replacement.size() == 0)
+      return 0;
+
+   // Every element with a volume attribute places that volume inside
+   // the composition that holds it. These are collected first, since
+   // the list returned by getElementsByTagName follows the document.
+
+   std::vector<DOMElement*> placements;
+   DOMNodeList* allL = document->getElementsByTagName(X("*"));
+   for (int i=0; i < (int)allL->getLength(); ++i) {
+      DOMElement* el = (DOMElement*)allL->item(i);
+      XString volumeS(el->getAttribute(X("volume")));
+      if (replacement.find(S(volumeS)) != replacement.end())
+         placements.push_back(el);
+   }
+   for (int i=0; i < (int)placements.size(); ++i) {
+      XString volumeS(placements[i]->getAttribute(X("volume")));
+      std::string envelope(replacement[S(volumeS)]);
+      if (envelope.size() > 0) {
+         placements[i]->setAttribute(X("volume"), X(envelope.c_str()));
+      }
+      else {
+         DOMNode* parent = placements[i]->getParentNode();
+         parent->removeChild(placements[i]);
+         placements[i]->release();
+      }
+   }
+   return placements.size();
+}
+
 void HddsG4Builder::translate(DOMElement* topel)
 {
 #ifdef LINUX_CPUTIME_PROFILING
@@ -1625,7 +2016,7 @@ G4LogicalVolume* HddsG4Builder::getWorldVolume(int parallel) const
 {
    int worlds = 0;
    std::map<vpair_t,G4LogicalVolume*>::const_iterator paraworld;
-   for (paraworld = fLogicalVolumes.find(vpair_t(fWorldVolume,0));
+   for (paraworld = fLogicalVolumes.lower_bound(vpair_t(fWorldVolume,0));
         paraworld != fLogicalVolumes.end() &&
         paraworld->first.first == fWorldVolume;
         ++paraworld, ++worlds)
@@ -1638,6 +2029,289 @@ G4LogicalVolume* HddsG4Builder::getWorldVolume(int parallel) const
    return 0;
 }
 
+int HddsG4Builder::mergeLayers(double tolerance)
+{
+   // At any point in the geometry, the volume that counts is the one
+   // found on the highest layer where the volume at that point has a
+   // material, since GlueXPathFinder searches the layers from the top
+   // down and passes over the empty ones. The volumes with a material on
+   // one layer can therefore be moved onto the next layer up without
+   // changing the geometry, provided that they do not overlap any of the
+   // volumes already there, which are empty at that point. A layer is
+   // merged only if all of its volumes can be moved, after which nothing
+   // is left on it but empty copies of their mothers, and it is dropped
+   // together with the entries for them in the volume tables.
+   // Each merged layer saves a navigation of the geometry on every step.
+   // Overlaps are looked for with the usual Geant4 surface sampling, to
+   // within the given tolerance. Returns the number of layers merged.
+
+   std::vector<int> layers;
+   std::map<vpair_t,G4LogicalVolume*>::iterator witer;
+   for (witer = fLogicalVolumes.lower_bound(vpair_t(fWorldVolume,0));
+        witer != fLogicalVolumes.end() &&
+        witer->first.first == fWorldVolume;
+        ++witer)
+   {
+      layers.push_back(witer->first.second);
+   }
+   int merged = 0;
+   unsigned int i = 0;
+   while (i + 1 < layers.size()) {
+      if (mergeLayer(layers[i], layers[i + 1], tolerance)) {
+         G4cout << "HddsG4Builder::mergeLayers - geometry layer "
+                << layers[i] << " merged into layer " << layers[i + 1]
+                << G4endl;
+         layers.erase(layers.begin() + i);
+         ++merged;
+      }
+      else {
+         ++i;
+      }
+   }
+   return merged;
+}
+
+void HddsG4Builder::findPlacements(G4LogicalVolume* vol,
+                                   const G4RotationMatrix &rot,
+                                   const G4ThreeVector &pos, int weight,
+                                   layer_placement_map &placed) const
+{
+   // Record where vol and everything inside it sits in the world, with
+   // the volumes inside of divisions counted as appearing many times.
+
+   layer_placement_map::iterator iter = placed.find(vol);
+   if (iter == placed.end()) {
+      layer_placement_t where = {weight, rot, pos};
+      placed[vol] = where;
+   }
+   else {
+      iter->second.count += weight;
+   }
+   for (int child = 0; child < (int)vol->GetNoDaughters(); ++child) {
+      G4VPhysicalVolume* pvol = vol->GetDaughter(child);
+      G4RotationMatrix crot = rot * pvol->GetObjectRotationValue();
+      G4ThreeVector cpos = rot * pvol->GetObjectTranslation() + pos;
+      findPlacements(pvol->GetLogicalVolume(), crot, cpos,
+                     (pvol->IsReplicated())? 2 : weight, placed);
+   }
+}
+
+bool HddsG4Builder::mergeLayer(int layer, int into, double tolerance)
+{
+   G4LogicalVolume* world = fLogicalVolumes[vpair_t(fWorldVolume,layer)];
+   G4LogicalVolume* below = fLogicalVolumes[vpair_t(fWorldVolume,into)];
+   if (world->GetMaterial() != 0)
+      return false;
+   layer_placement_map placed;
+   layer_placement_map placedInto;
+   findPlacements(world, G4RotationMatrix(), G4ThreeVector(), 1, placed);
+   findPlacements(below, G4RotationMatrix(), G4ThreeVector(), 1, placedInto);
+
+   // Find the volumes with a material that are placed directly inside
+   // of empty mother volumes on this layer, which are the ones to move.
+
+   std::vector<G4VPhysicalVolume*> moving;
+   std::vector<G4LogicalVolume*> mothers;
+   std::vector<G4LogicalVolume*> empties(1, world);
+   std::set<G4LogicalVolume*> visited;
+   while (empties.size() > 0) {
+      G4LogicalVolume* mother = empties.back();
+      empties.pop_back();
+      if (! visited.insert(mother).second)
+         continue;
+      for (int child = 0; child < (int)mother->GetNoDaughters(); ++child) {
+         G4VPhysicalVolume* pvol = mother->GetDaughter(child);
+         if (pvol->GetLogicalVolume()->GetMaterial() != 0) {
+            moving.push_back(pvol);
+            mothers.push_back(mother);
+         }
+         else {
+            empties.push_back(pvol->GetLogicalVolume());
+         }
+      }
+   }
+
+   // Each one goes into the copy of its mother on the layer up, which
+   // must be placed once only, at the same place, and have the same
+   // field, and it must not overlap anything already inside of it.
+
+   std::vector<G4VPhysicalVolume*> added;
+   bool mergeable = true;
+   for (unsigned int n=0; mergeable && n < moving.size(); ++n) {
+      int volume_id, mother_layer;
+      std::map<vpair_t,G4LogicalVolume*>::iterator target;
+      target = fLogicalVolumes.end();
+      if (findVolume(mothers[n], volume_id, mother_layer))
+         target = fLogicalVolumes.find(vpair_t(volume_id,into));
+      layer_placement_map::iterator here = placed.find(mothers[n]);
+      layer_placement_map::iterator there;
+      if (moving[n]->IsReplicated() || here->second.count != 1 ||
+          target == fLogicalVolumes.end() ||
+          (there = placedInto.find(target->second)) == placedInto.end() ||
+          there->second.count != 1 ||
+          (there->second.pos - here->second.pos).mag() > 1e-6*mm ||
+          ! there->second.rot.isNear(here->second.rot, 1e-9) ||
+          target->second->GetFieldManager() != mothers[n]->GetFieldManager())
+      {
+         mergeable = false;
+         break;
+      }
+      G4PVPlacement *pvol = new G4PVPlacement(moving[n]->GetRotation(),
+                                              moving[n]->GetTranslation(),
+                                              moving[n]->GetLogicalVolume(),
+                                              moving[n]->GetName(),
+                                              target->second, 0,
+                                              moving[n]->GetCopyNo());
+      added.push_back(pvol);
+      if (pvol->CheckOverlaps(1000, tolerance, false))
+         mergeable = false;
+   }
+   if (! mergeable) {
+      for (unsigned int n=0; n < added.size(); ++n) {
+         added[n]->GetMotherLogical()->RemoveDaughter(added[n]);
+         delete added[n];
+      }
+      return false;
+   }
+
+   std::map<G4VPhysicalVolume*,G4VPhysicalVolume*> replaced;
+   for (unsigned int n=0; n < moving.size(); ++n) {
+      replaced[moving[n]] = added[n];
+      mothers[n]->RemoveDaughter(moving[n]);
+      delete moving[n];
+   }
+   std::map<vpair_t,G4VPhysicalVolume*>::iterator piter;
+   for (piter = fPhysicalVolumes.begin();
+        piter != fPhysicalVolumes.end(); ++piter)
+   {
+      if (replaced.find(piter->second) != replaced.end())
+         piter->second = replaced[piter->second];
+   }
+
+   // The empty mothers left behind on the dropped layer are no longer
+   // part of the model, so they are taken out of the volume tables. The
+   // volumes that were moved keep their entries.
+
+   std::map<vpair_t,G4LogicalVolume*>::iterator liter;
+   for (liter = fLogicalVolumes.begin(); liter != fLogicalVolumes.end();) {
+      if (liter->first.second == layer &&
+          visited.find(liter->second) != visited.end())
+      {
+         int lvid = liter->second->GetInstanceID();
+         if (lvid >= 0 && lvid < (int)fVolumeIndex.size())
+            fVolumeIndex[lvid] = vpair_t(-1,-1);
+         fLogicalVolumes.erase(liter++);
+      }
+      else {
+         ++liter;
+      }
+   }
+   return true;
+}
+
+int HddsG4Builder::buildStrawRings(int minstraws)
+{
+   // Replace the rings of at least minstraws straw tubes found anywhere
+   // in the geometry with GlueXStrawRing volumes, which place each of
+   // them by their position around the ring instead of individually.
+   // The placements recorded for the replaced straws are pointed at the
+   // ring that took their place. Returns the number of rings made.
+
+   std::set<G4LogicalVolume*> mothers;
+   std::map<vpair_t,G4LogicalVolume*>::iterator liter;
+   for (liter = fLogicalVolumes.begin();
+        liter != fLogicalVolumes.end(); ++liter)
+   {
+      mothers.insert(liter->second);
+   }
+   int rings = 0;
+   std::map<G4VPhysicalVolume*,G4VPhysicalVolume*> replaced;
+   std::set<G4LogicalVolume*>::iterator miter;
+   for (miter = mothers.begin(); miter != mothers.end(); ++miter)
+      rings += GlueXStrawRing::Convert(*miter, minstraws, replaced);
+
+   std::map<vpair_t,G4VPhysicalVolume*>::iterator piter;
+   for (piter = fPhysicalVolumes.begin();
+        piter != fPhysicalVolumes.end(); ++piter)
+   {
+      if (replaced.find(piter->second) != replaced.end())
+         piter->second = replaced[piter->second];
+   }
+   return rings;
+}
+
+int HddsG4Builder::tuneSmartless()
+{
+   // Override the voxel quality factor of volumes from control.in, if a
+   // card SMARTLESS:<volume> is present for the hdds name of the volume,
+   // or else a card SMARTLESS that applies to all volumes. Only those
+   // with daughters are listed, since no others have voxels. Returns
+   // the number of volumes whose quality factor was changed.
+
+   GlueXUserOptions *user_opts = GlueXUserOptions::GetInstance();
+   if (user_opts == 0)
+      return 0;
+   std::map<int, double> all_opts;
+   double all_smartless = 0;
+   if (user_opts->Find("SMARTLESS", all_opts))
+      all_smartless = all_opts[1];
+   int tuned = 0;
+   std::map<vpair_t,G4LogicalVolume*>::iterator iter;
+   for (iter = fLogicalVolumes.begin(); iter != fLogicalVolumes.end(); ++iter)
+   {
+      G4LogicalVolume *lvol = iter->second;
+      if (lvol->GetNoDaughters() == 0)
+         continue;
+      std::map<vpair_t,G4LogicalVolume*>::iterator base;
+      base = fLogicalVolumes.find(vpair_t(iter->first.first,0));
+      std::string name((base != fLogicalVolumes.end())?
+                       base->second->GetName() : lvol->GetName());
+      std::map<int, double> smart_opts;
+      std::string key("SMARTLESS:" + name);
+      double smartless = all_smartless;
+      if (user_opts->Find(key.c_str(), smart_opts))
+         smartless = smart_opts[1];
+      if (smartless > 0 && smartless != lvol->GetSmartless()) {
+         lvol->SetSmartless(smartless);
+         ++tuned;
+      }
+   }
+   return tuned;
+}
+
+int HddsG4Builder::findDivisions()
+{
+   // Make the list of all of the division volumes placed anywhere in
+   // the geometry layers, each one once. This is done after the model
+   // is complete, since volumes can be moved between layers after they
+   // are built, and the model may come from the geometry cache. Returns
+   // the number of divisions found.
+
+   fDivisions.clear();
+   std::set<G4LogicalVolume*> visited;
+   for (int layer=0; getWorldVolume(layer) != 0; ++layer) {
+      std::vector<G4LogicalVolume*> volumes(1, getWorldVolume(layer));
+      while (volumes.size() > 0) {
+         G4LogicalVolume *vol = volumes.back();
+         volumes.pop_back();
+         if (! visited.insert(vol).second)
+            continue;
+         for (int child = 0; child < (int)vol->GetNoDaughters(); ++child) {
+            G4VPhysicalVolume *pvol = vol->GetDaughter(child);
+            if (dynamic_cast<G4PVDivision*>(pvol))
+               fDivisions.push_back(pvol);
+            volumes.push_back(pvol->GetLogicalVolume());
+         }
+      }
+   }
+   return fDivisions.size();
+}
+
+const std::vector<G4VPhysicalVolume*> &HddsG4Builder::getDivisions() const
+{
+   return fDivisions;
+}
+
 void HddsG4Builder::addReflections(int volume_id)
 {
 #ifdef LINUX_CPUTIME_PROFILING
@@ -1743,14 +2417,33 @@ void HddsG4Builder::addReflections(int volume_id)
 #endif
 }
 
-int HddsG4Builder::getVolumeId(G4LogicalVolume* vol) const
+void HddsG4Builder::indexVolume(const vpair_t &key, G4LogicalVolume* vol)
 {
-   std::map<vpair_t,G4LogicalVolume*>::const_iterator iter;
-   for (iter = fLogicalVolumes.begin(); iter != fLogicalVolumes.end(); ++iter)
+   int lvid = vol->GetInstanceID();
+   if (lvid >= (int)fVolumeIndex.size())
+      fVolumeIndex.resize(lvid + 1, vpair_t(-1,-1));
+   fVolumeIndex[lvid] = key;
+}
+
+bool HddsG4Builder::findVolume(G4LogicalVolume* vol,
+                               int &volume_id, int &layer) const
+{
+   int lvid = vol->GetInstanceID();
+   if (lvid < 0 || lvid >= (int)fVolumeIndex.size() ||
+       fVolumeIndex[lvid].first < 0)
    {
-      if (iter->second == vol) {
-         return iter->first.first;
-      }
+      return false;
+   }
+   volume_id = fVolumeIndex[lvid].first;
+   layer = fVolumeIndex[lvid].second;
+   return true;
+}
+
+int HddsG4Builder::getVolumeId(G4LogicalVolume* vol) const
+{
+   int volume_id, layer;
+   if (findVolume(vol, volume_id, layer)) {
+      return volume_id;
    }
    G4cerr << "HddsG4Builder::getVolumeId error - "
           << "logical volume " << vol->GetName()
@@ -1759,7 +2452,31 @@ int HddsG4Builder::getVolumeId(G4LogicalVolume* vol) const
    exit(1);
 }
 
+const std::vector<HddsG4Builder::vpair_t> &HddsG4Builder::getVolumeIndex() const
+{
+   return fVolumeIndex;
+}
+
 const std::map<int, G4LogicalVolume*> HddsG4Builder::getSensitiveVolumes() const
 {
    return fSensitiveVolumes;
 }
+
+const std::map<int, G4FieldManager*> HddsG4Builder::getFieldManagers() const
+{
+   return fFieldManagers;
+}
+
+const std::map<int, G4Region*> HddsG4Builder::getRegions() const
+{
+   return fRegions;
+}
+
+std::string HddsG4Builder::getRegionName(int iregion) const
+{
+   std::map<int, std::string>::const_iterator iter;
+   iter = fRegionNames.find(iregion);
+   if (iter != fRegionNames.end())
+      return iter->second;
+   return "";
+}
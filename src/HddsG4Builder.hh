@@ -30,6 +30,7 @@ using namespace xercesc;
 #include <G4Material.hh>
 #include <G4MagneticField.hh>
 #include <G4FieldManager.hh>
+#include <G4Region.hh>
 #include <G4LogicalVolume.hh>
 #include <G4RotationMatrix.hh>
 #include <G4PVPlacement.hh>
@@ -50,10 +51,16 @@ using namespace xercesc;
 
 #include <map>
 #include <vector>
+#include <string>
+
+class G4Mag_EqRhs;
+class G4MagIntegratorStepper;
 
 class HddsG4Builder : public CodeWriter
 {
  public:
+   typedef std::pair<int,int> vpair_t;  // (volume id, layer index)
+
    HddsG4Builder();
    HddsG4Builder(const HddsG4Builder &src);
    HddsG4Builder &operator=(const HddsG4Builder &src);
@@ -78,20 +85,56 @@ class HddsG4Builder : public CodeWriter
 
    G4LogicalVolume* getWorldVolume(int parallel=0) const;
                                          // return ptr to world volume
+   int mergeLayers(double tolerance=0);  // merge non-overlapping layers
+   int buildStrawRings(int minstraws);   // replace straws by GlueXStrawRing
+   int tuneSmartless();                  // apply SMARTLESS cards
+   int findDivisions();                  // fill the list of divisions
+   const std::vector<G4VPhysicalVolume*> &getDivisions() const;
+                                         // read-only access to fDivisions
    int getVolumeId(G4LogicalVolume* vol) const;
-                                         // reverse-find in fLogicalVolumes
+                                         // reverse-find in fVolumeIndex
+   bool findVolume(G4LogicalVolume* vol,
+                   int &volume_id, int &layer) const;
+                                         // same, returning false on a miss
+   const std::vector<vpair_t> &getVolumeIndex() const;
+                                         // read-only access to fVolumeIndex
    const std::map<int,G4LogicalVolume*> getSensitiveVolumes() const;
                                          // read-only access to fSensitiveVolumes
+   const std::map<int,G4FieldManager*> getFieldManagers() const;
+                                         // read-only access to fFieldManagers
+   std::string getRegionName(int iregion) const;
+                                         // return hdds name of field region
+   const std::map<int,G4Region*> getRegions() const;
+                                         // read-only access to fRegions
+
+   static G4MagIntegratorStepper* createStepper(const std::string &name,
+                                                G4Mag_EqRhs *eqn);
+                                         // construct stepper by class name
 
+   int pruneSubsystems(DOMDocument* document);
+                                         // apply SUBSYSOMIT/ENVELOPE cards
    void translate(DOMElement* topel);	 // invokes the main translator
 
  private:
-   typedef std::pair<int,int> vpair_t;
+   friend class GlueXGeometryCache;      // saves and restores the model
 
    std::map<vpair_t,G4LogicalVolume*>::iterator
    addNewLayer(int volume_id, int layer); // generate code for geometry layers
    void addReflections(int volume_id);    // propagate volume to other layers
 
+   // global position and orientation of a logical volume in the world
+   // of a layer, with a count above 1 if it appears more than once
+   struct layer_placement_t {
+      int count;
+      G4RotationMatrix rot;
+      G4ThreeVector pos;
+   };
+   typedef std::map<G4LogicalVolume*,layer_placement_t> layer_placement_map;
+   void findPlacements(G4LogicalVolume* vol, const G4RotationMatrix &rot,
+                       const G4ThreeVector &pos, int weight,
+                       layer_placement_map &placed) const;
+   bool mergeLayer(int layer, int into, double tolerance);
+
    int fWorldVolume;
 
    // many-to-one maps from volume id to attribute pointer
@@ -101,16 +144,102 @@ class HddsG4Builder : public CodeWriter
    std::map<int,G4FieldManager*> fFieldManagers;
    std::map<int,G4RotationMatrix*> fRotations;
 
+   // one-to-one map from region id to the hdds name of the region
+   std::map<int,std::string> fRegionNames;
+
+   // optional tuning of the tracking in a field region, taken from the
+   // swim element of the region in hdds, or from control.in cards of
+   // the form SWIMTUNE:<region> which take precedence; zero or empty
+   // values leave the corresponding builder default in place
+   struct swim_tuning_t {
+      std::string stepper;       // stepper class name, see createStepper
+      double minStep;            // chord finder minimum step (G4 units)
+      double deltaChord;         // max miss distance of chord (G4 units)
+      double deltaIntersection;  // boundary intersection accuracy
+      double deltaOneStep;       // position accuracy of each step
+   };
+   void getSwimTuning(const std::string &region,
+                      swim_tuning_t &tune) const;
+   G4FieldManager* createFieldManager(G4MagneticField *fld,
+                                      const swim_tuning_t &tune,
+                                      const std::string &defaultStepper,
+                                      double defaultDeltaChord);
+
+   // optional production cuts and user limits of a region, taken from
+   // the productionCuts and userLimits elements of the region in hdds,
+   // or from control.in cards of the form REGIONCUTS:<region> and
+   // REGIONLIMITS:<region> which take precedence; zero values leave the
+   // defaults of the physics list in place. Regions that end up with
+   // any of them get a G4Region of their own, kept in fRegions.
+   struct region_limits_t {
+      double cuts[4];            // range cuts for gamma, e-, e+, proton
+      double maxStep;            // G4UserLimits, in G4 units
+      double minEkin;
+      double maxTime;
+   };
+   void getRegionLimits(const std::string &region,
+                        region_limits_t &limits) const;
+   void createRegionLimits(int iregion, const region_limits_t &limits);
+   std::map<int,G4Region*> fRegions;
+
+   // description of the magnetic field of a region as found in hdds,
+   // from which its field and field manager are built, kept so that
+   // they can be rebuilt without the hdds document
+   enum field_type_t {
+      kNoFieldElement,
+      kNoBfield,
+      kUniformBfield,
+      kMappedBfield,
+      kComputedBfield
+   };
+   struct field_grid_t {
+      int cylindrical;           // 0 for a cartesian grid
+      int samples[4];            // arguments to AddCartesianGrid or
+      int order[4];              // AddCylindricalGrid, by axis index,
+      int sense[4];              // except order, which holds the position
+                                 // (1..3) of axis i+1 in the samples at i
+      double lower[4];
+      double upper[4];
+   };
+   struct region_field_t {
+      int type;                  // field_type_t
+      double B[3];               // uniform field, or maximum in B[0]
+      double unit;               // field unit conversion
+      double R[9];               // rotation and origin of the region
+      double O[3];
+      std::string function;      // computed field function
+      std::string method;        // swim method
+      double maxArcStep;
+      swim_tuning_t tune;        // tuning from hdds, before control.in
+      region_limits_t limits;    // limits from hdds, before control.in
+      std::vector<field_grid_t> grids;
+      std::string mapfile;
+   };
+   void createRegionField(int iregion, const region_field_t &field);
+   void createRegionMaps(int iregion, const region_field_t &field);
+   std::map<int,region_field_t> fRegionFields;
+
    // one-to-one map from (volume id, layer index) to logical volume,
    // keeps track of each named volume as it is initially populated
    // (layer=0), and then any subsequent reflections, indexed by layer
    std::map<vpair_t,G4LogicalVolume*> fLogicalVolumes;
 
+   // inverse of fLogicalVolumes, from the instance id of each logical
+   // volume to its (volume id, layer index), or (-1,-1) for instance
+   // ids that do not belong to a hdds volume, filled by indexVolume
+   // as new logical volumes are entered in fLogicalVolumes
+   std::vector<vpair_t> fVolumeIndex;
+   void indexVolume(const vpair_t &key, G4LogicalVolume* vol);
+
    // one-to-one map from (volume id, copy number) to physical volume,
    // keeps track of each named volume as it is initially placed,
    // whatever the layer; placement of reflections is not stored here
    std::map<vpair_t,G4VPhysicalVolume*> fPhysicalVolumes;
 
+   // every G4PVDivision in the model, on all layers, found once by
+   // findDivisions after the model is complete, for GlueXRunAction
+   std::vector<G4VPhysicalVolume*> fDivisions;
+
    // one-to-one map from volume id to logical volume for sensitive volumes
    std::map<int,G4LogicalVolume*> fSensitiveVolumes;
 
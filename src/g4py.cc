@@ -17,9 +17,17 @@
 #include <GlueXSteppingVerbose.hh>
 #include <GlueXPhysicsList.hh>
 
+#include <GlueXPointProbe.hh>
+
 #include <G4SystemOfUnits.hh>
 #include <G4OpenGLViewer.hh>
 #include <G4TransportationManager.hh>
+#include <G4PhysicalVolumeStore.hh>
+#include <G4Material.hh>
+
+#include <thread>
+#include <vector>
+#include <map>
 
 // We must wrap an abstract C++ type so python 
 // knows how to override pure virtual methods.
@@ -109,6 +117,146 @@ bool GetGlobalExitNormal(int world, G4ThreeVector *point,
    return 0;
 }
 
+// Probe the geometry and magnetic field at many points in one call, for
+// geometry validation and field map comparisons, in place of scraping
+// the output of pickPoint3D for each point. The arguments are sequences
+// of x, y and z in cm, anything that numpy can turn into arrays, and the
+// results are returned in a dict of numpy arrays, one entry per point:
+//   "volume"   - index of the physical volume in "volume_names", or -1
+//   "copy"     - copy number of the volume
+//   "layer"    - the geometry layer (world) where the point was found
+//   "material" - index of the material in "material_names", or -1
+//   "Bx","By","Bz" - magnetic field in Tesla
+// The point is found in each layer in turn from the top, as with
+// picking, and taken from the first layer where it lies in a volume
+// with a material. The python interpreter is released during the
+// search, and the points are divided between nthreads threads. Each
+// thread has its own navigators, copies of the geometry split classes
+// and copies of the field maps, which keep a cache of the last lookup.
+
+static double *numpy_data(boost::python::object array)
+{
+   using boost::python::extract;
+   boost::python::object iface = array.attr("__array_interface__");
+   boost::python::tuple data = extract<boost::python::tuple>(iface["data"]);
+   return reinterpret_cast<double*>((size_t)extract<size_t>(data[0]));
+}
+
+struct probe_job_t {
+   long int npoints;
+   const double *x, *y, *z;
+   int *volume, *copy, *layer, *material;
+   double *Bx, *By, *Bz;
+   const GlueXPointProbe *probe;
+};
+
+static void probe_range(const probe_job_t *job, long int first,
+                        long int last, bool worker)
+{
+   GlueXPointProbe::Locator locator(job->probe, worker);
+   for (long int n=first; n < last; ++n) {
+      G4ThreeVector point(job->x[n] * cm, job->y[n] * cm, job->z[n] * cm);
+      GlueXPointProbe::point_t found;
+      locator.Locate(point, found);
+      job->volume[n] = found.volume;
+      job->copy[n] = found.copy;
+      job->layer[n] = found.layer;
+      job->material[n] = found.material;
+      job->Bx[n] = found.B[0] / tesla;
+      job->By[n] = found.B[1] / tesla;
+      job->Bz[n] = found.B[2] / tesla;
+   }
+}
+
+boost::python::dict probePoints(boost::python::object x,
+                                boost::python::object y,
+                                boost::python::object z,
+                                int nthreads=1)
+{
+   using boost::python::object;
+   object numpy = boost::python::import("numpy");
+   object xarr = numpy.attr("ascontiguousarray")(x, "float64");
+   object yarr = numpy.attr("ascontiguousarray")(y, "float64");
+   object zarr = numpy.attr("ascontiguousarray")(z, "float64");
+   long int npoints = boost::python::len(xarr);
+   if (boost::python::len(yarr) != npoints ||
+       boost::python::len(zarr) != npoints)
+   {
+      PyErr_SetString(PyExc_ValueError,
+                      "probePoints: x, y and z must have the same length");
+      boost::python::throw_error_already_set();
+   }
+   object volume = numpy.attr("zeros")(npoints, "int32");
+   object copy = numpy.attr("zeros")(npoints, "int32");
+   object layer = numpy.attr("zeros")(npoints, "int32");
+   object material = numpy.attr("zeros")(npoints, "int32");
+   object Bx = numpy.attr("zeros")(npoints, "float64");
+   object By = numpy.attr("zeros")(npoints, "float64");
+   object Bz = numpy.attr("zeros")(npoints, "float64");
+
+   probe_job_t job;
+   job.npoints = npoints;
+   job.x = numpy_data(xarr);
+   job.y = numpy_data(yarr);
+   job.z = numpy_data(zarr);
+   job.volume = (int*)numpy_data(volume);
+   job.copy = (int*)numpy_data(copy);
+   job.layer = (int*)numpy_data(layer);
+   job.material = (int*)numpy_data(material);
+   job.Bx = numpy_data(Bx);
+   job.By = numpy_data(By);
+   job.Bz = numpy_data(Bz);
+
+   GlueXPointProbe probe;
+   job.probe = &probe;
+   boost::python::list volume_names;
+   G4PhysicalVolumeStore *pvstore = G4PhysicalVolumeStore::GetInstance();
+   for (unsigned int i=0; i < pvstore->size(); ++i)
+      volume_names.append(std::string((*pvstore)[i]->GetName()));
+   boost::python::list material_names;
+   const G4MaterialTable *mtable = G4Material::GetMaterialTable();
+   for (unsigned int i=0; i < mtable->size(); ++i)
+      material_names.append(std::string((*mtable)[i]->GetName()));
+
+#ifndef G4MULTITHREADED
+   nthreads = 1;
+#endif
+   if (nthreads < 1)
+      nthreads = 1;
+   if (nthreads > npoints)
+      nthreads = (npoints > 0)? npoints : 1;
+
+   PyThreadState *pystate = PyEval_SaveThread();
+   if (nthreads == 1) {
+      probe_range(&job, 0, npoints, false);
+   }
+   else {
+      std::vector<std::thread> threads;
+      for (int t=0; t < nthreads; ++t) {
+         long int first = npoints * t / nthreads;
+         long int last = npoints * (t + 1) / nthreads;
+         threads.push_back(std::thread(probe_range, &job, first, last, true));
+      }
+      for (int t=0; t < nthreads; ++t)
+         threads[t].join();
+   }
+   PyEval_RestoreThread(pystate);
+
+   boost::python::dict result;
+   result["volume"] = volume;
+   result["copy"] = copy;
+   result["layer"] = layer;
+   result["material"] = material;
+   result["Bx"] = Bx;
+   result["By"] = By;
+   result["Bz"] = Bz;
+   result["volume_names"] = volume_names;
+   result["material_names"] = material_names;
+   return result;
+}
+
+BOOST_PYTHON_FUNCTION_OVERLOADS(probePoints_overloads, probePoints, 3, 4)
+
 // Create a python module containing all of the G4 user classes
 // that are needed to run the HDGeant simulation from python.
 // Here it is named libhdgeant4 (happens to also be the name of
@@ -254,6 +402,8 @@ BOOST_PYTHON_MODULE(libhdgeant4)
    ;
 
    def("pickPoint3D", pickPoint3D);
+   def("probePoints", probePoints, probePoints_overloads(
+       boost::python::args("x", "y", "z", "nthreads")));
    def("GetNavigator", GetNavigator,
        boost::python::return_value_policy<boost::python::reference_existing_object>());
    def("GetGlobalExitNormal", GetGlobalExitNormal);
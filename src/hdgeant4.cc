@@ -9,8 +9,19 @@
 #include <GlueXDetectorConstruction.hh>
 #include <GlueXUserActionInitialization.hh>
 #include <GlueXPhysicsList.hh>
+#include <GlueXMagneticField.hh>
+#include <GlueXSwimTuner.hh>
+#include <GlueXOverlapChecker.hh>
+#include <GlueXThreadAffinity.hh>
+#include <GlueXUserWorkerInitialization.hh>
+#include <GlueXUserEventInformation.hh>
+#include <GlueXProcessPool.hh>
+#include <GlueXCheckpoint.hh>
+#include <GlueXQueryServer.hh>
+#include <GlueXForkRunManager.hh>
 #include <HddmOutput.hh>
 #include <Randomize.hh>
+#include <G4SystemOfUnits.hh>
 
 #include <DANA/DApplication.h>
 #include <unistd.h>
@@ -39,6 +50,25 @@ void usage()
           << "    -v : open a graphics window for visualization" << G4endl
           << "    -tN : start N worker threads, default 1" << G4endl
           << "    -rN : set run to N, default taken from control.in" << G4endl
+          << "    -c : write binary caches of the field maps and exit" << G4endl
+          << "    -s : benchmark swim settings in the field regions and exit"
+          << G4endl
+          << "    -m : merge the output shards of OUTFILE and exit" << G4endl
+          << "    -o : check the geometry for overlaps and exit" << G4endl
+          << "    -p<policy> : pin worker threads to cpus by policy, one of"
+          << G4endl
+          << "                 none, compact, scatter or a cpu list like 0-7"
+          << G4endl
+          << "    -fN : run the events on N worker processes forked "
+          << "after initialization" << G4endl
+          << "          with the sequential run manager, not with -t"
+          << G4endl
+          << "    -R : resume the job from the last checkpoint of SAVEPOINT"
+          << G4endl
+          << "    -q<socket> : answer geometry and field queries on a local"
+          << G4endl
+          << "                 socket at the given path, until told to stop"
+          << G4endl
           << G4endl;
    exit(9);
 }
@@ -52,8 +82,16 @@ int main(int argc,char** argv)
    // Interpret special command-line arguments
    int use_visualization = 0;
    int worker_threads = 1;
+   int convert_field_maps = 0;
+   int tune_field_regions = 0;
+   int merge_output_shards = 0;
+   int check_overlaps = 0;
+   int fork_processes = 0;
+   int resume_job = 0;
+   std::string pin_policy;
+   std::string query_socket;
    int c;
-   while ((c = getopt(argc, argv, "vt:r:")) != -1) {
+   while ((c = getopt(argc, argv, "vcsmoRt:r:p:f:q:")) != -1) {
       if (c == 'v') {
          use_visualization = 1;
       }
@@ -63,11 +101,41 @@ int main(int argc,char** argv)
       else if (c == 'r') {
          run_number = atoi(optarg);
       }
+      else if (c == 'c') {
+         convert_field_maps = 1;
+      }
+      else if (c == 's') {
+         tune_field_regions = 1;
+      }
+      else if (c == 'm') {
+         merge_output_shards = 1;
+      }
+      else if (c == 'o') {
+         check_overlaps = 1;
+      }
+      else if (c == 'p') {
+         pin_policy = optarg;
+      }
+      else if (c == 'f') {
+         fork_processes = atoi(optarg);
+      }
+      else if (c == 'R') {
+         resume_job = 1;
+      }
+      else if (c == 'q') {
+         query_socket = optarg;
+      }
       else {
          usage();
       }
    }
 
+   if (fork_processes > 0 && worker_threads > 1) {
+      G4cerr << "Error - the worker processes of -f run their events "
+             << "one at a time, it cannot be combined with -t." << G4endl;
+      exit(9);
+   }
+
    // Read user options from file control.in
    GlueXUserOptions opts;
    if (! opts.ReadControl_in("control.in")) {
@@ -86,11 +154,185 @@ int main(int argc,char** argv)
       }
    }
 
-   HddmOutput *hddmOut = 0;
+   // Compression of the output streams, including merged shards
+   std::map<int, std::string> compress_opts;
+   if (opts.Find("OUTCOMPRESS", compress_opts)) {
+      int compression = 0;
+      int integrity = 0;
+      std::string codec = compress_opts[1];
+      if (codec == "z" || codec == "zlib" || codec == "gzip") {
+         compression = hddm_s::k_z_compression;
+      }
+      else if (codec == "bz2" || codec == "bzip2") {
+         compression = hddm_s::k_bz2_compression;
+      }
+      else if (codec != "none") {
+         G4cerr << "Error - unknown compression " << codec
+                << " requested on the OUTCOMPRESS card in control.in, "
+                << "choose one of none, z, bz2." << G4endl;
+         exit(3);
+      }
+      if (compress_opts.find(2) != compress_opts.end()) {
+         if (compress_opts[2] == "crc32") {
+            integrity = hddm_s::k_crc32_integrity;
+         }
+         else if (compress_opts[2] != "none") {
+            G4cerr << "Error - unknown integrity check " << compress_opts[2]
+                   << " requested on the OUTCOMPRESS card in control.in, "
+                   << "choose one of none, crc32." << G4endl;
+            exit(3);
+         }
+      }
+      HddmOutput::SetCompression(compression, integrity);
+   }
+
+   // Truth information in the output, see HddmOutput::output_level_t
+   std::map<int, int> level_opts;
+   if (opts.Find("OUTLEVEL", level_opts)) {
+      if (level_opts[1] < HddmOutput::OUTPUT_HITS ||
+          level_opts[1] > HddmOutput::OUTPUT_TRUTH)
+      {
+         G4cerr << "Error - unknown output level " << level_opts[1]
+                << " requested on the OUTLEVEL card in control.in, "
+                << "choose one of 0, 1, 2." << G4endl;
+         exit(3);
+      }
+      HddmOutput::setOutputLevel(level_opts[1]);
+   }
+
+   // Merge mode (option -m), the output shards left by an earlier job
+   // with OUTSHARDS are merged into the OUTFILE
+   if (merge_output_shards) {
+      std::map<int, std::string> outfile_opts;
+      if (! opts.Find("OUTFILE", outfile_opts)) {
+         G4cerr << "Error - no OUTFILE specified in control.in, "
+                << "no output shards to merge." << G4endl;
+         exit(3);
+      }
+      HddmOutput::MergeShards(outfile_opts[1]);
+      exit(0);
+   }
+
+   // Converter mode (option -c), building the geometry reads all of
+   // the mapped field maps and rewrites their binary cache files
+   if (convert_field_maps) {
+      GlueXMappedMagField::SetMapCachePolicy(2);
+      GlueXDetectorConstruction *geometry = new GlueXDetectorConstruction();
+      delete geometry;
+      G4cout << "binary field map caches written, exiting." << G4endl;
+      exit(0);
+   }
+
+   // Tuning mode (option -s), building the geometry creates the field
+   // regions, which are then benchmarked with a range of swim settings
+   if (tune_field_regions) {
+      GlueXDetectorConstruction *geometry = new GlueXDetectorConstruction();
+      GlueXSwimTuner tuner(GlueXDetectorConstruction::GetBuilder());
+      tuner.Run();
+      delete geometry;
+      exit(0);
+   }
+
+   // Checking mode (option -o), the geometry is checked for overlaps on
+   // all of the worker threads, with the OVERLAPCHECK card giving the
+   // points per volume, the tolerance in mm and the report file name
+   if (check_overlaps) {
+      int resolution = 1000;
+      double tolerance = 0;
+      std::string reportfile("overlaps.txt");
+      std::map<int, std::string> check_opts;
+      if (opts.Find("OVERLAPCHECK", check_opts)) {
+         if (check_opts.find(1) != check_opts.end())
+            resolution = atoi(check_opts[1].c_str());
+         if (check_opts.find(2) != check_opts.end())
+            tolerance = atof(check_opts[2].c_str()) * mm;
+         if (check_opts.find(3) != check_opts.end())
+            reportfile = check_opts[3];
+      }
+      GlueXDetectorConstruction *geometry = new GlueXDetectorConstruction();
+      GlueXOverlapChecker checker(GlueXDetectorConstruction::GetBuilder());
+      int overlaps = checker.Run(worker_threads, resolution, tolerance,
+                                 reportfile);
+      delete geometry;
+      exit((overlaps > 0)? 1 : 0);
+   }
+
+   // Checkpoints (SAVEPOINT card) save the state of the job every so
+   // many events, so that a job that is killed can be resumed from the
+   // last one (option -R), appending to its output
    std::map<int, std::string> outfile_opts;
+   std::map<int, std::string> checkpoint_opts;
+   if (opts.Find("SAVEPOINT", checkpoint_opts)) {
+      std::string outfile;
+      if (opts.Find("OUTFILE", outfile_opts))
+         outfile = outfile_opts[1];
+      std::string ckpfile((outfile.size() > 0)? outfile + ".ckp" :
+                                                "hdgeant4.ckp");
+      if (checkpoint_opts.find(2) != checkpoint_opts.end())
+         ckpfile = checkpoint_opts[2];
+      std::map<int, int> shard_opts;
+      std::map<int, int> postsmear_opts;
+      if (worker_threads > 1 || fork_processes > 0 ||
+          opts.Find("OUTSHARDS", shard_opts) ||
+          (opts.Find("POSTSMEAR", postsmear_opts) && postsmear_opts[1] == 2))
+      {
+         G4cerr << "Warning - checkpoints need the events to be done "
+                << "one at a time into a single output file, they cannot "
+                << "be taken with -t, -f, OUTSHARDS or POSTSMEAR 2, "
+                << "continuing without them." << G4endl;
+      }
+      else {
+         GlueXCheckpoint::Configure(atoi(checkpoint_opts[1].c_str()),
+                                    ckpfile, outfile);
+         if (resume_job)
+            GlueXCheckpoint::Resume();
+      }
+   }
+   else if (resume_job) {
+      G4cerr << "Error - no SAVEPOINT card in control.in, "
+             << "there is no checkpoint to resume from." << G4endl;
+      exit(3);
+   }
+
+   HddmOutput *hddmOut = 0;
    if (opts.Find("OUTFILE", outfile_opts)) {
-      hddmOut = new HddmOutput(outfile_opts[1]);
-      hddmOut->setRunNo(run_number);
+      int depth = 64;
+      int window = 0;
+      std::map<int, int> writer_opts;
+      if (opts.Find("OUTWRITER", writer_opts)) {
+         depth = writer_opts[1];
+         window = writer_opts[2];
+      }
+      int shards = HddmOutput::SHARDS_NONE;
+      std::map<int, int> shard_opts;
+      if (opts.Find("OUTSHARDS", shard_opts)) {
+         shards = (shard_opts[1] != 0)? HddmOutput::SHARDS_KEPT :
+                                        HddmOutput::SHARDS_MERGED;
+      }
+      std::map<int, int> postsmear_opts;
+      if (opts.Find("POSTSMEAR", postsmear_opts) && postsmear_opts[1] == 2) {
+         if (shards != HddmOutput::SHARDS_NONE || fork_processes > 0) {
+            G4cerr << "Error - POSTSMEAR 2 streams a single output file "
+                   << "to mcsmear, it cannot be used with OUTSHARDS "
+                   << "or the -f option." << G4endl;
+            exit(3);
+         }
+         std::map<int, std::string> mcsmear_opts;
+         std::string options;
+         if (opts.Find("MCSMEAROPTS", mcsmear_opts))
+            options = mcsmear_opts[1];
+         HddmOutput::SetSmearStream(options);
+      }
+      // In fork mode (option -f) each worker process writes a shard
+      // of its own, with OUTSHARDS deciding whether they are merged
+      if (fork_processes > 0) {
+         GlueXProcessPool::SetOutput(outfile_opts[1], depth, window,
+                                     shards == HddmOutput::SHARDS_KEPT);
+      }
+      else {
+         hddmOut = new HddmOutput(outfile_opts[1], depth, window, shards);
+         hddmOut->setRunNo(run_number);
+      }
    }
 
    G4Random::setTheEngine(new CLHEP::RanecuEngine);
@@ -109,15 +351,61 @@ int main(int argc,char** argv)
       }
    }
 
+   // Each event can instead be seeded on its own from the run number and
+   // its event number, so that results do not depend on the thread that
+   // ran it, and a run can be split into shards starting at any event
+   std::map<int, int> eventseed_opts;
+   if (opts.Find("EVENTSEEDS", eventseed_opts)) {
+      long int first = (eventseed_opts.size() > 1)? eventseed_opts[2] : 1;
+      long int offset = (first > 0)? first - 1 : 0;
+      GlueXUserEventInformation::SetEventSeeding(eventseed_opts[1], offset);
+      HddmOutput::setEventNo(offset);
+   }
+
+   // The random engine continues from its state at the checkpoint
+   GlueXCheckpoint::RestoreEngine();
+
+   // Fork mode (option -f), the events of each run are divided between
+   // worker processes forked from this one once it is initialized
+   GlueXProcessPool::Configure(fork_processes);
+
    // Declare our G4VSteppingVerbose implementation
    G4VSteppingVerbose::SetInstance(new GlueXSteppingVerbose());
 
-   // Run manager handles the rest of the initialization
+   // Run manager handles the rest of the initialization. The workers in
+   // fork mode (option -f) are copies of this process, which would not
+   // have the worker threads of a G4MTRunManager, so they run their
+   // events with the sequential run manager. So do jobs that take
+   // checkpoints, so that the random engine saved with a checkpoint is
+   // the one that generates the events, and not a worker reseeded by
+   // the master for every event.
+   G4RunManager *runManager;
 #ifdef G4MULTITHREADED
-   G4MTRunManager runManager;
-   runManager.SetNumberOfThreads(worker_threads);
+   if (fork_processes > 0 || GlueXCheckpoint::IsActive()) {
+      runManager = new GlueXForkRunManager<G4RunManager>();
+   }
+   else {
+      G4MTRunManager *mtRunManager = new G4MTRunManager();
+      mtRunManager->SetNumberOfThreads(worker_threads);
+
+      // Worker threads are pinned to cpus following the policy given with
+      // the -p option, or else on the PINTHREADS card, where a non-zero
+      // second argument also replicates the field maps on each NUMA node
+      std::map<int, std::string> pin_opts;
+      int replicate = 0;
+      if (opts.Find("PINTHREADS", pin_opts)) {
+         if (pin_policy.size() == 0)
+            pin_policy = pin_opts[1];
+         if (pin_opts.find(2) != pin_opts.end())
+            replicate = atoi(pin_opts[2].c_str());
+      }
+      if (GlueXThreadAffinity::Configure(pin_policy, replicate) > 0)
+         mtRunManager->SetUserInitialization(
+                       new GlueXUserWorkerInitialization());
+      runManager = mtRunManager;
+   }
 #else
-   G4RunManager runManager;
+   runManager = new GlueXForkRunManager<G4RunManager>();
 #endif
 
    // Geometry initialization
@@ -129,16 +417,16 @@ int main(int argc,char** argv)
       GlueXParallelWorld *parallelWorld = new GlueXParallelWorld(name,topvol);
       geometry->RegisterParallelWorld(parallelWorld);
    }
-   runManager.SetUserInitialization(geometry);
+   runManager->SetUserInitialization(geometry);
 
    // Physics process initialization
-   runManager.SetUserInitialization(new GlueXPhysicsList());
+   runManager->SetUserInitialization(new GlueXPhysicsList());
     
    // User actions initialization
-   runManager.SetUserInitialization(new GlueXUserActionInitialization());
+   runManager->SetUserInitialization(new GlueXUserActionInitialization());
 
    // Initialize G4 kernel
-   runManager.Initialize();
+   runManager->Initialize();
        
    // Initialize graphics (option -v)
    G4VisManager* visManager = 0;
@@ -154,9 +442,16 @@ int main(int argc,char** argv)
 #endif
    }
 
-   // Start the user interface
+   // Start the user interface, or in query server mode (option -q)
+   // answer point queries from other programs on the initialized
+   // geometry and fields until the server is told to stop
+   int status = 0;
    G4UImanager * UImanager = G4UImanager::GetUIpointer();  
-   if (argc > optind) {   // batch mode  
+   if (query_socket.size() > 0) {
+      GlueXQueryServer server(query_socket);
+      status = server.Run();
+   }
+   else if (argc > optind) {   // batch mode  
       G4String command = "/control/execute ";
       G4String fileName = argv[optind];
       UImanager->ApplyCommand(command + fileName);
@@ -182,5 +477,7 @@ int main(int argc,char** argv)
       delete visManager;
    if (hddmOut)
       delete hddmOut;
-   return 0;
+   GlueXProcessPool::Finish();
+   delete runManager;
+   return status;
 }
@@ -0,0 +1,241 @@
+#!/usr/bin/python
+#
+# bench.py - script to run the standard hdgeant4 performance benchmarks
+#
+# Each benchmark in the bench directory next to this script is a set of
+# control.in cards laid over the control.in in this directory, with the
+# TRIG card giving the number of events to run. Every benchmark is run at
+# 1, N/2 and N worker threads, in a scratch directory of its own, with the
+# TELEMETRY card turned on so that hdgeant4 reports on the run itself.
+# The results are printed as a table, and written as one line of JSON for
+# each run, preceded by a line describing the host and the build, so that
+# results from different releases and nodes can be compared line by line.
+#
+# author: richard.t.jones at uconn.edu
+# version: october 14, 2026
+
+from __future__ import print_function
+
+import os
+import sys
+import glob
+import json
+import time
+import shutil
+import socket
+import getopt
+import subprocess
+
+benchdir = os.path.join(os.path.dirname(os.path.abspath(__file__)), "bench")
+basecontrol = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                           "control.in")
+
+# cards of the base control.in that select the event source, name the
+# output or call out to other programs, none of which may carry over
+source_cards = ["INFILE", "INSLICE", "INFILTER", "SKIP", "BEAM", "KINE",
+                "KINEMULT", "BGRATE", "BGGATE", "BGLIBRARY", "TRIG", "OUTFILE",
+                "OUTSHARDS", "POSTSMEAR", "DELETEUNSMEARED", "TELEMETRY",
+                "SAVEPOINT", "STEPPROFILE", "STEPTRACE"]
+
+def usage():
+   print("Usage: bench.py [options] [<benchmark> ...]")
+   print("  runs the named benchmarks from", benchdir)
+   print("  (default all of them), where options include:")
+   print("   -x <hdgeant4> : executable to run, default hdgeant4 in PATH")
+   print("   -t <N> : largest number of threads, default the number of cpus")
+   print("   -s <scale> : scale the number of events of each benchmark")
+   print("   -i <file.hddm> : input file for the benchmarks that read one")
+   print("   -w <dir> : scratch directory for the runs, default bench_work")
+   print("   -o <file.json> : results file, default bench_results.json")
+   print("   -l <label> : label for the results, eg. the release tag")
+   sys.exit(1)
+
+def card_name(line):
+   strt = line.strip()
+   if len(strt) == 0 or strt[0] in "cC":
+      return ""
+   return strt.split()[0].upper()
+
+def read_cards(infile):
+   cards = []
+   for line in open(infile):
+      if card_name(line):
+         cards.append(line.rstrip("\n"))
+   return cards
+
+def find_card(cards, name):
+   for line in cards:
+      if card_name(line) == name:
+         return line.split()[1:]
+   return []
+
+def write_control(cards, workdir, nevents, infile):
+   replaced = set(source_cards + [card_name(line) for line in cards])
+   out = open(os.path.join(workdir, "control.in"), "w")
+   for line in open(basecontrol):
+      name = card_name(line)
+      if name != "END" and name not in replaced:
+         out.write(line)
+   out.write("c cards of the benchmark\n")
+   for line in cards:
+      name = card_name(line)
+      if name == "TRIG":
+         out.write("TRIG {0}\n".format(nevents))
+      elif name == "INFILE":
+         out.write("INFILE '{0}'\n".format(infile))
+      else:
+         out.write(line + "\n")
+   out.write("OUTFILE 'bench.hddm'\n")
+   out.write("TELEMETRY 1e9 'telemetry.json'\n")
+   out.write("END\n")
+   out.close()
+
+def run_summary(workdir):
+   summary = {}
+   try:
+      for line in open(os.path.join(workdir, "telemetry.json")):
+         report = json.loads(line)
+         if report.get("telemetry") == "run":
+            summary = report
+   except (IOError, ValueError):
+      pass
+   return summary
+
+def run_bench(hdgeant4, name, cards, threads, nevents, infile, workdir):
+   result = {"bench": name, "threads": threads, "events": nevents}
+   rundir = os.path.join(workdir, "{0}.t{1}".format(name, threads))
+   if os.path.isdir(rundir):
+      shutil.rmtree(rundir)
+   os.makedirs(rundir)
+   write_control(cards, rundir, nevents, infile)
+   mac = open(os.path.join(rundir, "run.mac"), "w")
+   mac.write("/run/beamOn {0}\n".format(nevents))
+   mac.close()
+   log = open(os.path.join(rundir, "hdgeant4.log"), "w")
+   start = time.time()
+   status = subprocess.call([hdgeant4, "-t{0}".format(threads), "run.mac"],
+                            cwd=rundir, stdout=log, stderr=subprocess.STDOUT)
+   result["wall_s"] = round(time.time() - start, 3)
+   log.close()
+   summary = run_summary(rundir)
+   for key in ("events", "events_per_s", "event_ms_mean", "event_ms_p50",
+               "event_ms_p90", "event_ms_p99", "event_ms_max",
+               "steps_per_event", "peak_rss_kb", "hddm_bytes"):
+      if key in summary:
+         result[key] = summary[key]
+   outfile = os.path.join(rundir, "bench.hddm")
+   if os.path.exists(outfile):
+      result["output_bytes"] = os.path.getsize(outfile)
+   if status != 0:
+      result["status"] = "failed with exit code {0}".format(status)
+   elif not summary:
+      result["status"] = "no telemetry summary"
+   else:
+      result["status"] = "ok"
+   return result
+
+def describe_build(hdgeant4, label):
+   header = {"bench_suite": 1,
+             "label": label,
+             "host": socket.gethostname(),
+             "cpus": cpu_count(),
+             "date": time.strftime("%Y-%m-%dT%H:%M:%S"),
+             "hdgeant4": hdgeant4}
+   srcdir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+   try:
+      header["commit"] = subprocess.check_output(
+                         ["git", "describe", "--always", "--dirty"],
+                         cwd=srcdir, stderr=open(os.devnull, "w")
+                         ).decode().strip()
+   except (OSError, subprocess.CalledProcessError):
+      pass
+   return header
+
+def cpu_count():
+   try:
+      return os.sysconf("SC_NPROCESSORS_ONLN")
+   except (ValueError, OSError):
+      return 1
+
+def print_result(result):
+   if result["status"] != "ok":
+      print("{0:16s} {1:4d} {2:8d}  {3}".format(result["bench"],
+            result["threads"], result["events"], result["status"]))
+      return
+   print("{0:16s} {1:4d} {2:8d} {3:9.2f} {4:9.1f} {5:9.1f} {6:9.1f} "
+         "{7:10.1f} {8:10d} {9:12d}".format(result["bench"],
+         result["threads"], result["events"], result["events_per_s"],
+         result["event_ms_mean"], result["event_ms_p50"],
+         result["event_ms_p99"], result["event_ms_max"],
+         result["peak_rss_kb"] // 1024, result.get("output_bytes", 0)))
+
+def main(argv):
+   hdgeant4 = "hdgeant4"
+   maxthreads = cpu_count()
+   scale = 1.0
+   infile = ""
+   workdir = "bench_work"
+   output = "bench_results.json"
+   label = ""
+   try:
+      opts, args = getopt.getopt(argv, "x:t:s:i:w:o:l:h")
+   except getopt.GetoptError:
+      usage()
+   for opt, arg in opts:
+      if opt == "-x":
+         hdgeant4 = os.path.abspath(arg)
+      elif opt == "-t":
+         maxthreads = int(arg)
+      elif opt == "-s":
+         scale = float(arg)
+      elif opt == "-i":
+         infile = os.path.abspath(arg)
+      elif opt == "-w":
+         workdir = arg
+      elif opt == "-o":
+         output = arg
+      elif opt == "-l":
+         label = arg
+      else:
+         usage()
+
+   benches = args
+   if len(benches) == 0:
+      benches = sorted([os.path.basename(f)[:-3]
+                        for f in glob.glob(os.path.join(benchdir, "*.in"))])
+   threads = sorted(set([1, max(1, maxthreads // 2), max(1, maxthreads)]))
+
+   results = open(output, "w")
+   header = describe_build(hdgeant4, label)
+   results.write(json.dumps(header, sort_keys=True) + "\n")
+   print("{0:16s} {1:>4s} {2:>8s} {3:>9s} {4:>9s} {5:>9s} {6:>9s} "
+         "{7:>10s} {8:>10s} {9:>12s}".format("benchmark", "thr", "events",
+         "events/s", "mean(ms)", "p50(ms)", "p99(ms)", "max(ms)",
+         "rss(MB)", "output(B)"))
+   for name in benches:
+      control = os.path.join(benchdir, name + ".in")
+      if not os.path.exists(control):
+         print("bench.py error - no benchmark", name, "in", benchdir)
+         sys.exit(2)
+      cards = read_cards(control)
+      trig = find_card(cards, "TRIG")
+      nevents = max(1, int(int(trig[0] if trig else 100) * scale))
+      source = infile
+      if find_card(cards, "INFILE"):
+         if not source:
+            source = os.path.join(benchdir,
+                                  find_card(cards, "INFILE")[0].strip("'"))
+         if not os.path.exists(source):
+            print("{0:16s} skipped, input file {1} not found, give one "
+                  "with -i".format(name, source))
+            continue
+      for nthreads in threads:
+         result = run_bench(hdgeant4, name, cards, nthreads, nevents,
+                            source, workdir)
+         results.write(json.dumps(result, sort_keys=True) + "\n")
+         results.flush()
+         print_result(result)
+   results.close()
+
+if __name__ == "__main__":
+   main(sys.argv[1:])
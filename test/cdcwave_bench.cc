@@ -0,0 +1,131 @@
+//
+// cdcwave_bench.cc
+//
+// purpose: Benchmark of the CDC drift-cluster waveform synthesis and
+//          threshold scan, comparing the full readout window with a
+//          freshly allocated sample buffer (as before) against the
+//          window-limited scan over a reused buffer (as now)
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// usage: cdcwave_bench [<nstraws>] [<ntracks_per_straw>]
+//
+// The straws are filled with synthetic clusters resembling those from
+// a high-occupancy beam background event: each straw is crossed by a
+// Poisson-distributed number of tracks at random times in the readout
+// window, each contributing a train of clusters spread over the drift
+// time of the straw. The ASIC response uses the built-in default
+// parameters, since ccdb is not consulted here.
+//
+
+#include <GlueXSensitiveDetectorCDC.hh>
+#include <GlueXHitCDCstraw.hh>
+
+#include <G4Timer.hh>
+#include <G4SystemOfUnits.hh>
+#include <Randomize.hh>
+#include <CLHEP/Random/RandPoisson.h>
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+
+int run_number = 0;
+
+bool earlier(const GlueXHitCDCstraw::hitinfo_t &a,
+             const GlueXHitCDCstraw::hitinfo_t &b)
+{
+   return a.t_ns < b.t_ns;
+}
+
+int scan(const double *samples, int first, int last)
+{
+   // count the pulses over a 1 mV threshold, as done in EndOfEvent
+
+   int pulses = 0;
+   int over_threshold = 0;
+   for (int i=first; i < last; ++i) {
+      if (samples[i] >= 1.) {
+         pulses += (over_threshold == 0);
+         over_threshold = 1;
+      }
+      else {
+         over_threshold = 0;
+      }
+   }
+   return pulses;
+}
+
+int main(int argc, char *argv[])
+{
+   int nstraws = (argc > 1)? atoi(argv[1]) : 10000;
+   double ntracks = (argc > 2)? atof(argv[2]) : 2.;
+   const int num_samples = 1000;
+
+   GlueXSensitiveDetectorCDC::InitAsicKernel();
+
+   std::vector<GlueXHitCDCstraw*> straws;
+   long int nclusters = 0;
+   for (int n=0; n < nstraws; ++n) {
+      GlueXHitCDCstraw *straw = new GlueXHitCDCstraw(1, n + 1);
+      int ntrk = CLHEP::RandPoisson::shoot(ntracks) + 1;
+      for (int itrk=0; itrk < ntrk; ++itrk) {
+         double t0 = G4UniformRand() * 800;
+         double tdrift = G4UniformRand() * 200;
+         int ncl = 20 + int(G4UniformRand() * 40);
+         for (int icl=0; icl < ncl; ++icl) {
+            GlueXHitCDCstraw::hitinfo_t hit;
+            hit.t_ns = t0 + tdrift * (G4UniformRand() + icl) / ncl;
+            int n_s = CLHEP::RandPoisson::shoot(1.94);
+            hit.q_fC = 1e5 * 1.6022e-4 * (1 + n_s);
+            hit.d_cm = 0;
+            hit.itrack_ = 0;
+            hit.ptype_G3 = 0;
+            hit.t0_ns = t0;
+            hit.z_cm = 0;
+            straw->hits.push_back(hit);
+         }
+      }
+      std::sort(straw->hits.begin(), straw->hits.end(), earlier);
+      nclusters += straw->hits.size();
+      straws.push_back(straw);
+   }
+   std::cout << nstraws << " straws with " << nclusters / double(nstraws)
+             << " clusters per straw on average" << std::endl;
+
+   G4Timer timer;
+   long int pulses_full = 0;
+   timer.Start();
+   for (int n=0; n < nstraws; ++n) {
+      double *samples = new double[num_samples];
+      GlueXSensitiveDetectorCDC::cdc_wire_signal_mV(straws[n], samples,
+                                                    0, num_samples);
+      pulses_full += scan(samples, 0, num_samples);
+      delete [] samples;
+   }
+   timer.Stop();
+   double tfull = timer.GetRealElapsed();
+
+   std::vector<double> buffer(num_samples);
+   long int pulses_window = 0;
+   timer.Start();
+   for (int n=0; n < nstraws; ++n) {
+      int first, last;
+      GlueXSensitiveDetectorCDC::GetWaveformWindow(straws[n], num_samples,
+                                                   first, last);
+      GlueXSensitiveDetectorCDC::cdc_wire_signal_mV(straws[n], &buffer[0],
+                                                    first, last);
+      pulses_window += scan(&buffer[0], first, last);
+   }
+   timer.Stop();
+   double twindow = timer.GetRealElapsed();
+
+   std::cout << "full window: " << tfull / nstraws * 1e9 << " ns/straw, "
+             << pulses_full << " pulses" << std::endl
+             << "limited window: " << twindow / nstraws * 1e9
+             << " ns/straw, " << pulses_window << " pulses" << std::endl;
+   if (pulses_full != pulses_window)
+      std::cout << "warning - pulse counts differ!" << std::endl;
+   return 0;
+}
@@ -0,0 +1,95 @@
+#!/usr/bin/python
+#
+# geomquery.py - client for the hdgeant4 geometry and field query server
+#
+# Sends the points read from a file, or from stdin, one x y z in cm per
+# line, to an hdgeant4 running in query server mode (hdgeant4 -q<socket>)
+# in batches, and prints the reply for each point, one line per point
+# with the layer, volume path, material and field in Tesla, followed by
+# the values of the identifiers named with -i. See GlueXQueryServer.hh
+# for the format of the requests and replies. The Query class can also be
+# imported by other scripts that want to keep a connection open.
+#
+# author: richard.t.jones at uconn.edu
+# version: october 14, 2026
+
+from __future__ import print_function
+
+import sys
+import socket
+import getopt
+
+class Query:
+   def __init__(self, path, idents=[]):
+      self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+      self.sock.connect(path)
+      self.fin = self.sock.makefile("r")
+      if idents:
+         self.request("IDENT " + " ".join(idents) + "\n", 1)
+
+   def request(self, text, nlines):
+      self.sock.sendall(text.encode())
+      return [self.fin.readline().rstrip("\n") for n in range(nlines)]
+
+   def points(self, xyz):
+      text = "POINTS {0}\n".format(len(xyz))
+      text += "".join("{0} {1} {2}\n".format(*p) for p in xyz)
+      return self.request(text, len(xyz))
+
+   def close(self):
+      self.sock.sendall(b"QUIT\n")
+      self.sock.close()
+
+def usage():
+   print("Usage: geomquery.py [options] [<points.txt>]")
+   print("  sends the points, one x y z in cm per line, to the hdgeant4")
+   print("  query server and prints the replies, where options include:")
+   print("   -s <socket> : path of the server socket, default hdgeant4.sock")
+   print("   -i <ident,...> : HDDS identifiers to report, eg. ring,straw")
+   print("   -b <N> : number of points sent in each batch, default 10000")
+   print("   -x : ask the server to shut down when done")
+   sys.exit(1)
+
+def main(argv):
+   path = "hdgeant4.sock"
+   idents = []
+   batch = 10000
+   shutdown = False
+   try:
+      opts, args = getopt.getopt(argv, "s:i:b:xh")
+   except getopt.GetoptError:
+      usage()
+   for opt, arg in opts:
+      if opt == "-s":
+         path = arg
+      elif opt == "-i":
+         idents = arg.split(",")
+      elif opt == "-b":
+         batch = int(arg)
+      elif opt == "-x":
+         shutdown = True
+      else:
+         usage()
+
+   fin = open(args[0]) if args else sys.stdin
+   query = Query(path, idents)
+   xyz = []
+   for line in fin:
+      words = line.split()
+      if len(words) >= 3:
+         xyz.append(words[:3])
+      if len(xyz) == batch:
+         for reply in query.points(xyz):
+            print(reply)
+         xyz = []
+   if xyz:
+      for reply in query.points(xyz):
+         print(reply)
+   if shutdown:
+      query.sock.sendall(b"SHUTDOWN\n")
+      query.sock.close()
+   else:
+      query.close()
+
+if __name__ == "__main__":
+   main(sys.argv[1:])
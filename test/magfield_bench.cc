@@ -0,0 +1,213 @@
+//
+// magfield_bench.cc
+//
+// purpose: Benchmark comparing the throughput of single-point and batch
+//          field evaluation for the HDGeant4 magnetic field classes
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// usage: magfield_bench [<control.in>] [<npoints>]
+//
+// A synthetic Cartesian field map is written to a temporary file and
+// loaded into a GlueXMappedMagField, so the benchmark does not depend on
+// any external map. If a control.in file is given, cards that affect the
+// field classes (eg. MAGFIELDSTORE, MAGFIELDCACHE) are taken from it.
+// GlueXComputedMagField is not covered here because it needs the jana
+// framework and ccdb to be initialized.
+//
+// Before exiting, the storage engines selected by MAGFIELDSTORE are
+// checked against each other on a small non-cubic map stored with the
+// axes out of order, in which the field is linear so that all of them
+// should interpolate it exactly. The exit status is 1 if any of them
+// deviates from the exact field.
+//
+
+#include <GlueXUserOptions.hh>
+#include <GlueXMagneticField.hh>
+
+#include <G4Timer.hh>
+#include <G4SystemOfUnits.hh>
+#include <Randomize.hh>
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+int run_number = 0;
+
+void bench(const char *name, const G4MagneticField &field,
+           int npoints, const G4double *points, G4double *Bfield,
+           void (*batch)(const G4MagneticField&, int,
+                         const G4double*, G4double*))
+{
+   G4Timer timer;
+   timer.Start();
+   for (int n=0; n < npoints; ++n)
+      field.GetFieldValue(points + 4 * n, Bfield + 3 * n);
+   timer.Stop();
+   double tscalar = timer.GetRealElapsed();
+   timer.Start();
+   batch(field, npoints, points, Bfield);
+   timer.Stop();
+   double tbatch = timer.GetRealElapsed();
+   std::cout << name << ": scalar " << npoints / tscalar / 1e6
+             << " Mpoints/s, batch " << npoints / tbatch / 1e6
+             << " Mpoints/s" << std::endl;
+}
+
+template <class T>
+void batch_eval(const G4MagneticField &field, int npoints,
+                const G4double *points, G4double *Bfield)
+{
+   dynamic_cast<const T&>(field).GetFieldValues(npoints, points, Bfield);
+}
+
+double check_storage(GlueXUserOptions &options, const char *store)
+{
+   // load a 21 x 13 x 34 map of a linear field, strung out with y
+   // varying most slowly and x most rapidly, using the storage engine
+   // given as the arguments of a MAGFIELDSTORE card, and return the
+   // largest deviation from the exact field found at a set of points
+   // inside the map, in kG
+
+   const int nx=21, ny=13, nz=34;
+   char ctrlS[] = "/tmp/magfield_store_XXXXXX";
+   int fd = mkstemp(ctrlS);
+   close(fd);
+   std::ofstream ctrlfile(ctrlS);
+   ctrlfile << "MAGFIELDSTORE " << store << std::endl;
+   ctrlfile.close();
+   options.ReadControl_in(ctrlS);
+   unlink(ctrlS);
+
+   char mapS[] = "/tmp/magfield_store_XXXXXX";
+   fd = mkstemp(mapS);
+   close(fd);
+   std::ofstream mapfile(mapS);
+   for (int iy=0; iy < ny; ++iy) {
+      for (int iz=0; iz < nz; ++iz) {
+         for (int ix=0; ix < nx; ++ix) {
+            double x = -20 + 2. * ix;
+            double y = -12 + 2. * iy;
+            double z = -33 + 2. * iz;
+            mapfile << 1 + 0.01 * x - 0.02 * y + 0.003 * z << " "
+                    << -2 + 0.004 * x + 0.03 * y << " "
+                    << 15 - 0.001 * x + 0.002 * y - 0.05 * z << std::endl;
+         }
+      }
+   }
+   mapfile.close();
+
+   G4AffineTransform xform;
+   GlueXMappedMagField mapped(20, kilogauss, xform);
+   int axsamples[] = {0, nx, ny, nz};
+   int axorder[] = {0, 2, 3, 1};
+   int axsense[] = {1, 1, 1, 1};
+   G4double axlower[] = {0, -20, -12, -33};
+   G4double axupper[] = {0, 20, 12, 33};
+   mapped.AddCartesianGrid(axsamples, axorder, axsense, axlower, axupper);
+   mapped.ReadMapFile(mapS);
+   unlink(mapS);
+
+   double maxdev = 0;
+   for (int n=0; n < 10000; ++n) {
+      double x = -19.9 + G4UniformRand() * 39.8;
+      double y = -11.9 + G4UniformRand() * 23.8;
+      double z = -32.9 + G4UniformRand() * 65.8;
+      G4double point[4] = {x * cm, y * cm, z * cm, 0};
+      G4double B[3];
+      mapped.GetFieldValue(point, B);
+      double exact[3] = {1 + 0.01 * x - 0.02 * y + 0.003 * z,
+                         -2 + 0.004 * x + 0.03 * y,
+                         15 - 0.001 * x + 0.002 * y - 0.05 * z};
+      for (int i=0; i < 3; ++i) {
+         double dev = fabs(B[i] / kilogauss - exact[i]);
+         maxdev = (dev > maxdev)? dev : maxdev;
+      }
+   }
+   std::cout << "MAGFIELDSTORE " << store << ": max deviation "
+             << maxdev << " kG" << std::endl;
+   return maxdev;
+}
+
+int main(int argc, char *argv[])
+{
+   GlueXUserOptions options;
+   if (argc > 1)
+      options.ReadControl_in(argv[1]);
+   int npoints = (argc > 2)? atoi(argv[2]) : 1000000;
+
+   // write a synthetic 101 x 101 x 201 map of a solenoid-like field
+
+   const int nx=101, ny=101, nz=201;
+   char mapS[] = "/tmp/magfield_bench_XXXXXX";
+   int fd = mkstemp(mapS);
+   close(fd);
+   std::ofstream mapfile(mapS);
+   for (int ix=0; ix < nx; ++ix) {
+      for (int iy=0; iy < ny; ++iy) {
+         for (int iz=0; iz < nz; ++iz) {
+            double x = -100 + 2. * ix;
+            double y = -100 + 2. * iy;
+            double z = -200 + 2. * iz;
+            mapfile << 1e-4 * x * z << " " << 1e-4 * y * z << " "
+                    << 20 - 1e-4 * (x*x + y*y) << std::endl;
+         }
+      }
+   }
+   mapfile.close();
+
+   G4AffineTransform xform;
+   GlueXUniformMagField uniform(G4ThreeVector(0, 0, 20), kilogauss, xform);
+   GlueXMappedMagField mapped(20, kilogauss, xform);
+   int axsamples[] = {0, nx, ny, nz};
+   int axorder[] = {0, 1, 2, 3};
+   int axsense[] = {1, 1, 1, 1};
+   G4double axlower[] = {0, -100, -100, -200};
+   G4double axupper[] = {0, 100, 100, 200};
+   mapped.AddCartesianGrid(axsamples, axorder, axsense, axlower, axupper);
+   GlueXMappedMagField::SetMapCachePolicy(0);
+   mapped.ReadMapFile(mapS);
+   unlink(mapS);
+
+   // sample random points inside the map volume, in clusters
+   // of nearby points as they would be seen along a track, with
+   // the start of each cluster chosen so that all 100 of its
+   // points, spanning 49.5 x 19.8 x 99 cm, stay inside the map
+
+   std::vector<G4double> points(4 * npoints);
+   std::vector<G4double> Bfield(3 * npoints);
+   for (int n=0; n < npoints; ++n) {
+      if (n % 100 == 0) {
+         points[4 * n] = (-99 + G4UniformRand() * 148) * cm;
+         points[4 * n + 1] = (-99 + G4UniformRand() * 178) * cm;
+         points[4 * n + 2] = (-199 + G4UniformRand() * 298) * cm;
+      }
+      else {
+         points[4 * n] = points[4 * n - 4] + 0.5 * cm;
+         points[4 * n + 1] = points[4 * n - 3] + 0.2 * cm;
+         points[4 * n + 2] = points[4 * n - 2] + 1.0 * cm;
+      }
+      points[4 * n + 3] = 0;
+   }
+
+   bench("GlueXUniformMagField", uniform, npoints, &points[0], &Bfield[0],
+         batch_eval<GlueXUniformMagField>);
+   bench("GlueXMappedMagField", mapped, npoints, &points[0], &Bfield[0],
+         batch_eval<GlueXMappedMagField>);
+
+   // check that the storage engines agree on a map with unequal
+   // dimensions, where a mistake in the node ordering would show
+
+   const char *stores[] = {"'triplets'", "'double' 1", "'float' 1",
+                           "'double' 4", "'float' 4", 0};
+   int status = 0;
+   for (int i=0; stores[i]; ++i) {
+      if (check_storage(options, stores[i]) > 1e-4)
+         status = 1;
+   }
+   return status;
+}
@@ -0,0 +1,356 @@
+//
+// navigation_bench.cc
+//
+// purpose: Benchmark of point lookups in the full HDGeant4 geometry,
+//          replaying a list of points like the one made by sampler.py
+//          through G4Navigator::LocateGlobalPointAndSetup in each of
+//          the geometry layers and through the field lookup of
+//          GlueXDetectorConstruction::GetMagneticField, and reporting
+//          the time per lookup for the points in each top-level volume
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// usage: navigation_bench [-p <points>] [-o <report>] [-b <baseline>]
+//                         [-s <slack_percent>] [-l <lookups>] [-n <passes>]
+//
+// It must be run in a directory with the control.in and the geometry
+// that hdgeant4 would use. The points are read from the named file, one
+// per line as x y z in cm, as written by "sampler.py sample", otherwise
+// the same number of them are generated from the same distribution.
+//
+// The report has one line for every top-level volume that contains any
+// of the points, in each layer, with columns separated by tabs, sorted
+// so that reports from different geometries or builds can be compared
+// with diff. The time per lookup is the least of the given number of
+// passes over the points. If a baseline report is given, any volume
+// whose lookups are slower than it by more than the slack, or which
+// holds a different number of the points, is listed and the exit code
+// is 1, so that it can be used as a check in CI. The lookups file has
+// the volume and field found at each point, in the format produced by
+// "sampler.py scan4", so it can be compared with that of hdgeant using
+// "sampler.py compare".
+//
+
+#include <GlueXUserOptions.hh>
+#include <GlueXDetectorConstruction.hh>
+#include <HddsG4Builder.hh>
+
+#include <G4LogicalVolume.hh>
+#include <G4PVPlacement.hh>
+#include <G4Navigator.hh>
+#include <G4TouchableHistory.hh>
+#include <G4TransportationManager.hh>
+#include <G4GeometryManager.hh>
+#include <G4SystemOfUnits.hh>
+#include <Randomize.hh>
+
+#include <DANA/DApplication.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <map>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+int run_number = 0;
+
+const int kDefaultPoints = 100000;
+
+struct group_t {
+   std::vector<int> points;   // indices of the points in this volume
+   double locate_ns;          // least time per locate over the passes
+   double field_ns;           // least time per field lookup, layer 0 only
+};
+
+typedef std::map<std::string, group_t> layer_groups_t;
+
+void usage()
+{
+   std::cerr << "Usage: navigation_bench [-p <points>] [-o <report>]"
+             << " [-b <baseline>]" << std::endl
+             << "                        [-s <slack_percent>]"
+             << " [-l <lookups>] [-n <passes>]" << std::endl;
+   exit(9);
+}
+
+std::string top_volume(G4Navigator &navigator, const G4ThreeVector &point,
+                       std::string &located, bool &filled)
+{
+   // Locate point and return the name of the daughter of the world that
+   // holds it, or of the world itself, with the name of the volume that
+   // it was found in and whether that volume has a material.
+
+   navigator.LocateGlobalPointAndSetup(point, 0, false, true);
+   G4TouchableHistory *touch = navigator.CreateTouchableHistory();
+   int depth = touch->GetHistoryDepth();
+   G4LogicalVolume *top = touch->GetVolume((depth > 0)? depth - 1 : 0)
+                               ->GetLogicalVolume();
+   G4LogicalVolume *here = touch->GetVolume(0)->GetLogicalVolume();
+   located = here->GetName();
+   filled = (here->GetMaterial() != 0);
+   delete touch;
+   return top->GetName();
+}
+
+double elapsed_ns(const std::chrono::steady_clock::time_point &start)
+{
+   std::chrono::duration<double, std::nano> elapsed;
+   elapsed = std::chrono::steady_clock::now() - start;
+   return elapsed.count();
+}
+
+int compare(const char *baseline, const std::vector<layer_groups_t> &layers,
+            double slack)
+{
+   // Compare the timings in layers against those in the baseline report,
+   // and list the volumes that are slower by more than slack, or that
+   // hold a different number of points. Returns the number listed.
+
+   std::ifstream fin(baseline);
+   if (! fin.good()) {
+      std::cerr << "navigation_bench error - cannot open baseline report "
+                << baseline << std::endl;
+      exit(2);
+   }
+   int differences = 0;
+   std::string line;
+   std::getline(fin, line);
+   while (std::getline(fin, line)) {
+      std::stringstream words(line);
+      unsigned int layer;
+      std::string volume, field;
+      int npoints;
+      double locate_ns, field_ns = 0;
+      words >> layer >> volume >> npoints >> locate_ns >> field;
+      if (field != "-")
+         field_ns = atof(field.c_str());
+      layer_groups_t::const_iterator iter;
+      if (layer >= layers.size() ||
+          (iter = layers[layer].find(volume)) == layers[layer].end())
+      {
+         std::cout << "layer " << layer << " " << volume
+                   << ": no longer found" << std::endl;
+         ++differences;
+         continue;
+      }
+      const group_t &group = iter->second;
+      if ((int)group.points.size() != npoints) {
+         std::cout << "layer " << layer << " " << volume << ": holds "
+                   << group.points.size() << " points, was " << npoints
+                   << std::endl;
+         ++differences;
+      }
+      if (group.locate_ns > locate_ns * (1 + slack)) {
+         std::cout << "layer " << layer << " " << volume << ": locate "
+                   << group.locate_ns << " ns, was " << locate_ns
+                   << " ns" << std::endl;
+         ++differences;
+      }
+      if (field_ns > 0 && group.field_ns > field_ns * (1 + slack)) {
+         std::cout << "layer " << layer << " " << volume << ": field "
+                   << group.field_ns << " ns, was " << field_ns
+                   << " ns" << std::endl;
+         ++differences;
+      }
+   }
+   return differences;
+}
+
+int main(int argc, char *argv[])
+{
+   // Initialize the jana framework, needed by the computed fields
+   DApplication dapp(argc, argv);
+   dapp.Init();
+
+   std::string pointsfile;
+   std::string reportfile;
+   std::string baseline;
+   std::string lookupsfile;
+   double slack = 0.2;
+   int passes = 5;
+   int c;
+   while ((c = getopt(argc, argv, "p:o:b:s:l:n:")) != -1) {
+      if (c == 'p')
+         pointsfile = optarg;
+      else if (c == 'o')
+         reportfile = optarg;
+      else if (c == 'b')
+         baseline = optarg;
+      else if (c == 's')
+         slack = atof(optarg) / 100;
+      else if (c == 'l')
+         lookupsfile = optarg;
+      else if (c == 'n')
+         passes = atoi(optarg);
+      else
+         usage();
+   }
+   passes = (passes > 0)? passes : 1;
+
+   GlueXUserOptions opts;
+   if (! opts.ReadControl_in("control.in"))
+      exit(3);
+
+   // read the points, or make them the way sampler.py does
+
+   std::vector<G4ThreeVector> points;
+   if (pointsfile.size() > 0) {
+      std::ifstream fin(pointsfile.c_str());
+      if (! fin.good()) {
+         std::cerr << "navigation_bench error - cannot open points file "
+                   << pointsfile << std::endl;
+         exit(2);
+      }
+      double x, y, z;
+      while (fin >> x >> y >> z)
+         points.push_back(G4ThreeVector(x*cm, y*cm, z*cm));
+   }
+   else {
+      CLHEP::HepRandom::setTheSeed(20150721);
+      for (int n=0; n < kDefaultPoints; ++n) {
+         double x = (G4UniformRand() * 200 - 100) * cm;
+         double y = (G4UniformRand() * 200 - 100) * cm;
+         double z = (G4UniformRand() * 3200 - 2400) * cm;
+         points.push_back(G4ThreeVector(x, y, z));
+      }
+   }
+   int npoints = points.size();
+
+   // build the geometry, and give the field lookup a world to search
+
+   GlueXDetectorConstruction *geometry = new GlueXDetectorConstruction();
+   G4VPhysicalVolume *world = geometry->Construct();
+   G4TransportationManager::GetTransportationManager()
+                           ->GetNavigatorForTracking()
+                           ->SetWorldVolume(world);
+   const HddsG4Builder *builder = GlueXDetectorConstruction::GetBuilder();
+   std::vector<G4VPhysicalVolume*> tops(1, world);
+   while (G4LogicalVolume *top = builder->getWorldVolume(tops.size())) {
+      tops.push_back(new G4PVPlacement(0, G4ThreeVector(), top,
+                                       top->GetName(), 0, 0, 0));
+   }
+   G4GeometryManager::GetInstance()->CloseGeometry(true, false);
+   std::vector<G4Navigator*> navigators;
+   for (unsigned int w=0; w < tops.size(); ++w) {
+      navigators.push_back(new G4Navigator());
+      navigators[w]->SetWorldVolume(tops[w]);
+   }
+
+   // sort the points by the top-level volume that they are in, in each
+   // layer, and find the volume and field at each one, as GlueXPathFinder
+   // would, taking the volume from the last layer in which it is filled
+
+   std::vector<layer_groups_t> layers(tops.size());
+   std::vector<std::string> found(npoints);
+   std::vector<G4ThreeVector> Bfield(npoints);
+   for (int n=0; n < npoints; ++n) {
+      for (int w=tops.size() - 1; w >= 0; --w) {
+         std::string located;
+         bool filled;
+         std::string top = top_volume(*navigators[w], points[n],
+                                      located, filled);
+         layers[w][top].points.push_back(n);
+         if (found[n].size() == 0 && (filled || w == 0))
+            found[n] = located;
+      }
+      Bfield[n] = geometry->GetMagneticField(points[n], tesla);
+   }
+
+   // time the lookups of the points in each group
+
+   double checksum = 0;
+   for (unsigned int w=0; w < layers.size(); ++w) {
+      layer_groups_t::iterator iter;
+      for (iter = layers[w].begin(); iter != layers[w].end(); ++iter) {
+         group_t &group = iter->second;
+         int size = group.points.size();
+         group.locate_ns = 0;
+         group.field_ns = 0;
+         for (int pass=0; pass < passes; ++pass) {
+            std::chrono::steady_clock::time_point start;
+            start = std::chrono::steady_clock::now();
+            for (int i=0; i < size; ++i) {
+               G4ThreeVector &point = points[group.points[i]];
+               navigators[w]->LocateGlobalPointAndSetup(point, 0,
+                                                        false, true);
+            }
+            double ns = elapsed_ns(start) / size;
+            if (pass == 0 || ns < group.locate_ns)
+               group.locate_ns = ns;
+            if (w > 0)
+               continue;
+            start = std::chrono::steady_clock::now();
+            for (int i=0; i < size; ++i) {
+               G4ThreeVector &point = points[group.points[i]];
+               checksum += geometry->GetMagneticField(point, tesla).z();
+            }
+            ns = elapsed_ns(start) / size;
+            if (pass == 0 || ns < group.field_ns)
+               group.field_ns = ns;
+         }
+      }
+   }
+   G4GeometryManager::GetInstance()->OpenGeometry();
+   std::cout << npoints << " points in " << layers.size() << " layers, "
+             << passes << " passes (field checksum " << checksum << ")"
+             << std::endl;
+
+   // write out the report, and the lookups if requested
+
+   std::ofstream fout;
+   if (reportfile.size() > 0) {
+      fout.open(reportfile.c_str());
+      if (! fout.good()) {
+         std::cerr << "navigation_bench error - cannot open report file "
+                   << reportfile << std::endl;
+         exit(2);
+      }
+   }
+   std::ostream &report = (reportfile.size() > 0)? fout : std::cout;
+   report << "layer\tvolume\tpoints\tlocate_ns\tfield_ns" << std::endl
+          << std::fixed << std::setprecision(1);
+   for (unsigned int w=0; w < layers.size(); ++w) {
+      layer_groups_t::iterator iter;
+      for (iter = layers[w].begin(); iter != layers[w].end(); ++iter) {
+         report << w << "\t" << iter->first << "\t"
+                << iter->second.points.size() << "\t"
+                << iter->second.locate_ns << "\t";
+         if (w == 0)
+            report << iter->second.field_ns << std::endl;
+         else
+            report << "-" << std::endl;
+      }
+   }
+   if (lookupsfile.size() > 0) {
+      FILE *fp = fopen(lookupsfile.c_str(), "w");
+      if (fp == 0) {
+         std::cerr << "navigation_bench error - cannot open lookups file "
+                   << lookupsfile << std::endl;
+         exit(2);
+      }
+      for (int n=0; n < npoints; ++n) {
+         fprintf(fp, "%7.2f  %7.2f  %7.2f     %s %12.7f  %12.7f  %12.7f\n",
+                 points[n].x() / cm, points[n].y() / cm,
+                 points[n].z() / cm, found[n].c_str(),
+                 Bfield[n].x(), Bfield[n].y(), Bfield[n].z());
+      }
+      fclose(fp);
+   }
+
+   int differences = 0;
+   if (baseline.size() > 0) {
+      differences = compare(baseline.c_str(), layers, slack);
+      std::cout << differences << " differences from baseline " << baseline
+                << " with " << slack * 100 << "% slack" << std::endl;
+   }
+   for (unsigned int w=0; w < navigators.size(); ++w)
+      delete navigators[w];
+   delete geometry;
+   return (differences > 0)? 1 : 0;
+}
@@ -19,6 +19,8 @@ def usage():
    print "  *) sample - generate a set of random coordinates for sampling"
    print "  *) scan3 <logfile> - scan logfile for picking output from hdgeant"
    print "  *) scan4 <logfile> - scan logfile for picking output from hdgeant4"
+   print "     (or generate the same output directly from the sample file"
+   print "     with hdgeant4.probeBfield in g4py, without picking)"
    print "  *) compare <file3> <file4> - compare output from file3 and file4"
    print "     which should be output from prior scan3 and scan4 runs."
 
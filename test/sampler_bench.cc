@@ -0,0 +1,102 @@
+//
+// sampler_bench.cc
+//
+// purpose: Benchmark of the importance-sampling tables used to generate
+//          coherent bremsstrahlung beam photons, comparing the inversion
+//          of each table by a linear scan over its integral (as before)
+//          against the guide-table lookup in ImportanceSampler::sample
+//          (as now), and checking that both give the same samples
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// usage: sampler_bench [<nsamples>] [<Emax_GeV>] [<Epeak_GeV>]
+//
+// The tables are filled from the CobremsGenerator rates by calling
+// GlueXPrimaryGeneratorAction::prepareCobremsImportanceSamplingPDFs,
+// with the default beamline parameters.
+//
+
+#include <GlueXPrimaryGeneratorAction.hh>
+#include <CobremsGenerator.hh>
+
+#include <G4Timer.hh>
+#include <Randomize.hh>
+
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+
+int run_number = 0;
+
+typedef GlueXPrimaryGeneratorAction::ImportanceSampler ImportanceSampler;
+
+double scan(const ImportanceSampler &pdf, double u, double &f)
+{
+   // the linear scan that GenerateBeamPhoton used before
+
+   for (unsigned int i=1; i < pdf.randvar.size(); ++i) {
+      if (u <= pdf.integral[i]) {
+         double x0 = pdf.randvar[i - 1];
+         double x1 = pdf.randvar[i];
+         double f0 = pdf.density[i - 1];
+         double f1 = pdf.density[i];
+         double u0 = pdf.integral[i - 1];
+         double u1 = pdf.integral[i];
+         f = (f0 * (u1 - u) + f1 * (u - u0)) / (u1 - u0);
+         return (x0 * (u1 - u) + x1 * (u - u0)) / (u1 - u0);
+      }
+   }
+   f = 0;
+   return 0;
+}
+
+void bench(const char *name, const ImportanceSampler &pdf,
+           const std::vector<double> &u)
+{
+   int nsamples = u.size();
+   G4Timer timer;
+   double f, sum_scan = 0, sum_guide = 0;
+   timer.Start();
+   for (int n=0; n < nsamples; ++n)
+      sum_scan += scan(pdf, u[n], f);
+   timer.Stop();
+   double tscan = timer.GetRealElapsed();
+   timer.Start();
+   for (int n=0; n < nsamples; ++n)
+      sum_guide += pdf.sample(u[n], f);
+   timer.Stop();
+   double tguide = timer.GetRealElapsed();
+
+   int ndiffer = 0;
+   for (int n=0; n < nsamples; ++n) {
+      double f1, f2;
+      if (scan(pdf, u[n], f1) != pdf.sample(u[n], f2) || f1 != f2)
+         ++ndiffer;
+   }
+   std::cout << name << " (" << pdf.randvar.size() << " entries): "
+             << "linear scan " << nsamples / tscan << " samples/s, "
+             << "guide table " << nsamples / tguide << " samples/s"
+             << std::endl;
+   if (ndiffer > 0 || sum_scan != sum_guide)
+      std::cout << "warning - " << ndiffer << " samples differ!" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+   int nsamples = (argc > 1)? atoi(argv[1]) : 10000000;
+   double Emax = (argc > 2)? atof(argv[2]) : 12.;
+   double Epeak = (argc > 3)? atof(argv[3]) : 9.;
+
+   CobremsGenerator cobrems(Emax, Epeak);
+   GlueXPrimaryGeneratorAction::prepareCobremsImportanceSamplingPDFs(&cobrems);
+
+   std::vector<double> u(nsamples);
+   for (int n=0; n < nsamples; ++n)
+      u[n] = G4UniformRand();
+
+   bench("coherent x", GlueXPrimaryGeneratorAction::getCoherentPDFx(), u);
+   bench("incoherent log(x)",
+         GlueXPrimaryGeneratorAction::getIncoherentPDFlogx(), u);
+   bench("incoherent y", GlueXPrimaryGeneratorAction::getIncoherentPDFy(), u);
+   return 0;
+}
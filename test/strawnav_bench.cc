@@ -0,0 +1,227 @@
+//
+// strawnav_bench.cc
+//
+// purpose: Benchmark of navigation through the straws of a CDC-like
+//          chamber, comparing the straws placed one by one (as built
+//          from HDDS) against the same straws converted into rings by
+//          GlueXStrawRing (as with the STRAWRINGS card)
+// author: richard.t.jones at uconn.edu
+// version: october 14, 2026
+//
+// usage: strawnav_bench [<nrays>] [<npoints>]
+//
+// The chamber has the same number of straws in each of its 28 rings as
+// the CDC, with axial and +/-6 degree stereo superlayers in the same
+// order, but the ring radii are spaced more widely than in the real
+// chamber, so that it does not depend on the HDDS geometry. Before the
+// timing, the two geometries are checked to find the same straw, and
+// copy number, at a set of random points in the chamber. Geantino rays
+// are then shot from the target out through the chamber in each one.
+//
+
+#include <GlueXStrawRing.hh>
+
+#include <G4Box.hh>
+#include <G4Tubs.hh>
+#include <G4LogicalVolume.hh>
+#include <G4PVPlacement.hh>
+#include <G4NistManager.hh>
+#include <G4Navigator.hh>
+#include <G4TouchableHistory.hh>
+#include <G4GeometryManager.hh>
+#include <G4Timer.hh>
+#include <G4SystemOfUnits.hh>
+#include <Randomize.hh>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <math.h>
+#include <stdlib.h>
+
+int run_number = 0;
+
+// number of straws in each ring of the CDC, from the inside out,
+// as in GlueXSensitiveDetectorCDC
+const int num_rings = 28;
+const int ring_straws[num_rings] = {42, 42, 54, 54, 66, 66, 80, 80, 93, 93,
+                                    106, 106, 123, 123, 135, 135, 146, 146,
+                                    158, 158, 170, 170, 182, 182, 197, 197,
+                                    209, 209};
+
+const double straw_radius = 0.7776*cm;
+const double straw_halflength = 75.0*cm;
+const double first_ring_radius = 10.72*cm;
+const double ring_spacing = 2.0*cm;
+const double chamber_rmin = 9.0*cm;
+const double chamber_rmax = 68.0*cm;
+const double chamber_halflength = 85.0*cm;
+
+G4VPhysicalVolume *build_chamber(const char *name, int &rings)
+{
+   // Build a world holding the chamber with all of its straws placed
+   // individually, numbered from 1 in each ring, and if rings is set,
+   // convert them into GlueXStrawRing volumes, returning the number of
+   // these in rings.
+
+   G4NistManager *nist = G4NistManager::Instance();
+   G4Material *air = nist->FindOrBuildMaterial("G4_AIR");
+   G4Material *gas = nist->FindOrBuildMaterial("G4_Ar");
+   G4Material *mylar = nist->FindOrBuildMaterial("G4_MYLAR");
+   G4Box *worldS = new G4Box(name, 1*m, 1*m, 1*m);
+   G4LogicalVolume *world = new G4LogicalVolume(worldS, air, name);
+   G4Tubs *cdcS = new G4Tubs("CDC", chamber_rmin, chamber_rmax,
+                             chamber_halflength, 0, 2*M_PI);
+   G4LogicalVolume *cdc = new G4LogicalVolume(cdcS, gas, "CDC");
+   new G4PVPlacement(0, G4ThreeVector(), cdc, "CDC", world, 0, 0);
+
+   for (int ring=1; ring <= num_rings; ++ring) {
+      double stereo = 0;
+      if (ring >= 5 && ring <= 8)
+         stereo = 6*deg;
+      else if (ring >= 9 && ring <= 12)
+         stereo = -6*deg;
+      else if (ring >= 17 && ring <= 20)
+         stereo = -6*deg;
+      else if (ring >= 21 && ring <= 24)
+         stereo = 6*deg;
+      std::stringstream strawname;
+      strawname << "STRAW" << (ring < 10? "0" : "") << ring;
+      G4Tubs *tubeS = new G4Tubs(strawname.str(), 0, straw_radius,
+                                 straw_halflength, 0, 2*M_PI);
+      G4LogicalVolume *tube = new G4LogicalVolume(tubeS, mylar,
+                                                  strawname.str());
+      G4Tubs *gasS = new G4Tubs(strawname.str() + "gas", 0,
+                                straw_radius - 0.01*cm,
+                                straw_halflength, 0, 2*M_PI);
+      G4LogicalVolume *gasvol = new G4LogicalVolume(gasS, gas,
+                                               strawname.str() + "gas");
+      new G4PVPlacement(0, G4ThreeVector(), gasvol,
+                        strawname.str() + "gas", tube, 0, 0);
+      int nstraws = ring_straws[ring-1];
+      double radius = first_ring_radius + (ring - 1) * ring_spacing;
+      for (int sector=1; sector <= nstraws; ++sector) {
+         double phi = (sector - 0.5) * 2*M_PI / nstraws;
+         G4RotationMatrix rot;
+         rot.rotateX(-stereo);
+         rot.rotateZ(phi);
+         G4ThreeVector pos(radius * cos(phi), radius * sin(phi), 0);
+         new G4PVPlacement(G4Transform3D(rot, pos), tube,
+                           strawname.str(), cdc, 0, sector);
+      }
+   }
+
+   if (rings) {
+      std::map<G4VPhysicalVolume*, G4VPhysicalVolume*> replaced;
+      rings = GlueXStrawRing::Convert(cdc, 16, replaced);
+   }
+   return new G4PVPlacement(0, G4ThreeVector(), world, name, 0, 0, 0);
+}
+
+int straw_at(G4Navigator &navigator, const G4ThreeVector &point, int &copy)
+{
+   // Locate point and return the ring number of the straw that holds it,
+   // or 0 if it is not in a straw, with the straw copy number in copy.
+
+   navigator.LocateGlobalPointAndSetup(point, 0, false, true);
+   G4TouchableHistory *touch = navigator.CreateTouchableHistory();
+   int ring = 0;
+   for (int depth=0; depth < touch->GetHistoryDepth(); ++depth) {
+      G4String name = touch->GetVolume(depth)->GetLogicalVolume()->GetName();
+      if (name.size() == 7 && name.substr(0, 5) == "STRAW") {
+         ring = atoi(name.substr(5).c_str());
+         copy = GlueXStrawRing::GetCopyNumber(touch, depth);
+         break;
+      }
+   }
+   delete touch;
+   return ring;
+}
+
+long int shoot(G4Navigator &navigator, int nrays)
+{
+   // Shoot nrays rays out from the origin, spread evenly in direction,
+   // and return the number of steps taken to leave the world.
+
+   long int nsteps = 0;
+   for (int n=0; n < nrays; ++n) {
+      double costheta = 0.9 * (1 - (2 * n + 1.) / nrays);
+      double sintheta = sqrt(1 - costheta * costheta);
+      double phi = n * 2.399963229728653;  // golden angle
+      G4ThreeVector dir(sintheta * cos(phi), sintheta * sin(phi), costheta);
+      G4ThreeVector pos;
+      navigator.LocateGlobalPointAndSetup(pos, &dir, false, false);
+      for (int step=0; step < 100000; ++step) {
+         double safety;
+         double length = navigator.ComputeStep(pos, dir, kInfinity, safety);
+         if (length >= kInfinity)
+            break;
+         pos += length * dir;
+         navigator.SetGeometricallyLimitedStep();
+         ++nsteps;
+         if (navigator.LocateGlobalPointAndSetup(pos, &dir, true) == 0)
+            break;
+      }
+   }
+   return nsteps;
+}
+
+int main(int argc, char *argv[])
+{
+   int nrays = (argc > 1)? atoi(argv[1]) : 10000;
+   int npoints = (argc > 2)? atoi(argv[2]) : 100000;
+
+   int placed_rings = 0;
+   int converted_rings = 1;
+   G4VPhysicalVolume *placed = build_chamber("placed", placed_rings);
+   G4VPhysicalVolume *converted = build_chamber("rings", converted_rings);
+   std::cout << converted_rings << " of " << num_rings
+             << " rings converted" << std::endl;
+   G4GeometryManager::GetInstance()->CloseGeometry(true, false);
+
+   G4Navigator placed_nav;
+   placed_nav.SetWorldVolume(placed);
+   G4Navigator rings_nav;
+   rings_nav.SetWorldVolume(converted);
+
+   int mismatches = 0;
+   int instraw = 0;
+   for (int n=0; n < npoints; ++n) {
+      double r = sqrt(chamber_rmin * chamber_rmin + G4UniformRand() *
+                      (chamber_rmax * chamber_rmax -
+                       chamber_rmin * chamber_rmin));
+      double phi = G4UniformRand() * 2*M_PI;
+      double z = (2 * G4UniformRand() - 1) * chamber_halflength;
+      G4ThreeVector point(r * cos(phi), r * sin(phi), z);
+      int copy1 = 0;
+      int copy2 = 0;
+      int ring1 = straw_at(placed_nav, point, copy1);
+      int ring2 = straw_at(rings_nav, point, copy2);
+      if (ring1 != ring2 || copy1 != copy2)
+         ++mismatches;
+      instraw += (ring1 > 0);
+   }
+   std::cout << npoints << " points, " << instraw << " in straws, "
+             << mismatches << " located differently" << std::endl;
+
+   G4Timer timer;
+   timer.Start();
+   long int placed_steps = shoot(placed_nav, nrays);
+   timer.Stop();
+   double tplaced = timer.GetUserElapsed();
+   timer.Start();
+   long int rings_steps = shoot(rings_nav, nrays);
+   timer.Stop();
+   double trings = timer.GetUserElapsed();
+
+   std::cout << "placed straws: " << tplaced / nrays * 1e6 << " us/ray, "
+             << placed_steps / double(nrays) << " steps/ray" << std::endl
+             << "straw rings: " << trings / nrays * 1e6 << " us/ray, "
+             << rings_steps / double(nrays) << " steps/ray" << std::endl
+             << "speedup: " << tplaced / trings << std::endl;
+   if (mismatches > 0)
+      std::cout << "warning - the two geometries disagree!" << std::endl;
+   G4GeometryManager::GetInstance()->OpenGeometry();
+   return 0;
+}
@@ -3,11 +3,16 @@
 # trackdiff.py - script to compare the track stepping log output
 #                from hdgeant and hdgeant4 (/tracking/verbose 2)
 #
+# The hdgeant4 log may also be a binary step trace, written by hdgeant4
+# with /tracking/verbose 1 when the STEPTRACE card is given in control.in,
+# which is recognized from its first record.
+#
 # author: richard.t.jones at uconn.edu
 # version: august 10, 2015
 
 import sys
 import re
+import struct
 
 def usage():
    print
@@ -18,10 +23,33 @@ if len(sys.argv) != 3:
    usage()
 
 g3log = open(sys.argv[1])
-g4log = open(sys.argv[2])
+g4log = open(sys.argv[2], "rb")
 if not (g3log and g4log):
    usage()
 
+# Layout of the records in a binary step trace, see GlueXSteppingVerbose.hh
+trace_step = struct.Struct("<4i2H7f")
+trace_name = struct.Struct("<2i40s")
+trace_record_size = 48
+trace_volume_name = -1
+trace_process_name = -2
+trace_file_header = -3
+
+g4trace = False
+first = g4log.read(trace_record_size)
+if len(first) == trace_record_size:
+   kind, version, name = trace_name.unpack(first)
+   g4trace = (kind == trace_file_header)
+if g4trace:
+   if version != 1:
+      print "unsupported step trace version", version, "quitting!"
+      sys.exit(1)
+   g4trace_volumes = {0: "NULL"}
+   g4trace_processes = {}
+   g4trace_next = None
+else:
+   g4log.seek(0)
+
 def read_g3log():
    """
    Read the next event from the geant3 tracking log and return the step
@@ -111,6 +139,64 @@ def read_g4log():
          return
    g4log = 0
 
+def read_g4trace():
+   """
+   Read the next event from the geant4 binary step trace and return the
+   step information at each geometry transition in a tuple object with
+   the contents (step, name, num, x, y, z, ds, s), using generator
+   semantics, the same as read_g4log does for the text listing. Each
+   record also holds the kinetic energy, the energy deposit and the name
+   of the process that limited the step, which are not compared here.
+   """
+   global g4log
+   global g4trace_next
+   name = ""
+   num = 0
+   event = None
+   slist = []
+   while g4log:
+      if g4trace_next:
+         rec = g4trace_next
+         g4trace_next = None
+      else:
+         rec = g4log.read(trace_record_size)
+         if len(rec) < trace_record_size:
+            g4log = 0
+            break
+      kind, tag = struct.unpack("<2i", rec[:8])
+      if kind == trace_volume_name:
+         g4trace_volumes[tag] = trace_name.unpack(rec)[2].rstrip("\0")
+         continue
+      elif kind == trace_process_name:
+         g4trace_processes[tag] = trace_name.unpack(rec)[2].rstrip("\0")
+         continue
+      elif kind < 0:
+         continue
+      step = trace_step.unpack(rec)
+      if event is None:
+         event = step[0]
+      elif step[0] != event:
+         g4trace_next = rec
+         return
+      vname = g4trace_volumes[step[4]]
+      if step[12] == 0:
+         name = vname
+         num = step[3]
+         slist = [step]
+      elif vname != name or step[3] != num:
+         x = slist[0][6] * 0.1
+         y = slist[0][7] * 0.1
+         z = slist[0][8] * 0.1
+         s = slist[0][12] * 0.1
+         ds = sum(si[11] for si in slist[1:]) * 0.1 + step[11] * 0.1
+         if ds > 1e-12:
+            yield (slist[0][2], name, num, x, y, z, ds, s)
+         name = vname
+         num = step[3]
+         slist = [step]
+      else:
+         slist.append(step)
+
 def length_in_cm(value, unit):
    """
    Returns length specified in some arbitrary length unit in cm.
@@ -231,9 +317,13 @@ def compare(g3, g4):
       except:
          break
 
+if g4trace:
+   read_g4log = read_g4trace
+
 # advance the input logs to the start of the first event
 sum(0 for m in read_g3log())
-sum(0 for m in read_g4log())
+if not g4trace:
+   sum(0 for m in read_g4log())
 
 # loop over events, should be the same number in both logs
 if False: